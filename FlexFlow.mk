@@ -48,11 +48,16 @@ ifeq ($(strip $(USE_GASNET)),1)
 endif
 
 GEN_SRC += ${FF_HOME}/src/runtime/accessor.cc\
+		${FF_HOME}/src/runtime/checkpoint.cc\
+		${FF_HOME}/src/runtime/compile_cache.cc\
+		${FF_HOME}/src/runtime/egraph.cc\
+		${FF_HOME}/src/runtime/fx_importer.cc\
 		${FF_HOME}/src/runtime/graph.cc\
 		${FF_HOME}/src/runtime/initializer.cc\
 		${FF_HOME}/src/runtime/layer.cc\
 		${FF_HOME}/src/runtime/machine_model.cc\
 		${FF_HOME}/src/runtime/machine_view.cc\
+		${FF_HOME}/src/runtime/memory_planner.cc\
 		${FF_HOME}/src/runtime/model.cc\
 		${FF_HOME}/src/runtime/network.cc\
 		${FF_HOME}/src/runtime/optimizer.cc\
@@ -76,6 +81,7 @@ GEN_SRC += ${FF_HOME}/src/runtime/accessor.cc\
 		${FF_HOME}/src/ops/element_binary.cc\
 		${FF_HOME}/src/ops/element_unary.cc\
 		${FF_HOME}/src/ops/embedding.cc\
+		${FF_HOME}/src/ops/embedding_hot_tier.cc\
 		${FF_HOME}/src/ops/flat.cc\
 		${FF_HOME}/src/ops/fused.cc\
 		${FF_HOME}/src/ops/group_by.cc\
@@ -181,12 +187,58 @@ FF_HIP_SRC	+= ${FF_HOME}/src/ops/conv_2d.cpp\
 		${FF_HOME}/src/runtime/simulator.cpp\
 		${FF_HOME}/src/runtime/tensor.cpp
 		
+FF_CPU_SRC	+= ${FF_HOME}/src/ops/cpu/aggregate.cc\
+		${FF_HOME}/src/ops/cpu/aggregate_spec.cc\
+		${FF_HOME}/src/ops/cpu/attention.cc\
+		${FF_HOME}/src/ops/cpu/batch_matmul.cc\
+		${FF_HOME}/src/ops/cpu/batch_norm.cc\
+		${FF_HOME}/src/ops/cpu/cache.cc\
+		${FF_HOME}/src/ops/cpu/cast.cc\
+		${FF_HOME}/src/ops/cpu/concat.cc\
+		${FF_HOME}/src/ops/cpu/conv_2d.cc\
+		${FF_HOME}/src/ops/cpu/dropout.cc\
+		${FF_HOME}/src/ops/cpu/element_binary.cc\
+		${FF_HOME}/src/ops/cpu/element_unary.cc\
+		${FF_HOME}/src/ops/cpu/embedding.cc\
+		${FF_HOME}/src/ops/cpu/flat.cc\
+		${FF_HOME}/src/ops/cpu/fused.cc\
+		${FF_HOME}/src/ops/cpu/group_by.cc\
+		${FF_HOME}/src/ops/cpu/layer_norm.cc\
+		${FF_HOME}/src/ops/cpu/linear.cc\
+		${FF_HOME}/src/ops/cpu/mean.cc\
+		${FF_HOME}/src/ops/cpu/pool_2d.cc\
+		${FF_HOME}/src/ops/cpu/reshape.cc\
+		${FF_HOME}/src/ops/cpu/reverse.cc\
+		${FF_HOME}/src/ops/cpu/softmax.cc\
+		${FF_HOME}/src/ops/cpu/split.cc\
+		${FF_HOME}/src/ops/cpu/topk.cc\
+		${FF_HOME}/src/ops/cpu/transpose.cc\
+		${FF_HOME}/src/parallel_ops/cpu/combine.cc\
+		${FF_HOME}/src/parallel_ops/cpu/partition.cc\
+		${FF_HOME}/src/parallel_ops/cpu/replicate.cc\
+		${FF_HOME}/src/parallel_ops/cpu/reduction.cc\
+		${FF_HOME}/src/parallel_ops/cpu/fused_parallel_op.cc\
+		${FF_HOME}/src/loss_functions/cpu/loss_functions.cc\
+		${FF_HOME}/src/metrics_functions/cpu/metrics_functions.cc\
+		${FF_HOME}/src/runtime/cpu/cpu_helper.cc\
+		${FF_HOME}/src/runtime/cpu/cpu_gemm.cc\
+		${FF_HOME}/src/runtime/cpu/cpu_thread_pool.cc\
+		${FF_HOME}/src/runtime/cpu/initializer_kernel.cc\
+		${FF_HOME}/src/runtime/cpu/model.cc\
+		${FF_HOME}/src/runtime/cpu/moe_routing.cc\
+		${FF_HOME}/src/runtime/cpu/optimizer_kernel.cc\
+		${FF_HOME}/src/runtime/cpu/simulator.cc
+
+ifeq ($(strip $(FF_USE_CPU)),1)
+  GEN_SRC += $(FF_CPU_SRC)
+else
 GEN_GPU_SRC += $(FF_CUDA_SRC)
 ifeq ($(strip $(HIP_TARGET)),CUDA)
   GEN_HIP_SRC += $(FF_CUDA_SRC)
 else
   GEN_HIP_SRC += $(FF_HIP_SRC)
 endif
+endif
 
 ifneq ($(strip $(FF_USE_PYTHON)), 1)
   GEN_SRC		+= ${FF_HOME}/src/runtime/cpp_driver.cc
@@ -215,6 +267,10 @@ ifeq ($(strip $(FF_USE_AVX2)), 1)
 CC_FLAGS	+= -DFF_USE_AVX2 -mavx2
 endif
 
+ifeq ($(strip $(FF_USE_CPU)),1)
+CC_FLAGS	+= -DFF_USE_CPU
+endif
+
 ifeq ($(strip $(USE_CUDA)),1)
 CC_FLAGS	+= -DFF_USE_CUDA
 NVCC_FLAGS	+= -DFF_USE_CUDA
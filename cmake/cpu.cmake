@@ -0,0 +1,20 @@
+# CPU-only builds do not load FindCUDA. Provide the cuda_add_* commands used
+# by the FlexFlow targets as plain C++ targets, dropping CUDA sources and
+# nvcc options.
+macro(cuda_add_library name)
+  cmake_parse_arguments(FF_CPU_TARGET "" "" "OPTIONS" ${ARGN})
+  list(FILTER FF_CPU_TARGET_UNPARSED_ARGUMENTS EXCLUDE REGEX "\\.cu$")
+  add_library(${name} ${FF_CPU_TARGET_UNPARSED_ARGUMENTS})
+endmacro()
+
+macro(cuda_add_executable name)
+  cmake_parse_arguments(FF_CPU_TARGET "" "" "OPTIONS" ${ARGN})
+  list(FILTER FF_CPU_TARGET_UNPARSED_ARGUMENTS EXCLUDE REGEX "\\.cu$")
+  add_executable(${name} ${FF_CPU_TARGET_UNPARSED_ARGUMENTS})
+endmacro()
+
+find_package(Threads REQUIRED)
+list(APPEND FLEXFLOW_EXT_LIBRARIES
+  Threads::Threads)
+
+message( STATUS "FlexFlow CPU backend: operators run on Legion CPU processors")
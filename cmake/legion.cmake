@@ -27,8 +27,12 @@ else()
 	endif()
 	message(STATUS "GASNET ROOT: $ENV{GASNet_ROOT_DIR}")
 	set(Legion_MAX_DIM ${FF_MAX_DIM} CACHE STRING "Maximum number of dimensions")
-	set(Legion_USE_CUDA ON CACHE BOOL "enable Legion_USE_CUDA")
-	set(Legion_CUDA_ARCH ${FF_CUDA_ARCH} CACHE STRING "Legion CUDA ARCH")
+	if(FF_GPU_BACKEND STREQUAL "cpu")
+	  set(Legion_USE_CUDA OFF CACHE BOOL "enable Legion_USE_CUDA")
+	else()
+	  set(Legion_USE_CUDA ON CACHE BOOL "enable Legion_USE_CUDA")
+	  set(Legion_CUDA_ARCH ${FF_CUDA_ARCH} CACHE STRING "Legion CUDA ARCH")
+	endif()
 	add_subdirectory(deps/legion)
 	set(LEGION_LIBRARY Legion)
 endif()
@@ -0,0 +1,114 @@
+/* Copyright 2023 CMU, Facebook, LANL, MIT, NVIDIA, and Stanford (alphabetical)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Runs inference on a PyTorch model exported with
+// PyTorchModel(model).torch_to_file(path), e.g.,
+//   fx_import --fx-file mlp.ff --input-dims 784 -b 64 -ll:gpu 1
+
+#include "flexflow/fx_importer.h"
+#include "flexflow/model.h"
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using namespace Legion;
+using namespace FlexFlow;
+
+LegionRuntime::Logger::Category log_app("fx_import");
+
+struct FXImportConfig {
+  std::string fx_file;
+  // Input sizes without the batch dimension, outermost first
+  std::vector<int> input_dims;
+  int iterations = 16;
+};
+
+void parse_input_args(char **argv, int argc, FXImportConfig &config) {
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--fx-file")) {
+      config.fx_file = argv[++i];
+      continue;
+    }
+    if (!strcmp(argv[i], "--input-dims")) {
+      config.input_dims.clear();
+      for (char *dim = strtok(argv[++i], ","); dim != NULL;
+           dim = strtok(NULL, ",")) {
+        config.input_dims.push_back(atoi(dim));
+      }
+      continue;
+    }
+    if (!strcmp(argv[i], "--iterations")) {
+      config.iterations = atoi(argv[++i]);
+      continue;
+    }
+  }
+}
+
+void FlexFlow::top_level_task(Task const *task,
+                              std::vector<PhysicalRegion> const &regions,
+                              Context ctx,
+                              Runtime *runtime) {
+  FFConfig ffConfig;
+  FXImportConfig fxConfig;
+  {
+    InputArgs const &command_args = HighLevelRuntime::get_input_args();
+    parse_input_args(command_args.argv, command_args.argc, fxConfig);
+  }
+  if (fxConfig.fx_file.empty() || fxConfig.input_dims.empty()) {
+    fprintf(stderr,
+            "Usage: fx_import --fx-file <path> --input-dims d1,d2,...\n");
+    return;
+  }
+  log_app.print("batchSize(%d) workersPerNodes(%d) numNodes(%d)",
+                ffConfig.batchSize,
+                ffConfig.workersPerNode,
+                ffConfig.numNodes);
+  FFModel ff(ffConfig);
+
+  std::vector<int> dims;
+  dims.push_back(ffConfig.batchSize);
+  dims.insert(
+      dims.end(), fxConfig.input_dims.begin(), fxConfig.input_dims.end());
+  Tensor input = ff.create_tensor(dims.size(), dims.data(), DT_FLOAT);
+  std::vector<Tensor> outputs =
+      import_fx_file(ff, fxConfig.fx_file, std::vector<Tensor>(1, input));
+  assert(outputs.size() > 0);
+  log_app.print("imported %zu layers from %s",
+                ff.layers.size(),
+                fxConfig.fx_file.c_str());
+
+  std::vector<MetricsType> metrics;
+  ff.compile(LOSS_MEAN_SQUARED_ERROR_AVG_REDUCE, metrics, COMP_MODE_INFERENCE);
+  ff.init_operators();
+
+  std::vector<float> input_data(input->get_volume());
+  for (size_t i = 0; i < input_data.size(); i++) {
+    input_data[i] = (float)std::rand() / RAND_MAX;
+  }
+  std::vector<float> output_data(outputs.back()->get_volume());
+  std::vector<std::pair<Tensor, float const *>> batch;
+  batch.push_back(std::make_pair(input, input_data.data()));
+  double ts_start = Realm::Clock::current_time_in_microseconds();
+  for (int iter = 0; iter < fxConfig.iterations; iter++) {
+    ff.infer(batch, output_data.data());
+  }
+  double run_time =
+      1e-6 * (Realm::Clock::current_time_in_microseconds() - ts_start);
+  printf("ELAPSED TIME = %.4fs, THROUGHPUT = %.2f samples/s\n",
+         run_time,
+         fxConfig.iterations * ffConfig.batchSize / run_time);
+}
+
+void FlexFlow::register_custom_tasks() {}
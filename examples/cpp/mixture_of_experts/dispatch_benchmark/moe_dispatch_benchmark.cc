@@ -0,0 +1,216 @@
+/* Copyright 2023 CMU, Facebook, LANL, MIT, NVIDIA, and Stanford (alphabetical)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Runs one MoE layer (Group_by, one dense expert each, Aggregate) through the
+// CPU kernels for several expert capacities, and reports the tokens per
+// second and the fraction of (token, expert) pairs dropped. A capacity
+// factor of 0 is the capacity-free dispatch
+
+#include "flexflow/ops/aggregate.h"
+#include "flexflow/ops/groupby.h"
+#include "flexflow/utils/cpu_gemm.h"
+#include "flexflow/utils/cpu_helper.h"
+#include "flexflow/utils/moe_routing.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace FlexFlow;
+
+static double now_ms(void) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Top-k expert assignment of every token. Expert e is picked with weight
+// 1 / (e + 1)^skew, so skew 0 is a balanced gate
+static void make_assignment(std::vector<int> &assign,
+                            std::vector<float> &gate_preds,
+                            int num_tokens,
+                            int n,
+                            int k,
+                            float skew) {
+  std::mt19937 gen(0);
+  std::vector<double> weights(n);
+  for (int e = 0; e < n; e++) {
+    weights[e] = 1.0 / pow(e + 1.0, skew);
+  }
+  assign.resize((size_t)num_tokens * k);
+  gate_preds.resize((size_t)num_tokens * k);
+  for (int i = 0; i < num_tokens; i++) {
+    std::vector<double> w = weights;
+    for (int j = 0; j < k; j++) {
+      std::discrete_distribution<int> dist(w.begin(), w.end());
+      int expert = dist(gen);
+      // top-k picks distinct experts
+      w[expert] = 0.0;
+      assign[i * k + j] = expert;
+      gate_preds[i * k + j] = 1.0f / k;
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  int n = 8, k = 2, batch_size = 2048, data_dim = 512, hidden = 512;
+  int num_threads = 1, repeats = 5;
+  float skew = 1.0f;
+  for (int i = 1; i < argc; i++) {
+    if (i + 1 >= argc) {
+      fprintf(stderr,
+              "Usage: %s [--experts N] [--k N] [--batch N] [--dim N] "
+              "[--hidden N] [--skew S] [--threads N] [--repeats N]\n",
+              argv[0]);
+      return 1;
+    }
+    if (!strcmp(argv[i], "--experts")) {
+      n = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--k")) {
+      k = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--batch")) {
+      batch_size = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--dim")) {
+      data_dim = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--hidden")) {
+      hidden = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--skew")) {
+      skew = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "--threads")) {
+      num_threads = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--repeats")) {
+      repeats = atoi(argv[++i]);
+    } else {
+      fprintf(stderr, "Unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+  assert(k <= n);
+  cpu_set_num_threads(num_threads);
+  cpu_gemm_set_num_threads(num_threads);
+
+  std::mt19937 gen(1);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  std::vector<float> input((size_t)batch_size * data_dim);
+  for (float &x : input) {
+    x = dist(gen);
+  }
+  std::vector<std::vector<float>> weights(n);
+  for (std::vector<float> &w : weights) {
+    w.resize((size_t)data_dim * hidden);
+    for (float &x : w) {
+      x = dist(gen) / sqrtf(data_dim);
+    }
+  }
+  std::vector<int> assign;
+  std::vector<float> gate_preds;
+  make_assignment(assign, gate_preds, batch_size, n, k, skew);
+  std::vector<float> output((size_t)batch_size * hidden);
+
+  FFHandler handle = FFHandler();
+  GroupByMeta group_by_meta(handle, n);
+  AggregateMeta aggregate_meta(handle, n);
+  printf("experts = %d, k = %d, batch = %d, dim = %d, hidden = %d, "
+         "skew = %.2f, threads = %d\n",
+         n,
+         k,
+         batch_size,
+         data_dim,
+         hidden,
+         skew,
+         num_threads);
+  printf("%8s %8s %12s %10s %10s\n",
+         "alpha",
+         "rows",
+         "tokens/s",
+         "dropped",
+         "padding");
+  float const alphas[] = {1.0f, 1.25f, 2.0f, 0.0f};
+  for (float alpha : alphas) {
+    int rows = Group_by::get_expert_capacity(alpha, n, k, batch_size);
+    std::vector<std::vector<float>> exp_inputs(n), exp_preds(n);
+    std::vector<float *> exp_input_ptrs(n), exp_pred_ptrs(n);
+    for (int e = 0; e < n; e++) {
+      exp_inputs[e].resize((size_t)rows * data_dim);
+      exp_preds[e].resize((size_t)rows * hidden);
+      exp_input_ptrs[e] = exp_inputs[e].data();
+      exp_pred_ptrs[e] = exp_preds[e].data();
+    }
+    MoeRouting routing;
+    moe_route(assign.data(), k * batch_size, n, rows, routing);
+
+    double best_ms = 1e30;
+    for (int r = 0; r < repeats; r++) {
+      double t_start = now_ms();
+      Group_by::forward_kernel_wrapper(&group_by_meta,
+                                       input.data(),
+                                       assign.data(),
+                                       exp_input_ptrs.data(),
+                                       n,
+                                       k,
+                                       alpha,
+                                       batch_size,
+                                       data_dim);
+      // experts compute on every row of their tensors, padding included,
+      // as a dense layer does in the model
+      for (int e = 0; e < n; e++) {
+        cpu_gemm(true,
+                 false,
+                 hidden,
+                 rows,
+                 data_dim,
+                 1.0f,
+                 weights[e].data(),
+                 data_dim,
+                 0,
+                 exp_input_ptrs[e],
+                 data_dim,
+                 0,
+                 0.0f,
+                 exp_pred_ptrs[e],
+                 hidden,
+                 0,
+                 1,
+                 NULL,
+                 AC_MODE_RELU);
+      }
+      Aggregate::forward_kernel_wrapper(&aggregate_meta,
+                                        exp_pred_ptrs.data(),
+                                        assign.data(),
+                                        gate_preds.data(),
+                                        output.data(),
+                                        n,
+                                        k,
+                                        rows,
+                                        batch_size,
+                                        hidden);
+      best_ms = std::min(best_ms, now_ms() - t_start);
+    }
+    int num_pairs = k * batch_size;
+    int num_kept = num_pairs - routing.num_dropped();
+    printf("%8.2f %8d %12.0f %9.2f%% %9.2f%%\n",
+           alpha,
+           rows,
+           batch_size / (best_ms * 1e-3),
+           100.0 * routing.num_dropped() / num_pairs,
+           100.0 * ((double)n * rows - num_kept) / ((double)n * rows));
+  }
+  printf("alpha 0 is capacity-free; padding is the fraction of expert rows "
+         "that hold no token\n");
+  return 0;
+}
@@ -130,7 +130,7 @@ void top_level_task(Task const *task,
 
   //-----------------------------------------------------------------
 
-  float alpha = 2.0f;   // factor overhead tensor size for imbalance
+  float alpha = 2.0f;   // factor overhead tensor size, 0 for capacity-free
   float lambda = 0.04f; // multiplier for load balance term
 
   // MoE model
@@ -0,0 +1,48 @@
+from flexflow.core import *
+import argparse
+import time
+
+
+# Times building the same MLP with one Python call per layer and with a
+# single FFModel.add_layers call
+def build_per_layer(ffconfig, num_layers, hidden_dim):
+    ffmodel = FFModel(ffconfig)
+    t = ffmodel.create_tensor([ffconfig.batch_size, hidden_dim],
+                              DataType.DT_FLOAT)
+    for i in range(num_layers):
+        t = ffmodel.dense(t, hidden_dim)
+        t = ffmodel.relu(t)
+    return ffmodel, t
+
+
+def build_batched(ffconfig, num_layers, hidden_dim):
+    ffmodel = FFModel(ffconfig)
+    input_tensor = ffmodel.create_tensor([ffconfig.batch_size, hidden_dim],
+                                         DataType.DT_FLOAT)
+    batch = LayerBatch()
+    t = batch.input()
+    for i in range(num_layers):
+        t = batch.dense(t, hidden_dim)
+        t = batch.relu(t)
+    outputs = ffmodel.add_layers(batch, [input_tensor], [t])
+    return ffmodel, outputs[0]
+
+
+def top_level_task(num_layers, hidden_dim):
+    ffconfig = FFConfig()
+    print("Building %d dense+relu layers of dim %d" % (num_layers, hidden_dim))
+    for build in [build_per_layer, build_batched]:
+        ts_start = time.perf_counter()
+        ffmodel, t = build(ffconfig, num_layers, hidden_dim)
+        run_time = time.perf_counter() - ts_start
+        print("%s: ELAPSED TIME = %.4fs, %.2f us/layer, output dims %s" %
+              (build.__name__, run_time, 1e6 * run_time / (2 * num_layers),
+               str(t.dims)))
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--num-layers", type=int, default=10000)
+    parser.add_argument("--hidden-dim", type=int, default=64)
+    args, unknown = parser.parse_known_args()
+    top_level_task(args.num_layers, args.hidden_dim)
@@ -0,0 +1,168 @@
+/* Copyright 2023 CMU, Facebook, LANL, MIT, NVIDIA, and Stanford (alphabetical)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _FLEXFLOW_CHECKPOINT_H_
+#define _FLEXFLOW_CHECKPOINT_H_
+
+#include "flexflow/config.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace FlexFlow {
+
+// A checkpoint directory holds a manifest, naming the tensors and the
+// training scalars, and one shard file per process. A shard file is a
+// sequence of records, each a header followed by the data of one shard.
+// Shards cover boxes of the tensor with its replica dimensions dropped, so
+// a checkpoint can be restored under any partitioning
+
+struct CheckpointTensorInfo {
+  std::string name;
+  DataType data_type;
+  int ndims;
+  // Sizes of the non-replica dimensions, innermost first
+  int64_t dims[MAX_TENSOR_DIM];
+};
+
+class CheckpointManifest {
+public:
+  CheckpointManifest(void);
+  // Writes to a temporary file first, so a crash never leaves a partial
+  // manifest behind
+  bool write(std::string const &path) const;
+  bool read(std::string const &path);
+  // Index of the tensor called name, or -1
+  int find_tensor(std::string const &name) const;
+
+public:
+  uint64_t checkpoint_id;
+  // Number of processes, i.e., of shard files
+  int num_ranks;
+  std::vector<CheckpointTensorInfo> tensors;
+  // Training state besides the tensors, e.g., the Adam step factors
+  std::map<std::string, double> scalars;
+};
+
+// "FFCK"
+uint32_t const CHECKPOINT_SHARD_MAGIC = 0x4646434b;
+
+struct CheckpointShardHeader {
+  uint32_t magic;
+  uint64_t checkpoint_id;
+  int tensor_id;
+  int ndims;
+  // Inclusive box of the shard, innermost dimension first
+  int64_t lo[MAX_TENSOR_DIM], hi[MAX_TENSOR_DIM];
+  uint64_t num_bytes;
+};
+
+// Where the data of a shard is found
+struct CheckpointShardLocation {
+  CheckpointShardHeader header;
+  int rank;
+  uint64_t offset;
+};
+
+std::string get_checkpoint_shard_path(std::string const &dir,
+                                      uint64_t checkpoint_id,
+                                      int rank);
+// Appends the complete records of checkpoint_id in the shard file of rank
+// to shards; a record cut short by a crash ends the file
+void read_checkpoint_shards(std::string const &dir,
+                            uint64_t checkpoint_id,
+                            int rank,
+                            std::vector<CheckpointShardLocation> &shards);
+// Copies the part of the dense box src_lo..src_hi that overlaps the dense
+// box dst_lo..dst_hi, and returns the number of elements copied
+size_t copy_checkpoint_box(int ndims,
+                           int64_t const *src_lo,
+                           int64_t const *src_hi,
+                           char const *src,
+                           int64_t const *dst_lo,
+                           int64_t const *dst_hi,
+                           char *dst,
+                           size_t elem_size);
+
+// Appends shard records to shard files from a background thread, so the
+// task that owns a shard only copies it to host memory. The queued shards
+// stay in host memory until they are written
+class CheckpointWriter {
+public:
+  CheckpointWriter(void);
+  ~CheckpointWriter(void);
+  void write(std::string const &path,
+             CheckpointShardHeader const &header,
+             std::vector<char> &&data);
+  // Blocks until every queued shard is on disk; false if a write failed
+  // since the last flush
+  bool flush(void);
+  // The writer of this process
+  static CheckpointWriter *get_writer(void);
+
+private:
+  struct Request {
+    std::string path;
+    CheckpointShardHeader header;
+    std::vector<char> data;
+  };
+  void run(void);
+
+private:
+  std::mutex mutex;
+  std::condition_variable queued, drained;
+  std::deque<Request> requests;
+  bool writing, stopping, failed;
+  std::thread thread;
+};
+
+class Checkpoint {
+public:
+  // Arguments of the shard tasks of one tensor; the load task also gets the
+  // locations of the shards of the tensor after them
+  struct ShardArgs {
+    char dir[MAX_FILENAME];
+    uint64_t checkpoint_id;
+    int tensor_id;
+    DataType data_type;
+    int num_dims;
+    bool is_replica_dim[MAX_TENSOR_DIM];
+    int num_shards;
+  };
+  static void
+      save_shard_task(Legion::Task const *task,
+                      std::vector<Legion::PhysicalRegion> const &regions,
+                      Legion::Context ctx,
+                      Legion::Runtime *runtime);
+  // Returns false if the checkpoint does not cover the shard
+  static bool
+      load_shard_task(Legion::Task const *task,
+                      std::vector<Legion::PhysicalRegion> const &regions,
+                      Legion::Context ctx,
+                      Legion::Runtime *runtime);
+  static bool flush_task(Legion::Task const *task,
+                         std::vector<Legion::PhysicalRegion> const &regions,
+                         Legion::Context ctx,
+                         Legion::Runtime *runtime);
+};
+
+}; // namespace FlexFlow
+
+#endif // _FLEXFLOW_CHECKPOINT_H_
@@ -0,0 +1,69 @@
+/* Copyright 2023 CMU, Facebook, LANL, MIT, NVIDIA, and Stanford (alphabetical)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _FLEXFLOW_COMPILE_CACHE_H_
+#define _FLEXFLOW_COMPILE_CACHE_H_
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace FlexFlow {
+
+// Key of a compile: a canonical byte string of everything the strategy
+// search depends on. Values are appended in a fixed order, so equal keys
+// describe the same search
+class CompileCacheKey {
+public:
+  template <typename T>
+  void append(T const &value) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "only plain values can be appended to a key");
+    bytes.append(reinterpret_cast<char const *>(&value), sizeof(T));
+  }
+  void append(std::string const &value);
+  // Appends the contents of a file, or only its path if it cannot be read
+  void append_file(std::string const &path);
+  size_t hash(void) const;
+
+public:
+  std::string bytes;
+};
+
+// File-based cache of serialized strategy search results. Each entry is
+// one file named after the hash of its key, holding a versioned header,
+// the full key (compared on lookup, so hash collisions are misses) and the
+// result, whose size is not capped
+class CompileCache {
+public:
+  // Bump whenever the serialized graph format changes
+  static uint32_t const FORMAT_VERSION = 1;
+
+  CompileCache(std::string const &dir);
+  // Reads the result cached under key, false on a miss or a corrupt entry
+  bool load(CompileCacheKey const &key, std::vector<char> &data) const;
+  // Writes to a temporary file first, so concurrent jobs never read a
+  // partial entry; false if the entry cannot be written
+  bool store(CompileCacheKey const &key, std::vector<char> const &data) const;
+  std::string get_path(CompileCacheKey const &key) const;
+
+private:
+  std::string dir;
+};
+
+}; // namespace FlexFlow
+
+#endif // _FLEXFLOW_COMPILE_CACHE_H_
@@ -20,10 +20,14 @@
 #include <cstring>
 #if defined(FF_USE_CUDA) || defined(FF_USE_HIP_CUDA)
 #include <cublas_v2.h>
+#include <cuda_fp16.h>
 #include <cudnn.h>
 #elif defined(FF_USE_HIP_ROCM)
+#include <hip/hip_fp16.h>
 #include <hipblas.h>
 #include <miopen.h>
+#elif defined(FF_USE_CPU)
+#include "flexflow/utils/cpu_fp16.h"
 #else
 #error "Unknown device"
 #endif
@@ -45,6 +49,11 @@ namespace FlexFlow {
 #define MAX_NUM_WORKERS 1024
 #define MAX_FILENAME 200
 #define MAX_OPNAME 128
+// Task priorities assigned from the simulated critical path are in
+// [0, MAX_TASK_PRIORITY]
+#define MAX_TASK_PRIORITY 1000
+// Upper bound of the dynamic loss scale in mixed precision training
+#define MAX_LOSS_SCALE 16777216.0f
 // DataLoader
 #define MAX_SAMPLES_PER_LOAD 64
 #define MAX_FILE_LENGTH 128
@@ -58,19 +67,33 @@ constexpr ParameterSyncType CHOSEN_SYNC_TYPE = ParameterSyncType::NCCL;
 constexpr ParameterSyncType CHOSEN_SYNC_TYPE = ParameterSyncType::PS;
 #endif
 
+// Kind of the processors that run operator tasks and of their memory
+#ifdef FF_USE_CPU
+constexpr Legion::Processor::Kind WORKER_PROC_KIND =
+    Legion::Processor::LOC_PROC;
+constexpr Legion::Memory::Kind WORKER_MEM_KIND = Legion::Memory::SYSTEM_MEM;
+#else
+constexpr Legion::Processor::Kind WORKER_PROC_KIND =
+    Legion::Processor::TOC_PROC;
+constexpr Legion::Memory::Kind WORKER_MEM_KIND = Legion::Memory::GPU_FB_MEM;
+#endif
+
 class FFConfig;
 
 struct FFHandler {
 #if defined(FF_USE_CUDA) || defined(FF_USE_HIP_CUDA)
   cudnnHandle_t dnn;
   cublasHandle_t blas;
-#else
+#elif defined(FF_USE_HIP_ROCM)
   miopenHandle_t dnn;
   hipblasHandle_t blas;
 #endif
   void *workSpace;
   size_t workSpaceSize;
   bool allowTensorOpMathConversion;
+  // Set by the gradient overflow checks on this worker until they are
+  // reduced, so that the checks do not synchronize
+  bool *gradOverflow;
 #ifdef FF_USE_NCCL
   ncclComm_t ncclComm;
 #endif
@@ -154,6 +177,38 @@ public:
   int base_optimize_threshold;
   bool enable_control_replication;
   int python_data_loader_type;
+  // Automatically capture Legion traces of the training iteration
+  bool enable_auto_tracing;
+  int auto_tracing_warmup_iterations;
+  // Print the mappers' instance pool usage after every iteration
+  bool report_instance_pools;
+  // Share regions between activations with disjoint lifetimes
+  bool enable_memory_planning;
+  // Directory of the compile cache, which stores the strategy search result
+  // of every model and machine; empty disables the cache
+  std::string compile_cache_dir;
+  // Drop the substitutions whose source operators the search cannot reach
+  bool search_prune_xfers;
+  // Directory of the substitution statistics of each model family, used to
+  // skip the substitutions that never match; empty disables them
+  std::string substitution_stats_dir;
+  // Search with an e-graph of at most this many e-nodes instead of the
+  // best-first search over graphs; 0 disables it
+  size_t search_egraph_node_budget;
+  // Embedding backward emits row-sparse gradients, which the parameter
+  // server applies row by row (CPU backend with PS sync only)
+  bool enable_sparse_embedding_grads;
+  // Rows of the hot tier kept for each embedding table, refreshed every
+  // embedding_hot_tier_refresh batches (CPU backend only)
+  int embedding_hot_tier_rows;
+  int embedding_hot_tier_refresh;
+  // Mixed precision training (CUDA only): linear, matmul and element-wise
+  // operators run in half over float weights, softmax and layer norm run in
+  // float, and the loss is scaled dynamically to keep half gradients in range
+  bool enable_mixed_precision;
+  bool enable_loss_scaling;
+  float initial_loss_scale;
+  int loss_scale_growth_interval;
 };
 
 class FFIterationConfig {
@@ -161,6 +216,10 @@ public:
   FFIterationConfig();
   void reset();
   int seq_length;
+  // Number of samples whose lengths override seq_length, for batches padded
+  // to a common length; the lengths are kept by the model and follow the
+  // config in the arguments of the operators that mask samples
+  int num_sample_seq_lengths;
 };
 
 enum FieldIDs {
@@ -5,6 +5,7 @@
 #include <cuda_runtime.h>
 #elif defined(FF_USE_HIP_ROCM)
 #include <hip/hip_runtime.h>
+#elif defined(FF_USE_CPU)
 #else
 #error "Unknown device"
 #endif
@@ -16,9 +17,13 @@ cudaError_t get_legion_stream(cudaStream_t *stream);
 #elif defined(FF_USE_HIP_ROCM)
 typedef hipStream_t ffStream_t;
 hipError_t get_legion_stream(hipStream_t *stream);
+#elif defined(FF_USE_CPU)
+// CPU kernels run synchronously in the calling task
+typedef void *ffStream_t;
+int get_legion_stream(ffStream_t *stream);
 #else
 #error "Unknown device"
 #endif
 }; // namespace FlexFlow
 
-#endif // _FLEXFLOW_DEVICE_H_
\ No newline at end of file
+#endif // _FLEXFLOW_DEVICE_H_
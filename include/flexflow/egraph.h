@@ -0,0 +1,109 @@
+/* Copyright 2023 CMU, Facebook, LANL, MIT, NVIDIA, and Stanford (alphabetical)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _FLEXFLOW_EGRAPH_H_
+#define _FLEXFLOW_EGRAPH_H_
+
+#include "flexflow/substitution.h"
+#include <functional>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+namespace FlexFlow::PCG {
+
+// An e-graph over PCGs. An e-class is a set of equivalent tensors, all of
+// the same shape, and an e-node is one output of an operator applied to
+// e-classes. Applying an xfer adds the e-nodes of its destination operators
+// and merges the e-classes of its mapped outputs instead of copying the
+// graph, so a single e-graph holds every graph the xfers reach
+
+struct ENode {
+  // The e-nodes of the outputs of one operator share its node
+  Node node;
+  int out_idx;
+  std::vector<int> inputs;
+};
+
+class EGraph {
+public:
+  EGraph(FFModel *model);
+  // Adds the operators of graph; the outputs of its sinks are the roots
+  // of extract
+  void add_graph(Graph const *graph);
+  // Applies every match of xfers in rounds until a round changes nothing
+  // or the e-graph holds node_budget e-nodes; returns the number of rounds
+  int saturate(std::vector<GraphXfer *> const &xfers, size_t node_budget);
+  // Picks the e-node of each e-class that minimizes the total op_cost of
+  // the e-nodes it depends on, and returns the graph they form, or nullptr
+  // if a root has no e-node of finite cost
+  std::unique_ptr<Graph>
+      extract(std::function<float(Op const *)> const &op_cost) const;
+  // E-node picked by extract for each e-class, or -1 if it has none of
+  // finite cost
+  std::vector<int>
+      pick_enodes(std::function<float(Op const *)> const &op_cost) const;
+  // Adds the e-nodes of every output of node, and returns their e-classes
+  std::vector<int> add_operator(Node const &node,
+                                std::vector<int> const &inputs);
+  // Merges two e-classes; rebuild must run before the e-graph is matched
+  // or extracted again
+  bool merge(int a, int b);
+  // Restores the invariant that no two e-nodes have the same operator,
+  // output and input e-classes
+  void rebuild(void);
+  ENode const &get_enode(int id) const;
+  int find(int eclass) const;
+  size_t num_enodes(void) const;
+  size_t num_eclasses(void) const;
+
+private:
+  using Key = std::tuple<Op const *, int, std::vector<int>>;
+  struct Match {
+    // E-node matched by each source operator and the e-classes of its
+    // outputs, and the e-class bound to each input of the xfer
+    std::vector<int> enodes;
+    std::vector<std::vector<int>> outputs;
+    std::map<int, int> inputs;
+  };
+  int add_enode(ENode const &enode);
+  // E-class of output out_idx of the operator of e-node enode_id
+  int output_eclass(int enode_id, int out_idx) const;
+  void find_matches(GraphXfer *xfer,
+                    int depth,
+                    Match &match,
+                    std::vector<Match> &matches) const;
+  bool apply(GraphXfer *xfer, Match const &match);
+
+private:
+  FFModel *model;
+  std::vector<ENode> enodes;
+  // E-class of each e-node; dead e-nodes are duplicates found by rebuild
+  std::vector<int> enode_eclass;
+  std::vector<bool> enode_alive;
+  // Union-find parent and e-nodes of each e-class
+  mutable std::vector<int> parent;
+  std::vector<std::vector<int>> eclass_enodes;
+  std::map<Key, int> memo;
+  // Live e-nodes of the first output of each operator, by type
+  std::map<OperatorType, std::vector<int>> operators;
+  std::vector<int> roots;
+  size_t num_alive;
+};
+
+}; // namespace FlexFlow::PCG
+
+#endif // _FLEXFLOW_EGRAPH_H_
@@ -0,0 +1,58 @@
+/* Copyright 2023 CMU, Facebook, LANL, MIT, NVIDIA, and Stanford (alphabetical)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _FLEXFLOW_FX_IMPORTER_H_
+#define _FLEXFLOW_FX_IMPORTER_H_
+
+#include "flexflow/tensor.h"
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace FlexFlow {
+
+// Importer of the FX-IR text format written by PyTorchModel.torch_to_file
+// in python/flexflow/torch/model.py. Each line is one node of the traced
+// graph, in topological order:
+//   name; innode,innode,; outnode,; OP_TYPE; arg; arg; ...
+// where OP_TYPE names a flexflow.type.OpType. Attribute nodes only have a
+// name and an op type
+
+struct FXNode {
+  std::string name;
+  std::vector<std::string> innodes, outnodes;
+  std::string op_type;
+  // Items after the op type
+  std::vector<std::string> args;
+};
+
+// Returns false if line holds no node, and throws std::runtime_error if it
+// is malformed
+bool parse_fx_node(std::string const &line, FXNode &node);
+
+// Adds the layers of the graph read from graph to model, binding its input
+// nodes to inputs in order, and returns the tensors of its output node.
+// Throws std::runtime_error if the graph is malformed or has a node that
+// cannot be imported; the layers added before that node stay in model
+std::vector<Tensor> import_fx_graph(FFModel &model,
+                                    std::istream &graph,
+                                    std::vector<Tensor> const &inputs);
+std::vector<Tensor> import_fx_file(FFModel &model,
+                                   std::string const &filename,
+                                   std::vector<Tensor> const &inputs);
+
+}; // namespace FlexFlow
+
+#endif // _FLEXFLOW_FX_IMPORTER_H_
@@ -19,6 +19,7 @@
 #include "flexflow/graph_structures.h"
 #include "flexflow/model.h"
 #include "flexflow/utils/dot/dot_file.h"
+#include "flexflow/utils/persistent_map.h"
 #include "flexflow/utils/recursive_logger.h"
 #include "legion/legion_utilities.h"
 #include <unordered_set>
@@ -83,14 +84,19 @@ struct NodeCompare {
   };
 };
 
+// Result of graph_optimize_task. Legion serializes task results through
+// the legion_* methods, so the size of the graph is not capped
 struct GraphOptimalViewSerialized {
-#ifdef LEGION_MAX_RETURN_SIZE
-  static const size_t buffer_size = LEGION_MAX_RETURN_SIZE - 8;
-#else
-  static const size_t buffer_size = 32 * 1024 - 8;
-#endif
-  size_t total_bytes;
-  char data[buffer_size];
+  std::vector<char> data;
+
+  size_t legion_buffer_size(void) const;
+  void legion_serialize(void *buffer) const;
+  void legion_deserialize(void const *buffer);
+};
+
+// Task priorities of a node, larger values are mapped first by FFMapper
+struct NodeTaskPriority {
+  int forward, backward, update;
 };
 
 struct NodeAssignment {
@@ -273,6 +279,9 @@ public:
   bool check_correctness(void);
   bool has_loop(void);
   bool map_operators_to_layers(std::vector<Op *> &layers) const;
+  void compute_task_priorities(
+      std::unordered_map<Node, MachineView> const &optimal_views,
+      std::unordered_map<Node, NodeTaskPriority> &priorities) const;
   static GraphOptimalViewSerialized
       graph_optimize_task(Legion::Task const *task,
                           std::vector<Legion::PhysicalRegion> const &regions,
@@ -314,7 +323,9 @@ public:
 public:
   FFModel *model;
   SearchHelper *search;
-  std::unordered_map<Node, std::unordered_set<Edge>> inEdges, outEdges;
+  // Copies of a graph share the edges they have in common, so a copy is
+  // O(1) and a rewrite of it copies only the nodes it changes
+  persistent_map<Node, std::unordered_set<Edge>> inEdges, outEdges;
 
 private:
   void remove_inverse_parallel_ops();
@@ -7,6 +7,7 @@
 namespace FlexFlow {
 
 class FFModel;
+class CompileCacheKey;
 class Layer {
 public:
   Layer(FFModel *model,
@@ -37,6 +38,8 @@ public:
                                std::vector<int> &value) const;
   bool get_initializer(std::string const &key, Initializer *&initializer) const;
   Tensor get_parameter(int index);
+  // Appends the type, tensors and properties of the layer to key
+  void append_to_key(CompileCacheKey &key) const;
   void print();
 
 public:
@@ -30,6 +30,11 @@ struct MachineView {
   DeviceType device_type;
   int ndims, start_device_id, dim[MAX_TENSOR_DIM], stride[MAX_TENSOR_DIM];
   std::vector<int> device_ids() const;
+  // Layout of the view up to machine symmetry: nodes are relabeled in order
+  // of first use, and so are the devices of a node if relabel_devices is
+  // set. Views with equal keys cost the same on identical nodes
+  std::vector<int> get_symmetry_key(int devices_per_node,
+                                    bool relabel_devices) const;
 
   friend std::ostream &operator<<(std::ostream &, MachineView const &);
 };
@@ -51,6 +51,33 @@ struct InstanceCreationLog {
   Processor processor;
 };
 
+// Tunables/messages used by FFModel to manage the mappers' instance pools
+enum FFMapperTunableID {
+  FF_TUNABLE_RELEASE_INSTANCE_POOLS = 101,
+  FF_TUNABLE_REPORT_INSTANCE_POOLS = 102,
+};
+
+struct PooledInstance {
+  PhysicalInstance instance;
+  size_t size;
+  int epoch;
+  bool stale;
+};
+
+// Instances created by one mapper in one memory, indexed by instance id.
+// Stale instances, released after a strategy change or a failed allocation,
+// are also indexed by footprint so that a request of the same size can take
+// over their memory instead of allocating more
+struct InstancePool {
+  std::unordered_map<unsigned long, PooledInstance> instances;
+  // May list ids that were revived or collected since; they are skipped
+  std::unordered_map<size_t, std::vector<unsigned long>> stale_by_size;
+  size_t live_bytes = 0, stale_bytes = 0;
+  size_t peak_bytes = 0, iteration_peak_bytes = 0;
+  size_t num_requests = 0, num_reused = 0;
+  void mark_stale(PooledInstance &pi);
+};
+
 class FFMapper : public NullMapper {
 public:
   FFMapper(MapperRuntime *rt,
@@ -58,7 +85,8 @@ public:
            Processor local,
            char const *mapper_name, // const std::string& strategyFile,
            bool _enable_control_replication,
-           bool _log_instance_creation);
+           bool _log_instance_creation,
+           bool _profile_task_priorities);
   ~FFMapper();
   virtual char const *get_mapper_name(void) const;
   virtual MapperSyncModel get_mapper_sync_model(void) const;
@@ -263,6 +291,8 @@ public: // Task execution mapping calls
                                     Task const &task,
                                     SelectTunableInput const &input,
                                     SelectTunableOutput &output);
+  virtual void handle_message(const MapperContext ctx,
+                              MapperMessage const &message);
 
 public: // Must epoch mapping
   virtual void select_sharding_functor(const MapperContext ctx,
@@ -334,6 +364,24 @@ private:
   unsigned long long compute_task_hash(Task const &task);
   bool is_parameter_server_update_task(TaskID tid);
   bool is_initializer_task(TaskID tid);
+  int get_task_priority(Task const &task);
+  void record_instance(MapperContext ctx,
+                       Memory memory,
+                       PhysicalInstance const &instance,
+                       size_t size,
+                       bool created);
+  bool reuse_stale_instance(MapperContext ctx,
+                            Memory memory,
+                            LayoutConstraintSet const &constraints,
+                            RegionRequirement const &req,
+                            PhysicalInstance &result,
+                            size_t &footprint);
+  void release_instance_pools(MapperContext ctx);
+  size_t release_stale_instances(MapperContext ctx,
+                                 Memory memory,
+                                 size_t required_size);
+  void prune_collected_instances(MapperContext ctx, InstancePool &pool);
+  void report_instance_pools(MapperContext ctx);
   std::vector<Processor> const &all_procs_by_kind(Processor::Kind kind);
 
 protected:
@@ -343,6 +391,10 @@ protected:
   char const *mapper_name;
   bool enable_control_replication;
   bool log_instance_creation;
+  // Refine the simulator-assigned task priorities with measured runtimes
+  bool profile_task_priorities;
+  std::map<unsigned long long, double> measured_task_runtimes;
+  double max_measured_task_runtime;
   std::vector<Processor> all_gpus, all_cpus, all_pys, local_gpus, local_cpus,
       local_pys;
   std::map<Processor, Memory> proc_fbmems, proc_zcmems;
@@ -352,6 +404,9 @@ protected:
   std::map<std::pair<Memory::Kind, FieldSpace>, LayoutConstraintID>
       layout_constraint_cache;
   std::vector<InstanceCreationLog> created_instances;
+  // The epoch is advanced every time FFModel switches to a new strategy
+  std::map<Memory, InstancePool> instance_pools;
+  int pool_epoch, pool_iteration;
 };
 
 }; // namespace FlexFlow
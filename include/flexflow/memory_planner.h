@@ -0,0 +1,58 @@
+/* Copyright 2021 CMU, Facebook, LANL, MIT, and Stanford (alphabetical)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _FLEXFLOW_MEMORY_PLANNER_H_
+#define _FLEXFLOW_MEMORY_PLANNER_H_
+
+#include <cstddef>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+namespace FlexFlow {
+
+// A buffer used on one device during the steps [first_use, last_use] of an
+// iteration (both inclusive)
+struct BufferLifetime {
+  size_t id;
+  int device;
+  size_t size;
+  int first_use, last_use;
+};
+
+struct MemoryPlan {
+  // Offset of every buffer in the arena of its device
+  std::unordered_map<size_t, size_t> offsets;
+  // Per device: arena size of the plan, the sum of all buffers (one region
+  // per buffer), and the largest amount of simultaneously live memory
+  std::map<int, size_t> planned_bytes, naive_bytes, live_bytes;
+};
+
+// Assigns buffers with non-overlapping lifetimes to shared offsets in one
+// arena per device
+class MemoryPlanner {
+public:
+  MemoryPlanner(size_t alignment = 256);
+  void add_buffer(BufferLifetime const &buffer);
+  MemoryPlan plan() const;
+
+private:
+  size_t alignment;
+  std::vector<BufferLifetime> buffers;
+};
+
+}; // namespace FlexFlow
+
+#endif // _FLEXFLOW_MEMORY_PLANNER_H_
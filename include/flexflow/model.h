@@ -15,6 +15,7 @@
 #ifndef _FLEXFLOW_MODEL_H_
 #define _FLEXFLOW_MODEL_H_
 #include "accessor.h"
+#include "checkpoint.h"
 #include "config.h"
 #include "device.h"
 #include "flexflow/node.h"
@@ -145,6 +146,12 @@ enum TaskIDs {
   // Optimizer with NCCL
   SGD_UPD_NCCL_TASK_ID,
   ADAM_UPD_NCCL_TASK_ID,
+  // Optimizer with row-sparse gradients
+  SGD_SPARSE_UPD_TASK_ID,
+  ADAM_SPARSE_UPD_TASK_ID,
+  // Loss scaling
+  GRAD_OVERFLOW_CHECK_TASK_ID,
+  GRAD_OVERFLOW_REDUCE_TASK_ID,
   // Initializer
   GLOROT_INIT_TASK_ID,
   ZERO_INIT_TASK_ID,
@@ -158,6 +165,10 @@ enum TaskIDs {
   STRATEGY_SEARCH_TASK_ID,
   // Graph
   GRAPH_OPTIMIZE_TASK_ID,
+  // Checkpoint
+  CHECKPOINT_SAVE_TASK_ID,
+  CHECKPOINT_LOAD_TASK_ID,
+  CHECKPOINT_FLUSH_TASK_ID,
   // Python data loader
   PY_DL_FLOAT_LOAD_ENTIRE_CPU_TASK_ID,
   PY_DL_INT32_LOAD_ENTIRE_CPU_TASK_ID,
@@ -224,9 +235,11 @@ namespace PCG {
 class SearchHelper;
 class GraphSearchHelper;
 class Graph;
+struct NodeTaskPriority;
 }; // namespace PCG
 
 class FFModel;
+class CompileCacheKey;
 class ParallelOp;
 
 std::string optype_to_string(OperatorType);
@@ -505,7 +518,8 @@ public:
                              bool add_bias_kv = false,
                              bool add_zero_attn = false,
                              Initializer *kernel_initializer = NULL,
-                             char const *name = NULL);
+                             char const *name = NULL,
+                             bool causal = false);
   Tensor create_tensor_legion_ordering(int num_dim,
                                        int const dims[],
                                        DataType data_type,
@@ -589,6 +603,9 @@ public:
 
   void map_tensor(ParallelTensor tensor, Op const *parallel_op);
   void map_weight(ParallelTensor tensor, Op const *parallel_op);
+  void map_sparse_grad(ParallelTensor weight);
+  void plan_activation_memory(
+      std::unordered_map<ParallelTensor, ParallelTensor> &shared_regions);
   bool get_parallel_tensor_from_tensor(const Tensor tensor,
                                        ParallelTensor &parallel_tensor) const;
 
@@ -634,17 +651,25 @@ public:
       bool include_sink_compute_time,
       float optimal_cost,
       std::unordered_map<PCG::Node, MachineView> &optimal_views);
+  // Fills key with everything the strategy search of this model depends on
+  void get_compile_cache_key(CompileCacheKey &key) const;
   void deserialize_graph_optimal_view(
       Legion::Deserializer &dez,
       PCG::Graph *graph,
-      std::unordered_map<PCG::Node, MachineView> &optimal_views);
+      std::unordered_map<PCG::Node, MachineView> &optimal_views,
+      std::unordered_map<PCG::Node, PCG::NodeTaskPriority> &priorities);
   bool convert_graph_to_operators(
       const PCG::Graph *graph,
-      std::unordered_map<PCG::Node, MachineView> const &optimal_views);
+      std::unordered_map<PCG::Node, MachineView> const &optimal_views,
+      std::unordered_map<PCG::Node, PCG::NodeTaskPriority> const &priorities);
+  // Enumerates strided views of up to two dimensions, keeping one view per
+  // class of views equivalent under node symmetry, and under GPU symmetry
+  // within a node if symmetric_gpus is set
   static void register_all_machine_views(int num_nodes,
                                          int gpus_per_node,
                                          int cpus_per_node,
-                                         std::vector<MachineView> &valid_views);
+                                         std::vector<MachineView> &valid_views,
+                                         bool symmetric_gpus = false);
   // ========================================
   // Internal PCG::Node creation APIs
   // ========================================
@@ -708,7 +733,8 @@ public:
                                               float dropout,
                                               bool bias,
                                               bool add_bias_kv,
-                                              bool add_zero_attn);
+                                              bool add_zero_attn,
+                                              bool causal);
   PCG::Node get_or_create_reshape_node(const ParallelTensor input,
                                        ReshapeParams const &shape);
   PCG::Node get_or_create_reshape_node(const ParallelTensor input,
@@ -763,6 +789,9 @@ public:
                                              float scalar);
   PCG::Node get_or_create_parallel_op_node(const ParallelTensor input,
                                            ParallelOpInfo const &);
+  // Removes the operator of node from the caches above and frees it, with
+  // the tensors it owns; only for nodes no graph refers to
+  void discard_node(PCG::Node const &node);
   // ========================================
   // Internal APIs that should not be invoked from applications
   // ========================================
@@ -820,6 +849,16 @@ public:
   void init_operators();
   void prefetch();
   void forward(int seq_length = -1);
+  // Valid length of each sample for the following iterations, which
+  // MultiHeadAttention masks individually; an empty vector clears them
+  void set_sample_seq_lengths(std::vector<int> const &seq_lengths);
+  // Runs one inference step on a model compiled with COMP_MODE_INFERENCE:
+  // copies each input's data into its tensor, runs the forward pass and
+  // copies the final output into output. The regions are created by
+  // compile, so a step only maps them
+  void infer(std::vector<std::pair<Tensor, float const *>> const &batch,
+             float *output,
+             int seq_length = -1);
   void compute_metrics();
   void get_metrics();
   void backward(int seq_length = -1);
@@ -854,7 +893,22 @@ public:
                std::map<Op const *, ParallelConfig> &next,
                bool use_propagation) const;
   void recompile_on_condition(RecompileState &r);
+  void invalidate_iteration_trace();
+  // Let the mappers garbage collect the instances of the previous strategy
+  void release_instance_pools();
+  void report_instance_pools();
   void zero_gradients();
+  // Saves the parameters and the optimizer state to dir. Each shard is
+  // copied to host memory by the task that owns it and written in the
+  // background, so training continues; the checkpoint replaces the previous
+  // one in dir when finish_checkpoint returns
+  void save_checkpoint(std::string const &dir);
+  // Waits for the shards of the checkpoint being saved and commits it; false
+  // if it could not be written
+  bool finish_checkpoint(void);
+  // Restores the checkpoint in dir, which may have been saved under a
+  // different strategy or machine; false if it does not match the model
+  bool load_checkpoint(std::string const &dir);
   void print_layers(int id);
 
   std::unordered_map<Op *, std::vector<std::pair<Op *, int>>>
@@ -880,6 +934,8 @@ public:
   size_t tensor_global_guid, parallel_tensor_global_guid, node_global_guid;
   FFConfig config;
   FFIterationConfig iter_config;
+  // Valid length of each sample set by set_sample_seq_lengths
+  std::vector<int> sample_seq_lengths;
   Optimizer *optimizer;
   PCG::SearchHelper *search;
   PCG::GraphSearchHelper *graph_search;
@@ -895,6 +951,12 @@ public:
   std::vector<ParallelTensor> parameters;
   FFHandler handlers[MAX_NUM_WORKERS];
   Legion::Future current_metrics;
+  // Dynamic loss scaling: the current scale, the number of iterations since
+  // the last overflow, and whether the gradients of the last iteration
+  // overflowed
+  float loss_scale;
+  int loss_scale_good_steps;
+  Legion::Future grad_overflow;
   // Cached operators: key: operator hash, value: operator pointer
   std::tuple<
       std::unordered_map<
@@ -932,8 +994,24 @@ public:
 #ifdef FF_USE_NCCL
   std::unordered_map<size_t, ncclComm_t *> view_hash_to_nccl_comms;
 #endif
+  // Trace IDs at or above this value are reserved for automatic tracing
+  static constexpr Legion::TraceID AUTO_TRACE_ID_BASE = 10000;
+
 private:
   bool debug;
+  // State of the automatically captured iteration traces. Each sequence
+  // length has its own trace ID and warm-up, so alternating between
+  // lengths replays their traces instead of capturing new ones
+  bool auto_trace_active;
+  int auto_trace_seq_length;
+  Legion::TraceID auto_trace_id, auto_trace_next_id;
+  std::map<int, Legion::TraceID> auto_trace_ids;
+  std::map<int, int> auto_trace_warmup_left;
+  // Checkpoint being saved, if pending_checkpoint_dir is not empty, and the
+  // futures of its shard tasks
+  std::string pending_checkpoint_dir;
+  CheckpointManifest pending_checkpoint;
+  std::vector<Legion::FutureMap> pending_checkpoint_shards;
   // ParallelTensor label_tensor_with_final_part;//FIXME: to be removed
   std::map<MachineView, Legion::IndexSpace, MachineViewDimCompare> all_task_is;
 
@@ -958,6 +1036,11 @@ private:
   ElementUnary *
       unary(OperatorType op, char const *name = NULL, float scalar = 0.0);
   PCG::Node new_node(Op *);
+  void begin_iteration_trace();
+  void end_iteration_trace();
+  void adjust_loss_scale();
+  void check_gradient_overflow();
+  void apply_mixed_precision();
 };
 
 class UtilityTasks {
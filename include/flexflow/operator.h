@@ -173,6 +173,7 @@ public:
      int numWeights,
      int numOutputs,
      ParallelTensor const *tensors);
+  virtual ~Op() = default;
   // graph substitution related methods
   virtual bool get_int_parameter(PMParameter, int *) const;
   virtual bool get_tensor_parameter(TNParameter, DIMParameter, int *) const;
@@ -210,7 +211,7 @@ public:
   void zero_grad(FFModel const &);
   ParallelTensor get_parameter(int index);
   virtual bool can_inplace_output();
-  virtual bool has_inplace_output();
+  virtual bool has_inplace_output() const;
   virtual void do_inplace_output();
   virtual bool is_parallel_op() const;
   virtual void serialize(Legion::Serializer &) const;
@@ -242,6 +243,8 @@ protected:
                                     Legion::ArgumentMap &argmap);
   void set_opmeta_from_futuremap(FFModel const &ff,
                                  Legion::FutureMap const &fm);
+  void set_priority_for_forward(Legion::IndexLauncher &launcher) const;
+  void set_priority_for_backward(Legion::IndexLauncher &launcher) const;
   void solve_parallel_dim_mappings(
       std::vector<ParallelDim const *> const &inputs,
       std::vector<ParallelDim *> const &weights,
@@ -263,6 +266,9 @@ public:
   OpMeta *meta[MAX_NUM_WORKERS];
   int numInputs, numWeights, numOutputs;
   bool profiling;
+  // Scheduling priorities of this operator's tasks, computed by the simulator
+  // from the chosen strategy and passed to FFMapper::map_task
+  int fwd_task_priority = 0, bwd_task_priority = 0, upd_task_priority = 0;
 #ifdef FF_USE_NCCL
   ncclUniqueId ncclId;
 #endif
@@ -22,6 +22,7 @@ public:
                      bool _bias,
                      bool _add_bias_kv,
                      bool _add_zero_attn,
+                     bool _causal,
                      bool allocate_weights,
                      char const *name);
   MultiHeadAttention(FFModel &model,
@@ -37,6 +38,7 @@ public:
                      bool _bias,
                      bool _add_bias_kv,
                      bool _add_zero_attn,
+                     bool _causal,
                      bool allocate_weights,
                      char const *name);
   MultiHeadAttention(FFModel &model,
@@ -73,19 +75,23 @@ public:
   bool measure_operator_cost(Simulator *sim,
                              MachineView const &mv,
                              CostMetrics &cost_metrics) const override;
+  // seq_lengths is a host array with the valid length of each sample of the
+  // meta, -1 for an unpadded sample; NULL if no sample is padded
   static void forward_kernel(MultiHeadAttentionMeta const *m,
                              float const *query_ptr,
                              float const *key_ptr,
                              float const *value_ptr,
                              float const *weight_ptr,
                              float *output_ptr,
-                             ffStream_t stream);
+                             ffStream_t stream,
+                             int const *seq_lengths = NULL);
   static void forward_kernel_wrapper(MultiHeadAttentionMeta const *m,
                                      float const *query_ptr,
                                      float const *key_ptr,
                                      float const *value_ptr,
                                      float const *weight_ptr,
-                                     float *output_ptr);
+                                     float *output_ptr,
+                                     int const *seq_lengths = NULL);
   static void backward_kernel(MultiHeadAttentionMeta const *m,
                               float const *query_ptr,
                               float *query_grad_ptr,
@@ -96,7 +102,8 @@ public:
                               float const *weight_ptr,
                               float *weight_grad_ptr,
                               float const *output_grad_ptr,
-                              ffStream_t stream);
+                              ffStream_t stream,
+                              int const *seq_lengths = NULL);
   static void backward_kernel_wrapper(MultiHeadAttentionMeta const *m,
                                       float const *query_ptr,
                                       float *query_grad_ptr,
@@ -106,13 +113,16 @@ public:
                                       float *value_grad_ptr,
                                       float const *weight_ptr,
                                       float *weight_grad_ptr,
-                                      float const *output_grad_ptr);
+                                      float const *output_grad_ptr,
+                                      int const *seq_lengths = NULL);
 
 public:
   int num_heads;
   float dropout;
   bool bias;
   bool add_bias_kv, add_zero_attn;
+  // query t only attends to keys s <= t
+  bool causal;
   int qSize, kSize, vSize, qProjSize, kProjSize, vProjSize, oProjSize;
   int qoSeqLength, kvSeqLength;
 };
@@ -126,15 +136,22 @@ public:
                          int num_heads);
   ~MultiHeadAttentionMeta(void);
 
+public:
+  // floats of the weights of one head and of the reserve space of one
+  // (sample, head) pair, laid out as described in attention.cc
+  size_t head_weight_size() const;
+  size_t head_reserve_size() const;
+
 public:
   Realm::RegionInstance reserveInst;
   size_t weightSize, reserveSpaceSize;
-#if defined(FF_USE_CUDA) || defined(FF_USE_HIP_CUDA)
-  cudnnAttnDescriptor_t attnDesc;
-  cudnnSeqDataDescriptor_t qDesc, kDesc, vDesc, oDesc;
-#endif
-  int *devQoSeqArray, *devKvSeqArray, *loWinIdx, *hiWinIdx;
+  // reserveSpace holds the projections, attention outputs and softmax
+  // log-sum-exps of every (sample, head) pair for the backward pass
   void *reserveSpace;
+  int num_samples, num_heads;
+  int qSize, kSize, vSize, qProjSize, kProjSize, vProjSize, oProjSize;
+  int qoSeqLength, kvSeqLength;
+  bool causal;
 };
 
 }; // namespace FlexFlow
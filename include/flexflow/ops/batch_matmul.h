@@ -9,6 +9,8 @@ class BatchMatmulMeta : public OpMeta {
 public:
   BatchMatmulMeta(FFHandler handler);
   int a_seq_length_dim, b_seq_length_dim;
+  // Of the inputs and the output; half is only supported on CUDA
+  DataType data_type = DT_FLOAT;
 };
 
 class BatchMatmul : public Op {
@@ -41,10 +43,10 @@ public:
                             Legion::Context ctx,
                             Legion::Runtime *runtime);
   static void forward_kernel(BatchMatmulMeta const *meta,
-                             float *o_ptr,
-                             float const *a_ptr,
-                             float const *b_ptr,
-                             float const *c_ptr,
+                             void *o_ptr,
+                             void const *a_ptr,
+                             void const *b_ptr,
+                             void const *c_ptr,
                              int m,
                              int n,
                              int k,
@@ -54,10 +56,10 @@ public:
                              int b_seq_length_dim = -1,
                              int seq_length = -1);
   static void forward_kernel_wrapper(BatchMatmulMeta const *meta,
-                                     float *o_ptr,
-                                     float const *a_ptr,
-                                     float const *b_ptr,
-                                     float const *c_ptr,
+                                     void *o_ptr,
+                                     void const *a_ptr,
+                                     void const *b_ptr,
+                                     void const *c_ptr,
                                      int m,
                                      int n,
                                      int k,
@@ -66,26 +68,26 @@ public:
                                      int b_seq_length_dim = -1,
                                      int seq_length = -1);
   static void backward_kernel(BatchMatmulMeta const *meta,
-                              float const *o_ptr,
-                              float const *o_grad_ptr,
-                              float const *a_ptr,
-                              float *a_grad_ptr,
-                              float const *b_ptr,
-                              float *b_grad_ptr,
-                              float *c_grad_ptr,
+                              void const *o_ptr,
+                              void const *o_grad_ptr,
+                              void const *a_ptr,
+                              void *a_grad_ptr,
+                              void const *b_ptr,
+                              void *b_grad_ptr,
+                              void *c_grad_ptr,
                               int m,
                               int n,
                               int k,
                               int batch,
                               ffStream_t stream);
   static void backward_kernel_wrapper(BatchMatmulMeta const *meta,
-                                      float const *o_ptr,
-                                      float const *o_grad_ptr,
-                                      float const *a_ptr,
-                                      float *a_grad_ptr,
-                                      float const *b_ptr,
-                                      float *b_grad_ptr,
-                                      float *c_grad_ptr,
+                                      void const *o_ptr,
+                                      void const *o_grad_ptr,
+                                      void const *a_ptr,
+                                      void *a_grad_ptr,
+                                      void const *b_ptr,
+                                      void *b_grad_ptr,
+                                      void *c_grad_ptr,
                                       int m,
                                       int n,
                                       int k,
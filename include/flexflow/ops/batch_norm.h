@@ -73,10 +73,12 @@ public:
   cudnnTensorDescriptor_t inputTensor, outputTensor, biasTensor;
   cudnnActivationDescriptor_t actiDesc;
   cudnnBatchNormMode_t mode;
-#else
+#elif defined(FF_USE_HIP_ROCM)
   miopenTensorDescriptor_t inputTensor, outputTensor, biasTensor;
   miopenActivationDescriptor_t actiDesc;
   miopenBatchNormMode_t mode;
+#else
+  int output_n, output_c, output_h, output_w;
 #endif
   float *runningMean, *runningVar, *saveMean, *saveVar;
   bool relu;
@@ -91,7 +91,7 @@ public:
   cudnnConvolutionFwdAlgo_t fwdAlgo;
   cudnnConvolutionBwdFilterAlgo_t bwdFilterAlgo;
   cudnnConvolutionBwdDataAlgo_t bwdDataAlgo;
-#else
+#elif defined(FF_USE_HIP_ROCM)
   miopenTensorDescriptor_t inputTensor, biasTensor, outputTensor;
   miopenTensorDescriptor_t filterDesc;
   miopenActivationDescriptor_t actiDesc;
@@ -99,6 +99,10 @@ public:
   miopenConvFwdAlgorithm_t fwdAlgo;
   miopenConvBwdWeightsAlgorithm_t bwdFilterAlgo;
   miopenConvBwdDataAlgorithm_t bwdDataAlgo;
+#else
+  int input_n, input_c, input_h, input_w;
+  int output_c, output_h, output_w;
+  int kernel_h, kernel_w, stride_h, stride_w, pad_h, pad_w, groups;
 #endif
   bool relu, use_bias;
   char op_name[MAX_OPNAME];
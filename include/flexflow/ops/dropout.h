@@ -2,6 +2,7 @@
 #define _FLEXFLOW_DROPOUT_H
 
 #include "flexflow/model.h"
+#include <random>
 
 namespace FlexFlow {
 
@@ -88,9 +89,14 @@ public:
 #if defined(FF_USE_CUDA) || defined(FF_USE_HIP_CUDA)
   cudnnTensorDescriptor_t inputTensor, outputTensor;
   cudnnDropoutDescriptor_t dropoutDesc;
-#else
+#elif defined(FF_USE_HIP_ROCM)
   miopenTensorDescriptor_t inputTensor, outputTensor;
   miopenDropoutDescriptor_t dropoutDesc;
+#else
+  // reserveSpace holds one keep/drop byte per element
+  float rate;
+  size_t num_elements;
+  std::mt19937_64 generator;
 #endif
   void *reserveSpace, *dropoutStates;
   size_t reserveSpaceSize, dropoutStateSize;
@@ -26,12 +26,16 @@ public:
   cudnnTensorDescriptor_t input1Tensor, input2Tensor, outputTensor;
   cudnnOpTensorDescriptor_t opDesc;
   cudnnReduceTensorDescriptor_t reduceAddDesc;
-#else
+#elif defined(FF_USE_HIP_ROCM)
   miopenTensorDescriptor_t input1Tensor, input2Tensor, outputTensor;
   miopenTensorOp_t opDesc;
   miopenReduceTensorDescriptor_t reduceAddDesc;
+#else
+  Legion::Domain input1_domain, input2_domain, output_domain;
 #endif
   OperatorType op_type;
+  // Of the inputs and the output; half is only supported on CUDA
+  DataType data_type = DT_FLOAT;
   bool inplace_a, has_same_operands;
   bool broadcast_input1, broadcast_input2;
 };
@@ -59,7 +63,7 @@ public:
     assert(0);
   }
   bool can_inplace_output() override;
-  bool has_inplace_output() override;
+  bool has_inplace_output() const override;
   void do_inplace_output() override;
   static Op *
       create_operator_from_layer(FFModel &model,
@@ -82,27 +86,27 @@ public:
                           Legion::Domain const &input2_domain,
                           Legion::Domain const &output_domain);
   static void forward_kernel(ElementBinaryMeta const *m,
-                             float const *in1_ptr,
-                             float const *in2_ptr,
-                             float *out_ptr,
+                             void const *in1_ptr,
+                             void const *in2_ptr,
+                             void *out_ptr,
                              ffStream_t stream);
   static void forward_kernel_wrapper(ElementBinaryMeta const *m,
-                                     float const *in1_ptr,
-                                     float const *in2_ptr,
-                                     float *out_ptr);
+                                     void const *in1_ptr,
+                                     void const *in2_ptr,
+                                     void *out_ptr);
   static void backward_kernel(ElementBinaryMeta const *m,
-                              float const *out_grad_ptr,
-                              float const *in1_ptr,
-                              float const *in2_ptr,
-                              float *in1_grad_ptr,
-                              float *in2_grad_ptr,
+                              void const *out_grad_ptr,
+                              void const *in1_ptr,
+                              void const *in2_ptr,
+                              void *in1_grad_ptr,
+                              void *in2_grad_ptr,
                               ffStream_t stream);
   static void backward_kernel_wrapper(ElementBinaryMeta const *m,
-                                      float const *out_grad_ptr,
-                                      float const *in1_ptr,
-                                      float const *in2_ptr,
-                                      float *in1_grad_ptr,
-                                      float *in2_grad_ptr);
+                                      void const *out_grad_ptr,
+                                      void const *in1_ptr,
+                                      void const *in2_ptr,
+                                      void *in1_grad_ptr,
+                                      void *in2_grad_ptr);
   bool measure_operator_cost(Simulator *sim,
                              MachineView const &pc,
                              CostMetrics &cost_metrics) const override;
@@ -26,7 +26,7 @@ public:
 #if defined(FF_USE_CUDA) || defined(FF_USE_HIP_CUDA)
   cudnnTensorDescriptor_t inputTensor, outputTensor;
   cudnnActivationDescriptor_t actiDesc;
-#else
+#elif defined(FF_USE_HIP_ROCM)
   miopenTensorDescriptor_t inputTensor, outputTensor;
   miopenActivationDescriptor_t actiDesc;
 #endif
@@ -58,7 +58,7 @@ public:
     assert(0);
   }
   bool can_inplace_output() override;
-  bool has_inplace_output() override;
+  bool has_inplace_output() const override;
   void do_inplace_output() override;
   static Op *
       create_operator_from_layer(FFModel &model,
@@ -2,6 +2,7 @@
 #define _FLEXFLOW_EMBEDDING_H
 
 #include "flexflow/model.h"
+#include "flexflow/ops/embedding_hot_tier.h"
 
 namespace FlexFlow {
 
@@ -21,8 +22,23 @@ public:
   EmbeddingMeta(FFHandler handle) : OpMeta(handle) {}
   DataType input_data_type;
   AggrMode aggr;
+  // Hot tier of the replica's table, if enabled (CPU backend only), and
+  // whether it serves lookups, i.e., the table is never updated
+  std::unique_ptr<EmbeddingHotTier> hot_tier;
+  bool serve_hot_tier = false;
+  // Version of the table the tier copied its rows from
+  int hot_tier_weight_version = -1;
 };
 
+#ifdef FF_USE_CPU
+// Row-sparse embedding gradient: rows are sorted and unique, and values
+// holds the out_dim gradient entries of each row in the same order
+struct EmbeddingSparseGrad {
+  std::vector<int64_t> rows;
+  std::vector<float> values;
+};
+#endif
+
 struct EmbeddingParams {
   int num_entries, out_channels;
   AggrMode aggr;
@@ -71,16 +87,6 @@ public:
                             std::vector<Legion::PhysicalRegion> const &regions,
                             Legion::Context ctx,
                             Legion::Runtime *runtime);
-  static void
-      forward_task_cpu(Legion::Task const *task,
-                       std::vector<Legion::PhysicalRegion> const &regions,
-                       Legion::Context ctx,
-                       Legion::Runtime *runtime);
-  static void
-      backward_task_cpu(Legion::Task const *task,
-                        std::vector<Legion::PhysicalRegion> const &regions,
-                        Legion::Context ctx,
-                        Legion::Runtime *runtime);
   template <typename TI>
   static void forward_kernel(TI const *input_ptr,
                              float *output_ptr,
@@ -121,10 +127,38 @@ public:
                                       int batch_size,
                                       AggrMode aggr,
                                       int outputSize);
+#ifdef FF_USE_CPU
+  // Coalesces the gradients of the rows looked up by input_ptr, negative
+  // indices are padding
+  template <typename TI>
+  static void sparse_backward_kernel(TI const *input_ptr,
+                                     float const *output_ptr,
+                                     EmbeddingSparseGrad &grad,
+                                     int in_dim,
+                                     int out_dim,
+                                     int batch_size,
+                                     AggrMode aggr);
+  // Writes the row count and the sorted rows to rows_ptr, and their values
+  // to values_ptr, zeroing the values of the unused rows up to capacity
+  template <typename TI>
+  static void sparse_backward_kernel_wrapper(EmbeddingMeta const *m,
+                                             TI const *input_ptr,
+                                             float const *output_ptr,
+                                             int64_t *rows_ptr,
+                                             float *values_ptr,
+                                             int capacity,
+                                             int in_dim,
+                                             int out_dim,
+                                             int batch_size,
+                                             AggrMode aggr);
+#endif
   void rand_generate_int64_wrapper(int64_t *ptr, size_t size, int64_t p) const;
   bool measure_operator_cost(Simulator *sim,
                              MachineView const &pc,
                              CostMetrics &cost_metrics) const override;
+  bool estimate_sync_cost(Simulator *sim,
+                          MachineView const &pc,
+                          CostMetrics &cost_metrics) const override;
 
   size_t get_params_hash() const override;
 
@@ -144,6 +178,7 @@ private:
       Legion::Context ctx,
       Legion::Runtime *runtime);
 
+  size_t get_lookups_per_replica() const;
   int input_vocab_size_replica_dim() const;
   int input_channel_out_replica_dim() const;
   int output_vocab_size_replica_dim() const;
@@ -158,6 +193,12 @@ private:
 public:
   int num_entries, out_channels;
   AggrMode aggr;
+  // The weight gradient is row-sparse, see ParallelTensorBase::sparse_grad
+  bool sparse_grad;
+  // Rows of the hot tier of each replica, 0 disables it (CPU backend only)
+  int hot_tier_rows, hot_tier_refresh_interval;
+  // Compiled for inference, i.e., the table is never updated
+  bool inference;
 };
 
 }; // namespace FlexFlow
@@ -0,0 +1,108 @@
+/* Copyright 2023 CMU, Facebook, LANL, MIT, NVIDIA, and Stanford (alphabetical)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _FLEXFLOW_EMBEDDING_HOT_TIER_H_
+#define _FLEXFLOW_EMBEDDING_HOT_TIER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace FlexFlow {
+
+// Hot tier of an embedding table: a compact copy of the most frequently
+// looked up rows, small enough to stay in the CPU caches while the table
+// itself sits in slower memory. Lookups are counted on a sample of the
+// batches, and the tier is rebuilt from the counts every refresh_interval
+// batches. Its state grows with the capacity and the distinct rows of the
+// sampled batches, not with the table size
+class EmbeddingHotTier {
+public:
+  EmbeddingHotTier(int64_t num_entries,
+                   int out_dim,
+                   int capacity,
+                   int refresh_interval);
+  // Counts the lookups of one batch, ignoring padding and out of range
+  // indices, and returns whether the tier is due for a refresh
+  bool record_batch(int32_t const *indices, size_t num);
+  bool record_batch(int64_t const *indices, size_t num);
+  // Copy of row in the tier, or nullptr
+  float const *find(int64_t row) const {
+    // -1 marks the empty slots
+    if (slots.empty() || row < 0) {
+      return nullptr;
+    }
+    for (size_t i = hash_row(row);; i = (i + 1) & (slots.size() - 1)) {
+      if (slots[i].row == row) {
+        return values.data() + (size_t)slots[i].index * out_dim;
+      }
+      if (slots[i].row == -1) {
+        return nullptr;
+      }
+    }
+  }
+  // Moves the most frequently looked up rows of weight into the tier, and
+  // starts a new window of hit rate statistics
+  void refresh(float const *weight);
+  // Copies the rows in the tier again after weight was written
+  void reload(float const *weight);
+  // Rows in the tier, in table order
+  std::vector<int64_t> const &get_rows() const {
+    return rows;
+  }
+  // Fraction of the lookups counted since the last refresh that the tier
+  // served, or would have served
+  double get_hit_rate() const {
+    return lookups > 0 ? (double)hits / lookups : 0.0;
+  }
+  uint64_t get_lookups() const {
+    return lookups;
+  }
+
+public:
+  // One batch in this many is counted, which ranks rows by frequency at a
+  // fraction of the counting cost
+  static int const SAMPLE_INTERVAL = 8;
+  // Rows tracked per row of capacity before the rarest are forgotten
+  static int const TRACKED_ROWS_PER_SLOT = 8;
+
+private:
+  struct Slot {
+    int64_t row;
+    int index;
+  };
+  size_t hash_row(int64_t row) const {
+    return ((uint64_t)row * 0x9E3779B97F4A7C15ULL >> 20) & (slots.size() - 1);
+  }
+  template <typename TI>
+  bool record(TI const *indices, size_t num);
+
+private:
+  int64_t num_entries;
+  int out_dim, capacity, refresh_interval;
+  // Sampled lookup counts, halved at every refresh to age out old rows
+  std::unordered_map<int64_t, uint32_t> counts;
+  // Open-addressing index of rows, at most half full, and their copies
+  std::vector<Slot> slots;
+  std::vector<int64_t> rows;
+  std::vector<float> values;
+  int batches_since_refresh;
+  uint64_t hits, lookups;
+};
+
+}; // namespace FlexFlow
+
+#endif // _FLEXFLOW_EMBEDDING_HOT_TIER_H_
@@ -24,6 +24,11 @@ public:
   };
   FusedOp(FFModel &model, Op *op);
   bool add_operator(FFModel &model, Op *op);
+  // Whether op can join a FusedOp: there is a fused kernel for its type on
+  // this backend, and it has no half tensors
+  static bool can_fuse(Op const *op);
+  // Whether the CPU FusedOp runs op in a blocked elementwise chain
+  static bool is_chain_op(Op const *op);
   ParallelTensor init_inout(FFModel &model, const ParallelTensor input) {
     assert(0);
     return ParallelTensor();
@@ -56,6 +61,7 @@ public:
   int op_num_weights[MAX_NUM_FUSED_OPERATORS];
   int op_num_outputs[MAX_NUM_FUSED_OPERATORS];
   OperatorType op_op_type[MAX_NUM_FUSED_OPERATORS];
+  bool op_is_chain_op[MAX_NUM_FUSED_OPERATORS];
   SourceType op_input_source[MAX_NUM_FUSED_TENSORS];
   SourceType op_weight_source[MAX_NUM_FUSED_TENSORS];
   SourceType op_output_source[MAX_NUM_FUSED_TENSORS];
@@ -61,6 +61,12 @@ public:
   bool measure_operator_cost(Simulator *sim,
                              MachineView const &pc,
                              CostMetrics &cost_metrics) const override;
+  // Rows of every expert tensor: alpha * k / n times the batch size, or the
+  // whole batch for a capacity-free Group_by (alpha <= 0), which never drops
+  // a sample since top-k sends each sample to an expert at most once. The
+  // kernels count the samples of every expert first and zero the rows past
+  // the count
+  static int get_expert_capacity(float alpha, int n, int k, int batch_size);
 
 public:
   int n;
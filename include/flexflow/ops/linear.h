@@ -6,6 +6,9 @@
 #include "flexflow/node.h"
 #include "flexflow/op_meta.h"
 #include "flexflow/operator.h"
+#ifdef FF_USE_CPU
+#include "flexflow/utils/cpu_gemm.h"
+#endif
 
 namespace FlexFlow {
 
@@ -15,10 +18,13 @@ class Layer;
 class LinearMeta : public OpMeta {
 public:
   LinearMeta(FFHandler handle, int batch_size);
+#ifdef FF_USE_CPU
+  ~LinearMeta(void);
+#endif
 #if defined(FF_USE_CUDA) || defined(FF_USE_HIP_CUDA)
   cudnnTensorDescriptor_t outputTensor;
   cudnnActivationDescriptor_t actiDesc;
-#else
+#elif defined(FF_USE_HIP_ROCM)
   miopenTensorDescriptor_t outputTensor;
   miopenActivationDescriptor_t actiDesc;
 #endif
@@ -27,6 +33,12 @@ public:
   bool use_bias;
   DataType input_type, weight_type, output_type;
   char op_name[MAX_OPNAME];
+#ifdef FF_USE_CPU
+  // Weights packed for the GEMM micro-kernel in a model compiled for
+  // inference, and the version of the weight tensor they were packed from
+  CpuGemmPackedA *packed_weight = nullptr;
+  int packed_weight_version = -1;
+#endif
 };
 
 class LinearParams {
@@ -233,6 +245,8 @@ public:
   int in_channels, out_channels;
   ActiMode activation;
   bool use_bias;
+  // Compiled for inference, i.e., the weights are never updated
+  bool inference;
   ParallelTensor replica;
 };
 
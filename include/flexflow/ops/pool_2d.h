@@ -28,10 +28,14 @@ public:
   cudnnTensorDescriptor_t inputTensor, outputTensor;
   cudnnActivationDescriptor_t actiDesc;
   cudnnPoolingDescriptor_t poolDesc;
-#else
+#elif defined(FF_USE_HIP_ROCM)
   miopenTensorDescriptor_t inputTensor, outputTensor;
   miopenActivationDescriptor_t actiDesc;
   miopenPoolingDescriptor_t poolDesc;
+#else
+  PoolType pool_type;
+  int input_n, input_c, input_h, input_w, output_h, output_w;
+  int kernel_h, kernel_w, stride_h, stride_w, pad_h, pad_w;
 #endif
   bool relu;
   char op_name[MAX_OPNAME];
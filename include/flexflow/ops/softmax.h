@@ -14,11 +14,16 @@ public:
               Legion::Domain const &input_domain);
 #if defined(FF_USE_CUDA) || defined(FF_USE_HIP_CUDA)
   cudnnTensorDescriptor_t inputTensor;
-#else
+#elif defined(FF_USE_HIP_ROCM)
   miopenTensorDescriptor_t inputTensor;
+#else
+  // Softmax is taken over the channel dim, as in cuDNN's channel mode
+  int outer_size, channel_size, inner_size;
 #endif
   bool profiling;
   int dim;
+  // Of the input and the output; half is only supported on CUDA
+  DataType data_type;
   char op_name[MAX_OPNAME];
 };
 
@@ -58,19 +63,20 @@ public:
                              MachineView const &pc,
                              CostMetrics &cost_metrics) const override;
   static void forward_kernel(SoftmaxMeta const *m,
-                             float const *input_ptr,
-                             float *output_ptr,
+                             void const *input_ptr,
+                             void *output_ptr,
                              ffStream_t stream);
   static void forward_kernel_wrapper(SoftmaxMeta const *m,
-                                     float const *input_ptr,
-                                     float *output_ptr);
-  static void backward_kernel(float *input_grad_ptr,
-                              float const *output_grad_ptr,
+                                     void const *input_ptr,
+                                     void *output_ptr);
+  static void backward_kernel(SoftmaxMeta const *m,
+                              void *input_grad_ptr,
+                              void const *output_grad_ptr,
                               size_t num_elements,
                               ffStream_t stream);
   static void backward_kernel_wrapper(SoftmaxMeta const *m,
-                                      float *input_grad_ptr,
-                                      float const *output_grad_ptr,
+                                      void *input_grad_ptr,
+                                      void const *output_grad_ptr,
                                       size_t num_elements);
   size_t get_params_hash() const override;
 
@@ -30,7 +30,34 @@ public:
   virtual void init(void) = 0;
   virtual void next(void) = 0;
   virtual void update(const ParallelTensor p) = 0;
+  // Sets handle.gradOverflow if the gradient is not finite
+  static void check_gradient_overflow_task(
+      Legion::Task const *task,
+      std::vector<Legion::PhysicalRegion> const &regions,
+      Legion::Context ctx,
+      Legion::Runtime *runtime);
+  static void check_gradient_overflow_gpu(FFHandler const &handle,
+                                          float const *w_grad_ptr,
+                                          size_t size);
+  // Returns and clears handle.gradOverflow
+  static bool reduce_gradient_overflow_task(
+      Legion::Task const *task,
+      std::vector<Legion::PhysicalRegion> const &regions,
+      Legion::Context ctx,
+      Legion::Runtime *runtime);
+  static bool reduce_gradient_overflow_gpu(FFHandler const &handle);
+  // Launches the row-sparse update task_id on p, with the optimizer state
+  // in states; see ParallelTensorBase::sparse_grad
+  void sparse_update(Legion::TaskID task_id,
+                     Legion::TaskArgument const &arg,
+                     const ParallelTensor p,
+                     std::vector<ParallelTensor> const &states);
   FFModel const *model;
+  // Updates are skipped when this is false, i.e., when the gradients
+  // overflowed under loss scaling
+  Legion::Predicate update_predicate;
+  // Gradients are multiplied by this before the update to undo loss scaling
+  float grad_scale;
 };
 
 class SGDOptimizer : public Optimizer {
@@ -66,6 +93,25 @@ public:
                                    size_t size,
                                    float *w_ptr,
                                    float *v_ptr);
+#endif
+#ifdef FF_USE_CPU
+  static void
+      sparse_update_task(Legion::Task const *task,
+                         std::vector<Legion::PhysicalRegion> const &regions,
+                         Legion::Context ctx,
+                         Legion::Runtime *runtime);
+  // Applies the summed row-sparse gradients of num_replicas replicas to the
+  // touched rows of num_copies copies of the table
+  static void sparse_update_task_cpu(SGDOptimizer const *op,
+                                     int64_t const *rows_ptr,
+                                     float const *values_ptr,
+                                     int num_replicas,
+                                     int capacity,
+                                     int out_dim,
+                                     size_t table_size,
+                                     int num_copies,
+                                     float *w_ptr,
+                                     float *v_ptr);
 #endif
   double lr, momentum;
   bool nesterov;
@@ -110,6 +156,25 @@ public:
                                    float *w_ptr,
                                    float *v_ptr,
                                    float *m_ptr);
+#endif
+#ifdef FF_USE_CPU
+  static void
+      sparse_update_task(Legion::Task const *task,
+                         std::vector<Legion::PhysicalRegion> const &regions,
+                         Legion::Context ctx,
+                         Legion::Runtime *runtime);
+  // Lazy Adam: the moments of rows without gradients are left untouched
+  static void sparse_update_task_cpu(AdamOptimizer const *op,
+                                     int64_t const *rows_ptr,
+                                     float const *values_ptr,
+                                     int num_replicas,
+                                     int capacity,
+                                     int out_dim,
+                                     size_t table_size,
+                                     int num_copies,
+                                     float *w_ptr,
+                                     float *v_ptr,
+                                     float *m_ptr);
 #endif
   double alpha, beta1, beta2, weight_decay, epsilon;
   double alpha_t, beta1_t, beta2_t;
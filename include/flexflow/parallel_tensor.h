@@ -187,6 +187,18 @@ public:
   Legion::LogicalPartition part = Legion::LogicalPartition::NO_PART,
                            part_grad = Legion::LogicalPartition::NO_PART;
   Legion::PhysicalRegion physical_region;
+  // Bumped by every write to region from outside the operators that read
+  // it, so that they can rebuild data derived from it, such as packed
+  // weights
+  int version = 0;
+  // Row-sparse gradient, emitted instead of region_grad by owners that set
+  // sparse_grad. Each replica holds up to sparse_grad_capacity rows:
+  // sparse_grad_rows stores the row count followed by the sorted row ids and
+  // sparse_grad_values the matching rows of the gradient
+  bool sparse_grad = false;
+  int sparse_grad_capacity = 0;
+  ParallelTensorBase *sparse_grad_rows = nullptr,
+                     *sparse_grad_values = nullptr;
 };
 
 typedef ParallelTensorBase *ParallelTensor;
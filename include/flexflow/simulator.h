@@ -215,7 +215,17 @@ public:
   virtual std::vector<CommDevice *> get_comm_path(MemDevice *src_mem,
                                                   MemDevice *tar_mem) = 0;
   virtual std::string to_string() const = 0;
+  // Bandwidth of a GPU reading its own frame buffer (in bytes per ms)
+  float get_gpu_fb_mem_bandwidth() const {
+    return gpu_fb_mem_bandwidth;
+  }
+  // Cost of launching one task on a GPU (in ms)
+  float get_task_launch_overhead() const {
+    return task_launch_overhead;
+  }
   int version;
+  float gpu_fb_mem_bandwidth = 256 * 1024 * 1024.0f;
+  float task_launch_overhead = 0.01f;
 };
 
 class SimpleMachineModel : public MachineModel {
@@ -697,6 +707,9 @@ public:
                            int input_idx,
                            MachineView const &source_view,
                            MachineView const &sink_view);
+  // Time saved by fusing consumer into producer when both run on the same
+  // view, or 0 if apply_fusion would not fuse them
+  float estimate_fusion_saving(Op const *producer, Op const *consumer);
   float
       default_estimate_sync_cost(const ParallelDim tensor_dims[MAX_TENSOR_DIM],
                                  int tensor_ndims,
@@ -707,6 +720,13 @@ public:
   float default_estimate_sync_cost(const ParallelTensor tensor,
                                    MachineView const &view,
                                    int num_replicate_dims);
+  // All-gather of a row-sparse gradient, where each of the num_replicas
+  // replicas contributes num_rows rows of row_size bytes
+  float estimate_sparse_sync_cost(size_t num_rows,
+                                  size_t row_size,
+                                  int num_replicas,
+                                  MachineView const &view);
+  float get_sync_bandwidth(MachineView const &view);
   float simulate_runtime(FFModel const *model,
                          std::map<Op const *, ParallelConfig> const &global,
                          CompMode comp_mode);
@@ -733,7 +753,7 @@ public:
   CompMode computationMode;
 #if defined(FF_USE_CUDA) || defined(FF_USE_HIP_CUDA)
   cudaEvent_t start_event, end_event;
-#else
+#elif defined(FF_USE_HIP_ROCM)
   hipEvent_t start_event, end_event;
 #endif
   std::unordered_map<size_t, CostMetrics> hash_to_operator_cost;
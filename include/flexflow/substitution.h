@@ -119,6 +119,12 @@ void create_xfer(GraphXfer &xfer, sl::Rule const &r, int parallel_degree);
 std::vector<GraphXfer *> create_xfers(FFModel *model,
                                       sl::RuleCollection const &rules,
                                       int parallel_degree);
+// Like create_xfers, but without creating the operators of an xfer until
+// a graph it may match is searched
+std::vector<GraphXfer *>
+    create_lazy_xfers(FFModel *model,
+                      std::shared_ptr<sl::RuleCollection const> const &rules,
+                      int parallel_degree);
 
 class GraphCompare {
 public:
@@ -158,6 +164,8 @@ public:
   GraphXfer(FFModel *_model);
   TensorX new_tensor(void);
   bool can_match(OpX *srcOp, Node const &op, Graph const *graph);
+  // The checks of can_match that do not look at the inputs of op
+  bool can_match_parameters(OpX const *srcOp, Op const *op) const;
   void match(OpX *srcOp, Node const &op, Graph const *graph);
   void unmatch(OpX *srcOp, Node const &op, Graph const *graph);
   // Compute Ops
@@ -214,6 +222,13 @@ public:
 
   void find_matches(Graph const *, std::vector<GraphXferMatch> &matches);
   GraphXferMatch get_match_record(Graph const *) const;
+  // Creates the operators of a lazy xfer once graph has an operator of the
+  // type of its source operator; returns false while it has none
+  bool load_rule(Graph const *graph);
+  bool load_rule(std::unordered_set<OperatorType> const &op_types);
+  // Types of the source or destination operators, paired with the degree
+  // of parallel operators and 0 for others; also works before load_rule
+  std::vector<std::pair<OperatorType, int>> get_op_types(bool src) const;
 
 private:
   void find_matches(int depth,
@@ -229,6 +244,19 @@ public:
   std::map<TensorX, TensorX, TensorXCompare> mappedOutputs;
   std::vector<OpX *> srcOps;
   std::vector<OpX *> dstOps;
+  // Rule of a lazy xfer until its operators are created
+  std::shared_ptr<sl::RuleCollection const> rules = nullptr;
+  int rule_idx = -1, rule_parallel_degree = 0;
+};
+
+// Matches of an xfer over the searches of one model family, kept across
+// runs in FFConfig::substitution_stats_dir
+struct XferStatistics {
+  // Compiles whose search tried the xfer
+  int num_searches = 0;
+  long num_matches = 0, num_accepted = 0;
+  // Compiles that skipped the xfer since it was last searched
+  int num_skipped = 0;
 };
 
 class GraphSearchHelper {
@@ -243,6 +271,11 @@ public:
       bool only_data_parallel,
       std::unique_ptr<Graph> &best_graph,
       std::unordered_map<Node, MachineView> &optimal_views);
+  // Drops the xfers whose source operators appear in no graph the search
+  // can reach from one with operators of the given (type, parallel degree)
+  static std::vector<GraphXfer *>
+      prune_xfers(std::vector<std::pair<OperatorType, int>> const &op_types,
+                  std::vector<GraphXfer *> const &xfers);
 
 private:
   template <typename T>
@@ -268,12 +301,27 @@ private:
       ParallelTensorShape const &bottleneck_output_shape);
   void generate_all_pcg_xfers();
   void load_graph_substitutions(std::vector<GraphXfer *> &xfers) const;
+  // Same for the operators of graph
+  std::vector<GraphXfer *>
+      prune_xfers(Graph const *graph,
+                  std::vector<GraphXfer *> const &xfers) const;
+  // Skips the xfers that never matched this model family, except for one
+  // retry every few compiles, and tries the ones accepted most often first
+  void order_xfers_by_statistics(std::vector<GraphXfer *> &xfers);
+  void load_xfer_statistics(Graph const *graph);
+  void save_xfer_statistics(void);
   Graph *construct_graph();
   void subgraph_optimize(Graph *subgraph);
 
   std::unique_ptr<Graph>
       base_optimize(Graph const *,
                     SimplificationSettings const &simplification_settings);
+  // Saturates an e-graph of the graph with xfers and extracts the graph
+  // of lowest estimated cost, keeping the input if it costs less
+  std::unique_ptr<Graph>
+      egraph_optimize(Graph const *,
+                      std::vector<GraphXfer *> const &xfers,
+                      SimplificationSettings const &simplification_settings);
 
   std::vector<ParallelTensorShape>
       possible_split_output_tensor_shapes(Node const &) const;
@@ -294,6 +342,11 @@ private:
 
 private:
   std::unordered_map<size_t, float> cached_optimized_graphs;
+  // Statistics of the xfers by name, the xfers tried by this compile and
+  // the ones it skips
+  std::map<std::string, XferStatistics> xfer_statistics;
+  std::unordered_set<std::string> searched_xfers, skipped_xfers;
+  std::string xfer_statistics_path;
   std::vector<GraphXfer *> all_pcg_xfers;
   FFModel *model;
   FFConfig const &config;
@@ -3,7 +3,9 @@
 
 #include "flexflow/ffconst.h"
 #include "tl/optional.hpp"
+#include <cstdint>
 #include <fstream>
+#include <memory>
 #include <nlohmann/json.hpp>
 
 NLOHMANN_JSON_SERIALIZE_ENUM(PMParameter,
@@ -175,7 +177,42 @@ struct RuleCollection {
 void from_json(json const &j, RuleCollection &c);
 
 RuleCollection load_rule_collection(std::istream &s);
+// Reads either format, telling them apart by the binary magic
 RuleCollection load_rule_collection_from_path(std::string const &path);
+// Loads path once per process; later calls share the loaded rules
+std::shared_ptr<RuleCollection const>
+    get_rule_collection(std::string const &path);
+
+// Compact binary format of a RuleCollection: a header, arrays of records
+// made of int32s in host byte order, and the rule names. Records refer to
+// each other by index, so the file is read in place from a mapping
+// instead of being parsed
+uint32_t const RULE_COLLECTION_MAGIC = 0x46465352; // "FFSR"
+int const RULE_COLLECTION_VERSION = 1;
+
+struct BinaryRuleCollectionHeader {
+  uint32_t magic;
+  int32_t version;
+  int32_t num_rules, num_operators, num_tensors, num_parameters,
+      num_mapped_outputs, names_size;
+};
+
+struct BinaryRule {
+  int32_t name_offset, name_size;
+  // The destination operators follow the source operators
+  int32_t first_op, num_src_ops, num_dst_ops;
+  int32_t first_mapped_output, num_mapped_outputs;
+};
+
+struct BinaryOperator {
+  int32_t op_type;
+  int32_t first_input, num_inputs;
+  int32_t first_parameter, num_parameters;
+};
+
+void save_rule_collection_binary(RuleCollection const &c,
+                                 std::string const &path);
+RuleCollection load_rule_collection_binary(std::string const &path);
 
 } // namespace FlexFlow::substitution_loader
 
@@ -0,0 +1,81 @@
+#ifndef _FLEXFLOW_CPU_FP16_H_
+#define _FLEXFLOW_CPU_FP16_H_
+
+#include <cstdint>
+#include <cstring>
+
+// IEEE 754 half precision storage type for CPU builds, standing in for the
+// half type of cuda_fp16.h. Arithmetic is done in float.
+struct half {
+  uint16_t x;
+
+  half() = default;
+  half(float f) : x(float_to_bits(f)) {}
+  operator float() const {
+    return bits_to_float(x);
+  }
+
+  static uint16_t float_to_bits(float f) {
+    uint32_t u;
+    std::memcpy(&u, &f, sizeof(u));
+    uint32_t sign = (u >> 16) & 0x8000;
+    int32_t exp = (int32_t)((u >> 23) & 0xff) - 127 + 15;
+    uint32_t mant = u & 0x7fffff;
+    if (((u >> 23) & 0xff) == 0xff) {
+      // Inf or NaN
+      return (uint16_t)(sign | 0x7c00 | (mant ? 0x200 : 0));
+    }
+    if (exp >= 31) {
+      return (uint16_t)(sign | 0x7c00);
+    }
+    if (exp <= 0) {
+      if (exp < -10) {
+        return (uint16_t)sign;
+      }
+      // Subnormal, round to nearest even
+      mant |= 0x800000;
+      uint32_t shift = (uint32_t)(14 - exp);
+      uint32_t half_mant = mant >> shift;
+      uint32_t rem = mant & ((1u << shift) - 1);
+      uint32_t halfway = 1u << (shift - 1);
+      if (rem > halfway || (rem == halfway && (half_mant & 1))) {
+        half_mant++;
+      }
+      return (uint16_t)(sign | half_mant);
+    }
+    uint32_t bits = sign | ((uint32_t)exp << 10) | (mant >> 13);
+    uint32_t rem = mant & 0x1fff;
+    if (rem > 0x1000 || (rem == 0x1000 && (bits & 1))) {
+      // May carry into the exponent, which correctly rounds up to Inf
+      bits++;
+    }
+    return (uint16_t)bits;
+  }
+
+  static float bits_to_float(uint16_t h) {
+    uint32_t sign = ((uint32_t)h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1f;
+    uint32_t mant = h & 0x3ff;
+    uint32_t u;
+    if (exp == 0x1f) {
+      u = sign | 0x7f800000 | (mant << 13);
+    } else if (exp != 0) {
+      u = sign | ((exp + 127 - 15) << 23) | (mant << 13);
+    } else if (mant == 0) {
+      u = sign;
+    } else {
+      // Normalize a subnormal half
+      exp = 127 - 15 + 1;
+      while ((mant & 0x400) == 0) {
+        mant <<= 1;
+        exp--;
+      }
+      u = sign | (exp << 23) | ((mant & 0x3ff) << 13);
+    }
+    float f;
+    std::memcpy(&f, &u, sizeof(f));
+    return f;
+  }
+};
+
+#endif // _FLEXFLOW_CPU_FP16_H_
@@ -0,0 +1,83 @@
+#ifndef _FLEXFLOW_CPU_GEMM_H_
+#define _FLEXFLOW_CPU_GEMM_H_
+#include "flexflow/ffconst.h"
+#include <vector>
+
+// Micro-kernel instruction sets of the blocked CPU GEMM. AVX2 and AVX-512
+// kernels are only compiled with FF_USE_AVX2, and are selected at runtime
+// from what the host supports
+enum CpuGemmIsa {
+  CPU_GEMM_ISA_GENERIC = 0,
+  CPU_GEMM_ISA_AVX2 = 1,
+  CPU_GEMM_ISA_AVX512 = 2,
+};
+
+// Blocked, packed GEMM on column-major matrices following the cuBLAS
+// convention, with a fused epilogue:
+// C = act(alpha * op(A) * op(B) + beta * C + bias), where op(A) is m x k,
+// op(B) is k x n and bias has m entries broadcast over the columns of C.
+// bias may be NULL; batch_count > 1 runs a strided batched GEMM
+void cpu_gemm(bool trans_a,
+              bool trans_b,
+              int m,
+              int n,
+              int k,
+              float alpha,
+              float const *A,
+              int lda,
+              long long int stride_a,
+              float const *B,
+              int ldb,
+              long long int stride_b,
+              float beta,
+              float *C,
+              int ldc,
+              long long int stride_c,
+              int batch_count,
+              float const *bias,
+              ActiMode activation);
+
+// op(A) packed once into the micro-kernel's panel layout, for GEMMs that
+// reuse the same left operand, such as the weights of a layer in inference
+struct CpuGemmPackedA {
+  int m = 0, k = 0;
+  CpuGemmIsa isa = CPU_GEMM_ISA_GENERIC;
+  std::vector<float> panels;
+
+  bool empty(void) const {
+    return panels.empty();
+  }
+};
+
+// Packs the m x k matrix op(A) for the currently selected micro-kernel
+void cpu_gemm_pack_a(bool trans_a,
+                     int m,
+                     int k,
+                     float const *A,
+                     int lda,
+                     CpuGemmPackedA &packed);
+
+// cpu_gemm on a single batch with op(A) taken from packed
+void cpu_gemm_packed(CpuGemmPackedA const &packed,
+                     bool trans_b,
+                     int n,
+                     float alpha,
+                     float const *B,
+                     int ldb,
+                     float beta,
+                     float *C,
+                     int ldc,
+                     float const *bias,
+                     ActiMode activation);
+
+// Number of threads a single GEMM call splits its output tiles over
+void cpu_gemm_set_num_threads(int num_threads);
+int cpu_gemm_get_num_threads(void);
+
+// Selected micro-kernel; forcing an ISA the host lacks is an error
+CpuGemmIsa cpu_gemm_get_isa(void);
+bool cpu_gemm_isa_supported(CpuGemmIsa isa);
+void cpu_gemm_set_isa(CpuGemmIsa isa);
+char const *cpu_gemm_isa_name(CpuGemmIsa isa);
+
+#endif // _FLEXFLOW_CPU_GEMM_H_
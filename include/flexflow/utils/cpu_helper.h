@@ -0,0 +1,118 @@
+#ifndef _FLEXFLOW_CPU_HELPER_H_
+#define _FLEXFLOW_CPU_HELPER_H_
+#include "flexflow/ffconst.h"
+#include "flexflow/utils/cpu_thread_pool.h"
+#include "legion.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <vector>
+
+// CPU counterpart of CUDA_KERNEL_LOOP: kernels run on the calling task's
+// processor, one Legion CPU processor per worker
+#define CPU_KERNEL_LOOP(i, n) for (Legion::coord_t i = 0; i < (n); i++)
+
+// Column-major GEMM following the cuBLAS convention:
+// C = alpha * op(A) * op(B) + beta * C, where op(A) is m x k and op(B) is
+// k x n. Both variants run the blocked kernels in cpu_gemm.h
+void cpu_sgemm(bool trans_a,
+               bool trans_b,
+               int m,
+               int n,
+               int k,
+               float alpha,
+               float const *A,
+               int lda,
+               float const *B,
+               int ldb,
+               float beta,
+               float *C,
+               int ldc);
+
+void cpu_sgemm_strided_batched(bool trans_a,
+                               bool trans_b,
+                               int m,
+                               int n,
+                               int k,
+                               float alpha,
+                               float const *A,
+                               int lda,
+                               long long int stride_a,
+                               float const *B,
+                               int ldb,
+                               long long int stride_b,
+                               float beta,
+                               float *C,
+                               int ldc,
+                               long long int stride_c,
+                               int batch_count);
+
+// Applies the activation to ptr in place
+void cpu_activation_forward(ActiMode mode, float *ptr, size_t size);
+
+// Multiplies grad_ptr by the derivative of the activation, computed from the
+// activation's output as cuDNN does
+void cpu_activation_backward(ActiMode mode,
+                             float *grad_ptr,
+                             float const *output_ptr,
+                             size_t size);
+
+template <typename DT>
+void assign_kernel(DT *ptr, Legion::coord_t size, DT value);
+
+template <typename DT>
+void copy_kernel(DT *dst, const DT *src, Legion::coord_t size);
+
+template <typename T>
+void add_kernel(T *data_ptr, const T *grad_ptr, size_t size);
+
+template <typename DT>
+void apply_add_with_scale(DT *data_ptr,
+                          const DT *grad_ptr,
+                          size_t size,
+                          DT scale);
+
+// Use by concat and split
+void add_with_stride(float *output,
+                     float const *input,
+                     int num_blocks,
+                     int output_blk_size,
+                     int input_blk_size);
+void copy_with_stride(float *output,
+                      float const *input,
+                      int num_blocks,
+                      int output_blk_size,
+                      int input_blk_size);
+
+template <typename T>
+void print_tensor(const T *ptr, size_t num_elements, char const *prefix);
+
+// Wall-clock time in milliseconds, used for profiling and by the simulator
+double cpu_wall_time_ms(void);
+
+// Number of threads a CPU kernel may split its work over, set by the CPU
+// init task to this processor's share of the node's cores
+void cpu_set_num_threads(int num_threads);
+int cpu_get_num_threads(void);
+
+// Runs f(begin, end) on contiguous chunks of [0, n), using up to
+// cpu_get_num_threads() threads of the calling thread's pool and at least
+// grain iterations per chunk
+template <typename F>
+void cpu_parallel_for(size_t n, size_t grain, F const &f) {
+  size_t num_chunks = (n + grain - 1) / std::max(grain, (size_t)1);
+  size_t num_threads = std::min((size_t)cpu_get_num_threads(), num_chunks);
+  if (num_threads <= 1) {
+    f((size_t)0, n);
+    return;
+  }
+  size_t chunk = (n + num_threads - 1) / num_threads;
+  CpuThreadPool::get().run((int)num_threads, [&](int t) {
+    size_t begin = t * chunk;
+    if (begin < n) {
+      f(begin, std::min(n, begin + chunk));
+    }
+  });
+}
+
+#endif // _FLEXFLOW_CPU_HELPER_H_
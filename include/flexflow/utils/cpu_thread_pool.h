@@ -0,0 +1,45 @@
+#ifndef _FLEXFLOW_CPU_THREAD_POOL_H_
+#define _FLEXFLOW_CPU_THREAD_POOL_H_
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Worker threads that the CPU kernels split their loops over. Every Legion
+// CPU processor runs its kernels on its own long-lived thread, so each
+// calling thread gets its own pool, created on first use and grown to the
+// largest number of threads asked for. The workers outlive the calls, which
+// also keeps their thread_local packing buffers
+class CpuThreadPool {
+public:
+  // Pool of the calling thread
+  static CpuThreadPool &get(void);
+  // Runs f(thread_id) for every thread_id in [0, num_threads) and returns
+  // once all of them finished; the calling thread runs thread_id 0. Loops
+  // started from inside a loop run serially, so nested kernels do not
+  // oversubscribe the cores
+  void run(int num_threads, std::function<void(int)> const &f);
+  ~CpuThreadPool();
+
+private:
+  CpuThreadPool() = default;
+  CpuThreadPool(CpuThreadPool const &) = delete;
+  void worker_loop(int thread_id, size_t generation);
+
+private:
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable start, done;
+  // The current loop, counted by generation; only threads with an id below
+  // num_threads take part, and pending counts the workers still running
+  std::function<void(int)> const *job = nullptr;
+  int num_threads = 0, pending = 0;
+  size_t generation = 0;
+  bool stopping = false;
+  // Set while the owner thread runs its share of a loop
+  bool running = false;
+};
+
+#endif // _FLEXFLOW_CPU_THREAD_POOL_H_
@@ -3,6 +3,7 @@
 #include "flexflow/ffconst.h"
 #include "legion.h"
 #include <cublas_v2.h>
+#include <cuda_fp16.h>
 #include <cudnn.h>
 
 #define FatalError(s)                                                          \
@@ -111,6 +112,7 @@ __global__ void apply_add_with_scale(DT *data_ptr,
 
 __global__ void
     gelu_forward_kernel(size_t size, float B, float C, float *input);
+__global__ void gelu_forward_kernel(size_t size, float B, float C, half *input);
 
 // Use by concat and split
 __global__ void add_with_stride(float *output,
@@ -134,7 +136,8 @@ template <typename T>
 void print_tensor(const T *ptr, size_t num_elements, char const *prefix);
 
 cudnnStatus_t cudnnSetTensorDescriptorFromDomain(cudnnTensorDescriptor_t tensor,
-                                                 Legion::Domain domain);
+                                                 Legion::Domain domain,
+                                                 DataType data_type = DT_FLOAT);
 
 cudaDataType_t ff_to_cuda_datatype(DataType type);
 
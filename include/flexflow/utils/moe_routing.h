@@ -0,0 +1,33 @@
+#ifndef _FLEXFLOW_MOE_ROUTING_H_
+#define _FLEXFLOW_MOE_ROUTING_H_
+#include <vector>
+
+// Routing of the k * batch_size (sample, choice) pairs of a top-k gate to
+// per-expert batches, computed by a counting sort over the expert ids. The
+// pairs of an expert keep their sample order, so Group_by, Aggregate and
+// AggregateSpec agree on the row of every pair, and the pairs past an
+// expert's capacity are dropped
+struct MoeRouting {
+  int num_experts = 0, capacity = 0;
+  // pairs sent to each expert, including the dropped ones
+  std::vector<int> counts;
+  // pairs[offsets[e] + r] is the pair in row r of expert e
+  std::vector<int> offsets, pairs;
+  // row of every pair in its expert batch, or -1 if the pair is dropped
+  std::vector<int> rows;
+
+  int num_kept(int expert) const {
+    return offsets[expert + 1] - offsets[expert];
+  }
+  int num_dropped(void) const {
+    return (int)rows.size() - offsets[num_experts];
+  }
+};
+
+void moe_route(int const *exp_assign,
+               int num_pairs,
+               int num_experts,
+               int capacity,
+               MoeRouting &routing);
+
+#endif // _FLEXFLOW_MOE_ROUTING_H_
@@ -0,0 +1,299 @@
+#ifndef _FLEXFLOW_PERSISTENT_MAP_H
+#define _FLEXFLOW_PERSISTENT_MAP_H
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// A hash map with the interface of std::unordered_map that copies in O(1).
+// It is a hash array mapped trie whose nodes and entries are shared between
+// copies; a write copies the nodes on the path to its entry, and the entry,
+// only while they are shared. Iteration and find are read only, so reads do
+// not copy anything
+template <typename K,
+          typename V,
+          typename Hash = std::hash<K>,
+          typename Equal = std::equal_to<K>>
+class persistent_map {
+public:
+  using value_type = std::pair<K const, V>;
+
+private:
+  static int const BITS = 5;
+  static size_t const MASK = (1 << BITS) - 1;
+  static int const HASH_BITS = 8 * sizeof(size_t);
+  // One level per BITS of the hash, and one for colliding entries
+  static int const MAX_DEPTH = (HASH_BITS + BITS - 1) / BITS + 1;
+
+  struct Entry {
+    Entry(size_t _hash, K const &key) : hash(_hash), kv(key, V()) {}
+    size_t hash;
+    value_type kv;
+  };
+  struct TrieNode;
+  // Either a child node or an entry
+  struct Slot {
+    std::shared_ptr<TrieNode> child;
+    std::shared_ptr<Entry> entry;
+  };
+  // The slots of the set bits of bitmap, in order. Nodes below the last
+  // level of hash bits hold colliding entries and no bitmap
+  struct TrieNode {
+    uint32_t bitmap = 0;
+    std::vector<Slot> slots;
+  };
+
+public:
+  class const_iterator {
+  public:
+    const_iterator(void) : depth(0) {}
+    value_type const &operator*(void) const {
+      return this->current()->kv;
+    }
+    value_type const *operator->(void) const {
+      return &this->current()->kv;
+    }
+    const_iterator &operator++(void) {
+      this->stack[this->depth - 1].second++;
+      this->settle();
+      return *this;
+    }
+    const_iterator operator++(int) {
+      const_iterator old = *this;
+      ++*this;
+      return old;
+    }
+    bool operator==(const_iterator const &other) const {
+      return this->current() == other.current();
+    }
+    bool operator!=(const_iterator const &other) const {
+      return this->current() != other.current();
+    }
+
+  private:
+    friend class persistent_map;
+    Entry const *current(void) const {
+      if (this->depth == 0) {
+        return nullptr;
+      }
+      auto const &top = this->stack[this->depth - 1];
+      return top.first->slots[top.second].entry.get();
+    }
+    void push(TrieNode const *node, size_t pos) {
+      assert(this->depth < MAX_DEPTH);
+      this->stack[this->depth++] = {node, pos};
+    }
+    // Moves to the first entry at or after the top of the stack
+    void settle(void) {
+      while (this->depth > 0) {
+        auto &top = this->stack[this->depth - 1];
+        if (top.second >= top.first->slots.size()) {
+          this->depth--;
+          if (this->depth > 0) {
+            this->stack[this->depth - 1].second++;
+          }
+        } else if (top.first->slots[top.second].child != nullptr) {
+          this->push(top.first->slots[top.second].child.get(), 0);
+        } else {
+          return;
+        }
+      }
+    }
+    // Path from the root to the current entry, empty at the end. It is
+    // bounded by the number of levels, so iterators never allocate
+    std::array<std::pair<TrieNode const *, size_t>, MAX_DEPTH> stack;
+    int depth;
+  };
+  using iterator = const_iterator;
+
+  persistent_map(void) : num_entries(0) {}
+
+  size_t size(void) const {
+    return this->num_entries;
+  }
+  bool empty(void) const {
+    return this->num_entries == 0;
+  }
+  void clear(void) {
+    this->root = nullptr;
+    this->num_entries = 0;
+  }
+  const_iterator begin(void) const {
+    const_iterator it;
+    if (this->root != nullptr) {
+      it.push(this->root.get(), 0);
+      it.settle();
+    }
+    return it;
+  }
+  const_iterator end(void) const {
+    return const_iterator();
+  }
+
+  const_iterator find(K const &key) const {
+    const_iterator it;
+    if (this->root == nullptr) {
+      return it;
+    }
+    size_t hash = Hash()(key);
+    TrieNode const *node = this->root.get();
+    for (int shift = 0;; shift += BITS) {
+      size_t pos;
+      if (!this->find_slot(node, shift, hash, key, pos)) {
+        return const_iterator();
+      }
+      it.push(node, pos);
+      Slot const &slot = node->slots[pos];
+      if (slot.child == nullptr) {
+        return Equal()(slot.entry->kv.first, key) ? it : const_iterator();
+      }
+      node = slot.child.get();
+    }
+  }
+  size_t count(K const &key) const {
+    return this->find_entry(key) == nullptr ? 0 : 1;
+  }
+  V const &at(K const &key) const {
+    Entry const *entry = this->find_entry(key);
+    if (entry == nullptr) {
+      throw std::out_of_range("persistent_map::at");
+    }
+    return entry->kv.second;
+  }
+
+  // Inserts a default value if key is missing. The reference is only valid
+  // until the next write to this map or a copy of it
+  V &operator[](K const &key) {
+    size_t hash = Hash()(key);
+    if (this->root == nullptr) {
+      this->root = std::make_shared<TrieNode>();
+    }
+    std::shared_ptr<TrieNode> *link = &this->root;
+    for (int shift = 0;; shift += BITS) {
+      TrieNode *node = this->make_unique(*link);
+      size_t pos;
+      if (!this->find_slot(node, shift, hash, key, pos)) {
+        Slot slot;
+        slot.entry = std::make_shared<Entry>(hash, key);
+        if (shift < HASH_BITS) {
+          node->bitmap |= (uint32_t)1 << ((hash >> shift) & MASK);
+        }
+        node->slots.insert(node->slots.begin() + pos, slot);
+        this->num_entries++;
+        return node->slots[pos].entry->kv.second;
+      }
+      Slot &slot = node->slots[pos];
+      if (slot.child != nullptr) {
+        link = &slot.child;
+        continue;
+      }
+      if (Equal()(slot.entry->kv.first, key)) {
+        if (slot.entry.use_count() > 1) {
+          slot.entry = std::make_shared<Entry>(*slot.entry);
+        }
+        return slot.entry->kv.second;
+      }
+      // Another key shares the hash bits so far; push it one level down
+      std::shared_ptr<TrieNode> child = std::make_shared<TrieNode>();
+      int child_shift = shift + BITS;
+      if (child_shift < HASH_BITS) {
+        size_t bit = (slot.entry->hash >> child_shift) & MASK;
+        child->bitmap = (uint32_t)1 << bit;
+      }
+      child->slots.push_back(slot);
+      slot.entry = nullptr;
+      slot.child = child;
+      link = &slot.child;
+    }
+  }
+
+  size_t erase(K const &key) {
+    if (this->find_entry(key) == nullptr) {
+      return 0;
+    }
+    this->erase(this->root, 0, Hash()(key), key);
+    if (this->root->slots.empty()) {
+      this->root = nullptr;
+    }
+    this->num_entries--;
+    return 1;
+  }
+
+private:
+  // Like find, without building the path of an iterator
+  Entry const *find_entry(K const &key) const {
+    if (this->root == nullptr) {
+      return nullptr;
+    }
+    size_t hash = Hash()(key);
+    TrieNode const *node = this->root.get();
+    for (int shift = 0;; shift += BITS) {
+      size_t pos;
+      if (!this->find_slot(node, shift, hash, key, pos)) {
+        return nullptr;
+      }
+      Slot const &slot = node->slots[pos];
+      if (slot.child == nullptr) {
+        return Equal()(slot.entry->kv.first, key) ? slot.entry.get()
+                                                  : nullptr;
+      }
+      node = slot.child.get();
+    }
+  }
+  // Position of the slot of key in node, or where it would be inserted
+  bool find_slot(TrieNode const *node,
+                 int shift,
+                 size_t hash,
+                 K const &key,
+                 size_t &pos) const {
+    if (shift >= HASH_BITS) {
+      for (pos = 0; pos < node->slots.size(); pos++) {
+        if (Equal()(node->slots[pos].entry->kv.first, key)) {
+          return true;
+        }
+      }
+      return false;
+    }
+    uint32_t bit = (uint32_t)1 << ((hash >> shift) & MASK);
+    pos = __builtin_popcount(node->bitmap & (bit - 1));
+    return (node->bitmap & bit) != 0;
+  }
+  TrieNode *make_unique(std::shared_ptr<TrieNode> &link) {
+    if (link.use_count() > 1) {
+      link = std::make_shared<TrieNode>(*link);
+    }
+    return link.get();
+  }
+  void erase(std::shared_ptr<TrieNode> &link,
+             int shift,
+             size_t hash,
+             K const &key) {
+    TrieNode *node = this->make_unique(link);
+    size_t pos;
+    if (!this->find_slot(node, shift, hash, key, pos)) {
+      assert(false);
+      return;
+    }
+    Slot &slot = node->slots[pos];
+    if (slot.child != nullptr) {
+      this->erase(slot.child, shift + BITS, hash, key);
+      if (!slot.child->slots.empty()) {
+        return;
+      }
+    }
+    node->slots.erase(node->slots.begin() + pos);
+    if (shift < HASH_BITS) {
+      node->bitmap &= ~((uint32_t)1 << ((hash >> shift) & MASK));
+    }
+  }
+
+  std::shared_ptr<TrieNode> root;
+  size_t num_entries;
+};
+
+#endif // _FLEXFLOW_PERSISTENT_MAP_H
@@ -10,6 +10,7 @@
 #include "flexflow/tensor.h"
 #include "flexflow_c.h"
 #include "flexflow_dataloader.h"
+#include <cstring>
 
 namespace py = pybind11;
 using py::literals::operator""_a;
@@ -143,6 +144,198 @@ void detach_numpy_array(Tensor t, FFConfig &config) {
   t->parallel_tensor->detach_raw_ptr(config);
 }
 
+//-------- TensorView --------
+
+template <typename T>
+void *get_view_ptr(PhysicalRegion const &region,
+                   RegionRequirement const &req,
+                   FFConfig &config) {
+  if (req.privilege == READ_ONLY) {
+    return const_cast<T *>(helperGetTensorPointerRO<T>(
+        region, req, FID_DATA, config.lg_ctx, config.lg_hlr));
+  }
+  return helperGetTensorPointerRW<T>(
+      region, req, FID_DATA, config.lg_ctx, config.lg_hlr);
+}
+
+// Zero-copy view of a tensor as numpy arrays. The view maps the tensor's
+// region into host memory; numpy and torch then read or write it in place.
+// Every array handed out keeps the view alive, and release() refuses to
+// unmap the region while any of them exists. Legion unmaps the region when a
+// FlexFlow task needs it, and numpy() maps it again, so arrays must not be
+// used across a launch that touches the tensor; take fresh ones after it
+class TensorView {
+public:
+  TensorView(Tensor t, FFConfig &_config, bool _writable, bool gradients)
+      : config(_config), writable(_writable), released(false), ptr(nullptr),
+        num_arrays(0) {
+    ParallelTensor pt = t->parallel_tensor;
+    if (pt == nullptr) {
+      throw std::runtime_error("tensor has no regions before compile");
+    }
+    LogicalRegion lr = gradients ? pt->region_grad : pt->region;
+    if (lr == LogicalRegion::NO_REGION) {
+      throw std::runtime_error("tensor has no such region");
+    }
+    // The arrays cover the first replica; replica dimensions are
+    // outermost, so it starts the region
+    volume = 1;
+    for (int i = pt->num_dims - 1; i >= 0; i--) {
+      if (!pt->dims[i].is_replica_dim) {
+        shape.push_back(pt->dims[i].size);
+        volume *= pt->dims[i].size;
+      }
+    }
+    data_type = pt->data_type;
+    switch (data_type) {
+      case DT_HALF:
+        format = "e";
+        break;
+      case DT_FLOAT:
+        format = py::format_descriptor<float>::format();
+        break;
+      case DT_DOUBLE:
+        format = py::format_descriptor<double>::format();
+        break;
+      case DT_INT32:
+        format = py::format_descriptor<int32_t>::format();
+        break;
+      case DT_INT64:
+        format = py::format_descriptor<int64_t>::format();
+        break;
+      default:
+        throw std::runtime_error("unsupported data type for a tensor view");
+    }
+    req = RegionRequirement(
+        lr, writable ? READ_WRITE : READ_ONLY, EXCLUSIVE, lr);
+    req.add_field(FID_DATA);
+    InlineLauncher launcher(req);
+    region = config.lg_hlr->map_region(config.lg_ctx, launcher);
+    Domain domain = config.lg_hlr->get_index_space_domain(
+        config.lg_ctx, lr.get_index_space());
+    assert(domain.get_volume() % volume == 0);
+    num_replicas = domain.get_volume() / volume;
+    map();
+  }
+
+  TensorView(TensorView const &) = delete;
+
+  // Arrays keep the view alive, so none is left when it is destroyed
+  ~TensorView() {
+    assert(num_arrays == 0);
+    release();
+  }
+
+  // Unmaps the region; writes through the view are copied to the other
+  // replicas first, so replicated weights stay in sync
+  void release() {
+    if (released) {
+      return;
+    }
+    if (num_arrays > 0) {
+      throw std::runtime_error(
+          "tensor view has " + std::to_string(num_arrays) +
+          " arrays in use; delete them before releasing the view");
+    }
+    if (region.is_mapped()) {
+      if (writable && num_replicas > 1) {
+        size_t num_bytes = volume * data_type_size(data_type);
+        for (size_t i = 1; i < num_replicas; i++) {
+          memcpy(static_cast<char *>(ptr) + i * num_bytes, ptr, num_bytes);
+        }
+      }
+      config.lg_hlr->unmap_region(config.lg_ctx, region);
+    }
+    released = true;
+    ptr = nullptr;
+  }
+
+  bool is_released() const {
+    return released;
+  }
+
+  // Array over the first replica, mapping the region again if a launch
+  // unmapped it
+  static py::array numpy(py::object self) {
+    TensorView &view = self.cast<TensorView &>();
+    if (view.released) {
+      throw std::runtime_error("tensor view was released");
+    }
+    view.map();
+    // FlexFlow stores the innermost dimension contiguously, which is the
+    // last one in numpy order
+    ssize_t item_size = data_type_size(view.data_type);
+    std::vector<ssize_t> strides(view.shape.size());
+    ssize_t stride = item_size;
+    for (size_t i = view.shape.size(); i > 0; i--) {
+      strides[i - 1] = stride;
+      stride *= view.shape[i - 1];
+    }
+    // The base of the array holds a reference to the view and counts the
+    // array until numpy frees it
+    py::capsule base(new py::object(self), [](void *p) {
+      py::object *owner = static_cast<py::object *>(p);
+      owner->cast<TensorView &>().num_arrays--;
+      delete owner;
+    });
+    view.num_arrays++;
+    py::array array(
+        py::dtype(view.format), view.shape, strides, view.ptr, base);
+    if (!view.writable) {
+      array.attr("flags").attr("writeable") = false;
+    }
+    return array;
+  }
+
+private:
+  void map() {
+    if (!region.is_mapped()) {
+      config.lg_hlr->remap_region(config.lg_ctx, region);
+    }
+    region.wait_until_valid();
+    switch (data_type) {
+      case DT_HALF:
+        ptr = get_view_ptr<half>(region, req, config);
+        break;
+      case DT_FLOAT:
+        ptr = get_view_ptr<float>(region, req, config);
+        break;
+      case DT_DOUBLE:
+        ptr = get_view_ptr<double>(region, req, config);
+        break;
+      case DT_INT32:
+        ptr = get_view_ptr<int32_t>(region, req, config);
+        break;
+      case DT_INT64:
+        ptr = get_view_ptr<int64_t>(region, req, config);
+        break;
+      default:
+        assert(false);
+    }
+  }
+
+private:
+  FFConfig &config;
+  bool writable, released;
+  DataType data_type;
+  RegionRequirement req;
+  PhysicalRegion region;
+  void *ptr;
+  std::string format;
+  // Non-replica sizes in numpy order
+  std::vector<ssize_t> shape;
+  size_t volume, num_replicas;
+  // Live arrays handed out by numpy()
+  int num_arrays;
+};
+
+TensorView *create_tensor_view(Tensor t,
+                               FFConfig &config,
+                               bool writable,
+                               bool gradients) {
+  return new TensorView(t, config, writable, gradients);
+}
+
 //-------- Parameter --------
 
 bool get_weights(Parameter parameter, FFModel &model, py::array &full_array) {
@@ -300,7 +493,11 @@ std::vector<Tensor> split(FFModel &model,
 } // namespace
 
 PYBIND11_MODULE(flexflow_pybind11_internal, m) {
+#ifdef FF_USE_CPU
+  m.attr("cuda_enabled") = false;
+#else
   m.attr("cuda_enabled") = true;
+#endif
 
   m.def("begin_flexflow_task", &begin_flexflow_task);
   m.def("finish_flexflow_task", &finish_flexflow_task);
@@ -316,6 +513,7 @@ PYBIND11_MODULE(flexflow_pybind11_internal, m) {
   py::enum_<DataType>(m, "DataType")
       .value("DT_FLOAT", DataType::DT_FLOAT)
       .value("DT_DOUBLE", DataType::DT_DOUBLE)
+      .value("DT_HALF", DataType::DT_HALF)
       .value("DT_INT32", DataType::DT_INT32)
       .value("DT_INT64", DataType::DT_INT64)
       .value("DT_BOOLEAN", DataType::DT_BOOLEAN);
@@ -393,7 +591,34 @@ PYBIND11_MODULE(flexflow_pybind11_internal, m) {
       .def("set_tensor", &set_tensor, "ffmodel"_a, "np_array"_a)
       .def(
           "attach_numpy_array", &attach_numpy_array, "ffconfig"_a, "np_array"_a)
-      .def("detach_numpy_array", &detach_numpy_array, "ffconfig"_a);
+      .def("detach_numpy_array", &detach_numpy_array, "ffconfig"_a)
+      .def("view",
+           &create_tensor_view,
+           "ffconfig"_a,
+           "writable"_a = false,
+           "gradients"_a = false);
+
+  py::class_<TensorView>(m, "TensorView")
+      .def("numpy", &TensorView::numpy)
+      .def("__array__",
+           [](py::object self, py::object dtype, py::object copy) {
+             py::object array = TensorView::numpy(self);
+             if (!dtype.is_none()) {
+               array = array.attr("astype")(dtype);
+             } else if (!copy.is_none() && copy.cast<bool>()) {
+               array = array.attr("copy")();
+             }
+             return array;
+           },
+           "dtype"_a = py::none(),
+           "copy"_a = py::none())
+      .def_property_readonly("released", &TensorView::is_released)
+      .def("release", &TensorView::release)
+      .def("__enter__", [](py::object self) { return self; })
+      .def("__exit__",
+           [](TensorView &view, py::object, py::object, py::object) {
+             view.release();
+           });
 
   // py::class_<Tensor, TensorBase* >(m, "Tensor");
   // py::class_<Tensor>(m, "Tensor");
@@ -654,7 +879,8 @@ PYBIND11_MODULE(flexflow_pybind11_internal, m) {
            "add_bias_k"_a = false,
            "add_zero_attn"_a = false,
            "kernel_initializer"_a = nullptr,
-           "name"_a = nullptr)
+           "name"_a = nullptr,
+           "causal"_a = false)
       .def("concat", &concat, "tensors"_a, "axis"_a, "name"_a = nullptr)
       .def("split", &split, "input"_a, "split"_a, "axis"_a, "name"_a = nullptr)
       // Others
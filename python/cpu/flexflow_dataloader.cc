@@ -0,0 +1,150 @@
+/* Copyright 2020 Stanford, Los Alamos National Laboratory
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flexflow/utils/cpu_helper.h"
+#include "python/flexflow_dataloader.h"
+
+using namespace Legion;
+using namespace FlexFlow;
+
+// Copies the samples of a batch, which need not be contiguous in the dataset
+template <typename DT>
+static void copy_samples(DT *batch_ptr,
+                         const DT *full_ptr,
+                         SampleIdxs const *meta,
+                         coord_t sample_size) {
+  for (int i = 0; i < meta->num_samples; i++) {
+    copy_kernel<DT>(batch_ptr + i * sample_size,
+                    full_ptr + meta->idxs[i] * sample_size,
+                    sample_size);
+  }
+}
+
+void ImgDataLoader::load_label(Task const *task,
+                               std::vector<PhysicalRegion> const &regions,
+                               Context ctx,
+                               Runtime *runtime) {
+  assert(regions.size() == 2);
+  assert(task->regions.size() == 2);
+  SampleIdxs *meta = (SampleIdxs *)task->local_args;
+  TensorAccessorR<int, 2> acc_full_label(
+      regions[0], task->regions[0], FID_DATA, ctx, runtime);
+  TensorAccessorW<int, 2> acc_batch_label(regions[1],
+                                          task->regions[1],
+                                          FID_DATA,
+                                          ctx,
+                                          runtime,
+                                          false /*readOutput*/);
+  int batch_size = acc_batch_label.rect.hi[1] - acc_batch_label.rect.lo[1] + 1;
+  assert(batch_size == meta->num_samples);
+  copy_samples(acc_batch_label.ptr,
+               acc_full_label.ptr,
+               meta,
+               acc_batch_label.rect.volume() / batch_size);
+}
+
+void ImgDataLoader4D::load_input(Task const *task,
+                                 std::vector<PhysicalRegion> const &regions,
+                                 Context ctx,
+                                 Runtime *runtime) {
+  assert(regions.size() == 2);
+  assert(task->regions.size() == 2);
+  SampleIdxs *meta = (SampleIdxs *)task->local_args;
+  TensorAccessorR<float, 4> acc_full_input(
+      regions[0], task->regions[0], FID_DATA, ctx, runtime);
+  TensorAccessorW<float, 4> acc_batch_input(regions[1],
+                                            task->regions[1],
+                                            FID_DATA,
+                                            ctx,
+                                            runtime,
+                                            false /*readOutput*/);
+  coord_t batch_size =
+      acc_batch_input.rect.hi[3] - acc_batch_input.rect.lo[3] + 1;
+  coord_t channels =
+      acc_batch_input.rect.hi[2] - acc_batch_input.rect.lo[2] + 1;
+  coord_t height = acc_batch_input.rect.hi[1] - acc_batch_input.rect.lo[1] + 1;
+  coord_t width = acc_batch_input.rect.hi[0] - acc_batch_input.rect.lo[0] + 1;
+  assert(batch_size == meta->num_samples);
+  copy_samples(
+      acc_batch_input.ptr, acc_full_input.ptr, meta, channels * height * width);
+}
+
+void ImgDataLoader2D::load_input(Task const *task,
+                                 std::vector<PhysicalRegion> const &regions,
+                                 Context ctx,
+                                 Runtime *runtime) {
+  assert(regions.size() == 2);
+  assert(task->regions.size() == 2);
+  SampleIdxs *meta = (SampleIdxs *)task->local_args;
+  TensorAccessorR<float, 2> acc_full_input(
+      regions[0], task->regions[0], FID_DATA, ctx, runtime);
+  TensorAccessorW<float, 2> acc_batch_input(regions[1],
+                                            task->regions[1],
+                                            FID_DATA,
+                                            ctx,
+                                            runtime,
+                                            false /*readOutput*/);
+  coord_t batch_size =
+      acc_batch_input.rect.hi[1] - acc_batch_input.rect.lo[1] + 1;
+  coord_t width = acc_batch_input.rect.hi[0] - acc_batch_input.rect.lo[0] + 1;
+  assert(batch_size == meta->num_samples);
+  copy_samples(acc_batch_input.ptr, acc_full_input.ptr, meta, width);
+}
+
+template <typename DT>
+void SingleDataLoader::load_input(Task const *task,
+                                  std::vector<PhysicalRegion> const &regions,
+                                  Context ctx,
+                                  Runtime *runtime) {
+  assert(regions.size() == 2);
+  assert(task->regions.size() == 2);
+  SampleIdxs *meta = (SampleIdxs *)task->local_args;
+  Domain full_input_domain = runtime->get_index_space_domain(
+      ctx, task->regions[0].region.get_index_space());
+  Domain batch_input_domain = runtime->get_index_space_domain(
+      ctx, task->regions[1].region.get_index_space());
+  const DT *full_input_ptr = helperGetTensorPointerRO<DT>(
+      regions[0], task->regions[0], FID_DATA, ctx, runtime);
+  DT *batch_input_ptr = helperGetTensorPointerWO<DT>(
+      regions[1], task->regions[1], FID_DATA, ctx, runtime);
+
+  // add one dim since the batch input has a leading replica dim
+  int num_dims = full_input_domain.get_dim();
+  assert(num_dims + 1 == batch_input_domain.get_dim());
+  // assert the leading replica dim has a degree of one
+  assert(batch_input_domain.hi()[num_dims] ==
+         batch_input_domain.lo()[num_dims]);
+  coord_t batch_size = batch_input_domain.hi()[num_dims - 1] -
+                       batch_input_domain.lo()[num_dims - 1] + 1;
+  coord_t num_elements_per_batch = batch_input_domain.get_volume() / batch_size;
+  assert(batch_size == meta->num_samples);
+  copy_samples(batch_input_ptr, full_input_ptr, meta, num_elements_per_batch);
+}
+
+template void SingleDataLoader::load_input<float>(
+    Task const *task,
+    std::vector<PhysicalRegion> const &regions,
+    Context ctx,
+    Runtime *runtime);
+template void SingleDataLoader::load_input<int32_t>(
+    Task const *task,
+    std::vector<PhysicalRegion> const &regions,
+    Context ctx,
+    Runtime *runtime);
+template void SingleDataLoader::load_input<int64_t>(
+    Task const *task,
+    std::vector<PhysicalRegion> const &regions,
+    Context ctx,
+    Runtime *runtime);
@@ -40,6 +40,8 @@ def get_datatype_size(datatype):
     return 4
   elif (datatype == DataType.DT_DOUBLE):
     return 8
+  elif (datatype == DataType.DT_HALF):
+    return 2
   elif (datatype == DataType.DT_INT32):
     return 4
   elif (datatype == DataType.DT_INT64):
@@ -777,6 +779,160 @@ class Parameter(Tensor):
     assert ret_val == True
     return np_array
 
+# -----------------------------------------------------------------------
+# LayerBatch
+# -----------------------------------------------------------------------
+
+class LayerBatch(object):
+  """Layers recorded in Python and added to an FFModel by a single call to
+  :meth:`FFModel.add_layers`, instead of several calls into C++ per layer.
+  The batch is serialized in the FX-IR format read by
+  :meth:`FFModel.import_fx_file`. Its methods take and return the names of
+  nodes in the batch instead of Tensors.
+  """
+  __slots__ = ['_lines', '_names', '_nb_nodes']
+  def __init__(self):
+    self._lines = []
+    self._names = set()
+    self._nb_nodes = 0
+
+  def _new_name(self, name):
+    if name is None:
+      name = "batch_node_%d" % self._nb_nodes
+    self._nb_nodes += 1
+    assert name not in self._names, "Node %s is defined twice" % name
+    assert ';' not in name and ',' not in name, "Bad node name %s" % name
+    self._names.add(name)
+    return name
+
+  def _add_node(self, name, op_type, inputs, args=(), outputs=()):
+    items = [name, "".join(i + "," for i in inputs),
+             "".join(o + "," for o in outputs), op_type]
+    items.extend(str(arg) for arg in args)
+    self._lines.append("; ".join(items))
+    return name
+
+  def add_node(self, op_type, inputs, args=(), name=None):
+    """Adds a node of the FX-IR format, see :meth:`PyTorchModel.torch_to_file`.
+
+    :param op_type: the name of the OpType of the node, e.g., "LINEAR".
+    :type op_type: string
+
+    :param inputs: the input nodes.
+    :type inputs: list of strings
+
+    :param args: the arguments following the op type.
+    :type args: list
+
+    :returns:  string -- the name of the node.
+    """
+    return self._add_node(self._new_name(name), op_type, inputs, args)
+
+  def input(self, name=None):
+    """Adds an input node, bound to a Tensor by :meth:`FFModel.add_layers`
+    in the order of the calls.
+    """
+    return self.add_node("INPUT", [], name=name)
+
+  def dense(self, input, out_dim, activation=ActiMode.AC_MODE_NONE,
+            use_bias=True, name=None):
+    return self.add_node("LINEAR", [input],
+                         [out_dim, activation.value, int(use_bias)], name)
+
+  def conv2d(self, input, out_channels, kernel_h, kernel_w, stride_h, stride_w,
+             padding_h, padding_w, activation=ActiMode.AC_MODE_NONE, groups=1,
+             use_bias=True, name=None):
+    return self.add_node("CONV2D", [input],
+                         [out_channels, kernel_h, kernel_w, stride_h, stride_w,
+                          padding_h, padding_w, activation.value, groups,
+                          int(use_bias)], name)
+
+  def pool2d(self, input, kernel, stride, padding,
+             pool_type=PoolType.POOL_MAX, activation=ActiMode.AC_MODE_NONE,
+             name=None):
+    """Pool2D with square windows."""
+    return self.add_node("POOL2D", [input],
+                         [kernel, stride, padding, pool_type.value,
+                          activation.value], name)
+
+  def embedding(self, input, num_embeddings, embedding_dim, name=None):
+    return self.add_node("EMBEDDING", [input],
+                         [num_embeddings, embedding_dim], name)
+
+  def batch_norm(self, input, name=None):
+    return self.add_node("BATCH_NORM", [input], name=name)
+
+  def softmax(self, input, name=None):
+    return self.add_node("SOFTMAX", [input], name=name)
+
+  def dropout(self, input, rate, name=None):
+    return self.add_node("DROPOUT", [input], [rate], name)
+
+  def flat(self, input, name=None):
+    return self.add_node("FLAT", [input], name=name)
+
+  def relu(self, input, name=None):
+    return self.add_node("RELU", [input], name=name)
+
+  def sigmoid(self, input, name=None):
+    return self.add_node("SIGMOID", [input], name=name)
+
+  def tanh(self, input, name=None):
+    return self.add_node("TANH", [input], name=name)
+
+  def elu(self, input, name=None):
+    return self.add_node("ELU", [input], name=name)
+
+  def gelu(self, input, name=None):
+    return self.add_node("GELU", [input], name=name)
+
+  def identity(self, input, name=None):
+    return self.add_node("IDENTITY", [input], name=name)
+
+  def scalar_add(self, input, scalar, name=None):
+    return self.add_node("SCALAR_ADD", [input], [scalar], name)
+
+  def scalar_sub(self, input, scalar, name=None):
+    return self.add_node("SCALAR_SUB", [input], [scalar], name)
+
+  def scalar_multiply(self, input, scalar, name=None):
+    return self.add_node("SCALAR_MULTIPLY", [input], [scalar], name)
+
+  def scalar_true_divide(self, input, scalar, name=None):
+    return self.add_node("SCALAR_TRUEDIV", [input], [scalar], name)
+
+  def add(self, x, y, name=None):
+    return self.add_node("ADD", [x, y], name=name)
+
+  def multiply(self, x, y, name=None):
+    return self.add_node("MULTIPLY", [x, y], name=name)
+
+  def batch_matmul(self, a, b, name=None):
+    return self.add_node("BATCH_MATMUL", [a, b], name=name)
+
+  def concat(self, inputs, axis, name=None):
+    return self.add_node("CONCAT", inputs, [axis], name)
+
+  def split(self, input, num_splits, axis, name=None):
+    """Splits evenly into num_splits nodes, returned as a list."""
+    name = self._new_name(name)
+    items = [self._new_name(None) for i in range(num_splits)]
+    self._add_node(name, "SPLIT", [input], [axis], items)
+    for i in range(num_splits):
+      self._add_node(items[i], "GETITEM", [name], [i])
+    return items
+
+  def reshape(self, input, shape, name=None):
+    return self.add_node("RESHAPE", [input], shape, name)
+
+  def transpose(self, input, perm, name=None):
+    return self.add_node("PERMUTE", [input], perm, name)
+
+  def to_string(self, outputs):
+    """Serializes the batch, ending with an output node for outputs."""
+    output = ["output", "".join(o + "," for o in outputs), "", "OUTPUT"]
+    return "\n".join(self._lines + ["; ".join(output)])
+
 # -----------------------------------------------------------------------
 # FFModel
 # -----------------------------------------------------------------------
@@ -1388,6 +1544,71 @@ class FFModel(object):
     del c_outputs_handle_list
     return output_tensor_list
 
+  def import_fx_file(self, filename, input_tensors):
+    """Adds the layers of a PyTorch model in a single call, reading the FX-IR
+    file written by :meth:`PyTorchModel.torch_to_file` in C++. Unlike
+    :func:`flexflow.torch.model.file_to_ff`, no Python call is made per layer,
+    so the imported layers are not listed by :meth:`get_layers`.
+
+    :param filename: the FX-IR file.
+    :type filename: string
+
+    :param input_tensors: the tensors bound to the input nodes, in order.
+    :type input_tensors: list of Tensors
+
+    :returns:  list of Tensors -- the output tensors.
+
+    :raises RuntimeError: if the file is malformed or has a node that cannot be imported.
+    """
+    c_filename = get_c_name(filename)
+    c_inputs = ffi.new("flexflow_tensor_t[]", [t.handle for t in input_tensors])
+    c_outputs = ffi.new("flexflow_tensor_t[256]")
+    c_error = ffi.new("char[]", 1024)
+    n = ffc.flexflow_model_import_fx_file(self.handle, c_filename, len(input_tensors), c_inputs, 256, c_outputs, c_error, 1024)
+    if n < 0:
+      raise RuntimeError(ffi.string(c_error).decode())
+    output_tensor_list = []
+    for i in range(n):
+      tensor_p_handle = ffi.new("flexflow_tensor_t*")
+      tensor_p_handle.impl = c_outputs[i].impl
+      output_tensor_list.append(Tensor(None, p_handle=tensor_p_handle))
+    del c_outputs
+    return output_tensor_list
+
+  def add_layers(self, batch, input_tensors, outputs):
+    """Adds the layers recorded in a :class:`LayerBatch` in a single call.
+    As with :meth:`import_fx_file`, the added layers are not listed by
+    :meth:`get_layers`.
+
+    :param batch: the layers.
+    :type batch: LayerBatch
+
+    :param input_tensors: the tensors bound to the input nodes of the batch, in order.
+    :type input_tensors: list of Tensors
+
+    :param outputs: the nodes whose tensors are returned; each must have a single tensor.
+    :type outputs: list of strings
+
+    :returns:  list of Tensors -- the output tensors.
+
+    :raises RuntimeError: if a layer of the batch is malformed or cannot be added.
+    """
+    c_graph = get_c_name(batch.to_string(outputs))
+    c_inputs = ffi.new("flexflow_tensor_t[]", [t.handle for t in input_tensors])
+    c_outputs = ffi.new("flexflow_tensor_t[]", len(outputs))
+    c_error = ffi.new("char[]", 1024)
+    n = ffc.flexflow_model_add_layers(self.handle, c_graph, len(input_tensors), c_inputs, len(outputs), c_outputs, c_error, 1024)
+    if n < 0:
+      raise RuntimeError(ffi.string(c_error).decode())
+    assert n == len(outputs)
+    output_tensor_list = []
+    for i in range(n):
+      tensor_p_handle = ffi.new("flexflow_tensor_t*")
+      tensor_p_handle.impl = c_outputs[i].impl
+      output_tensor_list.append(Tensor(None, p_handle=tensor_p_handle))
+    del c_outputs
+    return output_tensor_list
+
   def flat(self, input, name=None):
     """Flattens the input. Does not affect the batch size.
              
@@ -1686,7 +1907,7 @@ class FFModel(object):
                           embed_dim, num_heads, 
                           kdim=0, vdim=0, dropout=0.0, 
                           bias=True, add_bias_kv=False, add_zero_attn=False, 
-                          kernel_initializer=None, name=None):
+                          kernel_initializer=None, name=None, causal=False):
     """Defines the MultiHead Attention operation as described in Attention Is All You Need 
     which takes in the tensors :attr:`query`, :attr:`key`, and :attr:`value`, 
     and returns the dot-product attention between them:.
@@ -1726,15 +1947,18 @@ class FFModel(object):
     
     :param kernel_initializer: Initializer for dense layer kernels. If it is set to None, the GlorotUniformInitializer is applied.
     :type kernel_initializer: Initializer
-             
+
     :param name: the name of the layer. Default is None.
     :type name: string
 
+    :param causal: whether each query only attends to the keys at or before its position. Default is False.
+    :type causal: bool
+
     :returns:  Tensor -- the output tensor.
     """     
     c_name = get_c_name(name)                 
     kernel_init_handle = self.__get_initializer_handle(kernel_initializer)
-    handle = ffc.flexflow_model_add_multihead_attention(self.handle, query.handle, key.handle, value.handle, embed_dim, num_heads, kdim, vdim, dropout, bias, add_bias_kv, add_zero_attn, kernel_init_handle, c_name)
+    handle = ffc.flexflow_model_add_multihead_attention(self.handle, query.handle, key.handle, value.handle, embed_dim, num_heads, kdim, vdim, dropout, bias, add_bias_kv, add_zero_attn, kernel_init_handle, c_name, causal)
     self.add_layer(OpType.MULTIHEAD_ATTENTION, name)
     return Tensor(handle, owner_op_type=OpType.MULTIHEAD_ATTENTION)
 
@@ -2489,6 +2489,10 @@ class PyTorchModel():
     @staticmethod
     def file_to_ff(filename, ffmodel, input_tensors):
         """
+        Adds the layers one Python call at a time; see
+        :meth:`FFModel.import_fx_file` for the native importer of the same
+        format.
+
         Args:
             filename (string): Name of the file from which to load the model
                 information; should be the output of :meth:`torch_to_file`.
@@ -13,8 +13,12 @@
  * limitations under the License.
  */
 
+#include "flexflow/fx_importer.h"
 #include "flexflow_c.h"
 #include "flexflow_dataloader.h"
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
 
 using namespace Legion;
 using namespace FlexFlow;
@@ -867,7 +871,8 @@ flexflow_tensor_t flexflow_model_add_multihead_attention(
     bool add_bias_kv,
     bool add_zero_attn,
     flexflow_initializer_t kernel_initializer_,
-    char const *name) {
+    char const *name,
+    bool causal) {
   FFModel *handle = FFCObjectWrapper::unwrap(handle_);
   Tensor query = FFCObjectWrapper::unwrap(query_);
   Tensor key = FFCObjectWrapper::unwrap(key_);
@@ -886,10 +891,12 @@ flexflow_tensor_t flexflow_model_add_multihead_attention(
                                               add_bias_kv,
                                               add_zero_attn,
                                               kernel_initializer,
-                                              name);
+                                              name,
+                                              causal);
   DEBUG_PRINT("[MultiHeadAttention] new Tensor %p, query %p, key %p, value %p, "
               "embed_dim %d, num_heads %d, kdim %d, vdim %d, dropout %f, bias "
-              "%d, add_bias_kv %d, add_zero_attn %d, kernel_init %p, name %s",
+              "%d, add_bias_kv %d, add_zero_attn %d, kernel_init %p, name %s, "
+              "causal %d",
               tensor,
               query,
               key,
@@ -903,10 +910,94 @@ flexflow_tensor_t flexflow_model_add_multihead_attention(
               add_bias_kv,
               add_zero_attn,
               kernel_initializer,
-              name);
+              name,
+              causal);
   return FFCObjectWrapper::wrap(tensor);
 }
 
+// Copies the message of an import error for the caller
+static int return_import_error(std::string const &message,
+                               char *error,
+                               int max_error_length) {
+  if (max_error_length > 0) {
+    strncpy(error, message.c_str(), max_error_length - 1);
+    error[max_error_length - 1] = '\0';
+  }
+  return -1;
+}
+
+int flexflow_model_import_fx_file(flexflow_model_t handle_,
+                                  char const *filename,
+                                  int num_inputs,
+                                  flexflow_tensor_t *inputs_,
+                                  int max_outputs,
+                                  flexflow_tensor_t *outputs_,
+                                  char *error,
+                                  int max_error_length) {
+  FFModel *handle = FFCObjectWrapper::unwrap(handle_);
+  std::vector<Tensor> inputs;
+  for (int i = 0; i < num_inputs; i++) {
+    inputs.push_back(FFCObjectWrapper::unwrap(inputs_[i]));
+  }
+  std::vector<Tensor> outputs;
+  try {
+    outputs = import_fx_file(*handle, filename, inputs);
+  } catch (std::runtime_error const &e) {
+    return return_import_error(e.what(), error, max_error_length);
+  }
+  if ((int)outputs.size() > max_outputs) {
+    return return_import_error("[FX] the graph has more than " +
+                                   std::to_string(max_outputs) + " outputs",
+                               error,
+                               max_error_length);
+  }
+  for (size_t i = 0; i < outputs.size(); i++) {
+    outputs_[i] = FFCObjectWrapper::wrap(outputs[i]);
+  }
+  DEBUG_PRINT("[ImportFX] file %s, num_inputs %d, num_outputs %zu",
+              filename,
+              num_inputs,
+              outputs.size());
+  return outputs.size();
+}
+
+int flexflow_model_add_layers(flexflow_model_t handle_,
+                              char const *graph,
+                              int num_inputs,
+                              flexflow_tensor_t *inputs_,
+                              int max_outputs,
+                              flexflow_tensor_t *outputs_,
+                              char *error,
+                              int max_error_length) {
+  FFModel *handle = FFCObjectWrapper::unwrap(handle_);
+  std::vector<Tensor> inputs;
+  for (int i = 0; i < num_inputs; i++) {
+    inputs.push_back(FFCObjectWrapper::unwrap(inputs_[i]));
+  }
+  int num_layers = handle->layers.size();
+  std::istringstream stream(graph);
+  std::vector<Tensor> outputs;
+  try {
+    outputs = import_fx_graph(*handle, stream, inputs);
+  } catch (std::runtime_error const &e) {
+    return return_import_error(e.what(), error, max_error_length);
+  }
+  if ((int)outputs.size() > max_outputs) {
+    return return_import_error("[FX] the batch has more than " +
+                                   std::to_string(max_outputs) + " outputs",
+                               error,
+                               max_error_length);
+  }
+  for (size_t i = 0; i < outputs.size(); i++) {
+    outputs_[i] = FFCObjectWrapper::wrap(outputs[i]);
+  }
+  DEBUG_PRINT("[AddLayers] num_layers %zu, num_inputs %d, num_outputs %zu",
+              handle->layers.size() - num_layers,
+              num_inputs,
+              outputs.size());
+  return outputs.size();
+}
+
 void flexflow_model_set_sgd_optimizer(flexflow_model_t handle_,
                                       flexflow_sgd_optimizer_t optimizer_) {
   FFModel *handle = FFCObjectWrapper::unwrap(handle_);
@@ -1975,7 +2066,7 @@ void register_c_custom_tasks() {
   // 4D Load input
   {
     TaskVariantRegistrar registrar(CUSTOM_GPU_TASK_ID_1, "4D Load Inputs");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<ImgDataLoader4D::load_input>(
         registrar, "4D Load Input Task");
@@ -1983,7 +2074,7 @@ void register_c_custom_tasks() {
   // Load label
   {
     TaskVariantRegistrar registrar(CUSTOM_GPU_TASK_ID_2, "Load Labels");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<ImgDataLoader::load_label>(
         registrar, "Load Label Task");
@@ -1991,7 +2082,7 @@ void register_c_custom_tasks() {
   // 2D Load input
   {
     TaskVariantRegistrar registrar(CUSTOM_GPU_TASK_ID_3, "2D Load Inputs");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<ImgDataLoader2D::load_input>(
         registrar, "2D Load Input Task");
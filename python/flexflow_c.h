@@ -334,7 +334,32 @@ flexflow_tensor_t flexflow_model_add_multihead_attention(
     bool add_bias_kv,
     bool add_zero_attn,
     flexflow_initializer_t kernel_initializer,
-    char const *name);
+    char const *name,
+    bool causal);
+
+// Adds the layers of an FX-IR file written by PyTorchModel.torch_to_file and
+// returns the number of output tensors, or -1 if the file cannot be imported,
+// in which case the reason is copied to error
+int flexflow_model_import_fx_file(flexflow_model_t handle,
+                                  char const *filename,
+                                  int num_inputs,
+                                  flexflow_tensor_t *inputs,
+                                  int max_outputs,
+                                  flexflow_tensor_t *outputs,
+                                  char *error,
+                                  int max_error_length);
+
+// Adds a batch of layers described in the FX-IR format in a single call and
+// returns the number of output tensors, or -1 if the batch cannot be added,
+// in which case the reason is copied to error
+int flexflow_model_add_layers(flexflow_model_t handle,
+                              char const *graph,
+                              int num_inputs,
+                              flexflow_tensor_t *inputs,
+                              int max_outputs,
+                              flexflow_tensor_t *outputs,
+                              char *error,
+                              int max_error_length);
 
 void flexflow_model_set_sgd_optimizer(flexflow_model_t handle,
                                       flexflow_sgd_optimizer_t optimizer);
@@ -1057,7 +1057,7 @@ void SingleDataLoader::register_gpu_tasks(void) {
   {
     TaskVariantRegistrar registrar(PY_DL_FLOAT_LOAD_BATCH_GPU_TASK_ID,
                                    "Float Load Inputs");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<SingleDataLoader::load_input<float>>(
         registrar, "Float Load Input Task");
@@ -1066,7 +1066,7 @@ void SingleDataLoader::register_gpu_tasks(void) {
   {
     TaskVariantRegistrar registrar(PY_DL_INT32_LOAD_BATCH_GPU_TASK_ID,
                                    "Int32 Load Inputs");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<SingleDataLoader::load_input<int32_t>>(
         registrar, "Int32 Load Input Task");
@@ -1075,7 +1075,7 @@ void SingleDataLoader::register_gpu_tasks(void) {
   {
     TaskVariantRegistrar registrar(PY_DL_INT64_LOAD_BATCH_GPU_TASK_ID,
                                    "Int64 Load Inputs");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<SingleDataLoader::load_input<int64_t>>(
         registrar, "Int64 Load Input Task");
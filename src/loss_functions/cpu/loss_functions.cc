@@ -0,0 +1,76 @@
+/* Copyright 2020 Stanford
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flexflow/model.h"
+#include "flexflow/utils/cpu_helper.h"
+
+namespace FlexFlow {
+
+using namespace Legion;
+
+static void scale_gradients(float *ptr, size_t size, float scale_factor) {
+  CPU_KERNEL_LOOP(i, (coord_t)size) {
+    ptr[i] *= scale_factor;
+  }
+}
+
+void Loss::sparse_categorical_crossentropy_loss_backward_kernel_wrapper(
+    float *logit_grad_ptr,
+    float const *logit_ptr,
+    int const *label_ptr,
+    size_t logit_volume,
+    size_t logit_grad_volume,
+    int num_samples,
+    int num_classes,
+    int k,
+    float scale_factor) {
+  copy_kernel<float>(logit_grad_ptr, logit_ptr, logit_volume);
+  CPU_KERNEL_LOOP(i, num_samples) {
+    int label_idx = label_ptr[i / k];
+    logit_grad_ptr[i * num_classes + label_idx] -= 1.0f;
+  }
+  // Scale logit gradients by op->scale_factor
+  scale_gradients(logit_grad_ptr, logit_grad_volume, scale_factor * k);
+}
+
+void Loss::categorical_crossentropy_loss_backward_kernel_wrapper(
+    float *logit_grad_ptr,
+    float const *logit_ptr,
+    float const *label_ptr,
+    size_t logit_volume,
+    size_t logit_grad_volume,
+    float scale_factor) {
+  CPU_KERNEL_LOOP(i, (coord_t)logit_volume) {
+    logit_grad_ptr[i] = logit_ptr[i] - label_ptr[i];
+  }
+  // Scale logit gradients by loss->scale_factor
+  scale_gradients(logit_grad_ptr, logit_grad_volume, scale_factor);
+}
+
+void Loss::mean_squared_error_avg_loss_backward_kernel_wrapper(
+    float *logit_grad_ptr,
+    float const *logit_ptr,
+    float const *label_ptr,
+    size_t logit_volume,
+    size_t logit_grad_volume,
+    float scale_factor) {
+  CPU_KERNEL_LOOP(i, (coord_t)logit_volume) {
+    logit_grad_ptr[i] = logit_ptr[i] - label_ptr[i];
+  }
+  // Scale logit gradients by loss->scale_factor
+  scale_gradients(logit_grad_ptr, logit_grad_volume, scale_factor);
+}
+
+}; // namespace FlexFlow
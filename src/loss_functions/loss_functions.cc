@@ -48,6 +48,11 @@ void Loss::backward(FFModel *model,
   } else {
     scale_factor = 1.0f / model->config.batchSize;
   }
+  if (model->config.enable_loss_scaling) {
+    // Scale the loss so that small gradients do not underflow in half
+    // precision; the optimizer unscales them before the update
+    scale_factor *= model->loss_scale;
+  }
   // scale_factor = 1.0f;
   //  Use the same parallel strategy as the owner of logit
   std::string pcname = logit->owner_op->name;
@@ -57,17 +57,36 @@ ShardID FFShardingFunctor::shard(DomainPoint const &point,
   return shard_id;
 }
 
+// Zero-copy memory if the machine has GPUs, otherwise system memory
+static Memory find_host_memory(Machine machine, Processor proc) {
+  Machine::MemoryQuery zc_query(machine);
+  zc_query.only_kind(Memory::Z_COPY_MEM);
+  zc_query.has_affinity_to(proc);
+  if (zc_query.count() > 0) {
+    assert(zc_query.count() == 1);
+    return *(zc_query.begin());
+  }
+  Machine::MemoryQuery sys_query(machine);
+  sys_query.only_kind(Memory::SYSTEM_MEM);
+  sys_query.has_affinity_to(proc);
+  assert(sys_query.count() == 1);
+  return *(sys_query.begin());
+}
+
 FFMapper::FFMapper(MapperRuntime *rt,
                    Machine machine,
                    Processor _local,
                    char const *_mapper_name,
                    // const std::string& strategyFile,
                    bool _enable_control_replication,
-                   bool _log_instance_creation)
+                   bool _log_instance_creation,
+                   bool _profile_task_priorities)
     : NullMapper(rt, machine), local_processor(_local),
       node_id(_local.address_space()), mapper_name(_mapper_name),
       enable_control_replication(_enable_control_replication),
-      log_instance_creation(_log_instance_creation) {
+      log_instance_creation(_log_instance_creation),
+      profile_task_priorities(_profile_task_priorities),
+      max_measured_task_runtime(0.0), pool_epoch(0), pool_iteration(0) {
   std::vector<Machine::ProcessorMemoryAffinity> proc_mem_affinities;
   machine.get_proc_mem_affinity(proc_mem_affinities);
   Machine::ProcessorQuery proc_query(machine);
@@ -94,20 +113,19 @@ FFMapper::FFMapper(MapperRuntime *rt,
       all_cpus.push_back(*it);
       if (it->address_space() == node_id)
         local_cpus.push_back(*it);
-      Machine::MemoryQuery zc_query(machine);
-      zc_query.only_kind(Memory::Z_COPY_MEM);
-      zc_query.has_affinity_to(*it);
-      assert(zc_query.count() == 1);
-      proc_zcmems[*it] = *(zc_query.begin());
+      proc_zcmems[*it] = find_host_memory(machine, *it);
+#ifdef FF_USE_CPU
+      // CPUs are the workers and keep operator regions in system memory
+      all_gpus.push_back(*it);
+      if (it->address_space() == node_id)
+        local_gpus.push_back(*it);
+      proc_fbmems[*it] = proc_zcmems[*it];
+#endif
     } else if (it->kind() == Processor::PY_PROC) {
       all_pys.push_back(*it);
       if (it->address_space() == node_id)
         local_pys.push_back(*it);
-      Machine::MemoryQuery zc_query(machine);
-      zc_query.only_kind(Memory::Z_COPY_MEM);
-      zc_query.has_affinity_to(*it);
-      assert(zc_query.count() == 1);
-      proc_zcmems[*it] = *(zc_query.begin());
+      proc_zcmems[*it] = find_host_memory(machine, *it);
     }
   }
   total_nodes = address_space_set.size();
@@ -243,12 +261,33 @@ bool FFMapper::is_parameter_server_update_task(TaskID tid) {
   switch (tid) {
     case SGD_UPD_PS_TASK_ID:
     case ADAM_UPD_PS_TASK_ID:
+    // the sparse updates are single tasks only when pushed to the server
+    case SGD_SPARSE_UPD_TASK_ID:
+    case ADAM_SPARSE_UPD_TASK_ID:
       return true;
     default:
       return false;
   }
 }
 
+int FFMapper::get_task_priority(Task const &task) {
+  // Priorities are computed by the simulator along the critical path of the
+  // chosen strategy and passed through the launcher's map_arg
+  if (task.mapper_data_size != sizeof(int)) {
+    return 0;
+  }
+  int priority = *((int const *)task.mapper_data);
+  if (profile_task_priorities && max_measured_task_runtime > 0.0) {
+    // Among tasks of similar criticality, run the longer ones first
+    auto it = measured_task_runtimes.find(compute_task_hash(task));
+    if (it != measured_task_runtimes.end()) {
+      priority += (int)(0.1 * MAX_TASK_PRIORITY * it->second /
+                        max_measured_task_runtime);
+    }
+  }
+  return priority;
+}
+
 bool FFMapper::is_initializer_task(TaskID tid) {
   switch (tid) {
     case GLOROT_INIT_TASK_ID:
@@ -501,8 +540,12 @@ void FFMapper::map_task(const MapperContext ctx,
   // Currently assume there is exactly one variant
   assert(variant_ids.size() == 1);
   output.chosen_variant = variant_ids[0];
-  // TODO: assign priorities
-  output.task_priority = 0;
+  output.task_priority = get_task_priority(task);
+  // Only tasks carrying a priority from the strategy are profiled
+  if (profile_task_priorities && task.mapper_data_size == sizeof(int)) {
+    output.task_prof_requests
+        .add_measurement<ProfilingMeasurements::OperationTimeline>();
+  }
   output.postmap_task = false;
   if (task.target_proc.address_space() != node_id) {
     assert(false);
@@ -513,7 +556,12 @@ void FFMapper::map_task(const MapperContext ctx,
     // Put any of our CPU procs here
     // If we're part of a must epoch launch, our
     // target proc will be sufficient
-    if (!task.must_epoch_task)
+    bool keep_target_proc = task.must_epoch_task;
+#ifdef FF_USE_CPU
+    // Operator tasks stay on the worker chosen by their machine view
+    keep_target_proc = keep_target_proc || task.is_index_space;
+#endif
+    if (!keep_target_proc)
       output.target_procs.insert(
           output.target_procs.end(), local_cpus.begin(), local_cpus.end());
     else
@@ -609,14 +657,37 @@ void FFMapper::map_task(const MapperContext ctx,
     size_t footprint;
     PhysicalInstance result;
     bool created;
-    if (!default_make_instance(ctx,
-                               target_mem,
-                               constraint_set,
-                               result,
-                               true /*meet_constraints*/,
-                               task.regions[idx],
-                               created,
-                               &footprint)) {
+    if (reuse_stale_instance(ctx,
+                             target_mem,
+                             constraint_set,
+                             task.regions[idx],
+                             result,
+                             footprint)) {
+      output.chosen_instances[idx].push_back(result);
+      continue;
+    }
+    bool allocated = default_make_instance(ctx,
+                                           target_mem,
+                                           constraint_set,
+                                           result,
+                                           true /*meet_constraints*/,
+                                           task.regions[idx],
+                                           created,
+                                           &footprint);
+    if (!allocated &&
+        release_stale_instances(ctx, target_mem, footprint) > 0) {
+      // Retry after allowing Legion to collect pooled instances
+      allocated = default_make_instance(ctx,
+                                        target_mem,
+                                        constraint_set,
+                                        result,
+                                        true /*meet_constraints*/,
+                                        task.regions[idx],
+                                        created,
+                                        &footprint);
+    }
+    if (!allocated) {
+      report_instance_pools(ctx);
       if (log_instance_creation) {
         for (size_t idx = 0; idx < created_instances.size(); idx++) {
           log_ff_mapper.print("Instance[%zu]: memory:" IDFMT "	proc:" IDFMT
@@ -643,6 +714,7 @@ void FFMapper::map_task(const MapperContext ctx,
       assert(false);
     } else {
       output.chosen_instances[idx].push_back(result);
+      record_instance(ctx, target_mem, result, footprint, created);
     }
     if (log_instance_creation && created) {
       // Log instance creation
@@ -849,7 +921,25 @@ void FFMapper::speculate(const MapperContext ctx,
 void FFMapper::report_profiling(const MapperContext ctx,
                                 Task const &task,
                                 TaskProfilingInfo const &input) {
-  assert(false);
+  assert(profile_task_priorities);
+  ProfilingMeasurements::OperationTimeline *timeline =
+      input.profiling_responses
+          .get_measurement<ProfilingMeasurements::OperationTimeline>();
+  if (timeline == NULL) {
+    return;
+  }
+  double runtime = (timeline->end_time - timeline->start_time) * 1e-3;
+  delete timeline;
+  // Exponential moving average over iterations
+  unsigned long long task_hash = compute_task_hash(task);
+  auto it = measured_task_runtimes.find(task_hash);
+  if (it == measured_task_runtimes.end()) {
+    measured_task_runtimes[task_hash] = runtime;
+  } else {
+    it->second = 0.8 * it->second + 0.2 * runtime;
+    runtime = it->second;
+  }
+  max_measured_task_runtime = std::max(max_measured_task_runtime, runtime);
 }
 
 void FFMapper::select_sharding_functor(const MapperContext ctx,
@@ -972,6 +1062,7 @@ void FFMapper::map_inline(const MapperContext ctx,
     assert(false);
   } else {
     output.chosen_instances.push_back(result);
+    record_instance(ctx, target_memory, result, footprint, created);
   }
 }
 
@@ -1206,7 +1297,267 @@ void FFMapper::select_tunable_value(const MapperContext ctx,
                                     Task const &task,
                                     SelectTunableInput const &input,
                                     SelectTunableOutput &output) {
-  assert(false);
+  switch (input.tunable_id) {
+    case FF_TUNABLE_RELEASE_INSTANCE_POOLS: {
+      release_instance_pools(ctx);
+      break;
+    }
+    case FF_TUNABLE_REPORT_INSTANCE_POOLS: {
+      report_instance_pools(ctx);
+      break;
+    }
+    default:
+      assert(false);
+  }
+  // Every other mapper manages the pools of its own processor
+  runtime->broadcast(ctx, &pool_epoch, sizeof(int), input.tunable_id);
+  int *value = (int *)malloc(sizeof(int));
+  *value = pool_epoch;
+  output.value = value;
+  output.size = sizeof(int);
+  output.take_ownership = true;
+}
+
+void FFMapper::handle_message(const MapperContext ctx,
+                              MapperMessage const &message) {
+  switch (message.kind) {
+    case FF_TUNABLE_RELEASE_INSTANCE_POOLS: {
+      release_instance_pools(ctx);
+      break;
+    }
+    case FF_TUNABLE_REPORT_INSTANCE_POOLS: {
+      report_instance_pools(ctx);
+      break;
+    }
+    default:
+      assert(false);
+  }
+}
+
+void InstancePool::mark_stale(PooledInstance &pi) {
+  assert(!pi.stale);
+  pi.stale = true;
+  live_bytes -= pi.size;
+  stale_bytes += pi.size;
+  stale_by_size[pi.size].push_back(pi.instance.get_instance_id());
+}
+
+void FFMapper::record_instance(MapperContext ctx,
+                               Memory memory,
+                               PhysicalInstance const &instance,
+                               size_t size,
+                               bool created) {
+  InstancePool &pool = instance_pools[memory];
+  pool.num_requests++;
+  if (!created) {
+    pool.num_reused++;
+    // An instance released with a previous strategy is in use again
+    auto it = pool.instances.find(instance.get_instance_id());
+    if (it != pool.instances.end() && it->second.stale) {
+      it->second.stale = false;
+      it->second.epoch = pool_epoch;
+      pool.stale_bytes -= it->second.size;
+      pool.live_bytes += it->second.size;
+      runtime->set_garbage_collection_priority(
+          ctx, instance, LEGION_GC_NEVER_PRIORITY);
+    }
+    return;
+  }
+  PooledInstance pi;
+  pi.instance = instance;
+  pi.size = size;
+  pi.epoch = pool_epoch;
+  pi.stale = false;
+  pool.instances[instance.get_instance_id()] = pi;
+  pool.live_bytes += size;
+  pool.peak_bytes = std::max(pool.peak_bytes, pool.live_bytes);
+  pool.iteration_peak_bytes =
+      std::max(pool.iteration_peak_bytes, pool.live_bytes);
+}
+
+bool FFMapper::reuse_stale_instance(MapperContext ctx,
+                                    Memory memory,
+                                    LayoutConstraintSet const &constraints,
+                                    RegionRequirement const &req,
+                                    PhysicalInstance &result,
+                                    size_t &footprint) {
+  auto const &pit = instance_pools.find(memory);
+  if (pit == instance_pools.end()) {
+    return false;
+  }
+  InstancePool &pool = pit->second;
+  // FlexFlow instances are dense, so the footprint of the new instance is
+  // its volume times the size of its fields
+  Domain domain =
+      runtime->get_index_space_domain(ctx, req.region.get_index_space());
+  size_t field_size = 0;
+  for (FieldID fid : req.privilege_fields) {
+    field_size +=
+        runtime->get_field_size(ctx, req.region.get_field_space(), fid);
+  }
+  size_t size = domain.get_volume() * field_size;
+  auto const &bucket = pool.stale_by_size.find(size);
+  if (bucket == pool.stale_by_size.end()) {
+    return false;
+  }
+  std::vector<LogicalRegion> regions(1, req.region);
+  while (!bucket->second.empty()) {
+    unsigned long id = bucket->second.back();
+    bucket->second.pop_back();
+    auto const &it = pool.instances.find(id);
+    if (it == pool.instances.end() || !it->second.stale) {
+      continue;
+    }
+    PooledInstance pi = it->second;
+    pool.instances.erase(it);
+    pool.stale_bytes -= pi.size;
+    // Fails if Legion collected the instance or it is still in use
+    if (!runtime->redistrict_instance(ctx,
+                                      pi.instance,
+                                      constraints,
+                                      regions,
+                                      true /*acquire*/,
+                                      LEGION_GC_NEVER_PRIORITY)) {
+      continue;
+    }
+    pi.stale = false;
+    pi.epoch = pool_epoch;
+    pool.instances[pi.instance.get_instance_id()] = pi;
+    pool.live_bytes += pi.size;
+    pool.num_requests++;
+    pool.num_reused++;
+    result = pi.instance;
+    footprint = pi.size;
+    return true;
+  }
+  return false;
+}
+
+void FFMapper::release_instance_pools(MapperContext ctx) {
+  // The strategy changed, so none of the existing instances are expected to
+  // be used again; let Legion collect them before anything else
+  pool_epoch++;
+  for (auto &it : instance_pools) {
+    InstancePool &pool = it.second;
+    for (auto &it2 : pool.instances) {
+      PooledInstance &pi = it2.second;
+      if (!pi.stale) {
+        runtime->set_garbage_collection_priority(
+            ctx, pi.instance, LEGION_GC_FIRST_PRIORITY);
+        pool.mark_stale(pi);
+      }
+    }
+  }
+}
+
+size_t FFMapper::release_stale_instances(MapperContext ctx,
+                                         Memory memory,
+                                         size_t required_size) {
+  if (instance_pools.find(memory) == instance_pools.end()) {
+    return 0;
+  }
+  InstancePool &pool = instance_pools[memory];
+  // Make live instances collectable as well, the smallest ones that fit the
+  // failed request first and then the largest ones below it, so that the
+  // freed block is likely to fit it. Legion never collects an instance
+  // holding the only valid copy of data
+  std::vector<PooledInstance *> order;
+  for (auto &it : pool.instances) {
+    if (!it.second.stale) {
+      order.push_back(&it.second);
+    }
+  }
+  std::sort(order.begin(),
+            order.end(),
+            [&](PooledInstance const *a, PooledInstance const *b) {
+              bool a_fits = a->size >= required_size;
+              bool b_fits = b->size >= required_size;
+              if (a_fits != b_fits) {
+                return a_fits;
+              }
+              return a_fits ? a->size < b->size : a->size > b->size;
+            });
+  size_t released = 0;
+  for (PooledInstance *pi : order) {
+    if (released >= required_size) {
+      break;
+    }
+    runtime->set_garbage_collection_priority(
+        ctx, pi->instance, LEGION_GC_FIRST_PRIORITY);
+    pool.mark_stale(*pi);
+    released += pi->size;
+  }
+  // Stale instances are not acquired here since acquired instances cannot
+  // be collected for the retry, so this is an upper bound since some of them
+  // may already be gone
+  return pool.stale_bytes;
+}
+
+void FFMapper::prune_collected_instances(MapperContext ctx,
+                                         InstancePool &pool) {
+  // Forget the stale instances Legion has already collected. Acquiring can
+  // re-enter the mapper, which may change the pool, so the candidates are
+  // collected first and looked up again after each acquire
+  std::vector<std::pair<unsigned long, PhysicalInstance>> stale;
+  for (auto const &it : pool.instances) {
+    if (it.second.stale) {
+      stale.push_back(std::make_pair(it.first, it.second.instance));
+    }
+  }
+  for (auto const &it : stale) {
+    if (runtime->acquire_instance(ctx, it.second)) {
+      continue;
+    }
+    auto const &pi = pool.instances.find(it.first);
+    if (pi != pool.instances.end() && pi->second.stale) {
+      pool.stale_bytes -= pi->second.size;
+      pool.instances.erase(pi);
+    }
+  }
+  for (auto it = pool.stale_by_size.begin();
+       it != pool.stale_by_size.end();) {
+    std::vector<unsigned long> &ids = it->second;
+    ids.erase(std::remove_if(ids.begin(),
+                             ids.end(),
+                             [&](unsigned long id) {
+                               auto const &pi = pool.instances.find(id);
+                               return pi == pool.instances.end() ||
+                                      !pi->second.stale;
+                             }),
+              ids.end());
+    if (ids.empty()) {
+      it = pool.stale_by_size.erase(it);
+    } else {
+      it++;
+    }
+  }
+}
+
+void FFMapper::report_instance_pools(MapperContext ctx) {
+  for (auto &it : instance_pools) {
+    InstancePool &pool = it.second;
+    prune_collected_instances(ctx, pool);
+    size_t pooled_bytes = pool.live_bytes + pool.stale_bytes;
+    log_ff_mapper.print(
+        "Memory pool iteration %d: memory " IDFMT " proc " IDFMT
+        " live %.2lf MB peak %.2lf MB (overall %.2lf MB)"
+        " fragmentation %.2lf%% reuse %.2lf%% (%zu/%zu)",
+        pool_iteration,
+        it.first.id,
+        local_processor.id,
+        pool.live_bytes / 1024.0 / 1024.0,
+        pool.iteration_peak_bytes / 1024.0 / 1024.0,
+        pool.peak_bytes / 1024.0 / 1024.0,
+        pooled_bytes == 0 ? 0.0 : 100.0 * pool.stale_bytes / pooled_bytes,
+        pool.num_requests == 0 ? 0.0
+                               : 100.0 * pool.num_reused / pool.num_requests,
+        pool.num_reused,
+        pool.num_requests);
+    pool.iteration_peak_bytes = pool.live_bytes;
+    pool.num_requests = 0;
+    pool.num_reused = 0;
+  }
+  pool_iteration++;
 }
 
 void FFMapper::select_sharding_functor(const MapperContext ctx,
@@ -1517,6 +1868,7 @@ void FFMapper::update_mappers(Machine machine,
   int argc = command_args.argc;
   bool enable_control_replication = false;
   bool log_instance_creation = false;
+  bool profile_task_priorities = false;
   for (int i = 1; i < argc; i++) {
     // if ((!strcmp(argv[i], "--import")) || (!strcmp(argv[i],
     // "--import-strategy"))) {
@@ -1531,6 +1883,10 @@ void FFMapper::update_mappers(Machine machine,
       log_instance_creation = true;
       continue;
     }
+    if (!strcmp(argv[i], "--profile-task-priorities")) {
+      profile_task_priorities = true;
+      continue;
+    }
   }
 
   for (std::set<Processor>::const_iterator it = local_procs.begin();
@@ -1541,7 +1897,8 @@ void FFMapper::update_mappers(Machine machine,
                                     *it,
                                     "FlexFlow Mapper",
                                     enable_control_replication,
-                                    log_instance_creation);
+                                    log_instance_creation,
+                                    profile_task_priorities);
     runtime->replace_default_mapper(mapper, *it);
   }
 }
@@ -0,0 +1,134 @@
+/* Copyright 2020 Stanford
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flexflow/model.h"
+#include "flexflow/utils/cpu_helper.h"
+#include <cmath>
+
+namespace FlexFlow {
+
+float const LOG_MIN_VALUE = 0.00000001f;
+
+void Metrics::update_metrics_sparse_label_kernel_wrapper(
+    float const *logits,
+    int const *labels,
+    Metrics const *me,
+    int num_effective_samples,
+    int num_classes,
+    PerfMetrics &perf) {
+  CPU_KERNEL_LOOP(b, num_effective_samples) {
+    if (me->measure_accuracy) {
+      float max_val = -1.0f;
+      int my_label = -1;
+      for (int i = 0; i < num_classes; i++) {
+        float my_logit = logits[b * num_classes + i];
+        if (my_logit > max_val) {
+          max_val = my_logit;
+          my_label = i;
+        }
+      }
+      assert(my_label >= 0);
+      perf.train_all += 1;
+      if (labels[b] == my_label)
+        perf.train_correct += 1;
+    }
+    if (me->measure_sparse_categorical_crossentropy) {
+      float my_logit =
+          std::max(logits[b * num_classes + labels[b]], LOG_MIN_VALUE);
+      perf.sparse_cce_loss += -logf(my_logit);
+    }
+    if (me->measure_mean_squared_error ||
+        me->measure_root_mean_squared_error ||
+        me->measure_mean_absolute_error) {
+      float mse = 0.0f, mae = 0.0f;
+      for (int i = 0; i < num_classes; i++) {
+        float my_logit = logits[b * num_classes + i];
+        float my_label = (labels[b] == i) ? 1.0f : 0.0f;
+        mse += (my_logit - my_label) * (my_logit - my_label);
+        mae += fabsf(my_logit - my_label);
+      }
+      if (me->measure_mean_squared_error)
+        perf.mse_loss += mse;
+      if (me->measure_root_mean_squared_error)
+        perf.rmse_loss += sqrtf(mse);
+      if (me->measure_mean_absolute_error)
+        perf.mae_loss += mae;
+    }
+  }
+}
+
+void Metrics::update_metrics_label_kernel_wrapper(float const *logits,
+                                                  float const *labels,
+                                                  Metrics const *me,
+                                                  int num_samples,
+                                                  int num_classes,
+                                                  PerfMetrics &perf) {
+  CPU_KERNEL_LOOP(b, num_samples) {
+    perf.train_all += 1;
+    if (me->measure_accuracy) {
+      if (num_classes == 1) {
+        // accuracy does not make sense when num_classes = 1
+        // we just return 100%
+        perf.train_all += 1;
+        perf.train_correct += 1;
+      } else {
+        float max_val = 0.0f;
+        int my_label = -1, true_label = -1;
+        for (int i = 0; i < num_classes; i++) {
+          if (my_label == -1 || logits[b * num_classes + i] > max_val) {
+            max_val = logits[b * num_classes + i];
+            my_label = i;
+          }
+          if (labels[b * num_classes + i] > 0.9f) {
+            assert(true_label == -1);
+            true_label = i;
+          }
+        }
+        assert(my_label >= 0);
+        assert(true_label >= 0);
+        if (true_label == my_label)
+          perf.train_correct += 1;
+      }
+    }
+    if (me->measure_categorical_crossentropy) {
+      float cce = 0.0f;
+      for (int i = 0; i < num_classes; i++) {
+        if (labels[b * num_classes + i] > 0.0f) {
+          float my_logit = std::max(logits[b * num_classes + i], LOG_MIN_VALUE);
+          cce += labels[b * num_classes + i] * -logf(my_logit);
+        }
+      }
+      perf.cce_loss += cce;
+    }
+    if (me->measure_mean_squared_error ||
+        me->measure_root_mean_squared_error ||
+        me->measure_mean_absolute_error) {
+      float mse = 0.0f, mae = 0.0f;
+      for (int i = 0; i < num_classes; i++) {
+        float diff = logits[b * num_classes + i] - labels[b * num_classes + i];
+        mse += diff * diff;
+        mae += fabsf(diff);
+      }
+      if (me->measure_mean_squared_error)
+        perf.mse_loss += mse;
+      if (me->measure_root_mean_squared_error)
+        perf.rmse_loss += sqrtf(mse);
+      if (me->measure_mean_absolute_error)
+        perf.mae_loss += mae;
+    }
+  }
+}
+
+}; // namespace FlexFlow
@@ -142,6 +142,7 @@ void AggregateSpec::forward(FFModel const &ff) {
                          false /*must*/,
                          0 /*mapper_id*/,
                          outputs[0]->machine_view.hash());
+  set_priority_for_forward(launcher);
   // gate_preds
   launcher.add_region_requirement(RegionRequirement(inputs[0]->part,
                                                     0 /*projection id*/,
@@ -250,6 +251,7 @@ void AggregateSpec::backward(FFModel const &ff) {
                          false /*must*/,
                          0 /*mapper_id*/,
                          outputs[0]->machine_view.hash());
+  set_priority_for_backward(launcher);
 
   // gate_preds
   launcher.add_region_requirement(RegionRequirement(inputs[0]->part,
@@ -48,7 +48,8 @@ Tensor FFModel::multihead_attention(const Tensor query,
                                     bool add_bias_kv,
                                     bool add_zero_attn,
                                     Initializer *kernel_initializer,
-                                    char const *name) {
+                                    char const *name,
+                                    bool causal) {
   Layer *li = new Layer(this,
                         OP_MULTIHEAD_ATTENTION,
                         name,
@@ -93,6 +94,7 @@ Tensor FFModel::multihead_attention(const Tensor query,
   li->add_int_property("bias", bias);
   li->add_int_property("add_bias_kv", add_bias_kv);
   li->add_int_property("add_zero_attn", add_zero_attn);
+  li->add_int_property("causal", causal);
   li->add_float_property("dropout", dropout);
   layers.push_back(li);
   return li->outputs[0];
@@ -119,6 +121,8 @@ Op *MultiHeadAttention::create_operator_from_layer(
   bool add_bias_kv = (bool)value;
   layer->get_int_property("add_zero_attn", value);
   bool add_zero_attn = (bool)value;
+  layer->get_int_property("causal", value);
+  bool causal = (bool)value;
   return new MultiHeadAttention(model,
                                 layer->layer_guid,
                                 inputs[0],
@@ -132,6 +136,7 @@ Op *MultiHeadAttention::create_operator_from_layer(
                                 bias,
                                 add_bias_kv,
                                 add_zero_attn,
+                                causal,
                                 false /*allocate_weights*/,
                                 layer->name);
 }
@@ -146,6 +151,7 @@ size_t MultiHeadAttention::get_params_hash() const {
   hash_combine(hash0, this->bias);
   hash_combine(hash0, this->add_bias_kv);
   hash_combine(hash0, this->add_zero_attn);
+  hash_combine(hash0, this->causal);
   hash_combine(hash0, this->qProjSize);
   hash_combine(hash0, this->kProjSize);
   hash_combine(hash0, this->vProjSize);
@@ -166,6 +172,7 @@ MultiHeadAttention::MultiHeadAttention(FFModel &model,
                                        bool _bias,
                                        bool _add_bias_kv,
                                        bool _add_zero_attn,
+                                       bool _causal,
                                        bool allocate_weights,
                                        char const *name)
     // Initializer* _bias_initializer)
@@ -180,6 +187,7 @@ MultiHeadAttention::MultiHeadAttention(FFModel &model,
          _value),
       num_heads(_num_heads), dropout(_dropout), bias(_bias),
       add_bias_kv(_add_bias_kv), add_zero_attn(_add_zero_attn),
+      causal(_causal),
       qSize(_query->dims[0].size), kSize(_key->dims[0].size),
       vSize(_value->dims[0].size), qProjSize(_kdim), kProjSize(_kdim),
       vProjSize(_vdim), oProjSize(_embed_dim),
@@ -253,6 +261,7 @@ MultiHeadAttention::MultiHeadAttention(FFModel &model,
                                        bool _bias,
                                        bool _add_bias_kv,
                                        bool _add_zero_attn,
+                                       bool _causal,
                                        bool allocate_weights,
                                        char const *name)
     // Initializer* _bias_initializer)
@@ -268,6 +277,7 @@ MultiHeadAttention::MultiHeadAttention(FFModel &model,
          _weight),
       num_heads(_num_heads), dropout(_dropout), bias(_bias),
       add_bias_kv(_add_bias_kv), add_zero_attn(_add_zero_attn),
+      causal(_causal),
       qSize(_query->dims[0].size), kSize(_key->dims[0].size),
       vSize(_value->dims[0].size), qProjSize(_kdim), kProjSize(_kdim),
       vProjSize(_vdim), oProjSize(_embed_dim),
@@ -346,6 +356,7 @@ MultiHeadAttention::MultiHeadAttention(FFModel &model,
                          other.bias,
                          other.add_bias_kv,
                          other.add_zero_attn,
+                         other.causal,
                          allocate_weights,
                          other.name) {}
 
@@ -443,7 +454,7 @@ OpMeta *
   assert(attn->oProjSize == acc_output.rect.hi[0] - acc_output.rect.lo[0] + 1);
 
   Memory gpu_mem = Machine::MemoryQuery(Machine::get_machine())
-                       .only_kind(Memory::GPU_FB_MEM)
+                       .only_kind(WORKER_MEM_KIND)
                        .best_affinity_to(task->target_proc)
                        .first();
   MultiHeadAttentionMeta *m =
@@ -453,20 +464,38 @@ OpMeta *
   return m;
 }
 
+// The iteration config followed by the sample lengths set on the model, so
+// that a launch only carries the lengths that were set
+static std::vector<char> get_iter_config_args(FFModel const &ff) {
+  FFIterationConfig const &iter_config = ff.iter_config;
+  assert(iter_config.num_sample_seq_lengths ==
+         (int)ff.sample_seq_lengths.size());
+  std::vector<char> args(sizeof(FFIterationConfig) +
+                         ff.sample_seq_lengths.size() * sizeof(int));
+  memcpy(args.data(), &iter_config, sizeof(FFIterationConfig));
+  memcpy(args.data() + sizeof(FFIterationConfig),
+         ff.sample_seq_lengths.data(),
+         ff.sample_seq_lengths.size() * sizeof(int));
+  return args;
+}
+
 void MultiHeadAttention::forward(FFModel const &ff) {
   ArgumentMap argmap;
   Context ctx = ff.config.lg_ctx;
   Runtime *runtime = ff.config.lg_hlr;
   set_argumentmap_for_forward(ff, argmap);
   int idx = 0;
-  IndexLauncher launcher(ATTENTION_FWD_TASK_ID,
-                         parallel_is,
-                         TaskArgument(NULL, 0),
-                         argmap,
-                         Predicate::TRUE_PRED,
-                         false /*must*/,
-                         0 /*mapper_id*/,
-                         outputs[0]->machine_view.hash());
+  std::vector<char> args = get_iter_config_args(ff);
+  IndexLauncher launcher(
+      ATTENTION_FWD_TASK_ID,
+      parallel_is,
+      TaskArgument(args.data(), args.size()),
+      argmap,
+      Predicate::TRUE_PRED,
+      false /*must*/,
+      0 /*mapper_id*/,
+      outputs[0]->machine_view.hash());
+  set_priority_for_forward(launcher);
   launcher.add_region_requirement(RegionRequirement(inputs[0]->part,
                                                     0 /*projection id*/,
                                                     READ_ONLY,
@@ -500,6 +529,24 @@ void MultiHeadAttention::forward(FFModel const &ff) {
   runtime->execute_index_space(ctx, launcher);
 }
 
+// Valid lengths of the samples in a task's query rect, starting from the
+// first sample it owns, or -1 for samples that are not padded
+static std::vector<int> get_seq_lengths(Task const *task,
+                                        Rect<4> const &query_rect) {
+  assert(task->arglen >= sizeof(FFIterationConfig));
+  FFIterationConfig const *iter_config = (FFIterationConfig const *)task->args;
+  int num_sample_seq_lengths = iter_config->num_sample_seq_lengths;
+  assert(task->arglen ==
+         sizeof(FFIterationConfig) + num_sample_seq_lengths * sizeof(int));
+  int const *sample_seq_lengths = (int const *)(iter_config + 1);
+  std::vector<int> seq_lengths;
+  for (coord_t b = query_rect.lo[2]; b <= query_rect.hi[2]; b++) {
+    seq_lengths.push_back(b < num_sample_seq_lengths ? sample_seq_lengths[b]
+                                                     : iter_config->seq_length);
+  }
+  return seq_lengths;
+}
+
 /*
   regions[0](I): query
   regions[1](I): key
@@ -531,13 +578,15 @@ void MultiHeadAttention::forward_task(
                                        ctx,
                                        runtime,
                                        false /*readOutput*/);
+  std::vector<int> seq_lengths = get_seq_lengths(task, acc_query.rect);
 
   MultiHeadAttention::forward_kernel_wrapper(m,
                                              acc_query.ptr,
                                              acc_key.ptr,
                                              acc_value.ptr,
                                              acc_weight.ptr,
-                                             acc_output.ptr);
+                                             acc_output.ptr,
+                                             seq_lengths.data());
 }
 
 void MultiHeadAttention::backward(FFModel const &ff) {
@@ -545,14 +594,17 @@ void MultiHeadAttention::backward(FFModel const &ff) {
   Context ctx = ff.config.lg_ctx;
   Runtime *runtime = ff.config.lg_hlr;
   set_argumentmap_for_backward(ff, argmap);
-  IndexLauncher launcher(ATTENTION_BWD_TASK_ID,
-                         parallel_is,
-                         TaskArgument(NULL, 0),
-                         argmap,
-                         Predicate::TRUE_PRED,
-                         false /*must*/,
-                         0 /*mapper_id*/,
-                         outputs[0]->machine_view.hash());
+  std::vector<char> args = get_iter_config_args(ff);
+  IndexLauncher launcher(
+      ATTENTION_BWD_TASK_ID,
+      parallel_is,
+      TaskArgument(args.data(), args.size()),
+      argmap,
+      Predicate::TRUE_PRED,
+      false /*must*/,
+      0 /*mapper_id*/,
+      outputs[0]->machine_view.hash());
+  set_priority_for_backward(launcher);
   launcher.add_region_requirement(RegionRequirement(inputs[0]->part,
                                                     0 /*projection id*/,
                                                     READ_ONLY,
@@ -701,6 +753,7 @@ void MultiHeadAttention::backward_task(
     value_grad_ptr = acc_value_grad.ptr;
     key_grad_ptr = acc_key_grad.ptr;
   }
+  std::vector<int> seq_lengths = get_seq_lengths(task, acc_query.rect);
 
   MultiHeadAttention::backward_kernel_wrapper(m,
                                               acc_query.ptr,
@@ -711,7 +764,8 @@ void MultiHeadAttention::backward_task(
                                               value_grad_ptr,
                                               acc_weight.ptr,
                                               acc_weight_grad.ptr,
-                                              acc_output_grad.ptr);
+                                              acc_output_grad.ptr,
+                                              seq_lengths.data());
 }
 
 bool MultiHeadAttention::get_int_parameter(PMParameter para, int *value) const {
@@ -767,6 +821,10 @@ bool MultiHeadAttention::measure_operator_cost(
   float *output_ptr = (float *)sim->allocate(sub_output.get_volume(), DT_FLOAT);
   assert(output_ptr != NULL);
   cost_metrics.outputs_memory += cost_metrics.total_mem_diff_from(sim->offset);
+  // The meta allocates the reserve space (the projected queries, keys and
+  // values and the attention output kept for backward) outside the
+  // simulator, so it is added by hand; it lives as long as the output
+  cost_metrics.outputs_memory += m->reserveSpaceSize;
 
   float const *weight_ptr = (float const *)sim->allocate(num_weights, DT_FLOAT);
   cost_metrics.weights_memory += cost_metrics.total_mem_diff_from(sim->offset);
@@ -854,6 +912,69 @@ bool MultiHeadAttention::measure_operator_cost(
   return true;
 }
 
+// The weights of each head are packed as Wq (qProjSize x qSize),
+// Wk (kProjSize x kSize), Wv (vProjSize x vSize) and Wo (oProjSize x
+// vProjSize), all row-major
+size_t MultiHeadAttentionMeta::head_weight_size() const {
+  return (size_t)qProjSize * qSize + (size_t)kProjSize * kSize +
+         (size_t)vProjSize * vSize + (size_t)oProjSize * vProjSize;
+}
+
+// The reserve space of each (sample, head) pair keeps the projected
+// queries, keys and values, the attention output before the output
+// projection and the log-sum-exp of every query's scores, which is all the
+// backward pass needs to recompute the attention probabilities tile by tile
+size_t MultiHeadAttentionMeta::head_reserve_size() const {
+  return (size_t)qoSeqLength * qProjSize + (size_t)kvSeqLength * kProjSize +
+         (size_t)kvSeqLength * vProjSize + (size_t)qoSeqLength * vProjSize +
+         (size_t)qoSeqLength;
+}
+
+MultiHeadAttentionMeta::MultiHeadAttentionMeta(FFHandler handler,
+                                               MultiHeadAttention const *attn,
+                                               Memory gpu_mem,
+                                               int num_samples,
+                                               int num_heads)
+    : OpMeta(handler), num_samples(num_samples), num_heads(num_heads) {
+  // Currently do not support adding bias to key/value projection
+  assert(!attn->add_bias_kv);
+  assert(attn->qProjSize > 0 && attn->kProjSize > 0 && attn->vProjSize > 0);
+  assert(attn->qProjSize == attn->kProjSize);
+  qSize = attn->qSize;
+  kSize = attn->kSize;
+  vSize = attn->vSize;
+  qProjSize = attn->qProjSize;
+  kProjSize = attn->kProjSize;
+  vProjSize = attn->vProjSize;
+  oProjSize = attn->oProjSize;
+  qoSeqLength = attn->qoSeqLength;
+  kvSeqLength = attn->kvSeqLength;
+  causal = attn->causal;
+  weightSize = head_weight_size() * num_heads * sizeof(float);
+  reserveSpaceSize =
+      head_reserve_size() * num_heads * num_samples * sizeof(float);
+  // allocate memory for the reserve space
+  {
+    Realm::Rect<1, coord_t> bounds(
+        Realm::Point<1, coord_t>(0),
+        Realm::Point<1, coord_t>(reserveSpaceSize - 1));
+    std::vector<size_t> field_sizes;
+    field_sizes.push_back(sizeof(char));
+    Realm::RegionInstance::create_instance(reserveInst,
+                                           gpu_mem,
+                                           bounds,
+                                           field_sizes,
+                                           0,
+                                           Realm::ProfilingRequestSet())
+        .wait();
+    reserveSpace = reserveInst.pointer_untyped(0, sizeof(char));
+  }
+}
+
+MultiHeadAttentionMeta::~MultiHeadAttentionMeta(void) {
+  reserveInst.destroy();
+}
+
 using PCG::Node;
 
 Node FFModel::get_or_create_multihead_attn_node(LayerID const &layer_guid,
@@ -867,7 +988,8 @@ Node FFModel::get_or_create_multihead_attn_node(LayerID const &layer_guid,
                                                 float dropout,
                                                 bool bias,
                                                 bool add_bias_kv,
-                                                bool add_zero_attn) {
+                                                bool add_zero_attn,
+                                                bool causal) {
   size_t hash = 0;
   hash_combine(hash, layer_guid.id);
   hash_combine(hash, query->get_owner_independent_hash());
@@ -880,6 +1002,7 @@ Node FFModel::get_or_create_multihead_attn_node(LayerID const &layer_guid,
   hash_combine(hash, std::hash<int>()((int)bias));
   hash_combine(hash, std::hash<int>()((int)add_bias_kv));
   hash_combine(hash, std::hash<int>()((int)add_zero_attn));
+  hash_combine(hash, std::hash<int>()((int)causal));
   auto const &it = cached_multihead_attn_ops.find(hash);
   MultiHeadAttention *attn = nullptr;
   if (it != cached_multihead_attn_ops.end()) {
@@ -898,6 +1021,7 @@ Node FFModel::get_or_create_multihead_attn_node(LayerID const &layer_guid,
                                   bias,
                                   add_bias_kv,
                                   add_zero_attn,
+                                  causal,
                                   false /*create_weights*/,
                                   nullptr);
     cached_multihead_attn_ops[hash] = attn;
@@ -30,7 +30,8 @@ void MultiHeadAttention::forward_kernel(MultiHeadAttentionMeta const *m,
                                         float const *value_ptr,
                                         float const *weight_ptr,
                                         float *output_ptr,
-                                        hipStream_t stream) {
+                                        hipStream_t stream,
+                                        int const *seq_lengths) {
 #if 0
   checkCUDNN(miopenSetStream(m->handle.dnn, stream));
 
@@ -50,7 +51,8 @@ void MultiHeadAttention::forward_kernel_wrapper(MultiHeadAttentionMeta const *m,
                                                 float const *key_ptr,
                                                 float const *value_ptr,
                                                 float const *weight_ptr,
-                                                float *output_ptr) {
+                                                float *output_ptr,
+                                                int const *seq_lengths) {
   hipStream_t stream;
   checkCUDA(get_legion_stream(&stream));
 
@@ -60,8 +62,14 @@ void MultiHeadAttention::forward_kernel_wrapper(MultiHeadAttentionMeta const *m,
     hipEventCreate(&t_end);
     hipEventRecord(t_start, stream);
   }
-  MultiHeadAttention::forward_kernel(
-      m, query_ptr, key_ptr, value_ptr, weight_ptr, output_ptr, stream);
+  MultiHeadAttention::forward_kernel(m,
+                                     query_ptr,
+                                     key_ptr,
+                                     value_ptr,
+                                     weight_ptr,
+                                     output_ptr,
+                                     stream,
+                                     seq_lengths);
   if (m->profiling) {
     hipEventRecord(t_end, stream);
     checkCUDA(hipEventSynchronize(t_end));
@@ -87,7 +95,8 @@ void MultiHeadAttention::backward_kernel(MultiHeadAttentionMeta const *m,
                                          float const *weight_ptr,
                                          float *weight_grad_ptr,
                                          float const *output_grad_ptr,
-                                         hipStream_t stream) {
+                                         hipStream_t stream,
+                                         int const *seq_lengths) {
   checkCUDNN(miopenSetStream(m->handle.dnn, stream));
 
 #if 0
@@ -118,7 +127,8 @@ void MultiHeadAttention::backward_kernel_wrapper(
     float *value_grad_ptr,
     float const *weight_ptr,
     float *weight_grad_ptr,
-    float const *output_grad_ptr) {
+    float const *output_grad_ptr,
+    int const *seq_lengths) {
   hipStream_t stream;
   checkCUDA(get_legion_stream(&stream));
 
@@ -139,7 +149,8 @@ void MultiHeadAttention::backward_kernel_wrapper(
                                       weight_ptr,
                                       weight_grad_ptr,
                                       output_grad_ptr,
-                                      stream);
+                                      stream,
+                                      seq_lengths);
   if (m->profiling) {
     hipEventRecord(t_end, stream);
     checkCUDA(hipEventSynchronize(t_end));
@@ -151,140 +162,4 @@ void MultiHeadAttention::backward_kernel_wrapper(
   }
 }
 
-MultiHeadAttentionMeta::MultiHeadAttentionMeta(FFHandler handler,
-                                               MultiHeadAttention const *attn,
-                                               Memory gpu_mem,
-                                               int num_samples,
-                                               int num_heads)
-    : OpMeta(handler) {
-  hipStream_t stream;
-  checkCUDA(get_legion_stream(&stream));
-  checkCUDNN(miopenSetStream(handler.dnn, stream));
-
-#if 0
-  checkCUDNN(cudnnCreateAttnDescriptor(&attnDesc));
-  checkCUDNN(cudnnCreateSeqDataDescriptor(&qDesc));
-  checkCUDNN(cudnnCreateSeqDataDescriptor(&kDesc));
-  checkCUDNN(cudnnCreateSeqDataDescriptor(&vDesc));
-  checkCUDNN(cudnnCreateSeqDataDescriptor(&oDesc));
-  // Currently do not support adding bias to key/value projection
-  assert(!attn->add_bias_kv);
-  cudnnAttnQueryMap_t attnMode = CUDNN_ATTN_QUERYMAP_ALL_TO_ONE;
-  // Assume no beam search for now
-  int maxBeamSize = 1;
-  //printf("batchSize(%d) qSize(%d) kSize(%d) vSize(%d) qProjSize(%d) kProjSize(%d)\n",
-  //    num_samples, attn->qSize, attn->kSize, attn->vSize, attn->qProjSize, attn->kProjSize);
-  //printf("vProjSize(%d) oProjSize(%d) qoSeqLength(%d) kvSeqLength(%d)\n",
-  //    attn->vProjSize, attn->oProjSize, attn->qoSeqLength, attn->kvSeqLength);
-  hipdnnMathType_t math_type;
-  if (handle.allowTensorOpMathConversion) {
-    math_type = CUDNN_TENSOR_OP_MATH_ALLOW_CONVERSION;
-  } else {
-    math_type = HIPDNN_TENSOR_OP_MATH;
-  }
-  checkCUDNN(cudnnSetAttnDescriptor(attnDesc, attnMode, num_heads,
-      1.0f/*smScalar*/, HIPDNN_DATA_FLOAT, HIPDNN_DATA_FLOAT, math_type,
-      NULL/*attnDropoutDesc*/, NULL/*postDropoutDesc*/,
-      attn->qSize, attn->kSize, attn->vSize, attn->qProjSize, attn->kProjSize,
-      attn->vProjSize, attn->oProjSize, attn->qoSeqLength, attn->kvSeqLength,
-      num_samples, maxBeamSize));
-  size_t workSpaceSize;
-  checkCUDNN(cudnnGetMultiHeadAttnBuffers(handler.dnn, attnDesc, &weightSize,
-      &workSpaceSize, &reserveSpaceSize));
-  assert(workSpaceSize <= handler.workSpaceSize);
-  //printf("weightSize(%zu) workSpaceSize(%zu) reserveSpaceSize(%zu)\n", weightSize, workSpaceSize, reserveSpaceSize);
-  int dimA[CUDNN_SEQDATA_DIM_COUNT];
-  cudnnSeqDataAxis_t axes[CUDNN_SEQDATA_DIM_COUNT];
-  assert(CUDNN_SEQDATA_DIM_COUNT == 4);
-  axes[3] = CUDNN_SEQDATA_VECT_DIM; // 3 = nbDims-1
-  axes[2] = CUDNN_SEQDATA_BEAM_DIM;
-  axes[1] = CUDNN_SEQDATA_TIME_DIM;
-  axes[0] = CUDNN_SEQDATA_BATCH_DIM;
-  int *qoSeqArray = (int*) malloc(sizeof(int) * num_samples);
-  int *kvSeqArray = (int*) malloc(sizeof(int) * num_samples);
-  for (int i = 0; i < num_samples; i++) {
-    qoSeqArray[i] = attn->qoSeqLength;
-    kvSeqArray[i] = attn->kvSeqLength;
-  }
-  // Set qDesc
-  {
-    dimA[CUDNN_SEQDATA_BEAM_DIM] = 1;
-    dimA[CUDNN_SEQDATA_BATCH_DIM] = num_samples;
-    dimA[CUDNN_SEQDATA_TIME_DIM] = attn->qoSeqLength;
-    dimA[CUDNN_SEQDATA_VECT_DIM] = attn->qSize;
-    checkCUDNN(cudnnSetSeqDataDescriptor(qDesc,
-        HIPDNN_DATA_FLOAT, CUDNN_SEQDATA_DIM_COUNT, dimA, axes,
-        num_samples, qoSeqArray, NULL));
-  }
-  // Set kDesc
-  {
-    dimA[CUDNN_SEQDATA_BEAM_DIM] = 1;
-    dimA[CUDNN_SEQDATA_BATCH_DIM] = num_samples;
-    dimA[CUDNN_SEQDATA_TIME_DIM] = attn->kvSeqLength;
-    dimA[CUDNN_SEQDATA_VECT_DIM] = attn->kSize;
-    checkCUDNN(cudnnSetSeqDataDescriptor(kDesc,
-        HIPDNN_DATA_FLOAT, CUDNN_SEQDATA_DIM_COUNT, dimA, axes,
-        num_samples, kvSeqArray, NULL));
-  }
-  // Set vDesc
-  {
-    dimA[CUDNN_SEQDATA_BEAM_DIM] = 1;
-    dimA[CUDNN_SEQDATA_BATCH_DIM] = num_samples;
-    dimA[CUDNN_SEQDATA_TIME_DIM] = attn->kvSeqLength;
-    dimA[CUDNN_SEQDATA_VECT_DIM] = attn->vSize;
-    checkCUDNN(cudnnSetSeqDataDescriptor(vDesc,
-        HIPDNN_DATA_FLOAT, CUDNN_SEQDATA_DIM_COUNT, dimA, axes,
-        num_samples, kvSeqArray, NULL));
-  }
-  // Set oDesc
-  {
-    dimA[CUDNN_SEQDATA_BEAM_DIM] = 1;
-    dimA[CUDNN_SEQDATA_BATCH_DIM] = num_samples;
-    dimA[CUDNN_SEQDATA_TIME_DIM] = attn->qoSeqLength;
-    dimA[CUDNN_SEQDATA_VECT_DIM] = attn->oProjSize;
-    checkCUDNN(cudnnSetSeqDataDescriptor(oDesc,
-        HIPDNN_DATA_FLOAT, CUDNN_SEQDATA_DIM_COUNT, dimA, axes,
-        num_samples, qoSeqArray, NULL));
-  }
-  // allocate memory for the seqArray and reserve space
-  {
-    size_t totalSize = reserveSpaceSize + sizeof(int) * num_samples * 2;
-    Realm::Rect<1, coord_t> bounds(Realm::Point<1, coord_t>(0), Realm::Point<1, coord_t>(totalSize-1));
-    std::vector<size_t> field_sizes;
-    field_sizes.push_back(sizeof(char));
-    Realm::RegionInstance::create_instance(reserveInst, gpu_mem, bounds,
-        field_sizes, 0, Realm::ProfilingRequestSet()).wait();
-    devQoSeqArray = (int*) reserveInst.pointer_untyped(0, sizeof(char));
-    checkCUDA(hipMemcpy(devQoSeqArray, qoSeqArray, sizeof(int) * num_samples,
-        hipMemcpyHostToDevice));
-    devKvSeqArray = (int*)devQoSeqArray + num_samples;
-    checkCUDA(hipMemcpy(devKvSeqArray, kvSeqArray, sizeof(int) * num_samples,
-        hipMemcpyHostToDevice));
-    reserveSpace = (int*)devKvSeqArray + num_samples;
-  }
-  // allocate memory for loWinIdx/hiWinIdx
-  loWinIdx = (int*) malloc(sizeof(int) * attn->qoSeqLength);
-  hiWinIdx = (int*) malloc(sizeof(int) * attn->qoSeqLength);
-  for (int i = 0; i < attn->qoSeqLength; i++) {
-    loWinIdx[i] = 0;
-    hiWinIdx[i] = attn->kvSeqLength;
-  }
-  free(qoSeqArray);
-  free(kvSeqArray);
-#endif
-}
-
-MultiHeadAttentionMeta::~MultiHeadAttentionMeta(void) {
-#if 0
-  reserveInst.destroy();
-  free(loWinIdx);
-  free(hiWinIdx);
-  checkCUDNN(cudnnDestroyAttnDescriptor(attnDesc));
-  checkCUDNN(cudnnDestroySeqDataDescriptor(qDesc));
-  checkCUDNN(cudnnDestroySeqDataDescriptor(kDesc));
-  checkCUDNN(cudnnDestroySeqDataDescriptor(vDesc));
-  checkCUDNN(cudnnDestroySeqDataDescriptor(oDesc));
-#endif
-}
-
 }; // namespace FlexFlow
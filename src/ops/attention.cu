@@ -22,6 +22,252 @@ namespace FlexFlow {
 using Legion::coord_t;
 using Legion::Memory;
 
+namespace {
+
+// Each thread owns one query (or key) row of a block of ATTN_BLOCK rows,
+// and the rows it attends over are staged in shared memory up to ATTN_TILE
+// at a time, so no Lq x Lk buffer is ever allocated. A thread accumulates
+// straight into its own row of the reserve or scratch space, which bounds
+// neither projection size
+int const ATTN_BLOCK = 64;
+int const ATTN_TILE = 32;
+// Shared memory a block may use without opting in to more
+size_t const ATTN_MAX_SHARED_MEMORY = 48 * 1024;
+
+// Sizes of one sample and its valid queries and keys: positions past its
+// sequence length are padding, and a causal query t only attends to keys
+// s <= t
+struct AttnDims {
+  AttnDims(MultiHeadAttentionMeta const *m, int seq_length)
+      : Lq(m->qoSeqLength), Lk(m->kvSeqLength), Pq(m->qProjSize),
+        Pv(m->vProjSize), q_len(m->qoSeqLength), kv_len(m->kvSeqLength),
+        causal(m->causal), reserve_stride(m->head_reserve_size()),
+        scratch_stride((size_t)Lq * (Pv + 1 + Pq) + (size_t)Lk * (Pq + Pv)) {
+    if (seq_length >= 0) {
+      q_len = std::min(q_len, seq_length);
+      kv_len = std::min(kv_len, seq_length);
+    }
+    // wide projections stage fewer rows at a time
+    size_t row_size = (Pq + Pv + 2) * sizeof(float);
+    tile = (int)std::min<size_t>(ATTN_TILE, ATTN_MAX_SHARED_MEMORY / row_size);
+    assert(tile > 0);
+  }
+  // shared memory for staging tile rows of the given width
+  size_t tile_memory(int width) const {
+    return tile * width * sizeof(float);
+  }
+  // keys [0, key_end(t)) are visible to query t
+  __device__ int key_end(int t) const {
+    return causal ? min(kv_len, t + 1) : kv_len;
+  }
+  int Lq, Lk, Pq, Pv, q_len, kv_len, tile;
+  bool causal;
+  // floats between the reserve spaces and the backward scratch buffers of
+  // two consecutive heads
+  size_t reserve_stride, scratch_stride;
+};
+
+// Views of one head's reserve space, laid out as described in
+// attention.cc
+struct HeadReserve {
+  __device__ HeadReserve(float *base, AttnDims const &d)
+      : q(base), k(q + (size_t)d.Lq * d.Pq), v(k + (size_t)d.Lk * d.Pq),
+        attn(v + (size_t)d.Lk * d.Pv), lse(attn + (size_t)d.Lq * d.Pv) {}
+  float *q, *k, *v, *attn, *lse;
+};
+
+// Views of one head's backward scratch space in the handle's workspace
+struct HeadScratch {
+  __device__ HeadScratch(float *base, AttnDims const &d)
+      : d_attn(base), delta(d_attn + (size_t)d.Lq * d.Pv),
+        d_q(delta + d.Lq), d_k(d_q + (size_t)d.Lq * d.Pq),
+        d_v(d_k + (size_t)d.Lk * d.Pq) {}
+  float *d_attn, *delta, *d_q, *d_k, *d_v;
+};
+
+// Copies rows [r0, r0 + n) of a row-major matrix with the given width into
+// shared memory
+__device__ void load_rows(float *tile,
+                          float const *rows,
+                          int r0,
+                          int n,
+                          int width) {
+  __syncthreads();
+  for (int i = threadIdx.x; i < n * width; i += blockDim.x) {
+    tile[i] = rows[(size_t)r0 * width + i];
+  }
+  __syncthreads();
+}
+
+__device__ float dot(float const *a, float const *b, int n) {
+  float sum = 0.0f;
+  for (int i = 0; i < n; i++) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+}
+
+// attn = softmax(q * k^T) * v for every head of one sample (blockIdx.y),
+// with a softmax scaler of 1. Each query folds the keys into a running
+// maximum and sum (online softmax), and lse receives log(sum(exp(scores)))
+__global__ void attention_forward_kernel(float *reserve, AttnDims d) {
+  extern __shared__ float tile[];
+  float *k_tile = tile;
+  float *v_tile = tile + d.tile * d.Pq;
+  HeadReserve r(reserve + blockIdx.y * d.reserve_stride, d);
+  int t_begin = blockIdx.x * ATTN_BLOCK;
+  int t = t_begin + threadIdx.x;
+  int t_last = min(t_begin + ATTN_BLOCK, d.q_len) - 1;
+  int s_end = t_last >= t_begin ? d.key_end(t_last) : 0;
+  int key_end = t < d.q_len ? d.key_end(t) : 0;
+  // only read and written by threads that own a row
+  float const *q = r.q + (size_t)t * d.Pq;
+  float *acc = r.attn + (size_t)t * d.Pv;
+  for (int p = 0; t < d.Lq && p < d.Pv; p++) {
+    acc[p] = 0.0f;
+  }
+  float row_max = -INFINITY, row_sum = 0.0f;
+  for (int s0 = 0; s0 < s_end; s0 += d.tile) {
+    int tk = min(d.tile, s_end - s0);
+    load_rows(k_tile, r.k, s0, tk, d.Pq);
+    load_rows(v_tile, r.v, s0, tk, d.Pv);
+    for (int s = 0; s < min(tk, key_end - s0); s++) {
+      float score = dot(q, k_tile + s * d.Pq, d.Pq);
+      float new_max = fmaxf(row_max, score);
+      // rescale what was accumulated under the previous maximum
+      float scale = expf(row_max - new_max);
+      float prob = expf(score - new_max);
+      row_sum = row_sum * scale + prob;
+      for (int p = 0; p < d.Pv; p++) {
+        acc[p] = acc[p] * scale + prob * v_tile[s * d.Pv + p];
+      }
+      row_max = new_max;
+    }
+  }
+  if (t >= d.Lq) {
+    return;
+  }
+  // padded queries and queries without a visible key produce zeros
+  float scale = row_sum > 0.0f ? 1.0f / row_sum : 0.0f;
+  for (int p = 0; p < d.Pv; p++) {
+    acc[p] *= scale;
+  }
+  r.lse[t] = row_sum > 0.0f ? row_max + logf(row_sum) : 0.0f;
+}
+
+// delta[t] = sum_s probs[t][s] * d_probs[t][s] = dot(attn[t], d_attn[t])
+__global__ void attention_delta_kernel(float *reserve,
+                                       float *scratch,
+                                       AttnDims d,
+                                       int num_heads) {
+  CUDA_KERNEL_LOOP(i, num_heads * d.Lq) {
+    int h = i / d.Lq, t = i % d.Lq;
+    HeadReserve r(reserve + h * d.reserve_stride, d);
+    HeadScratch g(scratch + h * d.scratch_stride, d);
+    g.delta[t] = t < d.q_len ? dot(r.attn + (size_t)t * d.Pv,
+                                   g.d_attn + (size_t)t * d.Pv,
+                                   d.Pv)
+                             : 0.0f;
+  }
+}
+
+// d_k and d_v of one key per thread, recomputing the probabilities of its
+// column from lse while the queries are staged in shared memory
+__global__ void attention_backward_kv_kernel(float *reserve,
+                                             float *scratch,
+                                             AttnDims d) {
+  extern __shared__ float tile[];
+  float *q_tile = tile;
+  float *d_attn_tile = q_tile + d.tile * d.Pq;
+  float *lse_tile = d_attn_tile + d.tile * d.Pv;
+  float *delta_tile = lse_tile + d.tile;
+  HeadReserve r(reserve + blockIdx.y * d.reserve_stride, d);
+  HeadScratch g(scratch + blockIdx.y * d.scratch_stride, d);
+  int s_begin = blockIdx.x * ATTN_BLOCK;
+  int s = s_begin + threadIdx.x;
+  // only read and written by threads that own a row
+  float const *k = r.k + (size_t)s * d.Pq;
+  float const *v = r.v + (size_t)s * d.Pv;
+  float *d_k = g.d_k + (size_t)s * d.Pq;
+  float *d_v = g.d_v + (size_t)s * d.Pv;
+  for (int p = 0; s < d.Lk && p < d.Pq; p++) {
+    d_k[p] = 0.0f;
+  }
+  for (int p = 0; s < d.Lk && p < d.Pv; p++) {
+    d_v[p] = 0.0f;
+  }
+  // causal queries before the first key of the block see none of its keys
+  int t_begin = d.causal ? s_begin : 0;
+  int t_end = s_begin < d.kv_len ? d.q_len : 0;
+  for (int t0 = t_begin; t0 < t_end; t0 += d.tile) {
+    int tq = min(d.tile, t_end - t0);
+    load_rows(q_tile, r.q, t0, tq, d.Pq);
+    load_rows(d_attn_tile, g.d_attn, t0, tq, d.Pv);
+    load_rows(lse_tile, r.lse, t0, tq, 1);
+    load_rows(delta_tile, g.delta, t0, tq, 1);
+    if (s >= d.kv_len) {
+      continue;
+    }
+    for (int t = 0; t < tq; t++) {
+      if (s >= d.key_end(t0 + t)) {
+        continue;
+      }
+      float const *q = q_tile + t * d.Pq;
+      float const *d_attn = d_attn_tile + t * d.Pv;
+      float prob = expf(dot(q, k, d.Pq) - lse_tile[t]);
+      // softmax backward
+      float d_score = prob * (dot(d_attn, v, d.Pv) - delta_tile[t]);
+      for (int p = 0; p < d.Pv; p++) {
+        d_v[p] += prob * d_attn[p];
+      }
+      for (int p = 0; p < d.Pq; p++) {
+        d_k[p] += d_score * q[p];
+      }
+    }
+  }
+}
+
+// d_q of one query per thread, recomputing the probabilities of its row
+// from lse while the keys are staged in shared memory
+__global__ void attention_backward_q_kernel(float *reserve,
+                                            float *scratch,
+                                            AttnDims d) {
+  extern __shared__ float tile[];
+  float *k_tile = tile;
+  float *v_tile = tile + d.tile * d.Pq;
+  HeadReserve r(reserve + blockIdx.y * d.reserve_stride, d);
+  HeadScratch g(scratch + blockIdx.y * d.scratch_stride, d);
+  int t_begin = blockIdx.x * ATTN_BLOCK;
+  int t = t_begin + threadIdx.x;
+  int t_last = min(t_begin + ATTN_BLOCK, d.q_len) - 1;
+  int s_end = t_last >= t_begin ? d.key_end(t_last) : 0;
+  int key_end = t < d.q_len ? d.key_end(t) : 0;
+  // only read and written by threads that own a row
+  float const *q = r.q + (size_t)t * d.Pq;
+  float const *d_attn = g.d_attn + (size_t)t * d.Pv;
+  float *d_q = g.d_q + (size_t)t * d.Pq;
+  for (int p = 0; t < d.Lq && p < d.Pq; p++) {
+    d_q[p] = 0.0f;
+  }
+  float lse = t < d.q_len ? r.lse[t] : 0.0f;
+  float delta = t < d.q_len ? g.delta[t] : 0.0f;
+  for (int s0 = 0; s0 < s_end; s0 += d.tile) {
+    int tk = min(d.tile, s_end - s0);
+    load_rows(k_tile, r.k, s0, tk, d.Pq);
+    load_rows(v_tile, r.v, s0, tk, d.Pv);
+    for (int s = 0; s < min(tk, key_end - s0); s++) {
+      float const *k = k_tile + s * d.Pq;
+      float prob = expf(dot(q, k, d.Pq) - lse);
+      float d_score = prob * (dot(d_attn, v_tile + s * d.Pv, d.Pv) - delta);
+      for (int p = 0; p < d.Pq; p++) {
+        d_q[p] += d_score * k[p];
+      }
+    }
+  }
+}
+
+} // namespace
+
 /*static*/
 void MultiHeadAttention::forward_kernel(MultiHeadAttentionMeta const *m,
                                         float const *query_ptr,
@@ -29,31 +275,108 @@ void MultiHeadAttention::forward_kernel(MultiHeadAttentionMeta const *m,
                                         float const *value_ptr,
                                         float const *weight_ptr,
                                         float *output_ptr,
-                                        cudaStream_t stream) {
-  checkCUDNN(cudnnSetStream(m->handle.dnn, stream));
-
-  checkCUDNN(cudnnMultiHeadAttnForward(m->handle.dnn,
-                                       m->attnDesc,
-                                       -1,
-                                       m->loWinIdx,
-                                       m->hiWinIdx,
-                                       m->devQoSeqArray,
-                                       m->devKvSeqArray,
-                                       m->qDesc,
-                                       query_ptr,
-                                       NULL /*residual*/,
-                                       m->kDesc,
-                                       key_ptr,
-                                       m->vDesc,
-                                       value_ptr,
-                                       m->oDesc,
-                                       output_ptr,
-                                       m->weightSize,
-                                       weight_ptr,
-                                       m->handle.workSpaceSize,
-                                       m->handle.workSpace,
-                                       m->reserveSpaceSize,
-                                       m->reserveSpace));
+                                        cudaStream_t stream,
+                                        int const *seq_lengths) {
+  checkCUDA(cublasSetStream(m->handle.blas, stream));
+  int const Lq = m->qoSeqLength, Lk = m->kvSeqLength;
+  int const Pq = m->qProjSize, Pk = m->kProjSize, Pv = m->vProjSize;
+  int const Po = m->oProjSize, H = m->num_heads;
+  size_t const hw = m->head_weight_size(), hr = m->head_reserve_size();
+  float const alpha = 1.0f, beta = 0.0f;
+  float const *wq = weight_ptr;
+  float const *wk = wq + (size_t)Pq * m->qSize;
+  float const *wv = wk + (size_t)Pk * m->kSize;
+  float const *wo = wv + (size_t)Pv * m->vSize;
+  checkCUDA(cudaMemsetAsync(
+      output_ptr, 0, sizeof(float) * m->num_samples * Lq * Po, stream));
+  for (int b = 0; b < m->num_samples; b++) {
+    AttnDims d(m, seq_lengths ? seq_lengths[b] : -1);
+    float const *xq = query_ptr + (size_t)b * Lq * m->qSize;
+    float const *xk = key_ptr + (size_t)b * Lk * m->kSize;
+    float const *xv = value_ptr + (size_t)b * Lk * m->vSize;
+    float *out = output_ptr + (size_t)b * Lq * Po;
+    float *q = (float *)m->reserveSpace + (size_t)b * H * hr;
+    float *k = q + (size_t)Lq * Pq;
+    float *v = k + (size_t)Lk * Pk;
+    float *attn = v + (size_t)Lk * Pv;
+    // project the queries, keys and values of every head
+    checkCUDA(cublasSgemmStridedBatched(m->handle.blas,
+                                        CUBLAS_OP_T,
+                                        CUBLAS_OP_N,
+                                        Pq,
+                                        Lq,
+                                        m->qSize,
+                                        &alpha,
+                                        wq,
+                                        m->qSize,
+                                        hw,
+                                        xq,
+                                        m->qSize,
+                                        0,
+                                        &beta,
+                                        q,
+                                        Pq,
+                                        hr,
+                                        H));
+    checkCUDA(cublasSgemmStridedBatched(m->handle.blas,
+                                        CUBLAS_OP_T,
+                                        CUBLAS_OP_N,
+                                        Pk,
+                                        Lk,
+                                        m->kSize,
+                                        &alpha,
+                                        wk,
+                                        m->kSize,
+                                        hw,
+                                        xk,
+                                        m->kSize,
+                                        0,
+                                        &beta,
+                                        k,
+                                        Pk,
+                                        hr,
+                                        H));
+    checkCUDA(cublasSgemmStridedBatched(m->handle.blas,
+                                        CUBLAS_OP_T,
+                                        CUBLAS_OP_N,
+                                        Pv,
+                                        Lk,
+                                        m->vSize,
+                                        &alpha,
+                                        wv,
+                                        m->vSize,
+                                        hw,
+                                        xv,
+                                        m->vSize,
+                                        0,
+                                        &beta,
+                                        v,
+                                        Pv,
+                                        hr,
+                                        H));
+    dim3 q_blocks((Lq + ATTN_BLOCK - 1) / ATTN_BLOCK, H);
+    attention_forward_kernel<<<q_blocks,
+                               ATTN_BLOCK,
+                               d.tile_memory(Pq + Pv),
+                               stream>>>(q, d);
+    // out += attn * wo^T, summed over the heads
+    for (int h = 0; h < H; h++) {
+      checkCUDA(cublasSgemm(m->handle.blas,
+                            CUBLAS_OP_T,
+                            CUBLAS_OP_N,
+                            Po,
+                            Lq,
+                            Pv,
+                            &alpha,
+                            wo + h * hw,
+                            Pv,
+                            attn + h * hr,
+                            Pv,
+                            &alpha,
+                            out,
+                            Po));
+    }
+  }
 }
 
 /*static*/
@@ -62,7 +385,8 @@ void MultiHeadAttention::forward_kernel_wrapper(MultiHeadAttentionMeta const *m,
                                                 float const *key_ptr,
                                                 float const *value_ptr,
                                                 float const *weight_ptr,
-                                                float *output_ptr) {
+                                                float *output_ptr,
+                                                int const *seq_lengths) {
   cudaStream_t stream;
   checkCUDA(get_legion_stream(&stream));
 
@@ -72,8 +396,14 @@ void MultiHeadAttention::forward_kernel_wrapper(MultiHeadAttentionMeta const *m,
     cudaEventCreate(&t_end);
     cudaEventRecord(t_start, stream);
   }
-  MultiHeadAttention::forward_kernel(
-      m, query_ptr, key_ptr, value_ptr, weight_ptr, output_ptr, stream);
+  MultiHeadAttention::forward_kernel(m,
+                                     query_ptr,
+                                     key_ptr,
+                                     value_ptr,
+                                     weight_ptr,
+                                     output_ptr,
+                                     stream,
+                                     seq_lengths);
   if (m->profiling) {
     cudaEventRecord(t_end, stream);
     checkCUDA(cudaEventSynchronize(t_end));
@@ -99,50 +429,206 @@ void MultiHeadAttention::backward_kernel(MultiHeadAttentionMeta const *m,
                                          float const *weight_ptr,
                                          float *weight_grad_ptr,
                                          float const *output_grad_ptr,
-                                         cudaStream_t stream) {
-  checkCUDNN(cudnnSetStream(m->handle.dnn, stream));
-
-  checkCUDNN(cudnnMultiHeadAttnBackwardData(m->handle.dnn,
-                                            m->attnDesc,
-                                            m->loWinIdx,
-                                            m->hiWinIdx,
-                                            m->devQoSeqArray,
-                                            m->devKvSeqArray,
-                                            m->oDesc,
-                                            output_grad_ptr,
-                                            m->qDesc,
-                                            query_grad_ptr,
-                                            query_ptr,
-                                            m->kDesc,
-                                            key_grad_ptr,
-                                            key_ptr,
-                                            m->vDesc,
-                                            value_grad_ptr,
-                                            value_ptr,
-                                            m->weightSize,
-                                            weight_ptr,
-                                            m->handle.workSpaceSize,
-                                            m->handle.workSpace,
-                                            m->reserveSpaceSize,
-                                            m->reserveSpace));
-  checkCUDNN(cudnnMultiHeadAttnBackwardWeights(m->handle.dnn,
-                                               m->attnDesc,
-                                               CUDNN_WGRAD_MODE_ADD,
-                                               m->qDesc,
-                                               query_ptr,
-                                               m->kDesc,
-                                               key_ptr,
-                                               m->vDesc,
-                                               value_ptr,
-                                               m->oDesc,
-                                               output_grad_ptr,
-                                               m->weightSize,
-                                               weight_ptr,
-                                               weight_grad_ptr,
-                                               m->handle.workSpaceSize,
-                                               m->handle.workSpace,
-                                               m->reserveSpaceSize,
-                                               m->reserveSpace));
+                                         cudaStream_t stream,
+                                         int const *seq_lengths) {
+  checkCUDA(cublasSetStream(m->handle.blas, stream));
+  int const Lq = m->qoSeqLength, Lk = m->kvSeqLength;
+  int const Pq = m->qProjSize, Pk = m->kProjSize, Pv = m->vProjSize;
+  int const Po = m->oProjSize, H = m->num_heads;
+  size_t const hw = m->head_weight_size(), hr = m->head_reserve_size();
+  float const alpha = 1.0f, beta = 0.0f;
+  float const *wq = weight_ptr;
+  float const *wk = wq + (size_t)Pq * m->qSize;
+  float const *wv = wk + (size_t)Pk * m->kSize;
+  float const *wo = wv + (size_t)Pv * m->vSize;
+  float *dwq = weight_grad_ptr;
+  float *dwk = dwq + (size_t)Pq * m->qSize;
+  float *dwv = dwk + (size_t)Pk * m->kSize;
+  float *dwo = dwv + (size_t)Pv * m->vSize;
+  // The gradients of the projected queries, keys and values of all heads of
+  // one sample are staged in the workspace
+  float *scratch = (float *)m->handle.workSpace;
+  size_t const hs = AttnDims(m, -1).scratch_stride;
+  assert(hs * H * sizeof(float) <= m->handle.workSpaceSize);
+  float *d_attn = scratch;
+  float *d_q = d_attn + (size_t)Lq * Pv + Lq;
+  float *d_k = d_q + (size_t)Lq * Pq;
+  float *d_v = d_k + (size_t)Lk * Pk;
+  // Like cuDNN, data gradients are overwritten and weight gradients are
+  // accumulated
+  checkCUDA(cudaMemsetAsync(query_grad_ptr,
+                            0,
+                            sizeof(float) * m->num_samples * Lq * m->qSize,
+                            stream));
+  checkCUDA(cudaMemsetAsync(key_grad_ptr,
+                            0,
+                            sizeof(float) * m->num_samples * Lk * m->kSize,
+                            stream));
+  checkCUDA(cudaMemsetAsync(value_grad_ptr,
+                            0,
+                            sizeof(float) * m->num_samples * Lk * m->vSize,
+                            stream));
+  for (int b = 0; b < m->num_samples; b++) {
+    AttnDims d(m, seq_lengths ? seq_lengths[b] : -1);
+    float const *xq = query_ptr + (size_t)b * Lq * m->qSize;
+    float const *xk = key_ptr + (size_t)b * Lk * m->kSize;
+    float const *xv = value_ptr + (size_t)b * Lk * m->vSize;
+    float *dxq = query_grad_ptr + (size_t)b * Lq * m->qSize;
+    float *dxk = key_grad_ptr + (size_t)b * Lk * m->kSize;
+    float *dxv = value_grad_ptr + (size_t)b * Lk * m->vSize;
+    float const *d_out = output_grad_ptr + (size_t)b * Lq * Po;
+    float *reserve = (float *)m->reserveSpace + (size_t)b * H * hr;
+    float const *attn = reserve + (size_t)Lq * Pq + (size_t)Lk * (Pk + Pv);
+    // output projection
+    checkCUDA(cublasSgemmStridedBatched(m->handle.blas,
+                                        CUBLAS_OP_N,
+                                        CUBLAS_OP_T,
+                                        Pv,
+                                        Po,
+                                        Lq,
+                                        &alpha,
+                                        attn,
+                                        Pv,
+                                        hr,
+                                        d_out,
+                                        Po,
+                                        0,
+                                        &alpha,
+                                        dwo,
+                                        Pv,
+                                        hw,
+                                        H));
+    checkCUDA(cublasSgemmStridedBatched(m->handle.blas,
+                                        CUBLAS_OP_N,
+                                        CUBLAS_OP_N,
+                                        Pv,
+                                        Lq,
+                                        Po,
+                                        &alpha,
+                                        wo,
+                                        Pv,
+                                        hw,
+                                        d_out,
+                                        Po,
+                                        0,
+                                        &beta,
+                                        d_attn,
+                                        Pv,
+                                        hs,
+                                        H));
+    attention_delta_kernel<<<GET_BLOCKS(H * Lq), CUDA_NUM_THREADS, 0, stream>>>(
+        reserve, scratch, d, H);
+    dim3 k_blocks((Lk + ATTN_BLOCK - 1) / ATTN_BLOCK, H);
+    attention_backward_kv_kernel<<<k_blocks,
+                                   ATTN_BLOCK,
+                                   d.tile_memory(Pq + Pv + 2),
+                                   stream>>>(reserve, scratch, d);
+    dim3 q_blocks((Lq + ATTN_BLOCK - 1) / ATTN_BLOCK, H);
+    attention_backward_q_kernel<<<q_blocks,
+                                  ATTN_BLOCK,
+                                  d.tile_memory(Pq + Pv),
+                                  stream>>>(reserve, scratch, d);
+    // input projections: weight gradients per head, data gradients summed
+    // over the heads
+    checkCUDA(cublasSgemmStridedBatched(m->handle.blas,
+                                        CUBLAS_OP_N,
+                                        CUBLAS_OP_T,
+                                        m->qSize,
+                                        Pq,
+                                        Lq,
+                                        &alpha,
+                                        xq,
+                                        m->qSize,
+                                        0,
+                                        d_q,
+                                        Pq,
+                                        hs,
+                                        &alpha,
+                                        dwq,
+                                        m->qSize,
+                                        hw,
+                                        H));
+    checkCUDA(cublasSgemmStridedBatched(m->handle.blas,
+                                        CUBLAS_OP_N,
+                                        CUBLAS_OP_T,
+                                        m->kSize,
+                                        Pk,
+                                        Lk,
+                                        &alpha,
+                                        xk,
+                                        m->kSize,
+                                        0,
+                                        d_k,
+                                        Pk,
+                                        hs,
+                                        &alpha,
+                                        dwk,
+                                        m->kSize,
+                                        hw,
+                                        H));
+    checkCUDA(cublasSgemmStridedBatched(m->handle.blas,
+                                        CUBLAS_OP_N,
+                                        CUBLAS_OP_T,
+                                        m->vSize,
+                                        Pv,
+                                        Lk,
+                                        &alpha,
+                                        xv,
+                                        m->vSize,
+                                        0,
+                                        d_v,
+                                        Pv,
+                                        hs,
+                                        &alpha,
+                                        dwv,
+                                        m->vSize,
+                                        hw,
+                                        H));
+    for (int h = 0; h < H; h++) {
+      checkCUDA(cublasSgemm(m->handle.blas,
+                            CUBLAS_OP_N,
+                            CUBLAS_OP_N,
+                            m->qSize,
+                            Lq,
+                            Pq,
+                            &alpha,
+                            wq + h * hw,
+                            m->qSize,
+                            d_q + h * hs,
+                            Pq,
+                            &alpha,
+                            dxq,
+                            m->qSize));
+      checkCUDA(cublasSgemm(m->handle.blas,
+                            CUBLAS_OP_N,
+                            CUBLAS_OP_N,
+                            m->kSize,
+                            Lk,
+                            Pk,
+                            &alpha,
+                            wk + h * hw,
+                            m->kSize,
+                            d_k + h * hs,
+                            Pk,
+                            &alpha,
+                            dxk,
+                            m->kSize));
+      checkCUDA(cublasSgemm(m->handle.blas,
+                            CUBLAS_OP_N,
+                            CUBLAS_OP_N,
+                            m->vSize,
+                            Lk,
+                            Pv,
+                            &alpha,
+                            wv + h * hw,
+                            m->vSize,
+                            d_v + h * hs,
+                            Pv,
+                            &alpha,
+                            dxv,
+                            m->vSize));
+    }
+  }
 }
 
 /*static*/
@@ -156,7 +642,8 @@ void MultiHeadAttention::backward_kernel_wrapper(
     float *value_grad_ptr,
     float const *weight_ptr,
     float *weight_grad_ptr,
-    float const *output_grad_ptr) {
+    float const *output_grad_ptr,
+    int const *seq_lengths) {
   cudaStream_t stream;
   checkCUDA(get_legion_stream(&stream));
 
@@ -177,7 +664,8 @@ void MultiHeadAttention::backward_kernel_wrapper(
                                       weight_ptr,
                                       weight_grad_ptr,
                                       output_grad_ptr,
-                                      stream);
+                                      stream,
+                                      seq_lengths);
   if (m->profiling) {
     cudaEventRecord(t_end, stream);
     checkCUDA(cudaEventSynchronize(t_end));
@@ -189,184 +677,4 @@ void MultiHeadAttention::backward_kernel_wrapper(
   }
 }
 
-MultiHeadAttentionMeta::MultiHeadAttentionMeta(FFHandler handler,
-                                               MultiHeadAttention const *attn,
-                                               Memory gpu_mem,
-                                               int num_samples,
-                                               int num_heads)
-    : OpMeta(handler) {
-  cudaStream_t stream;
-  checkCUDA(get_legion_stream(&stream));
-  checkCUDNN(cudnnSetStream(handler.dnn, stream));
-
-  checkCUDNN(cudnnCreateAttnDescriptor(&attnDesc));
-  checkCUDNN(cudnnCreateSeqDataDescriptor(&qDesc));
-  checkCUDNN(cudnnCreateSeqDataDescriptor(&kDesc));
-  checkCUDNN(cudnnCreateSeqDataDescriptor(&vDesc));
-  checkCUDNN(cudnnCreateSeqDataDescriptor(&oDesc));
-  // Currently do not support adding bias to key/value projection
-  assert(!attn->add_bias_kv);
-  cudnnAttnQueryMap_t attnMode = CUDNN_ATTN_QUERYMAP_ALL_TO_ONE;
-  // Assume no beam search for now
-  int maxBeamSize = 1;
-  // printf("batchSize(%d) qSize(%d) kSize(%d) vSize(%d) qProjSize(%d)
-  // kProjSize(%d)\n",
-  //     num_samples, attn->qSize, attn->kSize, attn->vSize, attn->qProjSize,
-  //     attn->kProjSize);
-  // printf("vProjSize(%d) oProjSize(%d) qoSeqLength(%d) kvSeqLength(%d)\n",
-  //     attn->vProjSize, attn->oProjSize, attn->qoSeqLength,
-  //     attn->kvSeqLength);
-  cudnnMathType_t math_type;
-  if (handle.allowTensorOpMathConversion) {
-    math_type = CUDNN_TENSOR_OP_MATH_ALLOW_CONVERSION;
-  } else {
-    math_type = CUDNN_TENSOR_OP_MATH;
-  }
-  checkCUDNN(cudnnSetAttnDescriptor(attnDesc,
-                                    attnMode,
-                                    num_heads,
-                                    1.0f /*smScalar*/,
-                                    CUDNN_DATA_FLOAT,
-                                    CUDNN_DATA_FLOAT,
-                                    math_type,
-                                    NULL /*attnDropoutDesc*/,
-                                    NULL /*postDropoutDesc*/,
-                                    attn->qSize,
-                                    attn->kSize,
-                                    attn->vSize,
-                                    attn->qProjSize,
-                                    attn->kProjSize,
-                                    attn->vProjSize,
-                                    attn->oProjSize,
-                                    attn->qoSeqLength,
-                                    attn->kvSeqLength,
-                                    num_samples,
-                                    maxBeamSize));
-  size_t workSpaceSize;
-  checkCUDNN(cudnnGetMultiHeadAttnBuffers(
-      handler.dnn, attnDesc, &weightSize, &workSpaceSize, &reserveSpaceSize));
-  assert(workSpaceSize <= handler.workSpaceSize);
-  // printf("weightSize(%zu) workSpaceSize(%zu) reserveSpaceSize(%zu)\n",
-  // weightSize, workSpaceSize, reserveSpaceSize);
-  int dimA[CUDNN_SEQDATA_DIM_COUNT];
-  cudnnSeqDataAxis_t axes[CUDNN_SEQDATA_DIM_COUNT];
-  assert(CUDNN_SEQDATA_DIM_COUNT == 4);
-  axes[3] = CUDNN_SEQDATA_VECT_DIM; // 3 = nbDims-1
-  axes[2] = CUDNN_SEQDATA_BEAM_DIM;
-  axes[1] = CUDNN_SEQDATA_TIME_DIM;
-  axes[0] = CUDNN_SEQDATA_BATCH_DIM;
-  int *qoSeqArray = (int *)malloc(sizeof(int) * num_samples);
-  int *kvSeqArray = (int *)malloc(sizeof(int) * num_samples);
-  for (int i = 0; i < num_samples; i++) {
-    qoSeqArray[i] = attn->qoSeqLength;
-    kvSeqArray[i] = attn->kvSeqLength;
-  }
-  // Set qDesc
-  {
-    dimA[CUDNN_SEQDATA_BEAM_DIM] = 1;
-    dimA[CUDNN_SEQDATA_BATCH_DIM] = num_samples;
-    dimA[CUDNN_SEQDATA_TIME_DIM] = attn->qoSeqLength;
-    dimA[CUDNN_SEQDATA_VECT_DIM] = attn->qSize;
-    checkCUDNN(cudnnSetSeqDataDescriptor(qDesc,
-                                         CUDNN_DATA_FLOAT,
-                                         CUDNN_SEQDATA_DIM_COUNT,
-                                         dimA,
-                                         axes,
-                                         num_samples,
-                                         qoSeqArray,
-                                         NULL));
-  }
-  // Set kDesc
-  {
-    dimA[CUDNN_SEQDATA_BEAM_DIM] = 1;
-    dimA[CUDNN_SEQDATA_BATCH_DIM] = num_samples;
-    dimA[CUDNN_SEQDATA_TIME_DIM] = attn->kvSeqLength;
-    dimA[CUDNN_SEQDATA_VECT_DIM] = attn->kSize;
-    checkCUDNN(cudnnSetSeqDataDescriptor(kDesc,
-                                         CUDNN_DATA_FLOAT,
-                                         CUDNN_SEQDATA_DIM_COUNT,
-                                         dimA,
-                                         axes,
-                                         num_samples,
-                                         kvSeqArray,
-                                         NULL));
-  }
-  // Set vDesc
-  {
-    dimA[CUDNN_SEQDATA_BEAM_DIM] = 1;
-    dimA[CUDNN_SEQDATA_BATCH_DIM] = num_samples;
-    dimA[CUDNN_SEQDATA_TIME_DIM] = attn->kvSeqLength;
-    dimA[CUDNN_SEQDATA_VECT_DIM] = attn->vSize;
-    checkCUDNN(cudnnSetSeqDataDescriptor(vDesc,
-                                         CUDNN_DATA_FLOAT,
-                                         CUDNN_SEQDATA_DIM_COUNT,
-                                         dimA,
-                                         axes,
-                                         num_samples,
-                                         kvSeqArray,
-                                         NULL));
-  }
-  // Set oDesc
-  {
-    dimA[CUDNN_SEQDATA_BEAM_DIM] = 1;
-    dimA[CUDNN_SEQDATA_BATCH_DIM] = num_samples;
-    dimA[CUDNN_SEQDATA_TIME_DIM] = attn->qoSeqLength;
-    dimA[CUDNN_SEQDATA_VECT_DIM] = attn->oProjSize;
-    checkCUDNN(cudnnSetSeqDataDescriptor(oDesc,
-                                         CUDNN_DATA_FLOAT,
-                                         CUDNN_SEQDATA_DIM_COUNT,
-                                         dimA,
-                                         axes,
-                                         num_samples,
-                                         qoSeqArray,
-                                         NULL));
-  }
-  // allocate memory for the seqArray and reserve space
-  {
-    size_t totalSize = reserveSpaceSize + sizeof(int) * num_samples * 2;
-    Realm::Rect<1, coord_t> bounds(Realm::Point<1, coord_t>(0),
-                                   Realm::Point<1, coord_t>(totalSize - 1));
-    std::vector<size_t> field_sizes;
-    field_sizes.push_back(sizeof(char));
-    Realm::RegionInstance::create_instance(reserveInst,
-                                           gpu_mem,
-                                           bounds,
-                                           field_sizes,
-                                           0,
-                                           Realm::ProfilingRequestSet())
-        .wait();
-    devQoSeqArray = (int *)reserveInst.pointer_untyped(0, sizeof(char));
-    checkCUDA(cudaMemcpy(devQoSeqArray,
-                         qoSeqArray,
-                         sizeof(int) * num_samples,
-                         cudaMemcpyHostToDevice));
-    devKvSeqArray = (int *)devQoSeqArray + num_samples;
-    checkCUDA(cudaMemcpy(devKvSeqArray,
-                         kvSeqArray,
-                         sizeof(int) * num_samples,
-                         cudaMemcpyHostToDevice));
-    reserveSpace = (int *)devKvSeqArray + num_samples;
-  }
-  // allocate memory for loWinIdx/hiWinIdx
-  loWinIdx = (int *)malloc(sizeof(int) * attn->qoSeqLength);
-  hiWinIdx = (int *)malloc(sizeof(int) * attn->qoSeqLength);
-  for (int i = 0; i < attn->qoSeqLength; i++) {
-    loWinIdx[i] = 0;
-    hiWinIdx[i] = attn->kvSeqLength;
-  }
-  free(qoSeqArray);
-  free(kvSeqArray);
-}
-
-MultiHeadAttentionMeta::~MultiHeadAttentionMeta(void) {
-  reserveInst.destroy();
-  free(loWinIdx);
-  free(hiWinIdx);
-  checkCUDNN(cudnnDestroyAttnDescriptor(attnDesc));
-  checkCUDNN(cudnnDestroySeqDataDescriptor(qDesc));
-  checkCUDNN(cudnnDestroySeqDataDescriptor(kDesc));
-  checkCUDNN(cudnnDestroySeqDataDescriptor(vDesc));
-  checkCUDNN(cudnnDestroySeqDataDescriptor(oDesc));
-}
-
 }; // namespace FlexFlow
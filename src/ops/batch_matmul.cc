@@ -115,13 +115,14 @@ BatchMatmul::BatchMatmul(FFModel &model,
   for (int i = A->num_dims - 1; i >= 2; i--)
     assert(A->dims[i] == B->dims[i]);
   assert(A->dims[0] == B->dims[1]);
+  assert(A->data_type == B->data_type);
   ParallelDim dims[MAX_TENSOR_DIM];
   for (int i = 0; i < A->num_dims; i++)
     dims[i] = A->dims[i];
   dims[0] = B->dims[0];
   numOutputs = 1;
   outputs[0] = model.create_parallel_tensor_legion_ordering(
-      A->num_dims, dims, DT_FLOAT, this);
+      A->num_dims, dims, A->data_type, this);
   // C is not none
   // if (C != Tensor::NO_TENSOR) {
   //  numInputs = 3;
@@ -191,6 +192,7 @@ OpMeta *BatchMatmul::init_task(Task const *task,
   m->profiling = bmm->profiling;
   m->a_seq_length_dim = bmm->a_seq_length_dim;
   m->b_seq_length_dim = bmm->b_seq_length_dim;
+  m->data_type = bmm->outputs[0]->data_type;
   return m;
 }
 
@@ -224,6 +226,7 @@ void BatchMatmul::forward_with_dim(FFModel const &ff) {
       false /*must*/,
       0 /*mapper_id*/,
       outputs[0]->machine_view.hash());
+  set_priority_for_forward(launcher);
   launcher.add_region_requirement(RegionRequirement(outputs[0]->part,
                                                     0 /*projection id*/,
                                                     WRITE_ONLY,
@@ -278,25 +281,47 @@ void BatchMatmul::forward_task(Task const *task,
     assert(dim_size == out_domain.hi()[i] - out_domain.lo()[i] + 1);
     batch *= dim_size;
   }
-  float *out_ptr = helperGetTensorPointerWO<float>(
-      regions[0], task->regions[0], FID_DATA, ctx, runtime);
-  float const *a_ptr = helperGetTensorPointerRO<float>(
-      regions[1], task->regions[1], FID_DATA, ctx, runtime);
-  float const *b_ptr = helperGetTensorPointerRO<float>(
-      regions[2], task->regions[2], FID_DATA, ctx, runtime);
-  float const *c_ptr = NULL;
+  int num_dims = out_domain.get_dim();
+  GenericTensorAccessorW acc_out(num_dims,
+                                 meta->data_type,
+                                 regions[0],
+                                 task->regions[0],
+                                 FID_DATA,
+                                 ctx,
+                                 runtime);
+  GenericTensorAccessorR acc_a(num_dims,
+                               meta->data_type,
+                               regions[1],
+                               task->regions[1],
+                               FID_DATA,
+                               ctx,
+                               runtime);
+  GenericTensorAccessorR acc_b(num_dims,
+                               meta->data_type,
+                               regions[2],
+                               task->regions[2],
+                               FID_DATA,
+                               ctx,
+                               runtime);
+  void const *c_ptr = NULL;
   if (regions.size() == 4) {
     Domain c_domain = runtime->get_index_space_domain(
         ctx, task->regions[3].region.get_index_space());
     assert(c_domain == a_domain);
-    c_ptr = helperGetTensorPointerRO<float>(
-        regions[3], task->regions[3], FID_DATA, ctx, runtime);
+    GenericTensorAccessorR acc_c(num_dims,
+                                 meta->data_type,
+                                 regions[3],
+                                 task->regions[3],
+                                 FID_DATA,
+                                 ctx,
+                                 runtime);
+    c_ptr = acc_c.ptr;
   }
 
   BatchMatmul::forward_kernel_wrapper(meta,
-                                      out_ptr,
-                                      a_ptr,
-                                      b_ptr,
+                                      acc_out.ptr,
+                                      acc_a.ptr,
+                                      acc_b.ptr,
                                       c_ptr,
                                       m,
                                       n,
@@ -346,6 +371,7 @@ void BatchMatmul::backward_with_dim(FFModel const &ff) {
       false /*must*/,
       0 /*mapper_id*/,
       outputs[0]->machine_view.hash());
+  set_priority_for_backward(launcher);
   // regions[0](I): output
   launcher.add_region_requirement(RegionRequirement(outputs[0]->part,
                                                     0 /*projection id*/,
@@ -446,20 +472,53 @@ __host__ void
     batch *= dim_size;
   }
   // get pointers
-  float const *out_ptr = helperGetTensorPointerRO<float>(
-      regions[0], task->regions[0], FID_DATA, ctx, runtime);
-  float const *out_grad_ptr = helperGetTensorPointerRO<float>(
-      regions[1], task->regions[1], FID_DATA, ctx, runtime);
-  float const *a_ptr = helperGetTensorPointerRO<float>(
-      regions[2], task->regions[2], FID_DATA, ctx, runtime);
-  float *a_grad_ptr = helperGetTensorPointerRW<float>(
-      regions[3], task->regions[3], FID_DATA, ctx, runtime);
-  float const *b_ptr = helperGetTensorPointerRO<float>(
-      regions[4], task->regions[4], FID_DATA, ctx, runtime);
-  float *b_grad_ptr = helperGetTensorPointerRW<float>(
-      regions[5], task->regions[5], FID_DATA, ctx, runtime);
-
-  float *c_grad_ptr = NULL;
+  int num_dims = out_domain.get_dim();
+  GenericTensorAccessorR acc_out(num_dims,
+                                 meta->data_type,
+                                 regions[0],
+                                 task->regions[0],
+                                 FID_DATA,
+                                 ctx,
+                                 runtime);
+  GenericTensorAccessorR acc_out_grad(num_dims,
+                                      meta->data_type,
+                                      regions[1],
+                                      task->regions[1],
+                                      FID_DATA,
+                                      ctx,
+                                      runtime);
+  GenericTensorAccessorR acc_a(num_dims,
+                               meta->data_type,
+                               regions[2],
+                               task->regions[2],
+                               FID_DATA,
+                               ctx,
+                               runtime);
+  GenericTensorAccessorW acc_a_grad(num_dims,
+                                    meta->data_type,
+                                    regions[3],
+                                    task->regions[3],
+                                    FID_DATA,
+                                    ctx,
+                                    runtime,
+                                    true /*readOutput*/);
+  GenericTensorAccessorR acc_b(num_dims,
+                               meta->data_type,
+                               regions[4],
+                               task->regions[4],
+                               FID_DATA,
+                               ctx,
+                               runtime);
+  GenericTensorAccessorW acc_b_grad(num_dims,
+                                    meta->data_type,
+                                    regions[5],
+                                    task->regions[5],
+                                    FID_DATA,
+                                    ctx,
+                                    runtime,
+                                    true /*readOutput*/);
+
+  void *c_grad_ptr = NULL;
 
   // TODO: add support for meta->a_seq_length_dim >= 0
   // or meta->b_seq_length_dim >= 0
@@ -467,12 +526,12 @@ __host__ void
   assert((meta->b_seq_length_dim < 0) || (iter_config->seq_length == 0));
 
   BatchMatmul::backward_kernel_wrapper(meta,
-                                       out_ptr,
-                                       out_grad_ptr,
-                                       a_ptr,
-                                       a_grad_ptr,
-                                       b_ptr,
-                                       b_grad_ptr,
+                                       acc_out.ptr,
+                                       acc_out_grad.ptr,
+                                       acc_a.ptr,
+                                       acc_a_grad.ptr,
+                                       acc_b.ptr,
+                                       acc_b_grad.ptr,
                                        c_grad_ptr,
                                        m,
                                        n,
@@ -520,17 +579,19 @@ bool BatchMatmul::measure_operator_cost(Simulator *sim,
   }
 
   BatchMatmulMeta *meta = sim->batch_matmul_meta;
+  DataType data_type = outputs[0]->data_type;
+  meta->data_type = data_type;
 
   // allocate tensors in simulator
   sim->free_all();
-  float *a_ptr = (float *)sim->allocate(sub_input0.get_volume(), DT_FLOAT);
+  void *a_ptr = sim->allocate(sub_input0.get_volume(), data_type);
   assert(a_ptr != NULL);
-  float *b_ptr = (float *)sim->allocate(sub_input1.get_volume(), DT_FLOAT);
+  void *b_ptr = sim->allocate(sub_input1.get_volume(), data_type);
   assert(b_ptr != NULL);
-  float *c_ptr = NULL;
+  void *c_ptr = NULL;
   cost_metrics.inputs_memory += cost_metrics.total_mem_diff_from(sim->offset);
 
-  float *out_ptr = (float *)sim->allocate(sub_output.get_volume(), DT_FLOAT);
+  void *out_ptr = sim->allocate(sub_output.get_volume(), data_type);
   assert(out_ptr != NULL);
   cost_metrics.outputs_memory += cost_metrics.total_mem_diff_from(sim->offset);
 
@@ -546,15 +607,12 @@ bool BatchMatmul::measure_operator_cost(Simulator *sim,
   };
 
   if (sim->computationMode == COMP_MODE_TRAINING) {
-    float *a_grad_ptr =
-        (float *)sim->allocate(sub_input0.get_volume(), DT_FLOAT);
-    float *b_grad_ptr =
-        (float *)sim->allocate(sub_input1.get_volume(), DT_FLOAT);
-    float *c_grad_ptr = NULL;
+    void *a_grad_ptr = sim->allocate(sub_input0.get_volume(), data_type);
+    void *b_grad_ptr = sim->allocate(sub_input1.get_volume(), data_type);
+    void *c_grad_ptr = NULL;
     cost_metrics.inputs_memory += cost_metrics.total_mem_diff_from(sim->offset);
 
-    float *out_grad_ptr =
-        (float *)sim->allocate(sub_output.get_volume(), DT_FLOAT);
+    void *out_grad_ptr = sim->allocate(sub_output.get_volume(), data_type);
     assert(out_grad_ptr != NULL);
     cost_metrics.outputs_memory +=
         cost_metrics.total_mem_diff_from(sim->offset);
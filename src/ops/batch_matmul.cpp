@@ -26,10 +26,10 @@ O: (batch, n, m)
 O = A * B
 */
 void BatchMatmul::forward_kernel(BatchMatmulMeta const *meta,
-                                 float *o_ptr,
-                                 float const *a_ptr,
-                                 float const *b_ptr,
-                                 float const *c_ptr,
+                                 void *o_ptr,
+                                 void const *a_ptr,
+                                 void const *b_ptr,
+                                 void const *c_ptr,
                                  int m,
                                  int n,
                                  int k,
@@ -40,6 +40,7 @@ void BatchMatmul::forward_kernel(BatchMatmulMeta const *meta,
                                  int seq_length) {
   checkCUDA(hipblasSetStream(meta->handle.blas, stream));
   checkCUDNN(miopenSetStream(meta->handle.dnn, stream));
+  assert(meta->data_type == DT_FLOAT);
 
   // int a_stride = n * k;
   // int b_stride = m * k;
@@ -80,14 +81,14 @@ void BatchMatmul::forward_kernel(BatchMatmulMeta const *meta,
                                        n,
                                        k,
                                        &alpha,
-                                       b_ptr,
+                                       (float const *)b_ptr,
                                        ldb,
                                        strideB,
-                                       a_ptr,
+                                       (float const *)a_ptr,
                                        lda,
                                        strideA,
                                        &beta,
-                                       o_ptr,
+                                       (float *)o_ptr,
                                        ldo,
                                        strideO,
                                        batch));
@@ -97,10 +98,10 @@ void BatchMatmul::forward_kernel(BatchMatmulMeta const *meta,
 
 /*static*/
 void BatchMatmul::forward_kernel_wrapper(BatchMatmulMeta const *meta,
-                                         float *o_ptr,
-                                         float const *a_ptr,
-                                         float const *b_ptr,
-                                         float const *c_ptr,
+                                         void *o_ptr,
+                                         void const *a_ptr,
+                                         void const *b_ptr,
+                                         void const *c_ptr,
                                          int m,
                                          int n,
                                          int k,
@@ -149,13 +150,13 @@ AGrad = OGrad * B^T
 BGrad = A^T * OGrad
 */
 void BatchMatmul::backward_kernel(BatchMatmulMeta const *meta,
-                                  float const *o_ptr,
-                                  float const *o_grad_ptr,
-                                  float const *a_ptr,
-                                  float *a_grad_ptr,
-                                  float const *b_ptr,
-                                  float *b_grad_ptr,
-                                  float *c_grad_ptr,
+                                  void const *o_ptr,
+                                  void const *o_grad_ptr,
+                                  void const *a_ptr,
+                                  void *a_grad_ptr,
+                                  void const *b_ptr,
+                                  void *b_grad_ptr,
+                                  void *c_grad_ptr,
                                   int m,
                                   int n,
                                   int k,
@@ -163,6 +164,7 @@ void BatchMatmul::backward_kernel(BatchMatmulMeta const *meta,
                                   hipStream_t stream) {
   checkCUDA(hipblasSetStream(meta->handle.blas, stream));
   checkCUDNN(miopenSetStream(meta->handle.dnn, stream));
+  assert(meta->data_type == DT_FLOAT);
 
   int a_stride = n * k;
   int b_stride = m * k;
@@ -175,14 +177,14 @@ void BatchMatmul::backward_kernel(BatchMatmulMeta const *meta,
                                        n,
                                        m,
                                        &alpha,
-                                       b_ptr,
+                                       (float const *)b_ptr,
                                        m,
                                        b_stride,
-                                       o_grad_ptr,
+                                       (float const *)o_grad_ptr,
                                        m,
                                        o_stride,
                                        &alpha,
-                                       a_grad_ptr,
+                                       (float *)a_grad_ptr,
                                        k,
                                        a_stride,
                                        batch));
@@ -193,14 +195,14 @@ void BatchMatmul::backward_kernel(BatchMatmulMeta const *meta,
                                        k,
                                        n,
                                        &alpha,
-                                       o_grad_ptr,
+                                       (float const *)o_grad_ptr,
                                        m,
                                        o_stride,
-                                       a_ptr,
+                                       (float const *)a_ptr,
                                        k,
                                        a_stride,
                                        &alpha,
-                                       b_grad_ptr,
+                                       (float *)b_grad_ptr,
                                        m,
                                        b_stride,
                                        batch));
@@ -209,13 +211,13 @@ void BatchMatmul::backward_kernel(BatchMatmulMeta const *meta,
 
 /*static*/
 void BatchMatmul::backward_kernel_wrapper(BatchMatmulMeta const *meta,
-                                          float const *o_ptr,
-                                          float const *o_grad_ptr,
-                                          float const *a_ptr,
-                                          float *a_grad_ptr,
-                                          float const *b_ptr,
-                                          float *b_grad_ptr,
-                                          float *c_grad_ptr,
+                                          void const *o_ptr,
+                                          void const *o_grad_ptr,
+                                          void const *a_ptr,
+                                          void *a_grad_ptr,
+                                          void const *b_ptr,
+                                          void *b_grad_ptr,
+                                          void *c_grad_ptr,
                                           int m,
                                           int n,
                                           int k,
@@ -18,6 +18,17 @@
 
 namespace FlexFlow {
 
+// Half inputs are multiplied and accumulated in float
+#if CUDA_VERSION >= 11000
+static cublasComputeType_t get_compute_type(void) {
+  return CUBLAS_COMPUTE_32F;
+}
+#else
+static cudaDataType_t get_compute_type(void) {
+  return CUDA_R_32F;
+}
+#endif
+
 /*
 A: (batch, n, k)
 B: (batch, k, m)
@@ -25,10 +36,10 @@ O: (batch, n, m)
 O = A * B
 */
 void BatchMatmul::forward_kernel(BatchMatmulMeta const *meta,
-                                 float *o_ptr,
-                                 float const *a_ptr,
-                                 float const *b_ptr,
-                                 float const *c_ptr,
+                                 void *o_ptr,
+                                 void const *a_ptr,
+                                 void const *b_ptr,
+                                 void const *c_ptr,
                                  int m,
                                  int n,
                                  int k,
@@ -72,34 +83,40 @@ void BatchMatmul::forward_kernel(BatchMatmulMeta const *meta,
   }
 
   float alpha = 1.0f, beta = 0.0f;
-  checkCUDA(cublasSgemmStridedBatched(meta->handle.blas,
-                                      CUBLAS_OP_N,
-                                      CUBLAS_OP_N,
-                                      m,
-                                      n,
-                                      k,
-                                      &alpha,
-                                      b_ptr,
-                                      ldb,
-                                      strideB,
-                                      a_ptr,
-                                      lda,
-                                      strideA,
-                                      &beta,
-                                      o_ptr,
-                                      ldo,
-                                      strideO,
-                                      batch));
+  cudaDataType_t data_type = ff_to_cuda_datatype(meta->data_type);
+  checkCUDA(cublasGemmStridedBatchedEx(meta->handle.blas,
+                                       CUBLAS_OP_N,
+                                       CUBLAS_OP_N,
+                                       m,
+                                       n,
+                                       k,
+                                       &alpha,
+                                       b_ptr,
+                                       data_type,
+                                       ldb,
+                                       strideB,
+                                       a_ptr,
+                                       data_type,
+                                       lda,
+                                       strideA,
+                                       &beta,
+                                       o_ptr,
+                                       data_type,
+                                       ldo,
+                                       strideO,
+                                       batch,
+                                       get_compute_type(),
+                                       CUBLAS_GEMM_DEFAULT_TENSOR_OP));
   // current assume c is null
   assert(c_ptr == NULL);
 }
 
 /*static*/
 void BatchMatmul::forward_kernel_wrapper(BatchMatmulMeta const *meta,
-                                         float *o_ptr,
-                                         float const *a_ptr,
-                                         float const *b_ptr,
-                                         float const *c_ptr,
+                                         void *o_ptr,
+                                         void const *a_ptr,
+                                         void const *b_ptr,
+                                         void const *c_ptr,
                                          int m,
                                          int n,
                                          int k,
@@ -148,13 +165,13 @@ AGrad = OGrad * B^T
 BGrad = A^T * OGrad
 */
 void BatchMatmul::backward_kernel(BatchMatmulMeta const *meta,
-                                  float const *o_ptr,
-                                  float const *o_grad_ptr,
-                                  float const *a_ptr,
-                                  float *a_grad_ptr,
-                                  float const *b_ptr,
-                                  float *b_grad_ptr,
-                                  float *c_grad_ptr,
+                                  void const *o_ptr,
+                                  void const *o_grad_ptr,
+                                  void const *a_ptr,
+                                  void *a_grad_ptr,
+                                  void const *b_ptr,
+                                  void *b_grad_ptr,
+                                  void *c_grad_ptr,
                                   int m,
                                   int n,
                                   int k,
@@ -167,54 +184,65 @@ void BatchMatmul::backward_kernel(BatchMatmulMeta const *meta,
   int b_stride = m * k;
   int o_stride = n * m;
   float alpha = 1.0f;
-  checkCUDA(cublasSgemmStridedBatched(meta->handle.blas,
-                                      CUBLAS_OP_T,
-                                      CUBLAS_OP_N,
-                                      k,
-                                      n,
-                                      m,
-                                      &alpha,
-                                      b_ptr,
-                                      m,
-                                      b_stride,
-                                      o_grad_ptr,
-                                      m,
-                                      o_stride,
-                                      &alpha,
-                                      a_grad_ptr,
-                                      k,
-                                      a_stride,
-                                      batch));
-  checkCUDA(cublasSgemmStridedBatched(meta->handle.blas,
-                                      CUBLAS_OP_N,
-                                      CUBLAS_OP_T,
-                                      m,
-                                      k,
-                                      n,
-                                      &alpha,
-                                      o_grad_ptr,
-                                      m,
-                                      o_stride,
-                                      a_ptr,
-                                      k,
-                                      a_stride,
-                                      &alpha,
-                                      b_grad_ptr,
-                                      m,
-                                      b_stride,
-                                      batch));
+  cudaDataType_t data_type = ff_to_cuda_datatype(meta->data_type);
+  checkCUDA(cublasGemmStridedBatchedEx(meta->handle.blas,
+                                       CUBLAS_OP_T,
+                                       CUBLAS_OP_N,
+                                       k,
+                                       n,
+                                       m,
+                                       &alpha,
+                                       b_ptr,
+                                       data_type,
+                                       m,
+                                       b_stride,
+                                       o_grad_ptr,
+                                       data_type,
+                                       m,
+                                       o_stride,
+                                       &alpha,
+                                       a_grad_ptr,
+                                       data_type,
+                                       k,
+                                       a_stride,
+                                       batch,
+                                       get_compute_type(),
+                                       CUBLAS_GEMM_DEFAULT_TENSOR_OP));
+  checkCUDA(cublasGemmStridedBatchedEx(meta->handle.blas,
+                                       CUBLAS_OP_N,
+                                       CUBLAS_OP_T,
+                                       m,
+                                       k,
+                                       n,
+                                       &alpha,
+                                       o_grad_ptr,
+                                       data_type,
+                                       m,
+                                       o_stride,
+                                       a_ptr,
+                                       data_type,
+                                       k,
+                                       a_stride,
+                                       &alpha,
+                                       b_grad_ptr,
+                                       data_type,
+                                       m,
+                                       b_stride,
+                                       batch,
+                                       get_compute_type(),
+                                       CUBLAS_GEMM_DEFAULT_TENSOR_OP));
   assert(c_grad_ptr == NULL);
 }
 
 /*static*/
 void BatchMatmul::backward_kernel_wrapper(BatchMatmulMeta const *meta,
-                                          float const *o_ptr,
-                                          float const *o_grad_ptr,
-                                          float const *a_ptr,
-                                          float *a_grad_ptr,
-                                          float const *b_ptr,
-                                          float *b_grad_ptr,
-                                          float *c_grad_ptr,
+                                          void const *o_ptr,
+                                          void const *o_grad_ptr,
+                                          void const *a_ptr,
+                                          void *a_grad_ptr,
+                                          void const *b_ptr,
+                                          void *b_grad_ptr,
+                                          void *c_grad_ptr,
                                           int m,
                                           int n,
                                           int k,
@@ -183,6 +183,7 @@ void Cache::forward(FFModel const &ff) {
                                 false /*must*/,
                                 0 /*mapper_id*/,
                                 FFConfig::get_hash_id(std::string(name)));
+  set_priority_for_forward(launcher_update);
   launcher_update.add_region_requirement(RegionRequirement(inputs[0]->part,
                                                            0 /*projection id*/,
                                                            READ_WRITE,
@@ -216,6 +217,7 @@ void Cache::forward(FFModel const &ff) {
                                false /*must*/,
                                0 /*mapper_id*/,
                                FFConfig::get_hash_id(std::string(name)));
+    set_priority_for_forward(launcher_fwd);
     launcher_fwd.add_region_requirement(RegionRequirement(outputs[0]->part,
                                                           0 /*projection id*/,
                                                           WRITE_ONLY,
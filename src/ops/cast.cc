@@ -163,6 +163,7 @@ void Cast::forward(FFModel const &ff) {
                          false /*must*/,
                          0 /*mapper_id*/,
                          outputs[0]->machine_view.hash());
+  set_priority_for_forward(launcher);
   launcher.add_region_requirement(RegionRequirement(inputs[0]->part,
                                                     0 /*projection id*/,
                                                     READ_ONLY,
@@ -219,6 +220,18 @@ void Cast::forward_task(Task const *task,
                         Context ctx,
                         Runtime *runtime) {
   CastMeta const *m = *((CastMeta **)task->local_args);
+  if (m->input_data_type == DT_HALF || m->output_data_type == DT_HALF) {
+    // Half precision tensors are only cast to and from float
+    if (m->input_data_type == DT_HALF && m->output_data_type == DT_FLOAT) {
+      Cast::forward_task_with_2_type<half, float>(task, regions, ctx, runtime);
+    } else if (m->input_data_type == DT_FLOAT &&
+               m->output_data_type == DT_HALF) {
+      Cast::forward_task_with_2_type<float, half>(task, regions, ctx, runtime);
+    } else {
+      assert(false && "Unsupported half precision cast");
+    }
+    return;
+  }
   if (m->input_data_type == DT_FLOAT) {
     Cast::forward_task_with_1_type<float>(task, regions, ctx, runtime);
   } else if (m->input_data_type == DT_DOUBLE) {
@@ -243,6 +256,7 @@ void Cast::backward(FFModel const &ff) {
                          false /*must*/,
                          0 /*mapper_id*/,
                          outputs[0]->machine_view.hash());
+  set_priority_for_backward(launcher);
   launcher.add_region_requirement(RegionRequirement(outputs[0]->part_grad,
                                                     0 /*projection id*/,
                                                     READ_ONLY,
@@ -299,6 +313,17 @@ void Cast::backward_task(Task const *task,
                          Context ctx,
                          Runtime *runtime) {
   CastMeta const *m = *((CastMeta **)task->local_args);
+  if (m->input_data_type == DT_HALF || m->output_data_type == DT_HALF) {
+    if (m->output_data_type == DT_FLOAT && m->input_data_type == DT_HALF) {
+      Cast::backward_task_with_2_type<float, half>(task, regions, ctx, runtime);
+    } else if (m->output_data_type == DT_HALF &&
+               m->input_data_type == DT_FLOAT) {
+      Cast::backward_task_with_2_type<half, float>(task, regions, ctx, runtime);
+    } else {
+      assert(false && "Unsupported half precision cast");
+    }
+    return;
+  }
   if (m->output_data_type == DT_FLOAT) {
     Cast::backward_task_with_1_type<float>(task, regions, ctx, runtime);
   } else if (m->output_data_type == DT_DOUBLE) {
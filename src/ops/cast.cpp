@@ -126,6 +126,13 @@ template void Cast::forward_kernel_wrapper<int64_t, int32_t>(
 template void Cast::forward_kernel_wrapper<int64_t, int64_t>(
     int64_t const *input_ptr, int64_t *output_ptr, size_t volume);
 
+template void Cast::forward_kernel_wrapper<half, float>(half const *input_ptr,
+                                                        float *output_ptr,
+                                                        size_t volume);
+template void Cast::forward_kernel_wrapper<float, half>(float const *input_ptr,
+                                                        half *output_ptr,
+                                                        size_t volume);
+
 template void Cast::backward_kernel_wrapper<float, float>(float const *src_ptr,
                                                           float *dst_ptr,
                                                           size_t volume);
@@ -164,4 +171,11 @@ template void Cast::backward_kernel_wrapper<int64_t, int32_t>(
 template void Cast::backward_kernel_wrapper<int64_t, int64_t>(
     int64_t const *src_ptr, int64_t *dst_ptr, size_t volume);
 
+template void Cast::backward_kernel_wrapper<half, float>(half const *src_ptr,
+                                                         float *dst_ptr,
+                                                         size_t volume);
+template void Cast::backward_kernel_wrapper<float, half>(float const *src_ptr,
+                                                         half *dst_ptr,
+                                                         size_t volume);
+
 }; // namespace FlexFlow
@@ -219,6 +219,7 @@ void Concat::forward(FFModel const &ff) {
                          false /*must*/,
                          0 /*mapper_id*/,
                          outputs[0]->machine_view.hash());
+  set_priority_for_forward(launcher);
   launcher.add_region_requirement(RegionRequirement(outputs[0]->part,
                                                     0 /*projection id*/,
                                                     WRITE_ONLY,
@@ -280,6 +281,7 @@ void Concat::backward(FFModel const &ff) {
                          false /*must*/,
                          0 /*mapper_id*/,
                          outputs[0]->machine_view.hash());
+  set_priority_for_backward(launcher);
   launcher.add_region_requirement(RegionRequirement(outputs[0]->part_grad,
                                                     0 /*projection id*/,
                                                     READ_ONLY,
@@ -0,0 +1,138 @@
+/* Copyright 2020 Stanford
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flexflow/ops/aggregate.h"
+#include "flexflow/utils/cpu_helper.h"
+#include "flexflow/utils/moe_routing.h"
+
+namespace FlexFlow {
+
+// Samples are split across threads in chunks of this many
+size_t const AGGREGATE_PARALLEL_GRAIN = 32;
+
+/*static*/
+void Aggregate::forward_kernel_wrapper(AggregateMeta const *m,
+                                       float **exp_preds,
+                                       int const *acc_gate_assign_ptr,
+                                       float const *acc_gate_pred_ptr,
+                                       float *acc_output_ptr,
+                                       int n,
+                                       int const k,
+                                       int rows,
+                                       int const batch_size,
+                                       int out_dim) {
+  MoeRouting routing;
+  moe_route(acc_gate_assign_ptr, k * batch_size, n, rows, routing);
+  cpu_parallel_for(
+      batch_size, AGGREGATE_PARALLEL_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+          float *output = acc_output_ptr + i * out_dim;
+          assign_kernel<float>(output, out_dim, 0.0f);
+          for (int j = 0; j < k; j++) {
+            int row = routing.rows[i * k + j];
+            if (row < 0) {
+              // dropped sample
+              continue;
+            }
+            float const *pred =
+                exp_preds[acc_gate_assign_ptr[i * k + j]] + row * out_dim;
+            float gate = acc_gate_pred_ptr[i * k + j];
+            for (int o = 0; o < out_dim; o++) {
+              output[o] += gate * pred[o];
+            }
+          }
+        }
+      });
+}
+
+/*static*/
+void Aggregate::backward_kernel_wrapper(AggregateMeta const *m,
+                                        float **exp_preds,
+                                        float **exp_grads,
+                                        int const *acc_gate_assign_ptr,
+                                        int const *acc_true_gate_assign_ptr,
+                                        float const *acc_gate_pred_ptr,
+                                        float *full_acc_gate_grad_ptr,
+                                        float const *acc_output_grad_ptr,
+                                        int n,
+                                        int const k,
+                                        int rows,
+                                        float lambda_bal,
+                                        int const batch_size,
+                                        int out_dim) {
+  // rows and expert counts follow the true assignment, which Group_by used
+  MoeRouting routing;
+  moe_route(acc_true_gate_assign_ptr, k * batch_size, n, rows, routing);
+  float bal_scale = (lambda_bal * n) / batch_size;
+  // every pair owns its expert row, so samples can be split across threads
+  cpu_parallel_for(
+      batch_size, AGGREGATE_PARALLEL_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+          bool cache_corr = true;
+          for (int j = 0; j < k; j++) {
+            if (acc_true_gate_assign_ptr[i * k + j] !=
+                acc_gate_assign_ptr[i * k + j]) {
+              cache_corr = false;
+            }
+          }
+          float const *output_grad = acc_output_grad_ptr + i * out_dim;
+          float *gate_grads = full_acc_gate_grad_ptr + i * n;
+          for (int j = 0; j < k; j++) {
+            int row = routing.rows[i * k + j];
+            if (row < 0) {
+              continue;
+            }
+            int expert = acc_true_gate_assign_ptr[i * k + j];
+            // expert gradients
+            float gate = acc_gate_pred_ptr[i * k + j];
+            float *exp_grad = exp_grads[expert] + row * out_dim;
+            for (int o = 0; o < out_dim; o++) {
+              exp_grad[o] += gate * output_grad[o];
+            }
+            // gate gradient
+            if (cache_corr) {
+              float const *exp_pred = exp_preds[expert] + row * out_dim;
+              float res = 0.0f;
+              for (int o = 0; o < out_dim; o++) {
+                res += output_grad[o] * exp_pred[o];
+              }
+              gate_grads[acc_gate_assign_ptr[i * k + j]] += res;
+            }
+          }
+          // balance term
+          for (int e = 0; e < n; e++) {
+            gate_grads[e] += bal_scale * routing.counts[e];
+          }
+          // make 0 mean
+          float mean = 0.0f;
+          for (int e = 0; e < n; e++) {
+            mean += gate_grads[e];
+          }
+          mean /= n;
+          for (int e = 0; e < n; e++) {
+            gate_grads[e] -= mean;
+          }
+        }
+      });
+}
+
+AggregateMeta::AggregateMeta(FFHandler handler, int n) : OpMeta(handler) {
+  // Expert pointers are passed directly on the CPU
+  dev_exp_preds = nullptr;
+  dev_exp_grads = nullptr;
+}
+AggregateMeta::~AggregateMeta(void) {}
+
+}; // namespace FlexFlow
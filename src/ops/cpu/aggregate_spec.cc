@@ -0,0 +1,145 @@
+/* Copyright 2020 Stanford
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flexflow/ops/aggregate_spec.h"
+#include "flexflow/utils/cpu_helper.h"
+#include "flexflow/utils/moe_routing.h"
+
+namespace FlexFlow {
+
+// Samples are split across threads in chunks of this many
+size_t const AGGREGATE_SPEC_PARALLEL_GRAIN = 32;
+
+/*static*/
+void AggregateSpec::forward_kernel_wrapper(AggregateSpecMeta const *m,
+                                           float **exp_preds,
+                                           int const *acc_gate_assign_ptr,
+                                           float *acc_output_ptr,
+                                           int n,
+                                           int const k,
+                                           int rows,
+                                           int const batch_size,
+                                           int out_dim) {
+  MoeRouting routing;
+  moe_route(acc_gate_assign_ptr, k * batch_size, n, rows, routing);
+  cpu_parallel_for(
+      (size_t)k * batch_size,
+      AGGREGATE_SPEC_PARALLEL_GRAIN,
+      [&](size_t begin, size_t end) {
+        for (size_t p = begin; p < end; p++) {
+          float *output = acc_output_ptr + p * out_dim;
+          int row = routing.rows[p];
+          if (row < 0) {
+            // dropped sample
+            assign_kernel<float>(output, out_dim, 0.0f);
+            continue;
+          }
+          copy_kernel<float>(output,
+                             exp_preds[acc_gate_assign_ptr[p]] + row * out_dim,
+                             out_dim);
+        }
+      });
+}
+
+/*static*/
+void AggregateSpec::backward_kernel_wrapper(AggregateSpecMeta const *m,
+                                            float **exp_grads,
+                                            int const *acc_gate_assign_ptr,
+                                            int const *acc_true_gate_assign_ptr,
+                                            float const *acc_gate_pred_ptr,
+                                            float *acc_full_gate_grad_ptr,
+                                            float const *acc_output_grad_ptr,
+                                            int n,
+                                            int const k,
+                                            int rows,
+                                            float lambda_bal,
+                                            int const batch_size,
+                                            int out_dim) {
+  // rows and expert counts follow the true assignment, which Group_by used
+  MoeRouting routing;
+  moe_route(acc_true_gate_assign_ptr, k * batch_size, n, rows, routing);
+  float bal_scale = (lambda_bal * n) / batch_size;
+  // every pair owns its expert row, so samples can be split across threads
+  cpu_parallel_for(
+      batch_size,
+      AGGREGATE_SPEC_PARALLEL_GRAIN,
+      [&](size_t begin, size_t end) {
+        std::vector<float> err(k);
+        for (size_t i = begin; i < end; i++) {
+          bool cache_corr = true;
+          for (int j = 0; j < k; j++) {
+            if (acc_true_gate_assign_ptr[i * k + j] !=
+                acc_gate_assign_ptr[i * k + j]) {
+              cache_corr = false;
+            }
+          }
+          float *gate_grads = acc_full_gate_grad_ptr + i * n;
+          // expert gradients
+          for (int j = 0; j < k; j++) {
+            int row = routing.rows[i * k + j];
+            if (row < 0) {
+              continue;
+            }
+            float const *output_grad =
+                acc_output_grad_ptr + (i * k + j) * out_dim;
+            float *exp_grad =
+                exp_grads[acc_true_gate_assign_ptr[i * k + j]] + row * out_dim;
+            for (int o = 0; o < out_dim; o++) {
+              exp_grad[o] += acc_gate_pred_ptr[i * k + j] * output_grad[o];
+            }
+          }
+          // gate gradients: pred(i,j) - err(i,j) / sum_l err(l,j), where
+          // the errors are squared L2 norms of the output gradients
+          if (cache_corr) {
+            float err_sum = 0.0f;
+            for (int j = 0; j < k; j++) {
+              float const *output_grad =
+                  acc_output_grad_ptr + (i * k + j) * out_dim;
+              err[j] = 0.0f;
+              for (int o = 0; o < out_dim; o++) {
+                err[j] += output_grad[o] * output_grad[o] * batch_size;
+              }
+              err_sum += err[j];
+            }
+            for (int j = 0; j < k; j++) {
+              gate_grads[acc_gate_assign_ptr[i * k + j]] +=
+                  err[j] / err_sum - (1.0f - acc_gate_pred_ptr[i * k + j]);
+            }
+          }
+          // balance term
+          for (int e = 0; e < n; e++) {
+            gate_grads[e] += bal_scale * routing.counts[e];
+          }
+          // make 0 mean
+          float mean = 0.0f;
+          for (int e = 0; e < n; e++) {
+            mean += gate_grads[e];
+          }
+          mean /= n;
+          for (int e = 0; e < n; e++) {
+            gate_grads[e] -= mean;
+          }
+        }
+      });
+}
+
+AggregateSpecMeta::AggregateSpecMeta(FFHandler handler, int n)
+    : OpMeta(handler) {
+  // Expert pointers are passed directly on the CPU
+  dev_region_ptrs = nullptr;
+}
+AggregateSpecMeta::~AggregateSpecMeta(void) {}
+
+}; // namespace FlexFlow
@@ -0,0 +1,608 @@
+/* Copyright 2020 Stanford
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flexflow/ops/attention.h"
+#include "flexflow/utils/cpu_helper.h"
+#include <cmath>
+#include <mutex>
+
+namespace FlexFlow {
+
+// declare Legion names
+using Legion::coord_t;
+using Legion::Memory;
+
+namespace {
+
+// Queries and keys are processed in tiles of this many, so that a tile of
+// scores stays in cache and is never materialized for the whole sequence
+int const ATTN_TILE_Q = 64;
+int const ATTN_TILE_K = 64;
+
+// Valid queries and keys of one sample: positions past its sequence length
+// are padding, and a causal query t only attends to keys s <= t
+struct AttnLengths {
+  AttnLengths(MultiHeadAttentionMeta const *m, int seq_length)
+      : q_len(m->qoSeqLength), kv_len(m->kvSeqLength), causal(m->causal) {
+    if (seq_length >= 0) {
+      q_len = std::min(q_len, seq_length);
+      kv_len = std::min(kv_len, seq_length);
+    }
+  }
+  // keys [0, key_end(t)) are visible to query t
+  int key_end(int t) const {
+    return causal ? std::min(kv_len, t + 1) : kv_len;
+  }
+  int q_len, kv_len;
+  bool causal;
+};
+
+// Replaces a tile of scores (tk keys by tq queries, column-major) with
+// exp(score - shift[t]), zeroing masked entries
+void exp_scores(float *scores,
+                float const *shift,
+                AttnLengths const &len,
+                int t0,
+                int tq,
+                int s0,
+                int tk) {
+  for (int t = 0; t < tq; t++) {
+    float *col = scores + (size_t)t * tk;
+    int end = std::min(tk, len.key_end(t0 + t) - s0);
+    for (int s = 0; s < std::max(end, 0); s++) {
+      col[s] = expf(col[s] - shift[t]);
+    }
+    for (int s = std::max(end, 0); s < tk; s++) {
+      col[s] = 0.0f;
+    }
+  }
+}
+
+// attn = softmax(q * k^T) * v for one (sample, head) pair, with a softmax
+// scaler of 1 as in cuDNN. Key tiles are folded into running row maxima
+// and sums (online softmax), and lse receives log(sum(exp(scores)))
+void attention_forward(float const *q,
+                       float const *k,
+                       float const *v,
+                       float *attn,
+                       float *lse,
+                       int Pq,
+                       int Pv,
+                       int Lq,
+                       AttnLengths const &len) {
+  assign_kernel<float>(attn, (size_t)Lq * Pv, 0.0f);
+  assign_kernel<float>(lse, Lq, 0.0f);
+  int num_q_tiles = (len.q_len + ATTN_TILE_Q - 1) / ATTN_TILE_Q;
+  cpu_parallel_for(num_q_tiles, 1, [&](size_t begin, size_t end) {
+    std::vector<float> scores((size_t)ATTN_TILE_Q * ATTN_TILE_K);
+    std::vector<float> row_max(ATTN_TILE_Q), row_sum(ATTN_TILE_Q);
+    std::vector<float> new_max(ATTN_TILE_Q);
+    for (size_t tile = begin; tile < end; tile++) {
+      int t0 = tile * ATTN_TILE_Q;
+      int tq = std::min(ATTN_TILE_Q, len.q_len - t0);
+      float *acc = attn + (size_t)t0 * Pv;
+      std::fill(row_max.begin(), row_max.end(), -INFINITY);
+      std::fill(row_sum.begin(), row_sum.end(), 0.0f);
+      int s_end = len.key_end(t0 + tq - 1);
+      for (int s0 = 0; s0 < s_end; s0 += ATTN_TILE_K) {
+        int tk = std::min(ATTN_TILE_K, s_end - s0);
+        cpu_sgemm(true,
+                  false,
+                  tk,
+                  tq,
+                  Pq,
+                  1.0f,
+                  k + (size_t)s0 * Pq,
+                  Pq,
+                  q + (size_t)t0 * Pq,
+                  Pq,
+                  0.0f,
+                  scores.data(),
+                  tk);
+        for (int t = 0; t < tq; t++) {
+          float const *col = scores.data() + (size_t)t * tk;
+          int key_end = std::min(tk, len.key_end(t0 + t) - s0);
+          float m = row_max[t];
+          for (int s = 0; s < key_end; s++) {
+            m = std::max(m, col[s]);
+          }
+          new_max[t] = m;
+        }
+        exp_scores(scores.data(), new_max.data(), len, t0, tq, s0, tk);
+        // rescale what was accumulated under the previous maxima
+        for (int t = 0; t < tq; t++) {
+          if (new_max[t] == -INFINITY) {
+            continue;
+          }
+          float scale = expf(row_max[t] - new_max[t]);
+          float const *col = scores.data() + (size_t)t * tk;
+          float sum = 0.0f;
+          for (int s = 0; s < tk; s++) {
+            sum += col[s];
+          }
+          row_sum[t] = row_sum[t] * scale + sum;
+          row_max[t] = new_max[t];
+          if (scale != 1.0f) {
+            float *out = acc + (size_t)t * Pv;
+            for (int p = 0; p < Pv; p++) {
+              out[p] *= scale;
+            }
+          }
+        }
+        cpu_sgemm(false,
+                  false,
+                  Pv,
+                  tq,
+                  tk,
+                  1.0f,
+                  v + (size_t)s0 * Pv,
+                  Pv,
+                  scores.data(),
+                  tk,
+                  1.0f,
+                  acc,
+                  Pv);
+      }
+      for (int t = 0; t < tq; t++) {
+        if (row_sum[t] == 0.0f) {
+          // no visible key, e.g. an empty sequence
+          continue;
+        }
+        float *out = acc + (size_t)t * Pv;
+        for (int p = 0; p < Pv; p++) {
+          out[p] /= row_sum[t];
+        }
+        lse[t0 + t] = row_max[t] + logf(row_sum[t]);
+      }
+    }
+  });
+}
+
+// Gradients of attention_forward given d_attn, recomputing the
+// probabilities of each tile from lse. Key tiles are split across threads,
+// which own their rows of d_k and d_v and sum their share of d_q
+void attention_backward(float const *q,
+                        float const *k,
+                        float const *v,
+                        float const *attn,
+                        float const *lse,
+                        float const *d_attn,
+                        float *d_q,
+                        float *d_k,
+                        float *d_v,
+                        int Pq,
+                        int Pv,
+                        int Lq,
+                        int Lk,
+                        AttnLengths const &len) {
+  assign_kernel<float>(d_q, (size_t)Lq * Pq, 0.0f);
+  assign_kernel<float>(d_k, (size_t)Lk * Pq, 0.0f);
+  assign_kernel<float>(d_v, (size_t)Lk * Pv, 0.0f);
+  // delta[t] = sum_s probs[t][s] * d_probs[t][s] = dot(attn[t], d_attn[t])
+  std::vector<float> delta(len.q_len);
+  for (int t = 0; t < len.q_len; t++) {
+    float dot = 0.0f;
+    for (int p = 0; p < Pv; p++) {
+      dot += attn[(size_t)t * Pv + p] * d_attn[(size_t)t * Pv + p];
+    }
+    delta[t] = dot;
+  }
+  int num_k_tiles = (len.kv_len + ATTN_TILE_K - 1) / ATTN_TILE_K;
+  std::mutex d_q_mutex;
+  cpu_parallel_for(num_k_tiles, 1, [&](size_t begin, size_t end) {
+    std::vector<float> probs((size_t)ATTN_TILE_Q * ATTN_TILE_K);
+    std::vector<float> d_scores((size_t)ATTN_TILE_Q * ATTN_TILE_K);
+    std::vector<float> part_d_q((size_t)len.q_len * Pq, 0.0f);
+    for (size_t tile = begin; tile < end; tile++) {
+      int s0 = tile * ATTN_TILE_K;
+      int tk = std::min(ATTN_TILE_K, len.kv_len - s0);
+      // causal queries before s0 see none of these keys
+      int first_t = len.causal ? s0 / ATTN_TILE_Q * ATTN_TILE_Q : 0;
+      for (int t0 = first_t; t0 < len.q_len; t0 += ATTN_TILE_Q) {
+        int tq = std::min(ATTN_TILE_Q, len.q_len - t0);
+        cpu_sgemm(true,
+                  false,
+                  tk,
+                  tq,
+                  Pq,
+                  1.0f,
+                  k + (size_t)s0 * Pq,
+                  Pq,
+                  q + (size_t)t0 * Pq,
+                  Pq,
+                  0.0f,
+                  probs.data(),
+                  tk);
+        exp_scores(probs.data(), lse + t0, len, t0, tq, s0, tk);
+        // d_v += d_attn * probs^T, d_probs = v^T * d_attn
+        cpu_sgemm(false,
+                  true,
+                  Pv,
+                  tk,
+                  tq,
+                  1.0f,
+                  d_attn + (size_t)t0 * Pv,
+                  Pv,
+                  probs.data(),
+                  tk,
+                  1.0f,
+                  d_v + (size_t)s0 * Pv,
+                  Pv);
+        cpu_sgemm(true,
+                  false,
+                  tk,
+                  tq,
+                  Pv,
+                  1.0f,
+                  v + (size_t)s0 * Pv,
+                  Pv,
+                  d_attn + (size_t)t0 * Pv,
+                  Pv,
+                  0.0f,
+                  d_scores.data(),
+                  tk);
+        // softmax backward
+        for (int t = 0; t < tq; t++) {
+          float const *p_col = probs.data() + (size_t)t * tk;
+          float *d_col = d_scores.data() + (size_t)t * tk;
+          for (int s = 0; s < tk; s++) {
+            d_col[s] = p_col[s] * (d_col[s] - delta[t0 + t]);
+          }
+        }
+        // d_q += k * d_scores, d_k += q * d_scores^T
+        cpu_sgemm(false,
+                  false,
+                  Pq,
+                  tq,
+                  tk,
+                  1.0f,
+                  k + (size_t)s0 * Pq,
+                  Pq,
+                  d_scores.data(),
+                  tk,
+                  1.0f,
+                  part_d_q.data() + (size_t)t0 * Pq,
+                  Pq);
+        cpu_sgemm(false,
+                  true,
+                  Pq,
+                  tk,
+                  tq,
+                  1.0f,
+                  q + (size_t)t0 * Pq,
+                  Pq,
+                  d_scores.data(),
+                  tk,
+                  1.0f,
+                  d_k + (size_t)s0 * Pq,
+                  Pq);
+      }
+    }
+    std::lock_guard<std::mutex> lock(d_q_mutex);
+    add_kernel<float>(d_q, part_d_q.data(), part_d_q.size());
+  });
+}
+
+} // namespace
+
+/*static*/
+void MultiHeadAttention::forward_kernel(MultiHeadAttentionMeta const *m,
+                                        float const *query_ptr,
+                                        float const *key_ptr,
+                                        float const *value_ptr,
+                                        float const *weight_ptr,
+                                        float *output_ptr,
+                                        ffStream_t stream,
+                                        int const *seq_lengths) {
+  int const Lq = m->qoSeqLength, Lk = m->kvSeqLength;
+  int const Pq = m->qProjSize, Pk = m->kProjSize, Pv = m->vProjSize;
+  int const Po = m->oProjSize;
+  assign_kernel<float>(output_ptr, (size_t)m->num_samples * Lq * Po, 0.0f);
+  for (int b = 0; b < m->num_samples; b++) {
+    AttnLengths len(m, seq_lengths ? seq_lengths[b] : -1);
+    float const *xq = query_ptr + (size_t)b * Lq * m->qSize;
+    float const *xk = key_ptr + (size_t)b * Lk * m->kSize;
+    float const *xv = value_ptr + (size_t)b * Lk * m->vSize;
+    float *out = output_ptr + (size_t)b * Lq * Po;
+    for (int h = 0; h < m->num_heads; h++) {
+      float const *wq = weight_ptr + h * m->head_weight_size();
+      float const *wk = wq + (size_t)Pq * m->qSize;
+      float const *wv = wk + (size_t)Pk * m->kSize;
+      float const *wo = wv + (size_t)Pv * m->vSize;
+      float *q = (float *)m->reserveSpace +
+                 ((size_t)b * m->num_heads + h) * m->head_reserve_size();
+      float *k = q + (size_t)Lq * Pq;
+      float *v = k + (size_t)Lk * Pk;
+      float *attn = v + (size_t)Lk * Pv;
+      float *lse = attn + (size_t)Lq * Pv;
+      // project the queries, keys and values
+      cpu_sgemm(true,
+                false,
+                Pq,
+                Lq,
+                m->qSize,
+                1.0f,
+                wq,
+                m->qSize,
+                xq,
+                m->qSize,
+                0.0f,
+                q,
+                Pq);
+      cpu_sgemm(true,
+                false,
+                Pk,
+                Lk,
+                m->kSize,
+                1.0f,
+                wk,
+                m->kSize,
+                xk,
+                m->kSize,
+                0.0f,
+                k,
+                Pk);
+      cpu_sgemm(true,
+                false,
+                Pv,
+                Lk,
+                m->vSize,
+                1.0f,
+                wv,
+                m->vSize,
+                xv,
+                m->vSize,
+                0.0f,
+                v,
+                Pv);
+      attention_forward(q, k, v, attn, lse, Pq, Pv, Lq, len);
+      // out += attn * wo^T
+      cpu_sgemm(true, false, Po, Lq, Pv, 1.0f, wo, Pv, attn, Pv, 1.0f, out, Po);
+    }
+  }
+}
+
+/*static*/
+void MultiHeadAttention::forward_kernel_wrapper(MultiHeadAttentionMeta const *m,
+                                                float const *query_ptr,
+                                                float const *key_ptr,
+                                                float const *value_ptr,
+                                                float const *weight_ptr,
+                                                float *output_ptr,
+                                                int const *seq_lengths) {
+  ffStream_t stream;
+  get_legion_stream(&stream);
+
+  double t_start = 0.0;
+  if (m->profiling) {
+    t_start = cpu_wall_time_ms();
+  }
+  MultiHeadAttention::forward_kernel(m,
+                                     query_ptr,
+                                     key_ptr,
+                                     value_ptr,
+                                     weight_ptr,
+                                     output_ptr,
+                                     stream,
+                                     seq_lengths);
+  if (m->profiling) {
+    double elapsed = cpu_wall_time_ms() - t_start;
+    printf("MultiHeadAttention forward time = %.2fms\n", elapsed);
+  }
+}
+
+/*static*/
+void MultiHeadAttention::backward_kernel(MultiHeadAttentionMeta const *m,
+                                         float const *query_ptr,
+                                         float *query_grad_ptr,
+                                         float const *key_ptr,
+                                         float *key_grad_ptr,
+                                         float const *value_ptr,
+                                         float *value_grad_ptr,
+                                         float const *weight_ptr,
+                                         float *weight_grad_ptr,
+                                         float const *output_grad_ptr,
+                                         ffStream_t stream,
+                                         int const *seq_lengths) {
+  int const Lq = m->qoSeqLength, Lk = m->kvSeqLength;
+  int const Pq = m->qProjSize, Pk = m->kProjSize, Pv = m->vProjSize;
+  int const Po = m->oProjSize;
+  // Like cuDNN, data gradients are overwritten and weight gradients are
+  // accumulated
+  assign_kernel<float>(
+      query_grad_ptr, (size_t)m->num_samples * Lq * m->qSize, 0.0f);
+  assign_kernel<float>(
+      key_grad_ptr, (size_t)m->num_samples * Lk * m->kSize, 0.0f);
+  assign_kernel<float>(
+      value_grad_ptr, (size_t)m->num_samples * Lk * m->vSize, 0.0f);
+  std::vector<float> d_attn((size_t)Lq * Pv);
+  std::vector<float> d_q((size_t)Lq * Pq), d_k((size_t)Lk * Pk);
+  std::vector<float> d_v((size_t)Lk * Pv);
+  for (int b = 0; b < m->num_samples; b++) {
+    AttnLengths len(m, seq_lengths ? seq_lengths[b] : -1);
+    float const *xq = query_ptr + (size_t)b * Lq * m->qSize;
+    float const *xk = key_ptr + (size_t)b * Lk * m->kSize;
+    float const *xv = value_ptr + (size_t)b * Lk * m->vSize;
+    float *dxq = query_grad_ptr + (size_t)b * Lq * m->qSize;
+    float *dxk = key_grad_ptr + (size_t)b * Lk * m->kSize;
+    float *dxv = value_grad_ptr + (size_t)b * Lk * m->vSize;
+    float const *d_out = output_grad_ptr + (size_t)b * Lq * Po;
+    for (int h = 0; h < m->num_heads; h++) {
+      float const *wq = weight_ptr + h * m->head_weight_size();
+      float const *wk = wq + (size_t)Pq * m->qSize;
+      float const *wv = wk + (size_t)Pk * m->kSize;
+      float const *wo = wv + (size_t)Pv * m->vSize;
+      float *dwq = weight_grad_ptr + h * m->head_weight_size();
+      float *dwk = dwq + (size_t)Pq * m->qSize;
+      float *dwv = dwk + (size_t)Pk * m->kSize;
+      float *dwo = dwv + (size_t)Pv * m->vSize;
+      float const *q = (float const *)m->reserveSpace +
+                       ((size_t)b * m->num_heads + h) * m->head_reserve_size();
+      float const *k = q + (size_t)Lq * Pq;
+      float const *v = k + (size_t)Lk * Pk;
+      float const *attn = v + (size_t)Lk * Pv;
+      float const *lse = attn + (size_t)Lq * Pv;
+      // output projection
+      cpu_sgemm(
+          false, true, Pv, Po, Lq, 1.0f, attn, Pv, d_out, Po, 1.0f, dwo, Pv);
+      cpu_sgemm(false,
+                false,
+                Pv,
+                Lq,
+                Po,
+                1.0f,
+                wo,
+                Pv,
+                d_out,
+                Po,
+                0.0f,
+                d_attn.data(),
+                Pv);
+      attention_backward(q,
+                         k,
+                         v,
+                         attn,
+                         lse,
+                         d_attn.data(),
+                         d_q.data(),
+                         d_k.data(),
+                         d_v.data(),
+                         Pq,
+                         Pv,
+                         Lq,
+                         Lk,
+                         len);
+      // input projections
+      cpu_sgemm(false,
+                true,
+                m->qSize,
+                Pq,
+                Lq,
+                1.0f,
+                xq,
+                m->qSize,
+                d_q.data(),
+                Pq,
+                1.0f,
+                dwq,
+                m->qSize);
+      cpu_sgemm(false,
+                true,
+                m->kSize,
+                Pk,
+                Lk,
+                1.0f,
+                xk,
+                m->kSize,
+                d_k.data(),
+                Pk,
+                1.0f,
+                dwk,
+                m->kSize);
+      cpu_sgemm(false,
+                true,
+                m->vSize,
+                Pv,
+                Lk,
+                1.0f,
+                xv,
+                m->vSize,
+                d_v.data(),
+                Pv,
+                1.0f,
+                dwv,
+                m->vSize);
+      cpu_sgemm(false,
+                false,
+                m->qSize,
+                Lq,
+                Pq,
+                1.0f,
+                wq,
+                m->qSize,
+                d_q.data(),
+                Pq,
+                1.0f,
+                dxq,
+                m->qSize);
+      cpu_sgemm(false,
+                false,
+                m->kSize,
+                Lk,
+                Pk,
+                1.0f,
+                wk,
+                m->kSize,
+                d_k.data(),
+                Pk,
+                1.0f,
+                dxk,
+                m->kSize);
+      cpu_sgemm(false,
+                false,
+                m->vSize,
+                Lk,
+                Pv,
+                1.0f,
+                wv,
+                m->vSize,
+                d_v.data(),
+                Pv,
+                1.0f,
+                dxv,
+                m->vSize);
+    }
+  }
+}
+
+/*static*/
+void MultiHeadAttention::backward_kernel_wrapper(
+    MultiHeadAttentionMeta const *m,
+    float const *query_ptr,
+    float *query_grad_ptr,
+    float const *key_ptr,
+    float *key_grad_ptr,
+    float const *value_ptr,
+    float *value_grad_ptr,
+    float const *weight_ptr,
+    float *weight_grad_ptr,
+    float const *output_grad_ptr,
+    int const *seq_lengths) {
+  ffStream_t stream;
+  get_legion_stream(&stream);
+
+  double t_start = 0.0;
+  if (m->profiling) {
+    t_start = cpu_wall_time_ms();
+  }
+  MultiHeadAttention::backward_kernel(m,
+                                      query_ptr,
+                                      query_grad_ptr,
+                                      key_ptr,
+                                      key_grad_ptr,
+                                      value_ptr,
+                                      value_grad_ptr,
+                                      weight_ptr,
+                                      weight_grad_ptr,
+                                      output_grad_ptr,
+                                      stream,
+                                      seq_lengths);
+  if (m->profiling) {
+    double elapsed = cpu_wall_time_ms() - t_start;
+    printf("MultiHeadAttention backward time = %.2fms\n", elapsed);
+  }
+}
+
+}; // namespace FlexFlow
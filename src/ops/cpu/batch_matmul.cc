@@ -0,0 +1,231 @@
+/* Copyright 2020 Stanford
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flexflow/ops/batch_matmul.h"
+#include "flexflow/utils/cpu_helper.h"
+
+namespace FlexFlow {
+
+/*
+A: (batch, n, k)
+B: (batch, k, m)
+O: (batch, n, m)
+O = A * B
+*/
+void BatchMatmul::forward_kernel(BatchMatmulMeta const *meta,
+                                 void *o_ptr,
+                                 void const *a_ptr,
+                                 void const *b_ptr,
+                                 void const *c_ptr,
+                                 int m,
+                                 int n,
+                                 int k,
+                                 int batch,
+                                 ffStream_t stream,
+                                 int a_seq_length_dim,
+                                 int b_seq_length_dim,
+                                 int seq_length) {
+  assert(meta->data_type == DT_FLOAT);
+  int lda = k;
+  int ldb = m;
+  int ldo = m;
+  long long int strideA = (long long int)n * k;
+  long long int strideB = (long long int)k * m;
+  long long int strideO = (long long int)n * m;
+  if ((a_seq_length_dim == 0) && (seq_length >= 0)) {
+    assert(seq_length <= k);
+    k = seq_length;
+    assert(b_seq_length_dim == 1);
+  } else if ((a_seq_length_dim == 1) && (seq_length >= 0)) {
+    assert(seq_length <= n);
+    n = seq_length;
+  } else {
+    // currently only support a_seq_length_dim = 0 or 1
+    assert((a_seq_length_dim < 0) || (seq_length < 0));
+  }
+  if ((b_seq_length_dim == 0) && (seq_length >= 0)) {
+    assert(seq_length <= m);
+    m = seq_length;
+  } else if ((b_seq_length_dim == 1) && (seq_length >= 0)) {
+    assert(a_seq_length_dim == 0);
+    assert(k == seq_length);
+  } else {
+    // currently only support a_seq_length_dim = 0 or 1
+    assert((b_seq_length_dim < 0) || (seq_length < 0));
+  }
+
+  cpu_sgemm_strided_batched(false,
+                            false,
+                            m,
+                            n,
+                            k,
+                            1.0f,
+                            (float const *)b_ptr,
+                            ldb,
+                            strideB,
+                            (float const *)a_ptr,
+                            lda,
+                            strideA,
+                            0.0f,
+                            (float *)o_ptr,
+                            ldo,
+                            strideO,
+                            batch);
+  // current assume c is null
+  assert(c_ptr == NULL);
+}
+
+/*static*/
+void BatchMatmul::forward_kernel_wrapper(BatchMatmulMeta const *meta,
+                                         void *o_ptr,
+                                         void const *a_ptr,
+                                         void const *b_ptr,
+                                         void const *c_ptr,
+                                         int m,
+                                         int n,
+                                         int k,
+                                         int batch,
+                                         int a_seq_length_dim,
+                                         int b_seq_length_dim,
+                                         int seq_length) {
+  ffStream_t stream;
+  get_legion_stream(&stream);
+
+  double t_start = 0.0;
+  if (meta->profiling) {
+    t_start = cpu_wall_time_ms();
+  }
+  BatchMatmul::forward_kernel(meta,
+                              o_ptr,
+                              a_ptr,
+                              b_ptr,
+                              c_ptr,
+                              m,
+                              n,
+                              k,
+                              batch,
+                              stream,
+                              a_seq_length_dim,
+                              b_seq_length_dim,
+                              seq_length);
+  if (meta->profiling) {
+    double elapsed = cpu_wall_time_ms() - t_start;
+    printf("BatchMatmul forward time = %.2lfms\n", elapsed);
+  }
+}
+
+/*
+A, AGrad: (batch, n, k)
+B, BGrad: (batch, k, m)
+O, OGrad: (batch, n, m)
+AGrad = OGrad * B^T
+BGrad = A^T * OGrad
+*/
+void BatchMatmul::backward_kernel(BatchMatmulMeta const *meta,
+                                  void const *o_ptr,
+                                  void const *o_grad_ptr,
+                                  void const *a_ptr,
+                                  void *a_grad_ptr,
+                                  void const *b_ptr,
+                                  void *b_grad_ptr,
+                                  void *c_grad_ptr,
+                                  int m,
+                                  int n,
+                                  int k,
+                                  int batch,
+                                  ffStream_t stream) {
+  assert(meta->data_type == DT_FLOAT);
+  int a_stride = n * k;
+  int b_stride = m * k;
+  int o_stride = n * m;
+  cpu_sgemm_strided_batched(true,
+                            false,
+                            k,
+                            n,
+                            m,
+                            1.0f,
+                            (float const *)b_ptr,
+                            m,
+                            b_stride,
+                            (float const *)o_grad_ptr,
+                            m,
+                            o_stride,
+                            1.0f,
+                            (float *)a_grad_ptr,
+                            k,
+                            a_stride,
+                            batch);
+  cpu_sgemm_strided_batched(false,
+                            true,
+                            m,
+                            k,
+                            n,
+                            1.0f,
+                            (float const *)o_grad_ptr,
+                            m,
+                            o_stride,
+                            (float const *)a_ptr,
+                            k,
+                            a_stride,
+                            1.0f,
+                            (float *)b_grad_ptr,
+                            m,
+                            b_stride,
+                            batch);
+  assert(c_grad_ptr == NULL);
+}
+
+/*static*/
+void BatchMatmul::backward_kernel_wrapper(BatchMatmulMeta const *meta,
+                                          void const *o_ptr,
+                                          void const *o_grad_ptr,
+                                          void const *a_ptr,
+                                          void *a_grad_ptr,
+                                          void const *b_ptr,
+                                          void *b_grad_ptr,
+                                          void *c_grad_ptr,
+                                          int m,
+                                          int n,
+                                          int k,
+                                          int batch) {
+  ffStream_t stream;
+  get_legion_stream(&stream);
+
+  double t_start = 0.0;
+  if (meta->profiling) {
+    t_start = cpu_wall_time_ms();
+  }
+  BatchMatmul::backward_kernel(meta,
+                               o_ptr,
+                               o_grad_ptr,
+                               a_ptr,
+                               a_grad_ptr,
+                               b_ptr,
+                               b_grad_ptr,
+                               c_grad_ptr,
+                               m,
+                               n,
+                               k,
+                               batch,
+                               stream);
+  if (meta->profiling) {
+    double elapsed = cpu_wall_time_ms() - t_start;
+    printf("BatchMatmul backward time = %.2lfms\n", elapsed);
+  }
+}
+
+BatchMatmulMeta::BatchMatmulMeta(FFHandler handler) : OpMeta(handler) {}
+
+}; // namespace FlexFlow
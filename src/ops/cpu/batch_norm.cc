@@ -0,0 +1,295 @@
+/* Copyright 2020 Stanford
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flexflow/ops/batch_norm.h"
+#include "flexflow/utils/cpu_helper.h"
+#include <cmath>
+
+namespace FlexFlow {
+
+// declare Legion names
+using Legion::Context;
+using Legion::coord_t;
+using Legion::Domain;
+using Legion::Machine;
+using Legion::Memory;
+using Legion::PhysicalRegion;
+using Legion::Rect;
+using Legion::Runtime;
+using Legion::Task;
+
+// Same value as CUDNN_BN_MIN_EPSILON
+static float const BN_EPSILON = 1e-5f;
+
+/*
+  regions[0]: input
+  regions[1]: output
+  regions[2](I): scale
+  regions[3](I): bias
+*/
+OpMeta *BatchNorm::init_task(Task const *task,
+                             std::vector<PhysicalRegion> const &regions,
+                             Context ctx,
+                             Runtime *runtime) {
+  assert(regions.size() == 4);
+  assert(task->regions.size() == 4);
+  BatchNorm const *bm = (BatchNorm *)task->args;
+  FFHandler handle = *((FFHandler const *)task->local_args);
+  TensorAccessorR<float, 4> acc_input(
+      regions[0], task->regions[0], FID_DATA, ctx, runtime);
+  TensorAccessorW<float, 4> acc_output(
+      regions[1], task->regions[1], FID_DATA, ctx, runtime);
+  TensorAccessorR<float, 1> acc_scale(
+      regions[2], task->regions[2], FID_DATA, ctx, runtime);
+  TensorAccessorR<float, 1> acc_bias(
+      regions[3], task->regions[3], FID_DATA, ctx, runtime);
+
+  int output_w = acc_output.rect.hi[0] - acc_output.rect.lo[0] + 1;
+  int output_h = acc_output.rect.hi[1] - acc_output.rect.lo[1] + 1;
+  int output_c = acc_output.rect.hi[2] - acc_output.rect.lo[2] + 1;
+  int output_n = acc_output.rect.hi[3] - acc_output.rect.lo[3] + 1;
+
+  Memory cpu_mem = Machine::MemoryQuery(Machine::get_machine())
+                       .only_kind(WORKER_MEM_KIND)
+                       .best_affinity_to(task->target_proc)
+                       .first();
+  BatchNormMeta *m = new BatchNormMeta(
+      handle, bm, cpu_mem, output_n, output_c, output_h, output_w);
+  return m;
+}
+
+/*static*/
+void BatchNorm::forward_kernel(BatchNormMeta *m,
+                               float const *input_ptr,
+                               float *output_ptr,
+                               float const *scale_ptr,
+                               float const *bias_ptr) {
+  // Spatial batch norm in training mode, with an exponential average
+  // factor of 1 as in the CUDA kernel
+  size_t spatial = (size_t)m->output_h * m->output_w;
+  size_t count = spatial * m->output_n;
+  for (int c = 0; c < m->output_c; c++) {
+    double sum = 0.0, sq_sum = 0.0;
+    for (int n = 0; n < m->output_n; n++) {
+      float const *in =
+          input_ptr + ((size_t)n * m->output_c + c) * spatial;
+      for (size_t i = 0; i < spatial; i++) {
+        sum += in[i];
+        sq_sum += (double)in[i] * in[i];
+      }
+    }
+    float mean = sum / count;
+    float var = std::max(sq_sum / count - (double)mean * mean, 0.0);
+    float inv_std = 1.0f / sqrtf(var + BN_EPSILON);
+    m->runningMean[c] = mean;
+    m->runningVar[c] = count > 1 ? var * count / (count - 1) : var;
+    m->saveMean[c] = mean;
+    m->saveVar[c] = inv_std;
+    for (int n = 0; n < m->output_n; n++) {
+      size_t offset = ((size_t)n * m->output_c + c) * spatial;
+      for (size_t i = 0; i < spatial; i++) {
+        output_ptr[offset + i] =
+            (input_ptr[offset + i] - mean) * inv_std * scale_ptr[c] +
+            bias_ptr[c];
+      }
+    }
+  }
+}
+
+/*
+  regions[0](I): input
+  regions[1](O): ouptut
+  regions[2](I): scale
+  regions[3](I): bias
+*/
+void BatchNorm::forward_task(Task const *task,
+                             std::vector<PhysicalRegion> const &regions,
+                             Context ctx,
+                             Runtime *runtime) {
+  assert(regions.size() == 4);
+  assert(task->regions.size() == 4);
+  BatchNormMeta *m = *((BatchNormMeta **)task->local_args);
+  TensorAccessorR<float, 4> acc_input(
+      regions[0], task->regions[0], FID_DATA, ctx, runtime);
+  TensorAccessorW<float, 4> acc_output(
+      regions[1], task->regions[1], FID_DATA, ctx, runtime);
+  TensorAccessorR<float, 1> acc_scale(
+      regions[2], task->regions[2], FID_DATA, ctx, runtime);
+  TensorAccessorR<float, 1> acc_bias(
+      regions[3], task->regions[3], FID_DATA, ctx, runtime);
+
+  double t_start = 0.0;
+  if (m->profiling) {
+    t_start = cpu_wall_time_ms();
+  }
+  forward_kernel(
+      m, acc_input.ptr, acc_output.ptr, acc_scale.ptr, acc_bias.ptr);
+  if (m->profiling) {
+    double elapsed = cpu_wall_time_ms() - t_start;
+    printf("BatchNorm forward time (BF) = %.2fms\n", elapsed);
+  }
+}
+
+/*static*/
+void BatchNorm::backward_kernel(BatchNormMeta *m,
+                                float const *input_ptr,
+                                float *output_grad_ptr,
+                                float const *output_ptr,
+                                float *input_grad_ptr,
+                                float const *scale_ptr,
+                                float *scale_grad_ptr,
+                                float *bias_grad_ptr,
+                                size_t numElements) {
+  if (m->relu) {
+    cpu_activation_backward(
+        AC_MODE_RELU, output_grad_ptr, output_ptr, numElements);
+  }
+  // NOTE: all gradients are accumulated
+  size_t spatial = (size_t)m->output_h * m->output_w;
+  size_t count = spatial * m->output_n;
+  for (int c = 0; c < m->output_c; c++) {
+    float mean = m->saveMean[c];
+    float inv_std = m->saveVar[c];
+    double dbias = 0.0, dscale = 0.0;
+    for (int n = 0; n < m->output_n; n++) {
+      size_t offset = ((size_t)n * m->output_c + c) * spatial;
+      for (size_t i = 0; i < spatial; i++) {
+        float x_hat = (input_ptr[offset + i] - mean) * inv_std;
+        dbias += output_grad_ptr[offset + i];
+        dscale += output_grad_ptr[offset + i] * x_hat;
+      }
+    }
+    for (int n = 0; n < m->output_n; n++) {
+      size_t offset = ((size_t)n * m->output_c + c) * spatial;
+      for (size_t i = 0; i < spatial; i++) {
+        float x_hat = (input_ptr[offset + i] - mean) * inv_std;
+        input_grad_ptr[offset + i] +=
+            scale_ptr[c] * inv_std *
+            (output_grad_ptr[offset + i] - dbias / count -
+             x_hat * dscale / count);
+      }
+    }
+    scale_grad_ptr[c] += dscale;
+    bias_grad_ptr[c] += dbias;
+  }
+}
+
+/*
+  regions[0](I): input
+  regions[1](I/O): input_grad
+  regions[2](I): output
+  regions[3](I/O): output_grad
+  regions[4](I): scale
+  regions[5](I/O): scale_grad
+  regions[6](I/O): bias_grad
+*/
+void BatchNorm::backward_task(Task const *task,
+                              std::vector<PhysicalRegion> const &regions,
+                              Context ctx,
+                              Runtime *runtime) {
+  assert(regions.size() == 7);
+  assert(task->regions.size() == 7);
+  BatchNormMeta *m = *((BatchNormMeta **)task->local_args);
+  TensorAccessorR<float, 4> acc_input(
+      regions[0], task->regions[0], FID_DATA, ctx, runtime);
+  TensorAccessorW<float, 4> acc_input_grad(regions[1],
+                                           task->regions[1],
+                                           FID_DATA,
+                                           ctx,
+                                           runtime,
+                                           true /*readOutput*/);
+  TensorAccessorR<float, 4> acc_output(
+      regions[2], task->regions[2], FID_DATA, ctx, runtime);
+  TensorAccessorW<float, 4> acc_output_grad(regions[3],
+                                            task->regions[3],
+                                            FID_DATA,
+                                            ctx,
+                                            runtime,
+                                            true /*readOutput*/);
+  TensorAccessorR<float, 1> acc_scale(
+      regions[4], task->regions[4], FID_DATA, ctx, runtime);
+  TensorAccessorW<float, 1> acc_scale_grad(regions[5],
+                                           task->regions[5],
+                                           FID_DATA,
+                                           ctx,
+                                           runtime,
+                                           true /*readOutput*/);
+  TensorAccessorW<float, 1> acc_bias_grad(regions[6],
+                                          task->regions[6],
+                                          FID_DATA,
+                                          ctx,
+                                          runtime,
+                                          true /*readOutput*/);
+
+  double t_start = 0.0;
+  if (m->profiling) {
+    t_start = cpu_wall_time_ms();
+  }
+  backward_kernel(m,
+                  acc_input.ptr,
+                  acc_output_grad.ptr,
+                  acc_output.ptr,
+                  acc_input_grad.ptr,
+                  acc_scale.ptr,
+                  acc_scale_grad.ptr,
+                  acc_bias_grad.ptr,
+                  acc_output.rect.volume());
+  if (m->profiling) {
+    double elapsed = cpu_wall_time_ms() - t_start;
+    printf("BatchNorm backward time = %.2fms\n", elapsed);
+  }
+}
+
+BatchNormMeta::BatchNormMeta(FFHandler handler,
+                             BatchNorm const *bn,
+                             Memory cpu_mem,
+                             int output_n,
+                             int output_c,
+                             int output_h,
+                             int output_w)
+    : OpMeta(handler), output_n(output_n), output_c(output_c),
+      output_h(output_h), output_w(output_w) {
+  relu = bn->relu;
+  profiling = bn->profiling;
+  fprintf(
+      stderr, "output(%d,%d,%d,%d)\n", output_n, output_c, output_h, output_w);
+  // allocate memory for runningMean, runningVar, saveMean, saveVar
+  {
+    size_t totalSize = sizeof(float) * output_c * 4;
+    Realm::Rect<1, coord_t> bounds(Realm::Point<1, coord_t>(0),
+                                   Realm::Point<1, coord_t>(totalSize - 1));
+    std::vector<size_t> field_sizes;
+    field_sizes.push_back(sizeof(char));
+    Realm::RegionInstance::create_instance(reserveInst,
+                                           cpu_mem,
+                                           bounds,
+                                           field_sizes,
+                                           0,
+                                           Realm::ProfilingRequestSet())
+        .wait();
+    runningMean = (float *)reserveInst.pointer_untyped(0, sizeof(char));
+    runningVar = (float *)runningMean + output_c;
+    saveMean = (float *)runningVar + output_c;
+    saveVar = (float *)saveMean + output_c;
+    assign_kernel<float>(runningMean, output_c, 0.0f);
+    assign_kernel<float>(runningVar, output_c, 0.0f);
+  }
+}
+
+BatchNormMeta::~BatchNormMeta(void) {
+  reserveInst.destroy();
+}
+
+}; // namespace FlexFlow
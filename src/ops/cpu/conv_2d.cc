@@ -0,0 +1,352 @@
+/* Copyright 2020 Stanford
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flexflow/ops/conv_2d.h"
+#include "flexflow/simulator.h"
+#include "flexflow/utils/cpu_helper.h"
+
+namespace FlexFlow {
+
+/*static*/
+void Conv2D::init_kernel(Conv2D const *conv,
+                         Conv2DMeta *m,
+                         int input_w,
+                         int input_h,
+                         int input_c,
+                         int input_n,
+                         int output_w,
+                         int output_h,
+                         int output_c,
+                         int output_n,
+                         int pad_h,
+                         int pad_w,
+                         float const *input_ptr,
+                         float *output_ptr,
+                         float const *kernel_ptr,
+                         float *kernel_grad_ptr) {
+  // Require that input_c is divisible by conv->groups
+  assert(input_c % conv->groups == 0);
+  printf("filterDim: kernel(%d %d) c_in(%d), c_out(%d)\n",
+         conv->kernel_h,
+         conv->kernel_w,
+         input_c / conv->groups,
+         output_c);
+  m->input_n = input_n;
+  m->input_c = input_c;
+  m->input_h = input_h;
+  m->input_w = input_w;
+  m->output_c = output_c;
+  m->output_h = output_h;
+  m->output_w = output_w;
+  m->kernel_h = conv->kernel_h;
+  m->kernel_w = conv->kernel_w;
+  m->stride_h = conv->stride_h;
+  m->stride_w = conv->stride_w;
+  m->pad_h = pad_h;
+  m->pad_w = pad_w;
+  m->groups = conv->groups;
+  assert(output_h == (input_h + 2 * pad_h - m->kernel_h) / m->stride_h + 1);
+  assert(output_w == (input_w + 2 * pad_w - m->kernel_w) / m->stride_w + 1);
+}
+
+/*static*/
+void Conv2D::forward_kernel(Conv2DMeta const *m,
+                            float const *input_ptr,
+                            float *output_ptr,
+                            float const *filter_ptr,
+                            float const *bias_ptr,
+                            ffStream_t stream) {
+  int in_c_per_group = m->input_c / m->groups;
+  int out_c_per_group = m->output_c / m->groups;
+  for (int n = 0; n < m->input_n; n++) {
+    for (int oc = 0; oc < m->output_c; oc++) {
+      int g = oc / out_c_per_group;
+      float const *filter = filter_ptr + (size_t)oc * in_c_per_group *
+                                             m->kernel_h * m->kernel_w;
+      float *output = output_ptr + ((size_t)n * m->output_c + oc) *
+                                       m->output_h * m->output_w;
+      for (int oh = 0; oh < m->output_h; oh++) {
+        for (int ow = 0; ow < m->output_w; ow++) {
+          float sum = bias_ptr != NULL ? bias_ptr[oc] : 0.0f;
+          for (int ic = 0; ic < in_c_per_group; ic++) {
+            float const *input =
+                input_ptr +
+                ((size_t)n * m->input_c + g * in_c_per_group + ic) *
+                    m->input_h * m->input_w;
+            for (int kh = 0; kh < m->kernel_h; kh++) {
+              int ih = oh * m->stride_h - m->pad_h + kh;
+              if (ih < 0 || ih >= m->input_h) {
+                continue;
+              }
+              for (int kw = 0; kw < m->kernel_w; kw++) {
+                int iw = ow * m->stride_w - m->pad_w + kw;
+                if (iw < 0 || iw >= m->input_w) {
+                  continue;
+                }
+                sum += input[ih * m->input_w + iw] *
+                       filter[(ic * m->kernel_h + kh) * m->kernel_w + kw];
+              }
+            }
+          }
+          output[oh * m->output_w + ow] = sum;
+        }
+      }
+    }
+  }
+  if (m->relu) {
+    cpu_activation_forward(AC_MODE_RELU,
+                           output_ptr,
+                           (size_t)m->input_n * m->output_c * m->output_h *
+                               m->output_w);
+  }
+}
+
+/*static*/
+void Conv2D::forward_kernel_wrapper(Conv2DMeta const *m,
+                                    float const *input_ptr,
+                                    float *output_ptr,
+                                    float const *filter_ptr,
+                                    float const *bias_ptr) {
+  ffStream_t stream;
+  get_legion_stream(&stream);
+
+  double t_start = 0.0;
+  if (m->profiling) {
+    t_start = cpu_wall_time_ms();
+  }
+
+  Conv2D::forward_kernel(
+      m, input_ptr, output_ptr, filter_ptr, bias_ptr, stream);
+  if (m->profiling) {
+    double elapsed = cpu_wall_time_ms() - t_start;
+    print_tensor<float>(input_ptr, 16, "[Conv2D:forward:input]");
+    print_tensor<float>(filter_ptr, 16, "[Conv2D:forward:kernel]");
+    print_tensor<float>(bias_ptr, 16, "[Conv2D:forward:bias]");
+    print_tensor<float>(output_ptr, 16, "[Conv2D:forward:output]");
+    printf("%s [Conv2D] forward time (CF) = %.2fms\n", m->op_name, elapsed);
+  }
+}
+
+/*static*/
+void Conv2D::backward_kernel(Conv2DMeta const *m,
+                             float const *input_ptr,
+                             float *input_grad_ptr,
+                             float const *output_ptr,
+                             float *output_grad_ptr,
+                             float const *kernel_ptr,
+                             float *kernel_grad_ptr,
+                             float *bias_grad_ptr,
+                             ffStream_t stream) {
+  if (m->relu) {
+    cpu_activation_backward(AC_MODE_RELU,
+                            output_grad_ptr,
+                            output_ptr,
+                            (size_t)m->input_n * m->output_c * m->output_h *
+                                m->output_w);
+  }
+  // NOTE: filter, bias and data gradients are all accumulated
+  int in_c_per_group = m->input_c / m->groups;
+  int out_c_per_group = m->output_c / m->groups;
+  for (int n = 0; n < m->input_n; n++) {
+    for (int oc = 0; oc < m->output_c; oc++) {
+      int g = oc / out_c_per_group;
+      size_t filter_offset =
+          (size_t)oc * in_c_per_group * m->kernel_h * m->kernel_w;
+      float const *output_grad =
+          output_grad_ptr +
+          ((size_t)n * m->output_c + oc) * m->output_h * m->output_w;
+      for (int oh = 0; oh < m->output_h; oh++) {
+        for (int ow = 0; ow < m->output_w; ow++) {
+          float dy = output_grad[oh * m->output_w + ow];
+          if (bias_grad_ptr != NULL) {
+            bias_grad_ptr[oc] += dy;
+          }
+          for (int ic = 0; ic < in_c_per_group; ic++) {
+            size_t input_offset =
+                ((size_t)n * m->input_c + g * in_c_per_group + ic) *
+                m->input_h * m->input_w;
+            for (int kh = 0; kh < m->kernel_h; kh++) {
+              int ih = oh * m->stride_h - m->pad_h + kh;
+              if (ih < 0 || ih >= m->input_h) {
+                continue;
+              }
+              for (int kw = 0; kw < m->kernel_w; kw++) {
+                int iw = ow * m->stride_w - m->pad_w + kw;
+                if (iw < 0 || iw >= m->input_w) {
+                  continue;
+                }
+                size_t in_idx = input_offset + ih * m->input_w + iw;
+                size_t f_idx =
+                    filter_offset + (ic * m->kernel_h + kh) * m->kernel_w + kw;
+                kernel_grad_ptr[f_idx] += input_ptr[in_idx] * dy;
+                if (input_grad_ptr != NULL) {
+                  input_grad_ptr[in_idx] += kernel_ptr[f_idx] * dy;
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+/*static*/
+void Conv2D::backward_kernel_wrapper(Conv2DMeta const *m,
+                                     float const *input_ptr,
+                                     float *input_grad_ptr,
+                                     float const *output_ptr,
+                                     float *output_grad_ptr,
+                                     float const *kernel_ptr,
+                                     float *kernel_grad_ptr,
+                                     float *bias_grad_ptr) {
+  ffStream_t stream;
+  get_legion_stream(&stream);
+
+  double t_start = 0.0;
+  if (m->profiling) {
+    t_start = cpu_wall_time_ms();
+  }
+
+  Conv2D::backward_kernel(m,
+                          input_ptr,
+                          input_grad_ptr,
+                          output_ptr,
+                          output_grad_ptr,
+                          kernel_ptr,
+                          kernel_grad_ptr,
+                          bias_grad_ptr,
+                          stream);
+  if (m->profiling) {
+    double elapsed = cpu_wall_time_ms() - t_start;
+    printf("%s [Conv2D] backward time = %.2fms\n", m->op_name, elapsed);
+  }
+}
+
+Conv2DMeta::Conv2DMeta(FFHandler handler) : OpMeta(handler) {}
+
+bool Conv2D::measure_operator_cost(Simulator *sim,
+                                   MachineView const &mv,
+                                   CostMetrics &cost_metrics) const {
+  ParallelTensorBase sub_output, sub_input;
+  if (!outputs[0]->get_sub_tensor(mv, sub_output))
+    return false;
+  if (!inputs[0]->get_sub_tensor(mv, sub_input))
+    return false;
+  int input_w = sub_input.dims[0].size;
+  int input_h = sub_input.dims[1].size;
+  int input_c = sub_input.dims[2].size;
+  int input_n = sub_input.dims[3].size;
+  int output_w = sub_output.dims[0].size;
+  int output_h = sub_output.dims[1].size;
+  int output_c = sub_output.dims[2].size;
+  int output_n = sub_output.dims[3].size;
+  int pad_h = ((output_h - 1) * stride_h + kernel_h - input_h + 1) / 2;
+  int pad_w = ((output_w - 1) * stride_w + kernel_w - input_w + 1) / 2;
+
+  Conv2DMeta *m = sim->conv2d_meta;
+  m->relu = activation == AC_MODE_RELU;
+  // require input_c is divisible by groups
+  assert(input_c % groups == 0);
+  m->input_n = input_n;
+  m->input_c = input_c;
+  m->input_h = input_h;
+  m->input_w = input_w;
+  m->output_c = output_c;
+  m->output_h = output_h;
+  m->output_w = output_w;
+  m->kernel_h = kernel_h;
+  m->kernel_w = kernel_w;
+  m->stride_h = stride_h;
+  m->stride_w = stride_w;
+  m->pad_h = pad_h;
+  m->pad_w = pad_w;
+  m->groups = groups;
+
+  // allocate tensors in simulator
+  sim->free_all();
+  float *input_ptr = (float *)sim->allocate(sub_input.get_volume(), DT_FLOAT);
+  assert(input_ptr != NULL);
+  cost_metrics.inputs_memory += cost_metrics.total_mem_diff_from(sim->offset);
+
+  float *output_ptr = (float *)sim->allocate(sub_output.get_volume(), DT_FLOAT);
+  assert(output_ptr != NULL);
+  cost_metrics.outputs_memory += cost_metrics.total_mem_diff_from(sim->offset);
+
+  float *weight_ptr = (float *)sim->allocate(
+      (size_t)output_c * input_c * kernel_h * kernel_w / groups, DT_FLOAT);
+  assert(weight_ptr != NULL);
+  float *bias_ptr = (float *)sim->allocate(output_c, DT_FLOAT);
+  assert(bias_ptr != NULL);
+  cost_metrics.weights_memory += cost_metrics.total_mem_diff_from(sim->offset);
+
+  float *input_grad_ptr = NULL;
+  if (trainableInputs[0]) {
+    input_grad_ptr =
+        (float *)sim->allocate(sub_input.get_volume(), DT_FLOAT);
+    assert(input_grad_ptr != NULL);
+  }
+  float *output_grad_ptr =
+      (float *)sim->allocate(sub_output.get_volume(), DT_FLOAT);
+  assert(output_grad_ptr != NULL);
+  float *weight_grad_ptr = (float *)sim->allocate(
+      (size_t)output_c * input_c * kernel_h * kernel_w / groups, DT_FLOAT);
+  assert(weight_grad_ptr != NULL);
+  float *bias_grad_ptr = (float *)sim->allocate(output_c, DT_FLOAT);
+  assert(bias_grad_ptr != NULL);
+  cost_metrics.outputs_memory += cost_metrics.total_mem_diff_from(sim->offset);
+
+  std::function<void()> forward, backward;
+  forward = [&] {
+    forward_kernel_wrapper(m, input_ptr, output_ptr, weight_ptr, bias_ptr);
+  };
+  backward = [&] {
+    backward_kernel_wrapper(m,
+                            input_ptr,
+                            input_grad_ptr,
+                            output_ptr,
+                            output_grad_ptr,
+                            weight_ptr,
+                            weight_grad_ptr,
+                            bias_grad_ptr);
+  };
+  inner_measure_operator_cost(sim, forward, backward, cost_metrics);
+
+  log_measure.debug("[Measure Conv2D] name(%s) input(%d %d %d %d) weight(%d %d "
+                    "%d %d) output(%d %d %d %d) stride(%d %d) padding(%d %d) "
+                    "forward_time(%.4lf) backward_time(%.4lf)\n",
+                    name,
+                    input_n,
+                    input_c,
+                    input_h,
+                    input_w,
+                    output_c,
+                    input_c / groups,
+                    kernel_h,
+                    kernel_w,
+                    output_n,
+                    output_c,
+                    output_h,
+                    output_w,
+                    stride_h,
+                    stride_w,
+                    padding_h,
+                    padding_w,
+                    cost_metrics.forward_time,
+                    cost_metrics.backward_time);
+  return true;
+}
+
+}; // namespace FlexFlow
@@ -0,0 +1,101 @@
+/* Copyright 2020 Stanford
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flexflow/ops/dropout.h"
+#include "flexflow/utils/cpu_helper.h"
+
+namespace FlexFlow {
+
+// declare Legion names
+using Legion::coord_t;
+using Legion::Domain;
+using Legion::Memory;
+
+void Dropout::forward_kernel(DropoutMeta *m,
+                             float const *input_ptr,
+                             float *output_ptr,
+                             ffStream_t stream) {
+  uint8_t *mask = (uint8_t *)m->reserveSpace;
+  float scale = m->rate < 1.0f ? 1.0f / (1.0f - m->rate) : 0.0f;
+  std::bernoulli_distribution keep(1.0f - m->rate);
+  CPU_KERNEL_LOOP(i, (coord_t)m->num_elements) {
+    mask[i] = keep(m->generator) ? 1 : 0;
+    output_ptr[i] = mask[i] ? input_ptr[i] * scale : 0.0f;
+  }
+}
+
+/*static*/
+void Dropout::forward_kernel_wrapper(DropoutMeta *m,
+                                     float const *input_ptr,
+                                     float *output_ptr) {
+  ffStream_t stream;
+  get_legion_stream(&stream);
+  Dropout::forward_kernel(m, input_ptr, output_ptr, stream);
+}
+
+void Dropout::backward_kernel(DropoutMeta *m,
+                              float const *output_grad_ptr,
+                              float *input_grad_ptr,
+                              ffStream_t stream) {
+  uint8_t const *mask = (uint8_t const *)m->reserveSpace;
+  float scale = m->rate < 1.0f ? 1.0f / (1.0f - m->rate) : 0.0f;
+  CPU_KERNEL_LOOP(i, (coord_t)m->num_elements) {
+    input_grad_ptr[i] = mask[i] ? output_grad_ptr[i] * scale : 0.0f;
+  }
+}
+
+/*static*/
+void Dropout::backward_kernel_wrapper(DropoutMeta *m,
+                                      float const *output_grad_ptr,
+                                      float *input_grad_ptr) {
+  ffStream_t stream;
+  get_legion_stream(&stream);
+  Dropout::backward_kernel(m, output_grad_ptr, input_grad_ptr, stream);
+}
+
+DropoutMeta::DropoutMeta(FFHandler handler,
+                         Dropout const *dropout,
+                         Memory gpu_mem,
+                         Domain const &output_domain)
+    : OpMeta(handler), generator(dropout->seed) {
+  profiling = dropout->profiling;
+  rate = dropout->rate;
+  num_elements = output_domain.get_volume();
+  dropoutStateSize = 0;
+  reserveSpaceSize = num_elements * sizeof(uint8_t);
+  {
+    // allocate memory for the dropout mask
+    Realm::Rect<1, coord_t> bounds(
+        Realm::Point<1, coord_t>(0),
+        Realm::Point<1, coord_t>(reserveSpaceSize - 1));
+    std::vector<size_t> field_sizes;
+    field_sizes.push_back(sizeof(char));
+    Realm::RegionInstance::create_instance(reserveInst,
+                                           gpu_mem,
+                                           bounds,
+                                           field_sizes,
+                                           0,
+                                           Realm::ProfilingRequestSet())
+        .wait();
+    reserveSpace = reserveInst.pointer_untyped(0, sizeof(char));
+    dropoutStates = NULL;
+  }
+}
+
+DropoutMeta::~DropoutMeta(void) {
+  reserveInst.destroy();
+}
+
+}; // namespace FlexFlow
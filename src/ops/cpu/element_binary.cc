@@ -0,0 +1,235 @@
+/* Copyright 2020 Stanford
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flexflow/ops/element_binary.h"
+#include "flexflow/utils/cpu_helper.h"
+
+namespace FlexFlow {
+// declare Legion names
+using Legion::coord_t;
+using Legion::Domain;
+
+// Maps an index into the output to the index into a (possibly broadcast)
+// input, where input dimensions of size 1 are broadcast
+static coord_t broadcast_index(coord_t out_idx,
+                               Domain const &output_domain,
+                               Domain const &input_domain) {
+  coord_t in_idx = 0, in_stride = 1;
+  for (int d = 0; d < output_domain.get_dim(); d++) {
+    coord_t out_size = output_domain.hi()[d] - output_domain.lo()[d] + 1;
+    coord_t coord = out_idx % out_size;
+    out_idx /= out_size;
+    if (d < input_domain.get_dim()) {
+      coord_t in_size = input_domain.hi()[d] - input_domain.lo()[d] + 1;
+      if (in_size > 1) {
+        in_idx += coord * in_stride;
+      }
+      in_stride *= in_size;
+    }
+  }
+  return in_idx;
+}
+
+/*static*/
+void ElementBinary::init_kernel(ElementBinaryMeta *m,
+                                Domain const &input1_domain,
+                                Domain const &input2_domain,
+                                Domain const &output_domain) {
+  switch (m->op_type) {
+    case OP_EW_ADD:
+    case OP_EW_SUB:
+    case OP_EW_MUL:
+      break;
+    default:
+      assert(false);
+  }
+  m->input1_domain = input1_domain;
+  m->input2_domain = input2_domain;
+  m->output_domain = output_domain;
+}
+
+// The CPU kernels only handle float
+static void forward_float(ElementBinaryMeta const *m,
+                          float const *in1_ptr,
+                          float const *in2_ptr,
+                          float *out_ptr) {
+  coord_t volume = m->output_domain.get_volume();
+  CPU_KERNEL_LOOP(i, volume) {
+    float in1 = in1_ptr[m->broadcast_input1 ? broadcast_index(i,
+                                                              m->output_domain,
+                                                              m->input1_domain)
+                                            : i];
+    float in2 = in2_ptr[m->broadcast_input2 ? broadcast_index(i,
+                                                              m->output_domain,
+                                                              m->input2_domain)
+                                            : i];
+    switch (m->op_type) {
+      case OP_EW_ADD:
+        out_ptr[i] = in1 + in2;
+        break;
+      case OP_EW_SUB:
+        out_ptr[i] = in1 - in2;
+        break;
+      case OP_EW_MUL:
+        out_ptr[i] = in1 * in2;
+        break;
+      default:
+        assert(false);
+    }
+  }
+}
+
+/*static*/
+void ElementBinary::forward_kernel(ElementBinaryMeta const *m,
+                                   void const *in1_ptr,
+                                   void const *in2_ptr,
+                                   void *out_ptr,
+                                   ffStream_t stream) {
+  assert(m->data_type == DT_FLOAT);
+  forward_float(
+      m, (float const *)in1_ptr, (float const *)in2_ptr, (float *)out_ptr);
+}
+
+static char const *get_op_name(OperatorType op_type) {
+  switch (op_type) {
+    case OP_EW_ADD:
+      return "Add";
+    case OP_EW_SUB:
+      return "Sub";
+    case OP_EW_MUL:
+      return "Mul";
+    case OP_EW_DIV:
+      return "Div";
+    default:
+      assert(false);
+  }
+  return NULL;
+}
+
+/*static*/
+void ElementBinary::forward_kernel_wrapper(ElementBinaryMeta const *m,
+                                           void const *in1_ptr,
+                                           void const *in2_ptr,
+                                           void *out_ptr) {
+  ffStream_t stream;
+  get_legion_stream(&stream);
+
+  double t_start = 0.0;
+  if (m->profiling) {
+    t_start = cpu_wall_time_ms();
+  }
+  ElementBinary::forward_kernel(m, in1_ptr, in2_ptr, out_ptr, stream);
+  if (m->profiling) {
+    double elapsed = cpu_wall_time_ms() - t_start;
+    log_measure.debug(
+        "[%s] forward time (CF) = %.2fms\n", get_op_name(m->op_type), elapsed);
+  }
+}
+
+static void backward_float(ElementBinaryMeta const *m,
+                           float const *out_grad_ptr,
+                           float const *in1_ptr,
+                           float const *in2_ptr,
+                           float *in1_grad_ptr,
+                           float *in2_grad_ptr) {
+  // Gradients are accumulated, and reduced over broadcast dimensions
+  coord_t volume = m->output_domain.get_volume();
+  CPU_KERNEL_LOOP(i, volume) {
+    coord_t i1 = m->broadcast_input1
+                     ? broadcast_index(i, m->output_domain, m->input1_domain)
+                     : i;
+    coord_t i2 = m->broadcast_input2
+                     ? broadcast_index(i, m->output_domain, m->input2_domain)
+                     : i;
+    float dy = out_grad_ptr[i];
+    switch (m->op_type) {
+      case OP_EW_ADD: {
+        if (in1_grad_ptr != nullptr)
+          in1_grad_ptr[i1] += dy;
+        if (in2_grad_ptr != nullptr)
+          in2_grad_ptr[i2] += dy;
+        break;
+      }
+      case OP_EW_SUB: {
+        if (in1_grad_ptr != nullptr)
+          in1_grad_ptr[i1] += dy;
+        if (in2_grad_ptr != nullptr)
+          in2_grad_ptr[i2] -= dy;
+        break;
+      }
+      case OP_EW_MUL: {
+        if (in1_grad_ptr != nullptr)
+          in1_grad_ptr[i1] += dy * in2_ptr[i2];
+        if (in2_grad_ptr != nullptr)
+          in2_grad_ptr[i2] += dy * in1_ptr[i1];
+        break;
+      }
+      default:
+        assert(false && "Unsupported ElementWise Binary Type");
+    }
+  }
+}
+
+/*static*/
+void ElementBinary::backward_kernel(ElementBinaryMeta const *m,
+                                    void const *out_grad_ptr,
+                                    void const *in1_ptr,
+                                    void const *in2_ptr,
+                                    void *in1_grad_ptr,
+                                    void *in2_grad_ptr,
+                                    ffStream_t stream) {
+  assert(m->data_type == DT_FLOAT);
+  backward_float(m,
+                 (float const *)out_grad_ptr,
+                 (float const *)in1_ptr,
+                 (float const *)in2_ptr,
+                 (float *)in1_grad_ptr,
+                 (float *)in2_grad_ptr);
+}
+
+/*static*/
+void ElementBinary::backward_kernel_wrapper(ElementBinaryMeta const *m,
+                                            void const *out_grad_ptr,
+                                            void const *in1_ptr,
+                                            void const *in2_ptr,
+                                            void *in1_grad_ptr,
+                                            void *in2_grad_ptr) {
+  ffStream_t stream;
+  get_legion_stream(&stream);
+
+  double t_start = 0.0;
+  if (m->profiling) {
+    t_start = cpu_wall_time_ms();
+  }
+  ElementBinary::backward_kernel(
+      m, out_grad_ptr, in1_ptr, in2_ptr, in1_grad_ptr, in2_grad_ptr, stream);
+  if (m->profiling) {
+    double elapsed = cpu_wall_time_ms() - t_start;
+    printf("[%s] backward time (CB) = %.2fms\n",
+           get_op_name(m->op_type),
+           elapsed);
+  }
+}
+
+ElementBinaryMeta::ElementBinaryMeta(FFHandler handler) : OpMeta(handler) {
+  op_type = OP_NOOP;
+  profiling = false;
+  inplace_a = false;
+  has_same_operands = false;
+  broadcast_input1 = false;
+  broadcast_input2 = false;
+}
+
+}; // namespace FlexFlow
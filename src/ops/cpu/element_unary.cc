@@ -0,0 +1,264 @@
+/* Copyright 2020 Stanford
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flexflow/ops/element_unary.h"
+#include "flexflow/utils/cpu_helper.h"
+#include <cmath>
+
+namespace FlexFlow {
+
+// declare Legion names
+using Legion::coord_t;
+using Legion::Domain;
+
+/*static*/
+void ElementUnary::init_kernel(ElementUnaryMeta *m,
+                               Domain const &input_domain,
+                               Domain const &output_domain) {
+  // Activations are computed by the CPU kernels below
+  assert(use_cudnn(m->op_type));
+  assert(input_domain.get_volume() == output_domain.get_volume());
+}
+
+/*static*/
+template <typename T>
+void ElementUnary::forward_kernel(ElementUnaryMeta const *m,
+                                  const T *in,
+                                  T *out,
+                                  size_t num_elements,
+                                  ffStream_t stream) {
+  const T scalar = (T)m->scalar;
+  CPU_KERNEL_LOOP(i, (coord_t)num_elements) {
+    switch (m->op_type) {
+      case OP_SIGMOID: {
+        out[i] = (T)(1.0f / (1.0f + expf(-(float)in[i])));
+        break;
+      }
+      case OP_RELU: {
+        out[i] = in[i] > (T)0 ? in[i] : (T)0;
+        break;
+      }
+      case OP_TANH: {
+        out[i] = (T)tanhf((float)in[i]);
+        break;
+      }
+      case OP_ELU: {
+        out[i] = in[i] > (T)0 ? in[i] : (T)(expf((float)in[i]) - 1.0f);
+        break;
+      }
+      case OP_EXP: {
+        out[i] = (T)exp((float)in[i]);
+        break;
+      }
+      case OP_IDENTITY: {
+        out[i] = in[i];
+        break;
+      }
+      case OP_SCALAR_MULTIPLY: {
+        out[i] = in[i] * scalar;
+        break;
+      }
+      case OP_SCALAR_ADD: {
+        out[i] = in[i] + scalar;
+        break;
+      }
+      case OP_SCALAR_SUB: {
+        out[i] = in[i] - scalar;
+        break;
+      }
+      case OP_SCALAR_TRUE_DIV: {
+        out[i] = in[i] / scalar;
+        break;
+      }
+      case OP_GELU: {
+        out[i] = (T)(in[i] * 0.5 * erfc(-in[i] * M_SQRT1_2));
+        break;
+      }
+      case OP_RSQRT: {
+        out[i] = (T)(1.0f / sqrt((float)in[i]));
+        break;
+      }
+      case OP_POW: {
+        out[i] = (T)(powf(in[i], scalar));
+        break;
+      }
+      default:
+        assert(false);
+    }
+  }
+}
+
+/*static*/
+template <typename T>
+void ElementUnary::forward_kernel_wrapper(ElementUnaryMeta const *m,
+                                          const T *input_ptr,
+                                          T *output_ptr,
+                                          size_t num_elements) {
+  ffStream_t stream;
+  get_legion_stream(&stream);
+  ElementUnary::forward_kernel<T>(
+      m, input_ptr, output_ptr, num_elements, stream);
+}
+
+/*static*/
+template <typename T>
+void ElementUnary::backward_kernel(ElementUnaryMeta const *m,
+                                   const T *input,
+                                   T *input_grad,
+                                   const T *output,
+                                   const T *output_grad,
+                                   size_t num_elements,
+                                   ffStream_t stream) {
+  const T scalar = (T)m->scalar;
+  CPU_KERNEL_LOOP(i, (coord_t)num_elements) {
+    switch (m->op_type) {
+      case OP_SIGMOID: {
+        input_grad[i] += output_grad[i] * output[i] * ((T)1 - output[i]);
+        break;
+      }
+      case OP_RELU: {
+        input_grad[i] += output[i] > (T)0 ? output_grad[i] : (T)0;
+        break;
+      }
+      case OP_TANH: {
+        input_grad[i] += output_grad[i] * ((T)1 - output[i] * output[i]);
+        break;
+      }
+      case OP_ELU: {
+        input_grad[i] +=
+            input[i] > (T)0 ? output_grad[i] : output_grad[i] * (output[i] + 1);
+        break;
+      }
+      case OP_EXP: {
+        input_grad[i] += output_grad[i] * output[i];
+        break;
+      }
+      case OP_IDENTITY: {
+        input_grad[i] += output_grad[i];
+        break;
+      }
+      case OP_SCALAR_MULTIPLY: {
+        input_grad[i] += output_grad[i] * scalar;
+        break;
+      }
+      case OP_SCALAR_ADD: {
+        input_grad[i] += output_grad[i];
+        break;
+      }
+      case OP_SCALAR_SUB: {
+        input_grad[i] += output_grad[i];
+        break;
+      }
+      case OP_SCALAR_TRUE_DIV: {
+        input_grad[i] += output_grad[i] / scalar;
+        break;
+      }
+      case OP_GELU: {
+        // Phi(x) + x * phi(x), where phi(x) = exp(-x^2 / 2) / sqrt(2 * pi)
+        input_grad[i] +=
+            (T)(output_grad[i] *
+                (0.5 * erfc(-input[i] * M_SQRT1_2) +
+                 0.5 * M_2_SQRTPI * M_SQRT1_2 * input[i] *
+                     exp(-input[i] * input[i] * 0.5)));
+        break;
+      }
+      case OP_RSQRT: {
+        input_grad[i] +=
+            (T)(-0.5f * output_grad[i] * output[i] * output[i] * output[i]);
+        break;
+      }
+      case OP_POW: {
+        input_grad[i] +=
+            (T)(output_grad[i] * scalar * powf(input[i], scalar - 1));
+        break;
+      }
+      default:
+        assert(false);
+    }
+  }
+}
+
+/*static*/
+template <typename T>
+void ElementUnary::backward_kernel_wrapper(ElementUnaryMeta const *m,
+                                           const T *input_ptr,
+                                           T *input_grad_ptr,
+                                           const T *output_ptr,
+                                           const T *output_grad_ptr,
+                                           size_t num_elements) {
+  ffStream_t stream;
+  get_legion_stream(&stream);
+  ElementUnary::backward_kernel<T>(m,
+                                   input_ptr,
+                                   input_grad_ptr,
+                                   output_ptr,
+                                   output_grad_ptr,
+                                   num_elements,
+                                   stream);
+}
+
+ElementUnaryMeta::ElementUnaryMeta(FFHandler handler) : OpMeta(handler) {}
+
+template void
+    ElementUnary::forward_kernel_wrapper<float>(ElementUnaryMeta const *m,
+                                                float const *input_ptr,
+                                                float *output_ptr,
+                                                size_t num_elements);
+template void
+    ElementUnary::forward_kernel_wrapper<double>(ElementUnaryMeta const *m,
+                                                 double const *input_ptr,
+                                                 double *output_ptr,
+                                                 size_t num_elements);
+template void
+    ElementUnary::forward_kernel_wrapper<int32_t>(ElementUnaryMeta const *m,
+                                                  int32_t const *input_ptr,
+                                                  int32_t *output_ptr,
+                                                  size_t num_elements);
+template void
+    ElementUnary::forward_kernel_wrapper<int64_t>(ElementUnaryMeta const *m,
+                                                  int64_t const *input_ptr,
+                                                  int64_t *output_ptr,
+                                                  size_t num_elements);
+
+template void
+    ElementUnary::backward_kernel_wrapper<float>(ElementUnaryMeta const *m,
+                                                 float const *input_ptr,
+                                                 float *input_grad_ptr,
+                                                 float const *output_ptr,
+                                                 float const *output_grad_ptr,
+                                                 size_t num_elements);
+template void
+    ElementUnary::backward_kernel_wrapper<double>(ElementUnaryMeta const *m,
+                                                  double const *input_ptr,
+                                                  double *input_grad_ptr,
+                                                  double const *output_ptr,
+                                                  double const *output_grad_ptr,
+                                                  size_t num_elements);
+template void ElementUnary::backward_kernel_wrapper<int32_t>(
+    ElementUnaryMeta const *m,
+    int32_t const *input_ptr,
+    int32_t *input_grad_ptr,
+    int32_t const *output_ptr,
+    int32_t const *output_grad_ptr,
+    size_t num_elements);
+template void ElementUnary::backward_kernel_wrapper<int64_t>(
+    ElementUnaryMeta const *m,
+    int64_t const *input_ptr,
+    int64_t *input_grad_ptr,
+    int64_t const *output_ptr,
+    int64_t const *output_grad_ptr,
+    size_t num_elements);
+
+}; // namespace FlexFlow
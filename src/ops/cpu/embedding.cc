@@ -0,0 +1,536 @@
+/* Copyright 2020 Stanford
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flexflow/ops/embedding.h"
+#include "flexflow/utils/cpu_helper.h"
+#include <algorithm>
+
+#if defined(FF_USE_AVX2) && defined(__GNUC__) &&                               \
+    (defined(__x86_64__) || defined(__i386__))
+#define FF_EMBED_X86
+#include <immintrin.h>
+#endif
+
+namespace FlexFlow {
+// declare Legion names
+using Legion::Context;
+using Legion::coord_t;
+using Legion::Domain;
+using Legion::PhysicalRegion;
+using Legion::Rect;
+using Legion::Runtime;
+using Legion::Task;
+
+LegionRuntime::Logger::Category log_embedding("embedding");
+
+namespace {
+
+// Bags and gradient rows are split across threads in chunks of this many
+size_t const EMBED_PARALLEL_GRAIN = 64;
+
+// Writes scale times the sum of the num_rows rows of one bag to out
+typedef void (*BagSum)(float const *const *rows,
+                       int num_rows,
+                       int dim,
+                       float scale,
+                       float *out);
+
+void bag_sum_generic(float const *const *rows,
+                     int num_rows,
+                     int dim,
+                     float scale,
+                     float *out) {
+  for (int j = 0; j < dim; j++) {
+    out[j] = 0.0f;
+  }
+  for (int r = 0; r < num_rows; r++) {
+    for (int j = 0; j < dim; j++) {
+      out[j] += rows[r][j];
+    }
+  }
+  for (int j = 0; j < dim; j++) {
+    out[j] *= scale;
+  }
+}
+
+#ifdef FF_EMBED_X86
+__attribute__((target("avx2"))) void bag_sum_avx2(float const *const *rows,
+                                                  int num_rows,
+                                                  int dim,
+                                                  float scale,
+                                                  float *out) {
+  __m256 vscale = _mm256_set1_ps(scale);
+  int j = 0;
+  for (; j + 32 <= dim; j += 32) {
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+    for (int r = 0; r < num_rows; r++) {
+      float const *row = rows[r] + j;
+      acc0 = _mm256_add_ps(acc0, _mm256_loadu_ps(row));
+      acc1 = _mm256_add_ps(acc1, _mm256_loadu_ps(row + 8));
+      acc2 = _mm256_add_ps(acc2, _mm256_loadu_ps(row + 16));
+      acc3 = _mm256_add_ps(acc3, _mm256_loadu_ps(row + 24));
+    }
+    _mm256_storeu_ps(out + j, _mm256_mul_ps(acc0, vscale));
+    _mm256_storeu_ps(out + j + 8, _mm256_mul_ps(acc1, vscale));
+    _mm256_storeu_ps(out + j + 16, _mm256_mul_ps(acc2, vscale));
+    _mm256_storeu_ps(out + j + 24, _mm256_mul_ps(acc3, vscale));
+  }
+  for (; j + 8 <= dim; j += 8) {
+    __m256 acc = _mm256_setzero_ps();
+    for (int r = 0; r < num_rows; r++) {
+      acc = _mm256_add_ps(acc, _mm256_loadu_ps(rows[r] + j));
+    }
+    _mm256_storeu_ps(out + j, _mm256_mul_ps(acc, vscale));
+  }
+  for (; j < dim; j++) {
+    float acc = 0.0f;
+    for (int r = 0; r < num_rows; r++) {
+      acc += rows[r][j];
+    }
+    out[j] = acc * scale;
+  }
+}
+
+__attribute__((target("avx512f"))) void
+    bag_sum_avx512(float const *const *rows,
+                   int num_rows,
+                   int dim,
+                   float scale,
+                   float *out) {
+  __m512 vscale = _mm512_set1_ps(scale);
+  int j = 0;
+  for (; j + 64 <= dim; j += 64) {
+    __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+    __m512 acc2 = _mm512_setzero_ps(), acc3 = _mm512_setzero_ps();
+    for (int r = 0; r < num_rows; r++) {
+      float const *row = rows[r] + j;
+      acc0 = _mm512_add_ps(acc0, _mm512_loadu_ps(row));
+      acc1 = _mm512_add_ps(acc1, _mm512_loadu_ps(row + 16));
+      acc2 = _mm512_add_ps(acc2, _mm512_loadu_ps(row + 32));
+      acc3 = _mm512_add_ps(acc3, _mm512_loadu_ps(row + 48));
+    }
+    _mm512_storeu_ps(out + j, _mm512_mul_ps(acc0, vscale));
+    _mm512_storeu_ps(out + j + 16, _mm512_mul_ps(acc1, vscale));
+    _mm512_storeu_ps(out + j + 32, _mm512_mul_ps(acc2, vscale));
+    _mm512_storeu_ps(out + j + 48, _mm512_mul_ps(acc3, vscale));
+  }
+  // masked loads cover any remainder of the embedding dim
+  for (; j < dim; j += 16) {
+    __mmask16 mask = dim - j >= 16 ? (__mmask16)0xFFFF
+                                   : (__mmask16)((1u << (dim - j)) - 1);
+    __m512 acc = _mm512_setzero_ps();
+    for (int r = 0; r < num_rows; r++) {
+      acc = _mm512_add_ps(acc, _mm512_maskz_loadu_ps(mask, rows[r] + j));
+    }
+    _mm512_mask_storeu_ps(out + j, mask, _mm512_mul_ps(acc, vscale));
+  }
+}
+#endif
+
+BagSum get_bag_sum(void) {
+#ifdef FF_EMBED_X86
+  if (__builtin_cpu_supports("avx512f")) {
+    return bag_sum_avx512;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return bag_sum_avx2;
+  }
+#endif
+  return bag_sum_generic;
+}
+
+// Collects the rows of one bag into rows, skipping padding (negative)
+// indices, and prefetches them so the loads overlap the previous bag's sum.
+// Rows in hot_tier, if any, are read from its copy
+template <typename TI>
+int gather_bag(TI const *indices,
+               int len,
+               float const *weight,
+               EmbeddingHotTier const *hot_tier,
+               int dim,
+               float const **rows) {
+  int num_rows = 0;
+  for (int i = 0; i < len; i++) {
+    if (indices[i] < 0) {
+      continue;
+    }
+    float const *row = hot_tier != nullptr ? hot_tier->find(indices[i])
+                                           : nullptr;
+    if (row == nullptr) {
+      row = weight + (size_t)indices[i] * dim;
+    }
+    // one prefetch per 64-byte cache line
+    for (int off = 0; off < dim; off += 16) {
+      __builtin_prefetch(row + off);
+    }
+    rows[num_rows++] = row;
+  }
+  return num_rows;
+}
+
+// AGGR_MODE_NONE is a bag of one index per output row
+template <typename TI>
+void forward_bags(TI const *input_ptr,
+                  float *output_ptr,
+                  float const *weight_ptr,
+                  EmbeddingHotTier const *hot_tier,
+                  int in_dim,
+                  int out_dim,
+                  int batch_size,
+                  AggrMode aggr) {
+  assert(aggr == AGGR_MODE_NONE || aggr == AGGR_MODE_SUM ||
+         aggr == AGGR_MODE_AVG);
+  static BagSum const bag_sum = get_bag_sum();
+  cpu_parallel_for(
+      batch_size, EMBED_PARALLEL_GRAIN, [&](size_t begin, size_t end) {
+        std::vector<float const *> rows(in_dim), next_rows(in_dim);
+        int num_rows = gather_bag(input_ptr + begin * in_dim,
+                                  in_dim,
+                                  weight_ptr,
+                                  hot_tier,
+                                  out_dim,
+                                  rows.data());
+        for (size_t bag = begin; bag < end; bag++) {
+          int num_next_rows = 0;
+          if (bag + 1 < end) {
+            num_next_rows = gather_bag(input_ptr + (bag + 1) * in_dim,
+                                       in_dim,
+                                       weight_ptr,
+                                       hot_tier,
+                                       out_dim,
+                                       next_rows.data());
+          }
+          // averages use the bag's real length, without padding
+          float scale = 1.0f;
+          if (aggr == AGGR_MODE_AVG && num_rows > 0) {
+            scale = 1.0f / num_rows;
+          }
+          bag_sum(rows.data(),
+                  num_rows,
+                  out_dim,
+                  scale,
+                  output_ptr + bag * out_dim);
+          rows.swap(next_rows);
+          num_rows = num_next_rows;
+        }
+      });
+}
+
+} // namespace
+
+/*static*/
+template <typename TI>
+void Embedding::forward_kernel(const TI *input_ptr,
+                               float *output_ptr,
+                               float const *weight_ptr,
+                               int in_dim,
+                               int out_dim,
+                               int batch_size,
+                               AggrMode aggr,
+                               int outputSize,
+                               ffStream_t stream) {
+  forward_bags(input_ptr,
+               output_ptr,
+               weight_ptr,
+               (EmbeddingHotTier const *)nullptr,
+               in_dim,
+               out_dim,
+               batch_size,
+               aggr);
+}
+
+/*static*/
+template <typename TI>
+void Embedding::forward_kernel_wrapper(EmbeddingMeta const *m,
+                                       const TI *input_ptr,
+                                       float *output_ptr,
+                                       float const *weight_ptr,
+                                       int in_dim,
+                                       int out_dim,
+                                       int batch_size,
+                                       AggrMode aggr,
+                                       int outputSize) {
+  EmbeddingHotTier *tier = m->hot_tier.get();
+  if (tier == nullptr) {
+    ffStream_t stream;
+    get_legion_stream(&stream);
+    Embedding::forward_kernel<TI>(input_ptr,
+                                  output_ptr,
+                                  weight_ptr,
+                                  in_dim,
+                                  out_dim,
+                                  batch_size,
+                                  aggr,
+                                  outputSize,
+                                  stream);
+    return;
+  }
+  bool refresh_due =
+      tier->record_batch(input_ptr, (size_t)batch_size * in_dim);
+  forward_bags(input_ptr,
+               output_ptr,
+               weight_ptr,
+               m->serve_hot_tier ? tier : nullptr,
+               in_dim,
+               out_dim,
+               batch_size,
+               aggr);
+  if (refresh_due) {
+    // training updates the table in place, so there the tier only
+    // projects the hit rate a cache in front of the table would get
+    log_embedding.info("hot tier %s = %.2lf%% over %llu sampled lookups",
+                       m->serve_hot_tier ? "hit rate" : "projected hit rate",
+                       100.0 * tier->get_hit_rate(),
+                       (unsigned long long)tier->get_lookups());
+    tier->refresh(weight_ptr);
+  }
+}
+
+/*static*/
+template <typename TI>
+void Embedding::sparse_backward_kernel(TI const *input_ptr,
+                                       float const *output_ptr,
+                                       EmbeddingSparseGrad &grad,
+                                       int in_dim,
+                                       int out_dim,
+                                       int batch_size,
+                                       AggrMode aggr) {
+  // (row, bag) pairs sorted by row, so that each touched row is reduced
+  // once without atomics
+  std::vector<std::pair<int64_t, int>> lookups;
+  lookups.reserve((size_t)batch_size * in_dim);
+  std::vector<float> scales(batch_size, 1.0f);
+  for (int bag = 0; bag < batch_size; bag++) {
+    TI const *indices = input_ptr + (size_t)bag * in_dim;
+    int len = 0;
+    for (int i = 0; i < in_dim; i++) {
+      if (indices[i] >= 0) {
+        lookups.push_back(std::make_pair((int64_t)indices[i], bag));
+        len++;
+      }
+    }
+    if (aggr == AGGR_MODE_AVG && len > 0) {
+      scales[bag] = 1.0f / len;
+    }
+  }
+  std::sort(lookups.begin(), lookups.end());
+  grad.rows.clear();
+  std::vector<size_t> starts;
+  for (size_t i = 0; i < lookups.size(); i++) {
+    if (i == 0 || lookups[i].first != lookups[i - 1].first) {
+      grad.rows.push_back(lookups[i].first);
+      starts.push_back(i);
+    }
+  }
+  starts.push_back(lookups.size());
+  grad.values.assign(grad.rows.size() * out_dim, 0.0f);
+  cpu_parallel_for(
+      grad.rows.size(), EMBED_PARALLEL_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t r = begin; r < end; r++) {
+          float *values = grad.values.data() + r * out_dim;
+          for (size_t i = starts[r]; i < starts[r + 1]; i++) {
+            int bag = lookups[i].second;
+            float scale = scales[bag];
+            float const *output = output_ptr + (size_t)bag * out_dim;
+            for (int off = 0; off < out_dim; off++) {
+              values[off] += scale * output[off];
+            }
+          }
+        }
+      });
+}
+
+/*static*/
+template <typename TI>
+void Embedding::backward_kernel(const TI *input_ptr,
+                                float const *output_ptr,
+                                float *weight_grad_ptr,
+                                int in_dim,
+                                int out_dim,
+                                int batch_size,
+                                AggrMode aggr,
+                                int outputSize,
+                                ffStream_t stream) {
+  assert(aggr == AGGR_MODE_NONE || aggr == AGGR_MODE_SUM ||
+         aggr == AGGR_MODE_AVG);
+  EmbeddingSparseGrad grad;
+  sparse_backward_kernel<TI>(
+      input_ptr, output_ptr, grad, in_dim, out_dim, batch_size, aggr);
+  // only the touched rows of the dense gradient are read and written
+  cpu_parallel_for(
+      grad.rows.size(), EMBED_PARALLEL_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t r = begin; r < end; r++) {
+          float *embed = weight_grad_ptr + (size_t)grad.rows[r] * out_dim;
+          float const *values = grad.values.data() + r * out_dim;
+          for (int off = 0; off < out_dim; off++) {
+            embed[off] += values[off];
+          }
+        }
+      });
+}
+
+/*static*/
+template <typename TI>
+void Embedding::backward_kernel_wrapper(EmbeddingMeta const *m,
+                                        const TI *input_ptr,
+                                        float const *output_ptr,
+                                        float *weight_grad_ptr,
+                                        int in_dim,
+                                        int out_dim,
+                                        int batch_size,
+                                        AggrMode aggr,
+                                        int outputSize) {
+  ffStream_t stream;
+  get_legion_stream(&stream);
+  Embedding::backward_kernel<TI>(input_ptr,
+                                 output_ptr,
+                                 weight_grad_ptr,
+                                 in_dim,
+                                 out_dim,
+                                 batch_size,
+                                 aggr,
+                                 outputSize,
+                                 stream);
+}
+
+/*static*/
+template <typename TI>
+void Embedding::sparse_backward_kernel_wrapper(EmbeddingMeta const *m,
+                                               TI const *input_ptr,
+                                               float const *output_ptr,
+                                               int64_t *rows_ptr,
+                                               float *values_ptr,
+                                               int capacity,
+                                               int in_dim,
+                                               int out_dim,
+                                               int batch_size,
+                                               AggrMode aggr) {
+  double t_start = 0.0;
+  if (m->profiling) {
+    t_start = cpu_wall_time_ms();
+  }
+  EmbeddingSparseGrad grad;
+  sparse_backward_kernel<TI>(
+      input_ptr, output_ptr, grad, in_dim, out_dim, batch_size, aggr);
+  int num_rows = grad.rows.size();
+  assert(num_rows <= capacity);
+  rows_ptr[0] = num_rows;
+  std::copy(grad.rows.begin(), grad.rows.end(), rows_ptr + 1);
+  std::copy(grad.values.begin(), grad.values.end(), values_ptr);
+  // so that the unused rows never look like an overflow under loss scaling
+  std::fill(values_ptr + (size_t)num_rows * out_dim,
+            values_ptr + (size_t)capacity * out_dim,
+            0.0f);
+  if (m->profiling) {
+    double elapsed = cpu_wall_time_ms() - t_start;
+    printf("[Embedding] sparse backward time = %.2lfms, rows = %d\n",
+           elapsed,
+           num_rows);
+  }
+}
+
+void Embedding::rand_generate_int64_wrapper(int64_t *ptr,
+                                            size_t size,
+                                            int64_t p) const {
+  // Randomly initialize the intput tensor to avoid out of index range issues
+  CPU_KERNEL_LOOP(i, (coord_t)size) {
+    ptr[i] = i % p;
+  }
+}
+
+template void
+    Embedding::forward_kernel_wrapper<int32_t>(EmbeddingMeta const *m,
+                                               int32_t const *input_ptr,
+                                               float *output_ptr,
+                                               float const *weight_ptr,
+                                               int in_dim,
+                                               int out_dim,
+                                               int batch_size,
+                                               AggrMode aggr,
+                                               int outputSize);
+template void
+    Embedding::forward_kernel_wrapper<int64_t>(EmbeddingMeta const *m,
+                                               int64_t const *input_ptr,
+                                               float *output_ptr,
+                                               float const *weight_ptr,
+                                               int in_dim,
+                                               int out_dim,
+                                               int batch_size,
+                                               AggrMode aggr,
+                                               int outputSize);
+
+template void
+    Embedding::backward_kernel_wrapper<int32_t>(EmbeddingMeta const *m,
+                                                int32_t const *input_ptr,
+                                                float const *output_ptr,
+                                                float *weight_grad_ptr,
+                                                int in_dim,
+                                                int out_dim,
+                                                int batch_size,
+                                                AggrMode aggr,
+                                                int outputSize);
+template void
+    Embedding::backward_kernel_wrapper<int64_t>(EmbeddingMeta const *m,
+                                                int64_t const *input_ptr,
+                                                float const *output_ptr,
+                                                float *weight_grad_ptr,
+                                                int in_dim,
+                                                int out_dim,
+                                                int batch_size,
+                                                AggrMode aggr,
+                                                int outputSize);
+
+template void Embedding::sparse_backward_kernel_wrapper<int32_t>(
+    EmbeddingMeta const *m,
+    int32_t const *input_ptr,
+    float const *output_ptr,
+    int64_t *rows_ptr,
+    float *values_ptr,
+    int capacity,
+    int in_dim,
+    int out_dim,
+    int batch_size,
+    AggrMode aggr);
+template void Embedding::sparse_backward_kernel_wrapper<int64_t>(
+    EmbeddingMeta const *m,
+    int64_t const *input_ptr,
+    float const *output_ptr,
+    int64_t *rows_ptr,
+    float *values_ptr,
+    int capacity,
+    int in_dim,
+    int out_dim,
+    int batch_size,
+    AggrMode aggr);
+
+template void
+    Embedding::sparse_backward_kernel<int32_t>(int32_t const *input_ptr,
+                                               float const *output_ptr,
+                                               EmbeddingSparseGrad &grad,
+                                               int in_dim,
+                                               int out_dim,
+                                               int batch_size,
+                                               AggrMode aggr);
+template void
+    Embedding::sparse_backward_kernel<int64_t>(int64_t const *input_ptr,
+                                               float const *output_ptr,
+                                               EmbeddingSparseGrad &grad,
+                                               int in_dim,
+                                               int out_dim,
+                                               int batch_size,
+                                               AggrMode aggr);
+
+}; // namespace FlexFlow
@@ -0,0 +1,995 @@
+/* Copyright 2020 Facebook
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flexflow/model.h"
+#include "flexflow/ops/batch_matmul.h"
+#include "flexflow/ops/batch_norm.h"
+#include "flexflow/ops/concat.h"
+#include "flexflow/ops/conv_2d.h"
+#include "flexflow/ops/dropout.h"
+#include "flexflow/ops/element_binary.h"
+#include "flexflow/ops/element_unary.h"
+#include "flexflow/ops/flat.h"
+#include "flexflow/ops/fused.h"
+#include "flexflow/ops/linear.h"
+#include "flexflow/ops/pool_2d.h"
+#include "flexflow/ops/reshape.h"
+#include "flexflow/ops/transpose.h"
+#include "flexflow/utils/cpu_helper.h"
+#include <cmath>
+
+namespace FlexFlow {
+// declare Legion names
+using Legion::Context;
+using Legion::coord_t;
+using Legion::Domain;
+using Legion::LogicalPartition;
+using Legion::LogicalRegion;
+using Legion::PhysicalRegion;
+using Legion::PointInRectIterator;
+using Legion::Rect;
+using Legion::Runtime;
+using Legion::Task;
+
+namespace {
+
+// Consecutive elementwise operators of a fused op run as one blocked loop:
+// every stage processes a block of elements before the next stage starts,
+// so the intermediate results are read back from cache rather than memory
+int const ELEMENTWISE_CHAIN_BLOCK = 2048;
+
+struct ElementwiseStage {
+  OperatorType op_type;
+  OpMeta *meta;
+  int num_inputs;
+  float const *inputs[2];
+  float *output;
+};
+
+struct SigmoidFn {
+  float operator()(float x) const {
+    return 1.0f / (1.0f + expf(-x));
+  }
+};
+struct ReluFn {
+  float operator()(float x) const {
+    return x > 0.0f ? x : 0.0f;
+  }
+};
+struct TanhFn {
+  float operator()(float x) const {
+    return tanhf(x);
+  }
+};
+struct EluFn {
+  float operator()(float x) const {
+    return x > 0.0f ? x : expf(x) - 1.0f;
+  }
+};
+struct ExpFn {
+  float operator()(float x) const {
+    return (float)exp(x);
+  }
+};
+struct IdentityFn {
+  float operator()(float x) const {
+    return x;
+  }
+};
+struct ScalarMulFn {
+  float scalar;
+  float operator()(float x) const {
+    return x * scalar;
+  }
+};
+struct ScalarAddFn {
+  float scalar;
+  float operator()(float x) const {
+    return x + scalar;
+  }
+};
+struct ScalarSubFn {
+  float scalar;
+  float operator()(float x) const {
+    return x - scalar;
+  }
+};
+struct ScalarDivFn {
+  float scalar;
+  float operator()(float x) const {
+    return x / scalar;
+  }
+};
+struct GeluFn {
+  float operator()(float x) const {
+    return (float)(x * 0.5 * erfc(-x * M_SQRT1_2));
+  }
+};
+struct RsqrtFn {
+  float operator()(float x) const {
+    return 1.0f / sqrtf(x);
+  }
+};
+struct PowFn {
+  float scalar;
+  float operator()(float x) const {
+    return powf(x, scalar);
+  }
+};
+struct AddFn {
+  float operator()(float a, float b) const {
+    return a + b;
+  }
+};
+struct SubFn {
+  float operator()(float a, float b) const {
+    return a - b;
+  }
+};
+struct MulFn {
+  float operator()(float a, float b) const {
+    return a * b;
+  }
+};
+
+template <typename F>
+void unary_block(F f, float const *in, float *out, coord_t n) {
+  for (coord_t i = 0; i < n; i++) {
+    out[i] = f(in[i]);
+  }
+}
+
+template <typename F>
+void binary_block(
+    F f, float const *in1, float const *in2, float *out, coord_t n) {
+  for (coord_t i = 0; i < n; i++) {
+    out[i] = f(in1[i], in2[i]);
+  }
+}
+
+// Elements [begin, begin + n) of one stage
+void run_stage_block(ElementwiseStage const &stage, coord_t begin, coord_t n) {
+  float const *in1 = stage.inputs[0] + begin;
+  float *out = stage.output + begin;
+  switch (stage.op_type) {
+    case OP_EW_ADD:
+      binary_block(AddFn(), in1, stage.inputs[1] + begin, out, n);
+      break;
+    case OP_EW_SUB:
+      binary_block(SubFn(), in1, stage.inputs[1] + begin, out, n);
+      break;
+    case OP_EW_MUL:
+      binary_block(MulFn(), in1, stage.inputs[1] + begin, out, n);
+      break;
+    case OP_DROPOUT: {
+      DropoutMeta *m = (DropoutMeta *)stage.meta;
+      uint8_t *mask = (uint8_t *)m->reserveSpace + begin;
+      float scale = m->rate < 1.0f ? 1.0f / (1.0f - m->rate) : 0.0f;
+      std::bernoulli_distribution keep(1.0f - m->rate);
+      for (coord_t i = 0; i < n; i++) {
+        mask[i] = keep(m->generator) ? 1 : 0;
+        out[i] = mask[i] ? in1[i] * scale : 0.0f;
+      }
+      break;
+    }
+    default: {
+      float scalar = ((ElementUnaryMeta *)stage.meta)->scalar;
+      switch (stage.op_type) {
+        case OP_SIGMOID:
+          unary_block(SigmoidFn(), in1, out, n);
+          break;
+        case OP_RELU:
+          unary_block(ReluFn(), in1, out, n);
+          break;
+        case OP_TANH:
+          unary_block(TanhFn(), in1, out, n);
+          break;
+        case OP_ELU:
+          unary_block(EluFn(), in1, out, n);
+          break;
+        case OP_EXP:
+          unary_block(ExpFn(), in1, out, n);
+          break;
+        case OP_IDENTITY:
+          unary_block(IdentityFn(), in1, out, n);
+          break;
+        case OP_SCALAR_MULTIPLY:
+          unary_block(ScalarMulFn{scalar}, in1, out, n);
+          break;
+        case OP_SCALAR_ADD:
+          unary_block(ScalarAddFn{scalar}, in1, out, n);
+          break;
+        case OP_SCALAR_SUB:
+          unary_block(ScalarSubFn{scalar}, in1, out, n);
+          break;
+        case OP_SCALAR_TRUE_DIV:
+          unary_block(ScalarDivFn{scalar}, in1, out, n);
+          break;
+        case OP_GELU:
+          unary_block(GeluFn(), in1, out, n);
+          break;
+        case OP_RSQRT:
+          unary_block(RsqrtFn(), in1, out, n);
+          break;
+        case OP_POW:
+          unary_block(PowFn{scalar}, in1, out, n);
+          break;
+        default:
+          assert(false);
+      }
+    }
+  }
+}
+
+// Bytes read and written by a chain when each stage makes its own pass over
+// memory, and when the chain reads its external inputs and writes every
+// output once
+void chain_bytes_moved(std::vector<ElementwiseStage> const &chain,
+                       coord_t volume,
+                       size_t &unfused_bytes,
+                       size_t &fused_bytes) {
+  size_t tensor_bytes = volume * sizeof(float);
+  std::vector<float const *> loaded;
+  unfused_bytes = fused_bytes = 0;
+  for (size_t s = 0; s < chain.size(); s++) {
+    ElementwiseStage const &stage = chain[s];
+    for (int i = 0; i < stage.num_inputs; i++) {
+      unfused_bytes += tensor_bytes;
+      bool produced = false;
+      for (size_t p = 0; p < s; p++) {
+        produced |= (chain[p].output == stage.inputs[i]);
+      }
+      if (!produced && std::find(loaded.begin(),
+                                 loaded.end(),
+                                 stage.inputs[i]) == loaded.end()) {
+        loaded.push_back(stage.inputs[i]);
+        fused_bytes += tensor_bytes;
+      }
+    }
+    size_t written = tensor_bytes;
+    if (stage.op_type == OP_DROPOUT) {
+      // the keep/drop mask
+      written += volume * sizeof(uint8_t);
+    }
+    unfused_bytes += written;
+    fused_bytes += written;
+  }
+}
+
+void run_elementwise_chain(FusedOp const *fused,
+                           std::vector<ElementwiseStage> const &chain,
+                           coord_t volume) {
+  double t_start = 0.0;
+  if (fused->profiling) {
+    t_start = cpu_wall_time_ms();
+  }
+  coord_t num_blocks =
+      (volume + ELEMENTWISE_CHAIN_BLOCK - 1) / ELEMENTWISE_CHAIN_BLOCK;
+  auto run_blocks = [&](size_t begin, size_t end) {
+    for (size_t b = begin; b < end; b++) {
+      coord_t lo = b * ELEMENTWISE_CHAIN_BLOCK;
+      coord_t n = std::min((coord_t)ELEMENTWISE_CHAIN_BLOCK, volume - lo);
+      for (ElementwiseStage const &stage : chain) {
+        run_stage_block(stage, lo, n);
+      }
+    }
+  };
+  bool has_dropout = false;
+  for (ElementwiseStage const &stage : chain) {
+    has_dropout |= (stage.op_type == OP_DROPOUT);
+  }
+  if (has_dropout) {
+    // dropout masks come from one sequential generator
+    run_blocks(0, num_blocks);
+  } else {
+    cpu_parallel_for(num_blocks, 1, run_blocks);
+  }
+  if (fused->profiling) {
+    double elapsed = cpu_wall_time_ms() - t_start;
+    size_t unfused_bytes, fused_bytes;
+    chain_bytes_moved(chain, volume, unfused_bytes, fused_bytes);
+    printf("Fused elementwise chain of %zu ops: %.2fMB moved unfused, "
+           "%.2fMB fused, time = %.2fms\n",
+           chain.size(),
+           unfused_bytes / 1e6,
+           fused_bytes / 1e6,
+           elapsed);
+  }
+}
+
+} // namespace
+
+OpMeta *FusedOp::init_task(Task const *task,
+                           std::vector<PhysicalRegion> const &regions,
+                           Context ctx,
+                           Runtime *runtime) {
+  FusedOp const *fused = (FusedOp *)task->args;
+  FusedOpMeta const *metas = (FusedOpMeta *)task->local_args;
+  FusedOpMeta *local_meta = new FusedOpMeta();
+  memcpy(local_meta, metas, sizeof(FusedOpMeta));
+  local_meta->fused_op = (FusedOp *)malloc(sizeof(FusedOp));
+  memcpy(static_cast<void *>(local_meta->fused_op),
+         static_cast<void const *>(fused),
+         sizeof(FusedOp));
+  return ((OpMeta *)local_meta);
+}
+
+/*
+  regions[...](I): inputs
+  regions[...](I): weights
+  regions[...](I): outputs
+*/
+void FusedOp::forward_task(Task const *task,
+                           std::vector<PhysicalRegion> const &regions,
+                           Context ctx,
+                           Runtime *runtime) {
+  // const FusedOp* fused = (FusedOp*) task->args;
+  FusedOpMeta const *metas = *((FusedOpMeta **)task->local_args);
+  FusedOp const *fused = metas->fused_op;
+  assert(metas->numOperators == fused->numOperators);
+  assert(regions.size() == task->regions.size());
+  assert((int)regions.size() ==
+         fused->numInputs + fused->numWeights + fused->numOutputs);
+  Domain input_domain[MAX_NUM_INPUTS];
+  Domain weight_domain[MAX_NUM_WEIGHTS];
+  Domain output_domain[MAX_NUM_OUTPUTS];
+  float const *input_ptr[MAX_NUM_INPUTS];
+  float const *weight_ptr[MAX_NUM_WEIGHTS];
+  float *output_ptr[MAX_NUM_OUTPUTS];
+  assert(fused->numInputs <= MAX_NUM_INPUTS);
+  for (int i = 0; i < fused->numInputs; i++) {
+    input_domain[i] = runtime->get_index_space_domain(
+        ctx, task->regions[i].region.get_index_space());
+    input_ptr[i] = helperGetTensorPointerRO<float>(
+        regions[i], task->regions[i], FID_DATA, ctx, runtime);
+  }
+  int roff = fused->numInputs;
+  assert(fused->numWeights <= MAX_NUM_WEIGHTS);
+  for (int i = 0; i < fused->numWeights; i++) {
+    weight_domain[i] = runtime->get_index_space_domain(
+        ctx, task->regions[i + roff].region.get_index_space());
+    weight_ptr[i] = helperGetTensorPointerRO<float>(
+        regions[i + roff], task->regions[i + roff], FID_DATA, ctx, runtime);
+  }
+  roff += fused->numWeights;
+  assert(task->arglen == fused->numWeights * sizeof(int));
+  int const *weight_versions = (int const *)task->args;
+  assert(fused->numOutputs <= MAX_NUM_OUTPUTS);
+  for (int i = 0; i < fused->numOutputs; i++) {
+    output_domain[i] = runtime->get_index_space_domain(
+        ctx, task->regions[i + roff].region.get_index_space());
+    output_ptr[i] = helperGetTensorPointerWO<float>(
+        regions[i + roff], task->regions[i + roff], FID_DATA, ctx, runtime);
+  }
+  ffStream_t stream;
+  get_legion_stream(&stream);
+
+  int ioff = 0, woff = 0, ooff = 0;
+  std::vector<ElementwiseStage> chain;
+  coord_t chain_volume = 0;
+  for (int op = 0; op < fused->numOperators; op++) {
+    Domain my_id[MAX_NUM_INPUTS];
+    Domain my_wd[MAX_NUM_WEIGHTS];
+    Domain my_od[MAX_NUM_OUTPUTS];
+    float const *my_ip[MAX_NUM_INPUTS];
+    float const *my_wp[MAX_NUM_WEIGHTS];
+    float *my_op[MAX_NUM_OUTPUTS];
+    for (int i = 0; i < fused->op_num_inputs[op]; i++) {
+      int my_off = fused->op_input_idx[i + ioff];
+      if (fused->op_input_source[i + ioff] == SOURCE_INPUT) {
+        my_id[i] = input_domain[my_off];
+        my_ip[i] = input_ptr[my_off];
+      } else if (fused->op_input_source[i + ioff] == SOURCE_OUTPUT) {
+        my_id[i] = output_domain[my_off];
+        my_ip[i] = output_ptr[my_off];
+      } else
+        assert(false);
+    }
+    for (int i = 0; i < fused->op_num_weights[op]; i++) {
+      assert(fused->op_weight_source[i + woff] == SOURCE_WEIGHT);
+      my_wd[i] = weight_domain[fused->op_weight_idx[i + woff]];
+      my_wp[i] = weight_ptr[fused->op_weight_idx[i + woff]];
+    }
+    for (int i = 0; i < fused->op_num_outputs[op]; i++) {
+      assert(fused->op_output_source[i + ooff] == SOURCE_OUTPUT);
+      my_od[i] = output_domain[fused->op_output_idx[i + ooff]];
+      my_op[i] = output_ptr[fused->op_output_idx[i + ooff]];
+    }
+    if (fused->op_is_chain_op[op]) {
+      assert(fused->op_num_inputs[op] <= 2);
+      assert(fused->op_num_weights[op] == 0);
+      assert(fused->op_num_outputs[op] == 1);
+      coord_t volume = my_od[0].get_volume();
+      for (int i = 0; i < fused->op_num_inputs[op]; i++) {
+        assert(my_id[i].get_volume() == volume);
+      }
+      if (!chain.empty() && volume != chain_volume) {
+        run_elementwise_chain(fused, chain, chain_volume);
+        chain.clear();
+      }
+      ElementwiseStage stage;
+      stage.op_type = fused->op_op_type[op];
+      stage.meta = metas->meta[op];
+      stage.num_inputs = fused->op_num_inputs[op];
+      for (int i = 0; i < stage.num_inputs; i++) {
+        stage.inputs[i] = my_ip[i];
+      }
+      stage.output = my_op[0];
+      chain.push_back(stage);
+      chain_volume = volume;
+      ioff += fused->op_num_inputs[op];
+      woff += fused->op_num_weights[op];
+      ooff += fused->op_num_outputs[op];
+      continue;
+    }
+    if (!chain.empty()) {
+      run_elementwise_chain(fused, chain, chain_volume);
+      chain.clear();
+    }
+    switch (fused->op_op_type[op]) {
+      case OP_CONCAT: {
+        assert(fused->op_num_weights[op] == 0);
+        assert(fused->op_num_outputs[op] == 1);
+        ConcatMeta *m = (ConcatMeta *)metas->meta[op];
+        int num_inputs = fused->op_num_inputs[op];
+        Concat::forward_kernel(my_op[0],
+                               my_ip,
+                               num_inputs,
+                               m->legion_axis,
+                               my_od[0],
+                               my_id,
+                               stream);
+        break;
+      }
+      case OP_CONV2D: {
+        assert(fused->op_num_inputs[op] == 1);
+        assert(fused->op_num_outputs[op] == 1);
+        assert(my_id[0].get_dim() == 4);
+        assert(my_wd[0].get_dim() == 4);
+        assert(my_od[0].get_dim() == 4);
+        Conv2DMeta *m = (Conv2DMeta *)metas->meta[op];
+        Conv2D::forward_kernel(
+            m, my_ip[0], my_op[0], my_wp[0], my_wp[1], stream);
+        break;
+      }
+      case OP_BATCHNORM: {
+        assert(fused->op_num_inputs[op] == 1);
+        assert(fused->op_num_outputs[op] == 1);
+        assert(my_id[0].get_dim() == 4);
+        assert(my_od[0].get_dim() == 4);
+        assert(my_wd[0].get_dim() == 1);
+        assert(my_wd[1].get_dim() == 1);
+        BatchNormMeta *m = (BatchNormMeta *)metas->meta[op];
+        BatchNorm::forward_kernel(
+            m, my_ip[0], my_op[0], my_wp[0], my_wp[1] /*, stream*/);
+        break;
+      }
+      case OP_LINEAR: {
+        assert(fused->op_num_inputs[op] == 1);
+        assert(fused->op_num_weights[op] == 2);
+        assert(fused->op_num_outputs[op] == 1);
+        Rect<2> kernel_rect = my_wd[0];
+        int in_dim = kernel_rect.hi[0] - kernel_rect.lo[0] + 1;
+        int out_dim = kernel_rect.hi[1] - kernel_rect.lo[1] + 1;
+        int batch_size = my_id[0].get_volume() / in_dim;
+        assert(my_od[0].get_volume() == out_dim * batch_size);
+        assert(my_id[0].get_volume() == in_dim * batch_size);
+        assert(my_wd[1].get_volume() == out_dim);
+        LinearMeta *m = (LinearMeta *)metas->meta[op];
+        int weight_version = weight_versions[fused->op_weight_idx[woff]];
+        if (m->packed_weight != NULL &&
+            m->packed_weight_version != weight_version) {
+          m->packed_weight->panels.clear();
+          m->packed_weight_version = weight_version;
+        }
+        Linear::forward_kernel(m,
+                               my_ip[0],
+                               my_op[0],
+                               my_wp[0],
+                               my_wp[1],
+                               in_dim,
+                               out_dim,
+                               batch_size,
+                               stream);
+        break;
+      }
+      case OP_BATCHMATMUL: {
+        assert(fused->op_num_inputs[op] == 2);
+        assert(fused->op_num_weights[op] == 0);
+        assert(fused->op_num_outputs[op] == 1);
+        Domain out_domain = my_od[0];
+        Domain a_domain = my_id[0];
+        Domain b_domain = my_id[1];
+        int m = b_domain.hi()[0] - b_domain.lo()[0] + 1;
+        assert(m == out_domain.hi()[0] - out_domain.lo()[0] + 1);
+        int n = a_domain.hi()[1] - a_domain.lo()[1] + 1;
+        assert(n == out_domain.hi()[1] - out_domain.lo()[1] + 1);
+        int k = a_domain.hi()[0] - a_domain.lo()[0] + 1;
+        assert(k == b_domain.hi()[1] - b_domain.lo()[1] + 1);
+        assert(a_domain.get_dim() == b_domain.get_dim());
+        assert(a_domain.get_dim() == out_domain.get_dim());
+        int batch = 1;
+        for (int i = 2; i < a_domain.get_dim(); i++) {
+          int dim_size = a_domain.hi()[i] - a_domain.lo()[i] + 1;
+          assert(dim_size == b_domain.hi()[i] - b_domain.lo()[i] + 1);
+          assert(dim_size == out_domain.hi()[i] - out_domain.lo()[i] + 1);
+          batch *= dim_size;
+        }
+        BatchMatmulMeta *meta = (BatchMatmulMeta *)metas->meta[op];
+        BatchMatmul::forward_kernel(meta,
+                                    my_op[0],
+                                    my_ip[0],
+                                    my_ip[1],
+                                    NULL,
+                                    m,
+                                    n,
+                                    k,
+                                    batch,
+                                    stream,
+                                    meta->a_seq_length_dim,
+                                    meta->b_seq_length_dim,
+                                    fused->iter_config.seq_length);
+        break;
+      }
+      case OP_EW_ADD:
+      case OP_EW_SUB:
+      case OP_EW_MUL:
+      case OP_EW_DIV: {
+        assert(fused->op_num_inputs[op] == 2);
+        assert(fused->op_num_weights[op] == 0);
+        assert(fused->op_num_outputs[op] == 1);
+        assert(my_id[0] == my_id[1]);
+        assert(my_id[0] == my_od[0]);
+        ElementBinaryMeta *m = (ElementBinaryMeta *)metas->meta[op];
+        ElementBinary::forward_kernel(m, my_ip[0], my_ip[1], my_op[0], stream);
+        break;
+      }
+      case OP_RELU:
+      case OP_SIGMOID:
+      case OP_TANH:
+      case OP_ELU: {
+        assert(fused->op_num_inputs[op] == 1);
+        assert(fused->op_num_weights[op] == 0);
+        assert(fused->op_num_outputs[op] == 1);
+        assert(my_id[0] == my_od[0]);
+        ElementUnaryMeta *m = (ElementUnaryMeta *)metas->meta[op];
+        ElementUnary::forward_kernel(
+            m, my_ip[0], my_op[0], my_id[0].get_volume(), stream);
+        break;
+      }
+      case OP_POOL2D: {
+        assert(fused->op_num_inputs[op] == 1);
+        assert(fused->op_num_weights[op] == 0);
+        assert(fused->op_num_outputs[op] == 1);
+        // assert(my_id[0] == my_od[0]);
+        Pool2DMeta *m = (Pool2DMeta *)metas->meta[op];
+        Pool2D::forward_kernel(m, my_ip[0], my_op[0], stream);
+        break;
+      }
+      case OP_FLAT: {
+        assert(fused->op_num_inputs[op] == 1);
+        assert(fused->op_num_weights[op] == 0);
+        assert(fused->op_num_outputs[op] == 1);
+        assert(my_id[0].get_volume() == my_od[0].get_volume());
+        Flat::forward_kernel(my_ip[0], my_op[0], my_id[0].get_volume(), stream);
+        break;
+      }
+      case OP_RESHAPE: {
+        assert(fused->op_num_inputs[op] == 1);
+        assert(fused->op_num_weights[op] == 0);
+        assert(fused->op_num_outputs[op] == 1);
+        assert(my_id[0].get_volume() == my_od[0].get_volume());
+        Reshape::forward_kernel(
+            my_ip[0], my_op[0], my_id[0].get_volume(), stream);
+        break;
+      }
+      case OP_TRANSPOSE: {
+        assert(fused->op_num_inputs[op] == 1);
+        assert(fused->op_num_weights[op] == 0);
+        assert(fused->op_num_outputs[op] == 1);
+        assert(my_id[0].get_volume() == my_od[0].get_volume());
+        TransposeMeta *m = (TransposeMeta *)metas->meta[op];
+        Transpose::forward_kernel(
+            m, my_ip[0], my_op[0], my_id[0], my_od[0], stream);
+        break;
+      }
+      default: {
+        fprintf(stderr,
+                "Fusion currently does not support type = %d\n",
+                fused->op_op_type[op]);
+        assert(false && "Fusion currently does not support type");
+      }
+    }
+    ioff += fused->op_num_inputs[op];
+    woff += fused->op_num_weights[op];
+    ooff += fused->op_num_outputs[op];
+  }
+  if (!chain.empty()) {
+    run_elementwise_chain(fused, chain, chain_volume);
+  }
+  // for (int i = 0; i < fused->numOutputs; i++)
+  //   print_tensor<float>(output_ptr[i], output_domain[i].get_volume(),
+  //   "[Fused:forward:output]");
+}
+
+/*
+  regions[...](I): input
+  regions[...](I): weight
+  regions[...](I): output
+  regions[...](I/O): input_grad
+  regions[...](I/O): weight_grad
+  regions[...](I/O): output_grad
+*/
+
+void FusedOp::backward_task(Task const *task,
+                            std::vector<PhysicalRegion> const &regions,
+                            Context ctx,
+                            Runtime *runtime) {
+  // const FusedOp* fused = (FusedOp*) task->args;
+  FusedOpMeta const *metas = *((FusedOpMeta **)task->local_args);
+  FusedOp const *fused = metas->fused_op;
+
+  assert(metas->numOperators == fused->numOperators);
+  assert(regions.size() == task->regions.size());
+  {
+    int sum = fused->numInputs + fused->numWeights + fused->numOutputs;
+    assert(sum * 2 == (int)regions.size());
+  }
+  Domain input_domain[MAX_NUM_INPUTS], input_grad_domain[MAX_NUM_INPUTS];
+  Domain weight_domain[MAX_NUM_WEIGHTS], weight_grad_domain[MAX_NUM_WEIGHTS];
+  Domain output_domain[MAX_NUM_OUTPUTS], output_grad_domain[MAX_NUM_OUTPUTS];
+  float const *input_ptr[MAX_NUM_INPUTS];
+  float *input_grad_ptr[MAX_NUM_INPUTS];
+  float const *weight_ptr[MAX_NUM_WEIGHTS];
+  float *weight_grad_ptr[MAX_NUM_WEIGHTS];
+  float const *output_ptr[MAX_NUM_OUTPUTS];
+  float *output_grad_ptr[MAX_NUM_OUTPUTS];
+  int roff = 0;
+  assert(fused->numInputs <= MAX_NUM_INPUTS);
+  for (int i = 0; i < fused->numInputs; i++) {
+    input_domain[i] = runtime->get_index_space_domain(
+        ctx, task->regions[i].region.get_index_space());
+    input_ptr[i] = helperGetTensorPointerRO<float>(
+        regions[i], task->regions[i], FID_DATA, ctx, runtime);
+  }
+  roff += fused->numInputs;
+  assert(fused->numWeights <= MAX_NUM_WEIGHTS);
+  for (int i = 0; i < fused->numWeights; i++) {
+    weight_domain[i] = runtime->get_index_space_domain(
+        ctx, task->regions[i + roff].region.get_index_space());
+    weight_ptr[i] = helperGetTensorPointerRO<float>(
+        regions[i + roff], task->regions[i + roff], FID_DATA, ctx, runtime);
+  }
+  roff += fused->numWeights;
+  assert(fused->numOutputs <= MAX_NUM_OUTPUTS);
+  for (int i = 0; i < fused->numOutputs; i++) {
+    output_domain[i] = runtime->get_index_space_domain(
+        ctx, task->regions[i + roff].region.get_index_space());
+    output_ptr[i] = helperGetTensorPointerRO<float>(
+        regions[i + roff], task->regions[i + roff], FID_DATA, ctx, runtime);
+  }
+  roff += fused->numOutputs;
+  for (int i = 0; i < fused->numInputs; i++) {
+    input_grad_domain[i] = runtime->get_index_space_domain(
+        ctx, task->regions[i + roff].region.get_index_space());
+    input_grad_ptr[i] = helperGetTensorPointerRW<float>(
+        regions[i + roff], task->regions[i + roff], FID_DATA, ctx, runtime);
+    assert(input_grad_domain[i] == input_domain[i]);
+  }
+  roff += fused->numInputs;
+  for (int i = 0; i < fused->numWeights; i++) {
+    weight_grad_domain[i] = runtime->get_index_space_domain(
+        ctx, task->regions[i + roff].region.get_index_space());
+    weight_grad_ptr[i] = helperGetTensorPointerRW<float>(
+        regions[i + roff], task->regions[i + roff], FID_DATA, ctx, runtime);
+    assert(weight_grad_domain[i].get_volume() == weight_domain[i].get_volume());
+  }
+  roff += fused->numWeights;
+  for (int i = 0; i < fused->numOutputs; i++) {
+    output_grad_domain[i] = runtime->get_index_space_domain(
+        ctx, task->regions[i + roff].region.get_index_space());
+    output_grad_ptr[i] = helperGetTensorPointerRW<float>(
+        regions[i + roff], task->regions[i + roff], FID_DATA, ctx, runtime);
+    assert(output_grad_domain[i] == output_domain[i]);
+  }
+  roff += fused->numOutputs;
+  ffStream_t stream;
+  get_legion_stream(&stream);
+
+  int ioff = 0, woff = 0, ooff = 0;
+  Domain my_id[MAX_NUM_INPUTS], my_grad_id[MAX_NUM_INPUTS];
+  Domain my_wd[MAX_NUM_WEIGHTS], my_grad_wd[MAX_NUM_WEIGHTS];
+  Domain my_od[MAX_NUM_OUTPUTS], my_grad_od[MAX_NUM_OUTPUTS];
+  float const *my_ip[MAX_NUM_INPUTS];
+  float const *my_wp[MAX_NUM_WEIGHTS];
+  float const *my_op[MAX_NUM_OUTPUTS];
+  float *my_grad_ip[MAX_NUM_INPUTS];
+  float *my_grad_wp[MAX_NUM_WEIGHTS];
+  float *my_grad_op[MAX_NUM_OUTPUTS];
+  // Do backpropagation in the reverse ordering
+  for (int op = 0; op < fused->numOperators; op++) {
+    ioff += fused->op_num_inputs[op];
+    woff += fused->op_num_weights[op];
+    ooff += fused->op_num_outputs[op];
+  }
+
+  for (int op = fused->numOperators - 1; op >= 0; op--) {
+    ioff -= fused->op_num_inputs[op];
+    woff -= fused->op_num_weights[op];
+    ooff -= fused->op_num_outputs[op];
+    for (int i = 0; i < fused->op_num_inputs[op]; i++) {
+      int my_off = fused->op_input_idx[i + ioff];
+      if (fused->op_input_source[i + ioff] == SOURCE_INPUT) {
+        my_id[i] = input_domain[my_off];
+        my_ip[i] = input_ptr[my_off];
+        my_grad_id[i] = input_grad_domain[my_off];
+        my_grad_ip[i] = input_grad_ptr[my_off];
+        assert(my_grad_id[i] == my_id[i]);
+      } else if (fused->op_input_source[i + ioff] == SOURCE_OUTPUT) {
+        my_id[i] = output_domain[my_off];
+        my_ip[i] = output_ptr[my_off];
+        my_grad_id[i] = output_grad_domain[my_off];
+        my_grad_ip[i] = output_grad_ptr[my_off];
+        assert(my_grad_id[i] == my_id[i]);
+      } else
+        assert(false);
+    }
+    for (int i = 0; i < fused->op_num_weights[op]; i++) {
+      assert(fused->op_weight_source[i + woff] == SOURCE_WEIGHT);
+      my_wd[i] = weight_domain[fused->op_weight_idx[i + woff]];
+      my_wp[i] = weight_ptr[fused->op_weight_idx[i + woff]];
+      my_grad_wd[i] = weight_grad_domain[fused->op_weight_idx[i + woff]];
+      my_grad_wp[i] = weight_grad_ptr[fused->op_weight_idx[i + woff]];
+      assert(my_grad_wd[i].get_volume() == my_wd[i].get_volume());
+    }
+    for (int i = 0; i < fused->op_num_outputs[op]; i++) {
+      assert(fused->op_output_source[i + ooff] == SOURCE_OUTPUT);
+      my_od[i] = output_domain[fused->op_output_idx[i + ooff]];
+      my_op[i] = output_ptr[fused->op_output_idx[i + ooff]];
+      my_grad_od[i] = output_grad_domain[fused->op_output_idx[i + ooff]];
+      my_grad_op[i] = output_grad_ptr[fused->op_output_idx[i + ooff]];
+      assert(my_grad_od[i] == my_od[i]);
+    }
+    switch (fused->op_op_type[op]) {
+      case OP_CONCAT: {
+        assert(fused->op_num_weights[op] == 0);
+        assert(fused->op_num_outputs[op] == 1);
+        ConcatMeta *m = (ConcatMeta *)metas->meta[op];
+        int num_inputs = fused->op_num_inputs[op];
+        Concat::backward_kernel(my_grad_op[0],
+                                my_grad_ip,
+                                num_inputs,
+                                m->legion_axis,
+                                my_grad_od[0],
+                                my_grad_id,
+                                stream);
+        break;
+      }
+      case OP_CONV2D: {
+        assert(fused->op_num_inputs[op] == 1);
+        assert(fused->op_num_outputs[op] == 1);
+        assert(my_id[0].get_dim() == 4);
+        assert(my_wd[0].get_dim() == 4);
+        assert(my_od[0].get_dim() == 4);
+        Conv2DMeta *m = (Conv2DMeta *)metas->meta[op];
+        Conv2D::backward_kernel(m,
+                                my_ip[0],
+                                my_grad_ip[0],
+                                my_op[0],
+                                my_grad_op[0],
+                                my_wp[0],
+                                my_grad_wp[0],
+                                my_grad_wp[1],
+                                stream);
+        break;
+      }
+      case OP_BATCHNORM: {
+        assert(fused->op_num_inputs[op] == 1);
+        assert(fused->op_num_outputs[op] == 1);
+        assert(my_id[0].get_dim() == 4);
+        assert(my_wd[0].get_dim() == 1);
+        assert(my_wd[1].get_dim() == 1);
+        assert(my_od[0].get_dim() == 4);
+        BatchNormMeta *m = (BatchNormMeta *)metas->meta[op];
+        BatchNorm::backward_kernel(m,
+                                   my_ip[0],
+                                   my_grad_op[0],
+                                   my_op[0],
+                                   my_grad_ip[0],
+                                   my_wp[0],
+                                   my_grad_wp[0],
+                                   my_grad_wp[1],
+                                   my_od[0].get_volume() /*, stream*/);
+        break;
+      }
+      case OP_DROPOUT: {
+        assert(fused->op_num_inputs[op] == 1);
+        assert(fused->op_num_outputs[op] == 1);
+        DropoutMeta *m = (DropoutMeta *)metas->meta[op];
+        Dropout::backward_kernel(m, my_grad_op[0], my_grad_ip[0], stream);
+        break;
+      }
+      case OP_LINEAR: {
+        assert(fused->op_num_inputs[op] == 1);
+        assert(fused->op_num_weights[op] == 2);
+        assert(fused->op_num_outputs[op] == 1);
+        Rect<2> kernel_rect = my_wd[0];
+        int in_dim = kernel_rect.hi[0] - kernel_rect.lo[0] + 1;
+        int out_dim = kernel_rect.hi[1] - kernel_rect.lo[1] + 1;
+        int batch_size = my_id[0].get_volume() / in_dim;
+        assert(my_od[0].get_volume() == out_dim * batch_size);
+        assert(my_id[0].get_volume() == in_dim * batch_size);
+        assert(my_wd[1].get_volume() == out_dim);
+        LinearMeta *m = (LinearMeta *)metas->meta[op];
+        Linear::backward_kernel(m,
+                                my_ip[0],
+                                my_grad_ip[0],
+                                my_op[0],
+                                my_grad_op[0],
+                                my_wp[0],
+                                my_grad_wp[0],
+                                my_grad_wp[1],
+                                in_dim,
+                                out_dim,
+                                batch_size,
+                                stream);
+        break;
+      }
+      case OP_BATCHMATMUL: {
+        assert(fused->op_num_inputs[op] == 2);
+        assert(fused->op_num_weights[op] == 0);
+        assert(fused->op_num_outputs[op] == 1);
+        Domain out_domain = my_od[0];
+        Domain a_domain = my_id[0];
+        Domain b_domain = my_id[1];
+        // check dims
+        int m = b_domain.hi()[0] - b_domain.lo()[0] + 1;
+        assert(m == out_domain.hi()[0] - out_domain.lo()[0] + 1);
+        int n = a_domain.hi()[1] - a_domain.lo()[1] + 1;
+        assert(n == out_domain.hi()[1] - out_domain.lo()[1] + 1);
+        int k = a_domain.hi()[0] - a_domain.lo()[0] + 1;
+        assert(k == b_domain.hi()[1] - b_domain.lo()[1] + 1);
+        assert(a_domain.get_dim() == b_domain.get_dim());
+        assert(a_domain.get_dim() == out_domain.get_dim());
+        int batch = 1;
+        for (int i = 2; i < a_domain.get_dim(); i++) {
+          int dim_size = a_domain.hi()[i] - a_domain.lo()[i] + 1;
+          assert(dim_size == b_domain.hi()[i] - b_domain.lo()[i] + 1);
+          assert(dim_size == out_domain.hi()[i] - out_domain.lo()[i] + 1);
+          batch *= dim_size;
+        }
+        BatchMatmulMeta *meta = (BatchMatmulMeta *)metas->meta[op];
+        BatchMatmul::backward_kernel(meta,
+                                     my_op[0],
+                                     my_grad_op[0],
+                                     my_ip[0],
+                                     my_grad_ip[0],
+                                     my_ip[1],
+                                     my_grad_ip[1],
+                                     NULL,
+                                     m,
+                                     n,
+                                     k,
+                                     batch,
+                                     stream);
+        break;
+      }
+      case OP_EW_ADD:
+      case OP_EW_SUB:
+      case OP_EW_MUL:
+      case OP_EW_DIV: {
+        assert(fused->op_num_inputs[op] == 2);
+        assert(fused->op_num_weights[op] == 0);
+        assert(fused->op_num_outputs[op] == 1);
+        assert(my_id[0] == my_id[1]);
+        assert(my_id[0] == my_od[0]);
+        ElementBinaryMeta *m = (ElementBinaryMeta *)metas->meta[op];
+        ElementBinary::backward_kernel(m,
+                                       my_grad_op[0],
+                                       my_ip[0],
+                                       my_ip[1],
+                                       my_grad_ip[0],
+                                       my_grad_ip[1],
+                                       stream);
+        break;
+      }
+      case OP_RELU:
+      case OP_SIGMOID:
+      case OP_TANH:
+      case OP_ELU:
+      case OP_EXP:
+      case OP_IDENTITY:
+      case OP_SCALAR_MULTIPLY:
+      case OP_SCALAR_ADD:
+      case OP_SCALAR_SUB:
+      case OP_SCALAR_TRUE_DIV:
+      case OP_GELU:
+      case OP_RSQRT:
+      case OP_POW: {
+        assert(fused->op_num_inputs[op] == 1);
+        assert(fused->op_num_weights[op] == 0);
+        assert(fused->op_num_outputs[op] == 1);
+        assert(my_id[0] == my_od[0]);
+        ElementUnaryMeta *m = (ElementUnaryMeta *)metas->meta[op];
+        ElementUnary::backward_kernel(m,
+                                      my_ip[0],
+                                      my_grad_ip[0],
+                                      my_op[0],
+                                      my_grad_op[0],
+                                      my_id[0].get_volume(),
+                                      stream);
+        break;
+      }
+      case OP_POOL2D: {
+        assert(fused->op_num_inputs[op] == 1);
+        assert(fused->op_num_weights[op] == 0);
+        assert(fused->op_num_outputs[op] == 1);
+        // assert(my_id[0] == my_od[0]);
+        Pool2DMeta *m = (Pool2DMeta *)metas->meta[op];
+        Pool2D::backward_kernel(
+            m, my_ip[0], my_grad_ip[0], my_op[0], my_grad_op[0], stream);
+        break;
+      }
+      case OP_FLAT: {
+        assert(fused->op_num_inputs[op] == 1);
+        assert(fused->op_num_weights[op] == 0);
+        assert(fused->op_num_outputs[op] == 1);
+        assert(my_grad_id[0].get_volume() == my_grad_od[0].get_volume());
+        Flat::backward_kernel(
+            my_grad_ip[0], my_grad_op[0], my_grad_id[0].get_volume(), stream);
+        break;
+      }
+      case OP_RESHAPE: {
+        assert(fused->op_num_inputs[op] == 1);
+        assert(fused->op_num_weights[op] == 0);
+        assert(fused->op_num_outputs[op] == 1);
+        assert(my_grad_id[0].get_volume() == my_grad_od[0].get_volume());
+        Reshape::backward_kernel(
+            my_grad_ip[0], my_grad_op[0], my_grad_id[0].get_volume(), stream);
+        break;
+      }
+      case OP_TRANSPOSE: {
+        assert(fused->op_num_inputs[op] == 1);
+        assert(fused->op_num_weights[op] == 0);
+        assert(fused->op_num_outputs[op] == 1);
+        assert(my_grad_id[0].get_volume() == my_grad_od[0].get_volume());
+        TransposeMeta *m = (TransposeMeta *)metas->meta[op];
+        Transpose::backward_kernel(m,
+                                   my_grad_ip[0],
+                                   my_grad_op[0],
+                                   my_grad_id[0],
+                                   my_grad_od[0],
+                                   stream);
+        break;
+      }
+      default:
+        assert(false && "Fusion currently does not support type");
+    }
+  }
+  assert(ioff == 0);
+  assert(woff == 0);
+  assert(ooff == 0);
+  // for (int i = 0; i < fused->numWeights; i++)
+  //   print_tensor<float>(weight_grad_ptr[i],
+  //   weight_grad_domain[i].get_volume(), "[Fused:backward:weight_grad]");
+  // for (int i = 0; i < fused->numInputs; i++)
+  //   print_tensor<float>(input_grad_ptr[i], input_grad_domain[i].get_volume(),
+  //   "[Fused:backward:input_grad]");
+  // for (int i = 0; i < fused->numOutputs; i++)
+  //   print_tensor<float>(output_grad_ptr[i],
+  //   output_grad_domain[i].get_volume(), "[Fused:backward:output_grad]");
+}
+
+}; // namespace FlexFlow
@@ -0,0 +1,110 @@
+/* Copyright 2019 Stanford
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flexflow/ops/groupby.h"
+#include "flexflow/utils/cpu_helper.h"
+#include "flexflow/utils/moe_routing.h"
+#include <math.h>
+#include <stdio.h>
+
+namespace FlexFlow {
+
+// Expert rows are copied across threads in chunks of this many
+size_t const GROUP_BY_PARALLEL_GRAIN = 32;
+
+/*static*/
+void Group_by::forward_kernel_wrapper(
+    GroupByMeta const *m,
+    float const *input,
+    int const *exp_assign,
+    float **outputs,
+    int n,       // num experts
+    int k,       // chosen experts
+    float alpha, // factor additional memory assigned
+    int batch_size,
+    int data_dim) {
+  double t_start = 0.0;
+  if (m->profiling) {
+    t_start = cpu_wall_time_ms();
+  }
+  int capacity = get_expert_capacity(alpha, n, k, batch_size);
+  MoeRouting routing;
+  moe_route(exp_assign, k * batch_size, n, capacity, routing);
+  // gather every expert row from its sample, and zero the rows left unused
+  // by the expert's pairs so that the expert computes on defined inputs
+  cpu_parallel_for((size_t)n * capacity,
+                   GROUP_BY_PARALLEL_GRAIN,
+                   [&](size_t begin, size_t end) {
+                     for (size_t r = begin; r < end; r++) {
+                       int expert = r / capacity, row = r % capacity;
+                       float *output = outputs[expert] + row * data_dim;
+                       if (row >= routing.num_kept(expert)) {
+                         assign_kernel<float>(output, data_dim, 0.0f);
+                         continue;
+                       }
+                       int pair = routing.pairs[routing.offsets[expert] + row];
+                       copy_kernel<float>(
+                           output, input + (pair / k) * data_dim, data_dim);
+                     }
+                   });
+  if (m->profiling) {
+    double elapsed = cpu_wall_time_ms() - t_start;
+    printf("Group_by forward time = %.2fms, dropped %d of %d samples\n",
+           elapsed,
+           routing.num_dropped(),
+           k * batch_size);
+  }
+}
+
+void Group_by::backward_kernel_wrapper(
+    GroupByMeta const *m,
+    float *input_grad,
+    int const *exp_assign,
+    float **output_grads,
+    int n,       // num experts
+    int k,       // chosen experts
+    float alpha, // factor additional memory assigned
+    int batch_size,
+    int data_dim) {
+  int capacity = get_expert_capacity(alpha, n, k, batch_size);
+  MoeRouting routing;
+  moe_route(exp_assign, k * batch_size, n, capacity, routing);
+  // a sample's gradient sums the gradients of the experts it was sent to;
+  // dropped pairs contribute nothing
+  cpu_parallel_for(
+      batch_size, GROUP_BY_PARALLEL_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+          float *grad = input_grad + i * data_dim;
+          assign_kernel<float>(grad, data_dim, 0.0f);
+          for (int j = 0; j < k; j++) {
+            int row = routing.rows[i * k + j];
+            if (row >= 0) {
+              add_kernel<float>(grad,
+                                output_grads[exp_assign[i * k + j]] +
+                                    row * data_dim,
+                                data_dim);
+            }
+          }
+        }
+      });
+}
+
+GroupByMeta::GroupByMeta(FFHandler handler, int n) : OpMeta(handler) {
+  // Expert pointers are passed directly on the CPU
+  dev_region_ptrs = nullptr;
+}
+GroupByMeta::~GroupByMeta(void) {}
+
+}; // namespace FlexFlow
@@ -0,0 +1,171 @@
+/* Copyright 2020 Stanford
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flexflow/ops/layer_norm.h"
+#include "flexflow/utils/cpu_helper.h"
+#include <cmath>
+
+namespace FlexFlow {
+
+LayerNormMeta::LayerNormMeta(FFHandler handle, LayerNorm const *ln)
+    : OpMeta(handle) {
+  elementwise_affine = ln->elementwise_affine;
+  effective_batch_size = ln->effective_batch_size;
+  effective_num_elements = ln->effective_num_elements;
+  eps = ln->eps;
+  mean_ptr = new float[effective_batch_size];
+  rstd_ptr = new float[effective_batch_size];
+  ds_ptr = new float[effective_batch_size];
+  db_ptr = new float[effective_batch_size];
+  scale_ptr = new float[effective_batch_size];
+  bias_ptr = new float[effective_batch_size];
+}
+
+/*static*/
+template <typename T>
+void LayerNorm::forward_kernel(LayerNormMeta const *m,
+                               const T *in_ptr,
+                               T *out_ptr,
+                               T *gamma_ptr,
+                               T *beta_ptr,
+                               ffStream_t stream) {
+  const int64_t M = m->effective_batch_size;
+  const int64_t N = m->effective_num_elements;
+  for (int64_t i = 0; i < M; i++) {
+    T sum1 = 0, sum2 = 0;
+    for (int64_t j = 0; j < N; j++) {
+      sum1 += in_ptr[i * N + j];
+      sum2 += in_ptr[i * N + j] * in_ptr[i * N + j];
+    }
+    const T scale = T(1) / static_cast<T>(N);
+    sum1 *= scale;
+    sum2 = std::max(sum2 * scale - sum1 * sum1, T(0));
+    m->mean_ptr[i] = sum1;
+    m->rstd_ptr[i] = 1.0f / sqrtf(sum2 + m->eps);
+    for (int64_t j = 0; j < N; j++) {
+      const T gamma_v = gamma_ptr == nullptr ? T(1) : gamma_ptr[j];
+      const T beta_v = beta_ptr == nullptr ? T(0) : beta_ptr[j];
+      out_ptr[i * N + j] =
+          (in_ptr[i * N + j] - m->mean_ptr[i]) * m->rstd_ptr[i] * gamma_v +
+          beta_v;
+    }
+  }
+}
+
+/*static*/
+template <typename T>
+void LayerNorm::forward_kernel_wrapper(LayerNormMeta const *m,
+                                       const T *in_ptr,
+                                       T *out_ptr,
+                                       T *gamma_ptr,
+                                       T *beta_ptr) {
+  ffStream_t stream;
+  get_legion_stream(&stream);
+  LayerNorm::forward_kernel<float>(
+      m, in_ptr, out_ptr, gamma_ptr, beta_ptr, stream);
+}
+
+/*static*/
+template <typename T>
+void LayerNorm::backward_kernel(LayerNormMeta const *m,
+                                const T *output_grad_ptr,
+                                const T *input_ptr,
+                                T *input_grad_ptr,
+                                const T *gamma_ptr,
+                                T *gamma_grad_ptr,
+                                T *beta_grad_ptr,
+                                ffStream_t stream) {
+  const int64_t M = m->effective_batch_size;
+  const int64_t N = m->effective_num_elements;
+  for (int64_t i = 0; i < M; i++) {
+    T sum1 = 0, sum2 = 0;
+    for (int64_t j = 0; j < N; j++) {
+      const T gamma_v = gamma_ptr == nullptr ? T(1) : gamma_ptr[j];
+      sum1 += output_grad_ptr[i * N + j] * input_ptr[i * N + j] * gamma_v;
+      sum2 += output_grad_ptr[i * N + j] * gamma_v;
+    }
+    m->ds_ptr[i] = sum1;
+    m->db_ptr[i] = sum2;
+    const T s = T(1) / static_cast<T>(N);
+    const T rstd = m->rstd_ptr[i];
+    const T a = (m->db_ptr[i] * m->mean_ptr[i] - m->ds_ptr[i]) * rstd * rstd *
+                rstd * s;
+    m->scale_ptr[i] = a;
+    m->bias_ptr[i] = -(a * m->mean_ptr[i] + m->db_ptr[i] * rstd * s);
+    if (input_grad_ptr != NULL) {
+      for (int64_t j = 0; j < N; j++) {
+        const T gamma_v = gamma_ptr == nullptr ? T(1) : gamma_ptr[j];
+        input_grad_ptr[i * N + j] += rstd * output_grad_ptr[i * N + j] *
+                                         gamma_v +
+                                     m->scale_ptr[i] * input_ptr[i * N + j] +
+                                     m->bias_ptr[i];
+      }
+    }
+  }
+  if (gamma_grad_ptr != NULL || beta_grad_ptr != NULL) {
+    for (int64_t j = 0; j < N; j++) {
+      T sum1 = 0, sum2 = 0;
+      for (int64_t i = 0; i < M; i++) {
+        const int64_t index = i * N + j;
+        sum1 += output_grad_ptr[index] * (input_ptr[index] - m->mean_ptr[i]) *
+                m->rstd_ptr[i];
+        sum2 += output_grad_ptr[index];
+      }
+      if (gamma_grad_ptr != NULL) {
+        gamma_grad_ptr[j] = sum1;
+      }
+      if (beta_grad_ptr != NULL) {
+        beta_grad_ptr[j] = sum2;
+      }
+    }
+  }
+}
+
+/*static*/
+template <typename T>
+void LayerNorm::backward_kernel_wrapper(LayerNormMeta const *m,
+                                        const T *output_grad_ptr,
+                                        const T *input_ptr,
+                                        T *input_grad_ptr,
+                                        const T *gamma_ptr,
+                                        T *gamma_grad_ptr,
+                                        T *beta_grad_ptr) {
+  ffStream_t stream;
+  get_legion_stream(&stream);
+  LayerNorm::backward_kernel<float>(m,
+                                    output_grad_ptr,
+                                    input_ptr,
+                                    input_grad_ptr,
+                                    gamma_ptr,
+                                    gamma_grad_ptr,
+                                    beta_grad_ptr,
+                                    stream);
+}
+
+template void LayerNorm::forward_kernel_wrapper<float>(LayerNormMeta const *m,
+                                                       float const *in_ptr,
+                                                       float *out_ptr,
+                                                       float *gamma_ptr,
+                                                       float *beta_ptr);
+template void
+    LayerNorm::backward_kernel_wrapper<float>(LayerNormMeta const *m,
+                                              float const *output_grad_ptr,
+                                              float const *input_ptr,
+                                              float *input_grad_ptr,
+                                              float const *gamma_ptr,
+                                              float *gamma_grad_ptr,
+                                              float *beta_grad_ptr);
+
+}; // namespace FlexFlow
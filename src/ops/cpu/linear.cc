@@ -0,0 +1,228 @@
+/* Copyright 2020 Stanford
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flexflow/ops/linear.h"
+#include "flexflow/utils/cpu_gemm.h"
+#include "flexflow/utils/cpu_helper.h"
+
+namespace FlexFlow {
+
+/*static*/
+void Linear::init_kernel(LinearMeta *m, int batch_size, int channel) {
+  // CPU kernels only support float tensors
+  assert(m->input_type == DT_FLOAT);
+  assert(m->weight_type == DT_FLOAT);
+  assert(m->output_type == DT_FLOAT);
+  if (use_activation(m->activation)) {
+    assert(m->activation == AC_MODE_RELU || m->activation == AC_MODE_SIGMOID);
+  }
+}
+
+/*static*/
+void Linear::forward_kernel(LinearMeta const *m,
+                            void const *input_ptr,
+                            void *output_ptr,
+                            void const *weight_ptr,
+                            void const *bias_ptr,
+                            int in_dim,
+                            int out_dim,
+                            int batch_size,
+                            ffStream_t stream) {
+  // bias and activation run in the GEMM epilogue while each output tile
+  // is still in cache. forward_task empties the pack when the weights change
+  if (m->packed_weight != NULL) {
+    if (m->packed_weight->empty()) {
+      cpu_gemm_pack_a(true,
+                      out_dim,
+                      in_dim,
+                      (float const *)weight_ptr,
+                      in_dim,
+                      *m->packed_weight);
+    }
+    assert(m->packed_weight->m == out_dim && m->packed_weight->k == in_dim);
+    cpu_gemm_packed(*m->packed_weight,
+                    false,
+                    batch_size,
+                    1.0f,
+                    (float const *)input_ptr,
+                    in_dim,
+                    0.0f,
+                    (float *)output_ptr,
+                    out_dim,
+                    (float const *)bias_ptr,
+                    m->activation);
+    return;
+  }
+  cpu_gemm(true,
+           false,
+           out_dim,
+           batch_size,
+           in_dim,
+           1.0f,
+           (float const *)weight_ptr,
+           in_dim,
+           0,
+           (float const *)input_ptr,
+           in_dim,
+           0,
+           0.0f,
+           (float *)output_ptr,
+           out_dim,
+           0,
+           1,
+           (float const *)bias_ptr,
+           m->activation);
+}
+
+/*static*/
+void Linear::forward_kernel_wrapper(LinearMeta const *m,
+                                    void const *input_ptr,
+                                    void *output_ptr,
+                                    void const *weight_ptr,
+                                    void const *bias_ptr,
+                                    int in_dim,
+                                    int out_dim,
+                                    int batch_size) {
+  ffStream_t stream;
+  get_legion_stream(&stream);
+
+  double t_start = 0.0;
+  if (m->profiling) {
+    t_start = cpu_wall_time_ms();
+  }
+  Linear::forward_kernel(m,
+                         input_ptr,
+                         output_ptr,
+                         weight_ptr,
+                         bias_ptr,
+                         in_dim,
+                         out_dim,
+                         batch_size,
+                         stream);
+
+  if (m->profiling) {
+    double elapsed = cpu_wall_time_ms() - t_start;
+    printf("%s [Linear] forward time = %.2lfms\n", m->op_name, elapsed);
+  }
+}
+
+/*static*/
+void Linear::backward_kernel(LinearMeta const *m,
+                             void const *input_ptr,
+                             void *input_grad_ptr,
+                             void const *output_ptr,
+                             void *output_grad_ptr,
+                             void const *kernel_ptr,
+                             void *kernel_grad_ptr,
+                             void *bias_grad_ptr,
+                             int in_dim,
+                             int out_dim,
+                             int batch_size,
+                             ffStream_t stream) {
+  float *output_grad = (float *)output_grad_ptr;
+  int output_size = out_dim * batch_size;
+  // init_kernel only accepts the modes the backward can apply to the output
+  cpu_activation_backward(
+      m->activation, output_grad, (float const *)output_ptr, output_size);
+  // Compute weight gradiant
+  // NOTE: we use beta=1 for kernel_grad to accumulate gradients
+  cpu_sgemm(false,
+            true,
+            in_dim,
+            out_dim,
+            batch_size,
+            1.0f,
+            (float const *)input_ptr,
+            in_dim,
+            output_grad,
+            out_dim,
+            1.0f,
+            (float *)kernel_grad_ptr,
+            in_dim);
+  // Compute bias gradiant
+  // use_bias = True
+  if (bias_grad_ptr != NULL) {
+    float *bias_grad = (float *)bias_grad_ptr;
+    for (int b = 0; b < batch_size; b++) {
+      for (int o = 0; o < out_dim; o++) {
+        bias_grad[o] += output_grad[(size_t)b * out_dim + o];
+      }
+    }
+  }
+  // Compute data gradiant
+  if (input_grad_ptr != NULL) {
+    cpu_sgemm(false,
+              false,
+              in_dim,
+              batch_size,
+              out_dim,
+              1.0f,
+              (float const *)kernel_ptr,
+              in_dim,
+              output_grad,
+              out_dim,
+              1.0f,
+              (float *)input_grad_ptr,
+              in_dim);
+  }
+}
+
+/*static*/
+void Linear::backward_kernel_wrapper(LinearMeta const *m,
+                                     void const *input_ptr,
+                                     void *input_grad_ptr,
+                                     void const *output_ptr,
+                                     void *output_grad_ptr,
+                                     void const *kernel_ptr,
+                                     void *kernel_grad_ptr,
+                                     void *bias_grad_ptr,
+                                     int in_dim,
+                                     int out_dim,
+                                     int batch_size) {
+  ffStream_t stream;
+  get_legion_stream(&stream);
+
+  double t_start = 0.0;
+  if (m->profiling) {
+    t_start = cpu_wall_time_ms();
+  }
+  Linear::backward_kernel(m,
+                          input_ptr,
+                          input_grad_ptr,
+                          output_ptr,
+                          output_grad_ptr,
+                          kernel_ptr,
+                          kernel_grad_ptr,
+                          bias_grad_ptr,
+                          in_dim,
+                          out_dim,
+                          batch_size,
+                          stream);
+  if (m->profiling) {
+    double elapsed = cpu_wall_time_ms() - t_start;
+    printf("%s Linear backward time = %.2lfms\n", m->op_name, elapsed);
+  }
+}
+
+LinearMeta::LinearMeta(FFHandler handler, int batch_size) : OpMeta(handler) {
+  // Bias is added directly by the CPU kernels
+  one_ptr = NULL;
+}
+
+LinearMeta::~LinearMeta(void) {
+  delete packed_weight;
+}
+
+}; // namespace FlexFlow
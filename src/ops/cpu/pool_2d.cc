@@ -0,0 +1,180 @@
+/* Copyright 2020 Stanford
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flexflow/ops/pool_2d.h"
+#include "flexflow/utils/cpu_helper.h"
+#include <cfloat>
+
+namespace FlexFlow {
+
+/*static*/
+void Pool2D::init_kernel(Pool2D const *pool,
+                         Pool2DMeta *m,
+                         int input_w,
+                         int input_h,
+                         int input_c,
+                         int input_n,
+                         int output_w,
+                         int output_h,
+                         int output_c,
+                         int output_n,
+                         int pad_h,
+                         int pad_w) {
+  assert(pool->pool_type == POOL_MAX || pool->pool_type == POOL_AVG);
+  m->pool_type = pool->pool_type;
+  m->input_n = input_n;
+  m->input_c = input_c;
+  m->input_h = input_h;
+  m->input_w = input_w;
+  m->output_h = output_h;
+  m->output_w = output_w;
+  m->kernel_h = pool->kernel_h;
+  m->kernel_w = pool->kernel_w;
+  m->stride_h = pool->stride_h;
+  m->stride_w = pool->stride_w;
+  m->pad_h = pad_h;
+  m->pad_w = pad_w;
+  assert(input_n == output_n);
+  assert(input_c == output_c);
+  assert(output_h == (input_h + 2 * pad_h - m->kernel_h) / m->stride_h + 1);
+  assert(output_w == (input_w + 2 * pad_w - m->kernel_w) / m->stride_w + 1);
+}
+
+/*static*/
+void Pool2D::forward_kernel(Pool2DMeta const *m,
+                            float const *input_ptr,
+                            float *output_ptr,
+                            ffStream_t stream) {
+  int num_planes = m->input_n * m->input_c;
+  for (int p = 0; p < num_planes; p++) {
+    float const *input = input_ptr + (size_t)p * m->input_h * m->input_w;
+    float *output = output_ptr + (size_t)p * m->output_h * m->output_w;
+    for (int oh = 0; oh < m->output_h; oh++) {
+      int h_start = std::max(oh * m->stride_h - m->pad_h, 0);
+      int h_end = std::min(oh * m->stride_h - m->pad_h + m->kernel_h,
+                           m->input_h);
+      for (int ow = 0; ow < m->output_w; ow++) {
+        int w_start = std::max(ow * m->stride_w - m->pad_w, 0);
+        int w_end = std::min(ow * m->stride_w - m->pad_w + m->kernel_w,
+                             m->input_w);
+        float result = m->pool_type == POOL_MAX ? -FLT_MAX : 0.0f;
+        for (int ih = h_start; ih < h_end; ih++) {
+          for (int iw = w_start; iw < w_end; iw++) {
+            float v = input[ih * m->input_w + iw];
+            if (m->pool_type == POOL_MAX) {
+              result = std::max(result, v);
+            } else {
+              result += v;
+            }
+          }
+        }
+        // Average pooling excludes padding, as in cuDNN
+        if (m->pool_type == POOL_AVG) {
+          result /= (h_end - h_start) * (w_end - w_start);
+        }
+        output[oh * m->output_w + ow] = result;
+      }
+    }
+  }
+}
+
+/*static*/
+void Pool2D::forward_kernel_wrapper(Pool2DMeta const *m,
+                                    float const *input_ptr,
+                                    float *output_ptr) {
+  ffStream_t stream;
+  get_legion_stream(&stream);
+
+  double t_start = 0.0;
+  if (m->profiling) {
+    t_start = cpu_wall_time_ms();
+  }
+  Pool2D::forward_kernel(m, input_ptr, output_ptr, stream);
+  if (m->profiling) {
+    double elapsed = cpu_wall_time_ms() - t_start;
+    printf("%s [Pool2D] forward time = %.2fms\n", m->op_name, elapsed);
+  }
+}
+
+/*static*/
+void Pool2D::backward_kernel(Pool2DMeta const *m,
+                             float const *input_ptr,
+                             float *input_grad_ptr,
+                             float const *output_ptr,
+                             float const *output_grad_ptr,
+                             ffStream_t stream) {
+  int num_planes = m->input_n * m->input_c;
+  for (int p = 0; p < num_planes; p++) {
+    size_t in_offset = (size_t)p * m->input_h * m->input_w;
+    size_t out_offset = (size_t)p * m->output_h * m->output_w;
+    for (int oh = 0; oh < m->output_h; oh++) {
+      int h_start = std::max(oh * m->stride_h - m->pad_h, 0);
+      int h_end = std::min(oh * m->stride_h - m->pad_h + m->kernel_h,
+                           m->input_h);
+      for (int ow = 0; ow < m->output_w; ow++) {
+        int w_start = std::max(ow * m->stride_w - m->pad_w, 0);
+        int w_end = std::min(ow * m->stride_w - m->pad_w + m->kernel_w,
+                             m->input_w);
+        size_t out_idx = out_offset + oh * m->output_w + ow;
+        float dy = output_grad_ptr[out_idx];
+        if (m->pool_type == POOL_MAX) {
+          // Route the gradient to the first element matching the maximum
+          bool found = false;
+          for (int ih = h_start; ih < h_end && !found; ih++) {
+            for (int iw = w_start; iw < w_end && !found; iw++) {
+              size_t in_idx = in_offset + ih * m->input_w + iw;
+              if (input_ptr[in_idx] == output_ptr[out_idx]) {
+                input_grad_ptr[in_idx] += dy;
+                found = true;
+              }
+            }
+          }
+        } else {
+          dy /= (h_end - h_start) * (w_end - w_start);
+          for (int ih = h_start; ih < h_end; ih++) {
+            for (int iw = w_start; iw < w_end; iw++) {
+              input_grad_ptr[in_offset + ih * m->input_w + iw] += dy;
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+/*static*/
+void Pool2D::backward_kernel_wrapper(Pool2DMeta const *m,
+                                     float const *input_ptr,
+                                     float *input_grad_ptr,
+                                     float const *output_ptr,
+                                     float const *output_grad_ptr) {
+  ffStream_t stream;
+  get_legion_stream(&stream);
+
+  double t_start = 0.0;
+  if (m->profiling) {
+    t_start = cpu_wall_time_ms();
+  }
+  Pool2D::backward_kernel(
+      m, input_ptr, input_grad_ptr, output_ptr, output_grad_ptr, stream);
+  if (m->profiling) {
+    double elapsed = cpu_wall_time_ms() - t_start;
+    printf("Pool2D backward time = %.2fms\n", elapsed);
+  }
+}
+
+Pool2DMeta::Pool2DMeta(FFHandler handler) : OpMeta(handler) {}
+
+}; // namespace FlexFlow
@@ -0,0 +1,129 @@
+/* Copyright 2020 Stanford
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flexflow/ops/softmax.h"
+#include "flexflow/utils/cpu_helper.h"
+#include "flexflow/utils/hash_utils.h"
+#include <cmath>
+
+namespace FlexFlow {
+// declare Legion names
+using Legion::coord_t;
+using Legion::Domain;
+
+SoftmaxMeta::SoftmaxMeta(FFHandler handler,
+                         Softmax const *softmax,
+                         Domain const &input_domain)
+    : OpMeta(handler) {
+  data_type = softmax->outputs[0]->data_type;
+  // Same NCHW view of the domain as cudnnSetTensorDescriptorFromDomain
+  int ndims = input_domain.get_dim();
+  assert(ndims >= 1 && ndims <= 5);
+  int channel_dim = ndims == 5 ? 2 : ndims - 2;
+  outer_size = channel_size = inner_size = 1;
+  for (int i = 0; i < ndims; i++) {
+    int size = input_domain.hi()[i] - input_domain.lo()[i] + 1;
+    if (i < channel_dim) {
+      inner_size *= size;
+    } else if (i == channel_dim) {
+      channel_size = size;
+    } else {
+      outer_size *= size;
+    }
+  }
+  dim = softmax->dim;
+  profiling = softmax->profiling;
+  std::strcpy(op_name, softmax->name);
+}
+
+/* static */
+void Softmax::forward_kernel(SoftmaxMeta const *m,
+                             void const *_input_ptr,
+                             void *_output_ptr,
+                             ffStream_t stream) {
+  assert(m->data_type == DT_FLOAT);
+  float const *input_ptr = (float const *)_input_ptr;
+  float *output_ptr = (float *)_output_ptr;
+  for (int o = 0; o < m->outer_size; o++) {
+    for (int in = 0; in < m->inner_size; in++) {
+      size_t base = (size_t)o * m->channel_size * m->inner_size + in;
+      float max_val = input_ptr[base];
+      for (int c = 1; c < m->channel_size; c++) {
+        max_val = std::max(max_val, input_ptr[base + c * m->inner_size]);
+      }
+      float sum = 0.0f;
+      for (int c = 0; c < m->channel_size; c++) {
+        size_t idx = base + c * m->inner_size;
+        output_ptr[idx] = expf(input_ptr[idx] - max_val);
+        sum += output_ptr[idx];
+      }
+      for (int c = 0; c < m->channel_size; c++) {
+        output_ptr[base + c * m->inner_size] /= sum;
+      }
+    }
+  }
+}
+
+/* static */
+void Softmax::forward_kernel_wrapper(SoftmaxMeta const *m,
+                                     void const *input_ptr,
+                                     void *output_ptr) {
+  ffStream_t stream;
+  get_legion_stream(&stream);
+
+  double t_start = 0.0;
+  if (m->profiling) {
+    t_start = cpu_wall_time_ms();
+  }
+  Softmax::forward_kernel(m, input_ptr, output_ptr, stream);
+  if (m->profiling) {
+    double elapsed = cpu_wall_time_ms() - t_start;
+    log_measure.debug(
+        "%s [Softmax] forward time = %.2fms\n", m->op_name, elapsed);
+  }
+}
+
+/* static */
+void Softmax::backward_kernel(SoftmaxMeta const *m,
+                              void *input_grad_ptr,
+                              void const *output_grad_ptr,
+                              size_t num_elements,
+                              ffStream_t stream) {
+  assert(m->data_type == DT_FLOAT);
+  copy_kernel<float>(
+      (float *)input_grad_ptr, (float const *)output_grad_ptr, num_elements);
+}
+
+/* static */
+void Softmax::backward_kernel_wrapper(SoftmaxMeta const *m,
+                                      void *input_grad_ptr,
+                                      void const *output_grad_ptr,
+                                      size_t num_elements) {
+  ffStream_t stream;
+  get_legion_stream(&stream);
+
+  double t_start = 0.0;
+  if (m->profiling) {
+    t_start = cpu_wall_time_ms();
+  }
+  Softmax::backward_kernel(
+      m, input_grad_ptr, output_grad_ptr, num_elements, stream);
+  if (m->profiling) {
+    double elapsed = cpu_wall_time_ms() - t_start;
+    log_measure.debug("Softmax backward time = %.2fms\n", elapsed);
+  }
+}
+
+}; // namespace FlexFlow
@@ -0,0 +1,136 @@
+/* Copyright 2021 Facebook
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flexflow/ops/topk.h"
+#include "flexflow/utils/cpu_helper.h"
+#include <algorithm>
+#include <numeric>
+
+namespace FlexFlow {
+// declare Legion names
+using Legion::coord_t;
+
+/*static*/
+void TopK::forward_kernel(TopKMeta const *m,
+                          float const *input_ptr,
+                          float *output_ptr,
+                          int *indices_ptr,
+                          size_t batch_size,
+                          int length,
+                          int k,
+                          bool sorted,
+                          ffStream_t stream) {
+  // Results are always sorted, with ties broken towards lower indices as in
+  // the CUDA kernel
+  assert(k <= length);
+  std::vector<int> order(length);
+  for (size_t b = 0; b < batch_size; b++) {
+    float const *row = input_ptr + b * length;
+    std::iota(order.begin(), order.end(), 0);
+    std::partial_sort(
+        order.begin(), order.begin() + k, order.end(), [&](int a, int c) {
+          return row[a] > row[c] || (row[a] == row[c] && a < c);
+        });
+    for (int i = 0; i < k; i++) {
+      output_ptr[b * k + i] = row[order[i]];
+      indices_ptr[b * k + i] = order[i];
+    }
+  }
+}
+
+/*static*/
+void TopK::forward_kernel_wrapper(TopKMeta const *m,
+                                  float const *input_ptr,
+                                  float *output_ptr,
+                                  int *indices_ptr,
+                                  size_t batch_size,
+                                  int length,
+                                  int k,
+                                  bool sorted) {
+  ffStream_t stream;
+  get_legion_stream(&stream);
+
+  double t_start = 0.0;
+  if (m->profiling) {
+    t_start = cpu_wall_time_ms();
+  }
+
+  TopK::forward_kernel(m,
+                       input_ptr,
+                       output_ptr,
+                       indices_ptr,
+                       batch_size,
+                       length,
+                       k,
+                       sorted,
+                       stream);
+
+  if (m->profiling) {
+    double elapsed = cpu_wall_time_ms() - t_start;
+    printf("[TopK] forward time = %.2lfms\n", elapsed);
+  }
+}
+
+/*static*/
+void TopK::backward_kernel(TopKMeta const *m,
+                           float const *value_grad_ptr,
+                           int const *indices_ptr,
+                           float *in_grad_ptr,
+                           size_t batch_size,
+                           int length,
+                           int k,
+                           ffStream_t stream) {
+  coord_t size = (coord_t)batch_size * k;
+  CPU_KERNEL_LOOP(i, size) {
+    coord_t batch_idx = i / k;
+    coord_t src_offset = batch_idx * length + indices_ptr[i];
+    in_grad_ptr[src_offset] += value_grad_ptr[i];
+  }
+}
+
+/*static*/
+void TopK::backward_kernel_wrapper(TopKMeta const *m,
+                                   float const *value_grad_ptr,
+                                   int const *indices_ptr,
+                                   float *in_grad_ptr,
+                                   size_t batch_size,
+                                   int length,
+                                   int k) {
+  ffStream_t stream;
+  get_legion_stream(&stream);
+
+  double t_start = 0.0;
+  if (m->profiling) {
+    t_start = cpu_wall_time_ms();
+  }
+
+  TopK::backward_kernel(m,
+                        value_grad_ptr,
+                        indices_ptr,
+                        in_grad_ptr,
+                        batch_size,
+                        length,
+                        k,
+                        stream);
+
+  if (m->profiling) {
+    double elapsed = cpu_wall_time_ms() - t_start;
+    printf("[TopK] backward time = %.2lfms\n", elapsed);
+  }
+}
+
+TopKMeta::TopKMeta(FFHandler handler) : OpMeta(handler) {}
+
+}; // namespace FlexFlow
@@ -184,7 +184,7 @@ bool ElementBinary::can_inplace_output(void) {
   return false;
 }
 
-bool ElementBinary::has_inplace_output(void) {
+bool ElementBinary::has_inplace_output(void) const {
   return inplace_a;
 }
 
@@ -249,6 +249,54 @@ void ElementBinary::init(FFModel const &ff) {
   set_opmeta_from_futuremap(ff, fm);
 }
 
+// Returns the data of a region, whose type is that of the tensors of m
+static void const *get_tensor_ptr_ro(ElementBinaryMeta const *m,
+                                     PhysicalRegion const &region,
+                                     RegionRequirement const &req,
+                                     Context ctx,
+                                     Runtime *runtime) {
+  Domain domain =
+      runtime->get_index_space_domain(ctx, req.region.get_index_space());
+  GenericTensorAccessorR acc(
+      domain.get_dim(), m->data_type, region, req, FID_DATA, ctx, runtime);
+  return acc.ptr;
+}
+
+static void *get_tensor_ptr_w(ElementBinaryMeta const *m,
+                              PhysicalRegion const &region,
+                              RegionRequirement const &req,
+                              Context ctx,
+                              Runtime *runtime,
+                              bool readOutput) {
+  Domain domain =
+      runtime->get_index_space_domain(ctx, req.region.get_index_space());
+  GenericTensorAccessorW acc(domain.get_dim(),
+                             m->data_type,
+                             region,
+                             req,
+                             FID_DATA,
+                             ctx,
+                             runtime,
+                             readOutput);
+  return acc.ptr;
+}
+
+static void *get_tensor_ptr_rw(ElementBinaryMeta const *m,
+                               PhysicalRegion const &region,
+                               RegionRequirement const &req,
+                               Context ctx,
+                               Runtime *runtime) {
+  return get_tensor_ptr_w(m, region, req, ctx, runtime, true /*readOutput*/);
+}
+
+static void *get_tensor_ptr_wo(ElementBinaryMeta const *m,
+                               PhysicalRegion const &region,
+                               RegionRequirement const &req,
+                               Context ctx,
+                               Runtime *runtime) {
+  return get_tensor_ptr_w(m, region, req, ctx, runtime, false /*readOutput*/);
+}
+
 OpMeta *ElementBinary::init_task(Task const *task,
                                  std::vector<PhysicalRegion> const &regions,
                                  Context ctx,
@@ -262,6 +310,7 @@ OpMeta *ElementBinary::init_task(Task const *task,
   m->has_same_operands = eb->has_same_operands;
   m->broadcast_input1 = eb->broadcast_input1;
   m->broadcast_input2 = eb->broadcast_input2;
+  m->data_type = eb->outputs[0]->data_type;
   Domain input1_domain = runtime->get_index_space_domain(
       ctx, task->regions[0].region.get_index_space());
   Domain input2_domain, output_domain;
@@ -311,6 +360,7 @@ void ElementBinary::forward(FFModel const &ff) {
                          false /*must*/,
                          0 /*mapper_id*/,
                          outputs[0]->machine_view.hash());
+  set_priority_for_forward(launcher);
   if (inplace_a) {
     assert(outputs[0]->part == inputs[0]->part);
     assert(outputs[0]->region == inputs[0]->region);
@@ -384,23 +434,23 @@ __host__ void
       assert(m->op_type == OP_EW_SUB || m->op_type == OP_EW_ADD);
     }
   }
-  float const *in1_ptr = NULL, *in2_ptr = NULL;
-  float *out_ptr = NULL;
+  void const *in1_ptr = NULL, *in2_ptr = NULL;
+  void *out_ptr = NULL;
   if (m->inplace_a) {
     if (m->has_same_operands) {
       assert(regions.size() == 1);
       assert(task->regions.size() == 1);
-      out_ptr = helperGetTensorPointerRW<float>(
-          regions[0], task->regions[0], FID_DATA, ctx, runtime);
+      out_ptr = get_tensor_ptr_rw(
+          m, regions[0], task->regions[0], ctx, runtime);
       in2_ptr = out_ptr;
       in1_ptr = out_ptr;
     } else {
       assert(regions.size() == 2);
       assert(task->regions.size() == 2);
-      out_ptr = helperGetTensorPointerRW<float>(
-          regions[0], task->regions[0], FID_DATA, ctx, runtime);
-      in2_ptr = helperGetTensorPointerRO<float>(
-          regions[1], task->regions[1], FID_DATA, ctx, runtime);
+      out_ptr = get_tensor_ptr_rw(
+          m, regions[0], task->regions[0], ctx, runtime);
+      in2_ptr = get_tensor_ptr_ro(
+          m, regions[1], task->regions[1], ctx, runtime);
       in1_ptr = out_ptr;
     }
   } else {
@@ -410,23 +460,23 @@ __host__ void
       Domain out_domain = runtime->get_index_space_domain(
           ctx, task->regions[1].region.get_index_space());
       assert(out_domain == in1_domain);
-      in1_ptr = helperGetTensorPointerRO<float>(
-          regions[0], task->regions[0], FID_DATA, ctx, runtime);
+      in1_ptr = get_tensor_ptr_ro(
+          m, regions[0], task->regions[0], ctx, runtime);
       in2_ptr = in1_ptr;
-      out_ptr = helperGetTensorPointerWO<float>(
-          regions[1], task->regions[1], FID_DATA, ctx, runtime);
+      out_ptr = get_tensor_ptr_wo(
+          m, regions[1], task->regions[1], ctx, runtime);
     } else {
       assert(regions.size() == 3);
       assert(task->regions.size() == 3);
       Domain out_domain = runtime->get_index_space_domain(
           ctx, task->regions[2].region.get_index_space());
       assert(out_domain == in1_domain);
-      in1_ptr = helperGetTensorPointerRO<float>(
-          regions[0], task->regions[0], FID_DATA, ctx, runtime);
-      in2_ptr = helperGetTensorPointerRO<float>(
-          regions[1], task->regions[1], FID_DATA, ctx, runtime);
-      out_ptr = helperGetTensorPointerWO<float>(
-          regions[2], task->regions[2], FID_DATA, ctx, runtime);
+      in1_ptr = get_tensor_ptr_ro(
+          m, regions[0], task->regions[0], ctx, runtime);
+      in2_ptr = get_tensor_ptr_ro(
+          m, regions[1], task->regions[1], ctx, runtime);
+      out_ptr = get_tensor_ptr_wo(
+          m, regions[2], task->regions[2], ctx, runtime);
     }
   }
 
@@ -446,6 +496,7 @@ void ElementBinary::backward(FFModel const &ff) {
                          false /*must*/,
                          0 /*mapper_id*/,
                          outputs[0]->machine_view.hash());
+  set_priority_for_backward(launcher);
   if (inplace_a) {
     // regions[0](I/O): output_grad
     launcher.add_region_requirement(RegionRequirement(outputs[0]->part_grad,
@@ -540,21 +591,21 @@ void ElementBinary::backward_task(Task const *task,
                                   Runtime *runtime) {
   // const ElementBinary* ele = (const ElementBinary*) task->args;
   ElementBinaryMeta const *m = *((ElementBinaryMeta **)task->local_args);
-  float const *in0_ptr = NULL, *in1_ptr = NULL, *out_grad_ptr = NULL;
-  float *in0_grad_ptr = NULL, *in1_grad_ptr = NULL;
+  void const *in0_ptr = NULL, *in1_ptr = NULL, *out_grad_ptr = NULL;
+  void *in0_grad_ptr = NULL, *in1_grad_ptr = NULL;
   Domain out_grad_domain = runtime->get_index_space_domain(
       ctx, task->regions[0].region.get_index_space());
   if (m->inplace_a) {
-    in0_grad_ptr = helperGetTensorPointerRW<float>(
-        regions[0], task->regions[0], FID_DATA, ctx, runtime);
+    in0_grad_ptr = get_tensor_ptr_rw(
+        m, regions[0], task->regions[0], ctx, runtime);
     assert(regions.size() == 2 || regions.size() == 4);
     assert(task->regions.size() == regions.size());
     if (regions.size() == 2) {
       Domain in0_domain = runtime->get_index_space_domain(
           ctx, task->regions[1].region.get_index_space());
       assert(in0_domain == out_grad_domain);
-      in0_ptr = helperGetTensorPointerRO<float>(
-          regions[1], task->regions[1], FID_DATA, ctx, runtime);
+      in0_ptr = get_tensor_ptr_ro(
+          m, regions[1], task->regions[1], ctx, runtime);
       in1_ptr = in0_ptr;
       in1_grad_ptr = in0_grad_ptr;
       out_grad_ptr = in0_grad_ptr;
@@ -565,30 +616,30 @@ void ElementBinary::backward_task(Task const *task,
           ctx, task->regions[2].region.get_index_space());
       assert(in0_domain == out_grad_domain);
       // assert(in1_domain == out_grad_domain);
-      in0_ptr = helperGetTensorPointerRO<float>(
-          regions[1], task->regions[1], FID_DATA, ctx, runtime);
-      in1_ptr = helperGetTensorPointerRO<float>(
-          regions[2], task->regions[2], FID_DATA, ctx, runtime);
-      in1_grad_ptr = helperGetTensorPointerRW<float>(
-          regions[3], task->regions[3], FID_DATA, ctx, runtime);
+      in0_ptr = get_tensor_ptr_ro(
+          m, regions[1], task->regions[1], ctx, runtime);
+      in1_ptr = get_tensor_ptr_ro(
+          m, regions[2], task->regions[2], ctx, runtime);
+      in1_grad_ptr = get_tensor_ptr_rw(
+          m, regions[3], task->regions[3], ctx, runtime);
       out_grad_ptr = in0_grad_ptr;
     }
   } else {
     int rid = 0;
-    out_grad_ptr = helperGetTensorPointerRO<float>(
-        regions[rid], task->regions[rid], FID_DATA, ctx, runtime);
+    out_grad_ptr = get_tensor_ptr_ro(
+        m, regions[rid], task->regions[rid], ctx, runtime);
     rid++;
     Domain in0_domain = runtime->get_index_space_domain(
         ctx, task->regions[rid].region.get_index_space());
-    in0_ptr = helperGetTensorPointerRO<float>(
-        regions[rid], task->regions[rid], FID_DATA, ctx, runtime);
+    in0_ptr = get_tensor_ptr_ro(
+        m, regions[rid], task->regions[rid], ctx, runtime);
     rid++;
     if (m->trainableInputs[0]) {
       Domain in0_grad_domain = runtime->get_index_space_domain(
           ctx, task->regions[rid].region.get_index_space());
       assert(in0_domain == in0_grad_domain);
-      in0_grad_ptr = helperGetTensorPointerRW<float>(
-          regions[rid], task->regions[rid], FID_DATA, ctx, runtime);
+      in0_grad_ptr = get_tensor_ptr_rw(
+          m, regions[rid], task->regions[rid], ctx, runtime);
       rid++;
     }
     if (m->has_same_operands) {
@@ -598,16 +649,16 @@ void ElementBinary::backward_task(Task const *task,
     } else {
       Domain in1_domain = runtime->get_index_space_domain(
           ctx, task->regions[rid].region.get_index_space());
-      in1_ptr = helperGetTensorPointerRO<float>(
-          regions[rid], task->regions[rid], FID_DATA, ctx, runtime);
+      in1_ptr = get_tensor_ptr_ro(
+          m, regions[rid], task->regions[rid], ctx, runtime);
       rid++;
       if (m->trainableInputs[1]) {
         Domain in1_grad_domain = runtime->get_index_space_domain(
             ctx, task->regions[rid].region.get_index_space());
         // assert(out_grad_domain == in1_domain);
         assert(in1_domain == in1_grad_domain);
-        in1_grad_ptr = helperGetTensorPointerRW<float>(
-            regions[rid], task->regions[rid], FID_DATA, ctx, runtime);
+        in1_grad_ptr = get_tensor_ptr_rw(
+            m, regions[rid], task->regions[rid], ctx, runtime);
         rid++;
       }
     }
@@ -636,6 +687,7 @@ bool ElementBinary::measure_operator_cost(Simulator *sim,
   m->has_same_operands = this->has_same_operands;
   m->broadcast_input1 = this->broadcast_input1;
   m->broadcast_input2 = this->broadcast_input2;
+  m->data_type = outputs[0]->data_type;
   Domain input1_domain = sub_input1.get_domain();
   Domain input2_domain = sub_input2.get_domain();
   Domain output_domain = sub_output.get_domain();
@@ -643,17 +695,17 @@ bool ElementBinary::measure_operator_cost(Simulator *sim,
   init_kernel(m, input1_domain, input2_domain, output_domain);
 
   sim->free_all();
-  float *input1_ptr = (float *)sim->allocate(sub_input1.get_volume(), DT_FLOAT);
+  void *input1_ptr = sim->allocate(sub_input1.get_volume(), m->data_type);
   assert(input1_ptr != NULL);
-  float *input2_ptr = (float *)sim->allocate(sub_input2.get_volume(), DT_FLOAT);
+  void *input2_ptr = sim->allocate(sub_input2.get_volume(), m->data_type);
   assert(input2_ptr != NULL);
   cost_metrics.inputs_memory += cost_metrics.total_mem_diff_from(sim->offset);
 
-  float *output_ptr = NULL;
+  void *output_ptr = NULL;
   if (inplace_a) {
     output_ptr = input1_ptr;
   } else {
-    output_ptr = (float *)sim->allocate(sub_output.get_volume(), DT_FLOAT);
+    output_ptr = sim->allocate(sub_output.get_volume(), m->data_type);
   }
   assert(output_ptr != NULL);
   cost_metrics.outputs_memory += cost_metrics.total_mem_diff_from(sim->offset);
@@ -665,20 +717,20 @@ bool ElementBinary::measure_operator_cost(Simulator *sim,
     forward_kernel_wrapper(m, input1_ptr, input2_ptr, output_ptr);
   };
   if (sim->computationMode == COMP_MODE_TRAINING) {
-    float *input1_grad_ptr =
-        (float *)sim->allocate(sub_input1.get_volume(), DT_FLOAT);
+    void *input1_grad_ptr =
+        sim->allocate(sub_input1.get_volume(), m->data_type);
     assert(input1_grad_ptr != NULL);
-    float *input2_grad_ptr =
-        (float *)sim->allocate(sub_input2.get_volume(), DT_FLOAT);
+    void *input2_grad_ptr =
+        sim->allocate(sub_input2.get_volume(), m->data_type);
     assert(input2_grad_ptr != NULL);
     cost_metrics.inputs_memory += cost_metrics.total_mem_diff_from(sim->offset);
 
-    float *output_grad_ptr = NULL;
+    void *output_grad_ptr = NULL;
     if (inplace_a) {
       output_grad_ptr = input1_grad_ptr;
     } else {
       output_grad_ptr =
-          (float *)sim->allocate(sub_output.get_volume(), DT_FLOAT);
+          sim->allocate(sub_output.get_volume(), m->data_type);
     }
     assert(output_grad_ptr != NULL);
     cost_metrics.outputs_memory +=
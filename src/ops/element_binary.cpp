@@ -93,10 +93,11 @@ __global__ void elewise_binary_forward_kernel(coord_t volume,
 
 /*static*/
 void ElementBinary::forward_kernel(ElementBinaryMeta const *m,
-                                   float const *in1_ptr,
-                                   float const *in2_ptr,
-                                   float *out_ptr,
+                                   void const *in1_ptr,
+                                   void const *in2_ptr,
+                                   void *out_ptr,
                                    hipStream_t stream) {
+  assert(m->data_type == DT_FLOAT);
   checkCUDA(hipblasSetStream(m->handle.blas, stream));
   checkCUDNN(miopenSetStream(m->handle.dnn, stream));
 
@@ -155,9 +156,9 @@ void ElementBinary::forward_kernel(ElementBinaryMeta const *m,
 
 /*static*/
 void ElementBinary::forward_kernel_wrapper(ElementBinaryMeta const *m,
-                                           float const *in1_ptr,
-                                           float const *in2_ptr,
-                                           float *out_ptr) {
+                                           void const *in1_ptr,
+                                           void const *in2_ptr,
+                                           void *out_ptr) {
   hipStream_t stream;
   checkCUDA(get_legion_stream(&stream));
 
@@ -239,12 +240,13 @@ __global__ void elewise_binary_backward_kernel(coord_t volume,
 
 /*static*/
 void ElementBinary::backward_kernel(ElementBinaryMeta const *m,
-                                    float const *out_grad_ptr,
-                                    float const *in1_ptr,
-                                    float const *in2_ptr,
-                                    float *in1_grad_ptr,
-                                    float *in2_grad_ptr,
+                                    void const *out_grad_ptr,
+                                    void const *in1_ptr,
+                                    void const *in2_ptr,
+                                    void *in1_grad_ptr,
+                                    void *in2_grad_ptr,
                                     hipStream_t stream) {
+  assert(m->data_type == DT_FLOAT);
   checkCUDA(hipblasSetStream(m->handle.blas, stream));
   checkCUDNN(miopenSetStream(m->handle.dnn, stream));
 
@@ -343,11 +345,11 @@ void ElementBinary::backward_kernel(ElementBinaryMeta const *m,
 
 /*static*/
 void ElementBinary::backward_kernel_wrapper(ElementBinaryMeta const *m,
-                                            float const *out_grad_ptr,
-                                            float const *in1_ptr,
-                                            float const *in2_ptr,
-                                            float *in1_grad_ptr,
-                                            float *in2_grad_ptr) {
+                                            void const *out_grad_ptr,
+                                            void const *in1_ptr,
+                                            void const *in2_ptr,
+                                            void *in1_grad_ptr,
+                                            void *in2_grad_ptr) {
   hipStream_t stream;
   checkCUDA(get_legion_stream(&stream));
   hipEvent_t t_start, t_end;
@@ -46,12 +46,12 @@ void ElementBinary::init_kernel(ElementBinaryMeta *m,
                                             CUDNN_PROPAGATE_NAN,
                                             CUDNN_REDUCE_TENSOR_NO_INDICES,
                                             CUDNN_32BIT_INDICES));
-  checkCUDNN(
-      cudnnSetTensorDescriptorFromDomain(m->input1Tensor, input1_domain));
-  checkCUDNN(
-      cudnnSetTensorDescriptorFromDomain(m->input2Tensor, input2_domain));
-  checkCUDNN(
-      cudnnSetTensorDescriptorFromDomain(m->outputTensor, output_domain));
+  checkCUDNN(cudnnSetTensorDescriptorFromDomain(
+      m->input1Tensor, input1_domain, m->data_type));
+  checkCUDNN(cudnnSetTensorDescriptorFromDomain(
+      m->input2Tensor, input2_domain, m->data_type));
+  checkCUDNN(cudnnSetTensorDescriptorFromDomain(
+      m->outputTensor, output_domain, m->data_type));
 }
 
 __global__ void elewise_binary_forward_kernel(coord_t volume,
@@ -93,9 +93,9 @@ __global__ void elewise_binary_forward_kernel(coord_t volume,
 
 /*static*/
 void ElementBinary::forward_kernel(ElementBinaryMeta const *m,
-                                   float const *in1_ptr,
-                                   float const *in2_ptr,
-                                   float *out_ptr,
+                                   void const *in1_ptr,
+                                   void const *in2_ptr,
+                                   void *out_ptr,
                                    cudaStream_t stream) {
   checkCUDA(cublasSetStream(m->handle.blas, stream));
   checkCUDNN(cudnnSetStream(m->handle.dnn, stream));
@@ -154,9 +154,9 @@ void ElementBinary::forward_kernel(ElementBinaryMeta const *m,
 
 /*static*/
 void ElementBinary::forward_kernel_wrapper(ElementBinaryMeta const *m,
-                                           float const *in1_ptr,
-                                           float const *in2_ptr,
-                                           float *out_ptr) {
+                                           void const *in1_ptr,
+                                           void const *in2_ptr,
+                                           void *out_ptr) {
   cudaStream_t stream;
   checkCUDA(get_legion_stream(&stream));
 
@@ -238,11 +238,11 @@ __global__ void elewise_binary_backward_kernel(coord_t volume,
 
 /*static*/
 void ElementBinary::backward_kernel(ElementBinaryMeta const *m,
-                                    float const *out_grad_ptr,
-                                    float const *in1_ptr,
-                                    float const *in2_ptr,
-                                    float *in1_grad_ptr,
-                                    float *in2_grad_ptr,
+                                    void const *out_grad_ptr,
+                                    void const *in1_ptr,
+                                    void const *in2_ptr,
+                                    void *in1_grad_ptr,
+                                    void *in2_grad_ptr,
                                     cudaStream_t stream) {
   checkCUDA(cublasSetStream(m->handle.blas, stream));
   checkCUDNN(cudnnSetStream(m->handle.dnn, stream));
@@ -334,11 +334,11 @@ void ElementBinary::backward_kernel(ElementBinaryMeta const *m,
 
 /*static*/
 void ElementBinary::backward_kernel_wrapper(ElementBinaryMeta const *m,
-                                            float const *out_grad_ptr,
-                                            float const *in1_ptr,
-                                            float const *in2_ptr,
-                                            float *in1_grad_ptr,
-                                            float *in2_grad_ptr) {
+                                            void const *out_grad_ptr,
+                                            void const *in1_ptr,
+                                            void const *in2_ptr,
+                                            void *in1_grad_ptr,
+                                            void *in2_grad_ptr) {
   cudaStream_t stream;
   checkCUDA(get_legion_stream(&stream));
   cudaEvent_t t_start, t_end;
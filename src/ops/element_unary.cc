@@ -33,7 +33,7 @@ Tensor FFModel::unary(OperatorType op,
   for (int i = 0; i < numdims; i++)
     dims[i] = x->dims[i];
   ele->outputs[0] = create_tensor_legion_ordering(
-      numdims, dims, DT_FLOAT, ele, 0, true /*create_grad*/);
+      numdims, dims, x->data_type, ele, 0, true /*create_grad*/);
   ele->add_int_property("inplace", inplace);
   ele->add_float_property("scalar", scalar);
   layers.push_back(ele);
@@ -182,7 +182,7 @@ bool ElementUnary::can_inplace_output(void) {
   return true;
 }
 
-bool ElementUnary::has_inplace_output(void) {
+bool ElementUnary::has_inplace_output(void) const {
   return inplace;
 }
 
@@ -280,6 +280,7 @@ void ElementUnary::forward(FFModel const &ff) {
                          false /*must*/,
                          0 /*mapper_id*/,
                          outputs[0]->machine_view.hash());
+  set_priority_for_forward(launcher);
   if (inplace) {
     assert(outputs[0]->part == inputs[0]->part);
     assert(outputs[0]->region == inputs[0]->region);
@@ -319,6 +320,10 @@ void ElementUnary::forward_task(Task const *task,
     forward_task_with_type<int32_t>(task, regions, ctx, runtime);
   } else if (m->data_type == DT_INT64) {
     forward_task_with_type<int64_t>(task, regions, ctx, runtime);
+#ifdef FF_USE_CUDA
+  } else if (m->data_type == DT_HALF) {
+    forward_task_with_type<half>(task, regions, ctx, runtime);
+#endif
   } else {
     assert(false && "Unsupported data type in Embedding forward");
   }
@@ -375,6 +380,7 @@ void ElementUnary::backward(FFModel const &ff) {
                          false /*must*/,
                          0 /*mapper_id*/,
                          outputs[0]->machine_view.hash());
+  set_priority_for_backward(launcher);
   if (inplace) {
     assert(inputs[0]->part == outputs[0]->part);
     assert(inputs[0]->part_grad == outputs[0]->part_grad);
@@ -438,6 +444,10 @@ void ElementUnary::backward_task(Task const *task,
     backward_task_with_type<int32_t>(task, regions, ctx, runtime);
   } else if (m->data_type == DT_INT64) {
     backward_task_with_type<int64_t>(task, regions, ctx, runtime);
+#ifdef FF_USE_CUDA
+  } else if (m->data_type == DT_HALF) {
+    backward_task_with_type<half>(task, regions, ctx, runtime);
+#endif
   } else {
     assert(false && "Unsupported data type in Embedding forward");
   }
@@ -521,6 +531,8 @@ bool ElementUnary::measure_operator_cost(Simulator *sim,
     return false;
   ElementUnaryMeta *m = sim->ele_unary_meta;
   m->op_type = op_type;
+  // Other types are measured as float
+  m->data_type = outputs[0]->data_type == DT_HALF ? DT_HALF : DT_FLOAT;
   if (use_cudnn(m->op_type)) {
     Domain input_domain, output_domain;
     input_domain.dim = sub_input.num_dims;
@@ -537,15 +549,15 @@ bool ElementUnary::measure_operator_cost(Simulator *sim,
     init_kernel(m, input_domain, output_domain);
   }
   sim->free_all();
-  float *input_ptr = (float *)sim->allocate(sub_input.get_volume(), DT_FLOAT);
+  void *input_ptr = sim->allocate(sub_input.get_volume(), m->data_type);
   assert(input_ptr != NULL);
   cost_metrics.inputs_memory += cost_metrics.total_mem_diff_from(sim->offset);
 
-  float *output_ptr = NULL;
+  void *output_ptr = NULL;
   if (inplace) {
     output_ptr = input_ptr;
   } else {
-    output_ptr = (float *)sim->allocate(sub_output.get_volume(), DT_FLOAT);
+    output_ptr = sim->allocate(sub_output.get_volume(), m->data_type);
   }
   assert(output_ptr != NULL);
   cost_metrics.outputs_memory += cost_metrics.total_mem_diff_from(sim->offset);
@@ -554,31 +566,52 @@ bool ElementUnary::measure_operator_cost(Simulator *sim,
 
   std::function<void()> forward, backward;
   forward = [&] {
-    forward_kernel_wrapper(m, input_ptr, output_ptr, sub_output.get_volume());
+#ifdef FF_USE_CUDA
+    if (m->data_type == DT_HALF) {
+      forward_kernel_wrapper(m,
+                             (half const *)input_ptr,
+                             (half *)output_ptr,
+                             sub_output.get_volume());
+      return;
+    }
+#endif
+    forward_kernel_wrapper(m,
+                           (float const *)input_ptr,
+                           (float *)output_ptr,
+                           sub_output.get_volume());
   };
   if (sim->computationMode == COMP_MODE_TRAINING) {
-    float *input_grad_ptr =
-        (float *)sim->allocate(sub_input.get_volume(), DT_FLOAT);
+    void *input_grad_ptr = sim->allocate(sub_input.get_volume(), m->data_type);
     assert(input_grad_ptr != NULL);
     cost_metrics.inputs_memory += cost_metrics.total_mem_diff_from(sim->offset);
 
-    float *output_grad_ptr = NULL;
+    void *output_grad_ptr = NULL;
     if (inplace) {
       output_grad_ptr = input_grad_ptr;
     } else {
-      output_grad_ptr =
-          (float *)sim->allocate(sub_output.get_volume(), DT_FLOAT);
+      output_grad_ptr = sim->allocate(sub_output.get_volume(), m->data_type);
     }
     assert(output_grad_ptr != NULL);
     cost_metrics.outputs_memory +=
         cost_metrics.total_mem_diff_from(sim->offset);
 
     backward = [&] {
+#ifdef FF_USE_CUDA
+      if (m->data_type == DT_HALF) {
+        backward_kernel_wrapper(m,
+                                (half const *)input_ptr,
+                                (half *)input_grad_ptr,
+                                (half const *)output_ptr,
+                                (half const *)output_grad_ptr,
+                                sub_output.get_volume());
+        return;
+      }
+#endif
       backward_kernel_wrapper(m,
-                              input_ptr,
-                              input_grad_ptr,
-                              output_ptr,
-                              output_grad_ptr,
+                              (float const *)input_ptr,
+                              (float *)input_grad_ptr,
+                              (float const *)output_ptr,
+                              (float const *)output_grad_ptr,
                               sub_output.get_volume());
     };
   }
@@ -45,19 +45,33 @@ void ElementUnary::init_kernel(ElementUnaryMeta *m,
   }
   checkCUDNN(cudnnSetActivationDescriptor(
       m->actiDesc, mode, CUDNN_PROPAGATE_NAN, 0.0));
-  checkCUDNN(cudnnSetTensorDescriptorFromDomain(m->inputTensor, input_domain));
+  checkCUDNN(cudnnSetTensorDescriptorFromDomain(
+      m->inputTensor, input_domain, m->data_type));
   // input_domain == output_domain
-  checkCUDNN(
-      cudnnSetTensorDescriptorFromDomain(m->outputTensor, output_domain));
+  checkCUDNN(cudnnSetTensorDescriptorFromDomain(
+      m->outputTensor, output_domain, m->data_type));
 }
 
+// The type that the kernels compute in; half is computed in float
+template <typename T>
+struct UnaryComputeType {
+  using type = T;
+};
+template <>
+struct UnaryComputeType<half> {
+  using type = float;
+};
+
 template <typename T>
 __global__ void elewise_unary_forward_kernel(
     coord_t volume, const T scalar, OperatorType type, const T *in, T *out) {
+  using CT = typename UnaryComputeType<T>::type;
+  CT s = (CT)scalar;
   CUDA_KERNEL_LOOP(i, volume) {
+    CT x = (CT)in[i];
     switch (type) {
       case OP_EXP: {
-        out[i] = (T)exp((float)in[i]);
+        out[i] = (T)(CT)exp((float)x);
         break;
       }
       case OP_IDENTITY: {
@@ -65,31 +79,31 @@ __global__ void elewise_unary_forward_kernel(
         break;
       }
       case OP_SCALAR_MULTIPLY: {
-        out[i] = in[i] * scalar;
+        out[i] = (T)(x * s);
         break;
       }
       case OP_SCALAR_ADD: {
-        out[i] = in[i] + scalar;
+        out[i] = (T)(x + s);
         break;
       }
       case OP_SCALAR_SUB: {
-        out[i] = in[i] - scalar;
+        out[i] = (T)(x - s);
         break;
       }
       case OP_SCALAR_TRUE_DIV: {
-        out[i] = in[i] / scalar;
+        out[i] = (T)(x / s);
         break;
       }
       case OP_GELU: {
-        out[i] = (T)(in[i] * 0.5 * erfc(-in[i] * M_SQRT1_2));
+        out[i] = (T)(CT)(x * 0.5 * erfc(-x * M_SQRT1_2));
         break;
       }
       case OP_RSQRT: {
-        out[i] = (T)(1.0f / sqrt((float)in[i]));
+        out[i] = (T)(CT)(1.0f / sqrt((float)x));
         break;
       }
       case OP_POW: {
-        out[i] = (T)(powf(in[i], scalar));
+        out[i] = (T)(CT)(powf(x, s));
         break;
       }
       default:
@@ -146,48 +160,48 @@ __global__ void elewise_unary_backward_kernel(coord_t volume,
                                               const T *output_grad,
                                               const T *input,
                                               T *input_grad) {
+  using CT = typename UnaryComputeType<T>::type;
+  CT s = (CT)scalar;
   CUDA_KERNEL_LOOP(i, volume) {
+    CT x = (CT)input[i], y = (CT)output[i], dy = (CT)output_grad[i];
+    CT dx = (CT)input_grad[i];
     switch (type) {
       case OP_EXP: {
         // TODO: change to use output instead of recomputing
-        input_grad[i] += (T)(output_grad[i] * exp((float)input[i]));
+        input_grad[i] = (T)(dx + (CT)(dy * exp((float)x)));
         break;
       }
       case OP_IDENTITY: {
-        input_grad[i] += output_grad[i];
+        input_grad[i] = (T)(dx + dy);
         break;
       }
       case OP_SCALAR_MULTIPLY: {
-        input_grad[i] += output_grad[i] * scalar;
+        input_grad[i] = (T)(dx + dy * s);
         break;
       }
       case OP_SCALAR_ADD: {
-        input_grad[i] += output_grad[i];
+        input_grad[i] = (T)(dx + dy);
         break;
       }
       case OP_SCALAR_SUB: {
-        input_grad[i] += output_grad[i];
+        input_grad[i] = (T)(dx + dy);
         break;
       }
       case OP_SCALAR_TRUE_DIV: {
-        input_grad[i] += output_grad[i] / scalar;
+        input_grad[i] = (T)(dx + dy / s);
         break;
       }
       case OP_GELU: {
-        input_grad[i] =
-            (T)(output_grad[i] *
-                (0.5 * erfc(-input[i] * M_SQRT1_2) -
-                 0.5 * M_SQRT1_2 * input[i] * exp(-input[i] * input[i] * 0.5)));
+        input_grad[i] = (T)(CT)(dy * (0.5 * erfc(-x * M_SQRT1_2) -
+                                      0.5 * M_SQRT1_2 * x * exp(-x * x * 0.5)));
         break;
       }
       case OP_RSQRT: {
-        input_grad[i] =
-            (T)(-0.5f * output_grad[i] * output[i] * output[i] * output[i]);
+        input_grad[i] = (T)(CT)(-0.5f * dy * y * y * y);
         break;
       }
       case OP_POW: {
-        input_grad[i] =
-            (T)(output_grad[i] * scalar * powf(input[i], scalar - 1));
+        input_grad[i] = (T)(CT)(dy * s * powf(x, s - 1));
         break;
       }
       default:
@@ -225,7 +239,7 @@ void ElementUnary::backward_kernel(ElementUnaryMeta const *m,
     elewise_unary_backward_kernel<T>
         <<<GET_BLOCKS(num_elements), CUDA_NUM_THREADS, 0, stream>>>(
             num_elements,
-            m->scalar,
+            (T)m->scalar,
             m->op_type,
             output_ptr,
             output_grad_ptr,
@@ -279,6 +293,11 @@ template void
                                                   int64_t const *input_ptr,
                                                   int64_t *output_ptr,
                                                   size_t num_elements);
+template void
+    ElementUnary::forward_kernel_wrapper<half>(ElementUnaryMeta const *m,
+                                               half const *input_ptr,
+                                               half *output_ptr,
+                                               size_t num_elements);
 
 template void
     ElementUnary::backward_kernel_wrapper<float>(ElementUnaryMeta const *m,
@@ -308,5 +327,12 @@ template void ElementUnary::backward_kernel_wrapper<int64_t>(
     int64_t const *output_ptr,
     int64_t const *output_grad_ptr,
     size_t num_elements);
+template void
+    ElementUnary::backward_kernel_wrapper<half>(ElementUnaryMeta const *m,
+                                                half const *input_ptr,
+                                                half *input_grad_ptr,
+                                                half const *output_ptr,
+                                                half const *output_grad_ptr,
+                                                size_t num_elements);
 
 }; // namespace FlexFlow
@@ -0,0 +1,121 @@
+/* Copyright 2023 CMU, Facebook, LANL, MIT, NVIDIA, and Stanford (alphabetical)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flexflow/ops/embedding_hot_tier.h"
+#include <algorithm>
+#include <cassert>
+
+namespace FlexFlow {
+
+EmbeddingHotTier::EmbeddingHotTier(int64_t _num_entries,
+                                   int _out_dim,
+                                   int _capacity,
+                                   int _refresh_interval)
+    : num_entries(_num_entries), out_dim(_out_dim),
+      capacity((int)std::min<int64_t>(_capacity, _num_entries)),
+      refresh_interval(_refresh_interval), batches_since_refresh(0), hits(0),
+      lookups(0) {
+  assert(capacity > 0 && refresh_interval > 0);
+}
+
+bool EmbeddingHotTier::record_batch(int32_t const *indices, size_t num) {
+  return record(indices, num);
+}
+
+bool EmbeddingHotTier::record_batch(int64_t const *indices, size_t num) {
+  return record(indices, num);
+}
+
+template <typename TI>
+bool EmbeddingHotTier::record(TI const *indices, size_t num) {
+  if (batches_since_refresh % SAMPLE_INTERVAL == 0) {
+    for (size_t i = 0; i < num; i++) {
+      int64_t row = indices[i];
+      if (row < 0 || row >= num_entries) {
+        continue;
+      }
+      counts[row]++;
+      lookups++;
+      if (find(row) != nullptr) {
+        hits++;
+      }
+    }
+  }
+  return ++batches_since_refresh >= refresh_interval;
+}
+
+void EmbeddingHotTier::refresh(float const *weight) {
+  std::vector<std::pair<uint32_t, int64_t>> ranked;
+  ranked.reserve(counts.size());
+  for (auto const &it : counts) {
+    ranked.push_back(std::make_pair(it.second, it.first));
+  }
+  auto more_frequent = [](std::pair<uint32_t, int64_t> const &a,
+                          std::pair<uint32_t, int64_t> const &b) {
+    return a.first > b.first || (a.first == b.first && a.second < b.second);
+  };
+  size_t num_tracked = (size_t)capacity * TRACKED_ROWS_PER_SLOT;
+  if (ranked.size() > num_tracked) {
+    std::nth_element(ranked.begin(),
+                     ranked.begin() + num_tracked,
+                     ranked.end(),
+                     more_frequent);
+    ranked.resize(num_tracked);
+  }
+  size_t num_rows = std::min(ranked.size(), (size_t)capacity);
+  std::partial_sort(
+      ranked.begin(), ranked.begin() + num_rows, ranked.end(), more_frequent);
+  // in table order, so that the copy below walks the table forwards
+  rows.clear();
+  for (size_t i = 0; i < num_rows; i++) {
+    rows.push_back(ranked[i].second);
+  }
+  std::sort(rows.begin(), rows.end());
+  size_t num_slots = 1;
+  while (num_slots < 2 * rows.size()) {
+    num_slots *= 2;
+  }
+  slots.assign(rows.empty() ? 0 : num_slots, Slot{-1, -1});
+  for (size_t r = 0; r < rows.size(); r++) {
+    size_t i = hash_row(rows[r]);
+    while (slots[i].row != -1) {
+      i = (i + 1) & (slots.size() - 1);
+    }
+    slots[i] = Slot{rows[r], (int)r};
+  }
+  reload(weight);
+  // age the counts, and forget the rows that are rare or were not looked
+  // up recently
+  counts.clear();
+  for (auto const &it : ranked) {
+    if (it.first > 1) {
+      counts[it.second] = it.first / 2;
+    }
+  }
+  batches_since_refresh = 0;
+  hits = 0;
+  lookups = 0;
+}
+
+void EmbeddingHotTier::reload(float const *weight) {
+  values.resize(rows.size() * out_dim);
+  for (size_t r = 0; r < rows.size(); r++) {
+    std::copy(weight + (size_t)rows[r] * out_dim,
+              weight + (size_t)(rows[r] + 1) * out_dim,
+              values.data() + r * out_dim);
+  }
+}
+
+}; // namespace FlexFlow
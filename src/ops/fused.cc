@@ -71,11 +71,15 @@ FusedOp::FusedOp(FFModel &model, Op *op)
     outputs[i]->owner_op = this;
     outputs[i]->owner_idx = i;
   }
+  fwd_task_priority = op->fwd_task_priority;
+  bwd_task_priority = op->bwd_task_priority;
+  upd_task_priority = op->upd_task_priority;
   numOperators = 1;
   op_num_inputs[0] = numInputs;
   op_num_weights[0] = numWeights;
   op_num_outputs[0] = numOutputs;
   op_op_type[0] = op->op_type;
+  op_is_chain_op[0] = is_chain_op(op);
   operators[0] = op;
   for (int i = 0; i < numInputs; i++) {
     op_input_source[i] = SOURCE_INPUT;
@@ -91,6 +95,79 @@ FusedOp::FusedOp(FFModel &model, Op *op)
   }
 }
 
+bool FusedOp::can_fuse(Op const *op) {
+  // The fused kernels only handle float tensors
+  for (int i = 0; i < op->numInputs; i++) {
+    if (op->inputs[i]->data_type == DT_HALF) {
+      return false;
+    }
+  }
+  for (int i = 0; i < op->numOutputs; i++) {
+    if (op->outputs[i]->data_type == DT_HALF) {
+      return false;
+    }
+  }
+  switch (op->op_type) {
+    case OP_CONCAT:
+    case OP_CONV2D:
+    case OP_BATCHNORM:
+    case OP_DROPOUT:
+    case OP_LINEAR:
+    case OP_BATCHMATMUL:
+    case OP_EW_ADD:
+    case OP_EW_SUB:
+    case OP_EW_MUL:
+    case OP_EW_DIV:
+    case OP_RELU:
+    case OP_SIGMOID:
+    case OP_TANH:
+    case OP_ELU:
+    case OP_POOL2D:
+    case OP_FLAT:
+    case OP_RESHAPE:
+    case OP_TRANSPOSE:
+      return true;
+    default:
+#ifdef FF_USE_CPU
+      // the CPU kernels run the other elementwise operators in chains
+      return is_chain_op(op);
+#else
+      return false;
+#endif
+  }
+}
+
+bool FusedOp::is_chain_op(Op const *op) {
+  if (op->outputs[0]->data_type != DT_FLOAT) {
+    return false;
+  }
+  switch (op->op_type) {
+    case OP_EW_ADD:
+    case OP_EW_SUB:
+    case OP_EW_MUL:
+      // no broadcast
+      return op->inputs[0]->get_volume() == op->outputs[0]->get_volume() &&
+             op->inputs[1]->get_volume() == op->outputs[0]->get_volume();
+    case OP_SIGMOID:
+    case OP_RELU:
+    case OP_TANH:
+    case OP_ELU:
+    case OP_EXP:
+    case OP_IDENTITY:
+    case OP_SCALAR_MULTIPLY:
+    case OP_SCALAR_ADD:
+    case OP_SCALAR_SUB:
+    case OP_SCALAR_TRUE_DIV:
+    case OP_GELU:
+    case OP_RSQRT:
+    case OP_POW:
+    case OP_DROPOUT:
+      return true;
+    default:
+      return false;
+  }
+}
+
 bool FusedOp::add_operator(FFModel &model, Op *op) {
   // Context ctx = model.config.lg_ctx;
   // Runtime* runtime = model.config.lg_hlr;
@@ -213,8 +290,13 @@ bool FusedOp::add_operator(FFModel &model, Op *op) {
   op_num_weights[numOperators] = op->numWeights;
   op_num_outputs[numOperators] = op->numOutputs;
   op_op_type[numOperators] = op->op_type;
+  op_is_chain_op[numOperators] = is_chain_op(op);
   operators[numOperators] = op;
   numOperators += 1;
+  // The fused task is as urgent as its most critical operator
+  fwd_task_priority = std::max(fwd_task_priority, op->fwd_task_priority);
+  bwd_task_priority = std::max(bwd_task_priority, op->bwd_task_priority);
+  upd_task_priority = std::max(upd_task_priority, op->upd_task_priority);
   assert(numOperators <= MAX_NUM_FUSED_OPERATORS);
   if (numInputs > MAX_NUM_INPUTS) {
     fprintf(stderr,
@@ -311,14 +393,22 @@ void FusedOp::forward(FFModel const &ff) {
   Context ctx = ff.config.lg_ctx;
   Runtime *runtime = ff.config.lg_hlr;
   set_argumentmap_for_forward(ff, argmap);
+  // Lets the CPU kernels drop Linear weights packed before the last write
+  assert(numWeights <= MAX_NUM_WEIGHTS);
+  int weight_versions[MAX_NUM_WEIGHTS];
+  for (int i = 0; i < numWeights; i++) {
+    weight_versions[i] = weights[i]->version;
+  }
   IndexLauncher launcher(FUSEDOP_FWD_TASK_ID,
                          parallel_is,
-                         TaskArgument(NULL, 0),
+                         TaskArgument(weight_versions,
+                                      numWeights * sizeof(int)),
                          argmap,
                          Predicate::TRUE_PRED,
                          false /*must*/,
                          0 /*mapper_id*/,
                          outputs[0]->machine_view.hash());
+  set_priority_for_forward(launcher);
   int offset = 0;
   for (int i = 0; i < numInputs; i++) {
     assert(inputs[i]->part != LogicalPartition::NO_PART);
@@ -368,6 +458,7 @@ void FusedOp::backward(FFModel const &ff) {
                          false /*must*/,
                          0 /*mapper_id*/,
                          outputs[0]->machine_view.hash());
+  set_priority_for_backward(launcher);
   int idx = 0;
   for (int i = 0; i < numInputs; i++) {
     launcher.add_region_requirement(RegionRequirement(inputs[i]->part,
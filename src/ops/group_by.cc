@@ -76,7 +76,7 @@ Group_by::Group_by(FFModel &model,
     outputs[i]->num_dims = 2;
     outputs[i]->dims[0].size = inputs[0]->dims[0].size;
     outputs[i]->dims[1].size =
-        (int)ceil(alpha * k / n * inputs[0]->dims[1].size);
+        get_expert_capacity(alpha, n, k, inputs[0]->dims[1].size);
   }
 
   numWeights = 0;
@@ -146,6 +146,7 @@ void Group_by::forward(FFModel const &ff) {
                          false /*must*/,
                          0 /*mapper_id*/,
                          outputs[0]->machine_view.hash());
+  set_priority_for_forward(launcher);
   // data
   launcher.add_region_requirement(RegionRequirement(inputs[0]->part,
                                                     0 /*projection id*/,
@@ -243,6 +244,7 @@ void Group_by::backward(FFModel const &ff) {
                          false /*must*/,
                          0 /*mapper_id*/,
                          outputs[0]->machine_view.hash());
+  set_priority_for_backward(launcher);
 
   // input_grad
   launcher.add_region_requirement(RegionRequirement(inputs[0]->part_grad,
@@ -328,6 +330,14 @@ void Group_by::backward_task(Task const *task,
                                     data_dim);
 }
 
+/*static*/
+int Group_by::get_expert_capacity(float alpha, int n, int k, int batch_size) {
+  if (alpha <= 0.0f) {
+    return batch_size;
+  }
+  return (int)ceil(alpha * k / n * batch_size);
+}
+
 bool Group_by::measure_operator_cost(Simulator *sim,
                                      MachineView const &mv,
                                      CostMetrics &cost_metrics) const {
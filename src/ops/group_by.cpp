@@ -29,21 +29,23 @@ __global__ void
     gb_forward_kernel(float const *input,
                       int const *exp_assign,
                       float **outputs,
-                      int n,       // num experts
-                      int k,       // chosen experts
-                      float alpha, // factor additional memory assigned
+                      int n,        // num experts
+                      int k,        // chosen experts
+                      int capacity, // rows of every expert tensor
                       int batch_size,
                       int data_dim) {
   __shared__ float *chosen_exp_preds[MAX_K * MAX_BATCH_SIZE];
+  __shared__ int expert_idx[MAX_N];
 
   // Get pred pointers, single thread per block
   if (threadIdx.x == 0) {
-    int exp_tensor_rows = ceil(alpha * k / n * batch_size);
-    int expert_idx[MAX_N] = {0};
+    for (int i = 0; i < n; i++) {
+      expert_idx[i] = 0;
+    }
     for (int i = 0; i < k * batch_size; i++) {
       // Get pointer to chosen expert predictions
       int expert = exp_assign[i];
-      if (expert_idx[expert] >= exp_tensor_rows) {
+      if (expert_idx[expert] >= capacity) {
         // dropped sample
         chosen_exp_preds[i] = 0;
         continue;
@@ -62,27 +64,35 @@ __global__ void
       chosen_exp_preds[i / data_dim][i % data_dim] = a;
     }
   }
+  // zero the rows no sample was sent to, so that the experts compute on
+  // defined inputs
+  CUDA_KERNEL_LOOP(i, n * capacity * data_dim) {
+    int expert = i / (capacity * data_dim);
+    int row = (i / data_dim) % capacity;
+    if (row >= expert_idx[expert]) {
+      outputs[expert][row * data_dim + i % data_dim] = 0.0f;
+    }
+  }
 }
 
 __global__ void
     gb_backward_kernel(float *input_grad,
                        int const *exp_assign,
                        float **output_grads,
-                       int n,       // num experts
-                       int k,       // chosen experts
-                       float alpha, // factor additional memory assigned
+                       int n,        // num experts
+                       int k,        // chosen experts
+                       int capacity, // rows of every expert tensor
                        int batch_size,
                        int data_dim) {
   __shared__ float *chosen_exp_grads[MAX_K * MAX_BATCH_SIZE];
 
-  // Get pred pointers, single thread
-  if (blockIdx.x * blockDim.x + threadIdx.x == 0) {
-    int exp_tensor_rows = ceil(alpha * k / n * batch_size);
+  // Get pred pointers, single thread per block
+  if (threadIdx.x == 0) {
     int expert_idx[MAX_N] = {0};
     for (int i = 0; i < k * batch_size; i++) {
       // Get pointer to chosen expert predictions
       int expert = exp_assign[i];
-      if (expert_idx[expert] >= exp_tensor_rows) {
+      if (expert_idx[expert] >= capacity) {
         // dropped sample
         chosen_exp_grads[i] = 0;
         continue;
@@ -95,12 +105,16 @@ __global__ void
 
   __syncthreads();
 
-  // compute output
-  CUDA_KERNEL_LOOP(i, k * batch_size * data_dim) {
-    if (chosen_exp_grads[i / data_dim] != 0) {
-      input_grad[(i / (k * data_dim)) * data_dim + i % data_dim] =
-          chosen_exp_grads[i / data_dim][i % data_dim];
+  // a sample's gradient sums the gradients of the experts it was sent to
+  CUDA_KERNEL_LOOP(i, batch_size * data_dim) {
+    int sample = i / data_dim;
+    float sum = 0.0f;
+    for (int j = 0; j < k; j++) {
+      if (chosen_exp_grads[sample * k + j] != 0) {
+        sum += chosen_exp_grads[sample * k + j][i % data_dim];
+      }
     }
+    input_grad[i] = sum;
   }
 }
 
@@ -115,6 +129,7 @@ void Group_by::forward_kernel_wrapper(
     float alpha, // factor additional memory assigned
     int batch_size,
     int data_dim) {
+  int capacity = get_expert_capacity(alpha, n, k, batch_size);
   // TODO: why cublas/cudnn stream is needed here?
   hipStream_t stream;
   checkCUDA(get_legion_stream(&stream));
@@ -133,7 +148,7 @@ void Group_by::forward_kernel_wrapper(
                      m->dev_region_ptrs,
                      n,
                      k,
-                     alpha,
+                     capacity,
                      batch_size,
                      data_dim);
 }
@@ -148,6 +163,7 @@ void Group_by::backward_kernel_wrapper(
     float alpha, // factor additional memory assigned
     int batch_size,
     int data_dim) {
+  int capacity = get_expert_capacity(alpha, n, k, batch_size);
   // TODO: why cublas/cudnn stream is needed here
   hipStream_t stream;
   checkCUDA(get_legion_stream(&stream));
@@ -168,7 +184,7 @@ void Group_by::backward_kernel_wrapper(
                      m->dev_region_ptrs,
                      n,
                      k,
-                     alpha,
+                     capacity,
                      batch_size,
                      data_dim);
 }
@@ -281,6 +281,7 @@ void LayerNorm::forward(FFModel const &ff) {
                          false /*must*/,
                          0 /*mapper_id*/,
                          outputs[0]->machine_view.hash());
+  set_priority_for_forward(launcher);
   launcher.add_region_requirement(RegionRequirement(inputs[0]->part,
                                                     0 /*projection id*/,
                                                     READ_ONLY,
@@ -368,6 +369,7 @@ void LayerNorm::backward(FFModel const &ff) {
                          false /*must*/,
                          0 /*mapper_id*/,
                          outputs[0]->machine_view.hash());
+  set_priority_for_backward(launcher);
   // regions[0](I): output_grad
   launcher.add_region_requirement(RegionRequirement(outputs[0]->part_grad,
                                                     0 /*projection id*/,
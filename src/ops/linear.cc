@@ -157,6 +157,7 @@ Linear::Linear(FFModel &model,
   // overwrite layer_guid
   layer_guid = _layer_guid;
   data_type = _data_type;
+  inference = model.config.computationMode == COMP_MODE_INFERENCE;
   auto dimension_names =
       this->get_params().get_dimension_names(_input->get_shape());
   this->in_channels =
@@ -174,7 +175,7 @@ Linear::Linear(FFModel &model,
     weights[KERNEL_IDX] =
         model.create_parallel_weight_legion_ordering(kernel_shape.num_dims,
                                                      kernel_shape.dims,
-                                                     _data_type,
+                                                     DT_FLOAT,
                                                      NULL /*owner_op*/,
                                                      true /*create_grad*/,
                                                      kernel_initializer,
@@ -186,7 +187,7 @@ Linear::Linear(FFModel &model,
       weights[BIAS_IDX] =
           model.create_parallel_weight_legion_ordering(bias_shape.num_dims,
                                                        bias_shape.dims,
-                                                       _data_type,
+                                                       DT_FLOAT,
                                                        NULL /*owner_op*/,
                                                        true /*create_grad*/,
                                                        bias_initializer,
@@ -281,26 +282,14 @@ OpMeta *Linear::init_task_with_dim(Task const *task,
   assert(regions.size() == 2 || regions.size() == 3);
   Linear const *linear = (Linear *)task->args;
   FFHandler handle = *((FFHandler const *)task->local_args);
-  // TensorAccessorR<float, 2> acc_input(
-  //     regions[0], task->regions[0], FID_DATA, ctx, runtime);
-  TensorAccessorW<float, NDIM> acc_output(regions[0],
-                                          task->regions[0],
-                                          FID_DATA,
-                                          ctx,
-                                          runtime,
-                                          false /*readOutput*/);
-  TensorAccessorW<float, NDIM> acc_kernel(regions[1],
-                                          task->regions[1],
-                                          FID_DATA,
-                                          ctx,
-                                          runtime,
-                                          false /*readOutput*/);
-  // TensorAccessorR<float, 1> acc_bias(
-  //     regions[3], task->regions[3], FID_DATA, ctx, runtime);
-  // int in_dim = acc_input.rect.hi[0] - acc_input.rect.lo[0] + 1;
-  int in_dim = acc_kernel.rect.hi[0] - acc_kernel.rect.lo[0] + 1;
-  int out_dim = acc_output.rect.hi[0] - acc_output.rect.lo[0] + 1;
-  int batch_size = acc_output.rect.volume() / out_dim;
+  // The output is half under mixed precision, so only read the domains
+  Domain output_domain = runtime->get_index_space_domain(
+      ctx, task->regions[0].region.get_index_space());
+  Domain kernel_domain = runtime->get_index_space_domain(
+      ctx, task->regions[1].region.get_index_space());
+  int in_dim = kernel_domain.hi()[0] - kernel_domain.lo()[0] + 1;
+  int out_dim = output_domain.hi()[0] - output_domain.lo()[0] + 1;
+  int batch_size = output_domain.get_volume() / out_dim;
   printf("init linear (input): in_dim(%d) out_dim(%d) batch_size(%d)\n",
          in_dim,
          out_dim,
@@ -314,6 +303,11 @@ OpMeta *Linear::init_task_with_dim(Task const *task,
   m->weight_type = linear->weights[0]->data_type;
   m->output_type = linear->outputs[0]->data_type;
   std::strcpy(m->op_name, linear->name);
+#ifdef FF_USE_CPU
+  if (linear->inference) {
+    m->packed_weight = new CpuGemmPackedA();
+  }
+#endif
 
   Linear::init_kernel(m, batch_size, out_dim);
 
@@ -325,14 +319,17 @@ void Linear::forward(FFModel const &ff) {
   Context ctx = ff.config.lg_ctx;
   Runtime *runtime = ff.config.lg_hlr;
   set_argumentmap_for_forward(ff, argmap);
+  // Lets the CPU kernels drop weights packed before the last write
+  int weight_version = weights[0]->version;
   IndexLauncher launcher(LINEAR_FWD_TASK_ID,
                          parallel_is,
-                         TaskArgument(nullptr, 0),
+                         TaskArgument(&weight_version, sizeof(int)),
                          argmap,
                          Predicate::TRUE_PRED,
                          false /*must*/,
                          0 /*mapper_id*/,
                          outputs[0]->machine_view.hash());
+  set_priority_for_forward(launcher);
   launcher.add_region_requirement(RegionRequirement(inputs[0]->part,
                                                     0 /*projection id*/,
                                                     READ_ONLY,
@@ -391,31 +388,59 @@ void Linear::forward_task_with_dim(Task const *task,
                                    Context ctx,
                                    Runtime *runtime) {
   // Linear* linear = (Linear*) task->args;
-  LinearMeta const *m = *((LinearMeta **)task->local_args);
+  LinearMeta *m = *((LinearMeta **)task->local_args);
   assert(regions.size() == (3 + static_cast<size_t>(m->use_bias)));
   assert(task->regions.size() == (3 + static_cast<size_t>(m->use_bias)));
-
-  TensorAccessorR<float, NDIM> acc_input(
-      regions[0], task->regions[0], FID_DATA, ctx, runtime);
-  TensorAccessorW<float, NDIM> acc_output(regions[1],
-                                          task->regions[1],
-                                          FID_DATA,
-                                          ctx,
-                                          runtime,
-                                          false /*readOutput*/);
-  TensorAccessorR<float, NDIM> acc_kernel(
-      regions[2], task->regions[2], FID_DATA, ctx, runtime);
-  int in_dim = acc_input.rect.hi[0] - acc_input.rect.lo[0] + 1;
-  int out_dim = acc_output.rect.hi[0] - acc_output.rect.lo[0] + 1;
-  int batch_size = acc_output.rect.volume() / out_dim;
-  assert(acc_output.rect.volume() == static_cast<size_t>(out_dim * batch_size));
-  assert(acc_input.rect.volume() == static_cast<size_t>(in_dim * batch_size));
-  assert(acc_kernel.rect.volume() == static_cast<size_t>(in_dim * out_dim));
-  float const *acc_bias_ptr = NULL;
+#ifdef FF_USE_CPU
+  assert(task->arglen == sizeof(int));
+  int weight_version = *((int const *)task->args);
+  if (m->packed_weight != NULL && m->packed_weight_version != weight_version) {
+    m->packed_weight->panels.clear();
+    m->packed_weight_version = weight_version;
+  }
+#endif
+
+  GenericTensorAccessorR acc_input(NDIM,
+                                   m->input_type,
+                                   regions[0],
+                                   task->regions[0],
+                                   FID_DATA,
+                                   ctx,
+                                   runtime);
+  GenericTensorAccessorW acc_output(NDIM,
+                                    m->output_type,
+                                    regions[1],
+                                    task->regions[1],
+                                    FID_DATA,
+                                    ctx,
+                                    runtime,
+                                    false /*readOutput*/);
+  GenericTensorAccessorR acc_kernel(NDIM,
+                                    m->weight_type,
+                                    regions[2],
+                                    task->regions[2],
+                                    FID_DATA,
+                                    ctx,
+                                    runtime);
+  int in_dim = acc_input.domain.hi()[0] - acc_input.domain.lo()[0] + 1;
+  int out_dim = acc_output.domain.hi()[0] - acc_output.domain.lo()[0] + 1;
+  int batch_size = acc_output.domain.get_volume() / out_dim;
+  assert(acc_output.domain.get_volume() ==
+         static_cast<size_t>(out_dim * batch_size));
+  assert(acc_input.domain.get_volume() ==
+         static_cast<size_t>(in_dim * batch_size));
+  assert(acc_kernel.domain.get_volume() ==
+         static_cast<size_t>(in_dim * out_dim));
+  void const *acc_bias_ptr = NULL;
   if (m->use_bias) {
-    TensorAccessorR<float, 3> acc_bias(
-        regions[3], task->regions[3], FID_DATA, ctx, runtime);
-    assert(acc_bias.rect.volume() == static_cast<size_t>(out_dim));
+    GenericTensorAccessorR acc_bias(3,
+                                    m->weight_type,
+                                    regions[3],
+                                    task->regions[3],
+                                    FID_DATA,
+                                    ctx,
+                                    runtime);
+    assert(acc_bias.domain.get_volume() == static_cast<size_t>(out_dim));
     acc_bias_ptr = acc_bias.ptr;
   }
 
@@ -443,6 +468,7 @@ void Linear::backward(FFModel const &ff) {
                            false /*must*/,
                            0 /*mapper_id*/,
                            outputs[0]->machine_view.hash());
+    set_priority_for_backward(launcher);
     int rid = 0;
     // regions[0](I): input
     launcher.add_region_requirement(RegionRequirement(inputs[0]->part,
@@ -543,71 +569,92 @@ void Linear::backward_task_with_dim(Task const *task,
   assert(task->regions.size() ==
          (5 + static_cast<size_t>(m->trainableInputs[0]) +
           static_cast<size_t>(m->use_bias)));
-  float *input_grad = NULL;
+  void *input_grad = NULL;
   size_t rid = 0;
-  TensorAccessorR<float, NDIM> acc_input(
-      regions[rid], task->regions[rid], FID_DATA, ctx, runtime);
+  GenericTensorAccessorR acc_input(NDIM,
+                                   m->input_type,
+                                   regions[rid],
+                                   task->regions[rid],
+                                   FID_DATA,
+                                   ctx,
+                                   runtime);
   rid++;
   if (m->trainableInputs[0]) {
     Domain domain = runtime->get_index_space_domain(
         ctx, task->regions[rid].region.get_index_space());
-    if (domain.get_dim() == NDIM + 1) {
-      assert(domain.get_volume() == acc_input.rect.volume());
-      input_grad = helperGetTensorPointerWO<float>(
-          regions[rid], task->regions[rid], FID_DATA, ctx, runtime);
-    } else {
-      TensorAccessorW<float, NDIM> acc_replica_grad(regions[rid],
-                                                    task->regions[rid],
-                                                    FID_DATA,
-                                                    ctx,
-                                                    runtime,
-                                                    true /*readOutput*/);
-      assert(acc_replica_grad.rect.volume() == acc_input.rect.volume());
-      input_grad = acc_replica_grad.ptr;
-    }
+    GenericTensorAccessorW acc_replica_grad(
+        domain.get_dim(),
+        m->input_type,
+        regions[rid],
+        task->regions[rid],
+        FID_DATA,
+        ctx,
+        runtime,
+        domain.get_dim() == NDIM /*readOutput*/);
+    assert(acc_replica_grad.domain.get_volume() ==
+           acc_input.domain.get_volume());
+    input_grad = acc_replica_grad.ptr;
     rid++;
   }
-  TensorAccessorR<float, NDIM> acc_output(
-      regions[rid], task->regions[rid], FID_DATA, ctx, runtime);
+  GenericTensorAccessorR acc_output(NDIM,
+                                    m->output_type,
+                                    regions[rid],
+                                    task->regions[rid],
+                                    FID_DATA,
+                                    ctx,
+                                    runtime);
   rid++;
-  TensorAccessorW<float, NDIM> acc_output_grad(regions[rid],
-                                               task->regions[rid],
-                                               FID_DATA,
-                                               ctx,
-                                               runtime,
-                                               true /*readOutput*/);
+  GenericTensorAccessorW acc_output_grad(NDIM,
+                                         m->output_type,
+                                         regions[rid],
+                                         task->regions[rid],
+                                         FID_DATA,
+                                         ctx,
+                                         runtime,
+                                         true /*readOutput*/);
   rid++;
-  TensorAccessorR<float, NDIM> acc_kernel(
-      regions[rid], task->regions[rid], FID_DATA, ctx, runtime);
+  GenericTensorAccessorR acc_kernel(NDIM,
+                                    m->weight_type,
+                                    regions[rid],
+                                    task->regions[rid],
+                                    FID_DATA,
+                                    ctx,
+                                    runtime);
   rid++;
-  TensorAccessorW<float, NDIM> acc_kernel_grad(regions[rid],
-                                               task->regions[rid],
-                                               FID_DATA,
-                                               ctx,
-                                               runtime,
-                                               true /*readOutput*/);
+  GenericTensorAccessorW acc_kernel_grad(NDIM,
+                                         m->weight_type,
+                                         regions[rid],
+                                         task->regions[rid],
+                                         FID_DATA,
+                                         ctx,
+                                         runtime,
+                                         true /*readOutput*/);
   rid++;
   // make sure the sizes match
-  int in_dim = acc_input.rect.hi[0] - acc_input.rect.lo[0] + 1;
-  int out_dim = acc_output.rect.hi[0] - acc_output.rect.lo[0] + 1;
-  int batch_size = acc_output.rect.volume() / out_dim;
-  assert(acc_output.rect.volume() == static_cast<size_t>(out_dim * batch_size));
-  assert(acc_output_grad.rect.volume() ==
+  int in_dim = acc_input.domain.hi()[0] - acc_input.domain.lo()[0] + 1;
+  int out_dim = acc_output.domain.hi()[0] - acc_output.domain.lo()[0] + 1;
+  int batch_size = acc_output.domain.get_volume() / out_dim;
+  assert(acc_output.domain.get_volume() ==
          static_cast<size_t>(out_dim * batch_size));
-  assert(acc_kernel.rect.volume() == static_cast<size_t>(in_dim * out_dim));
-  assert(acc_kernel_grad.rect.volume() ==
+  assert(acc_output_grad.domain.get_volume() ==
+         static_cast<size_t>(out_dim * batch_size));
+  assert(acc_kernel.domain.get_volume() ==
+         static_cast<size_t>(in_dim * out_dim));
+  assert(acc_kernel_grad.domain.get_volume() ==
          static_cast<size_t>(in_dim * out_dim));
-  float *acc_bias_grad_ptr = NULL;
+  void *acc_bias_grad_ptr = NULL;
   if (m->use_bias) {
-    TensorAccessorW<float, 3> acc_bias_grad(regions[rid],
-                                            task->regions[rid],
-                                            FID_DATA,
-                                            ctx,
-                                            runtime,
-                                            true /*readOutput*/);
+    GenericTensorAccessorW acc_bias_grad(3,
+                                         m->weight_type,
+                                         regions[rid],
+                                         task->regions[rid],
+                                         FID_DATA,
+                                         ctx,
+                                         runtime,
+                                         true /*readOutput*/);
     rid++;
-    assert(acc_bias_grad.rect.volume() == static_cast<size_t>(out_dim));
-    acc_bias_grad_ptr = static_cast<float *>(acc_bias_grad.ptr);
+    assert(acc_bias_grad.domain.get_volume() == static_cast<size_t>(out_dim));
+    acc_bias_grad_ptr = acc_bias_grad.ptr;
   }
   assert(rid == regions.size());
 
@@ -785,7 +832,7 @@ bool Linear::measure_operator_cost(Simulator *sim,
   LinearMeta *m = sim->linear_meta;
   m->activation = activation;
   m->input_type = inputs[0]->data_type;
-  m->weight_type = this->data_type;
+  m->weight_type = DT_FLOAT;
   m->output_type = outputs[0]->data_type;
   assert(m->profiling == false);
 
@@ -800,8 +847,8 @@ bool Linear::measure_operator_cost(Simulator *sim,
       sim->allocate(sub_output.get_volume(), outputs[0]->data_type);
   cost_metrics.outputs_memory += cost_metrics.total_mem_diff_from(sim->offset);
 
-  void *kernel_ptr = sim->allocate((size_t)output_c * input_c, this->data_type);
-  void *bias_ptr = sim->allocate(output_c, this->data_type);
+  void *kernel_ptr = sim->allocate((size_t)output_c * input_c, DT_FLOAT);
+  void *bias_ptr = sim->allocate(output_c, DT_FLOAT);
   assert(bias_ptr != NULL);
   cost_metrics.weights_memory += cost_metrics.total_mem_diff_from(sim->offset);
 
@@ -839,9 +886,8 @@ bool Linear::measure_operator_cost(Simulator *sim,
     cost_metrics.outputs_memory +=
         cost_metrics.total_mem_diff_from(sim->offset);
 
-    void *kernel_grad_ptr =
-        sim->allocate((size_t)output_c * input_c, this->data_type);
-    void *bias_grad_ptr = sim->allocate(output_c, this->data_type);
+    void *kernel_grad_ptr = sim->allocate((size_t)output_c * input_c, DT_FLOAT);
+    void *bias_grad_ptr = sim->allocate(output_c, DT_FLOAT);
     cost_metrics.weights_memory +=
         cost_metrics.total_mem_diff_from(sim->offset);
 
@@ -904,7 +950,7 @@ Node FFModel::get_or_create_linear_node(LayerID const &layer_guid,
   params.out_channels = out_dim;
   params.activation = activation;
   params.use_bias = use_bias;
-  params.data_type = DT_FLOAT; // TODO: currently assume data type is float
+  params.data_type = input->data_type;
 
   return this->get_or_create_node<Linear>(input, params);
 }
@@ -18,6 +18,53 @@
 
 namespace FlexFlow {
 
+// Under mixed precision the weights stay in float, and the GEMMs read a
+// half copy of them in the workspace
+__global__ void weight_to_half(size_t size, float const *weight, half *out) {
+  CUDA_KERNEL_LOOP(i, size) {
+    out[i] = __float2half(weight[i]);
+  }
+}
+
+__global__ void add_float_bias(size_t size,
+                               int out_dim,
+                               float const *bias,
+                               half *output) {
+  CUDA_KERNEL_LOOP(i, size) {
+    output[i] = __float2half(__half2float(output[i]) + bias[i % out_dim]);
+  }
+}
+
+__global__ void add_half_bias_grad(int out_dim,
+                                   int batch_size,
+                                   half const *output_grad,
+                                   float *bias_grad) {
+  CUDA_KERNEL_LOOP(i, out_dim) {
+    float sum = 0.0f;
+    for (int b = 0; b < batch_size; b++) {
+      sum += __half2float(output_grad[(size_t)b * out_dim + i]);
+    }
+    bias_grad[i] += sum;
+  }
+}
+
+static bool use_half_weight(LinearMeta const *m) {
+  return m->input_type == DT_HALF && m->weight_type == DT_FLOAT;
+}
+
+static half *get_half_weight(LinearMeta const *m,
+                             void const *weight_ptr,
+                             int in_dim,
+                             int out_dim,
+                             cudaStream_t stream) {
+  size_t size = (size_t)in_dim * out_dim;
+  assert(size * sizeof(half) <= m->handle.workSpaceSize);
+  half *half_weight = (half *)m->handle.workSpace;
+  weight_to_half<<<GET_BLOCKS(size), CUDA_NUM_THREADS, 0, stream>>>(
+      size, (float const *)weight_ptr, half_weight);
+  return half_weight;
+}
+
 /*static*/
 void Linear::init_kernel(LinearMeta *m, int batch_size, int channel) {
   if (use_activation(m->activation)) {
@@ -67,6 +114,15 @@ void Linear::forward_kernel(LinearMeta const *m,
 #else
   cudaDataType_t compute_type = CUDA_R_32F;
 #endif
+  bool half_weight = use_half_weight(m);
+  if (half_weight) {
+    weight_ptr = get_half_weight(m, weight_ptr, in_dim, out_dim, stream);
+    weight_type = CUDA_R_16F;
+#if CUDA_VERSION >= 11000
+    // Accumulate in float
+    compute_type = CUBLAS_COMPUTE_32F;
+#endif
+  }
   checkCUDA(cublasGemmEx(m->handle.blas,
                          CUBLAS_OP_T,
                          CUBLAS_OP_N,
@@ -87,7 +143,11 @@ void Linear::forward_kernel(LinearMeta const *m,
                          compute_type,
                          CUBLAS_GEMM_DEFAULT_TENSOR_OP));
   // use_bias = True
-  if (bias_ptr != NULL) {
+  if (bias_ptr != NULL && half_weight) {
+    size_t elements = (size_t)out_dim * (size_t)batch_size;
+    add_float_bias<<<GET_BLOCKS(elements), CUDA_NUM_THREADS, 0, stream>>>(
+        elements, out_dim, (float const *)bias_ptr, (half *)output_ptr);
+  } else if (bias_ptr != NULL) {
     checkCUDA(cublasGemmEx(m->handle.blas,
                            CUBLAS_OP_T,
                            CUBLAS_OP_N,
@@ -121,8 +181,15 @@ void Linear::forward_kernel(LinearMeta const *m,
     size_t elements = (size_t)out_dim * (size_t)batch_size;
     constexpr float B = 0.7978845608028654f;   // sqrt(2.0/M_PI)
     constexpr float C = 0.035677408136300125f; // 0.044715 * sqrt(2.0/M_PI)
-    gelu_forward_kernel<<<GET_BLOCKS(elements), CUDA_NUM_THREADS>>>(
-        elements, B, C, (float *)output_ptr);
+    if (m->output_type == DT_HALF) {
+      gelu_forward_kernel<<<GET_BLOCKS(elements),
+                            CUDA_NUM_THREADS,
+                            0,
+                            stream>>>(elements, B, C, (half *)output_ptr);
+    } else {
+      gelu_forward_kernel<<<GET_BLOCKS(elements), CUDA_NUM_THREADS>>>(
+          elements, B, C, (float *)output_ptr);
+    }
   } else if (m->activation == AC_MODE_NONE) {
     // Do nothing
   } else {
@@ -201,6 +268,16 @@ void Linear::backward_kernel(LinearMeta const *m,
 #else
   cudaDataType_t compute_type = CUDA_R_32F;
 #endif
+  bool half_weight = use_half_weight(m);
+  cudaDataType_t weight_grad_type = weight_type;
+  if (half_weight) {
+    // The weight gradients are accumulated in float
+    kernel_ptr = get_half_weight(m, kernel_ptr, in_dim, out_dim, stream);
+    weight_type = CUDA_R_16F;
+#if CUDA_VERSION >= 11000
+    compute_type = CUBLAS_COMPUTE_32F;
+#endif
+  }
   int output_size = out_dim * batch_size;
   if (m->activation == AC_MODE_RELU) {
     relu_backward_kernel(
@@ -229,14 +306,20 @@ void Linear::backward_kernel(LinearMeta const *m,
                          out_dim,
                          &alpha,
                          kernel_grad_ptr,
-                         weight_type,
+                         weight_grad_type,
                          in_dim,
                          compute_type,
                          CUBLAS_GEMM_DEFAULT_TENSOR_OP));
   // Compute bias gradiant
   // NOTE: we use alpha=1 for bias_grad to accumulate gradients
   // use_bias = True
-  if (bias_grad_ptr != NULL) {
+  if (bias_grad_ptr != NULL && half_weight) {
+    add_half_bias_grad<<<GET_BLOCKS(out_dim), CUDA_NUM_THREADS, 0, stream>>>(
+        out_dim,
+        batch_size,
+        (half const *)output_grad_ptr,
+        (float *)bias_grad_ptr);
+  } else if (bias_grad_ptr != NULL) {
     checkCUDA(cublasGemmEx(m->handle.blas,
                            CUBLAS_OP_N,
                            CUBLAS_OP_T,
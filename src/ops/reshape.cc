@@ -170,6 +170,7 @@ void Reshape::forward(FFModel const &ff) {
                          false /*must*/,
                          0 /*mapper_id*/,
                          outputs[0]->machine_view.hash());
+  set_priority_for_forward(launcher);
   launcher.add_region_requirement(RegionRequirement(inputs[0]->part,
                                                     0 /*projection id*/,
                                                     READ_ONLY,
@@ -245,6 +246,7 @@ void Reshape::backward(FFModel const &ff) {
                          false /*must*/,
                          0 /*mapper_id*/,
                          outputs[0]->machine_view.hash());
+  set_priority_for_backward(launcher);
   // regions[0](I): output_grad
   launcher.add_region_requirement(RegionRequirement(outputs[0]->part_grad,
                                                     0 /*projection id*/,
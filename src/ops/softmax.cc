@@ -33,27 +33,27 @@ using Legion::Task;
 using Legion::TaskArgument;
 using Legion::TaskLauncher;
 
-Tensor FFModel::softmax(const Tensor _input, int dim, char const *name) {
+Tensor FFModel::softmax(const Tensor input, int dim, char const *name) {
   Layer *sm = new Layer(this,
                         OP_SOFTMAX,
                         name,
                         1 /*inputs*/,
                         0 /*weights*/,
                         1 /*outputs*/,
-                        _input);
-  int numdims = _input->num_dims;
+                        input);
+  int numdims = input->num_dims;
   int dims[MAX_TENSOR_DIM];
   for (int i = 0; i < numdims; i++)
-    dims[i] = _input->dims[i];
+    dims[i] = input->dims[i];
   sm->outputs[0] = create_tensor_legion_ordering(
-      numdims, dims, DT_FLOAT, sm, 0, true /*create_grad*/);
+      numdims, dims, input->data_type, sm, 0, true /*create_grad*/);
   sm->add_int_property("softmax_dim", dim);
   layers.push_back(sm);
   return sm->outputs[0];
 #ifdef DEADCODE
   if (dim < 0)
-    dim += _input->num_dims;
-  Softmax *sm = new Softmax(*this, _input, _input->num_dims - 1 - dim, name);
+    dim += input->num_dims;
+  Softmax *sm = new Softmax(*this, input, input->num_dims - 1 - dim, name);
   layers.push_back(sm);
   return sm->outputs[0];
 #endif
@@ -90,7 +90,8 @@ Softmax::Softmax(FFModel &model,
   int numdim = _input->num_dims;
   for (int i = 0; i < numdim; i++)
     dims[i] = _input->dims[numdim - 1 - i];
-  outputs[0] = model.create_parallel_tensor(numdim, dims, DT_FLOAT, this);
+  outputs[0] =
+      model.create_parallel_tensor(numdim, dims, _input->data_type, this);
 }
 
 void Softmax::init(FFModel const &ff) {
@@ -178,6 +179,7 @@ void Softmax::forward(FFModel const &ff) {
                          false /*must*/,
                          0 /*mapper_id*/,
                          outputs[0]->machine_view.hash());
+  set_priority_for_forward(launcher);
   launcher.add_region_requirement(RegionRequirement(inputs[0]->part,
                                                     0 /*projection id*/,
                                                     READ_ONLY,
@@ -223,14 +225,16 @@ void Softmax::forward_task_with_dim(Task const *task,
   assert(task->regions.size() == 2);
   // const Softmax* softmax = (Softmax*) task->args;
   SoftmaxMeta const *m = *((SoftmaxMeta **)task->local_args);
-  TensorAccessorR<float, NDIM> acc_input(
-      regions[0], task->regions[0], FID_DATA, ctx, runtime);
-  TensorAccessorW<float, NDIM> acc_output(regions[1],
-                                          task->regions[1],
-                                          FID_DATA,
-                                          ctx,
-                                          runtime,
-                                          false /*readOutput*/);
+  GenericTensorAccessorR acc_input(
+      NDIM, m->data_type, regions[0], task->regions[0], FID_DATA, ctx, runtime);
+  GenericTensorAccessorW acc_output(NDIM,
+                                    m->data_type,
+                                    regions[1],
+                                    task->regions[1],
+                                    FID_DATA,
+                                    ctx,
+                                    runtime,
+                                    false /*readOutput*/);
 
   Softmax::forward_kernel_wrapper(m, acc_input.ptr, acc_output.ptr);
 }
@@ -248,6 +252,7 @@ void Softmax::backward(FFModel const &ff) {
                          false /*must*/,
                          0 /*mapper_id*/,
                          outputs[0]->machine_view.hash());
+  set_priority_for_backward(launcher);
   launcher.add_region_requirement(RegionRequirement(inputs[0]->part_grad,
                                                     0 /*projection id*/,
                                                     READ_WRITE,
@@ -296,19 +301,23 @@ void Softmax::backward_task_with_dim(Task const *task,
   assert(task->regions.size() == 2);
   // const Softmax* softmax = (Softmax*) task->args;
   SoftmaxMeta const *m = *((SoftmaxMeta **)task->local_args);
-  TensorAccessorW<float, NDIM> acc_input_grad(regions[0],
-                                              task->regions[0],
-                                              FID_DATA,
-                                              ctx,
-                                              runtime,
-                                              true /*readOutput*/);
-  TensorAccessorR<float, NDIM> acc_output_grad(
-      regions[1], task->regions[1], FID_DATA, ctx, runtime);
+  GenericTensorAccessorW acc_input_grad(NDIM,
+                                        m->data_type,
+                                        regions[0],
+                                        task->regions[0],
+                                        FID_DATA,
+                                        ctx,
+                                        runtime,
+                                        true /*readOutput*/);
+  GenericTensorAccessorR acc_output_grad(
+      NDIM, m->data_type, regions[1], task->regions[1], FID_DATA, ctx, runtime);
   // make sure the image indices match!
-  assert(acc_input_grad.rect == acc_output_grad.rect);
+  assert(acc_input_grad.domain == acc_output_grad.domain);
 
-  Softmax::backward_kernel_wrapper(
-      m, acc_input_grad.ptr, acc_output_grad.ptr, acc_input_grad.rect.volume());
+  Softmax::backward_kernel_wrapper(m,
+                                   acc_input_grad.ptr,
+                                   acc_output_grad.ptr,
+                                   acc_input_grad.domain.get_volume());
 }
 
 bool Softmax::get_int_parameter(PMParameter para, int *value) const {
@@ -342,24 +351,23 @@ bool Softmax::measure_operator_cost(Simulator *sim,
   SoftmaxMeta *m = new SoftmaxMeta(sim->handler, this, sub_output.get_domain());
 
   sim->free_all();
-  float *input_ptr = (float *)sim->allocate(sub_input.get_volume(), DT_FLOAT);
+  void *input_ptr = sim->allocate(sub_input.get_volume(), m->data_type);
   assert(input_ptr != NULL);
   cost_metrics.inputs_memory += cost_metrics.total_mem_diff_from(sim->offset);
 
-  float *output_ptr = (float *)sim->allocate(sub_output.get_volume(), DT_FLOAT);
+  void *output_ptr = sim->allocate(sub_output.get_volume(), m->data_type);
   assert(output_ptr != NULL);
   cost_metrics.outputs_memory += cost_metrics.total_mem_diff_from(sim->offset);
 
   std::function<void()> forward, backward;
   forward = [&] { forward_kernel_wrapper(m, input_ptr, output_ptr); };
   if (sim->computationMode == COMP_MODE_TRAINING) {
-    float *input_grad_ptr =
-        (float *)sim->allocate(sub_input.get_volume(), DT_FLOAT);
+    void *input_grad_ptr = sim->allocate(sub_input.get_volume(), m->data_type);
     assert(input_grad_ptr != NULL);
     cost_metrics.inputs_memory += cost_metrics.total_mem_diff_from(sim->offset);
 
-    float *output_grad_ptr =
-        (float *)sim->allocate(sub_output.get_volume(), DT_FLOAT);
+    void *output_grad_ptr =
+        sim->allocate(sub_output.get_volume(), m->data_type);
     assert(output_grad_ptr != NULL);
     cost_metrics.outputs_memory +=
         cost_metrics.total_mem_diff_from(sim->offset);
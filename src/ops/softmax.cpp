@@ -26,6 +26,7 @@ SoftmaxMeta::SoftmaxMeta(FFHandler handler,
                          Softmax const *softmax,
                          Domain const &input_domain)
     : OpMeta(handler) {
+  data_type = softmax->outputs[0]->data_type;
   checkCUDNN(miopenCreateTensorDescriptor(&inputTensor));
   checkCUDNN(cudnnSetTensorDescriptorFromDomain(inputTensor, input_domain));
   dim = softmax->dim;
@@ -35,9 +36,10 @@ SoftmaxMeta::SoftmaxMeta(FFHandler handler,
 
 /* static */
 void Softmax::forward_kernel(SoftmaxMeta const *m,
-                             float const *input_ptr,
-                             float *output_ptr,
+                             void const *input_ptr,
+                             void *output_ptr,
                              hipStream_t stream) {
+  assert(m->data_type == DT_FLOAT);
   checkCUDNN(miopenSetStream(m->handle.dnn, stream));
 
   float alpha = 1.0f, beta = 0.0f;
@@ -54,8 +56,8 @@ void Softmax::forward_kernel(SoftmaxMeta const *m,
 
 /* static */
 void Softmax::forward_kernel_wrapper(SoftmaxMeta const *m,
-                                     float const *input_ptr,
-                                     float *output_ptr) {
+                                     void const *input_ptr,
+                                     void *output_ptr) {
   hipStream_t stream;
   checkCUDA(get_legion_stream(&stream));
 
@@ -82,21 +84,22 @@ void Softmax::forward_kernel_wrapper(SoftmaxMeta const *m,
 }
 
 /* static */
-void Softmax::backward_kernel(float *input_grad_ptr,
-                              float const *output_grad_ptr,
+void Softmax::backward_kernel(SoftmaxMeta const *m,
+                              void *input_grad_ptr,
+                              void const *output_grad_ptr,
                               size_t num_elements,
                               hipStream_t stream) {
   checkCUDA(hipMemcpyAsync(input_grad_ptr,
                            output_grad_ptr,
-                           num_elements * sizeof(float),
+                           num_elements * data_type_size(m->data_type),
                            hipMemcpyDeviceToDevice,
                            stream));
 }
 
 /* static */
 void Softmax::backward_kernel_wrapper(SoftmaxMeta const *m,
-                                      float *input_grad_ptr,
-                                      float const *output_grad_ptr,
+                                      void *input_grad_ptr,
+                                      void const *output_grad_ptr,
                                       size_t num_elements) {
   hipStream_t stream;
   checkCUDA(get_legion_stream(&stream));
@@ -108,7 +111,7 @@ void Softmax::backward_kernel_wrapper(SoftmaxMeta const *m,
     hipEventRecord(t_start, stream);
   }
   Softmax::backward_kernel(
-      input_grad_ptr, output_grad_ptr, num_elements, stream);
+      m, input_grad_ptr, output_grad_ptr, num_elements, stream);
   if (m->profiling) {
     hipEventRecord(t_end, stream);
     checkCUDA(hipEventSynchronize(t_end));
@@ -25,8 +25,10 @@ SoftmaxMeta::SoftmaxMeta(FFHandler handler,
                          Softmax const *softmax,
                          Domain const &input_domain)
     : OpMeta(handler) {
+  data_type = softmax->outputs[0]->data_type;
   checkCUDNN(cudnnCreateTensorDescriptor(&inputTensor));
-  checkCUDNN(cudnnSetTensorDescriptorFromDomain(inputTensor, input_domain));
+  checkCUDNN(cudnnSetTensorDescriptorFromDomain(
+      inputTensor, input_domain, data_type));
   dim = softmax->dim;
   profiling = softmax->profiling;
   std::strcpy(op_name, softmax->name);
@@ -34,8 +36,8 @@ SoftmaxMeta::SoftmaxMeta(FFHandler handler,
 
 /* static */
 void Softmax::forward_kernel(SoftmaxMeta const *m,
-                             float const *input_ptr,
-                             float *output_ptr,
+                             void const *input_ptr,
+                             void *output_ptr,
                              cudaStream_t stream) {
   checkCUDNN(cudnnSetStream(m->handle.dnn, stream));
 
@@ -53,8 +55,8 @@ void Softmax::forward_kernel(SoftmaxMeta const *m,
 
 /* static */
 void Softmax::forward_kernel_wrapper(SoftmaxMeta const *m,
-                                     float const *input_ptr,
-                                     float *output_ptr) {
+                                     void const *input_ptr,
+                                     void *output_ptr) {
   cudaStream_t stream;
   checkCUDA(get_legion_stream(&stream));
 
@@ -81,21 +83,22 @@ void Softmax::forward_kernel_wrapper(SoftmaxMeta const *m,
 }
 
 /* static */
-void Softmax::backward_kernel(float *input_grad_ptr,
-                              float const *output_grad_ptr,
+void Softmax::backward_kernel(SoftmaxMeta const *m,
+                              void *input_grad_ptr,
+                              void const *output_grad_ptr,
                               size_t num_elements,
                               cudaStream_t stream) {
   checkCUDA(cudaMemcpyAsync(input_grad_ptr,
                             output_grad_ptr,
-                            num_elements * sizeof(float),
+                            num_elements * data_type_size(m->data_type),
                             cudaMemcpyDeviceToDevice,
                             stream));
 }
 
 /* static */
 void Softmax::backward_kernel_wrapper(SoftmaxMeta const *m,
-                                      float *input_grad_ptr,
-                                      float const *output_grad_ptr,
+                                      void *input_grad_ptr,
+                                      void const *output_grad_ptr,
                                       size_t num_elements) {
   cudaStream_t stream;
   checkCUDA(get_legion_stream(&stream));
@@ -107,7 +110,7 @@ void Softmax::backward_kernel_wrapper(SoftmaxMeta const *m,
     cudaEventRecord(t_start, stream);
   }
   Softmax::backward_kernel(
-      input_grad_ptr, output_grad_ptr, num_elements, stream);
+      m, input_grad_ptr, output_grad_ptr, num_elements, stream);
   if (m->profiling) {
     cudaEventRecord(t_end, stream);
     checkCUDA(cudaEventSynchronize(t_end));
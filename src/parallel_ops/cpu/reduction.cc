@@ -0,0 +1,47 @@
+/* Copyright 2021 CMU, Facebook, LANL, MIT, and Stanford (alphabetical)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flexflow/parallel_ops/reduction.h"
+#include "flexflow/utils/cpu_helper.h"
+
+namespace FlexFlow {
+
+template <typename T>
+void Reduction::forward_kernel(const T *input_ptr,
+                               T *output_ptr,
+                               size_t num_elements,
+                               size_t num_replicas) {
+  copy_kernel<T>(output_ptr, input_ptr, num_elements);
+  for (size_t j = 1; j < num_replicas; j++) {
+    add_kernel<T>(output_ptr, input_ptr + j * num_elements, num_elements);
+  }
+}
+
+template <typename T>
+void Reduction::backward_kernel(const T *output_grad_ptr,
+                                T *input_grad_ptr,
+                                size_t num_elements) {
+  copy_kernel<T>(input_grad_ptr, output_grad_ptr, num_elements);
+}
+
+template void Reduction::forward_kernel<float>(float const *input_ptr,
+                                               float *output_ptr,
+                                               size_t num_elements,
+                                               size_t num_replicas);
+template void Reduction::backward_kernel<float>(float const *output_grad_ptr,
+                                                float *input_grad_ptr,
+                                                size_t num_elements);
+
+}; // namespace FlexFlow
@@ -39,6 +39,10 @@ GenericTensorAccessorR::GenericTensorAccessorR(int _num_dim,
       TensorAccessorR<double, DIM> acc(region, req, fid, ctx, runtime);        \
       domain = acc.rect;                                                       \
       ptr = acc.ptr;                                                           \
+    } else if (data_type == DT_HALF) {                                         \
+      TensorAccessorR<half, DIM> acc(region, req, fid, ctx, runtime);          \
+      domain = acc.rect;                                                       \
+      ptr = acc.ptr;                                                           \
     } else if (data_type == DT_INT64) {                                        \
       TensorAccessorR<int64_t, DIM> acc(region, req, fid, ctx, runtime);       \
       domain = acc.rect;                                                       \
@@ -104,6 +108,11 @@ GenericTensorAccessorW::GenericTensorAccessorW(int _num_dim,
           region, req, fid, ctx, runtime, readOutput);                         \
       domain = acc.rect;                                                       \
       ptr = acc.ptr;                                                           \
+    } else if (data_type == DT_HALF) {                                         \
+      TensorAccessorW<half, DIM> acc(                                          \
+          region, req, fid, ctx, runtime, readOutput);                         \
+      domain = acc.rect;                                                       \
+      ptr = acc.ptr;                                                           \
     } else if (data_type == DT_INT64) {                                        \
       TensorAccessorW<int64_t, DIM> acc(                                       \
           region, req, fid, ctx, runtime, readOutput);                         \
@@ -238,6 +247,22 @@ template double *helperGetTensorPointerWO(PhysicalRegion region,
                                           Context ctx,
                                           Runtime *runtime);
 
+template half const *helperGetTensorPointerRO(PhysicalRegion region,
+                                              RegionRequirement req,
+                                              FieldID fid,
+                                              Context ctx,
+                                              Runtime *runtime);
+template half *helperGetTensorPointerRW(PhysicalRegion region,
+                                        RegionRequirement req,
+                                        FieldID fid,
+                                        Context ctx,
+                                        Runtime *runtime);
+template half *helperGetTensorPointerWO(PhysicalRegion region,
+                                        RegionRequirement req,
+                                        FieldID fid,
+                                        Context ctx,
+                                        Runtime *runtime);
+
 template int32_t const *helperGetTensorPointerRO(PhysicalRegion region,
                                                  RegionRequirement req,
                                                  FieldID fid,
@@ -0,0 +1,784 @@
+/* Copyright 2023 CMU, Facebook, LANL, MIT, NVIDIA, and Stanford (alphabetical)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flexflow/checkpoint.h"
+#include "flexflow/model.h"
+#include "flexflow/optimizer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+namespace FlexFlow {
+
+using namespace Legion;
+
+static int const CHECKPOINT_FORMAT_VERSION = 1;
+
+CheckpointManifest::CheckpointManifest(void)
+    : checkpoint_id(0), num_ranks(0) {}
+
+bool CheckpointManifest::write(std::string const &path) const {
+  std::string tmp_path = path + ".tmp." + std::to_string(getpid());
+  {
+    std::ofstream file(tmp_path, std::ios::trunc);
+    if (!file.good()) {
+      return false;
+    }
+    file.precision(17);
+    file << "flexflow-checkpoint " << CHECKPOINT_FORMAT_VERSION << "\n";
+    file << "id " << checkpoint_id << "\n";
+    file << "ranks " << num_ranks << "\n";
+    for (auto const &it : scalars) {
+      file << "scalar " << it.first << " " << it.second << "\n";
+    }
+    // The name goes last, since it runs to the end of the line
+    for (CheckpointTensorInfo const &info : tensors) {
+      file << "tensor " << info.data_type << " " << info.ndims;
+      for (int i = 0; i < info.ndims; i++) {
+        file << " " << info.dims[i];
+      }
+      file << " " << info.name << "\n";
+    }
+    if (!file.good()) {
+      file.close();
+      remove(tmp_path.c_str());
+      return false;
+    }
+  }
+  if (rename(tmp_path.c_str(), path.c_str()) != 0) {
+    remove(tmp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool CheckpointManifest::read(std::string const &path) {
+  std::ifstream file(path);
+  std::string line, word;
+  int version = 0;
+  if (!std::getline(file, line)) {
+    return false;
+  }
+  std::istringstream header(line);
+  if (!(header >> word >> version) || word != "flexflow-checkpoint" ||
+      version != CHECKPOINT_FORMAT_VERSION) {
+    return false;
+  }
+  tensors.clear();
+  scalars.clear();
+  while (std::getline(file, line)) {
+    std::istringstream fields(line);
+    fields >> word;
+    if (word == "id") {
+      fields >> checkpoint_id;
+    } else if (word == "ranks") {
+      fields >> num_ranks;
+    } else if (word == "scalar") {
+      std::string key;
+      double value;
+      fields >> key >> value;
+      scalars[key] = value;
+    } else if (word == "tensor") {
+      CheckpointTensorInfo info;
+      int data_type;
+      fields >> data_type >> info.ndims;
+      if (info.ndims < 0 || info.ndims > MAX_TENSOR_DIM) {
+        return false;
+      }
+      info.data_type = (DataType)data_type;
+      for (int i = 0; i < info.ndims; i++) {
+        fields >> info.dims[i];
+      }
+      fields.get();
+      std::getline(fields, info.name);
+      tensors.push_back(info);
+    } else {
+      return false;
+    }
+    if (fields.fail()) {
+      return false;
+    }
+  }
+  return num_ranks > 0;
+}
+
+int CheckpointManifest::find_tensor(std::string const &name) const {
+  for (size_t i = 0; i < tensors.size(); i++) {
+    if (tensors[i].name == name) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+std::string get_checkpoint_shard_path(std::string const &dir,
+                                      uint64_t checkpoint_id,
+                                      int rank) {
+  char name[64];
+  snprintf(name,
+           sizeof(name),
+           "%016llx.%d.shards",
+           (unsigned long long)checkpoint_id,
+           rank);
+  return dir + "/" + name;
+}
+
+void read_checkpoint_shards(std::string const &dir,
+                            uint64_t checkpoint_id,
+                            int rank,
+                            std::vector<CheckpointShardLocation> &shards) {
+  std::ifstream file(get_checkpoint_shard_path(dir, checkpoint_id, rank),
+                     std::ios::binary | std::ios::ate);
+  if (!file.good()) {
+    return;
+  }
+  uint64_t file_size = file.tellg();
+  file.seekg(0);
+  while (true) {
+    CheckpointShardLocation shard;
+    file.read((char *)&shard.header, sizeof(CheckpointShardHeader));
+    if (!file.good() || shard.header.magic != CHECKPOINT_SHARD_MAGIC ||
+        shard.header.ndims < 0 || shard.header.ndims > MAX_TENSOR_DIM) {
+      break;
+    }
+    shard.rank = rank;
+    shard.offset = file.tellg();
+    if (shard.offset + shard.header.num_bytes > file_size) {
+      break;
+    }
+    if (shard.header.checkpoint_id == checkpoint_id) {
+      shards.push_back(shard);
+    }
+    file.seekg(shard.offset + shard.header.num_bytes);
+  }
+}
+
+size_t copy_checkpoint_box(int ndims,
+                           int64_t const *src_lo,
+                           int64_t const *src_hi,
+                           char const *src,
+                           int64_t const *dst_lo,
+                           int64_t const *dst_hi,
+                           char *dst,
+                           size_t elem_size) {
+  assert(ndims > 0 && ndims <= MAX_TENSOR_DIM);
+  int64_t lo[MAX_TENSOR_DIM], hi[MAX_TENSOR_DIM], p[MAX_TENSOR_DIM];
+  for (int i = 0; i < ndims; i++) {
+    lo[i] = std::max(src_lo[i], dst_lo[i]);
+    hi[i] = std::min(src_hi[i], dst_hi[i]);
+    if (lo[i] > hi[i]) {
+      return 0;
+    }
+    p[i] = lo[i];
+  }
+  // Rows along the innermost dimension are contiguous in both boxes
+  size_t row_length = hi[0] - lo[0] + 1;
+  size_t num_copied = 0;
+  while (true) {
+    size_t src_offset = 0, dst_offset = 0, src_stride = 1, dst_stride = 1;
+    for (int i = 0; i < ndims; i++) {
+      src_offset += (p[i] - src_lo[i]) * src_stride;
+      dst_offset += (p[i] - dst_lo[i]) * dst_stride;
+      src_stride *= src_hi[i] - src_lo[i] + 1;
+      dst_stride *= dst_hi[i] - dst_lo[i] + 1;
+    }
+    memcpy(dst + dst_offset * elem_size,
+           src + src_offset * elem_size,
+           row_length * elem_size);
+    num_copied += row_length;
+    int i = 1;
+    while (i < ndims && p[i] == hi[i]) {
+      p[i] = lo[i];
+      i++;
+    }
+    if (i == ndims) {
+      break;
+    }
+    p[i]++;
+  }
+  return num_copied;
+}
+
+CheckpointWriter::CheckpointWriter(void)
+    : writing(false), stopping(false), failed(false),
+      thread(&CheckpointWriter::run, this) {}
+
+CheckpointWriter::~CheckpointWriter(void) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  queued.notify_one();
+  thread.join();
+}
+
+void CheckpointWriter::write(std::string const &path,
+                             CheckpointShardHeader const &header,
+                             std::vector<char> &&data) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    Request request;
+    request.path = path;
+    request.header = header;
+    request.data = std::move(data);
+    requests.push_back(std::move(request));
+  }
+  queued.notify_one();
+}
+
+bool CheckpointWriter::flush(void) {
+  std::unique_lock<std::mutex> lock(mutex);
+  drained.wait(lock, [this] { return requests.empty() && !writing; });
+  bool ok = !failed;
+  failed = false;
+  return ok;
+}
+
+void CheckpointWriter::run(void) {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    queued.wait(lock, [this] { return stopping || !requests.empty(); });
+    if (requests.empty()) {
+      // Only stop once every queued shard is written
+      break;
+    }
+    Request request = std::move(requests.front());
+    requests.pop_front();
+    writing = true;
+    lock.unlock();
+    bool ok = false;
+    FILE *file = fopen(request.path.c_str(), "ab");
+    if (file != NULL) {
+      ok = fwrite(&request.header, sizeof(CheckpointShardHeader), 1, file) ==
+           1;
+      ok = ok && fwrite(request.data.data(), 1, request.data.size(), file) ==
+                     request.data.size();
+      // A checkpoint must survive the crash it is taken for
+      ok = ok && fflush(file) == 0 && fsync(fileno(file)) == 0;
+      ok = (fclose(file) == 0) && ok;
+    }
+    if (!ok) {
+      fprintf(stderr,
+              "Cannot write checkpoint shard to %s\n",
+              request.path.c_str());
+    }
+    lock.lock();
+    writing = false;
+    failed = failed || !ok;
+    if (requests.empty()) {
+      drained.notify_all();
+    }
+  }
+}
+
+/*static*/
+CheckpointWriter *CheckpointWriter::get_writer(void) {
+  // Destroyed at exit, after writing what is still queued
+  static CheckpointWriter writer;
+  return &writer;
+}
+
+static void const *get_shard_ptr_ro(DataType data_type,
+                                    PhysicalRegion const &region,
+                                    RegionRequirement const &req,
+                                    Context ctx,
+                                    Runtime *runtime) {
+  switch (data_type) {
+    case DT_HALF:
+      return helperGetTensorPointerRO<half>(
+          region, req, FID_DATA, ctx, runtime);
+    case DT_FLOAT:
+      return helperGetTensorPointerRO<float>(
+          region, req, FID_DATA, ctx, runtime);
+    case DT_DOUBLE:
+      return helperGetTensorPointerRO<double>(
+          region, req, FID_DATA, ctx, runtime);
+    case DT_INT32:
+      return helperGetTensorPointerRO<int32_t>(
+          region, req, FID_DATA, ctx, runtime);
+    case DT_INT64:
+      return helperGetTensorPointerRO<int64_t>(
+          region, req, FID_DATA, ctx, runtime);
+    default:
+      assert(false && "Unsupported data type");
+  }
+  return NULL;
+}
+
+static void *get_shard_ptr_wo(DataType data_type,
+                              PhysicalRegion const &region,
+                              RegionRequirement const &req,
+                              Context ctx,
+                              Runtime *runtime) {
+  switch (data_type) {
+    case DT_HALF:
+      return helperGetTensorPointerWO<half>(
+          region, req, FID_DATA, ctx, runtime);
+    case DT_FLOAT:
+      return helperGetTensorPointerWO<float>(
+          region, req, FID_DATA, ctx, runtime);
+    case DT_DOUBLE:
+      return helperGetTensorPointerWO<double>(
+          region, req, FID_DATA, ctx, runtime);
+    case DT_INT32:
+      return helperGetTensorPointerWO<int32_t>(
+          region, req, FID_DATA, ctx, runtime);
+    case DT_INT64:
+      return helperGetTensorPointerWO<int64_t>(
+          region, req, FID_DATA, ctx, runtime);
+    default:
+      assert(false && "Unsupported data type");
+  }
+  return NULL;
+}
+
+/*
+  regions[0](I): shard of the tensor, in zero-copy memory
+*/
+void Checkpoint::save_shard_task(Task const *task,
+                                 std::vector<PhysicalRegion> const &regions,
+                                 Context ctx,
+                                 Runtime *runtime) {
+  assert(regions.size() == 1);
+  assert(task->regions.size() == 1);
+  assert(task->arglen == sizeof(ShardArgs));
+  ShardArgs const *args = (ShardArgs const *)task->args;
+  Domain domain = runtime->get_index_space_domain(
+      ctx, task->regions[0].region.get_index_space());
+  assert(domain.get_dim() == args->num_dims);
+  CheckpointShardHeader header;
+  // Zero the padding too, so equal checkpoints are equal files
+  memset(&header, 0, sizeof(header));
+  header.magic = CHECKPOINT_SHARD_MAGIC;
+  header.checkpoint_id = args->checkpoint_id;
+  header.tensor_id = args->tensor_id;
+  header.ndims = 0;
+  for (int i = 0; i < args->num_dims; i++) {
+    if (args->is_replica_dim[i]) {
+      // Replicas hold the same data, which the first one saves
+      if (domain.lo()[i] != 0) {
+        return;
+      }
+      continue;
+    }
+    header.lo[header.ndims] = domain.lo()[i];
+    header.hi[header.ndims] = domain.hi()[i];
+    header.ndims++;
+  }
+  header.num_bytes = domain.get_volume() * data_type_size(args->data_type);
+  char const *ptr = (char const *)get_shard_ptr_ro(
+      args->data_type, regions[0], task->regions[0], ctx, runtime);
+  // Only the copy to host memory delays the tasks that update the tensor
+  std::vector<char> data(ptr, ptr + header.num_bytes);
+  std::string path =
+      get_checkpoint_shard_path(args->dir,
+                                args->checkpoint_id,
+                                task->current_proc.address_space());
+  CheckpointWriter::get_writer()->write(path, header, std::move(data));
+}
+
+/*
+  regions[0](O): shard of the tensor, in zero-copy memory
+*/
+bool Checkpoint::load_shard_task(Task const *task,
+                                 std::vector<PhysicalRegion> const &regions,
+                                 Context ctx,
+                                 Runtime *runtime) {
+  assert(regions.size() == 1);
+  assert(task->regions.size() == 1);
+  ShardArgs const *args = (ShardArgs const *)task->args;
+  CheckpointShardLocation const *shards =
+      (CheckpointShardLocation const *)(args + 1);
+  assert(task->arglen ==
+         sizeof(ShardArgs) +
+             args->num_shards * sizeof(CheckpointShardLocation));
+  Domain domain = runtime->get_index_space_domain(
+      ctx, task->regions[0].region.get_index_space());
+  assert(domain.get_dim() == args->num_dims);
+  int64_t lo[MAX_TENSOR_DIM], hi[MAX_TENSOR_DIM];
+  int ndims = 0;
+  for (int i = 0; i < args->num_dims; i++) {
+    // Every replica loads the same data
+    if (!args->is_replica_dim[i]) {
+      lo[ndims] = domain.lo()[i];
+      hi[ndims] = domain.hi()[i];
+      ndims++;
+    }
+  }
+  char *ptr = (char *)get_shard_ptr_wo(
+      args->data_type, regions[0], task->regions[0], ctx, runtime);
+  size_t elem_size = data_type_size(args->data_type);
+  size_t num_copied = 0;
+  std::vector<char> data;
+  for (int s = 0; s < args->num_shards; s++) {
+    CheckpointShardHeader const &header = shards[s].header;
+    assert(header.ndims == ndims);
+    bool overlaps = true;
+    for (int i = 0; i < ndims; i++) {
+      overlaps = overlaps && header.lo[i] <= hi[i] && lo[i] <= header.hi[i];
+    }
+    if (!overlaps) {
+      continue;
+    }
+    std::ifstream file(get_checkpoint_shard_path(
+                           args->dir, args->checkpoint_id, shards[s].rank),
+                       std::ios::binary);
+    file.seekg(shards[s].offset);
+    data.resize(header.num_bytes);
+    file.read(data.data(), header.num_bytes);
+    if (!file.good()) {
+      fprintf(stderr,
+              "Cannot read a shard of checkpoint tensor %d\n",
+              args->tensor_id);
+      return false;
+    }
+    num_copied += copy_checkpoint_box(
+        ndims, header.lo, header.hi, data.data(), lo, hi, ptr, elem_size);
+  }
+  // Saved shards do not overlap, so a complete checkpoint covers every
+  // element exactly once
+  if (num_copied != domain.get_volume()) {
+    fprintf(
+        stderr, "Checkpoint tensor %d is missing shards\n", args->tensor_id);
+    return false;
+  }
+  return true;
+}
+
+bool Checkpoint::flush_task(Task const *task,
+                            std::vector<PhysicalRegion> const &regions,
+                            Context ctx,
+                            Runtime *runtime) {
+  // Each process flushes its own writer, see finish_checkpoint
+  assert(task->index_point[0] == (int)task->current_proc.address_space());
+  return CheckpointWriter::get_writer()->flush();
+}
+
+// A tensor saved in checkpoints: a parameter or one of its optimizer
+// states, which share its partition
+struct CheckpointTensor {
+  std::string name;
+  ParallelTensor tensor, parameter;
+  // Parameters must be in a checkpoint, optimizer states may be missing
+  bool required;
+};
+
+static std::string get_parameter_name(const ParallelTensor p) {
+  Op const *op = p->owner_op;
+  assert(op != NULL);
+  // Unlike op guids, layer guids do not depend on the strategy
+  std::string name = op->layer_guid.is_valid_id()
+                         ? "layer_" + std::to_string(op->layer_guid.id)
+                         : std::string(op->name);
+  for (int i = 0; i < op->numWeights; i++) {
+    if (op->weights[i] == p) {
+      return name + "/weight_" + std::to_string(i);
+    }
+  }
+  return name;
+}
+
+static void get_checkpoint_tensors(FFModel const *model,
+                                   std::vector<CheckpointTensor> &tensors) {
+  SGDOptimizer const *sgd = dynamic_cast<SGDOptimizer *>(model->optimizer);
+  AdamOptimizer const *adam = dynamic_cast<AdamOptimizer *>(model->optimizer);
+  for (ParallelTensor const &p : model->parameters) {
+    std::string name = get_parameter_name(p);
+    tensors.push_back({name, p, p, true});
+    if (sgd != NULL && sgd->v_values.find(p->region) != sgd->v_values.end()) {
+      tensors.push_back(
+          {name + "/momentum", sgd->v_values.at(p->region), p, false});
+    }
+    if (adam != NULL &&
+        adam->v_values.find(p->region) != adam->v_values.end()) {
+      tensors.push_back(
+          {name + "/adam_v", adam->v_values.at(p->region), p, false});
+      tensors.push_back(
+          {name + "/adam_m", adam->m_values.at(p->region), p, false});
+    }
+  }
+}
+
+static void get_shard_args(std::string const &dir,
+                           uint64_t checkpoint_id,
+                           int tensor_id,
+                           const ParallelTensor tensor,
+                           Checkpoint::ShardArgs &args) {
+  assert(dir.size() < MAX_FILENAME);
+  memset(&args, 0, sizeof(args));
+  std::strcpy(args.dir, dir.c_str());
+  args.checkpoint_id = checkpoint_id;
+  args.tensor_id = tensor_id;
+  args.data_type = tensor->data_type;
+  args.num_dims = tensor->num_dims;
+  for (int i = 0; i < tensor->num_dims; i++) {
+    args.is_replica_dim[i] = tensor->dims[i].is_replica_dim;
+  }
+}
+
+static CheckpointTensorInfo get_tensor_info(CheckpointTensor const &t) {
+  CheckpointTensorInfo info;
+  info.name = t.name;
+  info.data_type = t.tensor->data_type;
+  info.ndims = 0;
+  for (int i = 0; i < t.tensor->num_dims; i++) {
+    if (!t.tensor->dims[i].is_replica_dim) {
+      info.dims[info.ndims++] = t.tensor->dims[i].size;
+    }
+  }
+  return info;
+}
+
+void FFModel::save_checkpoint(std::string const &dir) {
+  Context ctx = config.lg_ctx;
+  Runtime *runtime = config.lg_hlr;
+  // At most one checkpoint is written at a time
+  finish_checkpoint();
+  pending_checkpoint = CheckpointManifest();
+  pending_checkpoint.checkpoint_id =
+      std::chrono::system_clock::now().time_since_epoch().count();
+  // Shard files are named by the address space of the writing process;
+  // config.numNodes can differ from it, e.g., with a cached search result
+  pending_checkpoint.num_ranks =
+      Realm::Machine::get_machine().get_address_space_count();
+  pending_checkpoint.scalars["loss_scale"] = loss_scale;
+  pending_checkpoint.scalars["loss_scale_good_steps"] = loss_scale_good_steps;
+  AdamOptimizer const *adam = dynamic_cast<AdamOptimizer *>(optimizer);
+  if (adam != NULL) {
+    pending_checkpoint.scalars["adam_alpha_t"] = adam->alpha_t;
+    pending_checkpoint.scalars["adam_beta1_t"] = adam->beta1_t;
+    pending_checkpoint.scalars["adam_beta2_t"] = adam->beta2_t;
+  }
+  std::vector<CheckpointTensor> tensors;
+  get_checkpoint_tensors(this, tensors);
+  for (size_t i = 0; i < tensors.size(); i++) {
+    CheckpointTensor const &t = tensors[i];
+    assert(pending_checkpoint.find_tensor(t.name) == -1);
+    pending_checkpoint.tensors.push_back(get_tensor_info(t));
+    Checkpoint::ShardArgs args;
+    get_shard_args(dir, pending_checkpoint.checkpoint_id, i, t.tensor, args);
+    // Each shard is saved by a task on the device that owns it
+    ParallelTensor p = t.parameter;
+    LogicalPartition part = runtime->get_logical_partition(
+        ctx, t.tensor->region, p->part.get_index_partition());
+    ArgumentMap argmap;
+    IndexLauncher launcher(CHECKPOINT_SAVE_TASK_ID,
+                           p->parallel_is,
+                           TaskArgument(&args, sizeof(args)),
+                           argmap,
+                           Predicate::TRUE_PRED,
+                           false /*must*/,
+                           0 /*mapper_id*/,
+                           p->machine_view.hash());
+    launcher.add_region_requirement(RegionRequirement(part,
+                                                      0 /*projection id*/,
+                                                      READ_ONLY,
+                                                      EXCLUSIVE,
+                                                      t.tensor->region,
+                                                      MAP_TO_ZC_MEMORY));
+    launcher.add_field(0, FID_DATA);
+    pending_checkpoint_shards.push_back(
+        runtime->execute_index_space(ctx, launcher));
+  }
+  pending_checkpoint_dir = dir;
+}
+
+bool FFModel::finish_checkpoint(void) {
+  if (pending_checkpoint_dir.empty()) {
+    return true;
+  }
+  Context ctx = config.lg_ctx;
+  Runtime *runtime = config.lg_hlr;
+  // Every shard is queued once its task is done; then the writers of all
+  // processes are flushed
+  for (FutureMap &fm : pending_checkpoint_shards) {
+    fm.wait_all_results();
+  }
+  // One point per process, on the first worker of its address space
+  int num_ranks = pending_checkpoint.num_ranks;
+  MachineView view;
+  view.device_type = MachineView::GPU;
+  view.ndims = 1;
+  view.dim[0] = num_ranks;
+  view.stride[0] = num_ranks > 1 ? config.workersPerNode : 1;
+  view.start_device_id = 0;
+  ArgumentMap argmap;
+  Rect<1> task_rect(Point<1>(0), Point<1>(num_ranks - 1));
+  IndexSpaceT<1> task_is = runtime->create_index_space(ctx, task_rect);
+  IndexLauncher launcher(CHECKPOINT_FLUSH_TASK_ID,
+                         task_is,
+                         TaskArgument(NULL, 0),
+                         argmap,
+                         Predicate::TRUE_PRED,
+                         false /*must*/,
+                         0 /*mapper_id*/,
+                         view.hash());
+  FutureMap fm = runtime->execute_index_space(ctx, launcher);
+  fm.wait_all_results();
+  bool ok = true;
+  for (PointInRectIterator<1> it(task_rect); it(); it++) {
+    ok = fm.get_result<bool>(*it) && ok;
+  }
+  runtime->destroy_index_space(ctx, task_is);
+  // The checkpoint only replaces the previous one in the directory once
+  // all its shards are on disk
+  std::string const &dir = pending_checkpoint_dir;
+  std::string manifest_path = dir + "/manifest";
+  CheckpointManifest previous;
+  bool has_previous = previous.read(manifest_path);
+  ok = ok && pending_checkpoint.write(manifest_path);
+  if (ok) {
+    if (has_previous &&
+        previous.checkpoint_id != pending_checkpoint.checkpoint_id) {
+      for (int r = 0; r < previous.num_ranks; r++) {
+        remove(get_checkpoint_shard_path(dir, previous.checkpoint_id, r)
+                   .c_str());
+      }
+    }
+  } else {
+    fprintf(stderr, "Warning: cannot write checkpoint %s\n", dir.c_str());
+  }
+  pending_checkpoint_dir.clear();
+  pending_checkpoint_shards.clear();
+  return ok;
+}
+
+bool FFModel::load_checkpoint(std::string const &dir) {
+  Context ctx = config.lg_ctx;
+  Runtime *runtime = config.lg_hlr;
+  finish_checkpoint();
+  CheckpointManifest manifest;
+  if (!manifest.read(dir + "/manifest")) {
+    fprintf(stderr, "Cannot read the manifest of checkpoint %s\n", dir.c_str());
+    return false;
+  }
+  std::vector<CheckpointShardLocation> shards;
+  for (int r = 0; r < manifest.num_ranks; r++) {
+    read_checkpoint_shards(dir, manifest.checkpoint_id, r, shards);
+  }
+  std::vector<CheckpointTensor> tensors;
+  get_checkpoint_tensors(this, tensors);
+  // Check every tensor before overwriting any
+  std::vector<int> tensor_ids;
+  for (CheckpointTensor const &t : tensors) {
+    int id = manifest.find_tensor(t.name);
+    if (id == -1) {
+      fprintf(stderr,
+              "%s: checkpoint %s has no tensor %s\n",
+              t.required ? "Error" : "Warning",
+              dir.c_str(),
+              t.name.c_str());
+      if (t.required) {
+        return false;
+      }
+    } else {
+      CheckpointTensorInfo info = get_tensor_info(t);
+      CheckpointTensorInfo const &saved = manifest.tensors[id];
+      bool same_shape = info.data_type == saved.data_type &&
+                        info.ndims == saved.ndims;
+      for (int i = 0; same_shape && i < info.ndims; i++) {
+        same_shape = info.dims[i] == saved.dims[i];
+      }
+      if (!same_shape) {
+        fprintf(stderr,
+                "Checkpoint tensor %s does not match the model\n",
+                t.name.c_str());
+        return false;
+      }
+    }
+    tensor_ids.push_back(id);
+  }
+  std::vector<std::pair<IndexSpace, FutureMap>> loads;
+  for (size_t i = 0; i < tensors.size(); i++) {
+    if (tensor_ids[i] == -1) {
+      continue;
+    }
+    CheckpointTensor const &t = tensors[i];
+    std::vector<CheckpointShardLocation> tensor_shards;
+    for (CheckpointShardLocation const &shard : shards) {
+      if (shard.header.tensor_id == tensor_ids[i]) {
+        tensor_shards.push_back(shard);
+      }
+    }
+    // The shards may be partitioned differently from the tensor, so every
+    // task gets all of them and copies the parts it owns
+    std::vector<char> buffer(sizeof(Checkpoint::ShardArgs) +
+                             tensor_shards.size() *
+                                 sizeof(CheckpointShardLocation));
+    Checkpoint::ShardArgs *args = (Checkpoint::ShardArgs *)buffer.data();
+    get_shard_args(dir, manifest.checkpoint_id, tensor_ids[i], t.tensor, *args);
+    args->num_shards = tensor_shards.size();
+    memcpy(args + 1,
+           tensor_shards.data(),
+           tensor_shards.size() * sizeof(CheckpointShardLocation));
+    ParallelTensor p = t.parameter;
+    LogicalPartition part = runtime->get_logical_partition(
+        ctx, t.tensor->region, p->part.get_index_partition());
+    ArgumentMap argmap;
+    IndexLauncher launcher(CHECKPOINT_LOAD_TASK_ID,
+                           p->parallel_is,
+                           TaskArgument(buffer.data(), buffer.size()),
+                           argmap,
+                           Predicate::TRUE_PRED,
+                           false /*must*/,
+                           0 /*mapper_id*/,
+                           p->machine_view.hash());
+    launcher.add_region_requirement(RegionRequirement(part,
+                                                      0 /*projection id*/,
+                                                      WRITE_ONLY,
+                                                      EXCLUSIVE,
+                                                      t.tensor->region,
+                                                      MAP_TO_ZC_MEMORY));
+    launcher.add_field(0, FID_DATA);
+    loads.push_back(std::make_pair(
+        p->parallel_is, runtime->execute_index_space(ctx, launcher)));
+  }
+  bool ok = true;
+  for (auto &load : loads) {
+    Domain domain = runtime->get_index_space_domain(ctx, load.first);
+    for (Domain::DomainPointIterator it(domain); it; it++) {
+      ok = load.second.get_result<bool>(*it) && ok;
+    }
+  }
+  // The loads overwrote the tensors, so copies derived from them such as
+  // packed weights are stale. A failed load may still have written some
+  // shards
+  for (size_t i = 0; i < tensors.size(); i++) {
+    if (tensor_ids[i] != -1) {
+      tensors[i].tensor->version++;
+    }
+  }
+  if (!ok) {
+    fprintf(stderr, "Cannot load checkpoint %s\n", dir.c_str());
+    return false;
+  }
+  std::map<std::string, double> const &scalars = manifest.scalars;
+  if (scalars.find("loss_scale") != scalars.end()) {
+    loss_scale = scalars.at("loss_scale");
+    loss_scale_good_steps = scalars.at("loss_scale_good_steps");
+  }
+  AdamOptimizer *adam = dynamic_cast<AdamOptimizer *>(optimizer);
+  if (adam != NULL && scalars.find("adam_alpha_t") != scalars.end()) {
+    adam->alpha_t = scalars.at("adam_alpha_t");
+    adam->beta1_t = scalars.at("adam_beta1_t");
+    adam->beta2_t = scalars.at("adam_beta2_t");
+  }
+  return true;
+}
+
+}; // namespace FlexFlow
@@ -0,0 +1,196 @@
+/* Copyright 2023 CMU, Facebook, LANL, MIT, NVIDIA, and Stanford (alphabetical)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flexflow/compile_cache.h"
+#include "flexflow/model.h"
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <unistd.h>
+
+namespace FlexFlow {
+
+using namespace Legion;
+
+// "FFCC"
+static uint32_t const COMPILE_CACHE_MAGIC = 0x46464343;
+
+uint32_t const CompileCache::FORMAT_VERSION;
+
+void CompileCacheKey::append(std::string const &value) {
+  append(value.size());
+  bytes.append(value);
+}
+
+void CompileCacheKey::append_file(std::string const &path) {
+  append(path);
+  std::ifstream file(path, std::ios::binary);
+  if (file.good()) {
+    std::stringstream contents;
+    contents << file.rdbuf();
+    append(contents.str());
+  }
+}
+
+size_t CompileCacheKey::hash(void) const {
+  return std::hash<std::string>()(bytes);
+}
+
+CompileCache::CompileCache(std::string const &_dir) : dir(_dir) {
+  assert(!dir.empty());
+}
+
+std::string CompileCache::get_path(CompileCacheKey const &key) const {
+  char name[32];
+  snprintf(name, sizeof(name), "%016zx.ffcc", key.hash());
+  return dir + "/" + name;
+}
+
+template <typename T>
+static bool read_value(std::ifstream &file, T &value) {
+  file.read(reinterpret_cast<char *>(&value), sizeof(T));
+  return file.good();
+}
+
+template <typename T>
+static void write_value(std::ofstream &file, T const &value) {
+  file.write(reinterpret_cast<char const *>(&value), sizeof(T));
+}
+
+bool CompileCache::load(CompileCacheKey const &key,
+                        std::vector<char> &data) const {
+  std::ifstream file(get_path(key), std::ios::binary);
+  if (!file.good()) {
+    return false;
+  }
+  uint32_t magic, version;
+  uint64_t key_size, data_size, checksum;
+  if (!read_value(file, magic) || magic != COMPILE_CACHE_MAGIC) {
+    return false;
+  }
+  if (!read_value(file, version) || version != FORMAT_VERSION) {
+    return false;
+  }
+  if (!read_value(file, key_size) || key_size != key.bytes.size()) {
+    return false;
+  }
+  std::string stored_key(key_size, '\0');
+  file.read(&stored_key[0], key_size);
+  if (!file.good() || stored_key != key.bytes) {
+    return false;
+  }
+  if (!read_value(file, data_size)) {
+    return false;
+  }
+  // The result and its checksum end the entry; a corrupt size must not
+  // allocate more than the file holds
+  std::streampos data_start = file.tellg();
+  file.seekg(0, std::ios::end);
+  uint64_t remaining = (uint64_t)(file.tellg() - data_start);
+  file.seekg(data_start);
+  if (!file.good() || remaining < sizeof(checksum) ||
+      data_size != remaining - sizeof(checksum)) {
+    return false;
+  }
+  data.resize(data_size);
+  file.read(data.data(), data_size);
+  if (!read_value(file, checksum)) {
+    return false;
+  }
+  std::string contents(data.begin(), data.end());
+  return checksum == std::hash<std::string>()(contents);
+}
+
+bool CompileCache::store(CompileCacheKey const &key,
+                         std::vector<char> const &data) const {
+  std::string path = get_path(key);
+  std::string tmp_path = path + ".tmp." + std::to_string(getpid());
+  {
+    std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!file.good()) {
+      return false;
+    }
+    write_value(file, COMPILE_CACHE_MAGIC);
+    write_value(file, FORMAT_VERSION);
+    write_value(file, (uint64_t)key.bytes.size());
+    file.write(key.bytes.data(), key.bytes.size());
+    write_value(file, (uint64_t)data.size());
+    file.write(data.data(), data.size());
+    std::string contents(data.begin(), data.end());
+    write_value(file, (uint64_t)std::hash<std::string>()(contents));
+    if (!file.good()) {
+      file.close();
+      remove(tmp_path.c_str());
+      return false;
+    }
+  }
+  // rename is atomic, so readers see either no entry or the whole one
+  if (rename(tmp_path.c_str(), path.c_str()) != 0) {
+    remove(tmp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+void FFModel::get_compile_cache_key(CompileCacheKey &key) const {
+  key.append(CompileCache::FORMAT_VERSION);
+  // Layer graph; the guids are part of the key since the cached graph
+  // refers to layers and input tensors by guid
+  key.append(layers.size());
+  for (Layer const *layer : layers) {
+    layer->append_to_key(key);
+  }
+  key.append(config.batchSize);
+  // Search flags
+  key.append(config.computationMode);
+  key.append(config.search_budget);
+  key.append(config.search_alpha);
+  key.append(config.search_overlap_backward_update);
+  key.append(config.only_data_parallel);
+  key.append(config.enable_sample_parallel);
+  key.append(config.enable_parameter_parallel);
+  key.append(config.enable_attribute_parallel);
+  key.append(config.allow_tensor_op_math_conversion);
+  key.append(config.perform_fusion);
+  key.append(config.enable_propagation);
+  key.append(config.base_optimize_threshold);
+  key.append(config.simulator_segment_size);
+  key.append(config.simulator_max_num_segments);
+  key.append(config.enable_mixed_precision);
+  key.append(config.substitution_json_path.has_value());
+  if (config.substitution_json_path.has_value()) {
+    key.append_file(config.substitution_json_path.value());
+  }
+  // The statistics change between compiles, so only their use is keyed
+  key.append(!config.substitution_stats_dir.empty());
+  key.append(config.search_egraph_node_budget);
+  // Machine
+  key.append(config.numNodes);
+  key.append(config.workersPerNode);
+  key.append(config.cpusPerNode);
+  key.append(config.search_num_nodes.value_or(-1));
+  key.append(config.search_num_workers.value_or(-1));
+  key.append(config.machine_model_version);
+  if (config.machine_model_version == 1) {
+    key.append_file(config.machine_model_file);
+  }
+  Memory worker_mem = Machine::MemoryQuery(Machine::get_machine())
+                          .only_kind(WORKER_MEM_KIND)
+                          .first();
+  key.append(worker_mem.capacity());
+}
+
+}; // namespace FlexFlow
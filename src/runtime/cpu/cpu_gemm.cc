@@ -0,0 +1,636 @@
+/* Copyright 2023 CMU, Facebook, LANL, MIT, NVIDIA, and Stanford (alphabetical)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flexflow/utils/cpu_gemm.h"
+#include "flexflow/utils/cpu_thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+#if defined(FF_USE_AVX2) && defined(__GNUC__) &&                               \
+    (defined(__x86_64__) || defined(__i386__))
+#define FF_CPU_GEMM_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Cache blocking in the style of BLIS/GotoBLAS: a KC x NC panel of op(B)
+// is packed once per thread and reused across MC x KC panels of op(A),
+// which the micro-kernel walks MR rows and NR columns at a time
+int const GEMM_KC = 256;
+int const GEMM_MC_PANELS = 8;
+// multiple of every micro-kernel's NR
+int const GEMM_NC = 384;
+// GEMMs below this many flops are not worth waking up extra threads
+double const GEMM_PARALLEL_FLOPS = 4.0e6;
+
+// Computes an MR x NR tile of op(A) * op(B) over kc steps from packed
+// panels, and stores it column-major into tile
+typedef void (*MicroKernel)(int kc,
+                            float const *a,
+                            float const *b,
+                            float *tile);
+
+struct GemmKernel {
+  int mr, nr;
+  MicroKernel fn;
+};
+
+template <int MR, int NR>
+void sgemm_kernel_generic(int kc,
+                          float const *a,
+                          float const *b,
+                          float *tile) {
+  float acc[NR][MR] = {};
+  for (int p = 0; p < kc; p++) {
+    for (int j = 0; j < NR; j++) {
+      for (int i = 0; i < MR; i++) {
+        acc[j][i] += a[i] * b[j];
+      }
+    }
+    a += MR;
+    b += NR;
+  }
+  for (int j = 0; j < NR; j++) {
+    for (int i = 0; i < MR; i++) {
+      tile[j * MR + i] = acc[j][i];
+    }
+  }
+}
+
+#ifdef FF_CPU_GEMM_X86
+// 16 x 6 tile: 12 ymm accumulators, two A vectors and one broadcast
+__attribute__((target("avx2,fma"))) void
+    sgemm_kernel_avx2(int kc, float const *a, float const *b, float *tile) {
+  __m256 c[6][2];
+#pragma GCC unroll 6
+  for (int j = 0; j < 6; j++) {
+    c[j][0] = _mm256_setzero_ps();
+    c[j][1] = _mm256_setzero_ps();
+  }
+  for (int p = 0; p < kc; p++) {
+    __m256 a0 = _mm256_loadu_ps(a);
+    __m256 a1 = _mm256_loadu_ps(a + 8);
+#pragma GCC unroll 6
+    for (int j = 0; j < 6; j++) {
+      __m256 bj = _mm256_broadcast_ss(b + j);
+      c[j][0] = _mm256_fmadd_ps(a0, bj, c[j][0]);
+      c[j][1] = _mm256_fmadd_ps(a1, bj, c[j][1]);
+    }
+    a += 16;
+    b += 6;
+  }
+#pragma GCC unroll 6
+  for (int j = 0; j < 6; j++) {
+    _mm256_storeu_ps(tile + j * 16, c[j][0]);
+    _mm256_storeu_ps(tile + j * 16 + 8, c[j][1]);
+  }
+}
+
+// 32 x 12 tile: 24 zmm accumulators, two A vectors and one broadcast
+__attribute__((target("avx512f"))) void
+    sgemm_kernel_avx512(int kc, float const *a, float const *b, float *tile) {
+  __m512 c[12][2];
+#pragma GCC unroll 12
+  for (int j = 0; j < 12; j++) {
+    c[j][0] = _mm512_setzero_ps();
+    c[j][1] = _mm512_setzero_ps();
+  }
+  for (int p = 0; p < kc; p++) {
+    __m512 a0 = _mm512_loadu_ps(a);
+    __m512 a1 = _mm512_loadu_ps(a + 16);
+#pragma GCC unroll 12
+    for (int j = 0; j < 12; j++) {
+      __m512 bj = _mm512_set1_ps(b[j]);
+      c[j][0] = _mm512_fmadd_ps(a0, bj, c[j][0]);
+      c[j][1] = _mm512_fmadd_ps(a1, bj, c[j][1]);
+    }
+    a += 32;
+    b += 12;
+  }
+#pragma GCC unroll 12
+  for (int j = 0; j < 12; j++) {
+    _mm512_storeu_ps(tile + j * 32, c[j][0]);
+    _mm512_storeu_ps(tile + j * 32 + 16, c[j][1]);
+  }
+}
+#endif
+
+GemmKernel get_kernel(CpuGemmIsa isa) {
+  switch (isa) {
+#ifdef FF_CPU_GEMM_X86
+    case CPU_GEMM_ISA_AVX512:
+      return {32, 12, sgemm_kernel_avx512};
+    case CPU_GEMM_ISA_AVX2:
+      return {16, 6, sgemm_kernel_avx2};
+#endif
+    default:
+      return {8, 4, sgemm_kernel_generic<8, 4>};
+  }
+}
+
+std::atomic<int> gemm_num_threads(1);
+std::atomic<int> gemm_isa(-1);
+
+// Copies the mc x kc block of op(A) at (i0, p0) into MR-row panels, each
+// stored as kc columns of MR contiguous values; short panels are zero padded
+void pack_a(bool trans_a,
+            float const *A,
+            int lda,
+            int i0,
+            int mc,
+            int p0,
+            int kc,
+            int mr,
+            float *buf) {
+  for (int ir = 0; ir < mc; ir += mr) {
+    int rows = std::min(mr, mc - ir);
+    float *dst = buf + (size_t)ir * kc;
+    if (trans_a) {
+      for (int i = 0; i < rows; i++) {
+        float const *src = A + (size_t)(i0 + ir + i) * lda + p0;
+        for (int p = 0; p < kc; p++) {
+          dst[p * mr + i] = src[p];
+        }
+      }
+    } else {
+      for (int p = 0; p < kc; p++) {
+        float const *src = A + (size_t)(p0 + p) * lda + i0 + ir;
+        for (int i = 0; i < rows; i++) {
+          dst[p * mr + i] = src[i];
+        }
+      }
+    }
+    for (int i = rows; i < mr; i++) {
+      for (int p = 0; p < kc; p++) {
+        dst[p * mr + i] = 0.0f;
+      }
+    }
+  }
+}
+
+// Copies the kc x nc block of op(B) at (p0, j0) into NR-column panels, each
+// stored as kc rows of NR contiguous values; short panels are zero padded
+void pack_b(bool trans_b,
+            float const *B,
+            int ldb,
+            int p0,
+            int kc,
+            int j0,
+            int nc,
+            int nr,
+            float *buf) {
+  for (int jr = 0; jr < nc; jr += nr) {
+    int cols = std::min(nr, nc - jr);
+    float *dst = buf + (size_t)jr * kc;
+    if (trans_b) {
+      for (int p = 0; p < kc; p++) {
+        float const *src = B + (size_t)(p0 + p) * ldb + j0 + jr;
+        for (int j = 0; j < cols; j++) {
+          dst[p * nr + j] = src[j];
+        }
+      }
+    } else {
+      for (int j = 0; j < cols; j++) {
+        float const *src = B + (size_t)(j0 + jr + j) * ldb + p0;
+        for (int p = 0; p < kc; p++) {
+          dst[p * nr + j] = src[p];
+        }
+      }
+    }
+    for (int j = cols; j < nr; j++) {
+      for (int p = 0; p < kc; p++) {
+        dst[p * nr + j] = 0.0f;
+      }
+    }
+  }
+}
+
+// Adds bias and applies the activation to one column of C
+void apply_epilogue(float *c, int rows, float const *bias, ActiMode mode) {
+  if (bias != NULL) {
+    for (int i = 0; i < rows; i++) {
+      c[i] += bias[i];
+    }
+  }
+  switch (mode) {
+    case AC_MODE_NONE:
+      break;
+    case AC_MODE_RELU:
+      for (int i = 0; i < rows; i++) {
+        c[i] = c[i] > 0.0f ? c[i] : 0.0f;
+      }
+      break;
+    case AC_MODE_SIGMOID:
+      for (int i = 0; i < rows; i++) {
+        c[i] = 1.0f / (1.0f + expf(-c[i]));
+      }
+      break;
+    case AC_MODE_TANH:
+      for (int i = 0; i < rows; i++) {
+        c[i] = tanhf(c[i]);
+      }
+      break;
+    case AC_MODE_GELU:
+      for (int i = 0; i < rows; i++) {
+        c[i] = c[i] * 0.5f * erfcf(-c[i] * (float)M_SQRT1_2);
+      }
+      break;
+    default:
+      assert(false && "Unsupported activation mode");
+  }
+}
+
+// Merges an accumulated tile into C. The first K block applies alpha and
+// beta (C is not read when beta is zero), later blocks accumulate, and the
+// last one runs the epilogue
+void store_tile(float const *tile,
+                int mr,
+                int rows,
+                int cols,
+                float alpha,
+                float beta,
+                bool first,
+                bool last,
+                float *C,
+                int ldc,
+                float const *bias,
+                ActiMode activation) {
+  for (int j = 0; j < cols; j++) {
+    float const *t = tile + j * mr;
+    float *c = C + (size_t)j * ldc;
+    if (!first) {
+      for (int i = 0; i < rows; i++) {
+        c[i] += alpha * t[i];
+      }
+    } else if (beta == 0.0f) {
+      for (int i = 0; i < rows; i++) {
+        c[i] = alpha * t[i];
+      }
+    } else {
+      for (int i = 0; i < rows; i++) {
+        c[i] = alpha * t[i] + beta * c[i];
+      }
+    }
+    if (last) {
+      apply_epilogue(c, rows, bias, activation);
+    }
+  }
+}
+
+struct GemmArgs {
+  bool trans_a, trans_b;
+  int m, n, k;
+  float alpha, beta;
+  float const *A, *B;
+  int lda, ldb, ldc;
+  long long int stride_a, stride_b, stride_c;
+  float *C;
+  float const *bias;
+  ActiMode activation;
+  GemmKernel kernel;
+  // op(A) packed by cpu_gemm_pack_a for all m rows, or NULL
+  float const *packed_a;
+  int batch_count;
+  int mc, nc;
+  // work is split into (batch, column block, row range) items
+  int num_col_blocks, rows_per_part, row_parts;
+};
+
+// Computes rows [row_begin, row_end) of one column block of one batch
+void gemm_block(GemmArgs const &g,
+                int batch,
+                int col_block,
+                int row_begin,
+                int row_end,
+                std::vector<float> &a_buf,
+                std::vector<float> &b_buf) {
+  int const mr = g.kernel.mr, nr = g.kernel.nr;
+  float const *A = g.A + batch * g.stride_a;
+  float const *B = g.B + batch * g.stride_b;
+  float *C = g.C + batch * g.stride_c;
+  int j0 = col_block * g.nc;
+  int nc = std::min(g.nc, g.n - j0);
+  float tile[32 * 12];
+  for (int p0 = 0; p0 < g.k; p0 += GEMM_KC) {
+    int kc = std::min(GEMM_KC, g.k - p0);
+    bool first = (p0 == 0), last = (p0 + kc == g.k);
+    pack_b(g.trans_b, B, g.ldb, p0, kc, j0, nc, nr, b_buf.data());
+    for (int i0 = row_begin; i0 < row_end; i0 += g.mc) {
+      int mc = std::min(g.mc, row_end - i0);
+      float const *a_panels = a_buf.data();
+      if (g.packed_a != NULL) {
+        // each K block holds the panels of all rows, padded to MR
+        size_t padded_m = (size_t)(g.m + mr - 1) / mr * mr;
+        a_panels = g.packed_a + (size_t)p0 * padded_m + (size_t)i0 * kc;
+      } else {
+        pack_a(g.trans_a, A, g.lda, i0, mc, p0, kc, mr, a_buf.data());
+      }
+      for (int jr = 0; jr < nc; jr += nr) {
+        for (int ir = 0; ir < mc; ir += mr) {
+          g.kernel.fn(kc,
+                      a_panels + (size_t)ir * kc,
+                      b_buf.data() + (size_t)jr * kc,
+                      tile);
+          store_tile(tile,
+                     mr,
+                     std::min(mr, mc - ir),
+                     std::min(nr, nc - jr),
+                     g.alpha,
+                     g.beta,
+                     first,
+                     last,
+                     C + (size_t)(j0 + jr) * g.ldc + i0 + ir,
+                     g.ldc,
+                     g.bias == NULL ? NULL : g.bias + i0 + ir,
+                     g.activation);
+        }
+      }
+    }
+  }
+}
+
+void gemm_worker(GemmArgs const *g, int thread_id, int num_threads) {
+  // Legion CPU processors and the pool workers are long-lived threads, so
+  // packing buffers are reused across calls
+  thread_local std::vector<float> a_buf, b_buf;
+  size_t kc = std::min(GEMM_KC, g->k);
+  if (g->packed_a == NULL && a_buf.size() < (size_t)g->mc * kc) {
+    a_buf.resize((size_t)g->mc * kc);
+  }
+  if (b_buf.size() < (size_t)g->nc * kc) {
+    b_buf.resize((size_t)g->nc * kc);
+  }
+  long long int num_items =
+      (long long int)g->batch_count * g->num_col_blocks * g->row_parts;
+  for (long long int item = thread_id; item < num_items;
+       item += num_threads) {
+    int part = item % g->row_parts;
+    int col_block = (item / g->row_parts) % g->num_col_blocks;
+    int batch = item / ((long long int)g->row_parts * g->num_col_blocks);
+    int row_begin = part * g->rows_per_part;
+    int row_end = std::min(g->m, row_begin + g->rows_per_part);
+    if (row_begin < row_end) {
+      gemm_block(*g, batch, col_block, row_begin, row_end, a_buf, b_buf);
+    }
+  }
+}
+
+// Sizes the blocks of g and runs it over the GEMM threads
+void run_gemm(GemmArgs &g) {
+  int const m = g.m, n = g.n, k = g.k, batch_count = g.batch_count;
+  int const mr = g.kernel.mr, nr = g.kernel.nr;
+  assert(GEMM_NC % nr == 0);
+  // shrink the blocks for small problems to keep packing buffers small
+  g.mc = std::min(GEMM_MC_PANELS * mr, (m + mr - 1) / mr * mr);
+  g.nc = std::min(GEMM_NC, (n + nr - 1) / nr * nr);
+  g.num_col_blocks = (n + g.nc - 1) / g.nc;
+  int num_row_blocks = (m + g.mc - 1) / g.mc;
+
+  int num_threads = cpu_gemm_get_num_threads();
+  double flops = 2.0 * m * n * k * batch_count;
+  if (flops < GEMM_PARALLEL_FLOPS) {
+    num_threads = 1;
+  }
+  // Split rows only when batches and column blocks cannot keep every
+  // thread busy, so each thread reuses its packed B panel as long as possible
+  long long int col_items = (long long int)batch_count * g.num_col_blocks;
+  g.row_parts = 1;
+  if (col_items < num_threads) {
+    g.row_parts = std::min((long long int)num_row_blocks,
+                           (num_threads + col_items - 1) / col_items);
+  }
+  g.rows_per_part = (num_row_blocks + g.row_parts - 1) / g.row_parts * g.mc;
+  num_threads = std::min((long long int)num_threads, col_items * g.row_parts);
+
+  CpuThreadPool::get().run(
+      num_threads, [&](int t) { gemm_worker(&g, t, num_threads); });
+}
+
+} // namespace
+
+void cpu_gemm(bool trans_a,
+              bool trans_b,
+              int m,
+              int n,
+              int k,
+              float alpha,
+              float const *A,
+              int lda,
+              long long int stride_a,
+              float const *B,
+              int ldb,
+              long long int stride_b,
+              float beta,
+              float *C,
+              int ldc,
+              long long int stride_c,
+              int batch_count,
+              float const *bias,
+              ActiMode activation) {
+  assert(m >= 0 && n >= 0 && k >= 0 && batch_count >= 0);
+  if (m == 0 || n == 0 || batch_count == 0) {
+    return;
+  }
+  if (k == 0 || alpha == 0.0f) {
+    // op(A) * op(B) does not contribute, only scale C and run the epilogue
+    for (int b = 0; b < batch_count; b++) {
+      for (int j = 0; j < n; j++) {
+        float *c = C + b * stride_c + (size_t)j * ldc;
+        for (int i = 0; i < m; i++) {
+          c[i] = beta == 0.0f ? 0.0f : beta * c[i];
+        }
+        apply_epilogue(c, m, bias, activation);
+      }
+    }
+    return;
+  }
+  GemmArgs g;
+  g.trans_a = trans_a;
+  g.trans_b = trans_b;
+  g.m = m;
+  g.n = n;
+  g.k = k;
+  g.alpha = alpha;
+  g.beta = beta;
+  g.A = A;
+  g.B = B;
+  g.C = C;
+  g.lda = lda;
+  g.ldb = ldb;
+  g.ldc = ldc;
+  g.stride_a = stride_a;
+  g.stride_b = stride_b;
+  g.stride_c = stride_c;
+  g.batch_count = batch_count;
+  g.bias = bias;
+  g.activation = activation;
+  g.kernel = get_kernel(cpu_gemm_get_isa());
+  g.packed_a = NULL;
+  run_gemm(g);
+}
+
+void cpu_gemm_pack_a(bool trans_a,
+                     int m,
+                     int k,
+                     float const *A,
+                     int lda,
+                     CpuGemmPackedA &packed) {
+  assert(m > 0 && k > 0);
+  packed.m = m;
+  packed.k = k;
+  packed.isa = cpu_gemm_get_isa();
+  int const mr = get_kernel(packed.isa).mr;
+  int padded_m = (m + mr - 1) / mr * mr;
+  packed.panels.resize((size_t)padded_m * k);
+  // same layout as the per-call packing, one K block after the other
+  for (int p0 = 0; p0 < k; p0 += GEMM_KC) {
+    int kc = std::min(GEMM_KC, k - p0);
+    pack_a(trans_a,
+           A,
+           lda,
+           0,
+           m,
+           p0,
+           kc,
+           mr,
+           packed.panels.data() + (size_t)p0 * padded_m);
+  }
+}
+
+void cpu_gemm_packed(CpuGemmPackedA const &packed,
+                     bool trans_b,
+                     int n,
+                     float alpha,
+                     float const *B,
+                     int ldb,
+                     float beta,
+                     float *C,
+                     int ldc,
+                     float const *bias,
+                     ActiMode activation) {
+  assert(!packed.empty());
+  assert(n >= 0);
+  if (n == 0) {
+    return;
+  }
+  if (alpha == 0.0f) {
+    // A is not read
+    cpu_gemm(false,
+             trans_b,
+             packed.m,
+             n,
+             packed.k,
+             alpha,
+             NULL,
+             packed.m,
+             0,
+             B,
+             ldb,
+             0,
+             beta,
+             C,
+             ldc,
+             0,
+             1,
+             bias,
+             activation);
+    return;
+  }
+  GemmArgs g;
+  g.trans_a = false;
+  g.trans_b = trans_b;
+  g.m = packed.m;
+  g.n = n;
+  g.k = packed.k;
+  g.alpha = alpha;
+  g.beta = beta;
+  g.A = NULL;
+  g.B = B;
+  g.C = C;
+  g.lda = 0;
+  g.ldb = ldb;
+  g.ldc = ldc;
+  g.stride_a = 0;
+  g.stride_b = 0;
+  g.stride_c = 0;
+  g.batch_count = 1;
+  g.bias = bias;
+  g.activation = activation;
+  // the panels are laid out for the kernel selected when they were packed
+  g.kernel = get_kernel(packed.isa);
+  g.packed_a = packed.panels.data();
+  run_gemm(g);
+}
+
+void cpu_gemm_set_num_threads(int num_threads) {
+  assert(num_threads > 0);
+  gemm_num_threads.store(num_threads);
+}
+
+int cpu_gemm_get_num_threads(void) {
+  return gemm_num_threads.load();
+}
+
+bool cpu_gemm_isa_supported(CpuGemmIsa isa) {
+  switch (isa) {
+    case CPU_GEMM_ISA_GENERIC:
+      return true;
+#ifdef FF_CPU_GEMM_X86
+    case CPU_GEMM_ISA_AVX2:
+      return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case CPU_GEMM_ISA_AVX512:
+      return __builtin_cpu_supports("avx512f");
+#endif
+    default:
+      return false;
+  }
+}
+
+CpuGemmIsa cpu_gemm_get_isa(void) {
+  int isa = gemm_isa.load();
+  if (isa < 0) {
+    // pick the widest micro-kernel the host supports
+    isa = CPU_GEMM_ISA_GENERIC;
+    if (cpu_gemm_isa_supported(CPU_GEMM_ISA_AVX512)) {
+      isa = CPU_GEMM_ISA_AVX512;
+    } else if (cpu_gemm_isa_supported(CPU_GEMM_ISA_AVX2)) {
+      isa = CPU_GEMM_ISA_AVX2;
+    }
+    gemm_isa.store(isa);
+  }
+  return (CpuGemmIsa)isa;
+}
+
+void cpu_gemm_set_isa(CpuGemmIsa isa) {
+  assert(cpu_gemm_isa_supported(isa));
+  gemm_isa.store(isa);
+}
+
+char const *cpu_gemm_isa_name(CpuGemmIsa isa) {
+  switch (isa) {
+    case CPU_GEMM_ISA_GENERIC:
+      return "generic";
+    case CPU_GEMM_ISA_AVX2:
+      return "avx2";
+    case CPU_GEMM_ISA_AVX512:
+      return "avx512";
+    default:
+      return "unknown";
+  }
+}
@@ -0,0 +1,290 @@
+#include "flexflow/utils/cpu_helper.h"
+#include "flexflow/utils/cpu_gemm.h"
+#include "flexflow/model.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+
+using Legion::coord_t;
+
+namespace FlexFlow {
+
+int get_legion_stream(ffStream_t *stream) {
+  // CPU kernels have no stream, they complete before returning
+  *stream = nullptr;
+  return 0;
+}
+
+}; // namespace FlexFlow
+
+void cpu_sgemm(bool trans_a,
+               bool trans_b,
+               int m,
+               int n,
+               int k,
+               float alpha,
+               float const *A,
+               int lda,
+               float const *B,
+               int ldb,
+               float beta,
+               float *C,
+               int ldc) {
+  cpu_gemm(trans_a,
+           trans_b,
+           m,
+           n,
+           k,
+           alpha,
+           A,
+           lda,
+           0,
+           B,
+           ldb,
+           0,
+           beta,
+           C,
+           ldc,
+           0,
+           1,
+           NULL,
+           AC_MODE_NONE);
+}
+
+void cpu_sgemm_strided_batched(bool trans_a,
+                               bool trans_b,
+                               int m,
+                               int n,
+                               int k,
+                               float alpha,
+                               float const *A,
+                               int lda,
+                               long long int stride_a,
+                               float const *B,
+                               int ldb,
+                               long long int stride_b,
+                               float beta,
+                               float *C,
+                               int ldc,
+                               long long int stride_c,
+                               int batch_count) {
+  cpu_gemm(trans_a,
+           trans_b,
+           m,
+           n,
+           k,
+           alpha,
+           A,
+           lda,
+           stride_a,
+           B,
+           ldb,
+           stride_b,
+           beta,
+           C,
+           ldc,
+           stride_c,
+           batch_count,
+           NULL,
+           AC_MODE_NONE);
+}
+
+void cpu_activation_forward(ActiMode mode, float *ptr, size_t size) {
+  switch (mode) {
+    case AC_MODE_NONE:
+      break;
+    case AC_MODE_RELU: {
+      CPU_KERNEL_LOOP(i, (coord_t)size) {
+        ptr[i] = ptr[i] > 0.0f ? ptr[i] : 0.0f;
+      }
+      break;
+    }
+    case AC_MODE_SIGMOID: {
+      CPU_KERNEL_LOOP(i, (coord_t)size) {
+        ptr[i] = 1.0f / (1.0f + expf(-ptr[i]));
+      }
+      break;
+    }
+    case AC_MODE_TANH: {
+      CPU_KERNEL_LOOP(i, (coord_t)size) {
+        ptr[i] = tanhf(ptr[i]);
+      }
+      break;
+    }
+    case AC_MODE_GELU: {
+      CPU_KERNEL_LOOP(i, (coord_t)size) {
+        ptr[i] = ptr[i] * 0.5f * erfcf(-ptr[i] * (float)M_SQRT1_2);
+      }
+      break;
+    }
+    default:
+      assert(false && "Unsupported activation mode");
+  }
+}
+
+void cpu_activation_backward(ActiMode mode,
+                             float *grad_ptr,
+                             float const *output_ptr,
+                             size_t size) {
+  switch (mode) {
+    case AC_MODE_NONE:
+      break;
+    case AC_MODE_RELU: {
+      CPU_KERNEL_LOOP(i, (coord_t)size) {
+        grad_ptr[i] = output_ptr[i] > 0.0f ? grad_ptr[i] : 0.0f;
+      }
+      break;
+    }
+    case AC_MODE_SIGMOID: {
+      CPU_KERNEL_LOOP(i, (coord_t)size) {
+        grad_ptr[i] *= output_ptr[i] * (1.0f - output_ptr[i]);
+      }
+      break;
+    }
+    case AC_MODE_TANH: {
+      CPU_KERNEL_LOOP(i, (coord_t)size) {
+        grad_ptr[i] *= 1.0f - output_ptr[i] * output_ptr[i];
+      }
+      break;
+    }
+    default:
+      // GELU cannot be differentiated from its output alone
+      assert(false && "Unsupported activation mode");
+  }
+}
+
+template <typename DT>
+void assign_kernel(DT *ptr, coord_t size, DT value) {
+  CPU_KERNEL_LOOP(i, size) {
+    ptr[i] = value;
+  }
+}
+
+template <typename DT>
+void copy_kernel(DT *dst, const DT *src, coord_t size) {
+  CPU_KERNEL_LOOP(i, size) {
+    dst[i] = src[i];
+  }
+}
+
+template <typename T>
+void add_kernel(T *data_ptr, const T *grad_ptr, size_t size) {
+  CPU_KERNEL_LOOP(i, (coord_t)size) {
+    data_ptr[i] += grad_ptr[i];
+  }
+}
+
+template <typename DT>
+void apply_add_with_scale(DT *data_ptr,
+                          const DT *grad_ptr,
+                          size_t size,
+                          DT scale) {
+  CPU_KERNEL_LOOP(i, (coord_t)size) {
+    data_ptr[i] += grad_ptr[i] * scale;
+  }
+}
+
+void add_with_stride(float *output,
+                     float const *input,
+                     int num_blocks,
+                     int output_blk_size,
+                     int input_blk_size) {
+  int min_blk_size = std::min(output_blk_size, input_blk_size);
+  for (int blk_idx = 0; blk_idx < num_blocks; blk_idx++) {
+    for (int blk_offset = 0; blk_offset < min_blk_size; blk_offset++) {
+      output[blk_idx * output_blk_size + blk_offset] +=
+          input[blk_idx * input_blk_size + blk_offset];
+    }
+  }
+}
+
+void copy_with_stride(float *output,
+                      float const *input,
+                      int num_blocks,
+                      int output_blk_size,
+                      int input_blk_size) {
+  int min_blk_size = std::min(output_blk_size, input_blk_size);
+  for (int blk_idx = 0; blk_idx < num_blocks; blk_idx++) {
+    for (int blk_offset = 0; blk_offset < min_blk_size; blk_offset++) {
+      output[blk_idx * output_blk_size + blk_offset] =
+          input[blk_idx * input_blk_size + blk_offset];
+    }
+  }
+}
+
+template <typename T>
+void print_tensor(const T *ptr, size_t num_elements, char const *prefix) {
+  printf("%s", prefix);
+  for (size_t idx = 0; idx < num_elements; idx++) {
+    printf(" %.4lf", (float)ptr[idx]);
+    if (idx >= 16)
+      break;
+  }
+  printf("\n");
+}
+
+double cpu_wall_time_ms(void) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+static std::atomic<int> cpu_num_threads(1);
+
+void cpu_set_num_threads(int num_threads) {
+  assert(num_threads > 0);
+  cpu_num_threads.store(num_threads);
+}
+
+int cpu_get_num_threads(void) {
+  return cpu_num_threads.load();
+}
+
+template void assign_kernel<float>(float *ptr, coord_t size, float value);
+template void assign_kernel<double>(double *ptr, coord_t size, double value);
+template void assign_kernel<int32_t>(int32_t *ptr, coord_t size, int32_t value);
+template void assign_kernel<int64_t>(int64_t *ptr, coord_t size, int64_t value);
+
+template void copy_kernel<float>(float *dst, float const *src, coord_t size);
+template void copy_kernel<double>(double *dst, double const *src, coord_t size);
+template void
+    copy_kernel<int32_t>(int32_t *dst, int32_t const *src, coord_t size);
+template void
+    copy_kernel<int64_t>(int64_t *dst, int64_t const *src, coord_t size);
+
+template void
+    add_kernel<float>(float *data_ptr, float const *grad_ptr, size_t size);
+template void
+    add_kernel<double>(double *data_ptr, double const *grad_ptr, size_t size);
+template void add_kernel<int32_t>(int32_t *data_ptr,
+                                  int32_t const *grad_ptr,
+                                  size_t size);
+template void add_kernel<int64_t>(int64_t *data_ptr,
+                                  int64_t const *grad_ptr,
+                                  size_t size);
+
+template void apply_add_with_scale<float>(float *data_ptr,
+                                          float const *grad_ptr,
+                                          size_t size,
+                                          float scale);
+template void apply_add_with_scale<double>(double *data_ptr,
+                                           double const *grad_ptr,
+                                           size_t size,
+                                           double scale);
+template void apply_add_with_scale<int32_t>(int32_t *data_ptr,
+                                            int32_t const *grad_ptr,
+                                            size_t size,
+                                            int32_t scale);
+template void apply_add_with_scale<int64_t>(int64_t *data_ptr,
+                                            int64_t const *grad_ptr,
+                                            size_t size,
+                                            int64_t scale);
+
+template void
+    print_tensor<float>(float const *ptr, size_t rect, char const *prefix);
+template void
+    print_tensor<double>(double const *ptr, size_t rect, char const *prefix);
+template void
+    print_tensor<int32_t>(int32_t const *ptr, size_t rect, char const *prefix);
+template void
+    print_tensor<int64_t>(int64_t const *ptr, size_t rect, char const *prefix);
@@ -0,0 +1,94 @@
+/* Copyright 2023 CMU, Facebook, LANL, MIT, NVIDIA, and Stanford (alphabetical)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flexflow/utils/cpu_thread_pool.h"
+#include <cassert>
+
+namespace {
+
+// Set on the workers of every pool
+thread_local bool in_pool_worker = false;
+
+} // namespace
+
+/*static*/
+CpuThreadPool &CpuThreadPool::get(void) {
+  thread_local CpuThreadPool pool;
+  return pool;
+}
+
+void CpuThreadPool::run(int _num_threads, std::function<void(int)> const &f) {
+  if (_num_threads <= 1 || in_pool_worker || running) {
+    for (int t = 0; t < _num_threads; t++) {
+      f(t);
+    }
+    return;
+  }
+  // Only the owner thread starts loops, so generation does not change
+  // while the new workers start
+  while ((int)workers.size() < _num_threads - 1) {
+    workers.emplace_back(&CpuThreadPool::worker_loop,
+                         this,
+                         (int)workers.size() + 1,
+                         generation);
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    job = &f;
+    num_threads = _num_threads;
+    pending = _num_threads - 1;
+    generation++;
+  }
+  start.notify_all();
+  running = true;
+  f(0);
+  running = false;
+  std::unique_lock<std::mutex> lock(mutex);
+  done.wait(lock, [this] { return pending == 0; });
+  job = nullptr;
+}
+
+void CpuThreadPool::worker_loop(int thread_id, size_t seen) {
+  in_pool_worker = true;
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    start.wait(lock, [&] { return stopping || generation != seen; });
+    if (stopping) {
+      return;
+    }
+    seen = generation;
+    if (thread_id >= num_threads) {
+      continue;
+    }
+    std::function<void(int)> const *f = job;
+    lock.unlock();
+    (*f)(thread_id);
+    lock.lock();
+    if (--pending == 0) {
+      done.notify_one();
+    }
+  }
+}
+
+CpuThreadPool::~CpuThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  start.notify_all();
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+}
@@ -0,0 +1,157 @@
+/* Copyright 2019 Stanford
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flexflow/accessor.h"
+#include "flexflow/initializer.h"
+#include "flexflow/model.h"
+#include "flexflow/utils/cpu_helper.h"
+#include <random>
+
+namespace FlexFlow {
+// declare Legion names
+using Legion::Context;
+using Legion::coord_t;
+using Legion::Domain;
+using Legion::PhysicalRegion;
+using Legion::Runtime;
+using Legion::Task;
+
+void UniformInitializer::init_task(Task const *task,
+                                   std::vector<PhysicalRegion> const &regions,
+                                   Context ctx,
+                                   Runtime *runtime) {
+  assert(regions.size() == task->regions.size());
+  UniformInitializer *initializer = (UniformInitializer *)task->args;
+  for (size_t i = 0; i < regions.size(); i++) {
+    Domain domain = runtime->get_index_space_domain(
+        ctx, task->regions[i].region.get_index_space());
+    // Do not support 0-dim parameters
+    assert(domain.get_dim() > 0);
+    float *w = helperGetTensorPointerWO<float>(
+        regions[i], task->regions[i], FID_DATA, ctx, runtime);
+    std::mt19937 generator(initializer->seed);
+    std::uniform_real_distribution<float> distribution(initializer->min_val,
+                                                       initializer->max_val);
+    CPU_KERNEL_LOOP(j, (coord_t)domain.get_volume()) {
+      w[j] = distribution(generator);
+    }
+  }
+}
+
+void GlorotUniform::init_task(Task const *task,
+                              std::vector<PhysicalRegion> const &regions,
+                              Context ctx,
+                              Runtime *runtime) {
+  assert(regions.size() == 1);
+  assert(task->regions.size() == 1);
+  GlorotUniform const *gu = (GlorotUniform const *)task->args;
+  Domain domain = runtime->get_index_space_domain(
+      ctx, task->regions[0].region.get_index_space());
+  float *w = helperGetTensorPointerWO<float>(
+      regions[0], task->regions[0], FID_DATA, ctx, runtime);
+  fprintf(stderr, "seed = %d scale = %.4lf\n", gu->seed, gu->scale);
+  std::mt19937 generator(gu->seed);
+  std::uniform_real_distribution<float> distribution(-gu->scale, gu->scale);
+  CPU_KERNEL_LOOP(i, (coord_t)domain.get_volume()) {
+    w[i] = distribution(generator);
+  }
+}
+
+void NormInitializer::init_task(Task const *task,
+                                std::vector<PhysicalRegion> const &regions,
+                                Context ctx,
+                                Runtime *runtime) {
+  assert(regions.size() == 1);
+  assert(task->regions.size() == 1);
+  Domain domain = runtime->get_index_space_domain(
+      ctx, task->regions[0].region.get_index_space());
+  float *w = helperGetTensorPointerWO<float>(
+      regions[0], task->regions[0], FID_DATA, ctx, runtime);
+  NormInitializer *initializer = (NormInitializer *)task->args;
+  std::mt19937 generator(initializer->seed);
+  std::normal_distribution<float> distribution(initializer->mean,
+                                               initializer->stddev);
+  CPU_KERNEL_LOOP(i, (coord_t)domain.get_volume()) {
+    w[i] = distribution(generator);
+  }
+}
+
+void ZeroInitializer::init_task(Task const *task,
+                                std::vector<PhysicalRegion> const &regions,
+                                Context ctx,
+                                Runtime *runtime) {
+  ZeroInitMeta *meta = (ZeroInitMeta *)task->args;
+  assert(meta->num_regions == regions.size());
+  assert(regions.size() == task->regions.size());
+  for (size_t i = 0; i < regions.size(); i++) {
+    Domain domain = runtime->get_index_space_domain(
+        ctx, task->regions[i].region.get_index_space());
+    if (meta->data_types[i] == DT_FLOAT) {
+      float *w = helperGetTensorPointerWO<float>(
+          regions[i], task->regions[i], FID_DATA, ctx, runtime);
+      assign_kernel<float>(w, domain.get_volume(), 0.0f);
+    } else if (meta->data_types[i] == DT_INT32) {
+      int32_t *w = helperGetTensorPointerWO<int32_t>(
+          regions[i], task->regions[i], FID_DATA, ctx, runtime);
+      assign_kernel<int32_t>(w, domain.get_volume(), 0);
+    } else if (meta->data_types[i] == DT_INT64) {
+      int64_t *w = helperGetTensorPointerWO<int64_t>(
+          regions[i], task->regions[i], FID_DATA, ctx, runtime);
+      assign_kernel<int64_t>(w, domain.get_volume(), 0);
+    } else {
+      assert(false && "Unsupported data type in Zero Initializer");
+    }
+  }
+}
+
+void ConstantInitializer::init_task(Task const *task,
+                                    std::vector<PhysicalRegion> const &regions,
+                                    Context ctx,
+                                    Runtime *runtime) {
+  ConstantInitializer *initializer = (ConstantInitializer *)task->args;
+  assert(regions.size() == task->regions.size());
+  for (size_t i = 0; i < regions.size(); i++) {
+    Domain domain = runtime->get_index_space_domain(
+        ctx, task->regions[i].region.get_index_space());
+    switch (initializer->data_type) {
+      case DT_FLOAT: {
+        float *w = helperGetTensorPointerWO<float>(
+            regions[i], task->regions[i], FID_DATA, ctx, runtime);
+        assign_kernel<float>(
+            w, domain.get_volume(), initializer->float_value);
+        break;
+      }
+      case DT_INT64: {
+        int64_t *w = helperGetTensorPointerWO<int64_t>(
+            regions[i], task->regions[i], FID_DATA, ctx, runtime);
+        assign_kernel<int64_t>(
+            w, domain.get_volume(), initializer->int64_value);
+        break;
+      }
+      case DT_INT32: {
+        int *w = helperGetTensorPointerWO<int>(
+            regions[i], task->regions[i], FID_DATA, ctx, runtime);
+        assign_kernel<int32_t>(
+            w, domain.get_volume(), initializer->int32_value);
+        break;
+      }
+      default: {
+        assert(false && "Unsupported Initialzier Type");
+      }
+    }
+  }
+}
+
+}; // namespace FlexFlow
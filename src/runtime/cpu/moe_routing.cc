@@ -0,0 +1,55 @@
+/* Copyright 2023 CMU, Facebook, LANL, MIT, NVIDIA, and Stanford (alphabetical)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flexflow/utils/moe_routing.h"
+#include <algorithm>
+#include <cassert>
+
+void moe_route(int const *exp_assign,
+               int num_pairs,
+               int num_experts,
+               int capacity,
+               MoeRouting &routing) {
+  assert(num_experts > 0);
+  assert(capacity >= 0);
+  routing.num_experts = num_experts;
+  routing.capacity = capacity;
+  // count the pairs of every expert first, so that each expert's rows can
+  // be placed without a pass per expert
+  routing.counts.assign(num_experts, 0);
+  for (int p = 0; p < num_pairs; p++) {
+    assert(exp_assign[p] >= 0 && exp_assign[p] < num_experts);
+    routing.counts[exp_assign[p]]++;
+  }
+  routing.offsets.resize(num_experts + 1);
+  routing.offsets[0] = 0;
+  for (int e = 0; e < num_experts; e++) {
+    routing.offsets[e + 1] =
+        routing.offsets[e] + std::min(routing.counts[e], capacity);
+  }
+  routing.pairs.resize(routing.offsets[num_experts]);
+  routing.rows.resize(num_pairs);
+  std::vector<int> next_row(num_experts, 0);
+  for (int p = 0; p < num_pairs; p++) {
+    int expert = exp_assign[p];
+    int row = next_row[expert]++;
+    if (row >= capacity) {
+      routing.rows[p] = -1;
+      continue;
+    }
+    routing.rows[p] = row;
+    routing.pairs[routing.offsets[expert] + row] = p;
+  }
+}
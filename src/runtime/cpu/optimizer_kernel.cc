@@ -0,0 +1,229 @@
+/* Copyright 2019 Stanford
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flexflow/accessor.h"
+#include "flexflow/model.h"
+#include "flexflow/optimizer.h"
+#include "flexflow/utils/cpu_helper.h"
+#include <algorithm>
+#include <cmath>
+
+namespace FlexFlow {
+
+using Legion::coord_t;
+
+LegionRuntime::Logger::Category log_optimizer("optimizer");
+
+// Rows per chunk of the row-parallel sparse updates
+static size_t const SPARSE_UPDATE_GRAIN = 64;
+
+// Sums the row-sparse gradients of all replicas into sorted unique rows.
+// Replica r stores its row count at rows_ptr[r * (capacity + 1)], followed by
+// its rows, and their values at values_ptr + r * capacity * out_dim
+static void merge_sparse_grads(int64_t const *rows_ptr,
+                               float const *values_ptr,
+                               int num_replicas,
+                               int capacity,
+                               int out_dim,
+                               std::vector<int64_t> &rows,
+                               std::vector<float> &values) {
+  // (row, replica row) pairs sorted by row
+  std::vector<std::pair<int64_t, size_t>> entries;
+  for (int r = 0; r < num_replicas; r++) {
+    int64_t const *replica_rows = rows_ptr + (size_t)r * (capacity + 1);
+    int64_t count = replica_rows[0];
+    assert(count >= 0 && count <= capacity);
+    for (int64_t i = 0; i < count; i++) {
+      entries.push_back(
+          std::make_pair(replica_rows[i + 1], (size_t)r * capacity + i));
+    }
+  }
+  std::sort(entries.begin(), entries.end());
+  rows.clear();
+  std::vector<size_t> starts;
+  for (size_t i = 0; i < entries.size(); i++) {
+    if (i == 0 || entries[i].first != entries[i - 1].first) {
+      rows.push_back(entries[i].first);
+      starts.push_back(i);
+    }
+  }
+  starts.push_back(entries.size());
+  values.assign(rows.size() * out_dim, 0.0f);
+  cpu_parallel_for(
+      rows.size(), SPARSE_UPDATE_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t r = begin; r < end; r++) {
+          float *dst = values.data() + r * out_dim;
+          for (size_t i = starts[r]; i < starts[r + 1]; i++) {
+            float const *src = values_ptr + entries[i].second * out_dim;
+            for (int off = 0; off < out_dim; off++) {
+              dst[off] += src[off];
+            }
+          }
+        }
+      });
+}
+
+void Optimizer::check_gradient_overflow_gpu(FFHandler const &handle,
+                                            float const *w_grad_ptr,
+                                            size_t size) {
+  CPU_KERNEL_LOOP(i, (coord_t)size) {
+    if (!std::isfinite(w_grad_ptr[i])) {
+      *handle.gradOverflow = true;
+      return;
+    }
+  }
+}
+
+bool Optimizer::reduce_gradient_overflow_gpu(FFHandler const &handle) {
+  bool overflow = *handle.gradOverflow;
+  *handle.gradOverflow = false;
+  return overflow;
+}
+
+void SGDOptimizer::ps_update_task_gpu(SGDOptimizer const *op,
+                                      float const *w_grad_ptr,
+                                      size_t size,
+                                      int num_replicas,
+                                      float *w_ptr,
+                                      float *v_ptr) {
+  // Step 1: Gather gradients in the first replica
+  for (int i = 1; i < num_replicas; i++) {
+    float const *src = w_grad_ptr + i * size;
+    apply_add_with_scale<float>((float *)w_grad_ptr, src, size, 1.0f);
+  }
+  // Step 2: SGD update
+  // Refernce https://pytorch.org/docs/stable/_modules/torch/optim/sgd.html#SGD
+  CPU_KERNEL_LOOP(i, (coord_t)size) {
+    float gt = w_grad_ptr[i] * op->grad_scale + op->weight_decay * w_ptr[i];
+    if (op->momentum > 0.0f) {
+      v_ptr[i] = v_ptr[i] * op->momentum + gt;
+      if (op->nesterov)
+        gt = gt + op->momentum * v_ptr[i];
+      else
+        gt = v_ptr[i];
+    }
+    w_ptr[i] -= op->lr * gt;
+  }
+}
+
+void SGDOptimizer::sparse_update_task_cpu(SGDOptimizer const *op,
+                                          int64_t const *rows_ptr,
+                                          float const *values_ptr,
+                                          int num_replicas,
+                                          int capacity,
+                                          int out_dim,
+                                          size_t table_size,
+                                          int num_copies,
+                                          float *w_ptr,
+                                          float *v_ptr) {
+  std::vector<int64_t> rows;
+  std::vector<float> values;
+  merge_sparse_grads(
+      rows_ptr, values_ptr, num_replicas, capacity, out_dim, rows, values);
+  // Same update as ps_update_task_gpu on the touched rows; weight decay and
+  // momentum are applied lazily, i.e., only when a row has a gradient
+  cpu_parallel_for(
+      rows.size(), SPARSE_UPDATE_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t r = begin; r < end; r++) {
+          float const *grad = values.data() + r * out_dim;
+          for (int c = 0; c < num_copies; c++) {
+            size_t offset = c * table_size + (size_t)rows[r] * out_dim;
+            assert((size_t)rows[r] * out_dim < table_size);
+            float *w = w_ptr + offset;
+            float *v = v_ptr != NULL ? v_ptr + offset : NULL;
+            for (int i = 0; i < out_dim; i++) {
+              float gt = grad[i] * op->grad_scale + op->weight_decay * w[i];
+              if (op->momentum > 0.0f) {
+                v[i] = v[i] * op->momentum + gt;
+                if (op->nesterov)
+                  gt = gt + op->momentum * v[i];
+                else
+                  gt = v[i];
+              }
+              w[i] -= op->lr * gt;
+            }
+          }
+        }
+      });
+}
+
+// ==================================================================
+//                        Adam Optimizer
+// ==================================================================
+void AdamOptimizer::ps_update_task_gpu(AdamOptimizer const *op,
+                                       float const *w_grad_ptr,
+                                       size_t size,
+                                       int num_replicas,
+                                       float *w_ptr,
+                                       float *v_ptr,
+                                       float *m_ptr) {
+  // Step 1: Gather gradients in the first replica
+  for (int i = 1; i < num_replicas; i++) {
+    float const *src = w_grad_ptr + i * size;
+    apply_add_with_scale<float>((float *)w_grad_ptr, src, size, 1.0f);
+  }
+  // Step 2: Adam update
+  // Reference for weight decay
+  // https://www.fast.ai/2018/07/02/adam-weight-decay/
+  CPU_KERNEL_LOOP(i, (coord_t)size) {
+    float gt = w_grad_ptr[i] * op->grad_scale + op->weight_decay * w_ptr[i];
+    float mt = op->beta1 * m_ptr[i] + (1 - op->beta1) * gt;
+    float vt = op->beta2 * v_ptr[i] + (1 - op->beta2) * gt * gt;
+    m_ptr[i] = mt;
+    v_ptr[i] = vt;
+    w_ptr[i] -= op->alpha_t * mt / (sqrtf(vt) + op->epsilon);
+  }
+}
+
+void AdamOptimizer::sparse_update_task_cpu(AdamOptimizer const *op,
+                                           int64_t const *rows_ptr,
+                                           float const *values_ptr,
+                                           int num_replicas,
+                                           int capacity,
+                                           int out_dim,
+                                           size_t table_size,
+                                           int num_copies,
+                                           float *w_ptr,
+                                           float *v_ptr,
+                                           float *m_ptr) {
+  std::vector<int64_t> rows;
+  std::vector<float> values;
+  merge_sparse_grads(
+      rows_ptr, values_ptr, num_replicas, capacity, out_dim, rows, values);
+  // The bias correction in alpha_t still follows the global step
+  cpu_parallel_for(
+      rows.size(), SPARSE_UPDATE_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t r = begin; r < end; r++) {
+          float const *grad = values.data() + r * out_dim;
+          for (int c = 0; c < num_copies; c++) {
+            size_t offset = c * table_size + (size_t)rows[r] * out_dim;
+            assert((size_t)rows[r] * out_dim < table_size);
+            float *w = w_ptr + offset;
+            float *v = v_ptr + offset;
+            float *m = m_ptr + offset;
+            for (int i = 0; i < out_dim; i++) {
+              float gt = grad[i] * op->grad_scale + op->weight_decay * w[i];
+              float mt = op->beta1 * m[i] + (1 - op->beta1) * gt;
+              float vt = op->beta2 * v[i] + (1 - op->beta2) * gt * gt;
+              m[i] = mt;
+              v[i] = vt;
+              w[i] -= op->alpha_t * mt / (sqrtf(vt) + op->epsilon);
+            }
+          }
+        }
+      });
+}
+
+}; // namespace FlexFlow
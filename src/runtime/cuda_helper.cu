@@ -65,7 +65,7 @@ __global__ void copy_kernel(DT *dst, const DT *src, coord_t size) {
 template <typename DT>
 __global__ void reluBackward(DT *grad_ptr, const DT *output, size_t n) {
   CUDA_KERNEL_LOOP(i, n) {
-    grad_ptr[i] = (output[i] > 0.0f) ? grad_ptr[i] : 0;
+    grad_ptr[i] = (output[i] > (DT)0.0f) ? grad_ptr[i] : (DT)0.0f;
   }
 }
 
@@ -82,6 +82,10 @@ __host__ void relu_backward_kernel(DataType data_type,
     reluBackward<double>
         <<<GET_BLOCKS(output_size), CUDA_NUM_THREADS, 0, stream>>>(
             (double *)output_grad_ptr, (double const *)output_ptr, output_size);
+  } else if (data_type == DT_HALF) {
+    reluBackward<half>
+        <<<GET_BLOCKS(output_size), CUDA_NUM_THREADS, 0, stream>>>(
+            (half *)output_grad_ptr, (half const *)output_ptr, output_size);
   } else {
     assert(false && "Unsupported data type in Linear backward");
     exit(1);
@@ -92,7 +96,7 @@ template <typename DT>
 __global__ void
     sigmoid_backward_function(DT *grad_ptr, const DT *output, size_t n) {
   CUDA_KERNEL_LOOP(i, n) {
-    grad_ptr[i] = grad_ptr[i] * output[i] * (1.0f - output[i]);
+    grad_ptr[i] = grad_ptr[i] * output[i] * ((DT)1.0f - output[i]);
   }
 }
 
@@ -109,6 +113,10 @@ __host__ void sigmoid_backward_kernel(DataType data_type,
     sigmoid_backward_function<double>
         <<<GET_BLOCKS(output_size), CUDA_NUM_THREADS, 0, stream>>>(
             (double *)output_grad_ptr, (double const *)output_ptr, output_size);
+  } else if (data_type == DT_HALF) {
+    sigmoid_backward_function<half>
+        <<<GET_BLOCKS(output_size), CUDA_NUM_THREADS, 0, stream>>>(
+            (half *)output_grad_ptr, (half const *)output_ptr, output_size);
   } else {
     assert(false && "Unsupported data type in Linear backward");
     exit(1);
@@ -126,6 +134,17 @@ __global__ void gelu_forward_kernel(size_t size,
   }
 }
 
+__global__ void gelu_forward_kernel(size_t size,
+                                    float const B,
+                                    float const C,
+                                    half *input) {
+  CUDA_KERNEL_LOOP(i, size) {
+    float const in = __half2float(input[i]);
+    float const cdf = 0.5f + 0.5f * tanh(in * (C * in * in + B));
+    input[i] = __float2half(in * cdf);
+  }
+}
+
 __global__ void
     apply_add(float *data_ptr, float const *replica_ptr, size_t size) {
   CUDA_KERNEL_LOOP(i, size) {
@@ -248,21 +267,23 @@ __host__ void
 }
 
 cudnnStatus_t cudnnSetTensorDescriptorFromDomain(cudnnTensorDescriptor_t tensor,
-                                                 Domain domain) {
+                                                 Domain domain,
+                                                 DataType data_type) {
+  cudnnDataType_t cudnn_data_type = ff_to_cudnn_datatype(data_type);
   int dims[MAX_TENSOR_DIM];
   switch (domain.get_dim()) {
     case 1: {
       Rect<1> rect = domain;
       dims[0] = rect.hi[0] - rect.lo[0] + 1;
       return cudnnSetTensor4dDescriptor(
-          tensor, CUDNN_TENSOR_NCHW, CUDNN_DATA_FLOAT, dims[0], 1, 1, 1);
+          tensor, CUDNN_TENSOR_NCHW, cudnn_data_type, dims[0], 1, 1, 1);
     }
     case 2: {
       Rect<2> rect = domain;
       dims[0] = rect.hi[0] - rect.lo[0] + 1;
       dims[1] = rect.hi[1] - rect.lo[1] + 1;
       return cudnnSetTensor4dDescriptor(
-          tensor, CUDNN_TENSOR_NCHW, CUDNN_DATA_FLOAT, dims[1], dims[0], 1, 1);
+          tensor, CUDNN_TENSOR_NCHW, cudnn_data_type, dims[1], dims[0], 1, 1);
     }
     case 3: {
       Rect<3> rect = domain;
@@ -271,7 +292,7 @@ cudnnStatus_t cudnnSetTensorDescriptorFromDomain(cudnnTensorDescriptor_t tensor,
       dims[2] = rect.hi[2] - rect.lo[2] + 1;
       return cudnnSetTensor4dDescriptor(tensor,
                                         CUDNN_TENSOR_NCHW,
-                                        CUDNN_DATA_FLOAT,
+                                        cudnn_data_type,
                                         dims[2],
                                         dims[1],
                                         dims[0],
@@ -285,7 +306,7 @@ cudnnStatus_t cudnnSetTensorDescriptorFromDomain(cudnnTensorDescriptor_t tensor,
       dims[3] = rect.hi[3] - rect.lo[3] + 1;
       return cudnnSetTensor4dDescriptor(tensor,
                                         CUDNN_TENSOR_NCHW,
-                                        CUDNN_DATA_FLOAT,
+                                        cudnn_data_type,
                                         dims[3],
                                         dims[2],
                                         dims[1],
@@ -301,7 +322,7 @@ cudnnStatus_t cudnnSetTensorDescriptorFromDomain(cudnnTensorDescriptor_t tensor,
       dims[3] = rect.hi[3] - rect.lo[3] + 1;
       return cudnnSetTensor4dDescriptor(tensor,
                                         CUDNN_TENSOR_NCHW,
-                                        CUDNN_DATA_FLOAT,
+                                        cudnn_data_type,
                                         dims[3],
                                         dims[2],
                                         dims[1],
@@ -319,6 +340,8 @@ cudnnDataType_t ff_to_cudnn_datatype(DataType type) {
       return CUDNN_DATA_FLOAT;
     case DT_DOUBLE:
       return CUDNN_DATA_DOUBLE;
+    case DT_HALF:
+      return CUDNN_DATA_HALF;
     case DT_INT32:
       return CUDNN_DATA_INT32;
     default:
@@ -333,6 +356,8 @@ cudaDataType_t ff_to_cuda_datatype(DataType type) {
       return CUDA_R_32F;
     case DT_DOUBLE:
       return CUDA_R_64F;
+    case DT_HALF:
+      return CUDA_R_16F;
     case DT_INT32:
       return CUDA_R_32I;
     default:
@@ -359,6 +384,8 @@ template __global__ void
 
 template __global__ void
     copy_kernel<float>(float *dst, float const *src, coord_t size);
+template __global__ void
+    copy_kernel<half>(half *dst, half const *src, coord_t size);
 template __global__ void
     copy_kernel<int32_t>(int32_t *dst, int32_t const *src, coord_t size);
 template __global__ void
@@ -0,0 +1,467 @@
+/* Copyright 2023 CMU, Facebook, LANL, MIT, NVIDIA, and Stanford (alphabetical)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flexflow/egraph.h"
+#include "flexflow/model.h"
+#include <algorithm>
+#include <limits>
+#include <set>
+#include <unordered_set>
+
+namespace FlexFlow::PCG {
+
+LegionRuntime::Logger::Category log_egraph("egraph");
+
+// Added to the cost of every e-node, so extract never picks a cycle of
+// e-nodes that cost nothing, such as a partition followed by a combine
+static float const MIN_ENODE_COST = 1e-6f;
+
+EGraph::EGraph(FFModel *_model) : model(_model), num_alive(0) {}
+
+int EGraph::find(int eclass) const {
+  while (parent[eclass] != eclass) {
+    parent[eclass] = parent[parent[eclass]];
+    eclass = parent[eclass];
+  }
+  return eclass;
+}
+
+ENode const &EGraph::get_enode(int id) const {
+  return this->enodes[id];
+}
+
+size_t EGraph::num_enodes(void) const {
+  return this->num_alive;
+}
+
+size_t EGraph::num_eclasses(void) const {
+  size_t num = 0;
+  for (size_t i = 0; i < this->parent.size(); i++) {
+    if (this->find(i) == (int)i) {
+      num++;
+    }
+  }
+  return num;
+}
+
+int EGraph::add_enode(ENode const &enode) {
+  ENode canonical = enode;
+  for (int &input : canonical.inputs) {
+    input = this->find(input);
+  }
+  Key key(canonical.node.ptr, canonical.out_idx, canonical.inputs);
+  auto const &it = this->memo.find(key);
+  if (it != this->memo.end()) {
+    return this->find(this->enode_eclass[it->second]);
+  }
+  int id = this->enodes.size();
+  int eclass = this->parent.size();
+  this->enodes.push_back(canonical);
+  this->enode_eclass.push_back(eclass);
+  this->enode_alive.push_back(true);
+  this->parent.push_back(eclass);
+  this->eclass_enodes.push_back({id});
+  this->memo[key] = id;
+  this->num_alive++;
+  return eclass;
+}
+
+std::vector<int> EGraph::add_operator(Node const &node,
+                                      std::vector<int> const &inputs) {
+  std::vector<int> outputs;
+  for (int i = 0; i < node.ptr->numOutputs; i++) {
+    outputs.push_back(this->add_enode({node, i, inputs}));
+  }
+  return outputs;
+}
+
+void EGraph::add_graph(Graph const *graph) {
+  // Add the operators in topological order
+  std::unordered_map<Node, int> todos;
+  std::vector<Node> opList;
+  for (auto const &it : graph->inEdges) {
+    todos[it.first] = it.second.size();
+    if (it.second.size() == 0) {
+      opList.push_back(it.first);
+    }
+  }
+  std::unordered_map<Node, std::vector<int>> outputs;
+  for (size_t i = 0; i < opList.size(); i++) {
+    Node const node = opList[i];
+    auto const &inList = graph->inEdges.at(node);
+    std::vector<int> inputs(inList.size(), -1);
+    for (Edge const &e : inList) {
+      assert(e.dstIdx < (int)inputs.size());
+      inputs[e.dstIdx] = outputs.at(e.srcOp)[e.srcIdx];
+    }
+    outputs[node] = this->add_operator(node, inputs);
+    auto const &outList = graph->outEdges.at(node);
+    if (outList.empty()) {
+      for (int eclass : outputs[node]) {
+        this->roots.push_back(eclass);
+      }
+    }
+    for (Edge const &e : outList) {
+      if (--todos[e.dstOp] == 0) {
+        opList.push_back(e.dstOp);
+      }
+    }
+  }
+  assert(opList.size() == graph->inEdges.size());
+}
+
+bool EGraph::merge(int a, int b) {
+  a = this->find(a);
+  b = this->find(b);
+  if (a == b) {
+    return false;
+  }
+  if (this->eclass_enodes[a].size() < this->eclass_enodes[b].size()) {
+    std::swap(a, b);
+  }
+  this->parent[b] = a;
+  this->eclass_enodes[a].insert(this->eclass_enodes[a].end(),
+                                this->eclass_enodes[b].begin(),
+                                this->eclass_enodes[b].end());
+  this->eclass_enodes[b].clear();
+  return true;
+}
+
+void EGraph::rebuild(void) {
+  // Merging two e-classes can make the e-nodes over them equal, which in
+  // turn merges the e-classes of those e-nodes
+  bool merged = true;
+  while (merged) {
+    merged = false;
+    this->memo.clear();
+    for (size_t id = 0; id < this->enodes.size(); id++) {
+      if (!this->enode_alive[id]) {
+        continue;
+      }
+      ENode &enode = this->enodes[id];
+      for (int &input : enode.inputs) {
+        input = this->find(input);
+      }
+      Key key(enode.node.ptr, enode.out_idx, enode.inputs);
+      auto const &it = this->memo.find(key);
+      if (it == this->memo.end()) {
+        this->memo[key] = id;
+        continue;
+      }
+      merged |= this->merge(this->enode_eclass[it->second],
+                            this->enode_eclass[id]);
+      this->enode_alive[id] = false;
+      this->num_alive--;
+    }
+  }
+  for (std::vector<int> &list : this->eclass_enodes) {
+    list.clear();
+  }
+  this->operators.clear();
+  for (size_t id = 0; id < this->enodes.size(); id++) {
+    if (this->enode_alive[id]) {
+      this->eclass_enodes[this->find(this->enode_eclass[id])].push_back(id);
+      if (this->enodes[id].out_idx == 0) {
+        this->operators[this->enodes[id].node.ptr->op_type].push_back(id);
+      }
+    }
+  }
+}
+
+int EGraph::output_eclass(int enode_id, int out_idx) const {
+  ENode const &enode = this->enodes[enode_id];
+  if (out_idx == enode.out_idx) {
+    return this->find(this->enode_eclass[enode_id]);
+  }
+  std::vector<int> inputs;
+  for (int input : enode.inputs) {
+    inputs.push_back(this->find(input));
+  }
+  auto const &it = this->memo.find(Key(enode.node.ptr, out_idx, inputs));
+  if (it == this->memo.end()) {
+    return -1;
+  }
+  return this->find(this->enode_eclass[it->second]);
+}
+
+void EGraph::find_matches(GraphXfer *xfer,
+                          int depth,
+                          Match &match,
+                          std::vector<Match> &matches) const {
+  if (depth >= (int)xfer->srcOps.size()) {
+    matches.push_back(match);
+    return;
+  }
+  OpX *srcOp = xfer->srcOps[depth];
+  auto const &candidates = this->operators.find(srcOp->type);
+  if (candidates == this->operators.end()) {
+    return;
+  }
+  for (int id : candidates->second) {
+    ENode const &enode = this->enodes[id];
+    if (enode.inputs.size() != srcOp->inputs.size() ||
+        !xfer->can_match_parameters(srcOp, enode.node.ptr) ||
+        std::find(match.enodes.begin(), match.enodes.end(), id) !=
+            match.enodes.end()) {
+      continue;
+    }
+    // Bind the inputs of the xfer, and check that intermediate tensors
+    // are outputs of the source operators matched before
+    std::vector<int> bound;
+    bool pass = true;
+    for (size_t i = 0; i < srcOp->inputs.size() && pass; i++) {
+      TensorX const &in = srcOp->inputs[i];
+      int eclass = this->find(enode.inputs[i]);
+      if (in.op == NULL) {
+        auto const &it = match.inputs.find(in.idx);
+        if (it == match.inputs.end()) {
+          match.inputs[in.idx] = eclass;
+          bound.push_back(in.idx);
+        } else if (it->second != eclass) {
+          pass = false;
+        }
+      } else {
+        size_t k = std::find(xfer->srcOps.begin(), xfer->srcOps.end(), in.op) -
+                   xfer->srcOps.begin();
+        assert((int)k < depth);
+        pass = match.outputs[k][in.idx] == eclass;
+      }
+    }
+    std::vector<int> outputs;
+    for (int i = 0; i < enode.node.ptr->numOutputs && pass; i++) {
+      outputs.push_back(this->output_eclass(id, i));
+      pass = outputs.back() >= 0;
+    }
+    if (pass) {
+      match.enodes.push_back(id);
+      match.outputs.push_back(outputs);
+      this->find_matches(xfer, depth + 1, match, matches);
+      match.enodes.pop_back();
+      match.outputs.pop_back();
+    }
+    for (int idx : bound) {
+      match.inputs.erase(idx);
+    }
+  }
+}
+
+bool EGraph::apply(GraphXfer *xfer, Match const &match) {
+  // Point the xfer at the matched operators, and at one tensor of each
+  // bound e-class, which all have the same shape
+  for (size_t k = 0; k < xfer->srcOps.size(); k++) {
+    xfer->srcOps[k]->mapOp = this->enodes[match.enodes[k]].node;
+  }
+  xfer->mappedInputs.clear();
+  for (auto const &it : match.inputs) {
+    int id = this->eclass_enodes[this->find(it.second)][0];
+    ENode const &enode = this->enodes[id];
+    xfer->mappedInputs.insert(
+        std::make_pair(it.first, std::make_pair(enode.node, enode.out_idx)));
+  }
+  // Operators created from here on are only used by this match
+  size_t first_new_guid = this->model->op_global_guid;
+  bool pass = true;
+  for (OpX *dstOp : xfer->dstOps) {
+    if (!xfer->create_new_operator(dstOp, dstOp->mapOp)) {
+      pass = false;
+      break;
+    }
+  }
+  // Only tensors of the same shape can be merged
+  for (auto const &it : xfer->mappedOutputs) {
+    if (!pass) {
+      break;
+    }
+    tl::optional<ParallelTensor> src = it.first.to_tensor(xfer);
+    tl::optional<ParallelTensor> dst = it.second.to_tensor(xfer);
+    pass = src.has_value() && dst.has_value() &&
+           src.value()->get_shape() == dst.value()->get_shape();
+  }
+  bool changed = false;
+  if (pass) {
+    size_t num_enodes = this->num_alive;
+    std::map<OpX const *, std::vector<int>> dst_outputs;
+    auto eclass_of = [&](TensorX const &t) {
+      if (t.op == NULL) {
+        return match.inputs.at(t.idx);
+      }
+      auto const &it = dst_outputs.find(t.op);
+      if (it != dst_outputs.end()) {
+        return it->second[t.idx];
+      }
+      size_t k = std::find(xfer->srcOps.begin(), xfer->srcOps.end(), t.op) -
+                 xfer->srcOps.begin();
+      assert(k < xfer->srcOps.size());
+      return match.outputs[k][t.idx];
+    };
+    for (OpX *dstOp : xfer->dstOps) {
+      std::vector<int> inputs;
+      for (TensorX const &in : dstOp->inputs) {
+        inputs.push_back(eclass_of(in));
+      }
+      dst_outputs[dstOp] = this->add_operator(dstOp->mapOp, inputs);
+    }
+    for (auto const &it : xfer->mappedOutputs) {
+      int src = eclass_of(it.first), dst = eclass_of(it.second);
+      changed |= this->merge(src, dst);
+    }
+    changed |= this->num_alive != num_enodes;
+  } else {
+    // Free the operators of an abandoned match, which no e-node refers to
+    std::set<Op const *> discarded;
+    for (OpX *dstOp : xfer->dstOps) {
+      Node const &node = dstOp->mapOp;
+      if (node != Node::INVALID_NODE &&
+          node.ptr->op_guid >= first_new_guid &&
+          discarded.insert(node.ptr).second) {
+        this->model->discard_node(node);
+      }
+    }
+  }
+  for (OpX *opx : xfer->srcOps) {
+    opx->mapOp = Node::INVALID_NODE;
+  }
+  for (OpX *opx : xfer->dstOps) {
+    opx->mapOp = Node::INVALID_NODE;
+  }
+  xfer->mappedInputs.clear();
+  return changed;
+}
+
+int EGraph::saturate(std::vector<GraphXfer *> const &xfers,
+                     size_t node_budget) {
+  int num_rounds = 0;
+  this->rebuild();
+  while (this->num_alive < node_budget) {
+    std::unordered_set<OperatorType> op_types;
+    for (auto const &it : this->operators) {
+      op_types.insert(it.first);
+    }
+    // Find the matches of every xfer before applying any, so all of them
+    // see the e-graph of the last rebuild
+    std::vector<std::pair<GraphXfer *, std::vector<Match>>> matches;
+    size_t num_matches = 0;
+    for (GraphXfer *xfer : xfers) {
+      if (!xfer->load_rule(op_types)) {
+        continue;
+      }
+      Match match;
+      matches.push_back(std::make_pair(xfer, std::vector<Match>()));
+      this->find_matches(xfer, 0, match, matches.back().second);
+      num_matches += matches.back().second.size();
+    }
+    bool changed = false;
+    for (auto const &it : matches) {
+      for (Match const &match : it.second) {
+        if (this->num_alive >= node_budget) {
+          break;
+        }
+        changed |= this->apply(it.first, match);
+      }
+    }
+    this->rebuild();
+    num_rounds++;
+    log_egraph.debug("Round %d: %zu matches, %zu e-nodes, %zu e-classes",
+                     num_rounds,
+                     num_matches,
+                     this->num_enodes(),
+                     this->num_eclasses());
+    if (!changed) {
+      break;
+    }
+  }
+  return num_rounds;
+}
+
+std::vector<int> EGraph::pick_enodes(
+    std::function<float(Op const *)> const &op_cost) const {
+  float const inf = std::numeric_limits<float>::infinity();
+  std::unordered_map<Op const *, float> op_costs;
+  std::vector<float> enode_cost(this->enodes.size(), inf);
+  for (size_t id = 0; id < this->enodes.size(); id++) {
+    if (!this->enode_alive[id]) {
+      continue;
+    }
+    Op const *op = this->enodes[id].node.ptr;
+    if (op_costs.find(op) == op_costs.end()) {
+      op_costs[op] = std::max(op_cost(op), 0.0f);
+    }
+    enode_cost[id] = op_costs[op] / op->numOutputs + MIN_ENODE_COST;
+  }
+  // Relax the cost of every e-class until none improves. Costs are
+  // positive, so a chosen e-node only depends on e-classes of lower cost
+  std::vector<float> cost(this->parent.size(), inf);
+  std::vector<int> best(this->parent.size(), -1);
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (size_t id = 0; id < this->enodes.size(); id++) {
+      if (!this->enode_alive[id]) {
+        continue;
+      }
+      float c = enode_cost[id];
+      for (int input : this->enodes[id].inputs) {
+        c += cost[this->find(input)];
+      }
+      int eclass = this->find(this->enode_eclass[id]);
+      if (c < cost[eclass]) {
+        cost[eclass] = c;
+        best[eclass] = id;
+        changed = true;
+      }
+    }
+  }
+  return best;
+}
+
+std::unique_ptr<Graph>
+    EGraph::extract(std::function<float(Op const *)> const &op_cost) const {
+  std::vector<int> best = this->pick_enodes(op_cost);
+  for (int root : this->roots) {
+    if (best[this->find(root)] < 0) {
+      return nullptr;
+    }
+  }
+
+  // Operators picked for several outputs are added once
+  std::unique_ptr<Graph> graph(new Graph(this->model));
+  std::map<std::pair<Op const *, std::vector<int>>, Node> nodes;
+  std::function<Node(int)> add_eclass = [&](int eclass) {
+    ENode const &enode = this->enodes[best[eclass]];
+    std::vector<int> inputs;
+    for (int input : enode.inputs) {
+      inputs.push_back(this->find(input));
+    }
+    auto key = std::make_pair((Op const *)enode.node.ptr, inputs);
+    auto const &it = nodes.find(key);
+    if (it != nodes.end()) {
+      return it->second;
+    }
+    nodes[key] = enode.node;
+    graph->add_node(enode.node);
+    for (size_t i = 0; i < inputs.size(); i++) {
+      Node src = add_eclass(inputs[i]);
+      int src_idx = this->enodes[best[inputs[i]]].out_idx;
+      graph->add_edge(src, enode.node, src_idx, i);
+    }
+    return enode.node;
+  };
+  for (int root : this->roots) {
+    add_eclass(this->find(root));
+  }
+  return graph;
+}
+
+}; // namespace FlexFlow::PCG
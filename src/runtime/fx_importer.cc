@@ -0,0 +1,520 @@
+/* Copyright 2023 CMU, Facebook, LANL, MIT, NVIDIA, and Stanford (alphabetical)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flexflow/fx_importer.h"
+#include "flexflow/model.h"
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+namespace FlexFlow {
+
+// Outputs of the nodes imported so far; a node has several outputs if it
+// returns a tuple, e.g., a split
+typedef std::unordered_map<std::string, std::vector<Tensor>> FXNodeOutputs;
+
+// Malformed graphs and unsupported nodes are reported to the caller, e.g.,
+// the C API hands the message to Python as an exception
+[[noreturn]] static void fx_error(std::string const &message) {
+  throw std::runtime_error("[FX] " + message);
+}
+
+static std::string strip(std::string const &s) {
+  size_t begin = s.find_first_not_of(" \t\r\n");
+  if (begin == std::string::npos) {
+    return "";
+  }
+  size_t end = s.find_last_not_of(" \t\r\n");
+  return s.substr(begin, end - begin + 1);
+}
+
+static std::vector<std::string> split_fx_items(std::string const &s,
+                                               char delimiter) {
+  std::vector<std::string> items;
+  size_t begin = 0;
+  while (true) {
+    size_t end = s.find(delimiter, begin);
+    items.push_back(strip(s.substr(begin, end - begin)));
+    if (end == std::string::npos) {
+      return items;
+    }
+    begin = end + 1;
+  }
+}
+
+// Node names are comma separated with a trailing comma
+static std::vector<std::string> parse_fx_node_names(std::string const &s) {
+  std::vector<std::string> names;
+  for (std::string const &name : split_fx_items(s, ',')) {
+    if (!name.empty()) {
+      names.push_back(name);
+    }
+  }
+  return names;
+}
+
+bool parse_fx_node(std::string const &line, FXNode &node) {
+  std::string stripped = strip(line);
+  if (stripped.empty()) {
+    return false;
+  }
+  std::vector<std::string> items = split_fx_items(stripped, ';');
+  node.name = items[0];
+  node.innodes.clear();
+  node.outnodes.clear();
+  node.args.clear();
+  if (items.size() < 4) {
+    if (items.size() != 2) {
+      fx_error("malformed node: " + stripped);
+    }
+    node.op_type = items[1];
+    return true;
+  }
+  node.innodes = parse_fx_node_names(items[1]);
+  node.outnodes = parse_fx_node_names(items[2]);
+  node.op_type = items[3];
+  node.args.assign(items.begin() + 4, items.end());
+  return true;
+}
+
+static bool try_parse_int(std::string const &s, int &value) {
+  char *end;
+  value = (int)strtol(s.c_str(), &end, 10);
+  return !s.empty() && *end == '\0';
+}
+
+static int parse_int(std::string const &s) {
+  int value;
+  if (!try_parse_int(s, value)) {
+    fx_error("expected an integer but got '" + s + "'");
+  }
+  return value;
+}
+
+static float parse_float(std::string const &s) {
+  char *end;
+  float value = strtof(s.c_str(), &end);
+  if (s.empty() || *end != '\0') {
+    fx_error("expected a number but got '" + s + "'");
+  }
+  return value;
+}
+
+static void check_num_args(FXNode const &node, size_t num_args) {
+  if (node.args.size() < num_args) {
+    fx_error(node.op_type + " node " + node.name + " expects " +
+             std::to_string(num_args) + " arguments");
+  }
+}
+
+static std::vector<Tensor> const &get_outputs(FXNodeOutputs const &outputs,
+                                              std::string const &name) {
+  FXNodeOutputs::const_iterator it = outputs.find(name);
+  if (it == outputs.end()) {
+    fx_error("node " + name + " is used before it is defined");
+  }
+  return it->second;
+}
+
+static Tensor get_input(FXNodeOutputs const &outputs,
+                        FXNode const &node,
+                        size_t idx) {
+  if (idx >= node.innodes.size()) {
+    fx_error(node.op_type + " node " + node.name + " expects " +
+             std::to_string(idx + 1) + " inputs");
+  }
+  std::vector<Tensor> const &tensors = get_outputs(outputs, node.innodes[idx]);
+  if (tensors.size() != 1) {
+    fx_error("node " + node.innodes[idx] + " is a tuple, not a tensor");
+  }
+  return tensors[0];
+}
+
+// Shape in PyTorch order, i.e., outermost dimension first
+static std::vector<int> get_torch_shape(Tensor const tensor) {
+  std::vector<int> shape;
+  for (int i = tensor->num_dims - 1; i >= 0; i--) {
+    shape.push_back(tensor->dims[i]);
+  }
+  return shape;
+}
+
+// Maps a negative PyTorch dimension to a nonnegative one
+static int get_torch_dim(int dim, int num_dims) {
+  if (dim < -num_dims || dim >= num_dims) {
+    fx_error("dimension " + std::to_string(dim) + " is out of range for " +
+             std::to_string(num_dims) + " dimensions");
+  }
+  if (dim < 0) {
+    dim += num_dims;
+  }
+  return dim;
+}
+
+// Shape of a view of tensor, inferring at most one -1 dimension
+static std::vector<int> get_view_shape(Tensor const tensor,
+                                       std::vector<int> shape) {
+  size_t num_elements = 1, view_elements = 1;
+  for (int i = 0; i < tensor->num_dims; i++) {
+    num_elements *= tensor->dims[i];
+  }
+  int infer_dim = -1;
+  for (size_t i = 0; i < shape.size(); i++) {
+    if (shape[i] == -1) {
+      if (infer_dim != -1) {
+        fx_error("can only infer one view dimension");
+      }
+      infer_dim = i;
+    } else {
+      view_elements *= shape[i];
+    }
+  }
+  if (infer_dim >= 0 && view_elements > 0 &&
+      num_elements % view_elements == 0) {
+    shape[infer_dim] = num_elements / view_elements;
+  } else if (infer_dim >= 0 || num_elements != view_elements) {
+    fx_error("cannot view " + std::to_string(num_elements) +
+             " elements in the requested shape");
+  }
+  return shape;
+}
+
+// Slicing is only supported for ':' and None, i.e., for reshapes
+static Tensor slice_tensor(FFModel &model,
+                           Tensor const tensor,
+                           std::vector<std::string> const &slices,
+                           char const *name) {
+  std::vector<int> shape = get_torch_shape(tensor);
+  std::vector<int> new_shape;
+  // Match dimensions from right to left
+  int dim = (int)shape.size() - 1;
+  for (size_t i = slices.size(); i > 0; i--) {
+    std::string const &slice = slices[i - 1];
+    if (slice == "None") {
+      new_shape.insert(new_shape.begin(), 1);
+    } else if (slice == "slice(None, None, None)" && dim >= 0) {
+      new_shape.insert(new_shape.begin(), shape[dim--]);
+    } else {
+      fx_error("unsupported slice: " + slice);
+    }
+  }
+  return model.reshape(tensor, new_shape, name);
+}
+
+static std::vector<Tensor> import_fx_node(FFModel &model,
+                                          FXNode const &node,
+                                          FXNodeOutputs const &outputs) {
+  std::string const &op = node.op_type;
+  std::vector<std::string> const &args = node.args;
+  char const *name = node.name.c_str();
+  if (op == "LINEAR") {
+    check_num_args(node, 3);
+    return {model.dense(get_input(outputs, node, 0),
+                        parse_int(args[0]),
+                        static_cast<ActiMode>(parse_int(args[1])),
+                        parse_int(args[2]) != 0,
+                        DT_FLOAT,
+                        NULL,
+                        NULL,
+                        NULL,
+                        name)};
+  }
+  if (op == "CONV2D") {
+    check_num_args(node, 10);
+    return {model.conv2d(get_input(outputs, node, 0),
+                         parse_int(args[0]),
+                         parse_int(args[1]),
+                         parse_int(args[2]),
+                         parse_int(args[3]),
+                         parse_int(args[4]),
+                         parse_int(args[5]),
+                         parse_int(args[6]),
+                         static_cast<ActiMode>(parse_int(args[7])),
+                         parse_int(args[8]),
+                         parse_int(args[9]) != 0,
+                         NULL,
+                         NULL,
+                         NULL,
+                         name)};
+  }
+  if (op == "POOL2D") {
+    // Square windows only, as in the Python importer
+    check_num_args(node, 5);
+    int kernel = parse_int(args[0]);
+    int stride = parse_int(args[1]);
+    int padding = parse_int(args[2]);
+    return {model.pool2d(get_input(outputs, node, 0),
+                         kernel,
+                         kernel,
+                         stride,
+                         stride,
+                         padding,
+                         padding,
+                         static_cast<PoolType>(parse_int(args[3])),
+                         static_cast<ActiMode>(parse_int(args[4])),
+                         name)};
+  }
+  if (op == "EMBEDDING") {
+    check_num_args(node, 2);
+    Initializer *kernel_initializer = new NormInitializer(42, 0.0f, 1.0f);
+    return {model.embedding(get_input(outputs, node, 0),
+                            parse_int(args[0]),
+                            parse_int(args[1]),
+                            AGGR_MODE_NONE,
+                            NULL,
+                            kernel_initializer,
+                            name)};
+  }
+  if (op == "BATCH_NORM") {
+    return {model.batch_norm(get_input(outputs, node, 0), true, name)};
+  }
+  if (op == "SOFTMAX") {
+    return {model.softmax(get_input(outputs, node, 0), -1, name)};
+  }
+  if (op == "DROPOUT") {
+    check_num_args(node, 1);
+    return {model.dropout(
+        get_input(outputs, node, 0), parse_float(args[0]), 0, name)};
+  }
+  if (op == "FLAT") {
+    return {model.flat(get_input(outputs, node, 0), name)};
+  }
+  if (op == "RELU") {
+    return {model.relu(get_input(outputs, node, 0), true, name)};
+  }
+  if (op == "SIGMOID") {
+    return {model.sigmoid(get_input(outputs, node, 0), name)};
+  }
+  if (op == "TANH") {
+    return {model.tanh(get_input(outputs, node, 0), name)};
+  }
+  if (op == "ELU") {
+    return {model.elu(get_input(outputs, node, 0), true, name)};
+  }
+  if (op == "GELU") {
+    return {model.gelu(get_input(outputs, node, 0), name)};
+  }
+  // LAYER_NORM and EXPAND nodes do not carry their parameters, so they are
+  // unsupported rather than imported as identities
+  if (op == "IDENTITY") {
+    return {model.identity(get_input(outputs, node, 0), name)};
+  }
+  if (op == "SCALAR_ADD" || op == "SCALAR_SUB" || op == "SCALAR_MULTIPLY" ||
+      op == "SCALAR_TRUEDIV") {
+    check_num_args(node, 1);
+    Tensor input = get_input(outputs, node, 0);
+    float scalar = parse_float(args[0]);
+    if (op == "SCALAR_ADD") {
+      return {model.scalar_add(input, scalar, true, name)};
+    } else if (op == "SCALAR_SUB") {
+      return {model.scalar_sub(input, scalar, true, name)};
+    } else if (op == "SCALAR_MULTIPLY") {
+      return {model.scalar_multiply(input, scalar, true, name)};
+    } else {
+      return {model.scalar_truediv(input, scalar, true, name)};
+    }
+  }
+  if (op == "ADD") {
+    return {model.add(
+        get_input(outputs, node, 0), get_input(outputs, node, 1), false, name)};
+  }
+  if (op == "MULTIPLY") {
+    return {model.multiply(
+        get_input(outputs, node, 0), get_input(outputs, node, 1), false, name)};
+  }
+  if (op == "BATCH_MATMUL") {
+    return {model.batch_matmul(get_input(outputs, node, 0),
+                               get_input(outputs, node, 1),
+                               -1,
+                               -1,
+                               name)};
+  }
+  if (op == "POW") {
+    check_num_args(node, 1);
+    return {model.pow(
+        get_input(outputs, node, 0), parse_float(args[0]), true, name)};
+  }
+  if (op == "RSQRT") {
+    return {model.rsqrt(get_input(outputs, node, 0), true, name)};
+  }
+  if (op == "MEAN") {
+    check_num_args(node, 1);
+    Tensor input = get_input(outputs, node, 0);
+    std::vector<int> dims;
+    bool keepdims = false;
+    for (std::string const &arg : args) {
+      if (arg == "True" || arg == "False") {
+        keepdims = (arg == "True");
+      } else {
+        dims.push_back(get_torch_dim(parse_int(arg), input->num_dims));
+      }
+    }
+    return {model.mean(input, dims, keepdims, name)};
+  }
+  if (op == "CONCAT") {
+    check_num_args(node, 1);
+    std::vector<Tensor> inputs;
+    for (size_t i = 0; i < node.innodes.size(); i++) {
+      inputs.push_back(get_input(outputs, node, i));
+    }
+    return {model.concat(
+        (int)inputs.size(), inputs.data(), parse_int(args[0]), name)};
+  }
+  if (op == "SPLIT") {
+    // Splits evenly into one tensor per user
+    check_num_args(node, 1);
+    Tensor input = get_input(outputs, node, 0);
+    int axis = parse_int(args[0]);
+    int num_splits = (int)node.outnodes.size();
+    std::vector<int> shape = get_torch_shape(input);
+    int dim = get_torch_dim(axis, (int)shape.size());
+    if (num_splits == 0 || shape[dim] % num_splits != 0) {
+      fx_error("cannot split node " + node.name + " evenly into " +
+               std::to_string(num_splits) + " tensors");
+    }
+    std::vector<int> sizes(num_splits, shape[dim] / num_splits);
+    std::vector<Tensor> results(num_splits);
+    model.split(input, results.data(), sizes, axis, name);
+    return results;
+  }
+  if (op == "TRANSPOSE") {
+    check_num_args(node, 2);
+    Tensor input = get_input(outputs, node, 0);
+    std::vector<int> perm(input->num_dims);
+    for (int i = 0; i < input->num_dims; i++) {
+      perm[i] = i;
+    }
+    std::swap(perm[get_torch_dim(parse_int(args[0]), input->num_dims)],
+              perm[get_torch_dim(parse_int(args[1]), input->num_dims)]);
+    return {model.transpose(input, perm, name)};
+  }
+  if (op == "PERMUTE") {
+    std::vector<int> perm;
+    for (std::string const &arg : args) {
+      perm.push_back(parse_int(arg));
+    }
+    return {model.transpose(get_input(outputs, node, 0), perm, name)};
+  }
+  if (op == "RESHAPE" || op == "VIEW") {
+    check_num_args(node, 1);
+    Tensor input = get_input(outputs, node, 0);
+    std::vector<int> shape;
+    if (args[0].back() == ',') {
+      // Reshaped as another node's output
+      std::vector<std::string> others = parse_fx_node_names(args[0]);
+      std::vector<Tensor> other;
+      if (others.size() == 1) {
+        other = get_outputs(outputs, others[0]);
+      }
+      if (other.size() != 1) {
+        fx_error(op + " node " + node.name + " must be shaped as one tensor");
+      }
+      shape = get_torch_shape(other[0]);
+    } else {
+      for (std::string const &arg : args) {
+        shape.push_back(parse_int(arg));
+      }
+    }
+    return {model.reshape(input, get_view_shape(input, shape), name)};
+  }
+  if (op == "UNSQUEEZE") {
+    check_num_args(node, 1);
+    Tensor input = get_input(outputs, node, 0);
+    std::vector<int> shape = get_torch_shape(input);
+    int dim = get_torch_dim(parse_int(args[0]), (int)shape.size() + 1);
+    shape.insert(shape.begin() + dim, 1);
+    return {model.reshape(input, shape, name)};
+  }
+  if (op == "GETITEM") {
+    check_num_args(node, 1);
+    int index;
+    if (try_parse_int(args[0], index)) {
+      // Element of a tuple
+      if (node.innodes.empty()) {
+        fx_error("GETITEM node " + node.name + " has no input");
+      }
+      std::vector<Tensor> const &tuple =
+          get_outputs(outputs, node.innodes[0]);
+      if (index < 0 || index >= (int)tuple.size()) {
+        fx_error("index " + args[0] + " of node " + node.name +
+                 " is out of range");
+      }
+      return {tuple[index]};
+    }
+    return {slice_tensor(model, get_input(outputs, node, 0), args, name)};
+  }
+  if (op == "GETATTR") {
+    // Only shapes are read, and they are read from the tensor itself
+    check_num_args(node, 1);
+    if (args[0] != "shape" || node.innodes.empty()) {
+      fx_error("unsupported attribute: " + args[0]);
+    }
+    return get_outputs(outputs, node.innodes[0]);
+  }
+  // Casts and layout changes do not change the values
+  if (op == "TO" || op == "FLOAT" || op == "TYPE_AS" || op == "CONTIGUOUS") {
+    return {get_input(outputs, node, 0)};
+  }
+  // ATTRIBUTE nodes need the PyTorch parameters, which are not serialized
+  fx_error("unsupported op type " + op + " of node " + node.name);
+}
+
+std::vector<Tensor> import_fx_graph(FFModel &model,
+                                    std::istream &graph,
+                                    std::vector<Tensor> const &inputs) {
+  FXNodeOutputs node_outputs;
+  std::vector<Tensor> outputs;
+  size_t num_inputs = 0;
+  std::string line;
+  FXNode node;
+  while (std::getline(graph, line)) {
+    if (!parse_fx_node(line, node)) {
+      continue;
+    }
+    if (node.op_type == "INPUT") {
+      if (num_inputs == inputs.size()) {
+        fx_error("the graph has more than " + std::to_string(inputs.size()) +
+                 " inputs");
+      }
+      node_outputs[node.name] = {inputs[num_inputs++]};
+    } else if (node.op_type == "OUTPUT") {
+      for (std::string const &innode : node.innodes) {
+        std::vector<Tensor> const &tensors = get_outputs(node_outputs, innode);
+        outputs.insert(outputs.end(), tensors.begin(), tensors.end());
+      }
+    } else {
+      node_outputs[node.name] = import_fx_node(model, node, node_outputs);
+    }
+  }
+  if (num_inputs != inputs.size()) {
+    fx_error("the graph has " + std::to_string(num_inputs) + " inputs but " +
+             std::to_string(inputs.size()) + " tensors were given");
+  }
+  return outputs;
+}
+
+std::vector<Tensor> import_fx_file(FFModel &model,
+                                   std::string const &filename,
+                                   std::vector<Tensor> const &inputs) {
+  std::ifstream file(filename);
+  if (!file.good()) {
+    fx_error("cannot open " + filename);
+  }
+  return import_fx_graph(model, file, inputs);
+}
+
+}; // namespace FlexFlow
@@ -35,6 +35,7 @@
 #include "flexflow/utils/disjoint_set.h"
 #include "legion.h"
 #include "legion/legion_utilities.h"
+#include <set>
 
 namespace FlexFlow::PCG {
 
@@ -451,7 +452,7 @@ bool Graph::has_loop(void) {
   size_t i = 0;
   while (i < opList.size()) {
     Node op = opList[i++];
-    auto const &outList = outEdges[op];
+    auto const &outList = outEdges.at(op);
     for (auto const &it2 : outList) {
       todos[it2.dstOp]--;
       if (todos[it2.dstOp] == 0) {
@@ -1287,6 +1288,17 @@ T SearchHelper::estimate_xfer_cost(Graph const *graph,
       // source.node.ptr->name, sink.node.ptr->name, estimated_xfer_cost);
       op_cost += estimated_xfer_cost;
     }
+    // apply_fusion fuses the sink into the source if they share a view, so
+    // credit the fused cost here and let the views chosen reflect it
+    if (this->model->config.perform_fusion && source.view == sink.view) {
+      float saving = this->model->simulator->estimate_fusion_saving(
+          source.node.ptr, sink.node.ptr);
+      CostMetrics sink_cost = this->model->simulator->measure_operator_cost(
+          sink.node.ptr, sink.view);
+      // never credit more than the sink itself costs
+      op_cost -=
+          std::min(saving, sink_cost.forward_time + sink_cost.backward_time);
+    }
     this->add_operator_cost<T>(source, op_cost, &result);
   } else {
     Node real_source = graph->find_source_node();
@@ -1521,6 +1533,101 @@ size_t dp_state_hash(Graph const *graph,
   return key;
 }
 
+void Graph::compute_task_priorities(
+    std::unordered_map<Node, MachineView> const &optimal_views,
+    std::unordered_map<Node, NodeTaskPriority> &priorities) const {
+  // Topological order of the graph
+  std::unordered_map<Node, int> todos;
+  std::vector<Node> opList;
+  for (auto const &it : this->inEdges) {
+    todos[it.first] = (int)it.second.size();
+    if (todos[it.first] == 0) {
+      opList.push_back(it.first);
+    }
+  }
+  for (size_t i = 0; i < opList.size(); i++) {
+    auto const &outList = this->outEdges.find(opList[i])->second;
+    for (auto const &e : outList) {
+      if (--todos[e.dstOp] == 0) {
+        opList.push_back(e.dstOp);
+      }
+    }
+  }
+  assert(opList.size() == this->inEdges.size());
+  bool training = model->config.computationMode == COMP_MODE_TRAINING;
+  std::unordered_map<Node, CostMetrics> costs;
+  for (Node const &node : opList) {
+    assert(optimal_views.find(node) != optimal_views.end());
+    costs[node] = model->simulator->measure_operator_cost(
+        node.ptr, optimal_views.find(node)->second);
+  }
+  // The backward pass runs from the outputs to the inputs, so the remaining
+  // backward work after a node is the longest chain towards its producers
+  std::unordered_map<Node, float> bwd_level, fwd_level;
+  for (Node const &node : opList) {
+    float level = 0.0f;
+    for (auto const &e : this->inEdges.find(node)->second) {
+      level = std::max(level, bwd_level[e.srcOp]);
+    }
+    bwd_level[node] = training ? level + costs[node].backward_time : 0.0f;
+  }
+  // The forward level of a node also includes its own backward chain, since
+  // the backward pass cannot start before the whole forward pass is done
+  float max_level = 0.0f;
+  for (auto it = opList.rbegin(); it != opList.rend(); it++) {
+    float level = bwd_level[*it];
+    for (auto const &e : this->outEdges.find(*it)->second) {
+      level = std::max(level, fwd_level[e.dstOp]);
+    }
+    fwd_level[*it] = level + costs[*it].forward_time;
+    max_level = std::max(max_level, fwd_level[*it]);
+  }
+  if (max_level <= 0.0f) {
+    max_level = 1.0f;
+  }
+  // Parameter updates are off the critical path of the current iteration,
+  // but the weights of early layers are the first ones needed by the next
+  // forward pass, so their synchronization is scheduled first
+  float max_update = 0.0f;
+  std::unordered_map<Node, float> upd_level;
+  for (size_t i = 0; i < opList.size(); i++) {
+    Node const &node = opList[i];
+    float level = max_level * (1.0f - (float)i / opList.size()) +
+                  costs[node].sync_time;
+    upd_level[node] = level;
+    max_update = std::max(max_update, level);
+  }
+  if (max_update <= 0.0f) {
+    max_update = 1.0f;
+  }
+  priorities.clear();
+  for (Node const &node : opList) {
+    NodeTaskPriority p;
+    p.forward = (int)(MAX_TASK_PRIORITY * fwd_level[node] / max_level);
+    p.backward = (int)(MAX_TASK_PRIORITY * bwd_level[node] / max_level);
+    p.update = training ? (int)(MAX_TASK_PRIORITY * upd_level[node] / max_update)
+                        : 0;
+    priorities[node] = p;
+  }
+}
+
+size_t GraphOptimalViewSerialized::legion_buffer_size(void) const {
+  return sizeof(size_t) + data.size();
+}
+
+void GraphOptimalViewSerialized::legion_serialize(void *buffer) const {
+  size_t size = data.size();
+  memcpy(buffer, &size, sizeof(size_t));
+  memcpy((char *)buffer + sizeof(size_t), data.data(), size);
+}
+
+void GraphOptimalViewSerialized::legion_deserialize(void const *buffer) {
+  size_t size;
+  memcpy(&size, buffer, sizeof(size_t));
+  char const *bytes = (char const *)buffer + sizeof(size_t);
+  data.assign(bytes, bytes + size);
+}
+
 GraphOptimalViewSerialized
     Graph::graph_optimize_task(Task const *task,
                                std::vector<PhysicalRegion> const &regions,
@@ -1534,12 +1641,14 @@ GraphOptimalViewSerialized
     model->config.workersPerNode = model->config.search_num_workers.value();
   }
   model->all_valid_views.clear();
+  // GPUs within a node are interchangeable in the simple machine model
   model->register_all_machine_views(model->config.numNodes,
                                     model->config.workersPerNode,
                                     model->config.cpusPerNode,
-                                    model->all_valid_views);
+                                    model->all_valid_views,
+                                    model->config.machine_model_version == 0);
   Memory gpu_mem = Machine::MemoryQuery(Machine::get_machine())
-                       .only_kind(Memory::GPU_FB_MEM)
+                       .only_kind(WORKER_MEM_KIND)
                        .best_affinity_to(task->target_proc)
                        .first();
   MachineModel *machine;
@@ -1610,14 +1719,14 @@ GraphOptimalViewSerialized
   size_t node_idx = 0;
   while (node_idx < opList.size()) {
     Node cur_node = opList[node_idx++];
-    auto const &outList = best_graph->outEdges[cur_node];
+    auto const &outList = best_graph->outEdges.at(cur_node);
     for (auto const &e : outList) {
       todos[e.dstOp]--;
       if (todos[e.dstOp] == 0) {
         opList.push_back(e.dstOp);
       }
     }
-    auto const &inList = best_graph->inEdges[cur_node];
+    auto const &inList = best_graph->inEdges.at(cur_node);
     sez.serialize(inList.size());
     for (auto const &e : inList) {
       sez.serialize(e.srcOp.guid);
@@ -1683,6 +1792,7 @@ GraphOptimalViewSerialized
         sez.serialize(attn->bias);
         sez.serialize(attn->add_bias_kv);
         sez.serialize(attn->add_zero_attn);
+        sez.serialize(attn->causal);
         break;
       }
       case OP_SOFTMAX: {
@@ -1736,8 +1846,17 @@ GraphOptimalViewSerialized
     sez.serialize(it.first.guid);
     sez.serialize(it.second);
   }
+  // Third, serialize task priorities along the simulated critical path
+  std::unordered_map<Node, NodeTaskPriority> priorities;
+  best_graph->compute_task_priorities(optimal_views, priorities);
+  sez.serialize(priorities.size());
+  for (auto const &it : priorities) {
+    sez.serialize((size_t)34567890); // safe guard
+    sez.serialize(it.first.guid);
+    sez.serialize(it.second);
+  }
 #ifdef DEADCODE
-  // Third, serialize input mappings
+  // Fourth, serialize input mappings
   sez.serialize((size_t)23456789);
   size_t num_inputs = 0;
   for (size_t i = 0; i < model->layers.size(); i++)
@@ -1752,10 +1871,9 @@ GraphOptimalViewSerialized
     }
   }
 #endif
-  assert(sez.get_used_bytes() < GraphOptimalViewSerialized::buffer_size);
   GraphOptimalViewSerialized ret;
-  ret.total_bytes = sez.get_used_bytes();
-  memcpy(ret.data, sez.get_buffer(), ret.total_bytes);
+  char const *buffer = (char const *)sez.get_buffer();
+  ret.data.assign(buffer, buffer + sez.get_used_bytes());
   // Deallocate best_graph
   // delete best_graph;
   return ret;
@@ -1769,38 +1887,92 @@ using PCG::Edge;
 using PCG::Graph;
 using PCG::GraphCostResult;
 using PCG::Node;
+using PCG::NodeTaskPriority;
+
+// Views of up to this many dimensions are enumerated for the search
+static int const MAX_ENUMERATED_VIEW_DIMS = 2;
+
+// Appends the views extending view's first num_dims dimensions: every
+// dimension has a degree of at least 2, and degrees and strides divide
+// num_devices. Strides grow innermost-last, so compact views come first
+static void enumerate_machine_views(MachineView &view,
+                                    int num_dims,
+                                    int num_parts,
+                                    int num_devices,
+                                    std::vector<int> const &divisors,
+                                    std::vector<MachineView> &views) {
+  if (num_dims > 0) {
+    view.ndims = num_dims;
+    std::vector<int> ids = view.device_ids();
+    // Skip views that map two parts to one device
+    if (std::unordered_set<int>(ids.begin(), ids.end()).size() == ids.size()) {
+      views.push_back(view);
+    }
+  }
+  if (num_dims == MAX_ENUMERATED_VIEW_DIMS) {
+    return;
+  }
+  int span = 0;
+  for (int i = 0; i < num_dims; i++) {
+    span += (view.dim[i] - 1) * view.stride[i];
+  }
+  for (int degree : divisors) {
+    if (degree < 2 || (num_devices / num_parts) % degree != 0) {
+      continue;
+    }
+    for (int stride : divisors) {
+      // The last device must exist
+      if (span + (degree - 1) * stride >= num_devices) {
+        break;
+      }
+      view.dim[num_dims] = degree;
+      view.stride[num_dims] = stride;
+      enumerate_machine_views(view,
+                              num_dims + 1,
+                              num_parts * degree,
+                              num_devices,
+                              divisors,
+                              views);
+    }
+  }
+  view.ndims = num_dims;
+}
 
 void FFModel::register_all_machine_views(
     int num_nodes,
     int gpus_per_node,
     int cpus_per_node,
-    std::vector<MachineView> &valid_views) {
-  // Single-parallelism-dimension views
-  for (int i = 1; i <= num_nodes * gpus_per_node; i++) {
-    if (num_nodes * gpus_per_node % i == 0) {
-      MachineView view;
-      view.device_type = MachineView::GPU;
-      view.ndims = 1;
-      view.dim[0] = i;
-      view.stride[0] = 1;
-      view.start_device_id = 0;
-      valid_views.push_back(view);
+    std::vector<MachineView> &valid_views,
+    bool symmetric_gpus) {
+  int num_gpus = num_nodes * gpus_per_node;
+  std::vector<int> divisors;
+  for (int i = 1; i <= num_gpus; i++) {
+    if (num_gpus % i == 0) {
+      divisors.push_back(i);
+    }
+  }
+  std::vector<MachineView> views;
+  MachineView view;
+  view.device_type = MachineView::GPU;
+  view.start_device_id = 0;
+  // The single-device view
+  view.ndims = 1;
+  view.dim[0] = 1;
+  view.stride[0] = 1;
+  views.push_back(view);
+  // Strided views of one or more dimensions, e.g. node x GPU grids
+  enumerate_machine_views(view, 0, 1, num_gpus, divisors, views);
+  // Keep the first, most compact view of each class of views that are
+  // equivalent under machine symmetry, since they cost the same. The
+  // mapper registers views without symmetric_gpus, which keeps a superset
+  // of the views kept with it
+  std::set<std::vector<int>> symmetry_keys;
+  for (MachineView const &v : views) {
+    if (symmetry_keys.insert(v.get_symmetry_key(gpus_per_node, symmetric_gpus))
+            .second) {
+      valid_views.push_back(v);
     }
   }
-  // Two-dimensional views
-  /* for (int i = 1; i <= num_nodes; i++) { */
-  /*   for (int j = 1; j <= gpus_per_node; j++) { */
-  /*     MachineView view; */
-  /*     view.device_type = MachineView::GPU; */
-  /*     view.ndims = 2; */
-  /*     view.dim[0] = i; */
-  /*     view.stride[0] = 1; */
-  /*     view.dim[1] = j; */
-  /*     view.stride[1] = 1; */
-  /*     view.start_device_id = 0; */
-  /*     valid_views.push_back(view); */
-  /*   } */
-  /* } */
 }
 
 float FFModel::graph_cost(Graph const *graph,
@@ -1843,7 +2015,8 @@ void FFModel::construct_optimal_view(
 void FFModel::deserialize_graph_optimal_view(
     Legion::Deserializer &dez,
     Graph *graph,
-    std::unordered_map<Node, MachineView> &optimal_views) {
+    std::unordered_map<Node, MachineView> &optimal_views,
+    std::unordered_map<Node, NodeTaskPriority> &priorities) {
   // Deserializer dez(serialized.data, serialized.total_bytes);
   std::unordered_map<size_t, Node> guid_to_nodes;
   size_t num_nodes;
@@ -1990,7 +2163,7 @@ void FFModel::deserialize_graph_optimal_view(
         assert(num_inputs == 3);
         int embed_dim, num_heads, k_dim, v_dim;
         float dropout;
-        bool bias, add_bias_kv, add_zero_attn;
+        bool bias, add_bias_kv, add_zero_attn, causal;
         size_t id;
         dez.deserialize(id);
         LayerID layer_guid(id);
@@ -2002,6 +2175,7 @@ void FFModel::deserialize_graph_optimal_view(
         dez.deserialize(bias);
         dez.deserialize(add_bias_kv);
         dez.deserialize(add_zero_attn);
+        dez.deserialize(causal);
         node = get_or_create_multihead_attn_node(layer_guid,
                                                  inputs[0],
                                                  inputs[1],
@@ -2013,7 +2187,8 @@ void FFModel::deserialize_graph_optimal_view(
                                                  dropout,
                                                  bias,
                                                  add_bias_kv,
-                                                 add_zero_attn);
+                                                 add_zero_attn,
+                                                 causal);
         break;
       }
       case OP_SOFTMAX: {
@@ -2106,8 +2281,21 @@ void FFModel::deserialize_graph_optimal_view(
     dez.deserialize(view);
     optimal_views[guid_to_nodes[guid]] = view;
   }
+  // Third, deserialize task priorities
+  size_t num_priorities;
+  dez.deserialize(num_priorities);
+  for (size_t i = 0; i < num_priorities; i++) {
+    size_t safecode, guid;
+    NodeTaskPriority priority;
+    dez.deserialize(safecode);
+    assert(safecode == 34567890);
+    dez.deserialize(guid);
+    assert(guid_to_nodes.find(guid) != guid_to_nodes.end());
+    dez.deserialize(priority);
+    priorities[guid_to_nodes[guid]] = priority;
+  }
 #ifdef DEADCODE
-  // Third, deserialize input mappings
+  // Fourth, deserialize input mappings
   size_t num_inputs, safecode;
   dez.deserialize(safecode);
   assert(safecode == 23456789);
@@ -327,6 +327,8 @@ miopenDataType_t ff_to_cudnn_datatype(DataType type) {
     case DT_DOUBLE:
       // FIXME assert(0);
       return miopenFloat;
+    case DT_HALF:
+      return miopenHalf;
     case DT_INT32:
       return miopenInt32;
     default:
@@ -341,6 +343,8 @@ hipblasDatatype_t ff_to_cuda_datatype(DataType type) {
       return HIPBLAS_R_32F;
     case DT_DOUBLE:
       return HIPBLAS_R_64F;
+    case DT_HALF:
+      return HIPBLAS_R_16F;
     case DT_INT32:
       return HIPBLAS_R_32I;
     default:
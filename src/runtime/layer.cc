@@ -1,6 +1,8 @@
 #include "flexflow/layer.h"
+#include "flexflow/compile_cache.h"
 #include "flexflow/ffconst_utils.h"
 #include "flexflow/model.h"
+#include <map>
 
 namespace FlexFlow {
 
@@ -131,6 +133,60 @@ bool Layer::get_initializer(std::string const &key,
   }
 }
 
+static void append_tensor_to_key(CompileCacheKey &key, const Tensor tensor) {
+  key.append(tensor->tensor_guid);
+  key.append(tensor->data_type);
+  key.append(tensor->num_dims);
+  for (int i = 0; i < tensor->num_dims; i++) {
+    key.append(tensor->dims[i]);
+  }
+}
+
+void Layer::append_to_key(CompileCacheKey &key) const {
+  key.append(op_type);
+  key.append(data_type);
+  key.append(layer_guid.id);
+  key.append(numInputs);
+  for (int i = 0; i < numInputs; i++) {
+    append_tensor_to_key(key, inputs[i]);
+    key.append(trainableInputs[i]);
+  }
+  key.append(numWeights);
+  for (int i = 0; i < numWeights; i++) {
+    append_tensor_to_key(key, weights[i]);
+  }
+  key.append(numOutputs);
+  for (int i = 0; i < numOutputs; i++) {
+    append_tensor_to_key(key, outputs[i]);
+  }
+  // the property maps are unordered, so go through them by key
+  std::map<std::string, long long> ints(int_properties.begin(),
+                                        int_properties.end());
+  key.append(ints.size());
+  for (auto const &it : ints) {
+    key.append(it.first);
+    key.append(it.second);
+  }
+  std::map<std::string, float> floats(float_properties.begin(),
+                                      float_properties.end());
+  key.append(floats.size());
+  for (auto const &it : floats) {
+    key.append(it.first);
+    key.append(it.second);
+  }
+  std::map<std::string, std::vector<int>> int_vectors(
+      int_vector_properties.begin(), int_vector_properties.end());
+  key.append(int_vectors.size());
+  for (auto const &it : int_vectors) {
+    key.append(it.first);
+    key.append(it.second.size());
+    for (int value : it.second) {
+      key.append(value);
+    }
+  }
+  // initializers do not affect the search
+}
+
 void Layer::print() {}
 
 Tensor Layer::get_parameter(int index) {
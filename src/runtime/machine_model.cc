@@ -302,6 +302,12 @@ EnhancedMachineModel::EnhancedMachineModel(std::string file,
         } else if (words[0] == "nvlink_bandwidth") {
           nvlink_bandwidth = stof(words[2]);
           printf("nvlink_bandwidth = %f\n", nvlink_bandwidth);
+        } else if (words[0] == "gpu_fb_mem_bandwidth") {
+          gpu_fb_mem_bandwidth = stof(words[2]) * 1024 * 1024;
+          printf("gpu_fb_mem_bandwidth = %f\n", stof(words[2]));
+        } else if (words[0] == "task_launch_overhead") {
+          task_launch_overhead = stof(words[2]);
+          printf("task_launch_overhead = %f\n", task_launch_overhead);
         } else if (words[0] == "intra_socket_sys_mem_to_sys_mem") {
           printf("intra_socket_sys_mem_to_sys_mem = ");
           for (size_t i = 2; i < words.size(); i++) {
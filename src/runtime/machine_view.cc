@@ -1,4 +1,5 @@
 #include "flexflow/machine_view.h"
+#include <unordered_map>
 
 namespace FlexFlow {
 
@@ -38,6 +39,34 @@ std::vector<int> MachineView::device_ids() const {
   return device_ids_list;
 }
 
+std::vector<int> MachineView::get_symmetry_key(int devices_per_node,
+                                              bool relabel_devices) const {
+  assert(devices_per_node > 0);
+  std::vector<int> key = {device_type, ndims};
+  for (int i = 0; i < ndims; i++) {
+    key.push_back(dim[i]);
+  }
+  std::unordered_map<int, int> node_labels, device_labels;
+  std::unordered_map<int, int> num_labeled_devices;
+  for (int device_id : device_ids()) {
+    int node = device_id / devices_per_node;
+    if (node_labels.find(node) == node_labels.end()) {
+      int label = node_labels.size();
+      node_labels[node] = label;
+    }
+    int device = device_id % devices_per_node;
+    if (relabel_devices) {
+      if (device_labels.find(device_id) == device_labels.end()) {
+        device_labels[device_id] = num_labeled_devices[node]++;
+      }
+      device = device_labels[device_id];
+    }
+    key.push_back(node_labels[node]);
+    key.push_back(device);
+  }
+  return key;
+}
+
 size_t MachineView::num_parts() const {
   size_t parts = 1;
   for (int i = 0; i < ndims; i++) {
@@ -0,0 +1,255 @@
+/* Copyright 2021 CMU, Facebook, LANL, MIT, and Stanford (alphabetical)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flexflow/memory_planner.h"
+#include "flexflow/model.h"
+#include "flexflow/simulator.h"
+#include <algorithm>
+#include <cassert>
+#include <unordered_set>
+
+namespace FlexFlow {
+
+using namespace Legion;
+
+MemoryPlanner::MemoryPlanner(size_t _alignment) : alignment(_alignment) {
+  assert(alignment > 0);
+}
+
+void MemoryPlanner::add_buffer(BufferLifetime const &buffer) {
+  assert(buffer.first_use <= buffer.last_use);
+  buffers.push_back(buffer);
+}
+
+static bool lifetimes_overlap(BufferLifetime const &a,
+                              BufferLifetime const &b) {
+  return !(a.last_use < b.first_use || b.last_use < a.first_use);
+}
+
+MemoryPlan MemoryPlanner::plan() const {
+  MemoryPlan plan;
+  std::map<int, std::vector<BufferLifetime>> device_buffers;
+  for (BufferLifetime const &b : buffers) {
+    device_buffers[b.device].push_back(b);
+  }
+  for (auto &it : device_buffers) {
+    int device = it.first;
+    std::vector<BufferLifetime> &list = it.second;
+    // Placing the largest buffers first keeps the arena close to the peak of
+    // live memory, since smaller buffers fill the gaps left between them
+    std::sort(list.begin(),
+              list.end(),
+              [](BufferLifetime const &a, BufferLifetime const &b) {
+                if (a.size != b.size) {
+                  return a.size > b.size;
+                }
+                return a.first_use < b.first_use;
+              });
+    std::vector<std::pair<BufferLifetime, size_t>> placed;
+    size_t arena_size = 0, naive_size = 0;
+    for (BufferLifetime const &b : list) {
+      size_t size = (b.size + alignment - 1) / alignment * alignment;
+      naive_size += size;
+      // Offsets occupied by buffers live at the same time
+      std::vector<std::pair<size_t, size_t>> occupied;
+      for (auto const &p : placed) {
+        if (lifetimes_overlap(p.first, b)) {
+          size_t p_size =
+              (p.first.size + alignment - 1) / alignment * alignment;
+          occupied.push_back({p.second, p.second + p_size});
+        }
+      }
+      std::sort(occupied.begin(), occupied.end());
+      // Take the lowest gap that fits
+      size_t offset = 0;
+      for (auto const &range : occupied) {
+        if (offset + size <= range.first) {
+          break;
+        }
+        offset = std::max(offset, range.second);
+      }
+      placed.push_back({b, offset});
+      plan.offsets[b.id] = offset;
+      arena_size = std::max(arena_size, offset + size);
+    }
+    // Largest amount of memory live at any step, a lower bound for any plan
+    size_t live_size = 0;
+    for (BufferLifetime const &b : list) {
+      size_t size = 0;
+      for (BufferLifetime const &other : list) {
+        if (other.first_use <= b.first_use && b.first_use <= other.last_use) {
+          size += (other.size + alignment - 1) / alignment * alignment;
+        }
+      }
+      live_size = std::max(live_size, size);
+    }
+    plan.planned_bytes[device] = arena_size;
+    plan.naive_bytes[device] = naive_size;
+    plan.live_bytes[device] = live_size;
+  }
+  return plan;
+}
+
+static bool can_share_region(ParallelTensor a, ParallelTensor b) {
+  if (a->data_type != b->data_type || a->num_dims != b->num_dims) {
+    return false;
+  }
+  if (!(a->machine_view == b->machine_view)) {
+    return false;
+  }
+  for (int i = 0; i < a->num_dims; i++) {
+    if (a->dims[i].size != b->dims[i].size ||
+        a->dims[i].degree != b->dims[i].degree ||
+        a->dims[i].parallel_idx != b->dims[i].parallel_idx ||
+        a->dims[i].is_replica_dim != b->dims[i].is_replica_dim) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void FFModel::plan_activation_memory(
+    std::unordered_map<ParallelTensor, ParallelTensor> &shared_regions) {
+  bool training = config.computationMode == COMP_MODE_TRAINING;
+  int num_ops = (int)operators.size();
+  // Forward steps are 0 .. num_ops - 1; in training, the backward of
+  // operators[l] runs at step 2 * num_ops - 1 - l
+  int last_step = training ? 2 * num_ops - 1 : num_ops - 1;
+  std::unordered_map<Op const *, int> op_index;
+  for (int l = 0; l < num_ops; l++) {
+    op_index[operators[l]] = l;
+  }
+  auto bwd_edge_map = get_bwd_edge_map();
+  Op const *final_op = get_final_operator();
+
+  MemoryPlanner planner;
+  std::vector<ParallelTensor> tensors;
+  std::unordered_map<ParallelTensor, std::pair<int, int>> lifetimes;
+  std::unordered_set<ParallelTensor> pinned;
+  for (int l = 0; l < num_ops; l++) {
+    Op *op = operators[l];
+    int last_consumer = l;
+    bool pin = op->op_type == OP_INPUT || op == final_op ||
+               op->is_parallel_op() ||
+               (config.enable_inplace_optimizations && op->can_inplace_output());
+    if (bwd_edge_map.find(op) != bwd_edge_map.end()) {
+      for (auto const &e : bwd_edge_map.at(op)) {
+        last_consumer = std::max(last_consumer, op_index.at(e.first));
+        // Parallel operators partition their input region, and inplace
+        // operators write their output into it
+        pin = pin || e.first->is_parallel_op() ||
+              (config.enable_inplace_optimizations &&
+               e.first->can_inplace_output());
+      }
+    }
+    for (int i = 0; i < op->numOutputs; i++) {
+      ParallelTensor tensor = op->outputs[i];
+      // The data loader writes inputs before the iteration starts, and the
+      // loss and metrics read the final output after the forward pass
+      int first_use = op->op_type == OP_INPUT ? 0 : l;
+      int last_use = last_consumer;
+      if (op == final_op) {
+        last_use = last_step;
+      } else if (training) {
+        // Activations are kept until the backward of their producer
+        last_use = last_step - l;
+      }
+      tensors.push_back(tensor);
+      lifetimes[tensor] = {first_use, last_use};
+      if (pin) {
+        pinned.insert(tensor);
+      }
+      size_t num_parts = tensor->get_total_num_parts();
+      size_t shard_size = tensor->get_volume() / num_parts *
+                          data_type_size(tensor->data_type);
+      std::vector<int> devices = tensor->machine_view.device_ids();
+      for (int device : devices) {
+        BufferLifetime buffer;
+        buffer.id =
+            (tensor->parallel_tensor_guid * MAX_NUM_WORKERS + device) * 2;
+        buffer.device = device;
+        buffer.size = shard_size;
+        buffer.first_use = first_use;
+        buffer.last_use = last_use;
+        planner.add_buffer(buffer);
+        if (tensor->create_gradients && training) {
+          // Gradients are zeroed by zero_gradients() before the iteration
+          // and accumulated until the backward of their producer
+          buffer.id = buffer.id + 1;
+          buffer.first_use = 0;
+          buffer.last_use = last_step - l;
+          planner.add_buffer(buffer);
+        }
+      }
+    }
+  }
+  MemoryPlan plan = planner.plan();
+  for (auto const &it : plan.naive_bytes) {
+    fprintf(stderr,
+            "Memory planner: device(%d) activations naive %.2lf MB "
+            "planned %.2lf MB (live peak %.2lf MB)\n",
+            it.first,
+            it.second / 1024.0 / 1024.0,
+            plan.planned_bytes[it.first] / 1024.0 / 1024.0,
+            plan.live_bytes[it.first] / 1024.0 / 1024.0);
+  }
+
+  // Legion regions cannot be carved out of an arena, so tensors share a
+  // region when their shapes and machine views match. Gradients are zeroed
+  // at the start of every iteration and live through the whole training
+  // step, so regions are only shared in inference. Fused tasks may access
+  // several of these tensors at once, so fusion disables sharing as well
+  shared_regions.clear();
+  if (training || config.perform_fusion) {
+    return;
+  }
+  // Greedy interval coloring in the order of first use, which is optimal
+  // for interval graphs
+  std::vector<ParallelTensor> slots;
+  std::vector<int> slot_free_after;
+  size_t naive_bytes = 0, shared_bytes = 0;
+  for (ParallelTensor tensor : tensors) {
+    size_t bytes = tensor->get_volume() * data_type_size(tensor->data_type);
+    naive_bytes += bytes;
+    if (pinned.find(tensor) != pinned.end()) {
+      continue;
+    }
+    auto const &lifetime = lifetimes[tensor];
+    bool found = false;
+    for (size_t s = 0; s < slots.size(); s++) {
+      if (slot_free_after[s] < lifetime.first &&
+          can_share_region(slots[s], tensor)) {
+        shared_regions[tensor] = slots[s];
+        slot_free_after[s] = lifetime.second;
+        shared_bytes += bytes;
+        found = true;
+        break;
+      }
+    }
+    if (!found) {
+      slots.push_back(tensor);
+      slot_free_after.push_back(lifetime.second);
+    }
+  }
+  fprintf(stderr,
+          "Memory planner: %zu of %zu activation regions shared, "
+          "%.2lf MB -> %.2lf MB\n",
+          shared_regions.size(),
+          tensors.size(),
+          naive_bytes / 1024.0 / 1024.0,
+          (naive_bytes - shared_bytes) / 1024.0 / 1024.0);
+}
+
+}; // namespace FlexFlow
@@ -16,9 +16,12 @@
 #include "flexflow/model.h"
 #if defined(FF_USE_CUDA) || defined(FF_USE_HIP_CUDA)
 #include "flexflow/utils/cuda_helper.h"
-#else
+#elif defined(FF_USE_HIP_ROCM)
 #include "flexflow/utils/hip_helper.h"
+#else
+#include "flexflow/utils/cpu_helper.h"
 #endif
+#include "flexflow/compile_cache.h"
 #include "flexflow/ffconst_utils.h"
 #include "flexflow/graph.h"
 #include "flexflow/mapper.h"
@@ -58,7 +61,10 @@
 #include "flexflow/utils/test_utils.h"
 #include "legion/legion_utilities.h"
 #include <dirent.h>
+#include <map>
 #include <queue>
+#include <set>
+#include <tuple>
 #include <unordered_set>
 
 namespace FlexFlow {
@@ -100,9 +106,31 @@ Op::Op(FFModel &model,
        const ParallelTensor _input2,
        const ParallelTensor _input3,
        const ParallelTensor _input4)
-    : op_type(_op_type), op_guid(model.op_global_guid++), numInputs(_numInputs),
-      numWeights(_numWeights), numOutputs(_numOutputs),
-      profiling(model.config.profiling) {
+    : Op(model.op_global_guid++,
+         model.config.profiling,
+         _op_type,
+         _name,
+         _numInputs,
+         _numWeights,
+         _numOutputs,
+         _input1,
+         _input2,
+         _input3,
+         _input4) {}
+
+Op::Op(int _guid,
+       bool _profiling,
+       OperatorType _op_type,
+       char const *_name,
+       int _numInputs,
+       int _numWeights,
+       int _numOutputs,
+       const ParallelTensor _input1,
+       const ParallelTensor _input2,
+       const ParallelTensor _input3,
+       const ParallelTensor _input4)
+    : op_type(_op_type), op_guid(_guid), numInputs(_numInputs),
+      numWeights(_numWeights), numOutputs(_numOutputs), profiling(_profiling) {
   for (int i = 0; i < MAX_NUM_INPUTS; i++)
     inputs[i] = NULL;
   std::vector<ParallelTensor> tensors;
@@ -185,7 +213,7 @@ bool Op::can_inplace_output() {
   return false;
 }
 
-bool Op::has_inplace_output() {
+bool Op::has_inplace_output() const {
   return false;
 }
 
@@ -235,18 +263,25 @@ void Op::zero_grad(FFModel const &ff) {
   Context ctx = ff.config.lg_ctx;
   ArgumentMap argmap;
   ZeroInitMeta meta;
-  meta.num_regions = numWeights + numOutputs;
+  // Row-sparse gradients are rewritten by every backward pass
+  std::vector<ParallelTensor> dense_weights;
+  for (int i = 0; i < numWeights; i++) {
+    if (!weights[i]->sparse_grad)
+      dense_weights.push_back(weights[i]);
+  }
+  int num_dense_weights = dense_weights.size();
+  meta.num_regions = num_dense_weights + numOutputs;
   assert(meta.num_regions <= ZeroInitMeta::MAX_NUM_REGIONS);
   IndexSpace parallel_is = IndexSpace::NO_SPACE;
-  for (int i = 0; i < numWeights; i++) {
-    meta.data_types[i] = weights[i]->data_type;
+  for (int i = 0; i < num_dense_weights; i++) {
+    meta.data_types[i] = dense_weights[i]->data_type;
     if (parallel_is == IndexSpace::NO_SPACE)
-      parallel_is = weights[i]->parallel_is;
+      parallel_is = dense_weights[i]->parallel_is;
     else
-      assert(parallel_is == weights[i]->parallel_is);
+      assert(parallel_is == dense_weights[i]->parallel_is);
   }
   for (int i = 0; i < numOutputs; i++) {
-    meta.data_types[i + numWeights] = outputs[i]->data_type;
+    meta.data_types[i + num_dense_weights] = outputs[i]->data_type;
     if (parallel_is == IndexSpace::NO_SPACE)
       parallel_is = outputs[i]->parallel_is;
     else
@@ -260,12 +295,13 @@ void Op::zero_grad(FFModel const &ff) {
                          false /*must*/,
                          0 /*mapper_id*/,
                          outputs[0]->machine_view.hash());
-  for (int i = 0; i < numWeights; i++) {
-    launcher.add_region_requirement(RegionRequirement(weights[i]->part_grad,
-                                                      0 /*projection id*/,
-                                                      WRITE_ONLY,
-                                                      EXCLUSIVE,
-                                                      weights[i]->region_grad));
+  for (int i = 0; i < num_dense_weights; i++) {
+    launcher.add_region_requirement(
+        RegionRequirement(dense_weights[i]->part_grad,
+                          0 /*projection id*/,
+                          WRITE_ONLY,
+                          EXCLUSIVE,
+                          dense_weights[i]->region_grad));
     launcher.add_field(i, FID_DATA);
   }
   for (int i = 0; i < numOutputs; i++) {
@@ -278,7 +314,7 @@ void Op::zero_grad(FFModel const &ff) {
     // printf("zero_grad:output[%d]: region(%d,%d,%d)\n", i,
     // lr.get_index_space().get_id(), lr.get_field_space().get_id(),
     // lr.get_tree_id());
-    launcher.add_field(i + numWeights, FID_DATA);
+    launcher.add_field(i + num_dense_weights, FID_DATA);
   }
   runtime->execute_index_space(ctx, launcher);
 }
@@ -982,6 +1018,14 @@ void Op::set_argumentmap_for_backward(FFModel const &ff, ArgumentMap &argmap) {
   }
 }
 
+void Op::set_priority_for_forward(IndexLauncher &launcher) const {
+  launcher.map_arg = TaskArgument(&fwd_task_priority, sizeof(int));
+}
+
+void Op::set_priority_for_backward(IndexLauncher &launcher) const {
+  launcher.map_arg = TaskArgument(&bwd_task_priority, sizeof(int));
+}
+
 bool Op::get_int_parameter(PMParameter para, int *value) const {
   switch (para) {
     case PM_OP_TYPE:
@@ -1077,7 +1121,11 @@ FFModel::FFModel(FFConfig &_config)
       tensor_global_guid(TENSOR_GUID_FIRST_VALID),
       parallel_tensor_global_guid(PARALLEL_TENSOR_GUID_FIRST_VALID),
       node_global_guid(NODE_GUID_FIRST_VALID), config(_config), optimizer(NULL),
-      loss_op(NULL), metrics_op(NULL), simulator(NULL) {
+      loss_op(NULL), metrics_op(NULL), simulator(NULL),
+      loss_scale(_config.initial_loss_scale), loss_scale_good_steps(0),
+      auto_trace_active(false), auto_trace_seq_length(-1),
+      auto_trace_id(AUTO_TRACE_ID_BASE),
+      auto_trace_next_id(AUTO_TRACE_ID_BASE) {
   this->search = new PCG::SearchHelper(this);
   this->graph_search = new PCG::GraphSearchHelper(this);
 
@@ -1189,6 +1237,52 @@ PCG::Node FFModel::new_node(Op *op) {
   return ret;
 }
 
+template <typename Cache>
+static bool erase_cached_op(Cache &cache, Op const *op) {
+  for (auto it = cache.begin(); it != cache.end(); it++) {
+    if (it->second == op) {
+      cache.erase(it);
+      return true;
+    }
+  }
+  return false;
+}
+
+void FFModel::discard_node(PCG::Node const &node) {
+  Op *op = const_cast<Op *>(node.ptr);
+  bool cached = std::apply(
+      [op](auto &...caches) { return (erase_cached_op(caches, op) || ...); },
+      this->cached_ops);
+  cached = cached || erase_cached_op(cached_noop_ops, op) ||
+           erase_cached_op(cached_cast_ops, op) ||
+           erase_cached_op(cached_dropout_ops, op) ||
+           erase_cached_op(cached_embedding_ops, op) ||
+           erase_cached_op(cached_flat_ops, op) ||
+           erase_cached_op(cached_multihead_attn_ops, op) ||
+           erase_cached_op(cached_reshape_ops, op) ||
+           erase_cached_op(cached_softmax_ops, op) ||
+           erase_cached_op(cached_split_ops, op) ||
+           erase_cached_op(cached_repartition_ops, op) ||
+           erase_cached_op(cached_replicate_ops, op) ||
+           erase_cached_op(cached_reduction_ops, op) ||
+           erase_cached_op(cached_combine_ops, op) ||
+           erase_cached_op(cached_fused_parallel_ops, op);
+  assert(cached);
+  // Inputs and shared weights belong to other operators
+  for (int i = 0; i < op->numOutputs; i++) {
+    if (op->outputs[i] != NULL && op->outputs[i]->owner_op == op) {
+      delete op->outputs[i];
+    }
+  }
+  for (int i = 0; i < op->numWeights; i++) {
+    if (op->weights[i] != NULL && op->weights[i]->owner_op == op) {
+      delete op->weights[i];
+    }
+  }
+  delete op->parallel_dims_mapping;
+  delete op;
+}
+
 Tensor FFModel::create_tensor(int numdim,
                               int const dims[],
                               DataType data_type,
@@ -1495,6 +1589,9 @@ void FFModel::map_tensor_with_dim2(ParallelTensor tensor,
     case DT_DOUBLE:
       allocator.allocate_field(sizeof(double), FID_DATA);
       break;
+    case DT_HALF:
+      allocator.allocate_field(sizeof(half), FID_DATA);
+      break;
     case DT_INT32:
       allocator.allocate_field(sizeof(int32_t), FID_DATA);
       break;
@@ -1567,6 +1664,44 @@ void FFModel::map_weight(ParallelTensor weight, Op const *op) {
   }
 }
 
+void FFModel::map_sparse_grad(ParallelTensor weight) {
+  // The sparse gradient regions keep the replica dims of the weight, so
+  // that each replica writes its own part, and replace its (out_channels,
+  // num_entries) table with a (1, capacity + 1) list of rows and a
+  // (out_channels, capacity) block of values
+  assert(weight->num_dims >= 2);
+  assert(weight->dims[0].degree == 1 && weight->dims[1].degree == 1);
+  assert(weight->sparse_grad_capacity > 0);
+  ParallelDim dims[MAX_TENSOR_DIM];
+  for (int i = 0; i < weight->num_dims; i++) {
+    dims[i] = weight->dims[i];
+  }
+  dims[0].size = 1;
+  dims[1].size = weight->sparse_grad_capacity + 1;
+  ParallelTensor rows =
+      create_parallel_tensor_legion_ordering(weight->num_dims,
+                                             dims,
+                                             DT_INT64,
+                                             weight->owner_op,
+                                             -1 /*not an output*/,
+                                             false /*create_grad*/);
+  map_tensor(rows, weight->owner_op);
+  dims[0].size = weight->dims[0].size;
+  dims[1].size = weight->sparse_grad_capacity;
+  ParallelTensor values =
+      create_parallel_tensor_legion_ordering(weight->num_dims,
+                                             dims,
+                                             DT_FLOAT,
+                                             weight->owner_op,
+                                             -1 /*not an output*/,
+                                             false /*create_grad*/);
+  map_tensor(values, weight->owner_op);
+  assert(rows->parallel_is == weight->parallel_is);
+  assert(values->parallel_is == weight->parallel_is);
+  weight->sparse_grad_rows = rows;
+  weight->sparse_grad_values = values;
+}
+
 template <int NDIM>
 void FFModel::map_weight_with_dim(ParallelTensor weight,
                                   Op const *parallel_op) {
@@ -1874,6 +2009,9 @@ void FFModel::map_linear_weight(ParallelTensor weight, Op const *op) {
     case DT_DOUBLE:
       allocator.allocate_field(sizeof(double), FID_DATA);
       break;
+    case DT_HALF:
+      allocator.allocate_field(sizeof(half), FID_DATA);
+      break;
     case DT_INT32:
       allocator.allocate_field(sizeof(int), FID_DATA);
       break;
@@ -1990,6 +2128,9 @@ void FFModel::map_conv_weight(ParallelTensor weight, Op const *op) {
     case DT_DOUBLE:
       allocator.allocate_field(sizeof(double), FID_DATA);
       break;
+    case DT_HALF:
+      allocator.allocate_field(sizeof(half), FID_DATA);
+      break;
     case DT_INT32:
       allocator.allocate_field(sizeof(int), FID_DATA);
       break;
@@ -2106,6 +2247,9 @@ ParallelTensor FFModel::create_linear_replica(int const dims[],
     case DT_DOUBLE:
       allocator.allocate_field(sizeof(double), FID_DATA);
       break;
+    case DT_HALF:
+      allocator.allocate_field(sizeof(half), FID_DATA);
+      break;
     case DT_INT32:
       allocator.allocate_field(sizeof(int), FID_DATA);
       break;
@@ -2260,13 +2404,125 @@ void FFModel::init_operators() {
 
 void FFModel::forward(int seq_length) {
   iter_config.seq_length = seq_length;
+  begin_iteration_trace();
   for (size_t i = 0; i < operators.size(); i++)
     operators[i]->forward(*this);
+  // Inference iterations consist of the forward pass only
+  if (config.computationMode == COMP_MODE_INFERENCE)
+    end_iteration_trace();
+}
+
+void FFModel::infer(std::vector<std::pair<Tensor, float const *>> const &batch,
+                    float *output,
+                    int seq_length) {
+  assert(config.computationMode == COMP_MODE_INFERENCE);
+  Context ctx = config.lg_ctx;
+  Runtime *runtime = config.lg_hlr;
+  for (auto const &it : batch) {
+    Tensor tensor = it.first;
+    std::vector<int> dims(tensor->num_dims);
+    for (int i = 0; i < tensor->num_dims; i++) {
+      dims[i] = tensor->dims[tensor->num_dims - 1 - i];
+    }
+    if (!tensor->set_tensor<float>(this, dims, it.second)) {
+      fprintf(stderr,
+              "Cannot set input tensor %zu for inference\n",
+              tensor->tensor_guid);
+      assert(false);
+    }
+  }
+  forward(seq_length);
+  // get_tensor only reads the first partition, so map the whole output
+  ParallelTensor tensor = get_final_operator()->outputs[0];
+  assert(tensor->data_type == DT_FLOAT);
+  size_t volume = 1;
+  for (int i = 0; i < tensor->num_dims; i++) {
+    if (!tensor->dims[i].is_replica_dim) {
+      volume *= tensor->dims[i].size;
+    }
+  }
+  RegionRequirement req(tensor->region, READ_ONLY, EXCLUSIVE, tensor->region);
+  req.add_field(FID_DATA);
+  InlineLauncher launcher(req);
+  PhysicalRegion pr = runtime->map_region(ctx, launcher);
+  pr.wait_until_valid();
+  switch (tensor->num_dims) {
+#define DIMFUNC(DIM)                                                           \
+  case DIM: {                                                                  \
+    TensorAccessorR<float, DIM> acc(pr, req, FID_DATA, ctx, runtime);          \
+    assert(acc.rect.volume() >= volume);                                       \
+    /* replicas are outermost, so the first one comes first */                 \
+    memcpy(output, acc.ptr, volume * sizeof(float));                           \
+    break;                                                                     \
+  }
+    LEGION_FOREACH_N(DIMFUNC)
+#undef DIMFUNC
+    default:
+      assert(false && "Unsupported dim");
+  }
+  runtime->unmap_region(ctx, pr);
 }
 
 void FFModel::recompile_on_condition(RecompileState &r) {
-  if (r.trigger())
+  if (r.trigger()) {
+    // The operators may change, so the captured trace can no longer be
+    // replayed
+    invalidate_iteration_trace();
     r.alter();
+  }
+}
+
+void FFModel::begin_iteration_trace() {
+  // Loss scaling predicates the updates on the gradient overflow checks,
+  // which cannot be captured in a trace
+  if (!config.enable_auto_tracing || config.enable_loss_scaling)
+    return;
+  if (auto_trace_active) {
+    // The previous iteration never reached update() (e.g., a forward-only
+    // evaluation step), so its launch sequence differs from a full iteration
+    end_iteration_trace();
+    auto_trace_ids.erase(auto_trace_seq_length);
+    auto_trace_warmup_left.erase(auto_trace_seq_length);
+  }
+  int seq_length = iter_config.seq_length;
+  if (auto_trace_ids.find(seq_length) == auto_trace_ids.end()) {
+    auto_trace_ids[seq_length] = auto_trace_next_id++;
+    auto_trace_warmup_left[seq_length] = config.auto_tracing_warmup_iterations;
+  }
+  // Run untraced for the warm-up iterations so that all instances and
+  // partitions exist before the trace is captured
+  if (auto_trace_warmup_left[seq_length] > 0) {
+    auto_trace_warmup_left[seq_length]--;
+    return;
+  }
+  Context ctx = config.lg_ctx;
+  Runtime *runtime = config.lg_hlr;
+  auto_trace_seq_length = seq_length;
+  auto_trace_id = auto_trace_ids[seq_length];
+  runtime->begin_trace(ctx, auto_trace_id);
+  auto_trace_active = true;
+}
+
+void FFModel::end_iteration_trace() {
+  if (!auto_trace_active)
+    return;
+  Context ctx = config.lg_ctx;
+  Runtime *runtime = config.lg_hlr;
+  runtime->end_trace(ctx, auto_trace_id);
+  auto_trace_active = false;
+}
+
+void FFModel::invalidate_iteration_trace() {
+  end_iteration_trace();
+  // Later iterations get fresh trace IDs so that Legion captures new traces
+  // instead of replaying the stale ones
+  auto_trace_ids.clear();
+  auto_trace_warmup_left.clear();
+}
+
+void FFModel::set_sample_seq_lengths(std::vector<int> const &seq_lengths) {
+  sample_seq_lengths = seq_lengths;
+  iter_config.num_sample_seq_lengths = seq_lengths.size();
 }
 
 void FFModel::compute_metrics() {
@@ -2282,6 +2538,7 @@ void FFModel::get_metrics() {
 void FFModel::backward(int seq_length) {
   iter_config.seq_length = seq_length;
   assert(config.computationMode == COMP_MODE_TRAINING);
+  adjust_loss_scale();
   // Compute metrics
   compute_metrics();
   // Compute the gradients of the final operator wrt loss
@@ -2310,10 +2567,189 @@ void FFModel::backward(int seq_length) {
 }
 
 void FFModel::update() {
+  if (config.enable_loss_scaling) {
+    check_gradient_overflow();
+    optimizer->grad_scale = 1.0f / loss_scale;
+  }
   optimizer->next();
   for (size_t i = 0; i < parameters.size(); i++) {
     optimizer->update(parameters[i]);
   }
+  end_iteration_trace();
+  if (config.report_instance_pools) {
+    report_instance_pools();
+  }
+}
+
+void FFModel::check_gradient_overflow() {
+  Context ctx = config.lg_ctx;
+  Runtime *runtime = config.lg_hlr;
+  // Each check only sets the overflow flag of its worker on the device, so
+  // that nothing waits for the gradients until the flags are reduced
+  for (size_t i = 0; i < parameters.size(); i++) {
+    ParallelTensor p = parameters[i];
+    ArgumentMap argmap;
+    Domain domain = runtime->get_index_space_domain(ctx, p->parallel_is);
+    for (Domain::DomainPointIterator it(domain); it; it++) {
+      FFHandler const &handle = handlers[p->machine_view.get_device_id(*it)];
+      argmap.set_point(*it, TaskArgument(&handle, sizeof(FFHandler)));
+    }
+    IndexLauncher launcher(GRAD_OVERFLOW_CHECK_TASK_ID,
+                           p->parallel_is,
+                           TaskArgument(NULL, 0),
+                           argmap,
+                           Predicate::TRUE_PRED,
+                           false /*must*/,
+                           0 /*mapper_id*/,
+                           p->machine_view.hash());
+    launcher.map_arg =
+        TaskArgument(&p->owner_op->upd_task_priority, sizeof(int));
+    if (p->sparse_grad) {
+      // Unused rows of the sparse gradient are zero
+      launcher.add_region_requirement(
+          RegionRequirement(p->sparse_grad_values->part,
+                            0 /*projection id*/,
+                            READ_ONLY,
+                            EXCLUSIVE,
+                            p->sparse_grad_values->region));
+    } else {
+      launcher.add_region_requirement(RegionRequirement(p->part_grad,
+                                                        0 /*projection id*/,
+                                                        READ_ONLY,
+                                                        EXCLUSIVE,
+                                                        p->region_grad));
+    }
+    launcher.add_field(0, FID_DATA);
+    runtime->execute_index_space(ctx, launcher);
+  }
+  // The reductions access no regions, so order them after the checks
+  runtime->issue_execution_fence(ctx);
+  Rect<1> task_rect(Point<1>(0),
+                    Point<1>(config.workersPerNode * config.numNodes - 1));
+  ArgumentMap argmap;
+  int idx = 0;
+  for (PointInRectIterator<1> it(task_rect); it(); it++) {
+    argmap.set_point(*it, TaskArgument(&handlers[idx++], sizeof(FFHandler)));
+  }
+  IndexLauncher launcher(GRAD_OVERFLOW_REDUCE_TASK_ID,
+                         get_or_create_task_is(Domain(task_rect)),
+                         TaskArgument(NULL, 0),
+                         argmap,
+                         Predicate::TRUE_PRED,
+                         false /*must*/,
+                         0 /*mapper_id*/,
+                         FFConfig::DataParallelism_GPU);
+  Future overflow =
+      runtime->execute_index_space(ctx, launcher, LEGION_REDOP_OR_BOOL);
+  // Skip the update if any gradient overflowed, without waiting for the
+  // reduction on the host
+  Predicate overflow_pred = runtime->create_predicate(ctx, overflow);
+  optimizer->update_predicate = runtime->predicate_not(ctx, overflow_pred);
+  grad_overflow = overflow;
+}
+
+void FFModel::adjust_loss_scale() {
+  if (!config.enable_loss_scaling || !grad_overflow.valid())
+    return;
+  // The check was launched by the previous update, so this rarely blocks
+  bool overflow = grad_overflow.get_result<bool>();
+  grad_overflow = Future();
+  if (overflow) {
+    loss_scale = std::max(loss_scale / 2.0f, 1.0f);
+    loss_scale_good_steps = 0;
+    log_model.print("Gradient overflow, skipped the update and reduced the "
+                    "loss scale to %.1f",
+                    loss_scale);
+  } else if (++loss_scale_good_steps >= config.loss_scale_growth_interval) {
+    loss_scale = std::min(loss_scale * 2.0f, MAX_LOSS_SCALE);
+    loss_scale_good_steps = 0;
+  }
+}
+
+// Operators that run in half in mixed precision mode. Exp, rsqrt and pow
+// overflow easily in half, and softmax and layer norm reduce over a whole
+// row, so they stay in float behind a cast like the loss
+static bool runs_in_half(OperatorType op_type) {
+  switch (op_type) {
+    case OP_LINEAR:
+    case OP_BATCHMATMUL:
+    case OP_EW_ADD:
+    case OP_EW_SUB:
+    case OP_EW_MUL:
+    case OP_IDENTITY:
+    case OP_RELU:
+    case OP_SIGMOID:
+    case OP_TANH:
+    case OP_ELU:
+    case OP_GELU:
+    case OP_SCALAR_MULTIPLY:
+    case OP_SCALAR_ADD:
+    case OP_SCALAR_SUB:
+    case OP_SCALAR_TRUE_DIV:
+      return true;
+    default:
+      return false;
+  }
+}
+
+void FFModel::apply_mixed_precision() {
+#ifndef FF_USE_CUDA
+  fprintf(stderr, "Mixed precision is only supported on CUDA\n");
+  assert(false);
+#endif
+  // The loss and the metrics read the output of the final layer in float
+  Layer *final_layer = layers.back();
+  std::vector<Layer *> old_layers;
+  old_layers.swap(layers);
+  // Tensors this pass changed to half, and the casts added so far
+  std::set<Tensor> halved;
+  std::map<std::pair<Tensor, DataType>, Tensor> casts;
+  auto cast_to = [&](Tensor t, DataType dtype) {
+    auto key = std::make_pair(t, dtype);
+    if (casts.find(key) == casts.end()) {
+      casts[key] = cast(t, dtype, NULL);
+    }
+    return casts[key];
+  };
+  for (Layer *l : old_layers) {
+    bool to_half = l != final_layer && runs_in_half(l->op_type);
+    for (int i = 0; i < l->numInputs; i++) {
+      DataType dtype = l->inputs[i]->data_type;
+      to_half = to_half && (dtype == DT_FLOAT || dtype == DT_HALF);
+    }
+    for (int i = 0; i < l->numInputs; i++) {
+      Tensor t = l->inputs[i];
+      if (to_half && t->data_type == DT_FLOAT) {
+        l->inputs[i] = cast_to(t, DT_HALF);
+      } else if (!to_half && halved.count(t) > 0) {
+        l->inputs[i] = cast_to(t, DT_FLOAT);
+      }
+    }
+    // Weights stay in float as the master copy for the optimizer
+    if (to_half) {
+      l->data_type = DT_HALF;
+      for (int i = 0; i < l->numOutputs; i++) {
+        if (l->outputs[i]->data_type == DT_FLOAT) {
+          l->outputs[i]->data_type = DT_HALF;
+          halved.insert(l->outputs[i]);
+        }
+      }
+    }
+    // cast() appended the new casts to layers
+    layers.push_back(l);
+  }
+}
+
+void FFModel::release_instance_pools() {
+  Context ctx = config.lg_ctx;
+  Runtime *runtime = config.lg_hlr;
+  runtime->select_tunable_value(ctx, FF_TUNABLE_RELEASE_INSTANCE_POOLS);
+}
+
+void FFModel::report_instance_pools() {
+  Context ctx = config.lg_ctx;
+  Runtime *runtime = config.lg_hlr;
+  runtime->select_tunable_value(ctx, FF_TUNABLE_REPORT_INSTANCE_POOLS);
 }
 
 Op *FFModel::get_final_operator() const {
@@ -2339,6 +2775,9 @@ bool FFModel::apply_fusion(std::vector<Op *> const &operators,
   // Context ctx = config.lg_ctx;
   // Runtime* runtime = config.lg_hlr;
   for (size_t l = 1; l < operators.size() - 1; l++) {
+    if (!FusedOp::can_fuse(operators[l])) {
+      continue;
+    }
     size_t start = 0;
     {
       Op *opl = operators[l];
@@ -2369,7 +2808,8 @@ bool FFModel::apply_fusion(std::vector<Op *> const &operators,
         else {
           // created = true;
           //  cannot be an in-place operator
-          if (operators[i]->has_inplace_output())
+          if (operators[i]->has_inplace_output() ||
+              !FusedOp::can_fuse(operators[i]))
             continue;
           fused_op = new FusedOp(*this, operators[i]);
         }
@@ -2565,6 +3005,13 @@ void FFModel::compile(LossType loss_type,
   Context ctx = config.lg_ctx;
   Runtime *runtime = config.lg_hlr;
   config.computationMode = comp_mode;
+  if (comp_mode == COMP_MODE_INFERENCE) {
+    // Without a backward pass, no activation is read after its last
+    // consumer, so outputs can be written in place and dead activations
+    // can share regions. Gradient regions are not created either
+    config.enable_inplace_optimizations = true;
+    config.enable_memory_planning = true;
+  }
   // if (config.import_strategy_file.length() > 0) {
   //   load_strategies_from_file(config.import_strategy_file,
   //   config.strategies);
@@ -2575,23 +3022,59 @@ void FFModel::compile(LossType loss_type,
             "Note: only_data_parallel is specified, FlexFlow compiles a "
             "data-parallel PCG.\n");
   }
+  // Instances mapped for a previous strategy are not needed anymore
+  release_instance_pools();
+  if (config.enable_mixed_precision) {
+    apply_mixed_precision();
+  }
   create_operators_from_layers();
-  // Launch the graph optimize task
+  // Launch the graph optimize task, unless its result is in the compile
+  // cache
   {
-    FFModel *model = this;
-    TaskLauncher launcher(GRAPH_OPTIMIZE_TASK_ID,
-                          TaskArgument(&model, sizeof(FFModel *)));
-    Future future = runtime->execute_task(ctx, launcher);
-
-    PCG::GraphOptimalViewSerialized ret =
-        future.get_result<PCG::GraphOptimalViewSerialized>();
-    Deserializer dez(ret.data, ret.total_bytes);
+    PCG::GraphOptimalViewSerialized ret;
+    CompileCacheKey cache_key;
+    bool cached = false;
+    if (!config.compile_cache_dir.empty()) {
+      get_compile_cache_key(cache_key);
+      CompileCache cache(config.compile_cache_dir);
+      cached = cache.load(cache_key, ret.data);
+      fprintf(stderr,
+              "Compile cache %s: %s\n",
+              cached ? "hit" : "miss",
+              cache.get_path(cache_key).c_str());
+    }
+    if (cached) {
+      // the search task would have applied these
+      if (config.search_num_nodes.has_value()) {
+        config.numNodes = config.search_num_nodes.value();
+      }
+      if (config.search_num_workers.has_value()) {
+        config.workersPerNode = config.search_num_workers.value();
+      }
+    } else {
+      FFModel *model = this;
+      TaskLauncher launcher(GRAPH_OPTIMIZE_TASK_ID,
+                            TaskArgument(&model, sizeof(FFModel *)));
+      Future future = runtime->execute_task(ctx, launcher);
+      ret = future.get_result<PCG::GraphOptimalViewSerialized>();
+      if (!config.compile_cache_dir.empty()) {
+        CompileCache cache(config.compile_cache_dir);
+        if (!cache.store(cache_key, ret.data)) {
+          fprintf(stderr,
+                  "Warning: cannot write the compile cache entry %s\n",
+                  cache.get_path(cache_key).c_str());
+        }
+      }
+    }
+    Deserializer dez(ret.data.data(), ret.data.size());
     // Reconstruct operators
     PCG::Graph *best_graph = new PCG::Graph(this);
     std::unordered_map<PCG::Node, MachineView> optimal_views;
-    deserialize_graph_optimal_view(dez, best_graph, optimal_views);
+    std::unordered_map<PCG::Node, PCG::NodeTaskPriority> priorities;
+    deserialize_graph_optimal_view(
+        dez, best_graph, optimal_views, priorities);
     operators.clear();
-    convert_graph_to_operators(best_graph, optimal_views);
+    convert_graph_to_operators(best_graph, optimal_views, priorities);
     delete best_graph;
     for (auto const &layer : layers) {
       // map inputs to parallel tensor
@@ -2642,7 +3125,10 @@ void FFModel::compile(LossType loss_type,
       if (operators[l]->can_inplace_output()) {
         // Assume outputs[0] is inplace with inputs[0]
         assert(operators[l]->numOutputs == 1);
-        if (operators[l]->inputs[0]->owner_op != NULL) {
+        // Inputs are written once per batch by the data loader or infer,
+        // and must not be overwritten
+        if (operators[l]->inputs[0]->owner_op != NULL &&
+            operators[l]->inputs[0]->owner_op->op_type != OP_INPUT) {
           // int dim1 = operators[l]->outputs[0]->num_dims;
           // int dim2 = operators[l]->inputs[0]->num_dims;
           MachineView view1 = operators[l]->outputs[0]->machine_view;
@@ -2672,6 +3158,12 @@ void FFModel::compile(LossType loss_type,
     }
   }
 
+  // Plan activation memory from tensor lifetimes
+  std::unordered_map<ParallelTensor, ParallelTensor> shared_regions;
+  if (config.enable_memory_planning) {
+    plan_activation_memory(shared_regions);
+  }
+
   for (size_t l = 0; l < operators.size(); l++) {
     Op *op = operators[l];
     for (int i = 0; i < op->numInputs; i++) {
@@ -2681,10 +3173,24 @@ void FFModel::compile(LossType loss_type,
       assert(op->weights[i]->owner_op != NULL);
       assert(op->weights[i]->region != LogicalRegion::NO_REGION);
       parameters.push_back(op->weights[i]);
+      if (op->weights[i]->sparse_grad &&
+          op->weights[i]->sparse_grad_rows == NULL &&
+          config.computationMode == COMP_MODE_TRAINING) {
+        map_sparse_grad(op->weights[i]);
+      }
     }
     for (int i = 0; i < op->numOutputs; i++) {
       // Output tensor
-      map_tensor(op->outputs[i], op);
+      if (shared_regions.find(op->outputs[i]) != shared_regions.end()) {
+        // Reuse the region of a tensor that is dead by now
+        ParallelTensor donor = shared_regions[op->outputs[i]];
+        assert(donor->region != LogicalRegion::NO_REGION);
+        op->outputs[i]->parallel_is = donor->parallel_is;
+        op->outputs[i]->region = donor->region;
+        op->outputs[i]->part = donor->part;
+      } else {
+        map_tensor(op->outputs[i], op);
+      }
     }
     if (op->is_parallel_op())
       ((ParallelOp *)op)->create_input_partition(*this);
@@ -2867,9 +3373,11 @@ void FFModel::compile(LossType loss_type,
       assert(false && "Unsupported dim");
     }
   }
-  // init optimizer
-  assert(optimizer != NULL);
-  optimizer->init();
+  // init optimizer, which inference does not need
+  if (config.computationMode == COMP_MODE_TRAINING) {
+    assert(optimizer != NULL);
+    optimizer->init();
+  }
 
 #ifdef FF_USE_NCCL
   if (config.computationMode == COMP_MODE_TRAINING) {
@@ -3232,11 +3740,12 @@ bool DataLoader::shuffle_samples(void) {
 // class FFIterationConfig
 // ========================================================
 FFIterationConfig::FFIterationConfig() {
-  seq_length = -1;
+  reset();
 }
 
 void FFIterationConfig::reset() {
   seq_length = -1;
+  num_sample_seq_lengths = 0;
 }
 
 // ========================================================
@@ -3273,6 +3782,17 @@ struct DefaultConfig {
   const static bool enable_control_replication = true;
   // The default python data loader type is 2 to enable control replication
   const static int python_data_loader_type = 2;
+  const static bool enable_auto_tracing = false;
+  const static int auto_tracing_warmup_iterations = 1;
+  const static bool report_instance_pools = false;
+  const static bool enable_memory_planning = false;
+  const static bool enable_sparse_embedding_grads = false;
+  const static int embedding_hot_tier_rows = 0;
+  const static int embedding_hot_tier_refresh = 100;
+  const static bool enable_mixed_precision = false;
+  const static bool enable_loss_scaling = false;
+  constexpr static float initial_loss_scale = 65536.0f;
+  const static int loss_scale_growth_interval = 2000;
 };
 
 FFConfig::FFConfig() {
@@ -3302,6 +3822,18 @@ FFConfig::FFConfig() {
   simulator_max_num_segments = DefaultConfig::simulator_max_num_segments;
   enable_control_replication = DefaultConfig::enable_control_replication;
   python_data_loader_type = DefaultConfig::python_data_loader_type;
+  enable_auto_tracing = DefaultConfig::enable_auto_tracing;
+  auto_tracing_warmup_iterations =
+      DefaultConfig::auto_tracing_warmup_iterations;
+  report_instance_pools = DefaultConfig::report_instance_pools;
+  enable_memory_planning = DefaultConfig::enable_memory_planning;
+  enable_sparse_embedding_grads = DefaultConfig::enable_sparse_embedding_grads;
+  embedding_hot_tier_rows = DefaultConfig::embedding_hot_tier_rows;
+  embedding_hot_tier_refresh = DefaultConfig::embedding_hot_tier_refresh;
+  enable_mixed_precision = DefaultConfig::enable_mixed_precision;
+  enable_loss_scaling = DefaultConfig::enable_loss_scaling;
+  initial_loss_scale = DefaultConfig::initial_loss_scale;
+  loss_scale_growth_interval = DefaultConfig::loss_scale_growth_interval;
   machine_model_file = "";
   import_strategy_file = "";
   export_strategy_file = "";
@@ -3309,6 +3841,8 @@ FFConfig::FFConfig() {
   export_strategy_computation_graph_file = "";
   dataset_path = "";
   substitution_json_path = tl::nullopt;
+  search_prune_xfers = true;
+  search_egraph_node_budget = 0;
   syntheticInput = false;
   perform_fusion = false;
   base_optimize_threshold = DefaultConfig::base_optimize_threshold;
@@ -3407,6 +3941,10 @@ void FFConfig::parse_args(char **argv, int argc) {
     }
     if (!strcmp(argv[i], "-ll:cpu")) {
       cpusPerNode = atoi(argv[++i]);
+#ifdef FF_USE_CPU
+      // Operators run on the CPU processors
+      workersPerNode = cpusPerNode;
+#endif
       continue;
     }
     if (!strcmp(argv[i], "--profiling")) {
@@ -3480,6 +4018,64 @@ void FFConfig::parse_args(char **argv, int argc) {
       substitution_json_path = std::string(argv[++i]);
       continue;
     }
+    if (!strcmp(argv[i], "--enable-auto-tracing")) {
+      enable_auto_tracing = true;
+      continue;
+    }
+    if (!strcmp(argv[i], "--auto-tracing-warmup")) {
+      auto_tracing_warmup_iterations = atoi(argv[++i]);
+      continue;
+    }
+    if (!strcmp(argv[i], "--report-instance-pools")) {
+      report_instance_pools = true;
+      continue;
+    }
+    if (!strcmp(argv[i], "--memory-planning")) {
+      enable_memory_planning = true;
+      continue;
+    }
+    if (!strcmp(argv[i], "--compile-cache-dir")) {
+      compile_cache_dir = std::string(argv[++i]);
+      continue;
+    }
+    if (!strcmp(argv[i], "--no-xfer-pruning")) {
+      search_prune_xfers = false;
+      continue;
+    }
+    if (!strcmp(argv[i], "--substitution-stats-dir")) {
+      substitution_stats_dir = std::string(argv[++i]);
+      continue;
+    }
+    if (!strcmp(argv[i], "--egraph-node-budget")) {
+      search_egraph_node_budget = (size_t)atoll(argv[++i]);
+      continue;
+    }
+    if (!strcmp(argv[i], "--sparse-embedding-grads")) {
+      enable_sparse_embedding_grads = true;
+      continue;
+    }
+    if (!strcmp(argv[i], "--embedding-hot-rows")) {
+      embedding_hot_tier_rows = atoi(argv[++i]);
+      continue;
+    }
+    if (!strcmp(argv[i], "--embedding-hot-refresh")) {
+      embedding_hot_tier_refresh = atoi(argv[++i]);
+      continue;
+    }
+    if (!strcmp(argv[i], "--mixed-precision")) {
+      enable_mixed_precision = true;
+      enable_loss_scaling = true;
+      continue;
+    }
+    if (!strcmp(argv[i], "--loss-scale")) {
+      initial_loss_scale = atof(argv[++i]);
+      enable_loss_scaling = true;
+      continue;
+    }
+    if (!strcmp(argv[i], "--loss-scale-window")) {
+      loss_scale_growth_interval = atoi(argv[++i]);
+      continue;
+    }
   }
 }
 
@@ -3614,7 +4210,7 @@ void register_flexflow_internal_tasks() {
   // CNN_INIT_TASK
   {
     TaskVariantRegistrar registrar(FF_INIT_TASK_ID, "cuda_init_task");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<FFHandler, UtilityTasks::init_cuda_task>(
         registrar, "cuda_init_task");
@@ -3623,7 +4219,7 @@ void register_flexflow_internal_tasks() {
   {
     TaskVariantRegistrar registrar(ELEMENTUNARY_INIT_TASK_ID,
                                    "ElementWiseUnary Init");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<OpMeta *, ElementUnary::init_task>(
         registrar, "ElementWiseUnary Init Task");
@@ -3631,7 +4227,7 @@ void register_flexflow_internal_tasks() {
   {
     TaskVariantRegistrar registrar(ELEMENTUNARY_FWD_TASK_ID,
                                    "ElementWiseUnary Forward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<ElementUnary::forward_task>(
         registrar, "ElementWiseUnary Forward Task");
@@ -3639,7 +4235,7 @@ void register_flexflow_internal_tasks() {
   {
     TaskVariantRegistrar registrar(ELEMENTUNARY_BWD_TASK_ID,
                                    "ElementWiseUnary Backward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<ElementUnary::backward_task>(
         registrar, "ElementWiseUnary Backward Task");
@@ -3648,7 +4244,7 @@ void register_flexflow_internal_tasks() {
   {
     TaskVariantRegistrar registrar(ELEMENTBINARY_INIT_TASK_ID,
                                    "ElementWiseBinary Init");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<OpMeta *, ElementBinary::init_task>(
         registrar, "ElementWiseBinary Init Task");
@@ -3656,7 +4252,7 @@ void register_flexflow_internal_tasks() {
   {
     TaskVariantRegistrar registrar(ELEMENTBINARY_FWD_TASK_ID,
                                    "ElementWiseBinary Forward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<ElementBinary::forward_task>(
         registrar, "ElementWiseBinary Forward Task");
@@ -3664,7 +4260,7 @@ void register_flexflow_internal_tasks() {
   {
     TaskVariantRegistrar registrar(ELEMENTBINARY_BWD_TASK_ID,
                                    "ElementWiseBinary Backward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<ElementBinary::backward_task>(
         registrar, "ElementWiseBinary Backward Task");
@@ -3672,21 +4268,21 @@ void register_flexflow_internal_tasks() {
   // Cast
   {
     TaskVariantRegistrar registrar(CAST_INIT_TASK_ID, "Cast Init");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<OpMeta *, Cast::init_task>(
         registrar, "Cast Init Task");
   }
   {
     TaskVariantRegistrar registrar(CAST_FWD_TASK_ID, "Cast Forward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Cast::forward_task>(registrar,
                                                           "Cast Forward Task");
   }
   {
     TaskVariantRegistrar registrar(CAST_BWD_TASK_ID, "Cast Backward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Cast::backward_task>(
         registrar, "Cast Backward Task");
@@ -3694,21 +4290,21 @@ void register_flexflow_internal_tasks() {
   // Conv2D task
   {
     TaskVariantRegistrar registrar(CONV2D_INIT_TASK_ID, "Conv2D Init");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<OpMeta *, Conv2D::init_task>(
         registrar, "Conv2D Init Task");
   }
   {
     TaskVariantRegistrar registrar(CONV2D_FWD_TASK_ID, "Conv2D Forward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Conv2D::forward_task>(
         registrar, "Conv2D Forward Task");
   }
   {
     TaskVariantRegistrar registrar(CONV2D_BWD_TASK_ID, "Conv2D Backward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Conv2D::backward_task>(
         registrar, "Conv2D Backward Task");
@@ -3723,21 +4319,21 @@ void register_flexflow_internal_tasks() {
   // Dropout task
   {
     TaskVariantRegistrar registrar(DROPOUT_INIT_TASK_ID, "Dropout Init");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<OpMeta *, Dropout::init_task>(
         registrar, "Dropout Init Task");
   }
   {
     TaskVariantRegistrar registrar(DROPOUT_FWD_TASK_ID, "Dropout Forward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Dropout::forward_task>(
         registrar, "Dropout Forward Task");
   }
   {
     TaskVariantRegistrar registrar(DROPOUT_BWD_TASK_ID, "Dropout Backward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Dropout::backward_task>(
         registrar, "Dropout Backward Task");
@@ -3745,59 +4341,43 @@ void register_flexflow_internal_tasks() {
   // Embedding task GPU
   {
     TaskVariantRegistrar registrar(EMBED_INIT_TASK_ID, "Embedding Init");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<OpMeta *, Embedding::init_task>(
         registrar, "Embedding Init Task");
   }
   {
     TaskVariantRegistrar registrar(EMBED_FWD_TASK_ID, "Embedding Forward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Embedding::forward_task>(
         registrar, "Embedding Forward Task");
   }
   {
     TaskVariantRegistrar registrar(EMBED_BWD_TASK_ID, "Embedding Backward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Embedding::backward_task>(
         registrar, "Embedding Backward Task");
   }
-  // Embedding task CPU
-  /* {
-    TaskVariantRegistrar registrar(EMBED_FWD_TASK_ID, "Embedding Forward");
-    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
-    registrar.set_leaf();
-    Runtime::preregister_task_variant<Embedding::forward_task_cpu>(
-        registrar, "Embedding Forward Task");
-  }
-  {
-    TaskVariantRegistrar registrar(EMBED_BWD_TASK_ID, "Embedding Backward");
-    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
-    registrar.set_leaf();
-    Runtime::preregister_task_variant<Embedding::backward_task_cpu>(
-        registrar, "Embedding Backward Task");
-  }*/
-
   // Cache task CPU
   {
     TaskVariantRegistrar registrar(CACHE_INIT_TASK_ID, "Cache Init");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<OpMeta *, Cache::init_task>(
         registrar, "Cache Init Task");
   }
   {
     TaskVariantRegistrar registrar(CACHE_FWD_TASK_ID, "Cache Forward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Cache::forward_task>(
         registrar, "Cache Forward Task");
   }
   {
     TaskVariantRegistrar registrar(CACHE_UPDATE_TASK_ID, "Cache Update");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<float, Cache::update_task>(
         registrar, "Cache Update Task");
@@ -3805,21 +4385,21 @@ void register_flexflow_internal_tasks() {
   // Group by task CPU
   {
     TaskVariantRegistrar registrar(GROUP_BY_INIT_TASK_ID, "Group_by Init");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<OpMeta *, Group_by::init_task>(
         registrar, "Group_by Init Task");
   }
   {
     TaskVariantRegistrar registrar(GROUP_BY_FWD_TASK_ID, "Group_by Forward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Group_by::forward_task>(
         registrar, "Group_by Forward Task");
   }
   {
     TaskVariantRegistrar registrar(GROUP_BY_BWD_TASK_ID, "Group_by Backward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Group_by::backward_task>(
         registrar, "Group_by Backward Task");
@@ -3828,21 +4408,21 @@ void register_flexflow_internal_tasks() {
   // Aggregate task CPU
   {
     TaskVariantRegistrar registrar(AGGREGATE_INIT_TASK_ID, "Aggregate Init");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<OpMeta *, Aggregate::init_task>(
         registrar, "Aggregate Init Task");
   }
   {
     TaskVariantRegistrar registrar(AGGREGATE_FWD_TASK_ID, "Aggregate Forward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Aggregate::forward_task>(
         registrar, "Aggregate Forward Task");
   }
   {
     TaskVariantRegistrar registrar(AGGREGATE_BWD_TASK_ID, "Aggregate Backward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Aggregate::backward_task>(
         registrar, "Aggregate Backward Task");
@@ -3852,7 +4432,7 @@ void register_flexflow_internal_tasks() {
   {
     TaskVariantRegistrar registrar(AGG_SPEC_INIT_TASK_ID,
                                    "Aggregate specification Init");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<OpMeta *, AggregateSpec::init_task>(
         registrar, "Aggregate specification Init Task");
@@ -3860,7 +4440,7 @@ void register_flexflow_internal_tasks() {
   {
     TaskVariantRegistrar registrar(AGG_SPEC_FWD_TASK_ID,
                                    "Aggregate specification Forward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<AggregateSpec::forward_task>(
         registrar, "Aggregate specification Forward Task");
@@ -3868,7 +4448,7 @@ void register_flexflow_internal_tasks() {
   {
     TaskVariantRegistrar registrar(AGG_SPEC_BWD_TASK_ID,
                                    "Aggregate specification Backward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<AggregateSpec::backward_task>(
         registrar, "Aggregate specification Backward Task");
@@ -3877,21 +4457,21 @@ void register_flexflow_internal_tasks() {
   // Pool2D task
   {
     TaskVariantRegistrar registrar(POOL2D_INIT_TASK_ID, "pool2d_init_task");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<OpMeta *, Pool2D::init_task>(
         registrar, "pool2d_init_task");
   }
   {
     TaskVariantRegistrar registrar(POOL2D_FWD_TASK_ID, "pool2d_fwd_task");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Pool2D::forward_task>(registrar,
                                                             "pool2d_fwd_task");
   }
   {
     TaskVariantRegistrar registrar(POOL2D_BWD_TASK_ID, "pool2d_bwd_task");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Pool2D::backward_task>(registrar,
                                                              "pool2d_bwd_task");
@@ -3899,21 +4479,21 @@ void register_flexflow_internal_tasks() {
   // BatchNorm task
   {
     TaskVariantRegistrar registrar(BATCHNORM_INIT_TASK_ID, "bn_init_task");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<OpMeta *, BatchNorm::init_task>(
         registrar, "bn_init_task");
   }
   {
     TaskVariantRegistrar registrar(BATCHNORM_FWD_TASK_ID, "bn_fwd_task");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<BatchNorm::forward_task>(registrar,
                                                                "bn_fwd_task");
   }
   {
     TaskVariantRegistrar registrar(BATCHNORM_BWD_TASK_ID, "bn_bwd_task");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<BatchNorm::backward_task>(registrar,
                                                                 "bn_bwd_task");
@@ -3922,7 +4502,7 @@ void register_flexflow_internal_tasks() {
   {
     TaskVariantRegistrar registrar(BATCHMATMUL_INIT_TASK_ID,
                                    "BatchMatmul Init");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<OpMeta *, BatchMatmul::init_task>(
         registrar, "BatchMatmul Init Task");
@@ -3930,7 +4510,7 @@ void register_flexflow_internal_tasks() {
   {
     TaskVariantRegistrar registrar(BATCHMATMUL_FWD_TASK_ID,
                                    "BatchMatmul Forward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<BatchMatmul::forward_task>(
         registrar, "BatchMatmul Forward Task");
@@ -3938,7 +4518,7 @@ void register_flexflow_internal_tasks() {
   {
     TaskVariantRegistrar registrar(BATCHMATMUL_BWD_TASK_ID,
                                    "BatchMatmul Backward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<BatchMatmul::backward_task>(
         registrar, "BatchMatmul Backward Task");
@@ -3947,21 +4527,21 @@ void register_flexflow_internal_tasks() {
   {
     TaskVariantRegistrar registrar(LAYERNORM_INIT_TASK_ID,
                                    "layernorm_init_task");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<OpMeta *, LayerNorm::init_task>(
         registrar, "layernorm_init_task");
   }
   {
     TaskVariantRegistrar registrar(LAYERNORM_FWD_TASK_ID, "layernorm_fwd_task");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<LayerNorm::forward_task>(
         registrar, "layernorm_fwd_task");
   }
   {
     TaskVariantRegistrar registrar(LAYERNORM_BWD_TASK_ID, "layernorm_bwd_task");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<LayerNorm::backward_task>(
         registrar, "layernorm_bwd_task");
@@ -3969,21 +4549,21 @@ void register_flexflow_internal_tasks() {
   // Linear task
   {
     TaskVariantRegistrar registrar(LINEAR_INIT_TASK_ID, "Linear Init");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<OpMeta *, Linear::init_task>(
         registrar, "Linear Init Task");
   }
   {
     TaskVariantRegistrar registrar(LINEAR_FWD_TASK_ID, "Linear Forward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Linear::forward_task>(
         registrar, "Linear Forward Task");
   }
   {
     TaskVariantRegistrar registrar(LINEAR_BWD_TASK_ID, "Linear Backward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Linear::backward_task>(
         registrar, "Linear Backward Task");
@@ -3991,21 +4571,21 @@ void register_flexflow_internal_tasks() {
   // Flat task
   {
     TaskVariantRegistrar registrar(FLAT_INIT_TASK_ID, "flat_init_task");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<OpMeta *, Flat::init_task>(
         registrar, "flat_init_task");
   }
   {
     TaskVariantRegistrar registrar(FLAT_FWD_TASK_ID, "flat_fwd_task");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Flat::forward_task>(registrar,
                                                           "flat_fwd_task");
   }
   {
     TaskVariantRegistrar registrar(FLAT_BWD_TASK_ID, "flat_bwd_task");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Flat::backward_task>(registrar,
                                                            "flat_bwd_task");
@@ -4013,21 +4593,21 @@ void register_flexflow_internal_tasks() {
   // Softmax task
   {
     TaskVariantRegistrar registrar(SOFTMAX_INIT_TASK_ID, "softmax_init_task");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<OpMeta *, Softmax::init_task>(
         registrar, "softmax_init_task");
   }
   {
     TaskVariantRegistrar registrar(SOFTMAX_FWD_TASK_ID, "softmax_fwd_task");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Softmax::forward_task>(
         registrar, "softmax_fwd_task");
   }
   {
     TaskVariantRegistrar registrar(SOFTMAX_BWD_TASK_ID, "softmax_bwd_task");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Softmax::backward_task>(
         registrar, "softmax_bwd_task");
@@ -4035,7 +4615,7 @@ void register_flexflow_internal_tasks() {
   // compute Loss
   {
     TaskVariantRegistrar registrar(LOSS_BWD_TASK_ID, "Loss Backward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Loss::backward_task>(
         registrar, "Loss Backward Task");
@@ -4043,7 +4623,7 @@ void register_flexflow_internal_tasks() {
   // compute Metrics
   {
     TaskVariantRegistrar registrar(METRICS_COMP_TASK_ID, "Metrics Compute");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<PerfMetrics, Metrics::compute_task>(
         registrar, "Metrics Compute Task");
@@ -4068,21 +4648,21 @@ void register_flexflow_internal_tasks() {
   // Concat task
   {
     TaskVariantRegistrar registrar(CONCAT_INIT_TASK_ID, "Concat Init");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<OpMeta *, Concat::init_task>(
         registrar, "Concat Init Task");
   }
   {
     TaskVariantRegistrar registrar(CONCAT_FWD_TASK_ID, "Concat Forward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Concat::forward_task>(
         registrar, "Concat Forward Task");
   }
   {
     TaskVariantRegistrar registrar(CONCAT_BWD_TASK_ID, "Concat Backward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Concat::backward_task>(
         registrar, "Concat Backward Task");
@@ -4090,21 +4670,21 @@ void register_flexflow_internal_tasks() {
   // Split task
   {
     TaskVariantRegistrar registrar(SPLIT_INIT_TASK_ID, "Split Init");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<OpMeta *, Split::init_task>(
         registrar, "Split Init Task");
   }
   {
     TaskVariantRegistrar registrar(SPLIT_FWD_TASK_ID, "Split Forward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Split::forward_task>(
         registrar, "Split Forward Task");
   }
   {
     TaskVariantRegistrar registrar(SPLIT_BWD_TASK_ID, "Split Backward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Split::backward_task>(
         registrar, "Split Backward Task");
@@ -4112,21 +4692,21 @@ void register_flexflow_internal_tasks() {
   // Reshape task
   {
     TaskVariantRegistrar registrar(RESHAPE_INIT_TASK_ID, "Reshape Init");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<OpMeta *, Reshape::init_task>(
         registrar, "Reshape Init Task");
   }
   {
     TaskVariantRegistrar registrar(RESHAPE_FWD_TASK_ID, "Reshape Forward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Reshape::forward_task>(
         registrar, "Reshape Forward Task");
   }
   {
     TaskVariantRegistrar registrar(RESHAPE_BWD_TASK_ID, "Reshape Backward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Reshape::backward_task>(
         registrar, "Reshape Backward Task");
@@ -4134,21 +4714,21 @@ void register_flexflow_internal_tasks() {
   // Reverse task
   {
     TaskVariantRegistrar registrar(REVERSE_INIT_TASK_ID, "Reverse Init");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<OpMeta *, Reverse::init_task>(
         registrar, "Reverse Init Task");
   }
   {
     TaskVariantRegistrar registrar(REVERSE_FWD_TASK_ID, "Reverse Forward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Reverse::forward_task>(
         registrar, "Reverse Forward Task");
   }
   {
     TaskVariantRegistrar registrar(REVERSE_BWD_TASK_ID, "Reverse Backward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Reverse::backward_task>(
         registrar, "Reverse Backward Task");
@@ -4156,21 +4736,21 @@ void register_flexflow_internal_tasks() {
   // Reverse task
   {
     TaskVariantRegistrar registrar(TOPK_INIT_TASK_ID, "TopK Init");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<OpMeta *, TopK::init_task>(
         registrar, "TopK Init Task");
   }
   {
     TaskVariantRegistrar registrar(TOPK_FWD_TASK_ID, "TopK Forward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<TopK::forward_task>(registrar,
                                                           "TopK Forward Task");
   }
   {
     TaskVariantRegistrar registrar(TOPK_BWD_TASK_ID, "TopK Backward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<TopK::backward_task>(
         registrar, "TopK Backward Task");
@@ -4178,21 +4758,21 @@ void register_flexflow_internal_tasks() {
   // Transpose task
   {
     TaskVariantRegistrar registrar(TRANSPOSE_INIT_TASK_ID, "Transpose Init");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<OpMeta *, Transpose::init_task>(
         registrar, "Transpose Init Task");
   }
   {
     TaskVariantRegistrar registrar(TRANSPOSE_FWD_TASK_ID, "Transpose Forward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Transpose::forward_task>(
         registrar, "Transpose Forward Task");
   }
   {
     TaskVariantRegistrar registrar(TRANSPOSE_BWD_TASK_ID, "Transpose Backward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Transpose::backward_task>(
         registrar, "Transpose Backward Task");
@@ -4201,7 +4781,7 @@ void register_flexflow_internal_tasks() {
   {
     TaskVariantRegistrar registrar(ATTENTION_INIT_TASK_ID,
                                    "MultiHeadAttention Init");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<OpMeta *, MultiHeadAttention::init_task>(
         registrar, "MultiHeadAttention Init Task");
@@ -4209,7 +4789,7 @@ void register_flexflow_internal_tasks() {
   {
     TaskVariantRegistrar registrar(ATTENTION_FWD_TASK_ID,
                                    "MultiHeadAttention Forward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<MultiHeadAttention::forward_task>(
         registrar, "MultiHeadAttention Forward Task");
@@ -4217,7 +4797,7 @@ void register_flexflow_internal_tasks() {
   {
     TaskVariantRegistrar registrar(ATTENTION_BWD_TASK_ID,
                                    "MultiHeadAttention Backward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<MultiHeadAttention::backward_task>(
         registrar, "MultiHeadAttention Backward Task");
@@ -4225,7 +4805,7 @@ void register_flexflow_internal_tasks() {
   // NoOp
   {
     TaskVariantRegistrar registrar(NOOP_INIT_TASK_ID, "Weight NCCL Init");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<OpMeta *, NoOp::init_task>(
         registrar, "Weight NCCL Init Task");
@@ -4233,21 +4813,21 @@ void register_flexflow_internal_tasks() {
   // FusedOp Task
   {
     TaskVariantRegistrar registrar(FUSEDOP_INIT_TASK_ID, "FusedOp Init");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<OpMeta *, FusedOp::init_task>(
         registrar, "FusedOp Init Task");
   }
   {
     TaskVariantRegistrar registrar(FUSEDOP_FWD_TASK_ID, "FusedOp Forward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<FusedOp::forward_task>(
         registrar, "FusedOp Forward Task");
   }
   {
     TaskVariantRegistrar registrar(FUSEDOP_BWD_TASK_ID, "FusedOp Backward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<FusedOp::backward_task>(
         registrar, "FusedOp Backward Task");
@@ -4257,7 +4837,7 @@ void register_flexflow_internal_tasks() {
   {
     TaskVariantRegistrar registrar(REPARTITION_INIT_TASK_ID,
                                    "Repartition Init");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<OpMeta *, Repartition::init_task>(
         registrar, "Repartition init Task");
@@ -4265,7 +4845,7 @@ void register_flexflow_internal_tasks() {
   {
     TaskVariantRegistrar registrar(REPARTITION_FWD_TASK_ID,
                                    "Repartition Forward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Repartition::forward_task>(
         registrar, "Repartition Forward Task");
@@ -4273,7 +4853,7 @@ void register_flexflow_internal_tasks() {
   {
     TaskVariantRegistrar registrar(REPARTITION_BWD_TASK_ID,
                                    "Repartition Backward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Repartition::backward_task>(
         registrar, "Repartition Backward Task");
@@ -4281,21 +4861,21 @@ void register_flexflow_internal_tasks() {
   // Combine
   {
     TaskVariantRegistrar registrar(COMBINE_INIT_TASK_ID, "Combine Init");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<OpMeta *, Combine::init_task>(
         registrar, "Combine init Task");
   }
   {
     TaskVariantRegistrar registrar(COMBINE_FWD_TASK_ID, "Combine Forward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Combine::forward_task>(
         registrar, "Combine Forward Task");
   }
   {
     TaskVariantRegistrar registrar(COMBINE_BWD_TASK_ID, "Combine Backward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Combine::backward_task>(
         registrar, "Combine Backward Task");
@@ -4303,14 +4883,14 @@ void register_flexflow_internal_tasks() {
   // Replicate
   {
     TaskVariantRegistrar registrar(REPLICATE_FWD_TASK_ID, "Replicate Forward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Replicate::forward_task>(
         registrar, "Replicate Forward Task");
   }
   {
     TaskVariantRegistrar registrar(REPLICATE_BWD_TASK_ID, "Replicate Backward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Replicate::backward_task>(
         registrar, "Replicate Backward Task");
@@ -4318,14 +4898,14 @@ void register_flexflow_internal_tasks() {
   // Reduction
   {
     TaskVariantRegistrar registrar(REDUCTION_FWD_TASK_ID, "Reduction Forward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Reduction::forward_task>(
         registrar, "Reduction Forward Task");
   }
   {
     TaskVariantRegistrar registrar(REDUCTION_BWD_TASK_ID, "Reduction Backward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Reduction::backward_task>(
         registrar, "Reduction Backward Task");
@@ -4334,7 +4914,7 @@ void register_flexflow_internal_tasks() {
   {
     TaskVariantRegistrar registrar(FUSED_PARALLELOP_FWD_TASK_ID,
                                    "FusedParallel Forward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<FusedParallelOp::forward_task>(
         registrar, "FusedParallel Forward Task");
@@ -4342,7 +4922,7 @@ void register_flexflow_internal_tasks() {
   {
     TaskVariantRegistrar registrar(FUSED_PARALLELOP_BWD_TASK_ID,
                                    "FusedParallel Backward");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<FusedParallelOp::backward_task>(
         registrar, "FusedParallel Backward Task");
@@ -4351,7 +4931,7 @@ void register_flexflow_internal_tasks() {
   {
     TaskVariantRegistrar registrar(SGD_UPD_PS_TASK_ID,
                                    "SGD Parameter Server Update");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<SGDOptimizer::ps_update_task>(
         registrar, "SGD Parameter Server Update Task");
@@ -4359,7 +4939,7 @@ void register_flexflow_internal_tasks() {
   {
     TaskVariantRegistrar registrar(ADAM_UPD_PS_TASK_ID,
                                    "Adam Parameter Server Update");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<AdamOptimizer::ps_update_task>(
         registrar, "Adam Parameter Server Update Task");
@@ -4367,20 +4947,56 @@ void register_flexflow_internal_tasks() {
 #ifdef FF_USE_NCCL
   {
     TaskVariantRegistrar registrar(SGD_UPD_NCCL_TASK_ID, "SGD NCCL Update");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<SGDOptimizer::nccl_update_task>(
         registrar, "SGD NCCL Update Task");
   }
   {
     TaskVariantRegistrar registrar(ADAM_UPD_NCCL_TASK_ID, "Adam NCCL Update");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<AdamOptimizer::nccl_update_task>(
         registrar, "Adam NCCL Update Task");
   }
 #endif
+#ifdef FF_USE_CPU
+  {
+    TaskVariantRegistrar registrar(SGD_SPARSE_UPD_TASK_ID,
+                                   "SGD Sparse Update");
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<SGDOptimizer::sparse_update_task>(
+        registrar, "SGD Sparse Update Task");
+  }
+  {
+    TaskVariantRegistrar registrar(ADAM_SPARSE_UPD_TASK_ID,
+                                   "Adam Sparse Update");
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<AdamOptimizer::sparse_update_task>(
+        registrar, "Adam Sparse Update Task");
+  }
+#endif
+  {
+    TaskVariantRegistrar registrar(GRAD_OVERFLOW_CHECK_TASK_ID,
+                                   "Gradient Overflow Check");
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<Optimizer::check_gradient_overflow_task>(
+        registrar, "Gradient Overflow Check Task");
+  }
+  {
+    TaskVariantRegistrar registrar(GRAD_OVERFLOW_REDUCE_TASK_ID,
+                                   "Gradient Overflow Reduce");
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<bool,
+                                      Optimizer::reduce_gradient_overflow_task>(
+        registrar, "Gradient Overflow Reduce Task");
+  }
   // Initializer
+#ifndef FF_USE_CPU
   {
     TaskVariantRegistrar registrar(ZERO_INIT_TASK_ID, "Zero Init");
     registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
@@ -4388,13 +5004,15 @@ void register_flexflow_internal_tasks() {
     Runtime::preregister_task_variant<ZeroInitializer::init_task_cpu>(
         registrar, "Zero Init Task");
   }
+#endif
   {
     TaskVariantRegistrar registrar(ZERO_INIT_TASK_ID, "Zero Init");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<ZeroInitializer::init_task>(
         registrar, "Zero Init Task");
   }
+#ifndef FF_USE_CPU
   {
     TaskVariantRegistrar registrar(CONSTANT_INIT_TASK_ID, "Constant Init");
     registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
@@ -4402,30 +5020,31 @@ void register_flexflow_internal_tasks() {
     Runtime::preregister_task_variant<ConstantInitializer::init_task_cpu>(
         registrar, "Constant Init Task");
   }
+#endif
   {
     TaskVariantRegistrar registrar(CONSTANT_INIT_TASK_ID, "Constant Init");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<ConstantInitializer::init_task>(
         registrar, "Constant Init Task");
   }
   {
     TaskVariantRegistrar registrar(UNIFORM_INIT_TASK_ID, "Uniform Init");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<UniformInitializer::init_task>(
         registrar, "Uniform Init Task");
   }
   {
     TaskVariantRegistrar registrar(GLOROT_INIT_TASK_ID, "Glorot Init");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<GlorotUniform::init_task>(
         registrar, "Glorot Init Task");
   }
   {
     TaskVariantRegistrar registrar(NORMAL_INIT_TASK_ID, "Normalize Init");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<NormInitializer::init_task>(
         registrar, "Normalize Init Task");
@@ -4435,7 +5054,7 @@ void register_flexflow_internal_tasks() {
   {
     TaskVariantRegistrar registrar(NCCL_GETUNIQUEID_TASK_ID,
                                    "NCCL GetUniqueId");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<ncclUniqueId,
                                       Op::get_nccl_unique_id_task>(
@@ -4444,7 +5063,7 @@ void register_flexflow_internal_tasks() {
   {
     TaskVariantRegistrar registrar(NCCL_INIT_COMMS_TASK_ID,
                                    "NCCL Init Communicators");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<ncclComm_t, Op::init_nccl_comms_task>(
         registrar, "NCCL Init Communicators Task");
@@ -4453,7 +5072,7 @@ void register_flexflow_internal_tasks() {
   // Search
   {
     TaskVariantRegistrar registrar(STRATEGY_SEARCH_TASK_ID, "Stretegy Search");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<Simulator::strategy_search_task>(
         registrar, "Stretegy Search Task");
@@ -4461,16 +5080,39 @@ void register_flexflow_internal_tasks() {
   // Graph optimize
   {
     TaskVariantRegistrar registrar(GRAPH_OPTIMIZE_TASK_ID, "Graph Optimize");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<PCG::GraphOptimalViewSerialized,
                                       PCG::Graph::graph_optimize_task>(
         registrar, "Graph Optimize Task");
   }
+  // Checkpoint tasks
+  {
+    TaskVariantRegistrar registrar(CHECKPOINT_SAVE_TASK_ID, "Checkpoint Save");
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<Checkpoint::save_shard_task>(
+        registrar, "Checkpoint Save Task");
+  }
+  {
+    TaskVariantRegistrar registrar(CHECKPOINT_LOAD_TASK_ID, "Checkpoint Load");
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<bool, Checkpoint::load_shard_task>(
+        registrar, "Checkpoint Load Task");
+  }
+  {
+    TaskVariantRegistrar registrar(CHECKPOINT_FLUSH_TASK_ID,
+                                   "Checkpoint Flush");
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<bool, Checkpoint::flush_task>(
+        registrar, "Checkpoint Flush Task");
+  }
   // Parameter Server Prefetch task
   {
     TaskVariantRegistrar registrar(PS_PREFETCH_TASK_ID, "Weights Prefetch");
-    registrar.add_constraint(ProcessorConstraint(Processor::TOC_PROC));
+    registrar.add_constraint(ProcessorConstraint(WORKER_PROC_KIND));
     registrar.set_leaf();
     Runtime::preregister_task_variant<UtilityTasks::dummy_task>(
         registrar, "Weights Prefetch Task");
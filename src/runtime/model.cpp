@@ -130,6 +130,8 @@ FFHandler
     handle.workSpace = workspaceInst.pointer_untyped(0, sizeof(char));
   }
   // checkCUDA(hipMalloc(&handle.workSpace, handle.workSpaceSize));
+  checkCUDA(hipMalloc(&handle.gradOverflow, sizeof(bool)));
+  checkCUDA(hipMemset(handle.gradOverflow, 0, sizeof(bool)));
 #ifdef FF_USE_NCCL
   handle.ncclComm = NULL;
 #endif
@@ -126,6 +126,8 @@ FFHandler
     handle.workSpace = workspaceInst.pointer_untyped(0, sizeof(char));
   }
   // checkCUDA(cudaMalloc(&handle.workSpace, handle.workSpaceSize));
+  checkCUDA(cudaMalloc(&handle.gradOverflow, sizeof(bool)));
+  checkCUDA(cudaMemset(handle.gradOverflow, 0, sizeof(bool)));
 #ifdef FF_USE_NCCL
   handle.ncclComm = NULL;
 #endif
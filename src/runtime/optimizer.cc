@@ -20,7 +20,123 @@ namespace FlexFlow {
 
 using namespace Legion;
 
-Optimizer::Optimizer(FFModel const *_model) : model(_model) {}
+Optimizer::Optimizer(FFModel const *_model)
+    : model(_model), update_predicate(Predicate::TRUE_PRED), grad_scale(1.0f) {}
+
+void Optimizer::check_gradient_overflow_task(
+    Task const *task,
+    std::vector<PhysicalRegion> const &regions,
+    Context ctx,
+    Runtime *runtime) {
+  assert(regions.size() == 1);
+  assert(task->regions.size() == 1);
+  assert(task->local_arglen == sizeof(FFHandler));
+  FFHandler const *handle = (FFHandler const *)task->local_args;
+  Domain domain = runtime->get_index_space_domain(
+      ctx, task->regions[0].region.get_index_space());
+  float const *w_grad_ptr = helperGetTensorPointerRO<float>(
+      regions[0], task->regions[0], FID_DATA, ctx, runtime);
+  check_gradient_overflow_gpu(*handle, w_grad_ptr, domain.get_volume());
+}
+
+bool Optimizer::reduce_gradient_overflow_task(
+    Task const *task,
+    std::vector<PhysicalRegion> const &regions,
+    Context ctx,
+    Runtime *runtime) {
+  assert(regions.size() == 0);
+  assert(task->local_arglen == sizeof(FFHandler));
+  FFHandler const *handle = (FFHandler const *)task->local_args;
+  return reduce_gradient_overflow_gpu(*handle);
+}
+
+void Optimizer::sparse_update(TaskID task_id,
+                              TaskArgument const &arg,
+                              const ParallelTensor p,
+                              std::vector<ParallelTensor> const &states) {
+  Context ctx = model->config.lg_ctx;
+  Runtime *runtime = model->config.lg_hlr;
+  assert(p->sparse_grad_rows != NULL && p->sparse_grad_values != NULL);
+  ParallelTensor rows = p->sparse_grad_rows, values = p->sparse_grad_values;
+  // Only the parameter server applies sparse gradients, see Embedding
+  assert(p->sync_type == ParameterSyncType::PS);
+  // Push the touched rows of every replica to the parameter server
+  TaskLauncher launcher(task_id,
+                        arg,
+                        update_predicate,
+                        0 /*mapper_id*/,
+                        p->machine_view.hash());
+  launcher.map_arg =
+      TaskArgument(&p->owner_op->upd_task_priority, sizeof(int));
+  // regions[0]: sparse_grad_rows
+  launcher.add_region_requirement(
+      RegionRequirement(rows->region, READ_ONLY, EXCLUSIVE, rows->region));
+  launcher.add_field(0, FID_DATA);
+  // regions[1]: sparse_grad_values
+  launcher.add_region_requirement(RegionRequirement(
+      values->region, READ_ONLY, EXCLUSIVE, values->region));
+  launcher.add_field(1, FID_DATA);
+  // regions[2]: region
+  launcher.add_region_requirement(
+      RegionRequirement(p->region, READ_WRITE, EXCLUSIVE, p->region));
+  launcher.add_field(2, FID_DATA);
+  // regions[3...]: optimizer states
+  for (size_t i = 0; i < states.size(); i++) {
+    launcher.add_region_requirement(RegionRequirement(
+        states[i]->region, READ_WRITE, EXCLUSIVE, states[i]->region));
+    launcher.add_field(3 + i, FID_DATA);
+  }
+  runtime->execute_task(ctx, launcher);
+  ArgumentMap argmap;
+  IndexLauncher index_launcher(PS_PREFETCH_TASK_ID,
+                               p->parallel_is,
+                               TaskArgument(NULL, 0),
+                               argmap,
+                               Predicate::TRUE_PRED,
+                               false /*must*/,
+                               0 /*mapper_id*/,
+                               p->machine_view.hash());
+  index_launcher.map_arg =
+      TaskArgument(&p->owner_op->upd_task_priority, sizeof(int));
+  // regions[0]: region
+  index_launcher.add_region_requirement(RegionRequirement(
+      p->part, 0 /*projection*/, READ_ONLY, EXCLUSIVE, p->region));
+  index_launcher.add_field(0, FID_DATA);
+  runtime->execute_index_space(ctx, index_launcher);
+}
+
+#ifdef FF_USE_CPU
+// Shapes of the regions of a sparse update task, see Optimizer::sparse_update
+static void get_sparse_update_shape(Task const *task,
+                                    Context ctx,
+                                    Runtime *runtime,
+                                    int &num_replicas,
+                                    int &capacity,
+                                    int &out_dim,
+                                    size_t &table_size,
+                                    int &num_copies) {
+  Domain rows_domain = runtime->get_index_space_domain(
+      ctx, task->regions[0].region.get_index_space());
+  Domain values_domain = runtime->get_index_space_domain(
+      ctx, task->regions[1].region.get_index_space());
+  Domain w_domain = runtime->get_index_space_domain(
+      ctx, task->regions[2].region.get_index_space());
+  assert(rows_domain.hi()[0] == rows_domain.lo()[0]);
+  capacity = rows_domain.hi()[1] - rows_domain.lo()[1];
+  num_replicas = rows_domain.get_volume() / (capacity + 1);
+  out_dim = values_domain.hi()[0] - values_domain.lo()[0] + 1;
+  assert(values_domain.get_volume() ==
+         (size_t)num_replicas * capacity * out_dim);
+  assert(w_domain.hi()[0] - w_domain.lo()[0] + 1 == out_dim);
+  table_size = (size_t)out_dim * (w_domain.hi()[1] - w_domain.lo()[1] + 1);
+  assert(w_domain.get_volume() % table_size == 0);
+  num_copies = w_domain.get_volume() / table_size;
+  for (size_t i = 3; i < task->regions.size(); i++) {
+    assert(runtime->get_index_space_domain(
+               ctx, task->regions[i].region.get_index_space()) == w_domain);
+  }
+}
+#endif
 
 ParallelTensor create_replica_parameter(FFModel const *model,
                                         const ParallelTensor p) {
@@ -91,12 +207,25 @@ void SGDOptimizer::update(const ParallelTensor p) {
   Context ctx = model->config.lg_ctx;
   Runtime *runtime = model->config.lg_hlr;
   assert(p->owner_op != NULL);
-  if (p->sync_type == ParameterSyncType::PS) {
+  p->version++;
+  if (p->sparse_grad) {
+    std::vector<ParallelTensor> states;
+    if (momentum > 0.0f) {
+      assert(v_values.find(p->region) != v_values.end());
+      states.push_back(v_values[p->region]);
+    }
+    sparse_update(SGD_SPARSE_UPD_TASK_ID,
+                  TaskArgument(this, sizeof(SGDOptimizer)),
+                  p,
+                  states);
+  } else if (p->sync_type == ParameterSyncType::PS) {
     TaskLauncher launcher(SGD_UPD_PS_TASK_ID,
                           TaskArgument(this, sizeof(SGDOptimizer)),
-                          Predicate::TRUE_PRED,
+                          update_predicate,
                           0 /*mapper_id*/,
                           p->machine_view.hash());
+    launcher.map_arg =
+        TaskArgument(&p->owner_op->upd_task_priority, sizeof(int));
     // regions[0]: region_grad
     launcher.add_region_requirement(RegionRequirement(
         p->region_grad, READ_ONLY, EXCLUSIVE, p->region_grad));
@@ -127,6 +256,8 @@ void SGDOptimizer::update(const ParallelTensor p) {
                                  false /*must*/,
                                  0 /*mapper_id*/,
                                  p->machine_view.hash());
+    index_launcher.map_arg =
+        TaskArgument(&p->owner_op->upd_task_priority, sizeof(int));
     // regions[0]: region
     index_launcher.add_region_requirement(RegionRequirement(
         p->part, 0 /*projection*/, READ_ONLY, EXCLUSIVE, p->region));
@@ -156,10 +287,12 @@ void SGDOptimizer::update(const ParallelTensor p) {
                            p->parallel_is,
                            TaskArgument(this, sizeof(SGDOptimizer)),
                            argmap,
-                           Predicate::TRUE_PRED,
+                           update_predicate,
                            false /*must_epoch*/,
                            0 /*mapper_id*/,
                            p->machine_view.hash());
+    launcher.map_arg =
+        TaskArgument(&p->owner_op->upd_task_priority, sizeof(int));
     // regions[0]: region_grad
     launcher.add_region_requirement(RegionRequirement(p->part_grad,
                                                       0 /*projection id*/,
@@ -311,6 +444,50 @@ void SGDOptimizer::nccl_update_task(Task const *task,
 }
 #endif
 
+#ifdef FF_USE_CPU
+void SGDOptimizer::sparse_update_task(
+    Task const *task,
+    std::vector<PhysicalRegion> const &regions,
+    Context ctx,
+    Runtime *runtime) {
+  SGDOptimizer const *op = (SGDOptimizer *)task->args;
+  size_t num_regions = op->momentum > 0.0f ? 4 : 3;
+  assert(regions.size() == num_regions);
+  assert(task->regions.size() == num_regions);
+  int num_replicas, capacity, out_dim, num_copies;
+  size_t table_size;
+  get_sparse_update_shape(task,
+                          ctx,
+                          runtime,
+                          num_replicas,
+                          capacity,
+                          out_dim,
+                          table_size,
+                          num_copies);
+  int64_t const *rows_ptr = helperGetTensorPointerRO<int64_t>(
+      regions[0], task->regions[0], FID_DATA, ctx, runtime);
+  float const *values_ptr = helperGetTensorPointerRO<float>(
+      regions[1], task->regions[1], FID_DATA, ctx, runtime);
+  float *w_ptr = helperGetTensorPointerRW<float>(
+      regions[2], task->regions[2], FID_DATA, ctx, runtime);
+  float *v_ptr = NULL;
+  if (op->momentum > 0.0f) {
+    v_ptr = helperGetTensorPointerRW<float>(
+        regions[3], task->regions[3], FID_DATA, ctx, runtime);
+  }
+  sparse_update_task_cpu(op,
+                         rows_ptr,
+                         values_ptr,
+                         num_replicas,
+                         capacity,
+                         out_dim,
+                         table_size,
+                         num_copies,
+                         w_ptr,
+                         v_ptr);
+}
+#endif
+
 // ------------------------------------------------------------------
 //                        Adam Optimizer
 // ------------------------------------------------------------------
@@ -377,12 +554,20 @@ void AdamOptimizer::update(const ParallelTensor p) {
   assert(v_values.find(p->region) != v_values.end());
   assert(m_values.find(p->region) != m_values.end());
   assert(p->owner_op != NULL);
-  if (p->sync_type == ParameterSyncType::PS) {
+  p->version++;
+  if (p->sparse_grad) {
+    sparse_update(ADAM_SPARSE_UPD_TASK_ID,
+                  TaskArgument(this, sizeof(AdamOptimizer)),
+                  p,
+                  {v_values[p->region], m_values[p->region]});
+  } else if (p->sync_type == ParameterSyncType::PS) {
     TaskLauncher launcher(ADAM_UPD_PS_TASK_ID,
                           TaskArgument(this, sizeof(AdamOptimizer)),
-                          Predicate::TRUE_PRED,
+                          update_predicate,
                           0 /*mapper_id*/,
                           p->machine_view.hash());
+    launcher.map_arg =
+        TaskArgument(&p->owner_op->upd_task_priority, sizeof(int));
     // regions[0]: region_grad
     launcher.add_region_requirement(RegionRequirement(
         p->region_grad, READ_ONLY, EXCLUSIVE, p->region_grad));
@@ -417,6 +602,8 @@ void AdamOptimizer::update(const ParallelTensor p) {
                                  false /*must*/,
                                  0 /*mapper_id*/,
                                  p->machine_view.hash());
+    index_launcher.map_arg =
+        TaskArgument(&p->owner_op->upd_task_priority, sizeof(int));
     // regions[0]: region
     index_launcher.add_region_requirement(RegionRequirement(
         p->part, 0 /*projection*/, READ_ONLY, EXCLUSIVE, p->region));
@@ -446,10 +633,12 @@ void AdamOptimizer::update(const ParallelTensor p) {
                            p->parallel_is,
                            TaskArgument(this, sizeof(AdamOptimizer)),
                            argmap,
-                           Predicate::TRUE_PRED,
+                           update_predicate,
                            false /*must_epoch*/,
                            0 /*mapper_id*/,
                            p->machine_view.hash());
+    launcher.map_arg =
+        TaskArgument(&p->owner_op->upd_task_priority, sizeof(int));
     // regions[0]: region_grad
     launcher.add_region_requirement(RegionRequirement(p->part_grad,
                                                       0 /*projection id*/,
@@ -602,4 +791,47 @@ void AdamOptimizer::nccl_update_task(Task const *task,
 }
 #endif
 
+#ifdef FF_USE_CPU
+void AdamOptimizer::sparse_update_task(
+    Task const *task,
+    std::vector<PhysicalRegion> const &regions,
+    Context ctx,
+    Runtime *runtime) {
+  AdamOptimizer const *op = (AdamOptimizer *)task->args;
+  assert(regions.size() == 5);
+  assert(task->regions.size() == 5);
+  int num_replicas, capacity, out_dim, num_copies;
+  size_t table_size;
+  get_sparse_update_shape(task,
+                          ctx,
+                          runtime,
+                          num_replicas,
+                          capacity,
+                          out_dim,
+                          table_size,
+                          num_copies);
+  int64_t const *rows_ptr = helperGetTensorPointerRO<int64_t>(
+      regions[0], task->regions[0], FID_DATA, ctx, runtime);
+  float const *values_ptr = helperGetTensorPointerRO<float>(
+      regions[1], task->regions[1], FID_DATA, ctx, runtime);
+  float *w_ptr = helperGetTensorPointerRW<float>(
+      regions[2], task->regions[2], FID_DATA, ctx, runtime);
+  float *v_ptr = helperGetTensorPointerRW<float>(
+      regions[3], task->regions[3], FID_DATA, ctx, runtime);
+  float *m_ptr = helperGetTensorPointerRW<float>(
+      regions[4], task->regions[4], FID_DATA, ctx, runtime);
+  sparse_update_task_cpu(op,
+                         rows_ptr,
+                         values_ptr,
+                         num_replicas,
+                         capacity,
+                         out_dim,
+                         table_size,
+                         num_copies,
+                         w_ptr,
+                         v_ptr,
+                         m_ptr);
+}
+#endif
+
 }; // namespace FlexFlow
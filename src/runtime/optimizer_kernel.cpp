@@ -23,17 +23,56 @@ namespace FlexFlow {
 
 LegionRuntime::Logger::Category log_optimizer("optimizer");
 
+__global__ void
+    check_overflow_kernel(size_t count, float const *WGrad, bool *overflow) {
+  CUDA_KERNEL_LOOP(i, count) {
+    if (!isfinite(WGrad[i])) {
+      *overflow = true;
+    }
+  }
+}
+
+__host__ void Optimizer::check_gradient_overflow_gpu(FFHandler const &handle,
+                                                     float const *w_grad_ptr,
+                                                     size_t size) {
+  hipStream_t stream;
+  checkCUDA(get_legion_stream(&stream));
+  hipLaunchKernelGGL(check_overflow_kernel,
+                     GET_BLOCKS(size),
+                     CUDA_NUM_THREADS,
+                     0,
+                     stream,
+                     size,
+                     w_grad_ptr,
+                     handle.gradOverflow);
+}
+
+__host__ bool Optimizer::reduce_gradient_overflow_gpu(FFHandler const &handle) {
+  hipStream_t stream;
+  checkCUDA(get_legion_stream(&stream));
+  bool overflow = false;
+  checkCUDA(hipMemcpyAsync(&overflow,
+                           handle.gradOverflow,
+                           sizeof(bool),
+                           hipMemcpyDeviceToHost,
+                           stream));
+  checkCUDA(hipMemsetAsync(handle.gradOverflow, 0, sizeof(bool), stream));
+  checkCUDA(hipStreamSynchronize(stream));
+  return overflow;
+}
+
 __global__ void sgd_update(size_t count,
                            float lr,
                            float weight_decay,
                            float momentum,
                            bool nesterov,
+                           float grad_scale,
                            float const *WGrad,
                            float *V,
                            float *W) {
   // Refernce https://pytorch.org/docs/stable/_modules/torch/optim/sgd.html#SGD
   CUDA_KERNEL_LOOP(i, count) {
-    float gt = WGrad[i] + weight_decay * W[i];
+    float gt = WGrad[i] * grad_scale + weight_decay * W[i];
     if (momentum > 0.0f) {
       V[i] = V[i] * momentum + gt;
       if (nesterov)
@@ -78,6 +117,7 @@ __host__ void SGDOptimizer::ps_update_task_gpu(SGDOptimizer const *op,
                      op->weight_decay,
                      op->momentum,
                      op->nesterov,
+                     op->grad_scale,
                      w_grad_ptr,
                      v_ptr,
                      w_ptr);
@@ -114,6 +154,7 @@ __host__ void SGDOptimizer::nccl_update_task_gpu(SGDOptimizer const *op,
                      op->weight_decay,
                      op->momentum,
                      op->nesterov,
+                     op->grad_scale,
                      w_grad_ptr,
                      v_ptr,
                      w_ptr);
@@ -143,6 +184,7 @@ __global__ void adam_update(int count,
                             float beta2,
                             float weight_decay,
                             float epsilon,
+                            float grad_scale,
                             float const *WGrad,
                             float *M,
                             float *V,
@@ -152,7 +194,7 @@ __global__ void adam_update(int count,
   CUDA_KERNEL_LOOP(i, count) {
     // W[i] -= weight_decay * alpha_t * W[i];
     // float gt = WGrad[i];
-    float gt = WGrad[i] + weight_decay * W[i];
+    float gt = WGrad[i] * grad_scale + weight_decay * W[i];
     float mt = beta1 * M[i] + (1 - beta1) * gt;
     float vt = beta2 * V[i] + (1 - beta2) * gt * gt;
     M[i] = mt;
@@ -198,6 +240,7 @@ __host__ void AdamOptimizer::ps_update_task_gpu(AdamOptimizer const *op,
                      op->beta2,
                      op->weight_decay,
                      op->epsilon,
+                     op->grad_scale,
                      w_grad_ptr,
                      m_ptr,
                      v_ptr,
@@ -236,6 +279,7 @@ __host__ void AdamOptimizer::nccl_update_task_gpu(AdamOptimizer const *op,
                      op->beta2,
                      op->weight_decay,
                      op->epsilon,
+                     op->grad_scale,
                      w_grad_ptr,
                      m_ptr,
                      v_ptr,
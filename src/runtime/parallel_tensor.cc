@@ -632,6 +632,7 @@ bool ParallelTensorBase::set_tensor(FFModel const *ff,
   InlineLauncher launcher(req);
   PhysicalRegion pr = runtime->map_region(ctx, launcher);
   pr.wait_until_valid();
+  version++;
   switch (num_dims) {
 #define DIMFUNC(DIM)                                                           \
   case DIM: {                                                                  \
@@ -15,6 +15,7 @@
 
 #include "flexflow/simulator.h"
 #include "flexflow/model.h"
+#include "flexflow/ops/fused.h"
 #include "flexflow/ops/pool_2d.h"
 #include "flexflow/parallel_ops/combine.h"
 #include "flexflow/parallel_ops/partition.h"
@@ -336,6 +337,8 @@ size_t data_type_size(DataType type) {
       return sizeof(float);
     case DT_DOUBLE:
       return sizeof(double);
+    case DT_HALF:
+      return sizeof(half);
     case DT_INT32:
       return sizeof(int32_t);
     case DT_INT64:
@@ -763,6 +766,32 @@ float Simulator::estimate_xfer_cost(Op const *op,
   }
 }
 
+float Simulator::estimate_fusion_saving(Op const *producer,
+                                        Op const *consumer) {
+  // Same conditions as FFModel::apply_fusion for two operators on one view
+  if (!FusedOp::can_fuse(producer) || !FusedOp::can_fuse(consumer)) {
+    return 0.0f;
+  }
+  if (producer->has_inplace_output()) {
+    return 0.0f;
+  }
+  // The fused op runs as one task in the forward pass, and one task in the
+  // backward pass
+  float saving = machine->get_task_launch_overhead();
+  if (computationMode == COMP_MODE_TRAINING) {
+    saving += machine->get_task_launch_overhead();
+  }
+#ifdef FF_USE_CPU
+  // In a chain, the consumer reads each block of the producer's output
+  // from cache rather than from memory
+  if (FusedOp::is_chain_op(producer) && FusedOp::is_chain_op(consumer)) {
+    ParallelTensorShape shape = producer->outputs[0]->get_shape();
+    saving += shape.get_piece_size() / machine->get_gpu_fb_mem_bandwidth();
+  }
+#endif
+  return saving;
+}
+
 bool Op::estimate_sync_cost(Simulator *sim,
                             MachineView const &view,
                             CostMetrics &cost_metrics) const {
@@ -798,24 +827,37 @@ float Simulator::default_estimate_sync_cost(
     // No replications
     return 0.0f;
   } else {
-    bool inter_node_sync = false;
-    tl::optional<int> node = tl::nullopt;
-    for (Domain::DomainPointIterator it(view.get_domain()); it; it++) {
-      int my_device = view.get_device_id(*it);
-      int my_node = machine->get_gpu(my_device)->node_id;
-      if (node == tl::nullopt) {
-        node = my_node;
-      }
-      if (my_node != node.value()) {
-        inter_node_sync = true;
-        break;
-      }
+    return 2 * tensor_shape.get_piece_size() / get_sync_bandwidth(view);
+  }
+}
+
+float Simulator::estimate_sparse_sync_cost(size_t num_rows,
+                                           size_t row_size,
+                                           int num_replicas,
+                                           MachineView const &view) {
+  if (num_replicas == 1) {
+    return 0.0f;
+  }
+  // Every replica receives the rows of all other replicas
+  return (num_replicas - 1) * num_rows * row_size / get_sync_bandwidth(view);
+}
+
+float Simulator::get_sync_bandwidth(MachineView const &view) {
+  bool inter_node_sync = false;
+  tl::optional<int> node = tl::nullopt;
+  for (Domain::DomainPointIterator it(view.get_domain()); it; it++) {
+    int my_device = view.get_device_id(*it);
+    int my_node = machine->get_gpu(my_device)->node_id;
+    if (node == tl::nullopt) {
+      node = my_node;
+    }
+    if (my_node != node.value()) {
+      inter_node_sync = true;
+      break;
     }
-    float bandwidth = inter_node_sync
-                          ? this->machine->get_inter_node_gpu_bandwidth()
-                          : this->machine->get_intra_node_gpu_bandwidth();
-    return 2 * tensor_shape.get_piece_size() / bandwidth;
   }
+  return inter_node_sync ? this->machine->get_inter_node_gpu_bandwidth()
+                         : this->machine->get_intra_node_gpu_bandwidth();
 }
 
 float Simulator::simulate_runtime(
@@ -927,10 +969,9 @@ float Simulator::simulate_runtime(
     // Step 3a: consider backpropagation and weight update are overlapped
     for (int l = model->operators.size() - 1; l >= 0; l--) {
       Op *op = model->operators[l];
-      size_t element_size =
-          data_type_size(DT_FLOAT); // assume all weights have float elements
       ParallelConfig pc = global.find(op)->second;
       for (int j = 0; j < op->numWeights; j++) {
+        size_t element_size = data_type_size(op->weights[j]->data_type);
         std::set<int> synched;
         for (int firstId = 0; firstId < pc.num_parts(); firstId++) {
           if (synched.find(firstId) == synched.end()) {
@@ -986,9 +1027,8 @@ float Simulator::simulate_runtime(
     for (size_t l = 0; l < model->operators.size(); l++) {
       Op *op = model->operators[l];
       ParallelConfig pc = global.find(op)->second;
-      size_t element_size =
-          data_type_size(DT_FLOAT); // assume all weights have float elements
       for (int j = 0; j < op->numWeights; j++) {
+        size_t element_size = data_type_size(op->weights[j]->data_type);
         std::set<int> synched;
         for (int firstId = 0; firstId < pc.num_parts(); firstId++)
           if (synched.find(firstId) == synched.end()) {
@@ -1140,14 +1180,13 @@ float Simulator::simulate_runtime(
         OpSyncTask *task = tasks.at(to_run).get();
         Op const *op = to_run;
         ParallelConfig pc = global.find(op)->second;
-        size_t element_size =
-            data_type_size(DT_FLOAT); // assume all weights have float elements
 
         for (int j = 0; j < pc.num_parts(); j++) {
           available_devices[pc.device_ids[j]] = false;
         }
 
         for (int j = 0; j < op->numWeights; j++) {
+          size_t element_size = data_type_size(op->weights[j]->data_type);
           std::set<int> synched;
           for (int firstId = 0; firstId < pc.num_parts(); firstId++) {
             if (synched.find(firstId) == synched.end()) {
@@ -1288,9 +1327,9 @@ float LogicalTaskgraphBasedSimulator::simulate_runtime(
   for (size_t l = 0; l < model->layers.size(); l++) {
     Op *op = model->operators[l];
     ParallelConfig config = global.find(op)->second;
-    size_t element_size = data_type_size(DT_FLOAT);
     // NER step: add allreduce task after backward propogation
     for (int j = 0; j < op->numWeights; j++) {
+      size_t element_size = data_type_size(op->weights[j]->data_type);
       std::set<int> synched;
       std::vector<int> node_ids;
       for (int firstId = 0; firstId < config.num_parts(); firstId++) {
@@ -15,6 +15,7 @@
 
 #include "flexflow/substitution.h"
 #include "flexflow/dominators.h"
+#include "flexflow/egraph.h"
 #include "flexflow/ffconst_utils.h"
 #include "flexflow/graph.h"
 #include "flexflow/graph_structures.h"
@@ -37,7 +38,13 @@
 #include "flexflow/parallel_ops/replicate.h"
 #include "flexflow/utils/dot/dot_file.h"
 #include <chrono>
+#include <climits>
+#include <fstream>
 #include <iomanip>
+#include <limits>
+#include <set>
+#include <sys/resource.h>
+#include <unistd.h>
 
 namespace FlexFlow::PCG {
 
@@ -229,17 +236,17 @@ bool GraphXfer::map_output(TensorX const &src, TensorX const &dst) {
   return true;
 }
 
-bool GraphXfer::can_match(OpX *srcOp, Node const &op, Graph const *graph) {
-  if (srcOp->type != op.ptr->op_type)
+bool GraphXfer::can_match_parameters(OpX const *srcOp, Op const *op) const {
+  if (srcOp->type != op->op_type)
     return false;
   // check num input tensors
-  if ((int)srcOp->inputs.size() != op.ptr->numInputs)
+  if ((int)srcOp->inputs.size() != op->numInputs)
     return false;
   // check pmConstraints
   for (size_t i = 0; i < srcOp->pmConstraints.size(); i++) {
     PMConstraint pmc = srcOp->pmConstraints[i];
     int actValue = 0;
-    assert(op.ptr->get_int_parameter(pmc.para, &actValue));
+    assert(op->get_int_parameter(pmc.para, &actValue));
     // printf("pmc[%d] para(%d) comp(%d) value(%d) actValue(%d)\n",
     //        i, pmc.para, pmc.comp, pmc.value, actValue);
     switch (pmc.comp) {
@@ -277,6 +284,59 @@ bool GraphXfer::can_match(OpX *srcOp, Node const &op, Graph const *graph) {
         assert(false);
     }
   }
+  // check tnConstraints
+  for (size_t i = 0; i < srcOp->tnConstraints.size(); i++) {
+    TNConstraint tnc = srcOp->tnConstraints[i];
+    int actValue = 0, expValue = 0;
+    if (tnc.singlePara) {
+      assert(op->get_tensor_parameter(tnc.para1, tnc.dim1, &actValue));
+      expValue = tnc.value;
+    } else {
+      assert(op->get_tensor_parameter(tnc.para1, tnc.dim1, &actValue));
+      assert(op->get_tensor_parameter(tnc.para2, tnc.dim2, &expValue));
+    }
+    switch (tnc.comp) {
+      case COMPARE_EQ: {
+        if (actValue != expValue)
+          return false;
+        break;
+      }
+      case COMPARE_NE: {
+        if (actValue == expValue)
+          return false;
+        break;
+      }
+      case COMPARE_LT: {
+        if (actValue >= expValue)
+          return false;
+        break;
+      }
+      case COMPARE_LE: {
+        if (actValue > expValue)
+          return false;
+        break;
+      }
+      case COMPARE_GT: {
+        if (actValue <= expValue)
+          return false;
+        break;
+      }
+      case COMPARE_GE: {
+        if (actValue < expValue)
+          return false;
+        break;
+      }
+      default:
+        assert(false);
+    }
+  }
+  return true;
+}
+
+bool GraphXfer::can_match(OpX *srcOp, Node const &op, Graph const *graph) {
+  if (!this->can_match_parameters(srcOp, op.ptr)) {
+    return false;
+  }
   // check inputs
   std::map<int, std::pair<Node, int>> newMapInputs;
   for (size_t i = 0; i < srcOp->inputs.size(); i++) {
@@ -324,52 +384,6 @@ bool GraphXfer::can_match(OpX *srcOp, Node const &op, Graph const *graph) {
         return false;
     }
   }
-  // check tnConstraints
-  for (size_t i = 0; i < srcOp->tnConstraints.size(); i++) {
-    TNConstraint tnc = srcOp->tnConstraints[i];
-    int actValue = 0, expValue = 0;
-    if (tnc.singlePara) {
-      assert(op.ptr->get_tensor_parameter(tnc.para1, tnc.dim1, &actValue));
-      expValue = tnc.value;
-    } else {
-      assert(op.ptr->get_tensor_parameter(tnc.para1, tnc.dim1, &actValue));
-      assert(op.ptr->get_tensor_parameter(tnc.para2, tnc.dim2, &expValue));
-    }
-    switch (tnc.comp) {
-      case COMPARE_EQ: {
-        if (actValue != expValue)
-          return false;
-        break;
-      }
-      case COMPARE_NE: {
-        if (actValue == expValue)
-          return false;
-        break;
-      }
-      case COMPARE_LT: {
-        if (actValue >= expValue)
-          return false;
-        break;
-      }
-      case COMPARE_LE: {
-        if (actValue > expValue)
-          return false;
-        break;
-      }
-      case COMPARE_GT: {
-        if (actValue <= expValue)
-          return false;
-        break;
-      }
-      case COMPARE_GE: {
-        if (actValue < expValue)
-          return false;
-        break;
-      }
-      default:
-        assert(false);
-    }
-  }
   return true;
 }
 
@@ -489,6 +503,9 @@ GraphXferMatch GraphXfer::get_match_record(Graph const *g) const {
 
 void GraphXfer::find_matches(Graph const *graph,
                              std::vector<GraphXferMatch> &matches) {
+  if (!this->load_rule(graph)) {
+    return;
+  }
   this->find_matches(0, graph, matches);
 }
 
@@ -585,6 +602,9 @@ void GraphXfer::run(
     int &num_matches_rejected) {
   // printf("run: depth(%d) srcOps.size(%zu) graph.size(%zu) candidates(%zu)\n",
   // depth, srcOps.size(), graph->inEdges.size(), candidates.size());
+  if (depth == 0 && !this->load_rule(graph)) {
+    return;
+  }
   if (depth >= (int)srcOps.size()) {
     // Create dst operators
     bool pass = true;
@@ -597,7 +617,7 @@ void GraphXfer::run(
       return;
     // Check that output tensors with external edges are mapped
     for (auto const &opIt : mappedOps) {
-      auto const &list = graph->outEdges[opIt.first];
+      auto const &list = graph->outEdges.at(opIt.first);
       for (auto const &e : list) {
         if (mappedOps.find(e.dstOp) == mappedOps.end()) {
           // dstOp is external, (srcOp, srcIdx) must be in mappedOutputs
@@ -759,28 +779,41 @@ std::unique_ptr<Graph> Graph::with_output_tensor_reshaped_to(
 
 Graph *GraphXfer::create_new_graph(
     Graph const *graph, SimplificationSettings const &simplification_settings) {
-  Graph *newGraph = new Graph(model);
-  // Step 1: map dst ops
+  // The copy shares the edges of graph, so only the edges rewritten below
+  // are copied
+  Graph *newGraph = new Graph(*graph);
+  // Step 1: connect unmapped dst ops to the mapped outputs
   std::vector<OpX *>::const_iterator dstIt;
-  // Step 2: add edges to the graph
-  for (auto const &opIt : graph->inEdges)
-    if (mappedOps.find(opIt.first) == mappedOps.end()) {
-      // Unmapped ops
-      auto const &list = opIt.second;
-      for (auto const &it : list)
-        if (mappedOps.find(it.srcOp) != mappedOps.end()) {
-          // mapped src -> unmapped dst
-          TensorX srcTen;
-          srcTen.op = mappedOps[it.srcOp];
-          srcTen.idx = it.srcIdx;
-          assert(mappedOutputs.find(srcTen) != mappedOutputs.end());
-          TensorX dstTen = mappedOutputs[srcTen];
-          newGraph->add_edge(dstTen.op->mapOp, it.dstOp, dstTen.idx, it.dstIdx);
-        } else {
-          // unmapped src -> unmmaped dst
-          newGraph->add_edge(it.srcOp, it.dstOp, it.srcIdx, it.dstIdx);
-        }
+  for (auto const &opIt : mappedOps) {
+    for (auto const &it : graph->outEdges.at(opIt.first)) {
+      if (mappedOps.find(it.dstOp) == mappedOps.end()) {
+        // mapped src -> unmapped dst
+        TensorX srcTen;
+        srcTen.op = opIt.second;
+        srcTen.idx = it.srcIdx;
+        assert(mappedOutputs.find(srcTen) != mappedOutputs.end());
+        TensorX dstTen = mappedOutputs[srcTen];
+        newGraph->add_edge(dstTen.op->mapOp, it.dstOp, dstTen.idx, it.dstIdx);
+      }
+    }
+  }
+  // Step 2: remove mapped ops, and unmapped ops left without edges
+  for (auto const &opIt : mappedOps) {
+    Node const &op = opIt.first;
+    for (auto const &it : graph->inEdges.at(op)) {
+      if (newGraph->has_edge(it)) {
+        newGraph->remove_edge(it);
+      }
+    }
+    for (auto const &it : graph->outEdges.at(op)) {
+      if (newGraph->has_edge(it)) {
+        newGraph->remove_edge(it);
+      }
+    }
+    if (newGraph->inEdges.find(op) != newGraph->inEdges.end()) {
+      newGraph->remove_node(op);
     }
+  }
   // Step 3: add edges for mapped ops
   for (dstIt = dstOps.begin(); dstIt != dstOps.end(); dstIt++) {
     OpX *dstOp = *dstIt;
@@ -925,7 +958,8 @@ bool GraphXfer::create_new_operator(OpX const *opx, Node &op) {
                                                     attn->dropout,
                                                     attn->bias,
                                                     attn->add_bias_kv,
-                                                    attn->add_zero_attn);
+                                                    attn->add_zero_attn,
+                                                    attn->causal);
       break;
     }
     case OP_SOFTMAX: {
@@ -1504,9 +1538,6 @@ void create_xfer(GraphXfer &xfer, sl::Rule const &r, int parallel_degree) {
   xfer.dstOps = create_rule_graph(
       xfer, r.dstOp, get_input_tensor, &xfer.srcOps, parallel_degree);
   xfer.name = r.name;
-  if (xfer.srcOps.size() == 1) {
-    printf("Here!\n");
-  }
 
   for (sl::MapOutput const &m : r.mappedOutput) {
     TensorX srcTensorX = xfer.srcOps[m.srcOpId]->outputs[m.srcTsId];
@@ -1598,6 +1629,132 @@ std::vector<GraphXfer *> create_xfers(FFModel *model,
   return xfers;
 }
 
+// Same types and parameters imply the same constraints, as compared by
+// create_xfers
+static bool have_same_types_and_parameters(std::vector<sl::Operator> const &a,
+                                           std::vector<sl::Operator> const &b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); i++) {
+    if (a[i].op_type != b[i].op_type || a[i].para.size() != b[i].para.size()) {
+      return false;
+    }
+    for (sl::Parameter const &p1 : a[i].para) {
+      bool found_same = false;
+      for (sl::Parameter const &p2 : b[i].para) {
+        if (p1.key == p2.key && p1.value == p2.value) {
+          found_same = true;
+        }
+      }
+      if (!found_same) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+std::vector<GraphXfer *>
+    create_lazy_xfers(FFModel *model,
+                      std::shared_ptr<sl::RuleCollection const> const &rules,
+                      int parallel_degree) {
+  std::vector<GraphXfer *> xfers;
+  std::vector<sl::Rule const *> kept_rules;
+  for (size_t i = 0; i < rules->rules.size(); i++) {
+    sl::Rule const &r = rules->rules[i];
+    // The rules create_xfers keeps, deduplicated from the rules alone
+    if (r.srcOp.size() != 1 || r.dstOp.size() == 1) {
+      continue;
+    }
+    bool found_same_rule = false;
+    for (sl::Rule const *old_rule : kept_rules) {
+      if (have_same_types_and_parameters(old_rule->srcOp, r.srcOp) &&
+          have_same_types_and_parameters(old_rule->dstOp, r.dstOp)) {
+        found_same_rule = true;
+        break;
+      }
+    }
+    if (found_same_rule) {
+      continue;
+    }
+    kept_rules.push_back(&r);
+    GraphXfer *xfer = new GraphXfer(model);
+    xfer->name = r.name;
+    xfer->rules = rules;
+    xfer->rule_idx = i;
+    xfer->rule_parallel_degree = parallel_degree;
+    xfers.push_back(xfer);
+  }
+  return xfers;
+}
+
+bool GraphXfer::load_rule(Graph const *graph) {
+  if (this->rules == nullptr) {
+    return true;
+  }
+  std::unordered_set<OperatorType> op_types;
+  for (auto const &it : graph->inEdges) {
+    op_types.insert(it.first.ptr->op_type);
+  }
+  return this->load_rule(op_types);
+}
+
+bool GraphXfer::load_rule(std::unordered_set<OperatorType> const &op_types) {
+  if (this->rules == nullptr) {
+    return true;
+  }
+  sl::Rule const &r = this->rules->rules[this->rule_idx];
+  if (op_types.find(r.srcOp[0].op_type) == op_types.end()) {
+    return false;
+  }
+  create_xfer(*this, r, this->rule_parallel_degree);
+  this->rules = nullptr;
+  return true;
+}
+
+// Parameter holding the degree of a parallel operator
+static PMParameter get_parallel_degree_parameter(OperatorType type) {
+  switch (type) {
+    case OP_REPARTITION:
+      return PM_REPARTITION_DEGREE;
+    case OP_COMBINE:
+      return PM_COMBINE_DEGREE;
+    case OP_REPLICATE:
+      return PM_REPLICATE_DEGREE;
+    case OP_REDUCTION:
+      return PM_REDUCTION_DEGREE;
+    default:
+      return PM_INVALID;
+  }
+}
+
+std::vector<std::pair<OperatorType, int>>
+    GraphXfer::get_op_types(bool src) const {
+  std::vector<std::pair<OperatorType, int>> types;
+  if (this->rules != nullptr) {
+    sl::Rule const &r = this->rules->rules[this->rule_idx];
+    for (sl::Operator const &op : src ? r.srcOp : r.dstOp) {
+      int degree = 0;
+      if (get_parallel_degree_parameter(op.op_type) != PM_INVALID &&
+          op.at(PM_PARALLEL_DEGREE).has_value()) {
+        degree = this->rule_parallel_degree;
+      }
+      types.push_back({op.op_type, degree});
+    }
+  } else {
+    for (OpX const *opx : src ? this->srcOps : this->dstOps) {
+      int degree = 0;
+      PMParameter para = get_parallel_degree_parameter(opx->type);
+      if (para != PM_INVALID) {
+        opx->get_pm_constraint(para, degree);
+      }
+      types.push_back({opx->type, degree});
+    }
+  }
+  return types;
+}
+
 GraphSearchHelper::GraphSearchHelper(FFModel *model)
     : model(model), config(model->config) {
   this->logger = std::unique_ptr<RecursiveLogger>(new RecursiveLogger("gs"));
@@ -1609,6 +1766,191 @@ void GraphSearchHelper::load_graph_substitutions(
   xfers = all_pcg_xfers;
 }
 
+std::vector<GraphXfer *> GraphSearchHelper::prune_xfers(
+    Graph const *graph, std::vector<GraphXfer *> const &xfers) const {
+  std::vector<std::pair<OperatorType, int>> op_types;
+  for (auto const &it : graph->inEdges) {
+    Op const *op = it.first.ptr;
+    int degree = 0;
+    PMParameter para = get_parallel_degree_parameter(op->op_type);
+    if (para != PM_INVALID) {
+      op->get_int_parameter(para, &degree);
+    }
+    op_types.push_back({op->op_type, degree});
+  }
+  return prune_xfers(op_types, xfers);
+}
+
+std::vector<GraphXfer *> GraphSearchHelper::prune_xfers(
+    std::vector<std::pair<OperatorType, int>> const &op_types,
+    std::vector<GraphXfer *> const &xfers) {
+  typedef std::map<std::pair<OperatorType, int>, int> OpTypeCounts;
+  // Count operators by type and degree, where degree 0 counts every degree
+  auto add_op_type = [](OpTypeCounts &counts,
+                        std::pair<OperatorType, int> const &type,
+                        int count) {
+    for (int degree : {0, type.second}) {
+      int &total = counts[{type.first, degree}];
+      total = count > INT_MAX - total ? INT_MAX : total + count;
+      if (type.second == 0) {
+        break;
+      }
+    }
+  };
+  // Operators in the graph, or INT_MAX of a type a kept xfer creates
+  OpTypeCounts available;
+  for (auto const &type : op_types) {
+    add_op_type(available, type, 1);
+  }
+  std::vector<OpTypeCounts> needed(xfers.size());
+  for (size_t i = 0; i < xfers.size(); i++) {
+    for (auto const &type : xfers[i]->get_op_types(true)) {
+      add_op_type(needed[i], type, 1);
+    }
+  }
+  // Keeping an xfer makes the types it creates available to the others
+  std::vector<bool> kept(xfers.size(), false);
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (size_t i = 0; i < xfers.size(); i++) {
+      if (kept[i]) {
+        continue;
+      }
+      bool can_match = true;
+      for (auto const &it : needed[i]) {
+        auto const &a = available.find(it.first);
+        if (a == available.end() || a->second < it.second) {
+          can_match = false;
+          break;
+        }
+      }
+      if (can_match) {
+        kept[i] = true;
+        changed = true;
+        for (auto const &type : xfers[i]->get_op_types(false)) {
+          add_op_type(available, type, INT_MAX);
+        }
+      }
+    }
+  }
+  std::vector<GraphXfer *> pruned;
+  for (size_t i = 0; i < xfers.size(); i++) {
+    if (kept[i]) {
+      pruned.push_back(xfers[i]);
+    }
+  }
+  return pruned;
+}
+
+// Searches after which an xfer that never matched a model family is skipped
+static int const XFER_SKIP_SEARCHES = 3;
+// Compiles an xfer is skipped for before it is searched again, so xfers that
+// start matching once the model family grows are not lost for good
+static int const XFER_RETRY_SKIPS = 10;
+
+void GraphSearchHelper::order_xfers_by_statistics(
+    std::vector<GraphXfer *> &xfers) {
+  if (this->xfer_statistics_path.empty()) {
+    return;
+  }
+  auto get_statistics = [this](GraphXfer const *xfer) {
+    auto const &it = this->xfer_statistics.find(xfer->get_name());
+    return it == this->xfer_statistics.end() ? XferStatistics()
+                                             : it->second;
+  };
+  std::vector<GraphXfer *> ordered;
+  for (GraphXfer *xfer : xfers) {
+    if (this->skipped_xfers.find(xfer->get_name()) ==
+        this->skipped_xfers.end()) {
+      ordered.push_back(xfer);
+    }
+  }
+  std::stable_sort(ordered.begin(),
+                   ordered.end(),
+                   [&get_statistics](GraphXfer const *a, GraphXfer const *b) {
+                     return get_statistics(a).num_accepted >
+                            get_statistics(b).num_accepted;
+                   });
+  xfers = ordered;
+}
+
+// A model family is the set of operator types of its PCG; its statistics
+// file has one line per xfer with the fields of XferStatistics and the name
+void GraphSearchHelper::load_xfer_statistics(Graph const *graph) {
+  this->xfer_statistics.clear();
+  this->searched_xfers.clear();
+  this->skipped_xfers.clear();
+  this->xfer_statistics_path.clear();
+  if (this->config.substitution_stats_dir.empty()) {
+    return;
+  }
+  std::set<OperatorType> op_types;
+  for (auto const &it : graph->inEdges) {
+    op_types.insert(it.first.ptr->op_type);
+  }
+  size_t family = 0;
+  for (OperatorType op_type : op_types) {
+    hash_combine(family, (int)op_type);
+  }
+  std::ostringstream oss;
+  oss << this->config.substitution_stats_dir << "/xfer_stats_" << std::hex
+      << family << ".txt";
+  this->xfer_statistics_path = oss.str();
+  std::ifstream file(this->xfer_statistics_path);
+  XferStatistics stats;
+  std::string name;
+  while (file >> stats.num_searches >> stats.num_matches >>
+             stats.num_accepted >> stats.num_skipped &&
+         std::getline(file >> std::ws, name)) {
+    this->xfer_statistics[name] = stats;
+  }
+  // Decided once per compile, as every segment of the graph is searched
+  // with the same xfers
+  for (auto &it : this->xfer_statistics) {
+    if (it.second.num_searches >= XFER_SKIP_SEARCHES &&
+        it.second.num_matches == 0) {
+      if (++it.second.num_skipped <= XFER_RETRY_SKIPS) {
+        this->skipped_xfers.insert(it.first);
+      } else {
+        it.second.num_skipped = 0;
+      }
+    }
+  }
+  log_xfers.info() << "Loaded statistics of " << this->xfer_statistics.size()
+                   << " xfers from " << this->xfer_statistics_path << ", "
+                   << this->skipped_xfers.size() << " skipped";
+}
+
+void GraphSearchHelper::save_xfer_statistics(void) {
+  if (this->xfer_statistics_path.empty()) {
+    return;
+  }
+  for (std::string const &name : this->searched_xfers) {
+    this->xfer_statistics[name].num_searches++;
+  }
+  std::string tmp_path =
+      this->xfer_statistics_path + ".tmp." + std::to_string(getpid());
+  {
+    std::ofstream file(tmp_path, std::ios::trunc);
+    for (auto const &it : this->xfer_statistics) {
+      file << it.second.num_searches << " " << it.second.num_matches << " "
+           << it.second.num_accepted << " " << it.second.num_skipped << " "
+           << it.first << "\n";
+    }
+    if (!file.good()) {
+      file.close();
+      remove(tmp_path.c_str());
+      log_xfers.warning() << "Cannot write " << this->xfer_statistics_path;
+      return;
+    }
+  }
+  // Concurrent compiles of the family keep the last writer's statistics
+  if (rename(tmp_path.c_str(), this->xfer_statistics_path.c_str()) != 0) {
+    remove(tmp_path.c_str());
+  }
+}
+
 void GraphSearchHelper::generate_all_pcg_xfers() {
   std::vector<int> all_parallel_degrees, single_node_parallel_degrees;
   auto const &config = this->model->config;
@@ -1661,11 +2003,11 @@ void GraphSearchHelper::generate_all_pcg_xfers() {
     considered_parallel_degrees.push_back(workersPerNode);
     if (numNodes > 1)
       considered_parallel_degrees.push_back(numNodes * workersPerNode);
-    sl::RuleCollection rule_collection = sl::load_rule_collection_from_path(
-        config.substitution_json_path.value());
+    std::shared_ptr<sl::RuleCollection const> rule_collection =
+        sl::get_rule_collection(config.substitution_json_path.value());
     for (int degree : considered_parallel_degrees) {
       std::vector<GraphXfer *> xfers =
-          create_xfers(this->model, rule_collection, degree);
+          create_lazy_xfers(this->model, rule_collection, degree);
       all_pcg_xfers.insert(all_pcg_xfers.end(), xfers.begin(), xfers.end());
     }
   } else {
@@ -1779,6 +2121,7 @@ void GraphSearchHelper::graph_optimize(
 
   Graph *graph = this->construct_graph();
   graph->duplicate_input_nodes();
+  this->load_xfer_statistics(graph);
   std::unordered_map<Node, MachineView> empty_strategy;
   if (!this->config.export_strategy_computation_graph_file.empty()) {
     graph->export_strategy_computation_graph(
@@ -1794,6 +2137,7 @@ void GraphSearchHelper::graph_optimize(
           tl::nullopt /*input_shape*/);
   this->logger->debug() << "Total cache size: "
                         << this->cached_optimized_graphs.size();
+  this->save_xfer_statistics();
   std::cout << "Optimal cost: " << optimal.cost << std::endl;
   SimplificationSettings settings;
   settings.fuse_parallel_ops = true;
@@ -1827,6 +2171,7 @@ void GraphSearchHelper::graph_optimize_no_split(
   this->logger->debug() << "Starting graph optimization without split";
 
   Graph *graph = this->construct_graph();
+  this->load_xfer_statistics(graph);
   std::unordered_map<Node, MachineView> empty_strategy;
   if (!this->config.export_strategy_computation_graph_file.empty()) {
     graph->export_strategy_computation_graph(
@@ -1837,6 +2182,7 @@ void GraphSearchHelper::graph_optimize_no_split(
   settings.simplify_parallel_ops = true;
   best_graph = this->base_optimize(graph, settings);
   optimal_views = best_graph->optimal_views();
+  this->save_xfer_statistics();
 
   this->logger->debug() << "Total cache size: "
                         << this->cached_optimized_graphs.size();
@@ -2013,6 +2359,19 @@ std::unique_ptr<Graph> GraphSearchHelper::base_optimize(
 
   std::vector<GraphXfer *> xfers;
   this->load_graph_substitutions(xfers);
+  size_t num_xfers = xfers.size();
+  if (this->config.search_prune_xfers) {
+    xfers = this->prune_xfers(r_graph, xfers);
+  }
+  size_t num_pruned = num_xfers - xfers.size();
+  this->order_xfers_by_statistics(xfers);
+  size_t num_skipped = num_xfers - num_pruned - xfers.size();
+  if (this->config.search_egraph_node_budget > 0) {
+    return this->egraph_optimize(r_graph, xfers, simplification_settings);
+  }
+  auto search_start = std::chrono::steady_clock::now();
+  int num_iterations = 0;
+  size_t num_graphs = 0;
 
   Graph *graph = new Graph(*r_graph);
 
@@ -2054,6 +2413,7 @@ std::unique_ptr<Graph> GraphSearchHelper::base_optimize(
                    candidates.size());
 
     log_xfers.debug() << "Considering " << xfers.size() << " possible xfers";
+    num_iterations++;
     for (size_t i = 0; i < xfers.size(); i++) {
       int num_matches_found = 0, num_matches_rejected = 0;
       log_xfers.debug() << "Considering xfer: " << xfers[i]->get_name();
@@ -2068,6 +2428,14 @@ std::unique_ptr<Graph> GraphSearchHelper::base_optimize(
                     num_matches_rejected);
       log_xfers.debug() << "Rejected [ " << num_matches_rejected << " / "
                         << num_matches_found << " ] matches";
+      num_graphs += num_matches_found;
+      if (!this->xfer_statistics_path.empty()) {
+        std::string name = xfers[i]->get_name();
+        XferStatistics &stats = this->xfer_statistics[name];
+        stats.num_matches += num_matches_found;
+        stats.num_accepted += num_matches_found - num_matches_rejected;
+        this->searched_xfers.insert(name);
+      }
       /* std::cout << "." << std::flush; */
     }
     /* std::cout << std::endl; */
@@ -2076,11 +2444,109 @@ std::unique_ptr<Graph> GraphSearchHelper::base_optimize(
     }
   }
 
+  // Every skipped xfer saves one run per iteration; compare the search time
+  // with --no-xfer-pruning for the speedup of the pruning
+  double search_time = std::chrono::duration<double, std::milli>(
+                           std::chrono::steady_clock::now() - search_start)
+                           .count();
+  log_xfers.info("Searched with %zu of %zu xfers (%zu pruned by operator "
+                 "types, %zu skipped by statistics) in %.2lf ms, saving %zu "
+                 "of %zu xfer runs",
+                 xfers.size(),
+                 num_xfers,
+                 num_pruned,
+                 num_skipped,
+                 search_time,
+                 (num_pruned + num_skipped) * num_iterations,
+                 num_xfers * num_iterations);
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  log_xfers.info("Created %zu candidate graphs (%.1lf per second), %zu "
+                 "queued; peak RSS %.1lf MB",
+                 num_graphs,
+                 num_graphs / std::max(search_time, 1e-3) * 1000.0,
+                 hashmap.size(),
+                 usage.ru_maxrss / 1024.0);
+
   this->logger->debug() << "Optimized cost: " << best_graph->optimal_cost();
   // best_graph->print_dot();
   return std::unique_ptr<Graph>(best_graph);
 }
 
+std::unique_ptr<Graph> GraphSearchHelper::egraph_optimize(
+    Graph const *r_graph,
+    std::vector<GraphXfer *> const &xfers,
+    SimplificationSettings const &simplification_settings) {
+  auto search_start = std::chrono::steady_clock::now();
+  EGraph egraph(this->model);
+  egraph.add_graph(r_graph);
+  int num_rounds =
+      egraph.saturate(xfers, this->config.search_egraph_node_budget);
+
+  // Each operator is charged its cheapest view; the views of the graph
+  // extracted are then chosen by the DP of optimal_cost
+  bool training = this->config.computationMode == COMP_MODE_TRAINING;
+  MachineResource resource(this->config);
+  auto op_cost = [&](Op const *op) {
+    float best = std::numeric_limits<float>::infinity();
+    if (op->is_parallel_op()) {
+      // A parallel op computes nothing, its cost is the data it moves
+      // from the views of its producer to its own
+      Op const *producer = op->inputs[0]->owner_op;
+      for (MachineView const &source_view :
+           this->model->search->get_valid_machine_views(producer, resource)) {
+        if (!op->inputs[0]->is_valid_machine_view(source_view)) {
+          continue;
+        }
+        for (MachineView const &sink_view :
+             this->model->search->get_valid_machine_views(op, resource)) {
+          best = std::min(best,
+                          this->model->simulator->estimate_xfer_cost(
+                              op, 0, source_view, sink_view));
+        }
+      }
+      return best;
+    }
+    for (MachineView const &view :
+         this->model->search->get_valid_machine_views(op, resource)) {
+      CostMetrics cost =
+          this->model->simulator->measure_operator_cost(op, view);
+      float time = cost.forward_time;
+      if (training) {
+        time += cost.backward_time;
+      }
+      best = std::min(best, time);
+    }
+    return best;
+  };
+  std::unique_ptr<Graph> best_graph = egraph.extract(op_cost);
+  float start_cost = r_graph->optimal_cost();
+  float best_cost = std::numeric_limits<float>::infinity();
+  if (best_graph != nullptr) {
+    best_graph->simplify(simplification_settings);
+    assert(best_graph->check_correctness());
+    best_cost = best_graph->optimal_cost();
+  }
+  if (best_cost >= start_cost) {
+    best_graph.reset(new Graph(*r_graph));
+    best_cost = start_cost;
+  }
+
+  double search_time = std::chrono::duration<double, std::milli>(
+                           std::chrono::steady_clock::now() - search_start)
+                           .count();
+  log_xfers.info("E-graph search with %zu xfers: %d rounds, %zu e-nodes in "
+                 "%zu e-classes, cost %.4lf -> %.4lf in %.2lf ms",
+                 xfers.size(),
+                 num_rounds,
+                 egraph.num_enodes(),
+                 egraph.num_eclasses(),
+                 start_cost,
+                 best_cost,
+                 search_time);
+  return best_graph;
+}
+
 size_t gs_dp_state_hash(Graph const *graph,
                         Node const &sink_node,
                         tl::optional<ParallelTensorShape> const &output_shape,
@@ -2994,6 +3460,7 @@ namespace FlexFlow {
 using PCG::Edge;
 using PCG::Graph;
 using PCG::Node;
+using PCG::NodeTaskPriority;
 
 void FFModel::graph_optimize(
     size_t budget,
@@ -3006,7 +3473,8 @@ void FFModel::graph_optimize(
 
 bool FFModel::convert_graph_to_operators(
     Graph const *graph,
-    std::unordered_map<Node, MachineView> const &optimal_views) {
+    std::unordered_map<Node, MachineView> const &optimal_views,
+    std::unordered_map<Node, NodeTaskPriority> const &priorities) {
   // Clear operators
   operators.clear();
   std::unordered_map<Node, int> todos;
@@ -3155,6 +3623,12 @@ bool FFModel::convert_graph_to_operators(
     for (int i = 0; i < new_op->numWeights; i++) {
       new_op->weights[i]->machine_view = view;
     }
+    if (priorities.find(node) != priorities.end()) {
+      NodeTaskPriority const &priority = priorities.find(node)->second;
+      new_op->fwd_task_priority = priority.forward;
+      new_op->bwd_task_priority = priority.backward;
+      new_op->upd_task_priority = priority.update;
+    }
     node_to_op[node] = new_op;
     operators.push_back(new_op);
     // Decrease the todos
@@ -1,6 +1,12 @@
 #include "flexflow/substitution_loader.h"
 #include <cassert>
+#include <fcntl.h>
 #include <functional>
+#include <map>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 using json = nlohmann::json;
 
@@ -70,8 +76,214 @@ RuleCollection load_rule_collection(std::istream &s) {
 }
 
 RuleCollection load_rule_collection_from_path(std::string const &path) {
-  std::ifstream input(path);
+  std::ifstream input(path, std::ios::binary);
+  uint32_t magic = 0;
+  input.read((char *)&magic, sizeof(magic));
+  if (input.gcount() == sizeof(magic) && magic == RULE_COLLECTION_MAGIC) {
+    return load_rule_collection_binary(path);
+  }
+  input.clear();
+  input.seekg(0);
   return load_rule_collection(input);
 }
 
+std::shared_ptr<RuleCollection const>
+    get_rule_collection(std::string const &path) {
+  static std::mutex mutex;
+  static std::map<std::string, std::shared_ptr<RuleCollection const>> loaded;
+  std::lock_guard<std::mutex> lock(mutex);
+  std::shared_ptr<RuleCollection const> &rules = loaded[path];
+  if (rules == nullptr) {
+    rules = std::make_shared<RuleCollection const>(
+        load_rule_collection_from_path(path));
+  }
+  return rules;
+}
+
+template <typename T>
+static void write_records(std::ofstream &out, std::vector<T> const &records) {
+  out.write((char const *)records.data(), records.size() * sizeof(T));
+}
+
+void save_rule_collection_binary(RuleCollection const &c,
+                                 std::string const &path) {
+  std::vector<BinaryRule> rules;
+  std::vector<BinaryOperator> operators;
+  // Pairs of opId and tsId, pairs of key and value, and quadruples of
+  // dstOpId, dstTsId, srcOpId and srcTsId
+  std::vector<int32_t> tensors, parameters, mapped_outputs;
+  std::string names;
+  auto add_operators = [&](std::vector<Operator> const &ops) {
+    for (Operator const &op : ops) {
+      BinaryOperator b;
+      b.op_type = op.op_type;
+      b.first_input = tensors.size() / 2;
+      b.num_inputs = op.input.size();
+      for (Tensor const &t : op.input) {
+        tensors.push_back(t.opId);
+        tensors.push_back(t.tsId);
+      }
+      b.first_parameter = parameters.size() / 2;
+      b.num_parameters = op.para.size();
+      for (Parameter const &p : op.para) {
+        parameters.push_back(p.key);
+        parameters.push_back(p.value);
+      }
+      operators.push_back(b);
+    }
+  };
+  for (Rule const &r : c.rules) {
+    BinaryRule b;
+    b.name_offset = names.size();
+    b.name_size = r.name.size();
+    names += r.name;
+    b.first_op = operators.size();
+    b.num_src_ops = r.srcOp.size();
+    b.num_dst_ops = r.dstOp.size();
+    add_operators(r.srcOp);
+    add_operators(r.dstOp);
+    b.first_mapped_output = mapped_outputs.size() / 4;
+    b.num_mapped_outputs = r.mappedOutput.size();
+    for (MapOutput const &m : r.mappedOutput) {
+      mapped_outputs.insert(mapped_outputs.end(),
+                            {m.dstOpId, m.dstTsId, m.srcOpId, m.srcTsId});
+    }
+    rules.push_back(b);
+  }
+  BinaryRuleCollectionHeader header;
+  header.magic = RULE_COLLECTION_MAGIC;
+  header.version = RULE_COLLECTION_VERSION;
+  header.num_rules = rules.size();
+  header.num_operators = operators.size();
+  header.num_tensors = tensors.size() / 2;
+  header.num_parameters = parameters.size() / 2;
+  header.num_mapped_outputs = mapped_outputs.size() / 4;
+  header.names_size = names.size();
+
+  std::ofstream out(path, std::ios::binary);
+  out.write((char const *)&header, sizeof(header));
+  write_records(out, rules);
+  write_records(out, operators);
+  write_records(out, tensors);
+  write_records(out, parameters);
+  write_records(out, mapped_outputs);
+  out.write(names.data(), names.size());
+  if (!out.good()) {
+    throw std::runtime_error("Failed to write rule collection to " + path);
+  }
+}
+
+static void check_range(int32_t first, int32_t num, int32_t total) {
+  if (first < 0 || num < 0 || first > total || num > total - first) {
+    throw std::runtime_error("Corrupted binary rule collection");
+  }
+}
+
+static RuleCollection decode_rule_collection(char const *data, size_t size) {
+  BinaryRuleCollectionHeader const *header =
+      (BinaryRuleCollectionHeader const *)data;
+  if (size < sizeof(*header) || header->magic != RULE_COLLECTION_MAGIC ||
+      header->version != RULE_COLLECTION_VERSION) {
+    throw std::runtime_error("Not a binary rule collection of version " +
+                             std::to_string(RULE_COLLECTION_VERSION));
+  }
+  int32_t const counts[] = {header->num_rules,
+                            header->num_operators,
+                            header->num_tensors,
+                            header->num_parameters,
+                            header->num_mapped_outputs,
+                            header->names_size};
+  for (int32_t count : counts) {
+    check_range(0, count, INT32_MAX);
+  }
+  size_t expected_size =
+      sizeof(*header) + header->num_rules * sizeof(BinaryRule) +
+      header->num_operators * sizeof(BinaryOperator) +
+      (2 * (size_t)header->num_tensors + 2 * (size_t)header->num_parameters +
+       4 * (size_t)header->num_mapped_outputs) *
+          sizeof(int32_t) +
+      header->names_size;
+  if (size != expected_size) {
+    throw std::runtime_error("Corrupted binary rule collection");
+  }
+  BinaryRule const *rules = (BinaryRule const *)(header + 1);
+  BinaryOperator const *operators =
+      (BinaryOperator const *)(rules + header->num_rules);
+  int32_t const *tensors = (int32_t const *)(operators + header->num_operators);
+  int32_t const *parameters = tensors + 2 * header->num_tensors;
+  int32_t const *mapped_outputs = parameters + 2 * header->num_parameters;
+  char const *names = (char const *)(mapped_outputs +
+                                     4 * header->num_mapped_outputs);
+
+  auto get_operator = [&](BinaryOperator const &b) {
+    check_range(b.first_input, b.num_inputs, header->num_tensors);
+    check_range(b.first_parameter, b.num_parameters, header->num_parameters);
+    Operator op;
+    op.op_type = static_cast<OperatorType>(b.op_type);
+    if (op.op_type == OP_INVALID) {
+      throw std::runtime_error("Attempted to load invalid OperatorType");
+    }
+    for (int i = 0; i < b.num_inputs; i++) {
+      int32_t const *t = tensors + 2 * (b.first_input + i);
+      op.input.push_back({t[0], t[1]});
+    }
+    for (int i = 0; i < b.num_parameters; i++) {
+      int32_t const *p = parameters + 2 * (b.first_parameter + i);
+      op.para.push_back({static_cast<PMParameter>(p[0]), p[1]});
+    }
+    return op;
+  };
+  RuleCollection c;
+  c.rules.resize(header->num_rules);
+  for (int i = 0; i < header->num_rules; i++) {
+    BinaryRule const &b = rules[i];
+    Rule &r = c.rules[i];
+    check_range(b.name_offset, b.name_size, header->names_size);
+    check_range(b.first_op, b.num_src_ops, header->num_operators);
+    check_range(
+        b.first_op + b.num_src_ops, b.num_dst_ops, header->num_operators);
+    check_range(b.first_mapped_output,
+                b.num_mapped_outputs,
+                header->num_mapped_outputs);
+    r.name.assign(names + b.name_offset, b.name_size);
+    for (int j = 0; j < b.num_src_ops; j++) {
+      r.srcOp.push_back(get_operator(operators[b.first_op + j]));
+    }
+    for (int j = 0; j < b.num_dst_ops; j++) {
+      r.dstOp.push_back(
+          get_operator(operators[b.first_op + b.num_src_ops + j]));
+    }
+    for (int j = 0; j < b.num_mapped_outputs; j++) {
+      int32_t const *m = mapped_outputs + 4 * (b.first_mapped_output + j);
+      r.mappedOutput.push_back({m[0], m[1], m[2], m[3]});
+    }
+  }
+  return c;
+}
+
+RuleCollection load_rule_collection_binary(std::string const &path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Cannot open rule collection " + path);
+  }
+  struct stat st;
+  void *data = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (data == MAP_FAILED) {
+    throw std::runtime_error("Cannot map rule collection " + path);
+  }
+  RuleCollection c;
+  try {
+    c = decode_rule_collection((char const *)data, st.st_size);
+  } catch (...) {
+    munmap(data, st.st_size);
+    throw;
+  }
+  munmap(data, st.st_size);
+  return c;
+}
+
 } // namespace FlexFlow::substitution_loader
@@ -0,0 +1,221 @@
+/* Copyright 2023 CMU, Facebook, LANL, MIT, NVIDIA, and Stanford (alphabetical)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares the blocked CPU GEMM against a naive loop on the GEMM shapes of
+// the example models with their default batch size of 64
+
+#include "flexflow/utils/cpu_gemm.h"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+struct GemmShape {
+  char const *name;
+  bool trans_a, trans_b;
+  int m, n, k, batch_count;
+  bool use_bias;
+  ActiMode activation;
+};
+
+// Linear computes Y = act(W^T X + b) with W stored in_dim x out_dim, so
+// m = out_dim, n = batch size and k = in_dim
+static GemmShape const shapes[] = {
+    {"alexnet/dense1", true, false, 4096, 64, 9216, 1, true, AC_MODE_RELU},
+    {"alexnet/dense2", true, false, 4096, 64, 4096, 1, true, AC_MODE_RELU},
+    {"alexnet/dense3", true, false, 10, 64, 4096, 1, true, AC_MODE_NONE},
+    {"mlp_unify/dense1", true, false, 8192, 64, 1024, 1, true, AC_MODE_RELU},
+    {"mlp_unify/dense2", true, false, 8192, 64, 8192, 1, true, AC_MODE_RELU},
+    {"dlrm/bot_mlp1", true, false, 64, 64, 4, 1, true, AC_MODE_RELU},
+    {"dlrm/top_mlp1", true, false, 64, 64, 64, 1, true, AC_MODE_RELU},
+    {"dlrm/top_mlp2", true, false, 2, 64, 64, 1, true, AC_MODE_NONE},
+    // one sequence of 512 tokens through a 1024-wide dense layer
+    {"transformer/dense", true, false, 1024, 512, 1024, 1, false,
+     AC_MODE_RELU},
+    // per-head attention scores and values as BatchMatmul runs them
+    {"transformer/qk", true, false, 512, 512, 64, 16, false, AC_MODE_NONE},
+    {"transformer/pv", false, false, 64, 512, 512, 16, false, AC_MODE_NONE},
+};
+
+static void naive_gemm(GemmShape const &s,
+                       float const *A,
+                       int lda,
+                       float const *B,
+                       int ldb,
+                       float *C,
+                       int ldc,
+                       float const *bias) {
+  for (int b = 0; b < s.batch_count; b++) {
+    float const *a = A + (size_t)b * lda * (s.trans_a ? s.m : s.k);
+    float const *bb = B + (size_t)b * ldb * (s.trans_b ? s.k : s.n);
+    float *c = C + (size_t)b * ldc * s.n;
+    for (int i = 0; i < s.m; i++) {
+      for (int j = 0; j < s.n; j++) {
+        float sum = 0.0f;
+        for (int p = 0; p < s.k; p++) {
+          float x = s.trans_a ? a[(size_t)i * lda + p] : a[(size_t)p * lda + i];
+          float y =
+              s.trans_b ? bb[(size_t)p * ldb + j] : bb[(size_t)j * ldb + p];
+          sum += x * y;
+        }
+        if (bias != NULL) {
+          sum += bias[i];
+        }
+        if (s.activation == AC_MODE_RELU) {
+          sum = std::max(sum, 0.0f);
+        }
+        c[(size_t)j * ldc + i] = sum;
+      }
+    }
+  }
+}
+
+static double now_ms(void) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+int main(int argc, char **argv) {
+  int num_threads = 1, repeats = 5;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+      num_threads = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--repeats") && i + 1 < argc) {
+      repeats = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--isa") && i + 1 < argc) {
+      char const *name = argv[++i];
+      bool found = false;
+      for (int isa = CPU_GEMM_ISA_GENERIC; isa <= CPU_GEMM_ISA_AVX512; isa++) {
+        if (!strcmp(name, cpu_gemm_isa_name((CpuGemmIsa)isa)) &&
+            cpu_gemm_isa_supported((CpuGemmIsa)isa)) {
+          cpu_gemm_set_isa((CpuGemmIsa)isa);
+          found = true;
+        }
+      }
+      if (!found) {
+        fprintf(stderr, "ISA %s is not available\n", name);
+        return 1;
+      }
+    } else {
+      fprintf(stderr,
+              "Usage: %s [--threads N] [--repeats N] "
+              "[--isa generic|avx2|avx512]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+  cpu_gemm_set_num_threads(num_threads);
+  printf("isa = %s, threads = %d\n",
+         cpu_gemm_isa_name(cpu_gemm_get_isa()),
+         cpu_gemm_get_num_threads());
+  printf("%-20s %5s %5s %5s %5s %10s %10s %8s %10s\n",
+         "shape",
+         "m",
+         "n",
+         "k",
+         "batch",
+         "naive",
+         "blocked",
+         "speedup",
+         "max_err");
+
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  bool ok = true;
+  for (GemmShape const &s : shapes) {
+    int lda = s.trans_a ? s.k : s.m;
+    int ldb = s.trans_b ? s.n : s.k;
+    int ldc = s.m;
+    long long int stride_a = (long long int)s.m * s.k;
+    long long int stride_b = (long long int)s.k * s.n;
+    long long int stride_c = (long long int)s.m * s.n;
+    std::vector<float> A(stride_a * s.batch_count), B(stride_b * s.batch_count);
+    std::vector<float> bias(s.m);
+    std::vector<float> ref(stride_c * s.batch_count);
+    std::vector<float> out(stride_c * s.batch_count);
+    for (float &x : A) {
+      x = dist(gen);
+    }
+    for (float &x : B) {
+      x = dist(gen);
+    }
+    for (float &x : bias) {
+      x = dist(gen);
+    }
+    float const *bias_ptr = s.use_bias ? bias.data() : NULL;
+    double gflop = 2.0 * s.m * s.n * s.k * s.batch_count * 1e-9;
+
+    double t_start = now_ms();
+    naive_gemm(s, A.data(), lda, B.data(), ldb, ref.data(), ldc, bias_ptr);
+    double naive_ms = now_ms() - t_start;
+
+    double blocked_ms = 1e30;
+    for (int r = 0; r < repeats; r++) {
+      t_start = now_ms();
+      cpu_gemm(s.trans_a,
+               s.trans_b,
+               s.m,
+               s.n,
+               s.k,
+               1.0f,
+               A.data(),
+               lda,
+               stride_a,
+               B.data(),
+               ldb,
+               stride_b,
+               0.0f,
+               out.data(),
+               ldc,
+               stride_c,
+               s.batch_count,
+               bias_ptr,
+               s.activation);
+      blocked_ms = std::min(blocked_ms, now_ms() - t_start);
+    }
+
+    double max_err = 0.0;
+    for (size_t i = 0; i < out.size(); i++) {
+      double err = fabs(out[i] - ref[i]) / std::max(1.0, fabs(ref[i]));
+      max_err = std::max(max_err, err);
+    }
+    // the two loops sum in different orders, allow the usual k * eps bound
+    if (max_err > s.k * FLT_EPSILON) {
+      ok = false;
+    }
+    printf("%-20s %5d %5d %5d %5d %10.2f %10.2f %7.1fx %10.2e\n",
+           s.name,
+           s.m,
+           s.n,
+           s.k,
+           s.batch_count,
+           gflop / (naive_ms * 1e-3),
+           gflop / (blocked_ms * 1e-3),
+           naive_ms / blocked_ms,
+           max_err);
+  }
+  printf("GFLOP/s for naive and blocked, best of %d blocked runs\n", repeats);
+  if (!ok) {
+    fprintf(stderr, "blocked GEMM does not match the naive loop\n");
+    return 1;
+  }
+  return 0;
+}
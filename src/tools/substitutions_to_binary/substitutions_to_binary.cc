@@ -0,0 +1,63 @@
+/* Copyright 2023 CMU, Facebook, LANL, MIT, NVIDIA, and Stanford (alphabetical)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Converts a substitution rule collection to the binary format, or, with
+// --load, reports the time and peak memory of loading one. Run --load once
+// per format, since the peak memory of a process never decreases
+
+#include "flexflow/substitution_loader.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <sys/resource.h>
+
+using namespace FlexFlow::substitution_loader;
+
+static long get_peak_rss_kb(void) {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    fprintf(stderr,
+            "Usage: %s <rules> <binary-output>\n"
+            "       %s --load <rules>\n",
+            argv[0],
+            argv[0]);
+    return 1;
+  }
+  if (!strcmp(argv[1], "--load")) {
+    long rss_before = get_peak_rss_kb();
+    auto start = std::chrono::steady_clock::now();
+    RuleCollection rules = load_rule_collection_from_path(argv[2]);
+    double elapsed = std::chrono::duration<double, std::milli>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    printf("%s: %zu rules, load time = %.2f ms, peak RSS = %ld KB "
+           "(%ld KB before loading)\n",
+           argv[2],
+           rules.rules.size(),
+           elapsed,
+           get_peak_rss_kb(),
+           rss_before);
+    return 0;
+  }
+  RuleCollection rules = load_rule_collection_from_path(argv[1]);
+  save_rule_collection_binary(rules, argv[2]);
+  printf("Wrote %zu rules to %s\n", rules.rules.size(), argv[2]);
+  return 0;
+}
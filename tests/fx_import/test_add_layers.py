@@ -0,0 +1,45 @@
+# Adds a batch of layers with FFModel.add_layers and checks it against the
+# same layers added one call at a time, e.g.,
+#   flexflow_python test_add_layers.py -ll:py 1 -ll:gpu 1 -ll:fsize 2048 -ll:zsize 2048
+from flexflow.core import *
+
+
+def top_level_task():
+  ffconfig = FFConfig()
+  ffmodel = FFModel(ffconfig)
+  input_tensor = ffmodel.create_tensor([ffconfig.batch_size, 64],
+                                       DataType.DT_FLOAT)
+
+  t = ffmodel.dense(input_tensor, 32, ActiMode.AC_MODE_RELU)
+  a, b = ffmodel.split(t, 2, 1)
+  t = ffmodel.add(ffmodel.sigmoid(a), b)
+  expected = [ffmodel.softmax(ffmodel.dense(t, 10)), t]
+
+  batch = LayerBatch()
+  t = batch.input()
+  t = batch.dense(t, 32, ActiMode.AC_MODE_RELU)
+  a, b = batch.split(t, 2, 1)
+  t = batch.add(batch.sigmoid(a), b)
+  outputs = ffmodel.add_layers(batch,
+                               [input_tensor],
+                               [batch.softmax(batch.dense(t, 10)), t])
+  assert len(outputs) == len(expected) == 2
+  for output, tensor in zip(outputs, expected):
+    assert output.dims == tensor.dims, (output.dims, tensor.dims)
+  assert outputs[0].dims == (ffconfig.batch_size, 10), outputs[0].dims
+
+  # A malformed batch raises instead of aborting the process
+  for op_type, inputs in [("LAYER_NORM", ["x"]), ("RELU", ["missing"])]:
+    batch = LayerBatch()
+    x = batch.input(name="x")
+    y = batch.add_node(op_type, inputs)
+    try:
+      ffmodel.add_layers(batch, [input_tensor], [y])
+      assert False, "%s(%s) was added" % (op_type, inputs)
+    except RuntimeError as e:
+      assert str(e).startswith("[FX]"), str(e)
+  print("add layers test passed")
+
+
+if __name__ == "__main__":
+  top_level_task()
@@ -0,0 +1,64 @@
+# Imports a whole PyTorch graph with the native FX-IR importer and checks it
+# against the Python importer, e.g.,
+#   flexflow_python test_fx_import.py -ll:py 1 -ll:gpu 1 -ll:fsize 2048 -ll:zsize 2048
+import os
+import tempfile
+
+import torch
+import torch.nn as nn
+from flexflow.core import *
+from flexflow.torch.model import PyTorchModel
+
+
+class Net(nn.Module):
+  def __init__(self):
+    super().__init__()
+    self.conv = nn.Conv2d(3, 8, 3, padding=1)
+    self.pool = nn.MaxPool2d(2)
+    self.flat = nn.Flatten()
+    self.linear1 = nn.Linear(8 * 16 * 16, 64)
+    self.linear2 = nn.Linear(32, 10)
+    self.relu = nn.ReLU()
+    self.softmax = nn.Softmax(dim=-1)
+
+  def forward(self, x):
+    y = self.pool(self.relu(self.conv(x)))
+    y = self.linear1(self.flat(y))
+    a, b = torch.split(y, 32, dim=1)
+    y = (self.relu(a) + b).view(-1, 32)
+    return self.softmax(self.linear2(y))
+
+
+def top_level_task():
+  ffconfig = FFConfig()
+  ffmodel = FFModel(ffconfig)
+  dims = [ffconfig.batch_size, 3, 32, 32]
+  input_tensor = ffmodel.create_tensor(dims, DataType.DT_FLOAT)
+
+  with tempfile.TemporaryDirectory() as tmp:
+    filename = os.path.join(tmp, "net.ff")
+    PyTorchModel(Net()).torch_to_file(filename)
+    expected = PyTorchModel.file_to_ff(filename, ffmodel, [input_tensor])
+    outputs = ffmodel.import_fx_file(filename, [input_tensor])
+  assert len(outputs) == len(expected) == 1
+  assert outputs[0].dims == expected[0].dims == (ffconfig.batch_size, 10), \
+    outputs[0].dims
+
+  # Nodes without their parameters are rejected instead of being imported
+  # as identities
+  with tempfile.TemporaryDirectory() as tmp:
+    filename = os.path.join(tmp, "layer_norm.ff")
+    with open(filename, "w") as f:
+      f.write("x; ; ln,; INPUT\n")
+      f.write("ln; x,; output,; LAYER_NORM\n")
+      f.write("output; ln,; ; OUTPUT\n")
+    try:
+      ffmodel.import_fx_file(filename, [input_tensor])
+      assert False, "LAYER_NORM was imported"
+    except RuntimeError as e:
+      assert "LAYER_NORM" in str(e), str(e)
+  print("fx import test passed")
+
+
+if __name__ == "__main__":
+  top_level_task()
@@ -36,6 +36,8 @@ $EXE $FF_HOME/examples/python/keras/func_cifar10_cnn_net2net.py -ll:py 1 -ll:gpu
 #Python
 $EXE $FF_HOME/examples/python/native/print_layers.py -ll:py 1 -ll:gpu $GPUS -ll:fsize 14048 -ll:zsize 12192 --epochs 5 -b ${BATCHSIZE}
 $EXE $FF_HOME/examples/python/native/split.py -ll:py 1 -ll:gpu $GPUS -ll:fsize 14048 -ll:zsize 12192 -b ${BATCHSIZE}
+$EXE $FF_HOME/tests/fx_import/test_fx_import.py -ll:py 1 -ll:gpu $GPUS -ll:fsize 14048 -ll:zsize 12192 -b ${BATCHSIZE}
+$EXE $FF_HOME/tests/fx_import/test_add_layers.py -ll:py 1 -ll:gpu $GPUS -ll:fsize 14048 -ll:zsize 12192 -b ${BATCHSIZE}
 $EXE $FF_HOME/examples/python/native/alexnet.py -ll:py 1 -ll:gpu $GPUS -ll:fsize 14048 -ll:zsize 12192 --epochs 40
 $EXE $FF_HOME/examples/python/native/mnist_mlp.py -ll:py 1 -ll:gpu $GPUS -ll:fsize 14048 -ll:zsize 12192 --epochs 5 -b ${BATCHSIZE}
 $EXE $FF_HOME/examples/python/native/mnist_cnn.py -ll:py 1 -ll:gpu $GPUS -ll:fsize 14048 -ll:zsize 12192 --epochs 5 -b ${BATCHSIZE}
@@ -0,0 +1,100 @@
+#include "flexflow/checkpoint.h"
+#include "gtest/gtest.h"
+#include <cstdio>
+#include <stdlib.h>
+
+using namespace FlexFlow;
+
+static std::string make_checkpoint_dir(void) {
+  char dir[] = "/tmp/ff_checkpoint_XXXXXX";
+  EXPECT_NE(mkdtemp(dir), nullptr);
+  return dir;
+}
+
+TEST(checkpoint, manifest_round_trip) {
+  std::string path = make_checkpoint_dir() + "/manifest";
+  CheckpointManifest manifest;
+  manifest.checkpoint_id = 0x123456789abcdefULL;
+  manifest.num_ranks = 4;
+  manifest.scalars["adam_beta1_t"] = 0.9 * 0.9 * 0.9;
+  CheckpointTensorInfo info;
+  info.name = "layer_3/weight_0";
+  info.data_type = DT_FLOAT;
+  info.ndims = 2;
+  info.dims[0] = 512;
+  info.dims[1] = 1024;
+  manifest.tensors.push_back(info);
+  EXPECT_TRUE(manifest.write(path));
+
+  CheckpointManifest loaded;
+  EXPECT_TRUE(loaded.read(path));
+  EXPECT_EQ(loaded.checkpoint_id, manifest.checkpoint_id);
+  EXPECT_EQ(loaded.num_ranks, 4);
+  EXPECT_EQ(loaded.scalars.at("adam_beta1_t"), 0.9 * 0.9 * 0.9);
+  EXPECT_EQ(loaded.find_tensor("layer_3/weight_0"), 0);
+  EXPECT_EQ(loaded.find_tensor("layer_3/weight_1"), -1);
+  EXPECT_EQ(loaded.tensors[0].dims[1], 1024);
+  remove(path.c_str());
+}
+
+TEST(checkpoint, reshard_on_load) {
+  std::string dir = make_checkpoint_dir();
+  // A 4 x 6 tensor saved as two 4 x 3 shards by two ranks
+  std::vector<float> tensor(24);
+  for (int i = 0; i < 24; i++) {
+    tensor[i] = i;
+  }
+  CheckpointWriter writer;
+  for (int rank = 0; rank < 2; rank++) {
+    CheckpointShardHeader header;
+    header.magic = CHECKPOINT_SHARD_MAGIC;
+    header.checkpoint_id = 7;
+    header.tensor_id = 0;
+    header.ndims = 2;
+    header.lo[0] = 0;
+    header.hi[0] = 3;
+    header.lo[1] = rank * 3;
+    header.hi[1] = rank * 3 + 2;
+    header.num_bytes = 12 * sizeof(float);
+    char const *begin = (char const *)&tensor[rank * 12];
+    writer.write(get_checkpoint_shard_path(dir, 7, rank),
+                 header,
+                 std::vector<char>(begin, begin + header.num_bytes));
+  }
+  EXPECT_TRUE(writer.flush());
+
+  std::vector<CheckpointShardLocation> shards;
+  for (int rank = 0; rank < 2; rank++) {
+    read_checkpoint_shards(dir, 7, rank, shards);
+  }
+  EXPECT_EQ(shards.size(), 2u);
+  // Restore the 2 x 6 half with the higher innermost index
+  int64_t lo[2] = {2, 0}, hi[2] = {3, 5};
+  std::vector<float> part(12, -1.0f);
+  size_t num_copied = 0;
+  for (CheckpointShardLocation const &shard : shards) {
+    FILE *file = fopen(get_checkpoint_shard_path(dir, 7, shard.rank).c_str(),
+                       "rb");
+    std::vector<char> data(shard.header.num_bytes);
+    fseek(file, shard.offset, SEEK_SET);
+    EXPECT_EQ(fread(data.data(), 1, data.size(), file), data.size());
+    fclose(file);
+    num_copied += copy_checkpoint_box(2,
+                                      shard.header.lo,
+                                      shard.header.hi,
+                                      data.data(),
+                                      lo,
+                                      hi,
+                                      (char *)part.data(),
+                                      sizeof(float));
+  }
+  EXPECT_EQ(num_copied, 12u);
+  for (int j = 0; j < 6; j++) {
+    for (int i = 0; i < 2; i++) {
+      EXPECT_EQ(part[j * 2 + i], tensor[j * 4 + i + 2]);
+    }
+  }
+  for (int rank = 0; rank < 2; rank++) {
+    remove(get_checkpoint_shard_path(dir, 7, rank).c_str());
+  }
+}
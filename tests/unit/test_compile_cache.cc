@@ -0,0 +1,76 @@
+#include "flexflow/compile_cache.h"
+#include "gtest/gtest.h"
+#include <cstdio>
+#include <fstream>
+#include <stdlib.h>
+
+using namespace FlexFlow;
+
+static std::string make_cache_dir(void) {
+  char dir[] = "/tmp/ff_compile_cache_XXXXXX";
+  EXPECT_NE(mkdtemp(dir), nullptr);
+  return dir;
+}
+
+TEST(compile_cache, store_and_load) {
+  CompileCache cache(make_cache_dir());
+  CompileCacheKey key;
+  key.append(42);
+  key.append(std::string("linear"));
+  std::vector<char> data = {'p', 'c', 'g', '\0', 'v'};
+  std::vector<char> loaded;
+  EXPECT_FALSE(cache.load(key, loaded));
+  EXPECT_TRUE(cache.store(key, data));
+  EXPECT_TRUE(cache.load(key, loaded));
+  EXPECT_EQ(loaded, data);
+  remove(cache.get_path(key).c_str());
+}
+
+TEST(compile_cache, different_keys_miss) {
+  CompileCache cache(make_cache_dir());
+  CompileCacheKey key, other;
+  key.append(1);
+  other.append(2);
+  std::vector<char> data(100000, 'x');
+  std::vector<char> loaded;
+  EXPECT_TRUE(cache.store(key, data));
+  EXPECT_FALSE(cache.load(other, loaded));
+  remove(cache.get_path(key).c_str());
+}
+
+TEST(compile_cache, corrupt_entry_misses) {
+  CompileCache cache(make_cache_dir());
+  CompileCacheKey key;
+  key.append(7);
+  std::vector<char> data(64, 'y');
+  EXPECT_TRUE(cache.store(key, data));
+  {
+    // flip the last byte of the result
+    std::fstream file(cache.get_path(key),
+                      std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(-(int)sizeof(uint64_t) - 1, std::ios::end);
+    file.put('z');
+  }
+  std::vector<char> loaded;
+  EXPECT_FALSE(cache.load(key, loaded));
+  remove(cache.get_path(key).c_str());
+}
+
+TEST(compile_cache, corrupt_size_misses) {
+  CompileCache cache(make_cache_dir());
+  CompileCacheKey key;
+  key.append(9);
+  std::vector<char> data(64, 'w');
+  EXPECT_TRUE(cache.store(key, data));
+  {
+    // overwrite the size of the result with a huge one
+    std::fstream file(cache.get_path(key),
+                      std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(-(int)(2 * sizeof(uint64_t) + data.size()), std::ios::end);
+    uint64_t size = ~(uint64_t)0 >> 1;
+    file.write(reinterpret_cast<char const *>(&size), sizeof(size));
+  }
+  std::vector<char> loaded;
+  EXPECT_FALSE(cache.load(key, loaded));
+  remove(cache.get_path(key).c_str());
+}
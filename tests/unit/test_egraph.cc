@@ -0,0 +1,106 @@
+#include "flexflow/egraph.h"
+#include "flexflow/model.h"
+#include "gtest/gtest.h"
+
+using namespace FlexFlow;
+using namespace FlexFlow::PCG;
+
+namespace {
+
+class TestOp : public Op {
+public:
+  TestOp(int guid, OperatorType type, int num_outputs = 1)
+      : Op(guid, false, type, NULL, 0, 0, num_outputs) {}
+  void init(FFModel const &) override {}
+  void forward(FFModel const &) override {}
+  void backward(FFModel const &) override {}
+  void print_layer(FFModel const &) override {}
+  bool measure_operator_cost(Simulator *,
+                             MachineView const &,
+                             CostMetrics &) const override {
+    return false;
+  }
+};
+
+Node node_of(TestOp &op) {
+  return Node(op.op_guid, &op);
+}
+
+} // namespace
+
+TEST(egraph, congruence_after_merge) {
+  TestOp a(1, OP_INPUT), b(2, OP_INPUT), relu(3, OP_RELU);
+  EGraph egraph(NULL);
+  int ea = egraph.add_operator(node_of(a), {})[0];
+  int eb = egraph.add_operator(node_of(b), {})[0];
+  int fa = egraph.add_operator(node_of(relu), {ea})[0];
+  int fb = egraph.add_operator(node_of(relu), {eb})[0];
+  EXPECT_EQ(egraph.num_enodes(), 4u);
+  EXPECT_EQ(egraph.num_eclasses(), 4u);
+  EXPECT_NE(egraph.find(fa), egraph.find(fb));
+
+  EXPECT_TRUE(egraph.merge(ea, eb));
+  EXPECT_FALSE(egraph.merge(eb, ea));
+  egraph.rebuild();
+  // relu(a) and relu(b) are now the same e-node
+  EXPECT_EQ(egraph.find(fa), egraph.find(fb));
+  EXPECT_EQ(egraph.num_enodes(), 3u);
+  EXPECT_EQ(egraph.num_eclasses(), 2u);
+  // Adding it again finds the existing e-class
+  EXPECT_EQ(egraph.find(egraph.add_operator(node_of(relu), {ea})[0]),
+            egraph.find(fa));
+  EXPECT_EQ(egraph.num_enodes(), 3u);
+}
+
+TEST(egraph, saturate_stops_at_budget) {
+  TestOp x(1, OP_INPUT), relu(2, OP_RELU), split(3, OP_SPLIT, 2);
+  EGraph egraph(NULL);
+  int ex = egraph.add_operator(node_of(x), {})[0];
+  int er = egraph.add_operator(node_of(relu), {ex})[0];
+  egraph.add_operator(node_of(split), {er});
+  EXPECT_EQ(egraph.num_enodes(), 4u);
+
+  std::vector<GraphXfer *> xfers;
+  // A full e-graph is not matched at all
+  EXPECT_EQ(egraph.saturate(xfers, 4), 0);
+  EXPECT_EQ(egraph.saturate(xfers, 2), 0);
+  EXPECT_EQ(egraph.num_enodes(), 4u);
+  // Below the budget it stops after the first round that changes nothing
+  EXPECT_EQ(egraph.saturate(xfers, 100), 1);
+  EXPECT_EQ(egraph.num_enodes(), 4u);
+}
+
+TEST(egraph, extract_picks_cheapest) {
+  TestOp x(1, OP_INPUT), linear(2, OP_LINEAR), relu(3, OP_RELU),
+      dropout(4, OP_DROPOUT), softmax(5, OP_SOFTMAX);
+  EGraph egraph(NULL);
+  int ex = egraph.add_operator(node_of(x), {})[0];
+  // linear(x) and dropout(relu(x)) are equivalent
+  int el = egraph.add_operator(node_of(linear), {ex})[0];
+  int er = egraph.add_operator(node_of(relu), {ex})[0];
+  int ed = egraph.add_operator(node_of(dropout), {er})[0];
+  int es = egraph.add_operator(node_of(softmax), {el})[0];
+  egraph.merge(el, ed);
+  egraph.rebuild();
+
+  std::map<Op const *, float> costs = {
+      {&x, 0.0f}, {&linear, 5.0f}, {&relu, 1.0f}, {&dropout, 1.0f}};
+  auto op_cost = [&](Op const *op) {
+    auto const &it = costs.find(op);
+    return it == costs.end() ? 1.0f : it->second;
+  };
+  std::vector<int> best = egraph.pick_enodes(op_cost);
+  EXPECT_EQ(egraph.get_enode(best[egraph.find(el)]).node.ptr, &dropout);
+  EXPECT_EQ(egraph.get_enode(best[egraph.find(er)]).node.ptr, &relu);
+  EXPECT_EQ(egraph.get_enode(best[egraph.find(es)]).node.ptr, &softmax);
+
+  // Once linear is cheaper it is picked instead
+  costs[&linear] = 1.5f;
+  best = egraph.pick_enodes(op_cost);
+  EXPECT_EQ(egraph.get_enode(best[egraph.find(el)]).node.ptr, &linear);
+
+  // An e-class whose every e-node has infinite cost is not picked
+  costs[&x] = std::numeric_limits<float>::infinity();
+  best = egraph.pick_enodes(op_cost);
+  EXPECT_EQ(best[egraph.find(es)], -1);
+}
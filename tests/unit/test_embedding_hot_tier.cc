@@ -0,0 +1,99 @@
+#include "flexflow/ops/embedding_hot_tier.h"
+#include "gtest/gtest.h"
+
+using namespace FlexFlow;
+
+namespace {
+
+// Row r of a table of out_dim columns holds r * 10 + column
+std::vector<float> make_table(int num_entries, int out_dim) {
+  std::vector<float> table((size_t)num_entries * out_dim);
+  for (int r = 0; r < num_entries; r++) {
+    for (int j = 0; j < out_dim; j++) {
+      table[(size_t)r * out_dim + j] = r * 10.0f + j;
+    }
+  }
+  return table;
+}
+
+// Records batches until the tier is due for a refresh
+void record_until_refresh(EmbeddingHotTier &tier,
+                          std::vector<int64_t> const &batch) {
+  while (!tier.record_batch(batch.data(), batch.size())) {
+  }
+}
+
+} // namespace
+
+TEST(embedding_hot_tier, keeps_most_frequent_rows) {
+  std::vector<float> table = make_table(100, 4);
+  EmbeddingHotTier tier(100, 4, 2, EmbeddingHotTier::SAMPLE_INTERVAL);
+  EXPECT_EQ(tier.find(7), nullptr);
+
+  // 7 and 42 are the most frequent; padding and out of range indices are
+  // not counted
+  record_until_refresh(tier, {7, 42, 7, 3, 42, 7, -1, 100, 12345});
+  EXPECT_EQ(tier.get_lookups(), 6u);
+  EXPECT_EQ(tier.get_hit_rate(), 0.0);
+  tier.refresh(table.data());
+  EXPECT_EQ(tier.get_rows(), std::vector<int64_t>({7, 42}));
+  ASSERT_NE(tier.find(42), nullptr);
+  EXPECT_EQ(tier.find(42)[0], 420.0f);
+  EXPECT_EQ(tier.find(42)[3], 423.0f);
+  EXPECT_EQ(tier.find(3), nullptr);
+  EXPECT_EQ(tier.find(-1), nullptr);
+  EXPECT_EQ(tier.find(12345), nullptr);
+
+  // The next window counts hits against the refreshed tier
+  record_until_refresh(tier, {7, 3, 3, 3});
+  EXPECT_EQ(tier.get_hit_rate(), 0.25);
+}
+
+TEST(embedding_hot_tier, ages_out_old_rows) {
+  std::vector<float> table = make_table(100, 2);
+  EmbeddingHotTier tier(100, 2, 1, EmbeddingHotTier::SAMPLE_INTERVAL);
+  record_until_refresh(tier, {5, 5, 5, 5});
+  tier.refresh(table.data());
+  EXPECT_EQ(tier.get_rows(), std::vector<int64_t>({5}));
+  // Halved at each refresh, the old counts lose to a row that is now hot
+  record_until_refresh(tier, {9, 9, 9});
+  tier.refresh(table.data());
+  EXPECT_EQ(tier.get_rows(), std::vector<int64_t>({9}));
+}
+
+TEST(embedding_hot_tier, reload_after_write) {
+  std::vector<float> table = make_table(10, 2);
+  EmbeddingHotTier tier(10, 2, 4, 1);
+  record_until_refresh(tier, {1, 2});
+  tier.refresh(table.data());
+  table[2 * 2 + 1] = -1.0f;
+  EXPECT_EQ(tier.find(2)[1], 21.0f);
+  tier.reload(table.data());
+  EXPECT_EQ(tier.find(2)[1], -1.0f);
+}
+
+TEST(embedding_hot_tier, many_rows) {
+  int const num_entries = 1 << 20, capacity = 1000;
+  std::vector<float> table = make_table(num_entries, 1);
+  EmbeddingHotTier tier(num_entries, 1, capacity, 1);
+  // Rows that are multiples of 1021 are looked up three times
+  std::vector<int64_t> batch;
+  for (int64_t r = 0; r < num_entries; r += 97) {
+    batch.push_back(r);
+    if (r % 1021 == 0) {
+      batch.push_back(r);
+      batch.push_back(r);
+    }
+  }
+  record_until_refresh(tier, batch);
+  tier.refresh(table.data());
+  ASSERT_EQ(tier.get_rows().size(), (size_t)capacity);
+  size_t num_hot = 0;
+  for (int64_t r : tier.get_rows()) {
+    num_hot += r % 1021 == 0;
+    ASSERT_NE(tier.find(r), nullptr);
+    EXPECT_EQ(tier.find(r)[0], r * 10.0f);
+  }
+  // every multiple of both 97 and 1021 made it in
+  EXPECT_EQ(num_hot, (size_t)(num_entries - 1) / (97 * 1021) + 1);
+}
@@ -0,0 +1,33 @@
+#include "flexflow/fx_importer.h"
+#include "gtest/gtest.h"
+
+using namespace FlexFlow;
+
+TEST(fx_importer, parse_fx_node) {
+  FXNode node;
+  EXPECT_TRUE(parse_fx_node(
+      "getitem; split,; add,mul,; GETITEM; None; slice(None, None, None)\n",
+      node));
+  EXPECT_EQ(node.name, "getitem");
+  EXPECT_EQ(node.innodes, std::vector<std::string>({"split"}));
+  EXPECT_EQ(node.outnodes, std::vector<std::string>({"add", "mul"}));
+  EXPECT_EQ(node.op_type, "GETITEM");
+  EXPECT_EQ(node.args,
+            std::vector<std::string>({"None", "slice(None, None, None)"}));
+
+  EXPECT_TRUE(parse_fx_node("x; ; linear,; INPUT", node));
+  EXPECT_TRUE(node.innodes.empty());
+  EXPECT_TRUE(node.args.empty());
+
+  EXPECT_TRUE(parse_fx_node("weight; ATTRIBUTE", node));
+  EXPECT_EQ(node.op_type, "ATTRIBUTE");
+  EXPECT_TRUE(node.outnodes.empty());
+
+  EXPECT_FALSE(parse_fx_node(" \n", node));
+}
+
+TEST(fx_importer, malformed_fx_node) {
+  FXNode node;
+  EXPECT_THROW(parse_fx_node("relu; x,; LINEAR", node), std::runtime_error);
+  EXPECT_THROW(parse_fx_node("relu", node), std::runtime_error);
+}
@@ -31,3 +31,22 @@ TEST(machine_view_get_device_id, basic) {
   EXPECT_EQ(mv.get_device_id({0}), 2);
   EXPECT_EQ(mv.get_device_id({1}), 3);
 }
+
+TEST(machine_view_get_symmetry_key, symmetry) {
+  // Two GPUs of node 0, and two GPUs of node 1, on 4 GPUs per node
+  MachineView a;
+  a.ndims = 1;
+  a.dim[0] = 2;
+  a.stride[0] = 1;
+  MachineView b = a;
+  b.start_device_id = 4;
+  MachineView c = a;
+  c.stride[0] = 2;
+
+  EXPECT_EQ(a.get_symmetry_key(4, false), b.get_symmetry_key(4, false));
+  EXPECT_NE(a.get_symmetry_key(4, false), c.get_symmetry_key(4, false));
+  EXPECT_EQ(a.get_symmetry_key(4, true), c.get_symmetry_key(4, true));
+  // Spanning two nodes is never equivalent to staying in one
+  c.stride[0] = 4;
+  EXPECT_NE(a.get_symmetry_key(4, true), c.get_symmetry_key(4, true));
+}
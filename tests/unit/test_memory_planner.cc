@@ -0,0 +1,41 @@
+#include "flexflow/memory_planner.h"
+#include "gtest/gtest.h"
+
+using namespace FlexFlow;
+
+TEST(memory_planner, chain) {
+  // A chain of operators where every activation is only read by the next one
+  MemoryPlanner planner(1);
+  for (int i = 0; i < 5; i++) {
+    planner.add_buffer({(size_t)i, 0, 100, i, i + 1});
+  }
+  MemoryPlan plan = planner.plan();
+  EXPECT_EQ(plan.naive_bytes[0], 500);
+  EXPECT_EQ(plan.live_bytes[0], 200);
+  EXPECT_EQ(plan.planned_bytes[0], 200);
+  EXPECT_NE(plan.offsets[0], plan.offsets[1]);
+  EXPECT_EQ(plan.offsets[0], plan.offsets[2]);
+}
+
+TEST(memory_planner, overlapping) {
+  MemoryPlanner planner(1);
+  planner.add_buffer({0, 0, 100, 0, 3});
+  planner.add_buffer({1, 0, 50, 1, 2});
+  planner.add_buffer({2, 0, 50, 2, 3});
+  planner.add_buffer({3, 1, 10, 0, 3});
+  MemoryPlan plan = planner.plan();
+  EXPECT_EQ(plan.naive_bytes[0], 200);
+  EXPECT_EQ(plan.planned_bytes[0], 200);
+  EXPECT_EQ(plan.planned_bytes[1], 10);
+  EXPECT_EQ(plan.offsets[0], 0);
+}
+
+TEST(memory_planner, alignment) {
+  MemoryPlanner planner(256);
+  planner.add_buffer({0, 0, 1, 0, 0});
+  planner.add_buffer({1, 0, 300, 0, 0});
+  MemoryPlan plan = planner.plan();
+  EXPECT_EQ(plan.planned_bytes[0], 768);
+  EXPECT_EQ(plan.offsets[1], 0);
+  EXPECT_EQ(plan.offsets[0], 512);
+}
@@ -0,0 +1,53 @@
+#include "flexflow/utils/persistent_map.h"
+#include "gtest/gtest.h"
+#include <unordered_map>
+
+TEST(persistent_map, copies_are_independent) {
+  persistent_map<int, int> a;
+  for (int i = 0; i < 1000; i++) {
+    a[i] = i;
+  }
+  persistent_map<int, int> b = a;
+  b[7] = -7;
+  b.erase(8);
+  b[1000] = 1000;
+  EXPECT_EQ(a.size(), 1000);
+  EXPECT_EQ(b.size(), 1000);
+  EXPECT_EQ(a.at(7), 7);
+  EXPECT_EQ(b.at(7), -7);
+  EXPECT_EQ(a.count(8), 1);
+  EXPECT_EQ(b.count(8), 0);
+  EXPECT_EQ(a.count(1000), 0);
+  size_t num_entries = 0;
+  for (auto const &kv : b) {
+    EXPECT_EQ(kv.second, kv.first == 7 ? -7 : kv.first);
+    num_entries++;
+  }
+  EXPECT_EQ(num_entries, b.size());
+}
+
+// All keys share their hash, so they end up in the nodes for collisions
+struct ConstantHash {
+  size_t operator()(int) const {
+    return 42;
+  }
+};
+
+TEST(persistent_map, hash_collisions) {
+  persistent_map<int, int, ConstantHash> map;
+  std::unordered_map<int, int> expected;
+  for (int i = 0; i < 20; i++) {
+    map[i] = i * i;
+    expected[i] = i * i;
+  }
+  for (int i = 0; i < 20; i += 3) {
+    EXPECT_EQ(map.erase(i), 1);
+    expected.erase(i);
+  }
+  EXPECT_EQ(map.erase(0), 0);
+  EXPECT_EQ(map.size(), expected.size());
+  for (auto const &kv : map) {
+    EXPECT_EQ(expected.at(kv.first), kv.second);
+  }
+  EXPECT_THROW(map.at(3), std::out_of_range);
+}
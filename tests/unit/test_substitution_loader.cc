@@ -5,6 +5,7 @@
 namespace sl = FlexFlow::substitution_loader;
 // using namespace FlexFlow::substitution_loader;
 using json = nlohmann::json;
+using FlexFlow::PCG::create_lazy_xfers;
 using FlexFlow::PCG::create_xfer;
 using FlexFlow::PCG::create_xfers;
 using FlexFlow::PCG::GraphXfer;
@@ -142,3 +143,62 @@ TEST(substitution_loader, load_full_file) {
   std::vector<GraphXfer *> xfers = create_xfers(nullptr, collection, 2);
   EXPECT_EQ(xfers.size(), 640);
 }
+
+TEST(substitution_loader, binary_round_trip) {
+  sl::RuleCollection collection =
+      sl::load_rule_collection_from_path("tests/unit/graph_subst_3_v2.json");
+  std::string path = "tests/unit/graph_subst_3_v2.ffsr";
+  sl::save_rule_collection_binary(collection, path);
+  sl::RuleCollection loaded = sl::load_rule_collection_from_path(path);
+  remove(path.c_str());
+
+  ASSERT_EQ(loaded.rules.size(), collection.rules.size());
+  for (size_t i = 0; i < collection.rules.size(); i++) {
+    sl::Rule const &r1 = collection.rules[i], &r2 = loaded.rules[i];
+    EXPECT_EQ(r1.name, r2.name);
+    ASSERT_EQ(r1.srcOp.size(), r2.srcOp.size());
+    ASSERT_EQ(r1.dstOp.size(), r2.dstOp.size());
+    for (size_t j = 0; j < r1.srcOp.size() + r1.dstOp.size(); j++) {
+      sl::Operator const &o1 = j < r1.srcOp.size()
+                                   ? r1.srcOp[j]
+                                   : r1.dstOp[j - r1.srcOp.size()];
+      sl::Operator const &o2 = j < r2.srcOp.size()
+                                   ? r2.srcOp[j]
+                                   : r2.dstOp[j - r2.srcOp.size()];
+      EXPECT_EQ(o1.op_type, o2.op_type);
+      ASSERT_EQ(o1.input.size(), o2.input.size());
+      for (size_t k = 0; k < o1.input.size(); k++) {
+        EXPECT_EQ(o1.input[k].opId, o2.input[k].opId);
+        EXPECT_EQ(o1.input[k].tsId, o2.input[k].tsId);
+      }
+      ASSERT_EQ(o1.para.size(), o2.para.size());
+      for (size_t k = 0; k < o1.para.size(); k++) {
+        EXPECT_EQ(o1.para[k].key, o2.para[k].key);
+        EXPECT_EQ(o1.para[k].value, o2.para[k].value);
+      }
+    }
+    ASSERT_EQ(r1.mappedOutput.size(), r2.mappedOutput.size());
+    for (size_t j = 0; j < r1.mappedOutput.size(); j++) {
+      EXPECT_EQ(r1.mappedOutput[j].dstOpId, r2.mappedOutput[j].dstOpId);
+      EXPECT_EQ(r1.mappedOutput[j].dstTsId, r2.mappedOutput[j].dstTsId);
+      EXPECT_EQ(r1.mappedOutput[j].srcOpId, r2.mappedOutput[j].srcOpId);
+      EXPECT_EQ(r1.mappedOutput[j].srcTsId, r2.mappedOutput[j].srcTsId);
+    }
+  }
+}
+
+TEST(substitution_loader, lazy_xfers) {
+  std::shared_ptr<sl::RuleCollection const> collection =
+      sl::get_rule_collection("tests/unit/graph_subst_3_v2.json");
+  EXPECT_EQ(sl::get_rule_collection("tests/unit/graph_subst_3_v2.json"),
+            collection);
+
+  std::vector<GraphXfer *> xfers = create_xfers(nullptr, *collection, 2);
+  std::vector<GraphXfer *> lazy_xfers =
+      create_lazy_xfers(nullptr, collection, 2);
+  ASSERT_EQ(lazy_xfers.size(), xfers.size());
+  for (size_t i = 0; i < xfers.size(); i++) {
+    EXPECT_EQ(lazy_xfers[i]->name, xfers[i]->name);
+    EXPECT_EQ(lazy_xfers[i]->srcOps.size(), 0);
+  }
+}
@@ -0,0 +1,125 @@
+#include "flexflow/substitution.h"
+#include "flexflow/substitution_loader.h"
+#include "gtest/gtest.h"
+
+namespace sl = FlexFlow::substitution_loader;
+using FlexFlow::PCG::create_lazy_xfers;
+using FlexFlow::PCG::create_xfer;
+using FlexFlow::PCG::GraphSearchHelper;
+using FlexFlow::PCG::GraphXfer;
+
+typedef std::vector<std::pair<OperatorType, int>> OpTypes;
+
+namespace {
+
+// Takes the xfer inputs or the first output of the previous operator
+sl::Operator rule_op(OperatorType type,
+                     std::vector<int> inputs,
+                     bool has_degree = false) {
+  sl::Operator op;
+  op.op_type = type;
+  for (int op_id : inputs) {
+    op.input.push_back({op_id, 0});
+  }
+  if (has_degree) {
+    op.para.push_back({PM_PARALLEL_DEGREE, 0});
+  }
+  return op;
+}
+
+sl::Rule rule(std::string const &name,
+              std::vector<sl::Operator> const &src,
+              std::vector<sl::Operator> const &dst) {
+  sl::Rule r;
+  r.name = name;
+  r.srcOp = src;
+  r.dstOp = dst;
+  return r;
+}
+
+std::vector<std::string> names_of(std::vector<GraphXfer *> const &xfers) {
+  std::vector<std::string> names;
+  for (GraphXfer const *xfer : xfers) {
+    names.push_back(xfer->name);
+  }
+  return names;
+}
+
+// linear -> repartition, linear, combine
+// combine -> replicate, reduction
+// relu -> repartition, relu
+std::shared_ptr<sl::RuleCollection const> chained_rules() {
+  auto rules = std::make_shared<sl::RuleCollection>();
+  rules->rules.push_back(rule("partition_linear",
+                              {rule_op(OP_LINEAR, {-1})},
+                              {rule_op(OP_REPARTITION, {-1}, true),
+                               rule_op(OP_LINEAR, {0}),
+                               rule_op(OP_COMBINE, {1}, true)}));
+  rules->rules.push_back(rule("replicate_combine",
+                              {rule_op(OP_COMBINE, {-1}, true)},
+                              {rule_op(OP_REPLICATE, {-1}, true),
+                               rule_op(OP_REDUCTION, {0}, true)}));
+  rules->rules.push_back(rule("partition_relu",
+                              {rule_op(OP_RELU, {-1})},
+                              {rule_op(OP_REPARTITION, {-1}, true),
+                               rule_op(OP_RELU, {0})}));
+  return rules;
+}
+
+} // namespace
+
+TEST(xfer_pruning, get_op_types) {
+  std::vector<GraphXfer *> xfers =
+      create_lazy_xfers(nullptr, chained_rules(), 4);
+  ASSERT_EQ(xfers.size(), 3u);
+  EXPECT_EQ(xfers[0]->get_op_types(true), OpTypes({{OP_LINEAR, 0}}));
+  EXPECT_EQ(xfers[0]->get_op_types(false),
+            OpTypes({{OP_REPARTITION, 4}, {OP_LINEAR, 0}, {OP_COMBINE, 4}}));
+
+  // An xfer with operators created reports the same types
+  GraphXfer eager(nullptr);
+  create_xfer(eager, chained_rules()->rules[0], 4);
+  EXPECT_EQ(eager.get_op_types(true), xfers[0]->get_op_types(true));
+  EXPECT_EQ(eager.get_op_types(false), xfers[0]->get_op_types(false));
+
+  for (GraphXfer *xfer : xfers) {
+    delete xfer;
+  }
+}
+
+TEST(xfer_pruning, keeps_reachable_xfers) {
+  std::vector<GraphXfer *> xfers =
+      create_lazy_xfers(nullptr, chained_rules(), 2);
+  // replicate_combine matches the combine partition_linear creates
+  EXPECT_EQ(names_of(GraphSearchHelper::prune_xfers(
+                {{OP_INPUT, 0}, {OP_LINEAR, 0}}, xfers)),
+            std::vector<std::string>({"partition_linear",
+                                      "replicate_combine"}));
+  // A combine of another degree does not match it
+  EXPECT_EQ(names_of(GraphSearchHelper::prune_xfers(
+                {{OP_RELU, 0}, {OP_COMBINE, 8}}, xfers)),
+            std::vector<std::string>({"partition_relu"}));
+  EXPECT_TRUE(
+      GraphSearchHelper::prune_xfers({{OP_INPUT, 0}, {OP_SOFTMAX, 0}}, xfers)
+          .empty());
+
+  for (GraphXfer *xfer : xfers) {
+    delete xfer;
+  }
+}
+
+TEST(xfer_pruning, counts_source_operators) {
+  GraphXfer fuse(nullptr);
+  create_xfer(fuse,
+              rule("fuse_adds",
+                   {rule_op(OP_EW_ADD, {-1, -2}), rule_op(OP_EW_ADD, {0, -3})},
+                   {rule_op(OP_EW_ADD, {-1, -2}), rule_op(OP_RELU, {0})}),
+              2);
+  std::vector<GraphXfer *> xfers = {&fuse};
+  EXPECT_TRUE(
+      GraphSearchHelper::prune_xfers({{OP_EW_ADD, 0}, {OP_RELU, 0}}, xfers)
+          .empty());
+  EXPECT_EQ(GraphSearchHelper::prune_xfers(
+                {{OP_EW_ADD, 0}, {OP_RELU, 0}, {OP_EW_ADD, 0}}, xfers),
+            xfers);
+}